@@ -68,6 +68,35 @@ namespace Falcor
         }
     }
 
+    CopyContext::ReadTextureTask::SharedPtr CopyContext::ReadTextureTask::create(CopyContext* pCtx, const Texture* pTexture, uint32_t subresourceIndex)
+    {
+        SharedPtr pThis = createReusable(pCtx);
+        pThis->record(pTexture, subresourceIndex);
+        pCtx->flush(false);
+        return pThis;
+    }
+
+    CopyContext::ReadTextureTask::SharedPtr CopyContext::ReadTextureTask::createReusable(CopyContext* pCtx)
+    {
+        assert(pCtx);
+        SharedPtr pThis = SharedPtr(new ReadTextureTask);
+        pThis->mpContext = pCtx;
+        pThis->mpFence = pCtx->getLowLevelData()->getFence();
+        return pThis;
+    }
+
+    bool CopyContext::ReadTextureTask::isReady() const
+    {
+        return mpFence->getGpuValue() >= mFenceValue;
+    }
+
+    void CopyContext::ReadTextureTask::syncCpu()
+    {
+        // The context signals its fence with the current CPU value when flushed. If that value hasn't been signaled yet, the copy is still in the open command list.
+        if (mpFence->getCpuValue() <= mFenceValue) mpContext->flush(false);
+        mpFence->syncCpu(mFenceValue);
+    }
+
     CopyContext::ReadTextureTask::SharedPtr CopyContext::asyncReadTextureSubresource(const Texture* pTexture, uint32_t subresourceIndex)
     {
         return CopyContext::ReadTextureTask::create(this, pTexture, subresourceIndex);
@@ -44,10 +44,31 @@ namespace Falcor
         public:
             using SharedPtr = std::shared_ptr<ReadTextureTask>;
             static SharedPtr create(CopyContext* pCtx, const Texture* pTexture, uint32_t subresourceIndex);
+
+            /** Create a task without a readback. Readbacks are recorded with record(), which reuses the task's staging buffer.
+            */
+            static SharedPtr createReusable(CopyContext* pCtx);
+
+            /** Record a readback of a texture subresource into the staging buffer.
+                The staging buffer is only reallocated if the size of the subresource data changes.
+                The copy is not submitted, it executes when the context is flushed. Its completion is tracked with the context's fence.
+                The previous readback must have been read with getData() before recording a new one.
+            */
+            void record(const Texture* pTexture, uint32_t subresourceIndex);
+
+            /** Get the data of the last readback. Flushes the context if the copy has not been submitted, and waits for the GPU to finish the copy.
+            */
             std::vector<uint8_t> getData();
+
+            /** Check if the GPU has finished the copy, in which case getData() doesn't block.
+            */
+            bool isReady() const;
         private:
             ReadTextureTask() = default;
+            void syncCpu();
+
             GpuFence::SharedPtr mpFence;
+            uint64_t mFenceValue = 0;       ///< Fence value signaled once the copy has executed.
             Buffer::SharedPtr mpBuffer;
             CopyContext* mpContext;
 #ifdef FALCOR_D3D12
@@ -142,40 +142,38 @@ namespace Falcor
         pBuffer->unmap();
     }
 
-    CopyContext::ReadTextureTask::SharedPtr CopyContext::ReadTextureTask::create(CopyContext* pCtx, const Texture* pTexture, uint32_t subresourceIndex)
+    void CopyContext::ReadTextureTask::record(const Texture* pTexture, uint32_t subresourceIndex)
     {
-        SharedPtr pThis = SharedPtr(new ReadTextureTask);
-        pThis->mpContext = pCtx;
+        CopyContext* pCtx = mpContext;
         //Get footprint
         D3D12_RESOURCE_DESC texDesc = pTexture->getApiHandle()->GetDesc();
-        D3D12_PLACED_SUBRESOURCE_FOOTPRINT& footprint = pThis->mFootprint;
+        D3D12_PLACED_SUBRESOURCE_FOOTPRINT& footprint = mFootprint;
         uint64_t rowSize;
         uint64_t size;
         ID3D12Device* pDevice = gpDevice->getApiHandle();
-        pDevice->GetCopyableFootprints(&texDesc, subresourceIndex, 1, 0, &footprint, &pThis->mRowCount, &rowSize, &size);
+        pDevice->GetCopyableFootprints(&texDesc, subresourceIndex, 1, 0, &footprint, &mRowCount, &rowSize, &size);
 
-        //Create buffer
-        pThis->mpBuffer = Buffer::create(size, Buffer::BindFlags::None, Buffer::CpuAccess::Read, nullptr);
+        //Create buffer, or reuse the one from the previous readback
+        if (!mpBuffer || mpBuffer->getSize() != size)
+        {
+            mpBuffer = Buffer::create(size, Buffer::BindFlags::None, Buffer::CpuAccess::Read, nullptr);
+        }
 
         //Copy from texture to buffer
         D3D12_TEXTURE_COPY_LOCATION srcLoc = { pTexture->getApiHandle(), D3D12_TEXTURE_COPY_TYPE_SUBRESOURCE_INDEX, subresourceIndex };
-        D3D12_TEXTURE_COPY_LOCATION dstLoc = { pThis->mpBuffer->getApiHandle(), D3D12_TEXTURE_COPY_TYPE_PLACED_FOOTPRINT, footprint };
+        D3D12_TEXTURE_COPY_LOCATION dstLoc = { mpBuffer->getApiHandle(), D3D12_TEXTURE_COPY_TYPE_PLACED_FOOTPRINT, footprint };
         pCtx->resourceBarrier(pTexture, Resource::State::CopySource);
         pCtx->getLowLevelData()->getCommandList()->CopyTextureRegion(&dstLoc, 0, 0, 0, &srcLoc, nullptr);
         pCtx->setPendingCommands(true);
 
-        // Create a fence and signal
-        pThis->mpFence = GpuFence::create();
-        pCtx->flush(false);
-        pThis->mpFence->gpuSignal(pCtx->getLowLevelData()->getCommandQueue());
-        pThis->mTextureFormat = pTexture->getFormat();
-
-        return pThis;
+        // The copy has executed once the context's next flush has signaled the fence
+        mFenceValue = mpFence->getCpuValue();
+        mTextureFormat = pTexture->getFormat();
     }
 
     std::vector<uint8_t> CopyContext::ReadTextureTask::getData()
     {
-        mpFence->syncCpu();
+        syncCpu();
         D3D12_PLACED_SUBRESOURCE_FOOTPRINT& footprint = mFootprint;
 
         // Calculate row size. GPU pitch can be different because it is aligned to D3D12_TEXTURE_DATA_PITCH_ALIGNMENT
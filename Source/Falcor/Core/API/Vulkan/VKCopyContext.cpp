@@ -184,8 +184,11 @@ namespace Falcor
 
         dataSize = getMipLevelPackedDataSize(pTexture, vkCopy.imageExtent.width, vkCopy.imageExtent.height, vkCopy.imageExtent.depth, pTexture->getFormat());
 
-        // Upload the data to a staging buffer
-        pStaging = Buffer::create(dataSize, Buffer::BindFlags::None, pSrcData ? Buffer::CpuAccess::Write : Buffer::CpuAccess::Read, pSrcData);
+        // Upload the data to a staging buffer. Readbacks reuse the staging buffer passed in if it has the right size.
+        if (pSrcData || !pStaging || pStaging->getSize() != dataSize)
+        {
+            pStaging = Buffer::create(dataSize, Buffer::BindFlags::None, pSrcData ? Buffer::CpuAccess::Write : Buffer::CpuAccess::Read, pSrcData);
+        }
         vkCopy.bufferOffset = pStaging->getGpuAddressOffset();
     }
 
@@ -219,30 +222,27 @@ namespace Falcor
         }
     }
 
-    CopyContext::ReadTextureTask::SharedPtr CopyContext::ReadTextureTask::create(CopyContext* pCtx, const Texture* pTexture, uint32_t subresourceIndex)
+    void CopyContext::ReadTextureTask::record(const Texture* pTexture, uint32_t subresourceIndex)
     {
-        SharedPtr pThis = SharedPtr(new ReadTextureTask);
-        pThis->mpContext = pCtx;
+        CopyContext* pCtx = mpContext;
 
+        // The staging buffer from the previous readback is reused if it has the right size
         VkBufferImageCopy vkCopy;
-        initTexAccessParams(pTexture, subresourceIndex, vkCopy, pThis->mpBuffer, nullptr, {}, uint3(-1, -1, -1), pThis->mDataSize);
+        initTexAccessParams(pTexture, subresourceIndex, vkCopy, mpBuffer, nullptr, {}, uint3(-1, -1, -1), mDataSize);
 
         // Execute the copy
         pCtx->resourceBarrier(pTexture, Resource::State::CopySource);
-        pCtx->resourceBarrier(pThis->mpBuffer.get(), Resource::State::CopyDest);
-        vkCmdCopyImageToBuffer(pCtx->getLowLevelData()->getCommandList(), pTexture->getApiHandle(), VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, pThis->mpBuffer->getApiHandle(), 1, &vkCopy);
-
-        // Create a fence and signal
-        pThis->mpFence = GpuFence::create();
-        pCtx->flush(false);
-        pThis->mpFence->gpuSignal(pCtx->getLowLevelData()->getCommandQueue());
+        pCtx->resourceBarrier(mpBuffer.get(), Resource::State::CopyDest);
+        vkCmdCopyImageToBuffer(pCtx->getLowLevelData()->getCommandList(), pTexture->getApiHandle(), VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, mpBuffer->getApiHandle(), 1, &vkCopy);
+        pCtx->setPendingCommands(true);
 
-        return pThis;
+        // The copy has executed once the context's next flush has signaled the fence
+        mFenceValue = mpFence->getCpuValue();
     }
 
     std::vector<uint8_t> CopyContext::ReadTextureTask::getData()
     {
-        mpFence->syncCpu();
+        syncCpu();
         // Map and read the results
         std::vector<uint8> result(mDataSize);
         uint8* pData = reinterpret_cast<uint8*>(mpBuffer->map(Buffer::MapType::Read));
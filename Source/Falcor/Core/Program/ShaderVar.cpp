@@ -27,6 +27,7 @@
  **************************************************************************/
 #include "stdafx.h"
 #include "ShaderVar.h"
+#include "ShaderVarHandle.h"
 
 namespace Falcor
 {
@@ -140,6 +141,11 @@ namespace Falcor
         return (*this)[std::string(name)];
     }
 
+    ShaderVar ShaderVar::operator[](const ShaderVarHandle& handle) const
+    {
+        return handle(*this);
+    }
+
     ShaderVar ShaderVar::operator[](size_t index) const
     {
         if (!isValid()) return *this;
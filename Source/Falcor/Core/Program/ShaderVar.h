@@ -34,6 +34,7 @@
 namespace Falcor
 {
     class ParameterBlock;
+    class ShaderVarHandle;
     template<typename T>
     class ParameterBlockSharedPtr;
 
@@ -127,6 +128,14 @@ namespace Falcor
         */
         ShaderVar operator[](const std::string& name) const;
 
+        /** Get a shader variable pointer to a sub-field using a pre-resolved handle.
+
+            This works like `operator[](const char*)` with the handle's member path, but the member lookup is
+            only done the first time the handle is applied to a variable of a given type.
+            If no matching member is found an error is logged and an invalid `ShaderVar` is returned.
+        */
+        ShaderVar operator[](const ShaderVarHandle& handle) const;
+
         /** Get a shader variable pointer to an element or sub-field.
 
             This operation is valid in two cases:
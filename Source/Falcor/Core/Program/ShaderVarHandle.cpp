@@ -0,0 +1,94 @@
+/***************************************************************************
+ # Copyright (c) 2015-21, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "stdafx.h"
+#include "ShaderVarHandle.h"
+
+namespace Falcor
+{
+    ShaderVarHandle::ShaderVarHandle(const std::string& path)
+        : mPath(path)
+    {
+        mMembers = splitString(path, ".");
+        if (mMembers.empty()) throw std::exception("ShaderVarHandle path must not be empty.");
+    }
+
+    ShaderVar ShaderVarHandle::operator()(const ShaderVar& var) const
+    {
+        ShaderVar result = find(var);
+        if (!result.isValid() && var.isValid())
+        {
+            logError("No member named '" + mPath + "' found.");
+        }
+        return result;
+    }
+
+    ShaderVar ShaderVarHandle::find(const ShaderVar& var) const
+    {
+        if (!var.isValid()) return var;
+
+        const TypedShaderVarOffset& offset = resolve(var);
+        return offset.isValid() ? var[offset] : ShaderVar();
+    }
+
+    const TypedShaderVarOffset& ShaderVarHandle::resolve(const ShaderVar& var) const
+    {
+        auto pType = var.getType();
+        for (const auto& entry : mCache)
+        {
+            if (entry.pType == pType) return entry.offset;
+        }
+
+        // Cache miss. The lookup is done relative to the type that `ShaderVar::operator[]` applies the offset to,
+        // which is the contents of the block if the variable is a constant buffer.
+        const ReflectionType* pContainerType = pType.get();
+        if (auto pResourceType = pType->asResourceType(); pResourceType && pResourceType->getType() == ReflectionResourceType::Type::ConstantBuffer)
+        {
+            pContainerType = var.getParameterBlock()->getElementType().get();
+        }
+
+        TypedShaderVarOffset offset = pContainerType->getZeroOffset();
+        for (const auto& name : mMembers)
+        {
+            auto pStructType = offset.getType()->asStructType();
+            auto pMember = pStructType ? pStructType->findMember(name) : nullptr;
+            if (!pMember)
+            {
+                offset = TypedShaderVarOffset();
+                break;
+            }
+            offset = TypedShaderVarOffset(pMember->getType().get(), offset + pMember->getBindLocation());
+        }
+
+        // Replace entries in round-robin order.
+        CacheEntry& entry = mCache[mNextCacheEntry];
+        mNextCacheEntry = (mNextCacheEntry + 1) % kCacheSize;
+        entry.pType = pType;
+        entry.offset = offset;
+        return entry.offset;
+    }
+}
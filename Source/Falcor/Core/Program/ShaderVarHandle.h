@@ -0,0 +1,90 @@
+/***************************************************************************
+ # Copyright (c) 2015-21, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#pragma once
+#include "ShaderVar.h"
+#include <array>
+
+namespace Falcor
+{
+    /** A pre-resolved handle to a member of a shader variable.
+
+        Looking up a member with `ShaderVar::operator[](const char*)` constructs a `std::string` and searches the
+        reflection data on every call. A `ShaderVarHandle` stores the member path and caches the resolved offset
+        for the type of the variable it is applied to, so that repeated lookups only compare a pointer and add an offset:
+
+            static const ShaderVarHandle kFrameDim("frameDim");
+            ...
+            var[kFrameDim] = frameDim;      // works like var["frameDim"] = frameDim
+
+        Reflection types are recreated whenever a program is recompiled, so cached offsets are automatically
+        re-resolved the first time the handle is applied to a variable of the new program version. The handle keeps
+        a reference to each cached type, so that a new type can never alias a stale cache entry.
+
+        A handle caches a small number of types, which allows the same handle to be shared by several programs
+        declaring a member of the same name. Applying a handle is not thread-safe.
+    */
+    class dlldecl ShaderVarHandle
+    {
+    public:
+        /** Create a handle.
+            \param[in] path Path of the member relative to the variable the handle is applied to.
+                Nested struct members are separated by '.', e.g. "params.frameDim". The path must not cross constant buffers or parameter blocks.
+        */
+        explicit ShaderVarHandle(const std::string& path);
+
+        /** Get a shader variable pointer to the member.
+            Logs an error and returns an invalid `ShaderVar` if the member doesn't exist.
+        */
+        ShaderVar operator()(const ShaderVar& var) const;
+
+        /** Try to get a shader variable pointer to the member.
+            Unlike `operator()`, no error is logged if the member doesn't exist.
+        */
+        ShaderVar find(const ShaderVar& var) const;
+
+        /** Get the member path.
+        */
+        const std::string& getPath() const { return mPath; }
+
+    private:
+        static const size_t kCacheSize = 8;
+
+        struct CacheEntry
+        {
+            ReflectionType::SharedConstPtr pType;   ///< Type of the variable the handle was applied to.
+            TypedShaderVarOffset offset;            ///< Offset of the member relative to the variable. Invalid if the member doesn't exist.
+        };
+
+        const TypedShaderVarOffset& resolve(const ShaderVar& var) const;
+
+        std::string mPath;
+        std::vector<std::string> mMembers;
+        mutable std::array<CacheEntry, kCacheSize> mCache;
+        mutable size_t mNextCacheEntry = 0;
+    };
+}
@@ -65,6 +65,40 @@ namespace Falcor
             { (uint32_t)SpatialReusePattern::Default, std::string("Default")},
         };
 
+        // Pre-resolved handles for the shader variables that are set every frame.
+        namespace ShaderVars
+        {
+            const ShaderVarHandle surfaceData("surfaceData");
+            const ShaderVarHandle normalDepth("normalDepth");
+            const ShaderVarHandle finalSamples("finalSamples");
+            const ShaderVarHandle frameDim("frameDim");
+            const ShaderVarHandle initialSamples("initialSamples");
+            const ShaderVarHandle prevReservoirs("prevReservoirs");
+            const ShaderVarHandle reservoirs("reservoirs");
+            const ShaderVarHandle giReservoirCount("giReservoirCount");
+            const ShaderVarHandle neighborOffsets("neighborOffsets");
+            const ShaderVarHandle frameIndex("frameIndex");
+            const ShaderVarHandle prevSurfaceData("prevSurfaceData");
+            const ShaderVarHandle motionVectors("motionVectors");
+            const ShaderVarHandle prevNormalDepth("prevNormalDepth");
+            const ShaderVarHandle temporalMaxSamples("temporalMaxSamples");
+            const ShaderVarHandle spatialMaxSamples("spatialMaxSamples");
+            const ShaderVarHandle reservoirCount("reservoirCount");
+            const ShaderVarHandle maxSampleAge("maxSampleAge");
+            const ShaderVarHandle cameraOrigin("cameraOrigin");
+            const ShaderVarHandle prevCameraOrigin("prevCameraOrigin");
+            const ShaderVarHandle viewProj("viewProj");
+            const ShaderVarHandle prevViewProj("prevViewProj");
+            const ShaderVarHandle forceClearReservoirs("forceClearReservoirs");
+            const ShaderVarHandle normalThreshold("normalThreshold");
+            const ShaderVarHandle depthThreshold("depthThreshold");
+            const ShaderVarHandle spatialWeightClampThreshold("spatialWeightClampThreshold");
+            const ShaderVarHandle enableSpatialWeightClamping("enableSpatialWeightClamping");
+            const ShaderVarHandle jacobianClampThreshold("jacobianClampThreshold");
+            const ShaderVarHandle enableJacobianClamping("enableJacobianClamping");
+            const ShaderVarHandle enableTemporalJacobian("enableTemporalJacobian");
+        }
+
         const uint32_t kNeighborOffsetCount = 8192;
     }
 
@@ -109,20 +143,20 @@ namespace Falcor
 
     void ScreenSpaceReSTIR::setShaderData(const ShaderVar& var) const
     {
-        var["surfaceData"] = mpSurfaceData;
-        var["normalDepth"] = mpNormalDepthTexture;
-        var["finalSamples"] = mpFinalSamples;
+        var[ShaderVars::surfaceData] = mpSurfaceData;
+        var[ShaderVars::normalDepth] = mpNormalDepthTexture;
+        var[ShaderVars::finalSamples] = mpFinalSamples;
 
-        var["frameDim"] = mFrameDim;
+        var[ShaderVars::frameDim] = mFrameDim;
 
         // ReSTIR GI.
-        var["initialSamples"] = mpGIInitialSamples;
+        var[ShaderVars::initialSamples] = mpGIInitialSamples;
         //var["prevReservoirs"] = mpGIReservoirs[(mFrameIndex + 0) % 2];
         //var["reservoirs"] = mpGIReservoirs[(mFrameIndex + 1) % 2];
-        var["prevReservoirs"] = mpGIReservoirs[((mFrameIndex - mReSTIRInstanceIndex) / mNumReSTIRInstances + 0) % 2];
-        var["reservoirs"] = mpGIReservoirs[((mFrameIndex - mReSTIRInstanceIndex) / mNumReSTIRInstances + 1) % 2];
+        var[ShaderVars::prevReservoirs] = mpGIReservoirs[((mFrameIndex - mReSTIRInstanceIndex) / mNumReSTIRInstances + 0) % 2];
+        var[ShaderVars::reservoirs] = mpGIReservoirs[((mFrameIndex - mReSTIRInstanceIndex) / mNumReSTIRInstances + 1) % 2];
 
-        var["giReservoirCount"] = mOptions->reSTIRGIReservoirCount;
+        var[ShaderVars::giReservoirCount] = mOptions->reSTIRGIReservoirCount;
     }
 
     void ScreenSpaceReSTIR::enablePass(bool enabled)
@@ -381,36 +415,36 @@ namespace Falcor
             mpScene->setRaytracingShaderData(pRenderContext, rootVar);
 
             auto var = rootVar["CB"]["gGIResampling"];
-            var["neighborOffsets"] = mpNeighborOffsets;
-            var["frameDim"] = mFrameDim;
-            var["frameIndex"] = mFrameIndex;
-            var["surfaceData"] = mpSurfaceData;
-            var["prevSurfaceData"] = mpPrevSurfaceData;
-            var["motionVectors"] = pMotionVectors;
-            var["normalDepth"] = mpNormalDepthTexture;
-            var["prevNormalDepth"] = mpPrevNormalDepthTexture;
-            var["temporalMaxSamples"] = mOptions->reSTIRGITemporalMaxSamples;
-            var["spatialMaxSamples"] = mOptions->reSTIRGISpatialMaxSamples;
-            var["reservoirCount"] = mOptions->reSTIRGIReservoirCount;
-            var["maxSampleAge"] = mOptions->reSTIRGIMaxSampleAge;
-            var["cameraOrigin"] = mpScene->getCamera()->getPosition();
-            var["prevCameraOrigin"] = mPrevCameraOrigin;
-            var["viewProj"] = mpScene->getCamera()->getViewProjMatrixNoJitter();
-            var["prevViewProj"] = mPrevViewProj;
-            var["forceClearReservoirs"] = mOptions->forceClearReservoirs;
-            var["normalThreshold"] = mOptions->normalThreshold;
-            var["depthThreshold"] = mOptions->depthThreshold;
-            var["initialSamples"] = mpGIInitialSamples;
-            var["spatialWeightClampThreshold"] = mOptions->reSTIRGISpatialWeightClampThreshold;
-            var["enableSpatialWeightClamping"] = mOptions->reSTIRGIEnableSpatialWeightClamping;
-            var["jacobianClampThreshold"] = mOptions->reSTIRGIJacobianClampTreshold;
-            var["enableJacobianClamping"] = mOptions->reSTIRGIEnableJacobianClamping;
-            var["enableTemporalJacobian"] = mOptions->reSTIREnableTemporalJacobian;
+            var[ShaderVars::neighborOffsets] = mpNeighborOffsets;
+            var[ShaderVars::frameDim] = mFrameDim;
+            var[ShaderVars::frameIndex] = mFrameIndex;
+            var[ShaderVars::surfaceData] = mpSurfaceData;
+            var[ShaderVars::prevSurfaceData] = mpPrevSurfaceData;
+            var[ShaderVars::motionVectors] = pMotionVectors;
+            var[ShaderVars::normalDepth] = mpNormalDepthTexture;
+            var[ShaderVars::prevNormalDepth] = mpPrevNormalDepthTexture;
+            var[ShaderVars::temporalMaxSamples] = mOptions->reSTIRGITemporalMaxSamples;
+            var[ShaderVars::spatialMaxSamples] = mOptions->reSTIRGISpatialMaxSamples;
+            var[ShaderVars::reservoirCount] = mOptions->reSTIRGIReservoirCount;
+            var[ShaderVars::maxSampleAge] = mOptions->reSTIRGIMaxSampleAge;
+            var[ShaderVars::cameraOrigin] = mpScene->getCamera()->getPosition();
+            var[ShaderVars::prevCameraOrigin] = mPrevCameraOrigin;
+            var[ShaderVars::viewProj] = mpScene->getCamera()->getViewProjMatrixNoJitter();
+            var[ShaderVars::prevViewProj] = mPrevViewProj;
+            var[ShaderVars::forceClearReservoirs] = mOptions->forceClearReservoirs;
+            var[ShaderVars::normalThreshold] = mOptions->normalThreshold;
+            var[ShaderVars::depthThreshold] = mOptions->depthThreshold;
+            var[ShaderVars::initialSamples] = mpGIInitialSamples;
+            var[ShaderVars::spatialWeightClampThreshold] = mOptions->reSTIRGISpatialWeightClampThreshold;
+            var[ShaderVars::enableSpatialWeightClamping] = mOptions->reSTIRGIEnableSpatialWeightClamping;
+            var[ShaderVars::jacobianClampThreshold] = mOptions->reSTIRGIJacobianClampTreshold;
+            var[ShaderVars::enableJacobianClamping] = mOptions->reSTIRGIEnableJacobianClamping;
+            var[ShaderVars::enableTemporalJacobian] = mOptions->reSTIREnableTemporalJacobian;
 
             //var["prevReservoirs"] = mpGIReservoirs[(mFrameIndex + 0) % 2];
             //var["reservoirs"] = mpGIReservoirs[(mFrameIndex + 1) % 2];
-            var["prevReservoirs"] = mpGIReservoirs[((mFrameIndex - mReSTIRInstanceIndex) / mNumReSTIRInstances + 0) % 2];
-            var["reservoirs"] = mpGIReservoirs[((mFrameIndex - mReSTIRInstanceIndex) / mNumReSTIRInstances + 1) % 2];
+            var[ShaderVars::prevReservoirs] = mpGIReservoirs[((mFrameIndex - mReSTIRInstanceIndex) / mNumReSTIRInstances + 0) % 2];
+            var[ShaderVars::reservoirs] = mpGIReservoirs[((mFrameIndex - mReSTIRInstanceIndex) / mNumReSTIRInstances + 1) % 2];
 
             mpGIResampling->execute(pRenderContext, mFrameDim.x, mFrameDim.y, 1);
 
@@ -86,6 +86,7 @@
 #include "Core/Program/ProgramVars.h"
 #include "Core/Program/ProgramVersion.h"
 #include "Core/Program/ShaderLibrary.h"
+#include "Core/Program/ShaderVarHandle.h"
 
 // Core/State
 #include "Core/State/ComputeState.h"
@@ -131,7 +132,10 @@
 #include "Utils/Algorithm/DirectedGraph.h"
 #include "Utils/Algorithm/DirectedGraphTraversal.h"
 #include "Utils/Algorithm/ParallelReduction.h"
+#include "Utils/Image/AsyncFrameCapture.h"
 #include "Utils/Image/Bitmap.h"
+#include "Utils/Image/FLIP.h"
+#include "Utils/Image/FrameWriter.h"
 #include "Utils/Image/ImageIO.h"
 #include "Utils/Math/CubicSpline.h"
 #include "Utils/Math/FalcorMath.h"
@@ -150,6 +154,7 @@
 #include "Utils/Timing/Profiler.h"
 #include "Utils/Timing/ProfilerUI.h"
 #include "Utils/Timing/TimeReport.h"
+#include "Utils/Timing/TraceProfiler.h"
 #include "Utils/UI/Font.h"
 #include "Utils/UI/Gui.h"
 #include "Utils/UI/PixelZoom.h"
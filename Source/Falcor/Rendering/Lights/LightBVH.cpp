@@ -132,6 +132,7 @@ namespace Falcor
         mPerDepthRefitEntryInfo.clear();
         mMaxTriangleCountPerLeaf = 0;
         mBVHStats = BVHStats();
+        mStatsValid = false;
         mIsValid = false;
         mIsCpuDataValid = false;
     }
@@ -142,7 +143,7 @@ namespace Falcor
         mInternalUpdater = ComputePass::create(kShaderFile, "updateInternalNodes");
     }
 
-    void LightBVH::traverseBVH(const NodeFunction& evalInternal, const NodeFunction& evalLeaf, uint32_t rootNodeIndex)
+    void LightBVH::traverseBVH(const NodeFunction& evalInternal, const NodeFunction& evalLeaf, uint32_t rootNodeIndex) const
     {
         std::stack<NodeLocation> stack({ NodeLocation{ rootNodeIndex, 0 } });
         while (!stack.empty())
@@ -173,7 +174,7 @@ namespace Falcor
         updateNodeIndices();
     }
 
-    void LightBVH::computeStats()
+    void LightBVH::computeStats() const
     {
         assert(isValid());
         mBVHStats.nodeCountPerLevel.clear();
@@ -215,6 +216,7 @@ namespace Falcor
         traverseBVH(evalInternal, evalLeaf);
 
         mBVHStats.byteSize = (uint32_t)(mNodes.size() * sizeof(mNodes[0]));
+        mStatsValid = true;
     }
 
     void LightBVH::updateNodeIndices()
@@ -304,6 +306,32 @@ namespace Falcor
         mIsCpuDataValid = true;
     }
 
+    void LightBVH::uploadCPUBufferRanges(const std::vector<uint2>& nodeRanges, const std::vector<uint32_t>& triangleIndices, const std::vector<uint2>& triangleIndexRanges, const std::vector<uint64_t>& triangleBitmasks, const std::vector<uint2>& bitmaskRanges)
+    {
+        assert(mIsValid && mIsCpuDataValid);
+
+        for (const uint2& range : nodeRanges)
+        {
+            assert(range.x < range.y && range.y <= mNodes.size());
+            mpBVHNodesBuffer->setBlob(&mNodes[range.x], range.x * sizeof(mNodes[0]), (range.y - range.x) * sizeof(mNodes[0]));
+        }
+
+        for (const uint2& range : triangleIndexRanges)
+        {
+            assert(range.x < range.y && range.y <= triangleIndices.size());
+            mpTriangleIndicesBuffer->setBlob(&triangleIndices[range.x], range.x * sizeof(triangleIndices[0]), (range.y - range.x) * sizeof(triangleIndices[0]));
+        }
+
+        for (const uint2& range : bitmaskRanges)
+        {
+            assert(range.x < range.y && range.y <= triangleBitmasks.size());
+            mpTriangleBitmasksBuffer->setBlob(&triangleBitmasks[range.x], range.x * sizeof(triangleBitmasks[0]), (range.y - range.x) * sizeof(triangleBitmasks[0]));
+        }
+
+        // The stats are recomputed on demand, see getStats().
+        mStatsValid = false;
+    }
+
     void LightBVH::syncDataToCPU() const
     {
         if (!mIsValid || mIsCpuDataValid) return;
@@ -44,6 +44,7 @@ namespace Falcor
         "Importance Sampling of Many Lights on the GPU", Ray Tracing Gems, Ch. 18, 2019.
 
         Before being used, the BVH needs to have been built using LightBVHBuilder::build().
+        When the lights move, the BVH is either refit on the GPU using refit(), or updated on the CPU using LightBVHBuilder::update().
         The data can be both used on the CPU (using traverseBVH() or on the GPU by:
           1. import LightBVH;
           2. Declare a variable of type LightBVH in your shader.
@@ -79,6 +80,7 @@ namespace Falcor
 
         /** Refit all the BVH nodes to the underlying geometry, without changing the hierarchy.
             The BVH needs to have been built before trying to refit it.
+            Refitting is not supported after incremental updates with LightBVHBuilder::update().
             \param[in] pRenderContext The render context.
         */
         void refit(RenderContext* pRenderContext);
@@ -88,7 +90,7 @@ namespace Falcor
             \param[in] evalLeaf Function called on each leaf node.
             \param[in] rootNodeIndex The index of the node to start traversing.
         */
-        void traverseBVH(const NodeFunction& evalInternal, const NodeFunction& evalLeaf, uint32_t rootNodeIndex = 0);
+        void traverseBVH(const NodeFunction& evalInternal, const NodeFunction& evalLeaf, uint32_t rootNodeIndex = 0) const;
 
         struct BVHStats
         {
@@ -104,8 +106,9 @@ namespace Falcor
         };
 
         /** Returns stats.
+            After incremental updates the stats are recomputed on first access.
         */
-        const BVHStats& getStats() const { return mBVHStats; }
+        const BVHStats& getStats() const { if (!mStatsValid) computeStats(); return mBVHStats; }
 
         /** Is the BVH valid.
             \return true if the BVH is ready for use.
@@ -125,11 +128,20 @@ namespace Falcor
         LightBVH(const LightCollection::SharedConstPtr& pLightCollection);
 
         void finalize();
-        void computeStats();
+        void computeStats() const;
         void updateNodeIndices();
         void renderStats(Gui::Widgets& widget, const BVHStats& stats) const;
 
         void uploadCPUBuffers(const std::vector<uint32_t>& triangleIndices, const std::vector<uint64_t>& triangleBitmasks);
+
+        /** Upload parts of the BVH data after an incremental update. The buffers must have been allocated by uploadCPUBuffers().
+            \param[in] nodeRanges Ranges [x, y) of nodes to upload from the CPU-side copy.
+            \param[in] triangleIndices Triangle indices.
+            \param[in] triangleIndexRanges Ranges [x, y) of triangle indices to upload.
+            \param[in] triangleBitmasks Triangle bitmasks, indexed by global triangle index.
+            \param[in] bitmaskRanges Ranges [x, y) of triangle bitmasks to upload.
+        */
+        void uploadCPUBufferRanges(const std::vector<uint2>& nodeRanges, const std::vector<uint32_t>& triangleIndices, const std::vector<uint2>& triangleIndexRanges, const std::vector<uint64_t>& triangleBitmasks, const std::vector<uint2>& bitmaskRanges);
         void syncDataToCPU() const;
 
         /** Invalidate the BVH.
@@ -153,7 +165,8 @@ namespace Falcor
         std::vector<uint32_t>                 mNodeIndices;             ///< Array of all node indices sorted by tree depth.
         std::vector<RefitEntryInfo>           mPerDepthRefitEntryInfo;  ///< Array containing for each level the number of internal nodes as well as the corresponding offset into 'mpNodeIndicesBuffer'; the very last entry contains the same data, but for all leaf nodes instead.
         uint32_t                              mMaxTriangleCountPerLeaf = 0; ///< After the BVH is built, this contains the maximum light count per leaf node.
-        BVHStats                              mBVHStats;
+        mutable BVHStats                      mBVHStats;
+        mutable bool                          mStatsValid = false;      ///< True when mBVHStats matches the current nodes.
         bool                                  mIsValid = false;         ///< True when the BVH has been built.
         mutable bool                          mIsCpuDataValid = false;  ///< Indicates whether the CPU-side data matches the GPU buffers.
 
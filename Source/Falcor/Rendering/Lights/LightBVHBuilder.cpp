@@ -27,7 +27,13 @@
  **************************************************************************/
 #include "stdafx.h"
 #include "LightBVHBuilder.h"
+#include "Scene/SceneCache.h"
+#include "Utils/NumericRange.h"
+#include "Utils/Algorithm/HostParallel.h"
+#include "Utils/Timing/TraceProfiler.h"
 #include <algorithm>
+#include <array>
+#include <execution>
 
 namespace
 {
@@ -41,6 +47,125 @@ namespace
     const uint32_t kMaxLeafTriangleCount = 1 << PackedNode::kTriangleCountBits;
     const uint32_t kMaxLeafTriangleOffset = 1 << PackedNode::kTriangleOffsetBits;
 
+    const uint64_t kInvalidBitmask = std::numeric_limits<uint64_t>::max();
+
+    // Number of levels of the maximum BVH depth kept free for the top-level tree and root node above the dynamic subtrees of the incremental BVH.
+    // This only limits the Morton build, the binned builds are only limited by the maximum depth.
+    const uint32_t kDynamicSubtreeDepthReserve = 16;
+
+    // Treelet restructuring of the Morton build.
+    const uint32_t kMaxTreeletLeafCount = 5;            ///< Number of leaves per treelet. The cost of the optimization grows as 3^n; 7 leaves improve the quality only slightly at several times the cost.
+    const uint32_t kTreeletParallelLevel = 8;           ///< The subtrees below this level are restructured in parallel.
+    const float kMinTreeletImprovement = 1e-3f;         ///< Minimum relative reduction of the SAOH cost for changing the topology of a treelet.
+
+    /** Insert two zero bits between each of the lower 21 bits of a value.
+    */
+    inline uint64_t expandBits21(uint64_t v)
+    {
+        v &= 0x1fffff;
+        v = (v | v << 32) & 0x1f00000000ffffull;
+        v = (v | v << 16) & 0x1f0000ff0000ffull;
+        v = (v | v << 8) & 0x100f00f00f00f00full;
+        v = (v | v << 4) & 0x10c30c30c30c30c3ull;
+        v = (v | v << 2) & 0x1249249249249249ull;
+        return v;
+    }
+
+    /** Compute the 63-bit Morton code of a point in the unit cube.
+    */
+    inline uint64_t computeMortonCode(const float3& p)
+    {
+        const float3 q = glm::clamp(p * 2097152.f, 0.f, 2097151.f);
+        return (expandBits21((uint64_t)q.x) << 2) | (expandBits21((uint64_t)q.y) << 1) | expandBits21((uint64_t)q.z);
+    }
+
+    /** Returns the smallest height of a binary tree over a number of triangles with at most maxLeafTriangleCount triangles per leaf.
+    */
+    inline uint32_t computeMinHeight(uint32_t triangleCount, uint32_t maxLeafTriangleCount)
+    {
+        const uint32_t leafCount = (triangleCount + maxLeafTriangleCount - 1) / maxLeafTriangleCount;
+        uint32_t height = 0;
+        while ((1ull << height) < leafCount) height++;
+        return height;
+    }
+
+    /** Returns true if the triangle should be included in the BVH.
+    */
+    inline bool isTriangleIncluded(const LightCollection::MeshLightTriangle& triangle, const LightBVHBuilder::Options& options)
+    {
+        return !options.usePreintegration || triangle.flux > 0.f;
+    }
+
+    /** Validate the options and the number of triangles to include in the BVH against the limits of the node format.
+    */
+    void validateBuildLimits(const LightBVHBuilder::Options& options, size_t triangleCount)
+    {
+        if (options.maxTriangleCountPerLeaf > kMaxLeafTriangleCount)
+        {
+            throw std::exception(("Max triangle count per leaf exceeds the maximum supported (" + std::to_string(kMaxLeafTriangleCount) + ")").c_str());
+        }
+        if (triangleCount > kMaxLeafTriangleOffset + kMaxLeafTriangleCount)
+        {
+            throw std::exception(("Emissive triangle count exceeds the maximum supported (" + std::to_string(kMaxLeafTriangleOffset + kMaxLeafTriangleCount) + ")").c_str());
+        }
+    }
+
+    /** Compute the key identifying a BVH in the scene cache.
+        The key covers all build options and the triangle data used by the build.
+    */
+    SHA1::MD computeCacheKey(const LightBVHBuilder::Options& options, const std::vector<LightCollection::MeshLightTriangle>& triangles)
+    {
+        SHA1 sha1;
+        auto update = [&sha1](const auto& value) { sha1.update(&value, sizeof(value)); };
+
+        // The options are hashed field by field to exclude padding.
+        update(kMaxBVHDepth);
+        update(options.splitHeuristicSelection);
+        update(options.maxTriangleCountPerLeaf);
+        update(options.binCount);
+        update(options.volumeEpsilon);
+        update(options.splitAlongLargest);
+        update(options.useVolumeOverSA);
+        update(options.useLeafCreationCost);
+        update(options.createLeavesASAP);
+        update(options.usePreintegration);
+        update(options.useLightingCones);
+        update(options.useTreeletRestructuring);
+
+        update((uint64_t)triangles.size());
+        for (const auto& tri : triangles)
+        {
+            for (const auto& vtx : tri.vtx) update(vtx.pos);
+            update(tri.normal);
+            update(tri.flux);
+        }
+
+        return sha1.final();
+    }
+
+    /** Returns the number of edges on the longest path from a node to a leaf.
+    */
+    uint32_t computeHeight(const std::vector<PackedNode>& nodes, uint32_t nodeIndex)
+    {
+        if (nodes[nodeIndex].isLeaf()) return 0;
+        const uint32_t rightIndex = nodes[nodeIndex].getInternalNode().rightChildIdx;
+        return 1 + std::max(computeHeight(nodes, nodeIndex + 1), computeHeight(nodes, rightIndex));
+    }
+
+    /** Sort ranges [x, y) and merge the ones that overlap or touch.
+    */
+    void mergeRanges(std::vector<uint2>& ranges)
+    {
+        std::sort(ranges.begin(), ranges.end(), [](const uint2& a, const uint2& b) { return a.x < b.x; });
+        size_t count = 0;
+        for (const uint2& range : ranges)
+        {
+            if (count > 0 && ranges[count - 1].y >= range.x) ranges[count - 1].y = std::max(ranges[count - 1].y, range.y);
+            else ranges[count++] = range;
+        }
+        ranges.resize(count);
+    }
+
     inline float safeACos(float v)
     {
         return std::acos(glm::clamp(v, -1.0f, 1.0f));
@@ -219,7 +344,8 @@ namespace
     {
         { (uint32_t)LightBVHBuilder::SplitHeuristic::Equal, "Equal" },
         { (uint32_t)LightBVHBuilder::SplitHeuristic::BinnedSAH, "Binned SAH" },
-        { (uint32_t)LightBVHBuilder::SplitHeuristic::BinnedSAOH, "Binned SAOH" }
+        { (uint32_t)LightBVHBuilder::SplitHeuristic::BinnedSAOH, "Binned SAOH" },
+        { (uint32_t)LightBVHBuilder::SplitHeuristic::Morton, "Morton (LBVH)" }
     };
 }
 
@@ -232,9 +358,10 @@ namespace Falcor
         return SharedPtr(new LightBVHBuilder(options));
     }
 
-    void LightBVHBuilder::build(LightBVH& bvh)
+    void LightBVHBuilder::build(LightBVH& bvh, const std::optional<SHA1::MD>& sceneCacheKey)
     {
         PROFILE("LightBVHBuilder::build()");
+        TRACE_ZONE("LightBVHBuilder::build");
 
         bvh.clear();
         assert(!bvh.isValid() && bvh.mNodes.empty());
@@ -244,6 +371,18 @@ namespace Falcor
         const auto& triangles = bvh.mpLightCollection->getMeshLightTriangles();
         if (triangles.empty()) return;
 
+        if (mOptions.useIncrementalUpdates)
+        {
+            buildIncremental(triangles, bvh.mpLightCollection->getMeshLights(), mIncrementalBVH);
+            uploadIncrementalBVH(bvh, true);
+            return;
+        }
+
+        // Load the BVH from the scene cache if it was built before with the same options and triangles.
+        // The incremental BVH is not cached, as it keeps additional state in the builder.
+        const SHA1::MD cacheKey = sceneCacheKey ? computeCacheKey(mOptions, triangles) : SHA1::MD();
+        if (sceneCacheKey && readFromCache(bvh, *sceneCacheKey, cacheKey)) return;
+
         // Create list of triangles that should be included in BVH.
         // For each triangle, precompute data we need for the build.
         BuildingData data(bvh.mNodes);
@@ -251,20 +390,9 @@ namespace Falcor
 
         for (size_t i = 0; i < triangles.size(); i++)
         {
-            if (!mOptions.usePreintegration || triangles[i].flux > 0.f)
+            if (isTriangleIncluded(triangles[i], mOptions))
             {
-                LightBVHBuilder::TriangleSortData tri;
-                for (uint32_t j = 0; j < 3; j++)
-                {
-                    tri.bounds |= triangles[i].vtx[j].pos;
-                }
-                tri.center = triangles[i].getCenter();
-                tri.coneDirection = triangles[i].normal;
-                tri.cosConeAngle = 1.f; // Single flat emitter => normal bounding cone angle is zero.
-                tri.flux = triangles[i].flux;
-                tri.triangleIndex = static_cast<uint32_t>(i);
-
-                data.trianglesData.push_back(tri);
+                data.trianglesData.push_back(createTriangleSortData(triangles[i], static_cast<uint32_t>(i)));
             }
         }
 
@@ -272,14 +400,7 @@ namespace Falcor
         if (data.trianglesData.empty()) return;
 
         // Validate options.
-        if (mOptions.maxTriangleCountPerLeaf > kMaxLeafTriangleCount)
-        {
-            throw std::exception(("Max triangle count per leaf exceeds the maximum supported (" + std::to_string(kMaxLeafTriangleCount) + ")").c_str());
-        }
-        if (data.trianglesData.size() > kMaxLeafTriangleOffset + kMaxLeafTriangleCount)
-        {
-            throw std::exception(("Emissive triangle count exceeds the maximum supported (" + std::to_string(kMaxLeafTriangleOffset + kMaxLeafTriangleCount) + ")").c_str());
-        }
+        validateBuildLimits(mOptions, data.trianglesData.size());
 
         // Allocate temporary memory for the BVH build.
         // To be grossly conservative, assume each triangle requires two nodes.
@@ -289,17 +410,15 @@ namespace Falcor
         data.nodes.reserve(2 * data.trianglesData.size());
         data.triangleIndices.reserve(data.trianglesData.size());
 
-        const uint64_t invalidBitmask = std::numeric_limits<uint64_t>::max();
-        data.triangleBitmasks.resize(triangles.size(), invalidBitmask); // This is sized based on input triangle count, as it's indexed by global triangle index.
+        data.triangleBitmasks.resize(triangles.size(), kInvalidBitmask); // This is sized based on input triangle count, as it's indexed by global triangle index.
 
         // Build the tree.
-        SplitHeuristicFunction splitFunc = getSplitFunction(mOptions.splitHeuristicSelection);
-        buildInternal(mOptions, splitFunc, 0ull, 0, Range(0, static_cast<uint32_t>(data.trianglesData.size())), data);
+        buildTree(mOptions, 0ull, 0, Range(0, static_cast<uint32_t>(data.trianglesData.size())), data);
         assert(!data.nodes.empty());
 
         size_t numValid = 0;
         for (auto mask : data.triangleBitmasks)
-            if (mask != invalidBitmask) numValid++;
+            if (mask != kInvalidBitmask) numValid++;
         assert(numValid == data.trianglesData.size());
 
         // Compute per-node light bounding cones.
@@ -313,6 +432,428 @@ namespace Falcor
 
         // Computate metadata.
         bvh.finalize();
+
+        if (sceneCacheKey)
+        {
+            SceneCache::LightBVHData cacheData;
+            cacheData.nodes = bvh.mNodes;
+            cacheData.triangleIndices = std::move(data.triangleIndices);
+            cacheData.triangleBitmasks = std::move(data.triangleBitmasks);
+            cacheData.maxTriangleCountPerLeaf = bvh.mMaxTriangleCountPerLeaf;
+            try
+            {
+                SceneCache::writeLightBVH(*sceneCacheKey, cacheKey, cacheData);
+            }
+            catch (const std::exception& e)
+            {
+                logWarning(std::string("Failed to write light BVH to scene cache: ") + e.what());
+            }
+        }
+    }
+
+    bool LightBVHBuilder::readFromCache(LightBVH& bvh, const SHA1::MD& sceneCacheKey, const SHA1::MD& cacheKey)
+    {
+        SceneCache::LightBVHData cacheData;
+        try
+        {
+            if (!SceneCache::readLightBVH(sceneCacheKey, cacheKey, cacheData)) return false;
+        }
+        catch (const std::exception& e)
+        {
+            logWarning(std::string("Failed to read light BVH from scene cache: ") + e.what());
+            return false;
+        }
+
+        const size_t triangleCount = bvh.mpLightCollection->getMeshLightTriangles().size();
+        if (cacheData.nodes.empty() || cacheData.triangleBitmasks.size() != triangleCount || cacheData.triangleIndices.size() > triangleCount) return false;
+
+        bvh.mNodes = std::move(cacheData.nodes);
+        bvh.mIsValid = true;
+        bvh.mMaxTriangleCountPerLeaf = cacheData.maxTriangleCountPerLeaf;
+        bvh.uploadCPUBuffers(cacheData.triangleIndices, cacheData.triangleBitmasks);
+        bvh.finalize();
+        return true;
+    }
+
+    void LightBVHBuilder::update(LightBVH& bvh)
+    {
+        PROFILE("LightBVHBuilder::update()");
+        TRACE_ZONE("LightBVHBuilder::update");
+
+        assert(mOptions.useIncrementalUpdates);
+        assert(bvh.mpLightCollection);
+        const auto& triangles = bvh.mpLightCollection->getMeshLightTriangles();
+        const auto& meshLights = bvh.mpLightCollection->getMeshLights();
+
+        if (updateIncremental(triangles, meshLights, bvh.mpLightCollection->getUpdatedLights(), mIncrementalBVH))
+        {
+            bvh.clear();
+            uploadIncrementalBVH(bvh, true);
+        }
+        else
+        {
+            uploadIncrementalBVH(bvh, false);
+        }
+    }
+
+    void LightBVHBuilder::buildIncremental(const std::vector<LightCollection::MeshLightTriangle>& triangles, const std::vector<MeshLightData>& meshLights, IncrementalBVH& bvh)
+    {
+        // The light classification is kept across builds, unless the lights have changed.
+        if (bvh.isDynamicLight.size() != meshLights.size()) bvh.isDynamicLight.assign(meshLights.size(), false);
+        bvh.lightSubtrees.assign(meshLights.size(), (uint32_t)MeshLightData::kInvalidIndex);
+        bvh.subtrees.clear();
+        bvh.nodes.clear();
+        bvh.hasStatic = bvh.hasDynamic = false;
+
+        // Create the subtrees of the dynamic lights and collect the triangles of the static lights.
+        BuildingData staticData(bvh.nodes);
+        uint32_t dynamicTriangleCount = 0;
+        for (uint32_t lightIdx = 0; lightIdx < (uint32_t)meshLights.size(); lightIdx++)
+        {
+            const MeshLightData& light = meshLights[lightIdx];
+            if (bvh.isDynamicLight[lightIdx])
+            {
+                bvh.lightSubtrees[lightIdx] = (uint32_t)bvh.subtrees.size();
+                auto& subtree = bvh.subtrees.emplace_back();
+                subtree.lightIndex = lightIdx;
+                updateSubtree(subtree, triangles, meshLights, false);
+                bvh.hasDynamic |= !subtree.nodes.empty();
+                dynamicTriangleCount += light.triangleCount;
+            }
+            else
+            {
+                for (uint32_t triangleIdx = light.triangleOffset; triangleIdx < light.triangleOffset + light.triangleCount; triangleIdx++)
+                {
+                    if (isTriangleIncluded(triangles[triangleIdx], mOptions))
+                    {
+                        staticData.trianglesData.push_back(createTriangleSortData(triangles[triangleIdx], triangleIdx));
+                    }
+                }
+            }
+        }
+        bvh.hasStatic = !staticData.trianglesData.empty();
+
+        // Reserve space for the dynamic part. A binary tree with one triangle per leaf needs at most two nodes per triangle.
+        bvh.dynamicTriangleCapacity = bvh.hasDynamic ? dynamicTriangleCount : 0;
+        bvh.dynamicNodeOffset = bvh.hasStatic && bvh.hasDynamic ? 1 : 0;
+        bvh.staticNodeOffset = bvh.hasDynamic ? bvh.dynamicNodeOffset + 2 * bvh.dynamicTriangleCapacity : 0;
+
+        if (bvh.hasStatic || bvh.hasDynamic)
+        {
+            validateBuildLimits(mOptions, bvh.dynamicTriangleCapacity + staticData.trianglesData.size());
+        }
+
+        staticData.triangleIndices.resize(bvh.dynamicTriangleCapacity);
+        staticData.triangleBitmasks.resize(triangles.size(), kInvalidBitmask);
+
+        if (bvh.hasStatic)
+        {
+            // Build the static subtree after the space reserved for the dynamic part.
+            // It is the right child of the root node if there are dynamic lights.
+            staticData.nodes.resize(bvh.staticNodeOffset);
+            const uint32_t depth = bvh.hasDynamic ? 1 : 0;
+            buildTree(mOptions, depth > 0 ? 1ull : 0ull, depth, Range(0, static_cast<uint32_t>(staticData.trianglesData.size())), staticData);
+
+            TriangleSortData& staticBounds = bvh.staticBounds;
+            staticBounds = TriangleSortData();
+            staticBounds.coneDirection = computeLightingConesInternal(bvh.staticNodeOffset, staticData, staticBounds.cosConeAngle);
+            for (const auto& td : staticData.trianglesData)
+            {
+                staticBounds.bounds |= td.bounds;
+                staticBounds.flux += td.flux;
+            }
+            staticBounds.center = staticBounds.bounds.center();
+        }
+
+        bvh.triangleIndices = std::move(staticData.triangleIndices);
+        bvh.triangleBitmasks = std::move(staticData.triangleBitmasks);
+
+        if (bvh.hasDynamic)
+        {
+            if (!bvh.hasStatic) bvh.nodes.resize(bvh.staticNodeOffset);
+            writeDynamicPart(bvh, meshLights);
+        }
+
+        // All data was written.
+        bvh.dirtyNodeRanges.clear();
+        bvh.dirtyTriangleIndexRanges.clear();
+        bvh.dirtyBitmaskRanges.clear();
+        if (!bvh.nodes.empty())
+        {
+            bvh.dirtyNodeRanges.push_back(uint2(0, (uint32_t)bvh.nodes.size()));
+            if (!bvh.triangleIndices.empty()) bvh.dirtyTriangleIndexRanges.push_back(uint2(0, (uint32_t)bvh.triangleIndices.size()));
+            bvh.dirtyBitmaskRanges.push_back(uint2(0, (uint32_t)triangles.size()));
+        }
+    }
+
+    bool LightBVHBuilder::updateIncremental(const std::vector<LightCollection::MeshLightTriangle>& triangles, const std::vector<MeshLightData>& meshLights, const std::vector<uint32_t>& updatedLights, IncrementalBVH& bvh)
+    {
+        bvh.dirtyNodeRanges.clear();
+        bvh.dirtyTriangleIndexRanges.clear();
+        bvh.dirtyBitmaskRanges.clear();
+
+        // A light that moves for the first time is moved out of the static subtree, which requires a rebuild.
+        bool rebuild = false;
+        if (bvh.isDynamicLight.size() != meshLights.size())
+        {
+            bvh.isDynamicLight.assign(meshLights.size(), false);
+            rebuild = true;
+        }
+        for (uint32_t lightIdx : updatedLights)
+        {
+            assert(lightIdx < meshLights.size());
+            if (!bvh.isDynamicLight[lightIdx])
+            {
+                bvh.isDynamicLight[lightIdx] = true;
+                rebuild = true;
+            }
+        }
+        if (!rebuild && updatedLights.empty()) return false;
+
+        if (!rebuild)
+        {
+            // Refit or rebuild the subtrees of the lights that have moved.
+            for (uint32_t lightIdx : updatedLights)
+            {
+                updateSubtree(bvh.subtrees[bvh.lightSubtrees[lightIdx]], triangles, meshLights, mOptions.allowRefitting);
+            }
+
+            // The layout depends on whether the dynamic subtrees contain any triangles.
+            bool hasDynamic = false;
+            for (const auto& subtree : bvh.subtrees) hasDynamic |= !subtree.nodes.empty();
+            rebuild = hasDynamic != bvh.hasDynamic;
+        }
+
+        if (rebuild)
+        {
+            buildIncremental(triangles, meshLights, bvh);
+            return true;
+        }
+
+        if (bvh.hasDynamic) writeDynamicPart(bvh, meshLights);
+        return false;
+    }
+
+    void LightBVHBuilder::updateSubtree(IncrementalBVH::Subtree& subtree, const std::vector<LightCollection::MeshLightTriangle>& triangles, const std::vector<MeshLightData>& meshLights, bool refit)
+    {
+        const MeshLightData& light = meshLights[subtree.lightIndex];
+        subtree.isDirty = true;
+        auto isIncluded = [&](uint32_t localIdx) { return isTriangleIncluded(triangles[light.triangleOffset + localIdx], mOptions); };
+
+        // The hierarchy can be kept if the same triangles are included as before.
+        if (refit && !subtree.nodes.empty())
+        {
+            uint32_t includedCount = 0;
+            for (uint32_t localIdx = 0; localIdx < light.triangleCount; localIdx++)
+            {
+                if (isIncluded(localIdx)) includedCount++;
+            }
+            refit = includedCount == subtree.trianglesData.size() &&
+                std::all_of(subtree.trianglesData.begin(), subtree.trianglesData.end(), [&](const TriangleSortData& td) { return isIncluded(td.triangleIndex); });
+        }
+        else
+        {
+            refit = false;
+        }
+
+        BuildingData data(subtree.nodes);
+        if (refit)
+        {
+            data.trianglesData = std::move(subtree.trianglesData);
+            for (auto& td : data.trianglesData)
+            {
+                td = createTriangleSortData(triangles[light.triangleOffset + td.triangleIndex], td.triangleIndex);
+            }
+        }
+        else
+        {
+            subtree.nodes.clear();
+            subtree.triangleBitmasks.assign(light.triangleCount, kInvalidBitmask);
+            for (uint32_t localIdx = 0; localIdx < light.triangleCount; localIdx++)
+            {
+                if (isIncluded(localIdx)) data.trianglesData.push_back(createTriangleSortData(triangles[light.triangleOffset + localIdx], localIdx));
+            }
+            subtree.height = 0;
+            subtree.bounds = TriangleSortData();
+            subtree.trianglesData.clear();
+            if (data.trianglesData.empty()) return;
+
+            // Build the hierarchy with subtree-local triangle indices. The attributes are computed by the refit below.
+            // The subtree is inlined below the top-level tree, which needs some of the maximum depth.
+            data.triangleBitmasks = std::move(subtree.triangleBitmasks);
+            data.depthReserve = kDynamicSubtreeDepthReserve;
+            buildTree(mOptions, 0ull, 0, Range(0, static_cast<uint32_t>(data.trianglesData.size())), data);
+            subtree.triangleBitmasks = std::move(data.triangleBitmasks);
+            subtree.height = computeHeight(subtree.nodes, 0);
+        }
+
+        subtree.bounds = refitInternal(0, data);
+        subtree.trianglesData = std::move(data.trianglesData);
+    }
+
+    void LightBVHBuilder::writeDynamicPart(IncrementalBVH& bvh, const std::vector<MeshLightData>& meshLights)
+    {
+        // Build the top-level tree over the non-empty subtrees, with one subtree per leaf.
+        std::vector<PackedNode> topNodes;
+        BuildingData top(topNodes);
+        for (uint32_t subtreeIdx = 0; subtreeIdx < (uint32_t)bvh.subtrees.size(); subtreeIdx++)
+        {
+            if (bvh.subtrees[subtreeIdx].nodes.empty()) continue;
+            TriangleSortData td = bvh.subtrees[subtreeIdx].bounds;
+            td.triangleIndex = subtreeIdx;
+            top.trianglesData.push_back(td);
+        }
+        assert(!top.trianglesData.empty());
+        top.triangleBitmasks.resize(bvh.subtrees.size(), kInvalidBitmask);
+        for (const auto& subtree : bvh.subtrees) top.depthReserve = std::max(top.depthReserve, subtree.height);
+
+        Options topOptions = mOptions;
+        topOptions.maxTriangleCountPerLeaf = 1;
+        topOptions.createLeavesASAP = true;
+        buildTree(topOptions, 0ull, bvh.dynamicNodeOffset, Range(0, static_cast<uint32_t>(top.trianglesData.size())), top);
+
+        // The triangles of dynamic lights whose subtrees became empty are culled.
+        for (auto& subtree : bvh.subtrees)
+        {
+            if (!subtree.nodes.empty() || !subtree.isDirty) continue;
+            const MeshLightData& light = meshLights[subtree.lightIndex];
+            std::fill_n(bvh.triangleBitmasks.begin() + light.triangleOffset, light.triangleCount, kInvalidBitmask);
+            if (light.triangleCount > 0) bvh.dirtyBitmaskRanges.push_back(uint2(light.triangleOffset, light.triangleOffset + light.triangleCount));
+            subtree.isDirty = false;
+            subtree.nodeOffset = subtree.triangleOffset = IncrementalBVH::Subtree::kInvalidOffset;
+        }
+
+        // Write the dynamic part. The left child of the root is at bit 0, so the bitmask prefix is zero.
+        uint32_t nodeIndex = bvh.dynamicNodeOffset;
+        uint32_t triangleOffset = 0;
+        TriangleSortData dynamicBounds = writeDynamicNode(bvh, meshLights, top, 0, 0ull, bvh.dynamicNodeOffset, nodeIndex, triangleOffset);
+        assert(nodeIndex <= bvh.dynamicNodeOffset + 2 * bvh.dynamicTriangleCapacity);
+        assert(triangleOffset <= bvh.dynamicTriangleCapacity);
+
+        // Join the dynamic and static parts.
+        if (bvh.hasStatic)
+        {
+            assert(bvh.dynamicNodeOffset == 1);
+            InternalNode root = {};
+            root.attribs = getNodeAttributes(mergeBounds(dynamicBounds, bvh.staticBounds));
+            root.rightChildIdx = bvh.staticNodeOffset;
+            PackedNode node = bvh.nodes[0];
+            node.setInternalNode(root);
+            if (std::memcmp(&node, &bvh.nodes[0], sizeof(PackedNode)) != 0)
+            {
+                bvh.nodes[0] = node;
+                bvh.dirtyNodeRanges.push_back(uint2(0, 1));
+            }
+        }
+
+        mergeRanges(bvh.dirtyNodeRanges);
+        mergeRanges(bvh.dirtyTriangleIndexRanges);
+        mergeRanges(bvh.dirtyBitmaskRanges);
+    }
+
+    LightBVHBuilder::TriangleSortData LightBVHBuilder::writeDynamicNode(IncrementalBVH& bvh, const std::vector<MeshLightData>& meshLights, const BuildingData& top, uint32_t topNodeIndex, uint64_t bitmask, uint32_t depth, uint32_t& nodeIndex, uint32_t& triangleOffset)
+    {
+        const PackedNode& topNode = top.nodes[topNodeIndex];
+        if (topNode.isLeaf())
+        {
+            const LeafNode topLeaf = topNode.getLeafNode();
+            assert(topLeaf.triangleCount == 1);
+            IncrementalBVH::Subtree& subtree = bvh.subtrees[top.triangleIndices[topLeaf.triangleOffset]];
+            if (depth + subtree.height > kMaxBVHDepth)
+            {
+                throw std::exception(("BVH depth of " + std::to_string(depth + subtree.height) + " reached; maximum of " + std::to_string(kMaxBVHDepth) + " allowed.").c_str());
+            }
+
+            // Copy the subtree in place of the leaf, relocating its child and triangle offsets.
+            // The nodes and triangle indices only depend on the location of the subtree, so they are kept if the subtree is unchanged.
+            const uint32_t nodeOffset = nodeIndex;
+            const uint32_t subtreeTriangleOffset = triangleOffset;
+            const uint32_t lightTriangleOffset = meshLights[subtree.lightIndex].triangleOffset;
+            nodeIndex += (uint32_t)subtree.nodes.size();
+            triangleOffset += (uint32_t)subtree.trianglesData.size();
+
+            if (subtree.isDirty || subtree.nodeOffset != nodeOffset || subtree.triangleOffset != subtreeTriangleOffset)
+            {
+                for (uint32_t i = 0; i < (uint32_t)subtree.nodes.size(); i++)
+                {
+                    PackedNode node = subtree.nodes[i];
+                    if (node.isLeaf()) node.data[0].x += subtreeTriangleOffset;
+                    else node.data[0].x += nodeOffset;
+                    bvh.nodes[nodeOffset + i] = node;
+                }
+                for (uint32_t i = 0; i < (uint32_t)subtree.trianglesData.size(); i++)
+                {
+                    bvh.triangleIndices[subtreeTriangleOffset + i] = lightTriangleOffset + subtree.trianglesData[i].triangleIndex;
+                }
+                bvh.dirtyNodeRanges.push_back(uint2(nodeOffset, nodeIndex));
+                if (triangleOffset > subtreeTriangleOffset) bvh.dirtyTriangleIndexRanges.push_back(uint2(subtreeTriangleOffset, triangleOffset));
+            }
+
+            // The bitmasks also depend on the path to the subtree root.
+            if (subtree.isDirty || subtree.bitmask != bitmask || subtree.depth != depth)
+            {
+                const uint32_t lightTriangleCount = meshLights[subtree.lightIndex].triangleCount;
+                std::fill_n(bvh.triangleBitmasks.begin() + lightTriangleOffset, lightTriangleCount, kInvalidBitmask);
+                for (const TriangleSortData& td : subtree.trianglesData)
+                {
+                    bvh.triangleBitmasks[lightTriangleOffset + td.triangleIndex] = bitmask | (subtree.triangleBitmasks[td.triangleIndex] << depth);
+                }
+                bvh.dirtyBitmaskRanges.push_back(uint2(lightTriangleOffset, lightTriangleOffset + lightTriangleCount));
+            }
+
+            subtree.isDirty = false;
+            subtree.nodeOffset = nodeOffset;
+            subtree.triangleOffset = subtreeTriangleOffset;
+            subtree.bitmask = bitmask;
+            subtree.depth = depth;
+            return subtree.bounds;
+        }
+        else
+        {
+            const uint32_t currentIndex = nodeIndex++;
+            TriangleSortData leftBounds = writeDynamicNode(bvh, meshLights, top, topNodeIndex + 1, bitmask | (0ull << depth), depth + 1, nodeIndex, triangleOffset);
+            const uint32_t rightIndex = nodeIndex;
+            TriangleSortData rightBounds = writeDynamicNode(bvh, meshLights, top, topNode.getInternalNode().rightChildIdx, bitmask | (1ull << depth), depth + 1, nodeIndex, triangleOffset);
+
+            // Only write the node if it has changed, which is the case for the nodes above updated subtrees.
+            TriangleSortData bounds = mergeBounds(leftBounds, rightBounds);
+            InternalNode internalNode = {};
+            internalNode.attribs = getNodeAttributes(bounds);
+            internalNode.rightChildIdx = rightIndex;
+            PackedNode node = bvh.nodes[currentIndex];
+            node.setInternalNode(internalNode);
+            if (std::memcmp(&node, &bvh.nodes[currentIndex], sizeof(PackedNode)) != 0)
+            {
+                bvh.nodes[currentIndex] = node;
+                bvh.dirtyNodeRanges.push_back(uint2(currentIndex, currentIndex + 1));
+            }
+            return bounds;
+        }
+    }
+
+    void LightBVHBuilder::uploadIncrementalBVH(LightBVH& bvh, bool rebuilt)
+    {
+        const IncrementalBVH& data = mIncrementalBVH;
+        if (rebuilt)
+        {
+            assert(!bvh.isValid());
+            if (data.nodes.empty()) return;
+
+            bvh.mNodes = data.nodes;
+            bvh.mIsValid = true;
+            bvh.mMaxTriangleCountPerLeaf = mOptions.maxTriangleCountPerLeaf;
+            bvh.uploadCPUBuffers(data.triangleIndices, data.triangleBitmasks);
+            bvh.finalize();
+        }
+        else if (!data.dirtyNodeRanges.empty() || !data.dirtyTriangleIndexRanges.empty() || !data.dirtyBitmaskRanges.empty())
+        {
+            assert(bvh.isValid() && bvh.mNodes.size() == data.nodes.size());
+            for (const uint2& range : data.dirtyNodeRanges)
+            {
+                std::copy(data.nodes.begin() + range.x, data.nodes.begin() + range.y, bvh.mNodes.begin() + range.x);
+            }
+            bvh.uploadCPUBufferRanges(data.dirtyNodeRanges, data.triangleIndices, data.dirtyTriangleIndexRanges, data.triangleBitmasks, data.dirtyBitmaskRanges);
+        }
     }
 
     bool LightBVHBuilder::renderUI(Gui::Widgets& widget)
@@ -326,6 +867,8 @@ namespace Falcor
         bool optionsChanged = false;
 
         optionsChanged |= widget.checkbox("Allow refitting", options.allowRefitting);
+        optionsChanged |= widget.checkbox("Incremental updates", options.useIncrementalUpdates);
+        widget.tooltip("Keep the static lights in a separate subtree and only update the moving lights on the CPU.", true);
         optionsChanged |= widget.var("Max triangle count per leaf", options.maxTriangleCountPerLeaf, 1u, kMaxLeafTriangleCount);
         optionsChanged |= widget.dropdown("Split heuristic", kSplitHeuristicList, (uint32_t&)options.splitHeuristicSelection);
 
@@ -351,6 +894,12 @@ namespace Falcor
                 optionsChanged |= splitGroup.checkbox("Use pre-integration", options.usePreintegration);
                 optionsChanged |= splitGroup.checkbox("Use lighting cones", options.useLightingCones);
             }
+
+            if (options.splitHeuristicSelection == SplitHeuristic::Morton)
+            {
+                optionsChanged |= splitGroup.checkbox("Use treelet restructuring", options.useTreeletRestructuring);
+                splitGroup.tooltip("Optimize the topology of small treelets for the SAOH cost after the build. The SAOH options above are used for the cost.", true);
+            }
         }
 
         return optionsChanged;
@@ -360,6 +909,17 @@ namespace Falcor
     {
     }
 
+    uint32_t LightBVHBuilder::buildTree(const Options& options, uint64_t bitmask, uint32_t depth, const Range& triangleRange, BuildingData& data)
+    {
+        if (options.splitHeuristicSelection == SplitHeuristic::Morton)
+        {
+            return buildMorton(options, bitmask, depth, triangleRange, data);
+        }
+
+        SplitHeuristicFunction splitFunc = getSplitFunction(options.splitHeuristicSelection);
+        return buildInternal(options, splitFunc, bitmask, depth, triangleRange, data);
+    }
+
     uint32_t LightBVHBuilder::buildInternal(const Options& options, const SplitHeuristicFunction& splitHeuristic, uint64_t bitmask, uint32_t depth, const Range& triangleRange, BuildingData& data)
     {
         assert(triangleRange.begin < triangleRange.end);
@@ -483,6 +1043,33 @@ namespace Falcor
         }
     }
 
+    LightBVHBuilder::TriangleSortData LightBVHBuilder::refitInternal(const uint32_t nodeIndex, BuildingData& data)
+    {
+        TriangleSortData bounds;
+        if (data.nodes[nodeIndex].isLeaf())
+        {
+            LeafNode node = data.nodes[nodeIndex].getLeafNode();
+            const Range triangleRange(node.triangleOffset, node.triangleOffset + node.triangleCount);
+            for (uint32_t triangleIdx = triangleRange.begin; triangleIdx < triangleRange.end; ++triangleIdx)
+            {
+                bounds.bounds |= data.trianglesData[triangleIdx].bounds;
+                bounds.flux += data.trianglesData[triangleIdx].flux;
+            }
+            bounds.coneDirection = computeLightingCone(triangleRange, data, bounds.cosConeAngle);
+            node.attribs = getNodeAttributes(bounds);
+            data.nodes[nodeIndex].setLeafNode(node);
+        }
+        else
+        {
+            InternalNode node = data.nodes[nodeIndex].getInternalNode();
+            bounds = mergeBounds(refitInternal(nodeIndex + 1, data), refitInternal(node.rightChildIdx, data));
+            node.attribs = getNodeAttributes(bounds);
+            data.nodes[nodeIndex].setInternalNode(node);
+        }
+        bounds.center = bounds.bounds.center();
+        return bounds;
+    }
+
     float3 LightBVHBuilder::computeLightingCone(const Range& triangleRange, const BuildingData& data, float& cosTheta)
     {
         float3 coneDirection = float3(0.0f);
@@ -876,6 +1463,353 @@ namespace Falcor
         return overallBestSplit.second;
     }
 
+    LightBVHBuilder::TriangleSortData LightBVHBuilder::createTriangleSortData(const LightCollection::MeshLightTriangle& triangle, uint32_t triangleIndex)
+    {
+        TriangleSortData tri;
+        for (uint32_t j = 0; j < 3; j++)
+        {
+            tri.bounds |= triangle.vtx[j].pos;
+        }
+        tri.center = triangle.getCenter();
+        tri.coneDirection = triangle.normal;
+        tri.cosConeAngle = 1.f; // Single flat emitter => normal bounding cone angle is zero.
+        tri.flux = triangle.flux;
+        tri.triangleIndex = triangleIndex;
+        return tri;
+    }
+
+    LightBVHBuilder::TriangleSortData LightBVHBuilder::mergeBounds(const TriangleSortData& a, const TriangleSortData& b)
+    {
+        TriangleSortData result;
+        result.bounds = a.bounds | b.bounds;
+        result.center = result.bounds.center();
+        result.flux = a.flux + b.flux;
+        result.coneDirection = coneUnionOld(a.coneDirection, a.cosConeAngle, b.coneDirection, b.cosConeAngle, result.cosConeAngle);
+        return result;
+    }
+
+    SharedNodeAttributes LightBVHBuilder::getNodeAttributes(const TriangleSortData& bounds)
+    {
+        SharedNodeAttributes attribs = {};
+        attribs.setAABB(bounds.bounds.minPoint, bounds.bounds.maxPoint);
+        attribs.flux = bounds.flux;
+        attribs.coneDirection = bounds.coneDirection;
+        attribs.cosConeAngle = bounds.cosConeAngle;
+        return attribs;
+    }
+
+    uint32_t LightBVHBuilder::buildMorton(const Options& options, uint64_t bitmask, uint32_t depth, const Range& triangleRange, BuildingData& data)
+    {
+        assert(triangleRange.begin < triangleRange.end);
+        const uint32_t triangleCount = triangleRange.length();
+
+        // Check the depth limit before the build. The splits are chosen so that the tree is no higher than needed to stay within it.
+        const uint32_t maxLeafTriangleCount = options.createLeavesASAP ? options.maxTriangleCountPerLeaf : 1;
+        const uint32_t minHeight = computeMinHeight(triangleCount, maxLeafTriangleCount);
+        if (depth + data.depthReserve + minHeight > kMaxBVHDepth)
+        {
+            throw std::exception(("BVH depth of " + std::to_string(depth + data.depthReserve + minHeight) + " reached; maximum of " + std::to_string(kMaxBVHDepth) + " allowed.").c_str());
+        }
+        const uint32_t maxHeight = kMaxBVHDepth - depth - data.depthReserve;
+        TRACE_ZONE("LightBVHBuilder::buildMorton");
+
+        // Compute the Morton codes of the triangle centers, quantized to 21 bits per axis within the bounds of the centers.
+        AABB centerBounds;
+        for (uint32_t dataIndex = triangleRange.begin; dataIndex < triangleRange.end; ++dataIndex)
+        {
+            centerBounds |= data.trianglesData[dataIndex].bounds.center();
+        }
+        const float3 extent = glm::max(centerBounds.extent(), float3(FLT_MIN));
+
+        std::vector<uint64_t> mortonCodes(triangleCount);
+        std::vector<uint32_t> order(triangleCount);
+        auto range = NumericRange<uint32_t>(0, triangleCount);
+        std::for_each(std::execution::par, range.begin(), range.end(), [&](uint32_t i)
+        {
+            mortonCodes[i] = computeMortonCode((data.trianglesData[triangleRange.begin + i].bounds.center() - centerBounds.minPoint) / extent);
+            order[i] = i;
+        });
+        HostParallel::radixSort(mortonCodes.data(), order.data(), triangleCount);
+
+        // Sort the triangles by Morton code. The leaf attributes below are computed from the sorted range.
+        std::vector<TriangleSortData> sortedTriangles(triangleCount);
+        std::for_each(std::execution::par, range.begin(), range.end(), [&](uint32_t i)
+        {
+            sortedTriangles[i] = data.trianglesData[triangleRange.begin + order[i]];
+        });
+        std::copy(sortedTriangles.begin(), sortedTriangles.end(), data.trianglesData.begin() + triangleRange.begin);
+
+        // Create the hierarchy by splitting the sorted codes.
+        std::vector<MortonNode> nodes;
+        std::vector<std::vector<uint32_t>> levels;
+        nodes.reserve(2 * triangleCount);
+        createMortonNode(mortonCodes, Range(0, triangleCount), maxLeafTriangleCount, maxHeight, 0, nodes, levels);
+
+        // Compute the node attributes bottom-up, with the nodes of each level in parallel.
+        for (auto level = levels.rbegin(); level != levels.rend(); ++level)
+        {
+            TRACE_ZONE("LightBVHBuilder::buildMorton (level)");
+            std::for_each(std::execution::par, level->begin(), level->end(), [&](uint32_t nodeIndex)
+            {
+                MortonNode& node = nodes[nodeIndex];
+                if (node.isLeaf())
+                {
+                    const Range leafRange(triangleRange.begin + node.triangleBegin, triangleRange.begin + node.triangleEnd);
+                    TriangleSortData bounds;
+                    for (uint32_t dataIndex = leafRange.begin; dataIndex < leafRange.end; ++dataIndex)
+                    {
+                        bounds.bounds |= data.trianglesData[dataIndex].bounds;
+                        bounds.flux += data.trianglesData[dataIndex].flux;
+                    }
+                    bounds.center = bounds.bounds.center();
+                    bounds.coneDirection = computeLightingCone(leafRange, data, bounds.cosConeAngle);
+                    node.bounds = bounds;
+                }
+                else
+                {
+                    node.bounds = mergeBounds(nodes[node.children[0]].bounds, nodes[node.children[1]].bounds);
+                    node.height = 1 + std::max(nodes[node.children[0]].height, nodes[node.children[1]].height);
+                }
+            });
+        }
+
+        if (options.useTreeletRestructuring)
+        {
+            // Treelets in disjoint subtrees are independent, so the subtrees below kTreeletParallelLevel are restructured in parallel.
+            if (levels.size() > kTreeletParallelLevel)
+            {
+                const auto& subtreeRoots = levels[kTreeletParallelLevel];
+                std::for_each(std::execution::par, subtreeRoots.begin(), subtreeRoots.end(), [&](uint32_t nodeIndex)
+                {
+                    TRACE_ZONE("LightBVHBuilder::restructureTreelets (subtree)");
+                    restructureTreelets(nodes, nodeIndex, std::numeric_limits<uint32_t>::max(), maxHeight - kTreeletParallelLevel, options);
+                });
+            }
+            restructureTreelets(nodes, 0, kTreeletParallelLevel, maxHeight, options);
+        }
+
+        // Write the nodes in the same layout as buildInternal(). The triangles are reordered by leaf node.
+        uint32_t triangleOffset = triangleRange.begin;
+        const uint32_t nodeIndex = writeMortonNode(nodes, 0, sortedTriangles, bitmask, depth, triangleOffset, data);
+        assert(triangleOffset == triangleRange.end);
+        return nodeIndex;
+    }
+
+    uint32_t LightBVHBuilder::createMortonNode(const std::vector<uint64_t>& mortonCodes, const Range& codeRange, uint32_t maxLeafTriangleCount, uint32_t maxHeight, uint32_t level, std::vector<MortonNode>& nodes, std::vector<std::vector<uint32_t>>& levels)
+    {
+        assert(codeRange.begin < codeRange.end);
+        assert(computeMinHeight(codeRange.length(), maxLeafTriangleCount) <= maxHeight);
+
+        const uint32_t nodeIndex = (uint32_t)nodes.size();
+        nodes.push_back({});
+        if (levels.size() <= level) levels.resize(level + 1);
+        levels[level].push_back(nodeIndex);
+
+        if (codeRange.length() <= maxLeafTriangleCount)
+        {
+            nodes[nodeIndex].triangleBegin = codeRange.begin;
+            nodes[nodeIndex].triangleEnd = codeRange.end;
+            return nodeIndex;
+        }
+
+        // Split at the highest bit that differs within the range. As the codes are sorted, the codes with the bit cleared come first.
+        // If all codes are equal, or if the larger part would not fit in the remaining height, the range is split in the middle.
+        // Clustered triangles otherwise use up to 63 levels for the code bits plus the levels for equal codes.
+        uint32_t split = codeRange.middle();
+        const uint64_t diff = mortonCodes[codeRange.begin] ^ mortonCodes[codeRange.end - 1];
+        if (diff != 0)
+        {
+            const uint32_t highBits = (uint32_t)(diff >> 32);
+            const uint32_t bit = highBits != 0 ? 32 + bitScanReverse(highBits) : bitScanReverse((uint32_t)diff);
+            auto it = std::partition_point(mortonCodes.begin() + codeRange.begin, mortonCodes.begin() + codeRange.end, [bit](uint64_t code) { return ((code >> bit) & 1) == 0; });
+            const uint32_t mortonSplit = (uint32_t)(it - mortonCodes.begin());
+            const uint32_t maxChildLength = std::max(mortonSplit - codeRange.begin, codeRange.end - mortonSplit);
+            if (1 + computeMinHeight(maxChildLength, maxLeafTriangleCount) <= maxHeight) split = mortonSplit;
+        }
+        assert(codeRange.begin < split && split < codeRange.end);
+
+        const uint32_t leftIndex = createMortonNode(mortonCodes, Range(codeRange.begin, split), maxLeafTriangleCount, maxHeight - 1, level + 1, nodes, levels);
+        const uint32_t rightIndex = createMortonNode(mortonCodes, Range(split, codeRange.end), maxLeafTriangleCount, maxHeight - 1, level + 1, nodes, levels);
+        nodes[nodeIndex].children[0] = leftIndex;
+        nodes[nodeIndex].children[1] = rightIndex;
+        return nodeIndex;
+    }
+
+    void LightBVHBuilder::restructureTreelets(std::vector<MortonNode>& nodes, uint32_t nodeIndex, uint32_t maxLevel, uint32_t maxHeight, const Options& options)
+    {
+        if (maxLevel == 0 || nodes[nodeIndex].isLeaf()) return;
+
+        MortonNode& node = nodes[nodeIndex];
+        for (uint32_t childIndex : node.children)
+        {
+            restructureTreelets(nodes, childIndex, maxLevel - 1, maxHeight - 1, options);
+        }
+        node.height = 1 + std::max(nodes[node.children[0]].height, nodes[node.children[1]].height);
+        restructureTreelet(nodes, nodeIndex, maxHeight, options);
+    }
+
+    bool LightBVHBuilder::restructureTreelet(std::vector<MortonNode>& nodes, uint32_t nodeIndex, uint32_t maxHeight, const Options& options)
+    {
+        // Form the treelet by expanding the internal node with the largest surface area.
+        std::array<uint32_t, kMaxTreeletLeafCount> leaves = { nodes[nodeIndex].children[0], nodes[nodeIndex].children[1] };
+        std::array<uint32_t, kMaxTreeletLeafCount - 2> internalNodes;
+        uint32_t leafCount = 2;
+        uint32_t internalCount = 0;
+        while (leafCount < kMaxTreeletLeafCount)
+        {
+            uint32_t expandIdx = kMaxTreeletLeafCount;
+            float maxArea = -std::numeric_limits<float>::infinity();
+            for (uint32_t i = 0; i < leafCount; i++)
+            {
+                const MortonNode& node = nodes[leaves[i]];
+                if (!node.isLeaf() && node.bounds.bounds.area() > maxArea)
+                {
+                    expandIdx = i;
+                    maxArea = node.bounds.bounds.area();
+                }
+            }
+            if (expandIdx == kMaxTreeletLeafCount) break;
+
+            const uint32_t expandedIndex = leaves[expandIdx];
+            internalNodes[internalCount++] = expandedIndex;
+            leaves[expandIdx] = nodes[expandedIndex].children[0];
+            leaves[leafCount++] = nodes[expandedIndex].children[1];
+        }
+        if (internalCount == 0) return false;
+
+        // Find the topology with the lowest SAOH cost by dynamic programming over the subsets of the treelet leaves.
+        // The cost of a subset is the cost of its root node plus the lowest cost of a partition into two subsets.
+        // The costs of the treelet leaves do not depend on the topology and are left out.
+        const uint32_t subsetCount = 1u << leafCount;
+        std::array<TriangleSortData, 1u << kMaxTreeletLeafCount> subsetBounds;
+        std::array<float, 1u << kMaxTreeletLeafCount> subsetCost;
+        std::array<uint8_t, 1u << kMaxTreeletLeafCount> subsetPartition;
+        for (uint32_t subset = 1; subset < subsetCount; subset++)
+        {
+            const uint32_t lowestBit = subset & (~subset + 1);
+            if (subset == lowestBit)
+            {
+                subsetBounds[subset] = nodes[leaves[bitScanReverse(subset)]].bounds;
+                subsetCost[subset] = 0.f;
+                continue;
+            }
+
+            // Only the partitions where the first subset contains the lowest bit are evaluated, as the order of the children does not matter.
+            float bestCost = std::numeric_limits<float>::infinity();
+            uint32_t bestPartition = lowestBit;
+            for (uint32_t partition = (subset - 1) & subset; partition != 0; partition = (partition - 1) & subset)
+            {
+                if ((partition & lowestBit) == 0) continue;
+                const float cost = subsetCost[partition] + subsetCost[subset ^ partition];
+                if (cost < bestCost)
+                {
+                    bestCost = cost;
+                    bestPartition = partition;
+                }
+            }
+
+            const TriangleSortData& bounds = subsetBounds[subset] = mergeBounds(subsetBounds[subset ^ lowestBit], subsetBounds[lowestBit]);
+            subsetCost[subset] = bestCost + evalSAOH(bounds.bounds, bounds.flux, bounds.cosConeAngle, options);
+            subsetPartition[subset] = (uint8_t)bestPartition;
+        }
+
+        // Compare the cost of the internal nodes below the treelet root, as the root is the same for all topologies.
+        float currentCost = 0.f;
+        for (uint32_t i = 0; i < internalCount; i++)
+        {
+            const TriangleSortData& bounds = nodes[internalNodes[i]].bounds;
+            currentCost += evalSAOH(bounds.bounds, bounds.flux, bounds.cosConeAngle, options);
+        }
+        const TriangleSortData& rootBounds = subsetBounds[subsetCount - 1];
+        const float optimalCost = subsetCost[subsetCount - 1] - evalSAOH(rootBounds.bounds, rootBounds.flux, rootBounds.cosConeAngle, options);
+        if (!(optimalCost < currentCost * (1.f - kMinTreeletImprovement))) return false;
+
+        // Keep the current topology if the new one would exceed the height limit.
+        auto computeSubsetHeight = [&](auto& self, uint32_t subset) -> uint32_t
+        {
+            if ((subset & (subset - 1)) == 0) return nodes[leaves[bitScanReverse(subset)]].height;
+            const uint32_t partition = subsetPartition[subset];
+            return 1 + std::max(self(self, partition), self(self, subset ^ partition));
+        };
+        if (computeSubsetHeight(computeSubsetHeight, subsetCount - 1) > maxHeight) return false;
+
+        // Create the new topology, reusing the internal nodes of the treelet. The attributes are recomputed from the children.
+        uint32_t nextInternal = 0;
+        auto createNode = [&](auto& self, uint32_t subset, uint32_t index) -> void
+        {
+            const uint32_t partition = subsetPartition[subset];
+            const uint32_t childSubsets[2] = { partition, subset ^ partition };
+            for (uint32_t i = 0; i < 2; i++)
+            {
+                uint32_t childIndex;
+                if ((childSubsets[i] & (childSubsets[i] - 1)) == 0)
+                {
+                    childIndex = leaves[bitScanReverse(childSubsets[i])];
+                }
+                else
+                {
+                    childIndex = internalNodes[nextInternal++];
+                    self(self, childSubsets[i], childIndex);
+                }
+                nodes[index].children[i] = childIndex;
+            }
+            nodes[index].bounds = mergeBounds(nodes[nodes[index].children[0]].bounds, nodes[nodes[index].children[1]].bounds);
+            nodes[index].height = 1 + std::max(nodes[nodes[index].children[0]].height, nodes[nodes[index].children[1]].height);
+        };
+        createNode(createNode, subsetCount - 1, nodeIndex);
+        assert(nextInternal == internalCount);
+        return true;
+    }
+
+    uint32_t LightBVHBuilder::writeMortonNode(const std::vector<MortonNode>& mortonNodes, uint32_t mortonNodeIndex, const std::vector<TriangleSortData>& sortedTriangles, uint64_t bitmask, uint32_t depth, uint32_t& triangleOffset, BuildingData& data)
+    {
+        const MortonNode& mortonNode = mortonNodes[mortonNodeIndex];
+
+        assert(data.nodes.size() < std::numeric_limits<uint32_t>::max());
+        const uint32_t nodeIndex = (uint32_t)data.nodes.size();
+        data.nodes.push_back({});
+
+        if (!mortonNode.isLeaf())
+        {
+            if (depth >= kMaxBVHDepth)
+            {
+                // See buildInternal().
+                throw std::exception(("BVH depth of " + std::to_string(depth + 1) + " reached; maximum of " + std::to_string(kMaxBVHDepth) + " allowed.").c_str());
+            }
+
+            InternalNode node = {};
+            node.attribs = getNodeAttributes(mortonNode.bounds);
+
+            uint32_t leftIndex = writeMortonNode(mortonNodes, mortonNode.children[0], sortedTriangles, bitmask | (0ull << depth), depth + 1, triangleOffset, data);
+            uint32_t rightIndex = writeMortonNode(mortonNodes, mortonNode.children[1], sortedTriangles, bitmask | (1ull << depth), depth + 1, triangleOffset, data);
+
+            assert(leftIndex == nodeIndex + 1);
+            node.rightChildIdx = rightIndex;
+
+            data.nodes[nodeIndex].setInternalNode(node);
+        }
+        else
+        {
+            LeafNode node = {};
+            node.attribs = getNodeAttributes(mortonNode.bounds);
+            node.triangleCount = mortonNode.triangleEnd - mortonNode.triangleBegin;
+            node.triangleOffset = (uint32_t)data.triangleIndices.size();
+            assert(node.triangleCount < kMaxLeafTriangleCount);
+            assert(node.triangleOffset < kMaxLeafTriangleOffset);
+
+            for (uint32_t i = mortonNode.triangleBegin; i < mortonNode.triangleEnd; ++i)
+            {
+                const TriangleSortData& triangle = sortedTriangles[i];
+                data.trianglesData[triangleOffset++] = triangle;
+                data.triangleIndices.push_back(triangle.triangleIndex);
+                data.triangleBitmasks[triangle.triangleIndex] = bitmask;
+            }
+
+            data.nodes[nodeIndex].setLeafNode(node);
+        }
+        return nodeIndex;
+    }
+
     LightBVHBuilder::SplitHeuristicFunction LightBVHBuilder::getSplitFunction(SplitHeuristic heuristic)
     {
         switch (heuristic)
@@ -898,6 +1832,7 @@ namespace Falcor
         splitHeuristic.value("Equal", LightBVHBuilder::SplitHeuristic::Equal);
         splitHeuristic.value("BinnedSAH", LightBVHBuilder::SplitHeuristic::BinnedSAH);
         splitHeuristic.value("BinnedSAOH", LightBVHBuilder::SplitHeuristic::BinnedSAOH);
+        splitHeuristic.value("Morton", LightBVHBuilder::SplitHeuristic::Morton);
 
         // TODO use a nested class in the bindings when supported.
         ScriptBindings::SerializableStruct<LightBVHBuilder::Options> options(m, "LightBVHBuilderOptions");
@@ -911,8 +1846,10 @@ namespace Falcor
         options.field(useLeafCreationCost);
         options.field(createLeavesASAP);
         options.field(allowRefitting);
+        options.field(useIncrementalUpdates);
         options.field(usePreintegration);
         options.field(useLightingCones);
+        options.field(useTreeletRestructuring);
 #undef field
     }
 }
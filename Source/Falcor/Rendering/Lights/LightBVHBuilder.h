@@ -27,10 +27,12 @@
  **************************************************************************/
 #pragma once
 #include "LightBVH.h"
+#include "Utils/CryptoUtils.h"
 #include "Utils/Math/AABB.h"
 #include "Utils/Math/Vector.h"
 #include "Utils/UI/Gui.h"
 #include <limits>
+#include <optional>
 #include <vector>
 
 namespace Falcor
@@ -40,6 +42,10 @@ namespace Falcor
         The building process can be customized via the |Options|,
         which are also available in the GUI via the |renderUI()| function.
 
+        With the |useIncrementalUpdates| option, the builder creates a two-level BVH that
+        separates the static lights from the moving ones, see IncrementalBVH. When lights
+        move, update() only updates the parts of the BVH that contain moving lights.
+
         TODO: Rename all things triangle* to light* as the BVH class can be used for other types.
     */
     class dlldecl LightBVHBuilder
@@ -53,6 +59,7 @@ namespace Falcor
             Equal = 0u,         ///< Split the input into two equal partitions.
             BinnedSAH = 1u,     ///< Split the input according to SAH; the input is binned for speeding up the SAH computation.
             BinnedSAOH = 2u,    ///< Split the input according to SAOH (Estévez Conty et al, 2018); the input is binned for speeding up the SAOH computation.
+            Morton = 3u,        ///< Split the input at the highest differing bit of the Morton codes of the triangle centers (LBVH, Lauterbach et al, 2009). Much faster but lower quality than the binned heuristics.
         };
 
         /** Light BVH builder configuration options.
@@ -69,8 +76,10 @@ namespace Falcor
             bool           useLeafCreationCost = true;                           ///< Set to true to avoid splitting when the cost is higher than the cost of creating a leaf node. Only used when 'createLeavesASAP' is disabled.
             bool           createLeavesASAP = true;                              ///< Rather than creating a leaf only once splitting stops, create it as soon as we can.
             bool           allowRefitting = true;                                ///< Rather than always rebuilding the BVH from scratch, keep the hierarchy but update the bounds and lighting cones.
+            bool           useIncrementalUpdates = false;                        ///< Build a two-level BVH and only update the subtrees of the moving lights on the CPU, rather than refitting or rebuilding the whole BVH. With refitting allowed, the subtrees are refit, otherwise they are rebuilt.
             bool           usePreintegration = true;                             ///< Use pre-integration for culling out emissive triangles and use their flux when computing the splits. Only valid when using the BinnedSAOH split heuristic.
             bool           useLightingCones = true;                              ///< Use lighting cones when computing the splits. Only valid when using the BinnedSAOH split heuristic.
+            bool           useTreeletRestructuring = true;                       ///< Optimize the topology of small treelets for the SAOH cost after the build (Karras and Aila, 2013). Only valid when using the Morton split heuristic.
         };
 
         /** Creates a new object.
@@ -79,9 +88,20 @@ namespace Falcor
         static SharedPtr create(const Options& options);
 
         /** Build the BVH.
+            If a scene cache key is given, the BVH is loaded from the scene cache if one was previously built with the same
+            options and emissive triangles, otherwise it is built and written to the cache. This is not done with |useIncrementalUpdates|.
             \param[in,out] bvh The light BVH to build.
+            \param[in] sceneCacheKey Key of the scene cache to use, see Scene::getSceneCacheKey().
+        */
+        void build(LightBVH& bvh, const std::optional<SHA1::MD>& sceneCacheKey = {});
+
+        /** Update the BVH after the mesh lights given by LightCollection::getUpdatedLights() have moved.
+            The BVH must have been built with the |useIncrementalUpdates| option enabled.
+            Only the moving lights and the tree joining them are updated and uploaded. If a light moves
+            for the first time, it is moved out of the static subtree, which requires a full rebuild.
+            \param[in,out] bvh The light BVH to update.
         */
-        void build(LightBVH& bvh);
+        void update(LightBVH& bvh);
 
         virtual bool renderUI(Gui::Widgets& widget);
 
@@ -127,10 +147,106 @@ namespace Falcor
             std::vector<uint32_t> triangleIndices;          ///< Triangle indices sorted by leaf node. Each leaf node refers to a contiguous array of triangle indices.
             std::vector<uint64_t> triangleBitmasks;         ///< Array containing the per triangle bit pattern retracing the tree traversal to reach the triangle: 0=left child, 1=right child; this array gets filled in during the build process. Indexed by global triangle index.
             float currentNodeFlux = 0.f;                    ///< Used by computeSAOHSplit() as the leaf creation cost.
+            uint32_t depthReserve = 0;                      ///< Number of levels of the maximum BVH depth kept free by the Morton build, for a tree that is inlined into or below this one.
 
             BuildingData(std::vector<PackedNode>& bvhNodes) : nodes(bvhNodes) {}
         };
 
+        /** Node of the intermediate binary tree created by the Morton build.
+        */
+        struct MortonNode
+        {
+            TriangleSortData bounds;                        ///< Bounds, flux and lighting cone of the node.
+            uint32_t children[2] = { 0, 0 };                ///< Indices of the child nodes. Only valid for internal nodes.
+            uint32_t triangleBegin = 0;                     ///< First triangle of a leaf node, in Morton order.
+            uint32_t triangleEnd = 0;                       ///< End of the triangle range of a leaf node. Internal nodes have an empty range.
+            uint32_t height = 0;                            ///< Number of edges on the longest path between the node and a leaf.
+
+            bool isLeaf() const { return triangleEnd > triangleBegin; }
+        };
+
+    public:
+        /** Host-side two-level light BVH for incremental updates.
+
+            A mesh light is static until it moves for the first time, after which it is dynamic.
+            All static lights share a single subtree and each dynamic light has its own subtree.
+            A top-level tree is built over the dynamic subtrees, and a root node joins it with the static subtree.
+            The nodes are laid out as follows:
+
+              [0]                        Root node, if there are both static and dynamic lights.
+              [dynamicNodeOffset, ...)   Top-level tree with the dynamic subtrees inlined in depth-first order.
+              [staticNodeOffset, ...)    Static subtree.
+
+            The range reserved for the dynamic part fits any tree over the dynamic lights, so the static subtree
+            is built once and then never moved or written again. The triangle indices of the dynamic part are
+            also placed before the static ones. When dynamic lights move, their subtrees are refit or rebuilt,
+            and the top-level tree over the dynamic subtrees is rebuilt. Only the top-level nodes that changed and
+            the subtrees that were updated or moved to a different place in the layout are rewritten.
+
+            If there are no dynamic lights, the BVH is identical to the one created by build().
+        */
+        struct IncrementalBVH
+        {
+            struct Subtree
+            {
+                static const uint32_t kInvalidOffset = std::numeric_limits<uint32_t>::max();
+
+                uint32_t lightIndex = 0;                        ///< Index of the mesh light.
+                std::vector<PackedNode> nodes;                  ///< Nodes with child and triangle offsets local to the subtree.
+                std::vector<TriangleSortData> trianglesData;    ///< Active triangles sorted by leaf node. Triangle indices are local to the mesh light.
+                std::vector<uint64_t> triangleBitmasks;         ///< Traversal bit pattern from the subtree root, indexed by local triangle index.
+                TriangleSortData bounds;                        ///< Bounds, flux and lighting cone of the subtree.
+                uint32_t height = 0;                            ///< Number of edges on the longest path between the subtree root and a leaf.
+
+                // Location of the subtree in the BVH data when it was last written.
+                bool isDirty = true;                            ///< True if the subtree was built or refit since it was last written.
+                uint32_t nodeOffset = kInvalidOffset;           ///< Index of the subtree root node.
+                uint32_t triangleOffset = kInvalidOffset;       ///< Index of the first triangle index of the subtree.
+                uint64_t bitmask = 0;                           ///< Bit pattern retracing the tree traversal to reach the subtree root.
+                uint32_t depth = 0;                             ///< Depth of the subtree root.
+            };
+
+            // BVH data in the layout of the LightBVH buffers.
+            std::vector<PackedNode> nodes;                      ///< BVH nodes. The nodes between the dynamic and static parts may be unused.
+            std::vector<uint32_t> triangleIndices;              ///< Triangle indices sorted by leaf node. The indices between the dynamic and static parts may be unused.
+            std::vector<uint64_t> triangleBitmasks;             ///< Per triangle bit pattern retracing the tree traversal to reach the triangle. Indexed by global triangle index.
+
+            // Data written by the last build or update.
+            std::vector<uint2> dirtyNodeRanges;                 ///< Sorted ranges [x, y) of nodes that were written.
+            std::vector<uint2> dirtyTriangleIndexRanges;        ///< Sorted ranges [x, y) of triangle indices that were written.
+            std::vector<uint2> dirtyBitmaskRanges;              ///< Sorted ranges [x, y) of triangle bitmasks that were written.
+
+            // Incremental state.
+            std::vector<bool> isDynamicLight;                   ///< Per mesh light flag, set when the light moves. This is kept when the BVH is rebuilt.
+            std::vector<uint32_t> lightSubtrees;                ///< Per mesh light index of its dynamic subtree, or MeshLightData::kInvalidIndex for static lights.
+            std::vector<Subtree> subtrees;                      ///< Subtrees of the dynamic lights, sorted by mesh light index.
+            TriangleSortData staticBounds;                      ///< Bounds, flux and lighting cone of the static subtree.
+            uint32_t dynamicNodeOffset = 0;                     ///< Index of the first node of the dynamic part.
+            uint32_t staticNodeOffset = 0;                      ///< Index of the root node of the static subtree.
+            uint32_t dynamicTriangleCapacity = 0;               ///< Number of triangle indices reserved for the dynamic part.
+            bool hasStatic = false;                             ///< True if the static subtree contains any triangles.
+            bool hasDynamic = false;                            ///< True if the dynamic subtrees contain any triangles.
+        };
+
+        /** Build a two-level BVH for incremental updates on the host.
+            The lights flagged in bvh.isDynamicLight are placed in dynamic subtrees, all other lights in the static subtree.
+            \param[in] triangles Emissive triangles, see LightCollection::getMeshLightTriangles().
+            \param[in] meshLights Mesh lights, see LightCollection::getMeshLights().
+            \param[in,out] bvh The BVH to build. All of its data is marked as written.
+        */
+        void buildIncremental(const std::vector<LightCollection::MeshLightTriangle>& triangles, const std::vector<MeshLightData>& meshLights, IncrementalBVH& bvh);
+
+        /** Update a two-level BVH on the host after some of the mesh lights have moved.
+            \param[in] triangles Emissive triangles, see LightCollection::getMeshLightTriangles().
+            \param[in] meshLights Mesh lights, see LightCollection::getMeshLights().
+            \param[in] updatedLights Indices of the mesh lights that have moved.
+            \param[in,out] bvh The BVH to update. The written parts of the data are marked as such.
+            \return True if the BVH had to be rebuilt, false if only the dynamic part was updated.
+        */
+        bool updateIncremental(const std::vector<LightCollection::MeshLightTriangle>& triangles, const std::vector<MeshLightData>& meshLights, const std::vector<uint32_t>& updatedLights, IncrementalBVH& bvh);
+
+    protected:
+
         /** Compute the split according to a specified heuristic.
             \param[in] data Prepared light data.
             \param[in] triangleRange Range of triangles to process.
@@ -155,6 +271,59 @@ namespace Falcor
         */
         uint32_t buildInternal(const Options& options, const SplitHeuristicFunction& splitHeuristic, uint64_t bitmask, uint32_t depth, const Range& triangleRange, BuildingData& data);
 
+        /** Build a BVH over a range of triangles with the split heuristic selected in the options.
+            The parameters are the same as for buildInternal().
+            \return Index of the allocated node.
+        */
+        uint32_t buildTree(const Options& options, uint64_t bitmask, uint32_t depth, const Range& triangleRange, BuildingData& data);
+
+        /** Morton (LBVH) build.
+            The triangles are sorted by the Morton codes of their centers and the hierarchy is created by splitting at the highest
+            differing bit of the codes. The node attributes are computed bottom-up in parallel, optionally followed by treelet restructuring.
+            The height of the tree is limited to the maximum BVH depth minus the depth of the root and data.depthReserve.
+            The nodes are written in the same layout as by buildInternal(), and the range of triangles is reordered by leaf node.
+            The parameters are the same as for buildInternal().
+            \return Index of the allocated node.
+        */
+        uint32_t buildMorton(const Options& options, uint64_t bitmask, uint32_t depth, const Range& triangleRange, BuildingData& data);
+
+        /** Recursively create the intermediate tree of the Morton build.
+            \param[in] mortonCodes Sorted Morton codes.
+            \param[in] codeRange Range of codes to process.
+            \param[in] maxLeafTriangleCount Ranges of at most this many triangles become leaf nodes.
+            \param[in] maxHeight Maximum height of the node. Ranges are split in the middle instead of at the highest differing bit where needed to stay within it.
+            \param[in] level Level of the node to create.
+            \param[in,out] nodes Intermediate tree.
+            \param[in,out] levels Indices of the nodes per level.
+            \return Index of the created node.
+        */
+        static uint32_t createMortonNode(const std::vector<uint64_t>& mortonCodes, const Range& codeRange, uint32_t maxLeafTriangleCount, uint32_t maxHeight, uint32_t level, std::vector<MortonNode>& nodes, std::vector<std::vector<uint32_t>>& levels);
+
+        /** Restructure the treelets of a subtree of the intermediate tree bottom-up.
+            \param[in] maxLevel Only restructure the treelets rooted above this level, relative to the subtree root.
+            \param[in] maxHeight Maximum height of the subtree.
+        */
+        static void restructureTreelets(std::vector<MortonNode>& nodes, uint32_t nodeIndex, uint32_t maxLevel, uint32_t maxHeight, const Options& options);
+
+        /** Find the topology of the treelet rooted at a node that minimizes the SAOH cost (Karras and Aila, 2013).
+            The treelet is formed by repeatedly expanding the child with the largest surface area. Its nodes are reused for the new topology.
+            \param[in] maxHeight Maximum height of the treelet root. Topologies that exceed it are rejected.
+            \return True if the topology was changed.
+        */
+        static bool restructureTreelet(std::vector<MortonNode>& nodes, uint32_t nodeIndex, uint32_t maxHeight, const Options& options);
+
+        /** Recursively write the intermediate tree of the Morton build in the node layout of buildInternal().
+            \param[in] mortonNodes Intermediate tree.
+            \param[in] mortonNodeIndex Index of the current node in the intermediate tree.
+            \param[in] sortedTriangles Triangles in Morton order.
+            \param[in] bitmask Bit pattern retracing the tree traversal to reach the node.
+            \param[in] depth Depth of the node.
+            \param[in,out] triangleOffset Index of the next triangle in data.trianglesData to write in leaf order.
+            \param[in,out] data Prepared light data.
+            \return Index of the allocated node.
+        */
+        static uint32_t writeMortonNode(const std::vector<MortonNode>& mortonNodes, uint32_t mortonNodeIndex, const std::vector<TriangleSortData>& sortedTriangles, uint64_t bitmask, uint32_t depth, uint32_t& triangleOffset, BuildingData& data);
+
         /** Recursive computation of lighting cones for all internal nodes.
             \param[in] nodeIndex Index of the current node.
             \param[in,out] data Updated node data.
@@ -178,7 +347,56 @@ namespace Falcor
 
         static SplitHeuristicFunction getSplitFunction(SplitHeuristic heuristic);
 
+        static TriangleSortData createTriangleSortData(const LightCollection::MeshLightTriangle& triangle, uint32_t triangleIndex);
+
+        /** Compute the bounds, flux and lighting cone of the union of two nodes.
+        */
+        static TriangleSortData mergeBounds(const TriangleSortData& a, const TriangleSortData& b);
+
+        static SharedNodeAttributes getNodeAttributes(const TriangleSortData& bounds);
+
+        /** Recursively recompute the attributes of a subtree from its triangles, keeping the hierarchy.
+            \param[in] nodeIndex Index of the current node.
+            \param[in,out] data Nodes and triangles, where the triangles are sorted by leaf node.
+            \return Bounds, flux and lighting cone of the current node.
+        */
+        static TriangleSortData refitInternal(const uint32_t nodeIndex, BuildingData& data);
+
+        /** Build or refit the subtree of a dynamic light from the current triangles.
+            \param[in] refit Refit the subtree if the set of active triangles has not changed.
+        */
+        void updateSubtree(IncrementalBVH::Subtree& subtree, const std::vector<LightCollection::MeshLightTriangle>& triangles, const std::vector<MeshLightData>& meshLights, bool refit);
+
+        /** Rebuild the top-level tree over the dynamic subtrees and write the dynamic part of the BVH.
+            Only the top-level nodes that changed and the subtrees that are dirty or have moved in the layout are rewritten.
+        */
+        void writeDynamicPart(IncrementalBVH& bvh, const std::vector<MeshLightData>& meshLights);
+
+        /** Recursively write a node of the top-level tree, copying the dirty subtrees in place of the top-level leaf nodes.
+            \param[in] top The top-level tree. Each leaf references a single subtree.
+            \param[in] topNodeIndex Index of the current node in the top-level tree.
+            \param[in] bitmask Bit pattern retracing the tree traversal to reach the node.
+            \param[in] depth Depth of the node.
+            \param[in,out] nodeIndex Index of the next node to write.
+            \param[in,out] triangleOffset Index of the next triangle index to write.
+            \return Bounds, flux and lighting cone of the written node.
+        */
+        TriangleSortData writeDynamicNode(IncrementalBVH& bvh, const std::vector<MeshLightData>& meshLights, const BuildingData& top, uint32_t topNodeIndex, uint64_t bitmask, uint32_t depth, uint32_t& nodeIndex, uint32_t& triangleOffset);
+
+        /** Upload the data of the incremental BVH to a light BVH.
+            \param[in] rebuilt True if the incremental BVH was rebuilt, false if only the dirty parts should be uploaded.
+        */
+        void uploadIncrementalBVH(LightBVH& bvh, bool rebuilt);
+
+        /** Load a BVH from the scene cache.
+            \return True if a valid BVH was found and uploaded.
+        */
+        bool readFromCache(LightBVH& bvh, const SHA1::MD& sceneCacheKey, const SHA1::MD& cacheKey);
+
         // Configuration
         Options mOptions;
+
+        // Internal state
+        IncrementalBVH mIncrementalBVH;                     ///< Host-side data of the last BVH built with incremental updates.
     };
 }
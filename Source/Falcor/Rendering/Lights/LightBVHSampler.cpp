@@ -55,21 +55,30 @@ namespace Falcor
 
         bool samplerChanged = false;
         bool needsRefit = false;
+        bool needsIncrementalUpdate = false;
 
         // Check if light collection has changed.
-        if (is_set(mpScene->getUpdates(), Scene::UpdateFlags::LightCollectionChanged))
+        const bool lightCollectionChanged = is_set(mpScene->getUpdates(), Scene::UpdateFlags::LightCollectionChanged);
+        if (lightCollectionChanged)
         {
-            if (mOptions.buildOptions.allowRefitting && !mNeedsRebuild) needsRefit = true;
+            if (mOptions.buildOptions.useIncrementalUpdates && !mNeedsRebuild) needsIncrementalUpdate = true;
+            else if (mOptions.buildOptions.allowRefitting && !mNeedsRebuild) needsRefit = true;
             else mNeedsRebuild = true;
         }
 
         // Rebuild BVH if it's marked as dirty.
         if (mNeedsRebuild)
         {
-            mpBVHBuilder->build(*mpBVH);
+            // The scene cache is only used for static lights, to not write a cache entry for every frame of an animation.
+            mpBVHBuilder->build(*mpBVH, lightCollectionChanged ? std::nullopt : mpScene->getSceneCacheKey());
             mNeedsRebuild = false;
             samplerChanged = true;
         }
+        else if (needsIncrementalUpdate)
+        {
+            mpBVHBuilder->update(*mpBVH);
+            samplerChanged = true;
+        }
         else if (needsRefit)
         {
             mpBVH->refit(pRenderContext);
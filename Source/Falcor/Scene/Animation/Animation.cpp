@@ -261,6 +261,13 @@ namespace Falcor
     {
         assert(keyframe.time <= mDuration);
 
+        // Keyframes are usually added in order, so check for appending first.
+        if (mKeyframes.size() > 0 && mKeyframes.back().time < keyframe.time)
+        {
+            mKeyframes.push_back(keyframe);
+            return;
+        }
+
         if (mKeyframes.size() == 0 || mKeyframes[0].time > keyframe.time)
         {
             mKeyframes.insert(mKeyframes.begin(), keyframe);
@@ -299,9 +299,13 @@ namespace Falcor
     void AnimationController::createSkinningPass(const std::vector<PackedStaticVertexData>& staticVertexData, const std::vector<DynamicVertexData>& dynamicVertexData)
     {
         // We always copy the static data, to initialize the non-skinned vertices.
+        // The static data is empty if the scene uses out-of-core geometry, the vertex buffer is then initialized from the paged store by the scene.
         const Buffer::SharedPtr& pVB = mpScene->mpVao->getVertexBuffer(Scene::kStaticDataBufferIndex);
-        assert(pVB->getSize() == staticVertexData.size() * sizeof(staticVertexData[0]));
-        pVB->setBlob(staticVertexData.data(), 0, pVB->getSize());
+        if (!staticVertexData.empty())
+        {
+            assert(pVB->getSize() == staticVertexData.size() * sizeof(staticVertexData[0]));
+            pVB->setBlob(staticVertexData.data(), 0, pVB->getSize());
+        }
 
         if (!dynamicVertexData.empty())
         {
@@ -28,6 +28,9 @@
 #include "stdafx.h"
 #include "CurveTessellation.h"
 #include "Utils/Math/MathHelpers.h"
+#include "Utils/NumericRange.h"
+#include <execution>
+#include <numeric>
 #define _USE_MATH_DEFINES
 #include <math.h>
 
@@ -45,149 +48,290 @@ namespace Falcor
             float xr = glm::length(xq.xyz - xp.xyz);
             return float4(xp.xyz, xr);
         }
-    }
 
-    CurveTessellation::SweptSphereResult CurveTessellation::convertToLinearSweptSphere(size_t strandCount, const int* vertexCountsPerStrand, const float3* controlPoints, const float* widths, const float2* UVs, uint32_t degree, uint32_t subdivPerSegment, uint32_t keepOneEveryXPerStrand, const glm::mat4& xform)
-    {
-        SweptSphereResult result;
+        /** Choose the number of sub-segments for cubic segment j of a strand.
+            A sub-segment of length l whose tangent turns by angle a deviates about l * a / 8 from the curve,
+            so n sub-segments of a segment with length L and total turn A deviate about L * A / (8 * n^2).
+        */
+        uint32_t computeSegmentSubdiv(const CubicSpline<float3>& strandPoints, const CubicSpline<float>& strandWidths, uint32_t j, const CurveTessellation::TessellationOptions& options, const glm::mat4& xform)
+        {
+            const uint32_t kChordCount = 4;
+            float4 sph[kChordCount + 1];
+            for (uint32_t s = 0; s <= kChordCount; s++)
+            {
+                float t = (float)s / (float)kChordCount;
+                sph[s] = transformSphere(xform, float4(strandPoints.interpolate(j, t), strandWidths.interpolate(j, t) * 0.5f));
+            }
 
-        // Only support linear tube segments now.
-        // TODO: Add quadratic or cubic tube segments if necessary.
-        assert(degree == 1);
-        result.degree = degree;
+            float length = 0.f;
+            float angle = 0.f;
+            float minRadius = sph[0].w;
+            float3 prevDir = float3(0.f);
+            for (uint32_t s = 0; s < kChordCount; s++)
+            {
+                float3 d = sph[s + 1].xyz - sph[s].xyz;
+                float l = glm::length(d);
+                minRadius = std::min(minRadius, sph[s + 1].w);
+                if (l <= 0.f) continue;
+                float3 dir = d / l;
+                if (length > 0.f) angle += std::acos(glm::clamp(glm::dot(prevDir, dir), -1.f, 1.f));
+                length += l;
+                prevDir = dir;
+            }
 
-        uint32_t pointCounts = 0;
-        uint32_t segCounts = 0;
-        for (uint32_t i = 0; i < strandCount; i++)
-        {
-            uint32_t tmpPointCount = (subdivPerSegment * (vertexCountsPerStrand[i] - 1) + keepOneEveryXPerStrand - 1) / keepOneEveryXPerStrand + 1;
-            pointCounts += tmpPointCount;
-            segCounts += tmpPointCount - 1;
+            float tolerance = options.maxDeviation * minRadius;
+            if (options.pixelAngle > 0.f)
+            {
+                float distance = glm::length(sph[kChordCount / 2].xyz - options.viewPosition);
+                tolerance = std::max(tolerance, options.maxPixelDeviation * options.pixelAngle * distance);
+            }
+            if (!(tolerance > 0.f)) return options.subdivPerSegment;
+
+            float n = std::ceil(std::sqrt(length * angle / (8.f * tolerance)));
+            return (uint32_t)glm::clamp(n, 1.f, (float)options.subdivPerSegment);
         }
-        result.indices.reserve(segCounts);
-        result.points.reserve(pointCounts);
-        result.radius.reserve(pointCounts);
-        result.texCrds.reserve(pointCounts);
 
-        uint32_t pointOffset = 0;
-        for (uint32_t i = 0; i < strandCount; i++)
+        /** Visit the kept curve points of a strand in order.
+            Curve point m of the S sub-segment end points of a strand is kept if m is a multiple of keepOneEveryXPerStrand, or if it is the last one.
+            With segmentEnd == false, point m is evaluated at the start of its sub-segment and the last point at the end of the last segment (swept spheres).
+            With segmentEnd == true, the first point is evaluated at the start of the strand and point m at the end of its sub-segment (mesh).
+            \param[in] func Called as func(segment, t) for each kept point.
+        */
+        template<typename Func>
+        void forEachCurvePoint(const CurveTessellation::StrandLayout& layout, uint32_t strandIndex, uint32_t segmentCount, bool segmentEnd, Func func)
         {
-            CubicSpline strandPoints(controlPoints + pointOffset, vertexCountsPerStrand[i]);
-            CubicSpline strandWidths(widths + pointOffset, vertexCountsPerStrand[i]);
+            const uint32_t* pSubdivs = layout.segmentSubdivs.empty() ? nullptr : layout.segmentSubdivs.data() + layout.controlPointOffsets[strandIndex] - strandIndex;
+            auto getSubdiv = [&](uint32_t j) { return pSubdivs ? pSubdivs[j] : layout.subdivPerSegment; };
+
+            uint32_t totalSubdiv = 0;
+            for (uint32_t j = 0; j < segmentCount; j++) totalSubdiv += getSubdiv(j);
+
+            const uint32_t keepOneEveryX = layout.keepOneEveryXPerStrand;
+            const uint32_t kFirst = segmentEnd ? 1 : 0;
+            uint32_t m = 0;
+            if (segmentEnd)
+            {
+                func(0u, 0.f);
+                m++;
+            }
 
-            uint32_t tmpCount = 0;
-            for (uint32_t j = 0; j < (uint32_t)vertexCountsPerStrand[i] - 1; j++)
+            for (uint32_t j = 0; j < segmentCount; j++)
             {
-                for (uint32_t k = 0; k < subdivPerSegment; k++)
+                const uint32_t subdiv = getSubdiv(j);
+                for (uint32_t k = kFirst; k < subdiv + kFirst; k++, m++)
                 {
-                    // Always keep the last vertex.
-                    if (tmpCount % keepOneEveryXPerStrand == 0 || (j == vertexCountsPerStrand[i] - 1 && k == subdivPerSegment - 1))
+                    if ((m % keepOneEveryX == 0 && m < totalSubdiv) || (segmentEnd && m == totalSubdiv))
                     {
-                        float t = (float)k / (float)subdivPerSegment;
-                        result.indices.push_back((uint32_t)result.points.size());
-
-                        // Pre-transform curve points.
-                        float4 sph = transformSphere(xform, float4(strandPoints.interpolate(j, t), strandWidths.interpolate(j, t) * 0.5f));
-                        result.points.push_back(sph.xyz);
-                        result.radius.push_back(sph.w);
+                        func(j, (float)k / (float)subdiv);
                     }
-                    tmpCount++;
                 }
             }
 
-            float4 sph = transformSphere(xform, float4(strandPoints.interpolate(vertexCountsPerStrand[i] - 2, 1.f), strandWidths.interpolate(vertexCountsPerStrand[i] - 2, 1.f) * 0.5f));
-            result.points.push_back(sph.xyz);
-            result.radius.push_back(sph.w);
+            if (!segmentEnd) func(segmentCount - 1, 1.f);
+        }
+    }
 
-            // Texture coordinates.
-            if (UVs)
+    CurveTessellation::StrandLayout CurveTessellation::computeStrandLayout(size_t strandCount, const int* vertexCountsPerStrand, const float3* controlPoints, const float* widths, const TessellationOptions& options, const glm::mat4& xform)
+    {
+        StrandLayout layout;
+        layout.subdivPerSegment = std::max(options.subdivPerSegment, 1u);
+        layout.keepOneEveryXPerStrand = std::max(options.keepOneEveryXPerStrand, 1u);
+
+        layout.controlPointOffsets.resize(strandCount + 1);
+        layout.controlPointOffsets[0] = 0;
+        std::inclusive_scan(std::execution::par, vertexCountsPerStrand, vertexCountsPerStrand + strandCount, layout.controlPointOffsets.begin() + 1, std::plus<uint32_t>(), 0u);
+
+        if (options.adaptive)
+        {
+            layout.segmentSubdivs.resize(layout.controlPointOffsets.back() - strandCount);
+        }
+
+        // Count the curve points of each strand, then turn the counts into offsets.
+        layout.pointOffsets.resize(strandCount + 1);
+        layout.pointOffsets[0] = 0;
+        NumericRange<uint32_t> range(0, (uint32_t)strandCount);
+        std::for_each(std::execution::par, range.begin(), range.end(), [&](uint32_t i)
+        {
+            assert(vertexCountsPerStrand[i] >= 2);
+            const uint32_t segmentCount = (uint32_t)vertexCountsPerStrand[i] - 1;
+            uint32_t totalSubdiv = layout.subdivPerSegment * segmentCount;
+
+            if (options.adaptive)
             {
-                CubicSpline strandUVs(UVs + pointOffset, vertexCountsPerStrand[i]);
-                tmpCount = 0;
-                for (uint32_t j = 0; j < (uint32_t)vertexCountsPerStrand[i] - 1; j++)
+                const uint32_t offset = layout.controlPointOffsets[i];
+                CubicSpline strandPoints(controlPoints + offset, vertexCountsPerStrand[i]);
+                CubicSpline strandWidths(widths + offset, vertexCountsPerStrand[i]);
+                uint32_t* pSubdivs = layout.segmentSubdivs.data() + offset - i;
+
+                totalSubdiv = 0;
+                for (uint32_t j = 0; j < segmentCount; j++)
                 {
-                    for (uint32_t k = 0; k < subdivPerSegment; k++)
-                    {
-                        if (tmpCount % keepOneEveryXPerStrand == 0 || (j == vertexCountsPerStrand[i] - 1 && k == subdivPerSegment - 1))
-                        {
-                            float t = (float)k / (float)subdivPerSegment;
-                            result.texCrds.push_back(strandUVs.interpolate(j, t));
-                        }
-                        tmpCount++;
-                    }
+                    pSubdivs[j] = computeSegmentSubdiv(strandPoints, strandWidths, j, options, xform);
+                    totalSubdiv += pSubdivs[j];
                 }
-                result.texCrds.push_back(strandUVs.interpolate(vertexCountsPerStrand[i] - 2, 1.f));
             }
 
-            pointOffset += vertexCountsPerStrand[i];
-        }
+            layout.pointOffsets[i + 1] = (totalSubdiv + layout.keepOneEveryXPerStrand - 1) / layout.keepOneEveryXPerStrand + 1;
+        });
+        std::inclusive_scan(std::execution::par, layout.pointOffsets.begin() + 1, layout.pointOffsets.end(), layout.pointOffsets.begin() + 1);
+
+        return layout;
+    }
+
+    CurveTessellation::SweptSphereResult CurveTessellation::convertToLinearSweptSphere(size_t strandCount, const int* vertexCountsPerStrand, const float3* controlPoints, const float* widths, const float2* UVs, uint32_t degree, uint32_t subdivPerSegment, uint32_t keepOneEveryXPerStrand, const glm::mat4& xform)
+    {
+        TessellationOptions options;
+        options.subdivPerSegment = subdivPerSegment;
+        options.keepOneEveryXPerStrand = keepOneEveryXPerStrand;
+        return convertToLinearSweptSphere(strandCount, vertexCountsPerStrand, controlPoints, widths, UVs, degree, options, xform);
+    }
+
+    CurveTessellation::SweptSphereResult CurveTessellation::convertToLinearSweptSphere(size_t strandCount, const int* vertexCountsPerStrand, const float3* controlPoints, const float* widths, const float2* UVs, uint32_t degree, const TessellationOptions& options, const glm::mat4& xform)
+    {
+        SweptSphereResult result;
+
+        // Only support linear tube segments now.
+        // TODO: Add quadratic or cubic tube segments if necessary.
+        assert(degree == 1);
+        result.degree = degree;
+
+        StrandLayout layout = computeStrandLayout(strandCount, vertexCountsPerStrand, controlPoints, widths, options, xform);
+        result.indices.resize(layout.getSegmentCount());
+        result.points.resize(layout.getPointCount());
+        result.radius.resize(layout.getPointCount());
+        if (UVs) result.texCrds.resize(layout.getPointCount());
+
+        SweptSphereBuffers buffers;
+        buffers.pIndices = result.indices.data();
+        buffers.pPoints = result.points.data();
+        buffers.pRadius = result.radius.data();
+        buffers.pTexCrds = UVs ? result.texCrds.data() : nullptr;
+        tessellateLinearSweptSphere(layout, vertexCountsPerStrand, controlPoints, widths, UVs, xform, buffers);
 
         return result;
     }
 
+    void CurveTessellation::tessellateLinearSweptSphere(const StrandLayout& layout, const int* vertexCountsPerStrand, const float3* controlPoints, const float* widths, const float2* UVs, const glm::mat4& xform, const SweptSphereBuffers& buffers, uint32_t indexOffset)
+    {
+        NumericRange<uint32_t> range(0, (uint32_t)layout.getStrandCount());
+        std::for_each(std::execution::par, range.begin(), range.end(), [&](uint32_t i)
+        {
+            const uint32_t offset = layout.controlPointOffsets[i];
+            const uint32_t segmentCount = (uint32_t)vertexCountsPerStrand[i] - 1;
+            const uint32_t pointBegin = layout.pointOffsets[i];
+            const uint32_t pointEnd = layout.pointOffsets[i + 1];
+
+            CubicSpline strandPoints(controlPoints + offset, vertexCountsPerStrand[i]);
+            CubicSpline strandWidths(widths + offset, vertexCountsPerStrand[i]);
+
+            uint32_t pointIndex = pointBegin;
+            forEachCurvePoint(layout, i, segmentCount, false, [&](uint32_t j, float t)
+            {
+                // Pre-transform curve points.
+                float4 sph = transformSphere(xform, float4(strandPoints.interpolate(j, t), strandWidths.interpolate(j, t) * 0.5f));
+                buffers.pPoints[pointIndex] = sph.xyz;
+                buffers.pRadius[pointIndex] = sph.w;
+                pointIndex++;
+            });
+            assert(pointIndex == pointEnd);
+
+            // Each point except the last one of the strand starts a segment.
+            uint32_t* pIndices = buffers.pIndices + pointBegin - i;
+            for (uint32_t p = pointBegin; p + 1 < pointEnd; p++) *pIndices++ = indexOffset + p;
+
+            // Texture coordinates.
+            if (UVs && buffers.pTexCrds)
+            {
+                CubicSpline strandUVs(UVs + offset, vertexCountsPerStrand[i]);
+                pointIndex = pointBegin;
+                forEachCurvePoint(layout, i, segmentCount, false, [&](uint32_t j, float t)
+                {
+                    buffers.pTexCrds[pointIndex++] = strandUVs.interpolate(j, t);
+                });
+            }
+        });
+    }
+
     CurveTessellation::MeshResult CurveTessellation::convertToMesh(size_t strandCount, const int* vertexCountsPerStrand, const float3* controlPoints, const float* widths, const float2* UVs, uint32_t subdivPerSegment, uint32_t pointCountPerCrossSection)
+    {
+        TessellationOptions options;
+        options.subdivPerSegment = subdivPerSegment;
+        return convertToMesh(strandCount, vertexCountsPerStrand, controlPoints, widths, UVs, options, pointCountPerCrossSection);
+    }
+
+    CurveTessellation::MeshResult CurveTessellation::convertToMesh(size_t strandCount, const int* vertexCountsPerStrand, const float3* controlPoints, const float* widths, const float2* UVs, const TessellationOptions& options, uint32_t pointCountPerCrossSection)
     {
         MeshResult result;
-        uint32_t vertexCounts = 0;
-        uint32_t faceCounts = 0;
-        for (uint32_t i = 0; i < strandCount; i++)
-        {
-            vertexCounts += pointCountPerCrossSection * subdivPerSegment * (vertexCountsPerStrand[i] - 1) + 1;
-            faceCounts += 2 * pointCountPerCrossSection * subdivPerSegment * (vertexCountsPerStrand[i] - 1);
-        }
-        result.vertices.reserve(vertexCounts);
-        result.normals.reserve(vertexCounts);
-        result.tangents.reserve(vertexCounts);
-        result.faceVertexCounts.reserve(faceCounts);
-        result.faceVertexIndices.reserve(faceCounts * 3);
-        result.texCrds.reserve(vertexCounts);
-
-        uint32_t pointOffset = 0;
-        uint32_t meshVertexOffset = 0;
-        for (uint32_t i = 0; i < strandCount; i++)
+
+        StrandLayout layout = computeStrandLayout(strandCount, vertexCountsPerStrand, controlPoints, widths, options);
+        const uint32_t vertexCount = layout.getMeshVertexCount(pointCountPerCrossSection);
+        const uint32_t faceCount = layout.getMeshFaceCount(pointCountPerCrossSection);
+        result.vertices.resize(vertexCount);
+        result.normals.resize(vertexCount);
+        result.tangents.resize(vertexCount);
+        result.faceVertexCounts.resize(faceCount);
+        result.faceVertexIndices.resize(faceCount * 3);
+        if (UVs) result.texCrds.resize(vertexCount);
+
+        MeshBuffers buffers;
+        buffers.pVertices = result.vertices.data();
+        buffers.pNormals = result.normals.data();
+        buffers.pTangents = result.tangents.data();
+        buffers.pFaceVertexCounts = result.faceVertexCounts.data();
+        buffers.pFaceVertexIndices = result.faceVertexIndices.data();
+        buffers.pTexCrds = UVs ? result.texCrds.data() : nullptr;
+        tessellateMesh(layout, vertexCountsPerStrand, controlPoints, widths, UVs, pointCountPerCrossSection, buffers);
+
+        return result;
+    }
+
+    void CurveTessellation::tessellateMesh(const StrandLayout& layout, const int* vertexCountsPerStrand, const float3* controlPoints, const float* widths, const float2* UVs, uint32_t pointCountPerCrossSection, const MeshBuffers& buffers, uint32_t vertexOffset)
+    {
+        const bool writeTexCrds = UVs && buffers.pTexCrds;
+
+        NumericRange<uint32_t> range(0, (uint32_t)layout.getStrandCount());
+        std::for_each(std::execution::par, range.begin(), range.end(), [&](uint32_t i)
         {
-            CubicSpline strandPoints(controlPoints + pointOffset, vertexCountsPerStrand[i]);
-            CubicSpline strandWidths(widths + pointOffset, vertexCountsPerStrand[i]);
+            const uint32_t offset = layout.controlPointOffsets[i];
+            const uint32_t segmentCount = (uint32_t)vertexCountsPerStrand[i] - 1;
+            const uint32_t curvePointCount = layout.pointOffsets[i + 1] - layout.pointOffsets[i];
+
+            CubicSpline strandPoints(controlPoints + offset, vertexCountsPerStrand[i]);
+            CubicSpline strandWidths(widths + offset, vertexCountsPerStrand[i]);
 
             std::vector<float3> curvePoints;
             std::vector<float> curveRadius;
             std::vector<float2> curveUVs;
+            curvePoints.reserve(curvePointCount);
+            curveRadius.reserve(curvePointCount);
 
-            curvePoints.push_back(strandPoints.interpolate(0, 0.f));
-            curveRadius.push_back(strandWidths.interpolate(0, 0.f) * 0.5f);
-
-            for (uint32_t j = 0; j < (uint32_t)vertexCountsPerStrand[i] - 1; j++)
+            forEachCurvePoint(layout, i, segmentCount, true, [&](uint32_t j, float t)
             {
-                for (uint32_t k = 1; k <= subdivPerSegment; k++)
-                {
-                    float t = (float)k / (float)subdivPerSegment;
-                    curvePoints.push_back(strandPoints.interpolate(j, t));
-                    curveRadius.push_back(strandWidths.interpolate(j, t) * 0.5f);
-                }
-            }
+                curvePoints.push_back(strandPoints.interpolate(j, t));
+                curveRadius.push_back(strandWidths.interpolate(j, t) * 0.5f);
+            });
+            assert(curvePoints.size() == curvePointCount);
 
             // Texture coordinates.
-            if (UVs)
+            if (writeTexCrds)
             {
-                CubicSpline strandUVs(UVs + pointOffset, vertexCountsPerStrand[i]);
-                curveUVs.push_back(strandUVs.interpolate(0, 0.f));
-                for (uint32_t j = 0; j < (uint32_t)vertexCountsPerStrand[i] - 1; j++)
+                CubicSpline strandUVs(UVs + offset, vertexCountsPerStrand[i]);
+                curveUVs.reserve(curvePointCount);
+                forEachCurvePoint(layout, i, segmentCount, true, [&](uint32_t j, float t)
                 {
-                    for (uint32_t k = 1; k <= subdivPerSegment; k++)
-                    {
-                        float t = (float)k / (float)subdivPerSegment;
-                        curveUVs.push_back(strandUVs.interpolate(j, t));
-                    }
-                }
+                    curveUVs.push_back(strandUVs.interpolate(j, t));
+                });
             }
 
-            pointOffset += vertexCountsPerStrand[i];
-
             // Create mesh.
-            for (uint32_t j = 0; j < curvePoints.size(); j++)
+            const uint32_t strandVertexOffset = layout.pointOffsets[i] * pointCountPerCrossSection;
+            const uint32_t meshVertexOffset = vertexOffset + strandVertexOffset;
+            uint32_t faceIndex = (layout.pointOffsets[i] - i) * pointCountPerCrossSection * 2;
+
+            for (uint32_t j = 0; j < curvePointCount; j++)
             {
                 float3 fwd, s, t;
-                if (j < curvePoints.size() - 1)
+                if (j < curvePointCount - 1)
                 {
                     fwd = normalize(curvePoints[j + 1] - curvePoints[j]);
                 }
@@ -203,36 +347,44 @@ namespace Falcor
                     float phi = (float)k / (float)pointCountPerCrossSection * (float)M_PI * 2.f;
                     float3 vNormal = std::cos(phi) * s + std::sin(phi) * t;
 
-                    result.vertices.push_back(curvePoints[j] + curveRadius[j] * vNormal);
-                    result.normals.push_back(vNormal);
-                    result.tangents.push_back(float4(fwd.x, fwd.y, fwd.z, 1));
+                    const uint32_t v = strandVertexOffset + j * pointCountPerCrossSection + k;
+                    buffers.pVertices[v] = curvePoints[j] + curveRadius[j] * vNormal;
+                    buffers.pNormals[v] = vNormal;
+                    buffers.pTangents[v] = float4(fwd.x, fwd.y, fwd.z, 1);
 
-                    if (UVs)
+                    if (writeTexCrds)
                     {
-                        result.texCrds.push_back(curveUVs[j]);
+                        buffers.pTexCrds[v] = curveUVs[j];
                     }
                 }
 
                 // Mesh faces.
-                if (j < curvePoints.size() - 1)
+                if (j < curvePointCount - 1)
                 {
                     for (uint32_t k = 0; k < pointCountPerCrossSection; k++)
                     {
-                        result.faceVertexCounts.push_back(3);
-                        result.faceVertexIndices.push_back(meshVertexOffset + j * pointCountPerCrossSection + k);
-                        result.faceVertexIndices.push_back(meshVertexOffset + j * pointCountPerCrossSection + (k + 1) % pointCountPerCrossSection);
-                        result.faceVertexIndices.push_back(meshVertexOffset + (j + 1) * pointCountPerCrossSection + (k + 1) % pointCountPerCrossSection);
-
-                        result.faceVertexCounts.push_back(3);
-                        result.faceVertexIndices.push_back(meshVertexOffset + j * pointCountPerCrossSection + k);
-                        result.faceVertexIndices.push_back(meshVertexOffset + (j + 1) * pointCountPerCrossSection + (k + 1) % pointCountPerCrossSection);
-                        result.faceVertexIndices.push_back(meshVertexOffset + (j + 1) * pointCountPerCrossSection + k);
+                        const uint32_t v00 = meshVertexOffset + j * pointCountPerCrossSection + k;
+                        const uint32_t v01 = meshVertexOffset + j * pointCountPerCrossSection + (k + 1) % pointCountPerCrossSection;
+                        const uint32_t v11 = meshVertexOffset + (j + 1) * pointCountPerCrossSection + (k + 1) % pointCountPerCrossSection;
+                        const uint32_t v10 = meshVertexOffset + (j + 1) * pointCountPerCrossSection + k;
+
+                        uint32_t* pFace = buffers.pFaceVertexIndices + faceIndex * 3;
+                        pFace[0] = v00;
+                        pFace[1] = v01;
+                        pFace[2] = v11;
+                        pFace[3] = v00;
+                        pFace[4] = v11;
+                        pFace[5] = v10;
+
+                        if (buffers.pFaceVertexCounts)
+                        {
+                            buffers.pFaceVertexCounts[faceIndex] = 3;
+                            buffers.pFaceVertexCounts[faceIndex + 1] = 3;
+                        }
+                        faceIndex += 2;
                     }
                 }
             }
-
-            meshVertexOffset += pointCountPerCrossSection * (uint32_t)curvePoints.size();
-        }
-        return result;
+        });
     }
 }
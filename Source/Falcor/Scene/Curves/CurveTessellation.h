@@ -33,6 +33,53 @@ namespace Falcor
     class dlldecl CurveTessellation
     {
     public:
+        /** Tessellation options.
+            In fixed mode every cubic segment is split into subdivPerSegment sub-segments.
+            In adaptive mode the sub-segment count of each cubic segment is chosen such that the distance between the curve
+            and its linear approximation stays below a tolerance, clamped to [1, subdivPerSegment]. The tolerance is
+            maxDeviation times the curve radius, or the world-space size of maxPixelDeviation pixels seen from viewPosition
+            if that is larger (only when pixelAngle > 0).
+        */
+        struct TessellationOptions
+        {
+            uint32_t subdivPerSegment = 4;          ///< Fixed mode: sub-segments per cubic segment. Adaptive mode: maximum sub-segments per cubic segment.
+            uint32_t keepOneEveryXPerStrand = 1;    ///< Keep one of every X vertices in each curve strand. The last vertex is always kept.
+            bool adaptive = false;                  ///< Choose the sub-segment count per cubic segment from curvature and width.
+            float maxDeviation = 0.1f;              ///< Adaptive mode: maximum deviation from the curve relative to the curve radius.
+            float3 viewPosition = float3(0.f);      ///< Adaptive mode: viewer position for the screen-space tolerance.
+            float pixelAngle = 0.f;                 ///< Adaptive mode: angle subtended by one pixel in radians. Zero disables the screen-space tolerance.
+            float maxPixelDeviation = 0.5f;         ///< Adaptive mode: maximum deviation from the curve in pixels.
+        };
+
+        /** Output layout of a set of strands, computed by a parallel pass over the strands followed by prefix sums.
+            The layout is shared by the swept sphere and mesh outputs. Strand i owns the curve points [pointOffsets[i], pointOffsets[i + 1]).
+        */
+        struct StrandLayout
+        {
+            std::vector<uint32_t> controlPointOffsets;  ///< Offset of the first control point of each strand (strandCount + 1 entries).
+            std::vector<uint32_t> pointOffsets;         ///< Offset of the first curve point of each strand (strandCount + 1 entries).
+            std::vector<uint32_t> segmentSubdivs;       ///< Sub-segments per cubic segment, indexed by controlPointOffsets[i] - i + j. Empty in fixed mode.
+            uint32_t subdivPerSegment = 0;              ///< Sub-segments per cubic segment in fixed mode.
+            uint32_t keepOneEveryXPerStrand = 1;        ///< Decimation factor.
+
+            size_t getStrandCount() const { return pointOffsets.empty() ? 0 : pointOffsets.size() - 1; }
+            uint32_t getPointCount() const { return pointOffsets.empty() ? 0 : pointOffsets.back(); }
+            uint32_t getSegmentCount() const { return getPointCount() - (uint32_t)getStrandCount(); }
+            uint32_t getMeshVertexCount(uint32_t pointCountPerCrossSection) const { return getPointCount() * pointCountPerCrossSection; }
+            uint32_t getMeshFaceCount(uint32_t pointCountPerCrossSection) const { return getSegmentCount() * pointCountPerCrossSection * 2; }
+        };
+
+        /** Compute the output layout of a set of strands. Strands are processed in parallel.
+            \param[in] strandCount Number of curve strands.
+            \param[in] vertexCountsPerStrand Number of control points per strand (at least 2).
+            \param[in] controlPoints Array of control points.
+            \param[in] widths Array of curve widths, i.e., diameters of swept spheres.
+            \param[in] options Tessellation options.
+            \param[in] xform Transformation applied to the curve geometry. Only used by the adaptive mode to measure world-space tolerances.
+            eturn Output layout.
+        */
+        static StrandLayout computeStrandLayout(size_t strandCount, const int* vertexCountsPerStrand, const float3* controlPoints, const float* widths, const TessellationOptions& options, const glm::mat4& xform = glm::mat4(1.f));
+
         // Swept spheres
 
         struct SweptSphereResult
@@ -44,6 +91,17 @@ namespace Falcor
             std::vector<float2> texCrds;
         };
 
+        /** Caller-provided output buffers for linear swept spheres.
+            The point buffers must hold layout.getPointCount() elements and the index buffer layout.getSegmentCount() elements.
+        */
+        struct SweptSphereBuffers
+        {
+            uint32_t* pIndices = nullptr;   ///< Index of the first point of each segment.
+            float3* pPoints = nullptr;      ///< Sphere centers.
+            float* pRadius = nullptr;       ///< Sphere radii.
+            float2* pTexCrds = nullptr;     ///< Texture coordinates. Optional, only written if UVs are provided.
+        };
+
         /** Convert cubic B-splines to a couple of linear swept sphere segments.
             \param[in] strandCount Number of curve strands.
             \param[in] vertexCountsPerStrand Number of control points per strand.
@@ -54,10 +112,35 @@ namespace Falcor
             \param[in] subdivPerSegment Number of sub-segments within each cubic bspline segment (defined by 4 control points).
             \param[in] keepOneEveryXPerStrand Keep one of every X vertices in each curve strand.
             \param[in] xform Row-major 4x4 transformation matrix. We apply pre-transformation to curve geometry.
-            \return Linear swept sphere segments.
+            eturn Linear swept sphere segments.
         */
         static SweptSphereResult convertToLinearSweptSphere(size_t strandCount, const int* vertexCountsPerStrand, const float3* controlPoints, const float* widths, const float2* UVs, uint32_t degree, uint32_t subdivPerSegment, uint32_t keepOneEveryXPerStrand, const glm::mat4& xform);
 
+        /** Convert cubic B-splines to a couple of linear swept sphere segments, with optional adaptive subdivision.
+            \param[in] strandCount Number of curve strands.
+            \param[in] vertexCountsPerStrand Number of control points per strand.
+            \param[in] controlPoints Array of control points.
+            \param[in] widths Array of curve widths, i.e., diameters of swept spheres.
+            \param[in] UVs Array of texture coordinates.
+            \param[in] degree Polynomial degree of strand (linear -- cubic).
+            \param[in] options Tessellation options.
+            \param[in] xform Row-major 4x4 transformation matrix. We apply pre-transformation to curve geometry.
+            eturn Linear swept sphere segments.
+        */
+        static SweptSphereResult convertToLinearSweptSphere(size_t strandCount, const int* vertexCountsPerStrand, const float3* controlPoints, const float* widths, const float2* UVs, uint32_t degree, const TessellationOptions& options, const glm::mat4& xform);
+
+        /** Write linear swept sphere segments into caller-provided buffers. Strands are processed in parallel.
+            \param[in] layout Output layout from computeStrandLayout().
+            \param[in] vertexCountsPerStrand Number of control points per strand.
+            \param[in] controlPoints Array of control points.
+            \param[in] widths Array of curve widths, i.e., diameters of swept spheres.
+            \param[in] UVs Array of texture coordinates, or nullptr.
+            \param[in] xform Row-major 4x4 transformation matrix. We apply pre-transformation to curve geometry.
+            \param[in] buffers Output buffers.
+            \param[in] indexOffset Offset added to all written indices, e.g., when appending to an existing point buffer.
+        */
+        static void tessellateLinearSweptSphere(const StrandLayout& layout, const int* vertexCountsPerStrand, const float3* controlPoints, const float* widths, const float2* UVs, const glm::mat4& xform, const SweptSphereBuffers& buffers, uint32_t indexOffset = 0);
+
         // Tessellated mesh
 
         struct MeshResult
@@ -70,6 +153,20 @@ namespace Falcor
             std::vector<float2> texCrds;
         };
 
+        /** Caller-provided output buffers for tessellated meshes.
+            The vertex buffers must hold layout.getMeshVertexCount() elements, pFaceVertexCounts layout.getMeshFaceCount() elements,
+            and pFaceVertexIndices three times as many.
+        */
+        struct MeshBuffers
+        {
+            float3* pVertices = nullptr;
+            float3* pNormals = nullptr;
+            float4* pTangents = nullptr;
+            uint32_t* pFaceVertexCounts = nullptr;  ///< Optional, all faces are triangles.
+            uint32_t* pFaceVertexIndices = nullptr;
+            float2* pTexCrds = nullptr;             ///< Optional, only written if UVs are provided.
+        };
+
         /** Tessellate cubic B-splines to a triangular mesh.
             \param[in] strandCount Number of curve strands.
             \param[in] vertexCountsPerStrand Number of control points per strand.
@@ -78,10 +175,34 @@ namespace Falcor
             \param[in] UVs Array of texture coordinates.
             \param[in] subdivPerSegment Number of sub-segments within each cubic bspline segment (defined by 4 control points).
             \param[in] pointCountPerCrossSection Number of points sampled at each cross-section.
-            \return Tessellated mesh.
+            eturn Tessellated mesh.
         */
         static MeshResult convertToMesh(size_t strandCount, const int* vertexCountsPerStrand, const float3* controlPoints, const float* widths, const float2* UVs, uint32_t subdivPerSegment, uint32_t pointCountPerCrossSection);
-        
+
+        /** Tessellate cubic B-splines to a triangular mesh, with optional adaptive subdivision and decimation.
+            \param[in] strandCount Number of curve strands.
+            \param[in] vertexCountsPerStrand Number of control points per strand.
+            \param[in] controlPoints Array of control points.
+            \param[in] widths Array of curve widths, i.e., diameters of swept spheres.
+            \param[in] UVs Array of texture coordinates.
+            \param[in] options Tessellation options.
+            \param[in] pointCountPerCrossSection Number of points sampled at each cross-section.
+            eturn Tessellated mesh.
+        */
+        static MeshResult convertToMesh(size_t strandCount, const int* vertexCountsPerStrand, const float3* controlPoints, const float* widths, const float2* UVs, const TessellationOptions& options, uint32_t pointCountPerCrossSection);
+
+        /** Write a tessellated mesh into caller-provided buffers. Strands are processed in parallel.
+            \param[in] layout Output layout from computeStrandLayout().
+            \param[in] vertexCountsPerStrand Number of control points per strand.
+            \param[in] controlPoints Array of control points.
+            \param[in] widths Array of curve widths, i.e., diameters of swept spheres.
+            \param[in] UVs Array of texture coordinates, or nullptr.
+            \param[in] pointCountPerCrossSection Number of points sampled at each cross-section.
+            \param[in] buffers Output buffers.
+            \param[in] vertexOffset Offset added to all written face vertex indices.
+        */
+        static void tessellateMesh(const StrandLayout& layout, const int* vertexCountsPerStrand, const float3* controlPoints, const float* widths, const float2* UVs, uint32_t pointCountPerCrossSection, const MeshBuffers& buffers, uint32_t vertexOffset = 0);
+
     private:
         CurveTessellation() = default;
         CurveTessellation(const CurveTessellation&) = delete;
@@ -0,0 +1,708 @@
+/***************************************************************************
+ # Copyright (c) 2015-21, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "stdafx.h"
+#include "HostRayTracer.h"
+#include "Utils/NumericRange.h"
+#include "Utils/Timing/CpuTimer.h"
+#include <atomic>
+#include <execution>
+#include <numeric>
+#include <immintrin.h>
+
+namespace Falcor
+{
+    namespace
+    {
+        const uint32_t kLeafSize = 4;               ///< Max primitives per leaf, one per SIMD lane.
+        const uint32_t kBinCount = 16;              ///< Number of SAH bins per axis.
+        const uint32_t kMaxSAHDepth = 48;           ///< Depth after which median splits are used, bounding the traversal stack size.
+        const uint32_t kParallelBuildThreshold = 4096; ///< Min primitive count for building the children of a node in parallel.
+        const uint32_t kStackSize = 256;
+        const size_t kBatchSize = 256;              ///< Rays per task in batched queries.
+
+        /** Binned SAH builder for 4-wide BVHs over a set of primitive bounds.
+            The output is a list of nodes with node 0 as root, and a list of leaves as ranges into the primitive order.
+        */
+        template<typename NodeType>
+        class Bvh4Builder
+        {
+        public:
+            Bvh4Builder(const std::vector<AABB>& primBounds, uint32_t leafFlag, uint32_t invalidChild)
+                : mPrimBounds(primBounds)
+                , mLeafFlag(leafFlag)
+                , mInvalidChild(invalidChild)
+            {
+                const uint32_t primCount = (uint32_t)primBounds.size();
+                mCentroids.resize(primCount);
+                for (uint32_t i = 0; i < primCount; ++i) mCentroids[i] = primBounds[i].center();
+                mOrder.resize(primCount);
+                std::iota(mOrder.begin(), mOrder.end(), 0u);
+
+                // Each internal node has at least two children and each leaf at least one primitive.
+                mNodes.resize(std::max(primCount, 1u));
+                mLeaves.resize(std::max(primCount, 1u));
+
+                Range root = makeRange(0, primCount);
+                mNodeCount = 1;
+                buildNode(0, root, 0);
+
+                mNodes.resize(mNodeCount);
+                mLeaves.resize(mLeafCount);
+            }
+
+            std::vector<NodeType>& getNodes() { return mNodes; }
+            const std::vector<uint2>& getLeaves() const { return mLeaves; }     ///< Leaves as (begin, count) into the primitive order.
+            const std::vector<uint32_t>& getOrder() const { return mOrder; }
+
+        private:
+            struct Range
+            {
+                uint32_t begin;
+                uint32_t end;
+                AABB bounds;
+                AABB centroidBounds;
+                uint32_t count() const { return end - begin; }
+            };
+
+            Range makeRange(uint32_t begin, uint32_t end) const
+            {
+                Range r = { begin, end };
+                for (uint32_t i = begin; i < end; ++i)
+                {
+                    r.bounds.include(mPrimBounds[mOrder[i]]);
+                    r.centroidBounds.include(mCentroids[mOrder[i]]);
+                }
+                return r;
+            }
+
+            /** Split a range in two, using binned SAH on the centroids or a median split as fallback.
+            */
+            void split(const Range& r, uint32_t depth, Range& left, Range& right)
+            {
+                uint32_t mid = r.begin;
+                float3 extent = r.centroidBounds.extent();
+                int axis = extent.x >= extent.y && extent.x >= extent.z ? 0 : (extent.y >= extent.z ? 1 : 2);
+
+                if (depth < kMaxSAHDepth && extent[axis] > 0.f)
+                {
+                    float bestCost = std::numeric_limits<float>::infinity();
+                    int bestAxis = -1;
+                    uint32_t bestBin = 0;
+
+                    for (int a = 0; a < 3; ++a)
+                    {
+                        if (!(extent[a] > 0.f)) continue;
+                        AABB binBounds[kBinCount];
+                        uint32_t binCounts[kBinCount] = {};
+                        float scale = kBinCount / extent[a];
+                        for (uint32_t i = r.begin; i < r.end; ++i)
+                        {
+                            uint32_t b = std::min((uint32_t)((mCentroids[mOrder[i]][a] - r.centroidBounds.minPoint[a]) * scale), kBinCount - 1);
+                            binBounds[b].include(mPrimBounds[mOrder[i]]);
+                            binCounts[b]++;
+                        }
+
+                        // Sweep from the right to get the cost of the right side of each split plane.
+                        float rightArea[kBinCount];
+                        uint32_t rightCount[kBinCount];
+                        AABB acc;
+                        uint32_t count = 0;
+                        for (uint32_t b = kBinCount - 1; b > 0; --b)
+                        {
+                            acc.include(binBounds[b]);
+                            count += binCounts[b];
+                            rightArea[b] = acc.valid() ? acc.area() : 0.f;
+                            rightCount[b] = count;
+                        }
+
+                        acc.invalidate();
+                        count = 0;
+                        for (uint32_t b = 0; b < kBinCount - 1; ++b)
+                        {
+                            acc.include(binBounds[b]);
+                            count += binCounts[b];
+                            if (count == 0 || rightCount[b + 1] == 0) continue;
+                            float cost = acc.area() * count + rightArea[b + 1] * rightCount[b + 1];
+                            if (cost < bestCost)
+                            {
+                                bestCost = cost;
+                                bestAxis = a;
+                                bestBin = b;
+                            }
+                        }
+                    }
+
+                    if (bestAxis >= 0)
+                    {
+                        float scale = kBinCount / extent[bestAxis];
+                        float minValue = r.centroidBounds.minPoint[bestAxis];
+                        auto it = std::partition(mOrder.begin() + r.begin, mOrder.begin() + r.end, [&](uint32_t i)
+                        {
+                            return std::min((uint32_t)((mCentroids[i][bestAxis] - minValue) * scale), kBinCount - 1) <= bestBin;
+                        });
+                        mid = (uint32_t)(it - mOrder.begin());
+                    }
+                }
+
+                // Fall back to a median split if SAH failed to separate the primitives.
+                if (mid == r.begin || mid == r.end)
+                {
+                    mid = r.begin + r.count() / 2;
+                    std::nth_element(mOrder.begin() + r.begin, mOrder.begin() + mid, mOrder.begin() + r.end, [&](uint32_t a, uint32_t b)
+                    {
+                        return mCentroids[a][axis] < mCentroids[b][axis];
+                    });
+                }
+
+                left = makeRange(r.begin, mid);
+                right = makeRange(mid, r.end);
+            }
+
+            uint32_t makeLeaf(const Range& r)
+            {
+                uint32_t leafIndex = mLeafCount++;
+                mLeaves[leafIndex] = uint2(r.begin, r.count());
+                return leafIndex | mLeafFlag;
+            }
+
+            /** Build the node at a given index. The children are created by repeatedly splitting the child with the largest surface area.
+            */
+            void buildNode(uint32_t nodeIndex, const Range& r, uint32_t depth)
+            {
+                Range children[4];
+                uint32_t childCount = 1;
+                children[0] = r;
+
+                while (childCount < 4)
+                {
+                    int best = -1;
+                    float bestArea = -1.f;
+                    for (uint32_t i = 0; i < childCount; ++i)
+                    {
+                        if (children[i].count() <= kLeafSize) continue;
+                        float area = children[i].bounds.area();
+                        if (area > bestArea)
+                        {
+                            bestArea = area;
+                            best = (int)i;
+                        }
+                    }
+                    if (best < 0) break;
+
+                    Range left, right;
+                    split(children[best], depth, left, right);
+                    children[best] = left;
+                    children[childCount++] = right;
+                }
+
+                uint32_t refs[4];
+                auto buildChild = [&](uint32_t i)
+                {
+                    if (children[i].count() <= kLeafSize)
+                    {
+                        refs[i] = makeLeaf(children[i]);
+                    }
+                    else
+                    {
+                        refs[i] = mNodeCount++;
+                        buildNode(refs[i], children[i], depth + 1);
+                    }
+                };
+
+                if (r.count() >= kParallelBuildThreshold)
+                {
+                    auto range = NumericRange<uint32_t>(0, childCount);
+                    std::for_each(std::execution::par, range.begin(), range.end(), buildChild);
+                }
+                else
+                {
+                    for (uint32_t i = 0; i < childCount; ++i) buildChild(i);
+                }
+
+                NodeType& node = mNodes[nodeIndex];
+                for (uint32_t i = 0; i < 4; ++i)
+                {
+                    AABB b = i < childCount && children[i].count() > 0 ? children[i].bounds : AABB();
+                    for (uint32_t a = 0; a < 3; ++a)
+                    {
+                        node.bounds[2 * a][i] = b.minPoint[a];
+                        node.bounds[2 * a + 1][i] = b.maxPoint[a];
+                    }
+                    node.children[i] = i < childCount && children[i].count() > 0 ? refs[i] : mInvalidChild;
+                }
+            }
+
+            const std::vector<AABB>& mPrimBounds;
+            const uint32_t mLeafFlag;
+            const uint32_t mInvalidChild;
+            std::vector<float3> mCentroids;
+            std::vector<uint32_t> mOrder;
+            std::vector<NodeType> mNodes;
+            std::vector<uint2> mLeaves;
+            std::atomic<uint32_t> mNodeCount = 0;
+            std::atomic<uint32_t> mLeafCount = 0;
+        };
+
+        /** Read the object-space triangles of a mesh, either from the scene data (full or compact vertex format) or from the paged geometry store.
+        */
+        void readMeshTriangles(const Scene::SceneData& sceneData, uint32_t meshID, std::vector<float3>& positions, std::vector<uint32_t>& indices)
+        {
+            const MeshDesc& mesh = sceneData.meshDesc[meshID];
+            positions.resize(mesh.vertexCount);
+            if (!sceneData.meshCompactStaticData.empty())
+            {
+                const VertexQuantization& q = sceneData.meshVertexQuantization[meshID];
+                for (uint32_t v = 0; v < mesh.vertexCount; v++) positions[v] = sceneData.meshCompactStaticData[mesh.vbOffset + v].unpackPosition(q);
+            }
+            else
+            {
+                std::vector<PackedStaticVertexData> vertices(mesh.vertexCount);
+                if (sceneData.pGeometryStore) sceneData.pGeometryStore->read(sceneData.meshStaticDataOffset + sizeof(PackedStaticVertexData) * (uint64_t)mesh.vbOffset, sizeof(PackedStaticVertexData) * vertices.size(), vertices.data());
+                else std::copy_n(sceneData.meshStaticData.begin() + mesh.vbOffset, mesh.vertexCount, vertices.begin());
+                for (uint32_t v = 0; v < mesh.vertexCount; v++) positions[v] = vertices[v].position;
+            }
+
+            const uint32_t indexCount = mesh.getTriangleCount() * 3;
+            indices.resize(indexCount);
+            if (mesh.indexCount > 0)
+            {
+                std::vector<uint32_t> words(mesh.use16BitIndices() ? div_round_up(mesh.indexCount, 2u) : mesh.indexCount);
+                if (sceneData.pGeometryStore) sceneData.pGeometryStore->read(sceneData.meshIndexDataOffset + sizeof(uint32_t) * (uint64_t)mesh.ibOffset, sizeof(uint32_t) * words.size(), words.data());
+                else std::copy_n(sceneData.meshIndexData.begin() + mesh.ibOffset, words.size(), words.begin());
+
+                if (mesh.use16BitIndices()) std::copy_n(reinterpret_cast<const uint16_t*>(words.data()), indexCount, indices.begin());
+                else std::copy_n(words.begin(), indexCount, indices.begin());
+            }
+            else
+            {
+                std::iota(indices.begin(), indices.end(), 0u);
+            }
+        }
+
+        std::vector<float4x4> computeGlobalMatrices(const std::vector<Scene::Node>& sceneGraph)
+        {
+            // Parents are always stored before their children.
+            std::vector<float4x4> globalMatrices(sceneGraph.size());
+            for (size_t i = 0; i < sceneGraph.size(); i++)
+            {
+                globalMatrices[i] = sceneGraph[i].transform;
+                if (sceneGraph[i].parent != Scene::kInvalidNode) globalMatrices[i] = globalMatrices[sceneGraph[i].parent] * globalMatrices[i];
+            }
+            return globalMatrices;
+        }
+    }
+
+    /** Per-ray data for SIMD traversal.
+    */
+    struct HostRayTracer::RayData
+    {
+        __m128 origin[3];
+        __m128 dir[3];
+        __m128 invDir[3];
+        uint32_t nearRow[3];    ///< Row in Node::bounds of the near plane per axis.
+        uint32_t farRow[3];
+        float tMin;
+
+        RayData(const float3& o, const float3& d, float tMin_)
+        {
+            for (uint32_t a = 0; a < 3; ++a)
+            {
+                float inv = 1.f / d[a];
+                origin[a] = _mm_set1_ps(o[a]);
+                dir[a] = _mm_set1_ps(d[a]);
+                invDir[a] = _mm_set1_ps(inv);
+                nearRow[a] = 2 * a + (inv < 0.f ? 1 : 0);
+                farRow[a] = 2 * a + (inv < 0.f ? 0 : 1);
+            }
+            tMin = tMin_;
+        }
+
+        /** Intersect the four child boxes of a node.
+            \return Bit mask of children that are hit within [tMin, tMax].
+        */
+        int intersect(const Node& node, float tMax, __m128& tNear) const
+        {
+            __m128 t0x = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.bounds[nearRow[0]]), origin[0]), invDir[0]);
+            __m128 t0y = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.bounds[nearRow[1]]), origin[1]), invDir[1]);
+            __m128 t0z = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.bounds[nearRow[2]]), origin[2]), invDir[2]);
+            __m128 t1x = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.bounds[farRow[0]]), origin[0]), invDir[0]);
+            __m128 t1y = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.bounds[farRow[1]]), origin[1]), invDir[1]);
+            __m128 t1z = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.bounds[farRow[2]]), origin[2]), invDir[2]);
+            tNear = _mm_max_ps(_mm_max_ps(t0x, t0y), _mm_max_ps(t0z, _mm_set1_ps(tMin)));
+            // Scale the far distance to be conservative with respect to rounding errors (Ize, "Robust BVH Ray Traversal").
+            __m128 tFar = _mm_mul_ps(_mm_min_ps(_mm_min_ps(t1x, t1y), _mm_min_ps(t1z, _mm_set1_ps(tMax))), _mm_set1_ps(1.0000004f));
+            return _mm_movemask_ps(_mm_cmple_ps(tNear, tFar));
+        }
+
+        /** Intersect four triangles with the Moller-Trumbore test.
+            \return Bit mask of triangles that are hit within [tMin, tMax], and the hit distances and barycentrics.
+        */
+        int intersect(const TriangleLeaf& leaf, float tMax, __m128& t, __m128& u, __m128& v) const
+        {
+            __m128 e1x = _mm_load_ps(leaf.e1[0]), e1y = _mm_load_ps(leaf.e1[1]), e1z = _mm_load_ps(leaf.e1[2]);
+            __m128 e2x = _mm_load_ps(leaf.e2[0]), e2y = _mm_load_ps(leaf.e2[1]), e2z = _mm_load_ps(leaf.e2[2]);
+
+            // p = d x e2
+            __m128 px = _mm_sub_ps(_mm_mul_ps(dir[1], e2z), _mm_mul_ps(dir[2], e2y));
+            __m128 py = _mm_sub_ps(_mm_mul_ps(dir[2], e2x), _mm_mul_ps(dir[0], e2z));
+            __m128 pz = _mm_sub_ps(_mm_mul_ps(dir[0], e2y), _mm_mul_ps(dir[1], e2x));
+            __m128 det = _mm_add_ps(_mm_add_ps(_mm_mul_ps(e1x, px), _mm_mul_ps(e1y, py)), _mm_mul_ps(e1z, pz));
+            __m128 invDet = _mm_div_ps(_mm_set1_ps(1.f), det);
+
+            // s = o - v0
+            __m128 sx = _mm_sub_ps(origin[0], _mm_load_ps(leaf.v0[0]));
+            __m128 sy = _mm_sub_ps(origin[1], _mm_load_ps(leaf.v0[1]));
+            __m128 sz = _mm_sub_ps(origin[2], _mm_load_ps(leaf.v0[2]));
+            u = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(sx, px), _mm_mul_ps(sy, py)), _mm_mul_ps(sz, pz)), invDet);
+
+            // q = s x e1
+            __m128 qx = _mm_sub_ps(_mm_mul_ps(sy, e1z), _mm_mul_ps(sz, e1y));
+            __m128 qy = _mm_sub_ps(_mm_mul_ps(sz, e1x), _mm_mul_ps(sx, e1z));
+            __m128 qz = _mm_sub_ps(_mm_mul_ps(sx, e1y), _mm_mul_ps(sy, e1x));
+            v = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(dir[0], qx), _mm_mul_ps(dir[1], qy)), _mm_mul_ps(dir[2], qz)), invDet);
+            t = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(e2x, qx), _mm_mul_ps(e2y, qy)), _mm_mul_ps(e2z, qz)), invDet);
+
+            const __m128 zero = _mm_setzero_ps();
+            __m128 valid = _mm_cmpneq_ps(det, zero);
+            valid = _mm_and_ps(valid, _mm_cmpge_ps(u, zero));
+            valid = _mm_and_ps(valid, _mm_cmpge_ps(v, zero));
+            valid = _mm_and_ps(valid, _mm_cmple_ps(_mm_add_ps(u, v), _mm_set1_ps(1.f)));
+            valid = _mm_and_ps(valid, _mm_cmpge_ps(t, _mm_set1_ps(tMin)));
+            valid = _mm_and_ps(valid, _mm_cmple_ps(t, _mm_set1_ps(tMax)));
+            return _mm_movemask_ps(valid);
+        }
+
+        /** Intersect a node and push the children that are hit onto the stack, far to near so that the nearest child is visited first.
+            \return New stack size.
+        */
+        uint32_t pushChildren(const Node& node, float tMax, StackEntry* stack, uint32_t stackSize)
+        {
+            __m128 tNear;
+            int mask = intersect(node, tMax, tNear);
+            if (mask == 0) return stackSize;
+
+            alignas(16) float tNears[4];
+            _mm_store_ps(tNears, tNear);
+
+            StackEntry hits[4];
+            uint32_t hitCount = 0;
+            for (uint32_t i = 0; i < 4; ++i)
+            {
+                if (!(mask & (1 << i)) || node.children[i] == kInvalidChild) continue;
+                StackEntry e = { node.children[i], tNears[i] };
+                uint32_t j = hitCount++;
+                while (j > 0 && hits[j - 1].tNear < e.tNear)
+                {
+                    hits[j] = hits[j - 1];
+                    --j;
+                }
+                hits[j] = e;
+            }
+            assert(stackSize + hitCount <= kStackSize);
+            for (uint32_t i = 0; i < hitCount; ++i) stack[stackSize++] = hits[i];
+            return stackSize;
+        }
+    };
+
+    HostRayTracer::SharedPtr HostRayTracer::create(const Scene::SceneData& sceneData)
+    {
+        auto startTime = CpuTimer::getCurrentTimePoint();
+
+        SharedPtr pTracer = SharedPtr(new HostRayTracer());
+        const uint32_t meshCount = (uint32_t)sceneData.meshDesc.size();
+        pTracer->mBlas.resize(meshCount);
+
+        // Build the mesh BVHs in parallel. Large meshes additionally build their subtrees in parallel.
+        auto range = NumericRange<uint32_t>(0, meshCount);
+        std::for_each(std::execution::par, range.begin(), range.end(), [&](uint32_t meshID)
+        {
+            const MeshDesc& mesh = sceneData.meshDesc[meshID];
+            if (mesh.getTriangleCount() == 0) return;
+
+            std::vector<float3> positions;
+            std::vector<uint32_t> indices;
+            readMeshTriangles(sceneData, meshID, positions, indices);
+
+            const uint32_t triangleCount = mesh.getTriangleCount();
+            std::vector<AABB> triangleBounds(triangleCount);
+            for (uint32_t i = 0; i < triangleCount; ++i)
+            {
+                triangleBounds[i] = AABB(positions[indices[3 * i]]).include(positions[indices[3 * i + 1]]).include(positions[indices[3 * i + 2]]);
+            }
+
+            Bvh4Builder<Node> builder(triangleBounds, kLeafFlag, kInvalidChild);
+            Blas& blas = pTracer->mBlas[meshID];
+            blas.nodes = std::move(builder.getNodes());
+            blas.leaves.resize(builder.getLeaves().size());
+
+            for (size_t l = 0; l < blas.leaves.size(); ++l)
+            {
+                const uint2 leafRange = builder.getLeaves()[l];
+                TriangleLeaf& leaf = blas.leaves[l];
+                std::memset(&leaf, 0, sizeof(leaf));
+                for (uint32_t j = 0; j < kLeafSize; ++j)
+                {
+                    leaf.primitiveIndex[j] = kInvalidChild;
+                    if (j >= leafRange.y) continue;
+
+                    uint32_t triangleIndex = builder.getOrder()[leafRange.x + j];
+                    float3 v0 = positions[indices[3 * triangleIndex]];
+                    float3 e1 = positions[indices[3 * triangleIndex + 1]] - v0;
+                    float3 e2 = positions[indices[3 * triangleIndex + 2]] - v0;
+                    for (uint32_t a = 0; a < 3; ++a)
+                    {
+                        leaf.v0[a][j] = v0[a];
+                        leaf.e1[a][j] = e1[a];
+                        leaf.e2[a][j] = e2[a];
+                    }
+                    leaf.primitiveIndex[j] = triangleIndex;
+                }
+            }
+
+            for (const auto& b : triangleBounds) blas.bounds.include(b);
+        });
+
+        // Setup the instances. The instance index is the global geometry instance ID.
+        pTracer->mInstances.resize(sceneData.meshInstanceData.size());
+        for (size_t i = 0; i < sceneData.meshInstanceData.size(); ++i)
+        {
+            const auto& inst = sceneData.meshInstanceData[i];
+            pTracer->mInstances[i].meshID = inst.meshID;
+            pTracer->mInstances[i].globalMatrixID = inst.globalMatrixID;
+        }
+        pTracer->setInstanceTransforms(computeGlobalMatrices(sceneData.sceneGraph));
+
+        Stats& stats = pTracer->mStats;
+        stats.instanceCount = (uint32_t)pTracer->mInstances.size();
+        for (const auto& blas : pTracer->mBlas)
+        {
+            if (blas.nodes.empty()) continue;
+            stats.meshCount++;
+            stats.nodeCount += blas.nodes.size();
+            stats.memoryInBytes += blas.nodes.size() * sizeof(Node) + blas.leaves.size() * sizeof(TriangleLeaf);
+        }
+        for (const auto& mesh : sceneData.meshDesc) stats.triangleCount += mesh.getTriangleCount();
+        stats.buildTime = CpuTimer::calcDuration(startTime, CpuTimer::getCurrentTimePoint()) * 1e-3;
+
+        logInfo("Built host ray tracing BVH for " + std::to_string(stats.meshCount) + " meshes (" + std::to_string(stats.triangleCount) + " triangles) and "
+            + std::to_string(stats.instanceCount) + " instances in " + std::to_string(stats.buildTime) + " s, using " + formatByteSize(stats.memoryInBytes) + ".");
+
+        return pTracer;
+    }
+
+    void HostRayTracer::setInstanceTransforms(const std::vector<float4x4>& globalMatrices)
+    {
+        std::unique_lock<std::shared_mutex> lock(mTlasMutex);
+        for (auto& inst : mInstances)
+        {
+            if (inst.globalMatrixID >= globalMatrices.size()) throw std::exception("HostRayTracer: Invalid global matrix ID");
+            const float4x4& m = globalMatrices[inst.globalMatrixID];
+            float4x4 inv = glm::inverse(m);
+            for (uint32_t r = 0; r < 3; ++r)
+            {
+                for (uint32_t c = 0; c < 4; ++c) inst.worldToObject[r][c] = inv[c][r]; // glm is column-major
+            }
+            inst.worldBounds = mBlas[inst.meshID].nodes.empty() ? AABB() : mBlas[inst.meshID].bounds.transform(m);
+        }
+        buildTlas();
+    }
+
+    void HostRayTracer::buildTlas()
+    {
+        std::vector<AABB> instanceBounds(mInstances.size());
+        mBounds.invalidate();
+        for (size_t i = 0; i < mInstances.size(); ++i)
+        {
+            instanceBounds[i] = mInstances[i].worldBounds;
+            mBounds.include(instanceBounds[i]);
+        }
+
+        Bvh4Builder<Node> builder(instanceBounds, kLeafFlag, kInvalidChild);
+        mTlasNodes = std::move(builder.getNodes());
+        mTlasLeaves.resize(builder.getLeaves().size());
+        for (size_t l = 0; l < mTlasLeaves.size(); ++l)
+        {
+            const uint2 leafRange = builder.getLeaves()[l];
+            for (uint32_t j = 0; j < kLeafSize; ++j)
+            {
+                mTlasLeaves[l].instanceIndex[j] = j < leafRange.y ? builder.getOrder()[leafRange.x + j] : kInvalidChild;
+            }
+        }
+    }
+
+    template<bool kAnyHit>
+    bool HostRayTracer::traverseBlas(const Blas& blas, const Ray& ray, Hit& hit) const
+    {
+        StackEntry stack[kStackSize];
+        uint32_t stackSize = 0;
+        stack[stackSize++] = { 0, ray.tMin };
+
+        RayData rayData(ray.origin, ray.dir, ray.tMin);
+        float tHit = ray.tMax;
+        bool found = false;
+
+        while (stackSize > 0)
+        {
+            StackEntry entry = stack[--stackSize];
+            if (entry.tNear > tHit) continue;
+
+            if (entry.ref & kLeafFlag)
+            {
+                const TriangleLeaf& leaf = blas.leaves[entry.ref & ~kLeafFlag];
+                __m128 t, u, v;
+                int mask = rayData.intersect(leaf, tHit, t, u, v);
+                if (mask == 0) continue;
+                if (kAnyHit) return true;
+
+                alignas(16) float ts[4], us[4], vs[4];
+                _mm_store_ps(ts, t);
+                _mm_store_ps(us, u);
+                _mm_store_ps(vs, v);
+                for (uint32_t j = 0; j < 4; ++j)
+                {
+                    if ((mask & (1 << j)) && ts[j] <= tHit)
+                    {
+                        tHit = ts[j];
+                        hit.primitiveIndex = leaf.primitiveIndex[j];
+                        hit.barycentrics = float2(us[j], vs[j]);
+                        found = true;
+                    }
+                }
+                continue;
+            }
+
+            stackSize = rayData.pushChildren(blas.nodes[entry.ref], tHit, stack, stackSize);
+        }
+
+        if (found) hit.t = tHit;
+        return found;
+    }
+
+    template<bool kAnyHit>
+    bool HostRayTracer::traverse(const Ray& ray, Hit& hit) const
+    {
+        if (mTlasNodes.empty()) return false;
+
+        StackEntry stack[kStackSize];
+        uint32_t stackSize = 0;
+        stack[stackSize++] = { 0, ray.tMin };
+
+        RayData rayData(ray.origin, ray.dir, ray.tMin);
+        float tHit = ray.tMax;
+        bool found = false;
+
+        while (stackSize > 0)
+        {
+            StackEntry entry = stack[--stackSize];
+            if (entry.tNear > tHit) continue;
+
+            if (entry.ref & kLeafFlag)
+            {
+                const InstanceLeaf& leaf = mTlasLeaves[entry.ref & ~kLeafFlag];
+                for (uint32_t j = 0; j < kLeafSize; ++j)
+                {
+                    uint32_t instanceIndex = leaf.instanceIndex[j];
+                    if (instanceIndex == kInvalidChild) continue;
+                    const Instance& inst = mInstances[instanceIndex];
+                    const Blas& blas = mBlas[inst.meshID];
+                    if (blas.nodes.empty()) continue;
+
+                    // Transform the ray to object space. The ray is not renormalized, so hit distances are unchanged.
+                    const auto& m = inst.worldToObject;
+                    Ray objectRay = ray;
+                    objectRay.tMax = tHit;
+                    for (uint32_t r = 0; r < 3; ++r)
+                    {
+                        objectRay.origin[r] = m[r][0] * ray.origin.x + m[r][1] * ray.origin.y + m[r][2] * ray.origin.z + m[r][3];
+                        objectRay.dir[r] = m[r][0] * ray.dir.x + m[r][1] * ray.dir.y + m[r][2] * ray.dir.z;
+                    }
+
+                    if (traverseBlas<kAnyHit>(blas, objectRay, hit))
+                    {
+                        if (kAnyHit) return true;
+                        tHit = hit.t;
+                        hit.instanceID.index = instanceIndex;
+                        found = true;
+                    }
+                }
+                continue;
+            }
+
+            stackSize = rayData.pushChildren(mTlasNodes[entry.ref], tHit, stack, stackSize);
+        }
+
+        if (found) hit.type = HitType::Triangle;
+        return found;
+    }
+
+    HostRayTracer::Hit HostRayTracer::traceClosestHit(const Ray& ray) const
+    {
+        std::shared_lock<std::shared_mutex> lock(mTlasMutex);
+        Hit hit;
+        traverse<false>(ray, hit);
+        return hit;
+    }
+
+    bool HostRayTracer::traceAnyHit(const Ray& ray) const
+    {
+        std::shared_lock<std::shared_mutex> lock(mTlasMutex);
+        Hit hit;
+        return traverse<true>(ray, hit);
+    }
+
+    void HostRayTracer::traceClosestHit(const Ray* pRays, Hit* pHits, size_t rayCount) const
+    {
+        // The lock is held by the calling thread for the whole batch, the worker threads traverse without locking.
+        std::shared_lock<std::shared_mutex> lock(mTlasMutex);
+        auto range = NumericRange<size_t>(0, div_round_up(rayCount, kBatchSize));
+        std::for_each(std::execution::par, range.begin(), range.end(), [&](size_t batch)
+        {
+            size_t end = std::min(rayCount, (batch + 1) * kBatchSize);
+            for (size_t i = batch * kBatchSize; i < end; ++i)
+            {
+                pHits[i] = Hit();
+                traverse<false>(pRays[i], pHits[i]);
+            }
+        });
+    }
+
+    void HostRayTracer::traceAnyHit(const Ray* pRays, bool* pHit, size_t rayCount) const
+    {
+        std::shared_lock<std::shared_mutex> lock(mTlasMutex);
+        auto range = NumericRange<size_t>(0, div_round_up(rayCount, kBatchSize));
+        std::for_each(std::execution::par, range.begin(), range.end(), [&](size_t batch)
+        {
+            size_t end = std::min(rayCount, (batch + 1) * kBatchSize);
+            for (size_t i = batch * kBatchSize; i < end; ++i)
+            {
+                Hit hit;
+                pHit[i] = traverse<true>(pRays[i], hit);
+            }
+        });
+    }
+}
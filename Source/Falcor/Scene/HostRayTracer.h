@@ -0,0 +1,200 @@
+/***************************************************************************
+ # Copyright (c) 2015-21, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#pragma once
+#include "Scene.h"
+#include "HitInfoType.slang"
+#include <shared_mutex>
+
+namespace Falcor
+{
+    /** CPU ray queries against the triangle meshes of a scene.
+
+        The acceleration structure is two-level like the device acceleration structures built by
+        Scene::buildBlas()/buildTlas(): one BVH per mesh in object space, and one BVH over the mesh instances.
+        All BVHs are 4-wide and built with binned SAH. Node bounds and leaf triangles are stored in SoA layout
+        so that a ray is tested against four boxes or four triangles at once with SSE.
+
+        Hits are reported with the same contents as TriangleHit in HitInfo.slang: the global geometry instance ID,
+        the triangle index within the mesh and the barycentric weights of vertices 1 and 2.
+
+        Limitations:
+        - Only triangle meshes are supported. Curves, SDF grids and custom primitives are ignored.
+        - Displacement and alpha testing are ignored. All triangles are double-sided.
+        - Meshes with vertex animation or skinning use their initial pose. Instance transforms can be updated.
+
+        All trace functions are thread-safe, also while setInstanceTransforms() updates the instance BVH on another thread.
+        Traces share a lock on the instance BVH, which the update holds exclusively.
+    */
+    class dlldecl HostRayTracer
+    {
+    public:
+        using SharedPtr = std::shared_ptr<HostRayTracer>;
+
+        /** Ray description. Same layout as RayDesc.
+        */
+        struct Ray
+        {
+            float3 origin = float3(0.f);
+            float tMin = 0.f;
+            float3 dir = float3(0.f, 0.f, 1.f);
+            float tMax = std::numeric_limits<float>::infinity();
+        };
+
+        /** Ray hit. The fields match TriangleHit.
+        */
+        struct Hit
+        {
+            HitType type = HitType::None;
+            GeometryInstanceID instanceID = {};
+            uint32_t primitiveIndex = 0;
+            float2 barycentrics = float2(0.f);
+            float t = 0.f;                              ///< Hit distance along the ray.
+
+            bool isValid() const { return type != HitType::None; }
+        };
+
+        struct Stats
+        {
+            uint32_t meshCount = 0;                     ///< Number of meshes with a BVH.
+            uint32_t instanceCount = 0;                 ///< Number of mesh instances.
+            uint64_t triangleCount = 0;                 ///< Number of unique triangles.
+            uint64_t nodeCount = 0;                     ///< Number of BVH nodes in all levels.
+            uint64_t memoryInBytes = 0;                 ///< Memory used by the acceleration structure.
+            double buildTime = 0.0;                     ///< Build time in seconds.
+        };
+
+        /** Create the acceleration structure from scene data.
+            Mesh BVHs are built in parallel. The index and vertex data is read from the paged geometry store if present.
+            \param[in] sceneData Scene data, as prepared by SceneBuilder.
+            \return New object, or throws an exception on error.
+        */
+        static SharedPtr create(const Scene::SceneData& sceneData);
+
+        /** Find the closest hit along a ray.
+        */
+        Hit traceClosestHit(const Ray& ray) const;
+
+        /** Check if a ray hits anything in [tMin, tMax].
+        */
+        bool traceAnyHit(const Ray& ray) const;
+
+        /** Find the closest hits for a batch of rays. The rays are traced in parallel.
+            \param[in] pRays Rays.
+            \param[out] pHits Closest hit per ray.
+            \param[in] rayCount Number of rays.
+        */
+        void traceClosestHit(const Ray* pRays, Hit* pHits, size_t rayCount) const;
+
+        /** Check visibility for a batch of rays. The rays are traced in parallel.
+            \param[in] pRays Rays.
+            \param[out] pHit True for rays that hit anything in [tMin, tMax].
+            \param[in] rayCount Number of rays.
+        */
+        void traceAnyHit(const Ray* pRays, bool* pHit, size_t rayCount) const;
+
+        /** Update the instance transforms and rebuild the instance BVH. The mesh BVHs are kept.
+            Traces on other threads wait for the update to finish.
+            \param[in] globalMatrices Global matrix per scene graph node, as computed by the AnimationController.
+        */
+        void setInstanceTransforms(const std::vector<float4x4>& globalMatrices);
+
+        /** Get the world-space bounds of all instances.
+        */
+        AABB getBounds() const { std::shared_lock<std::shared_mutex> lock(mTlasMutex); return mBounds; }
+
+        const Stats& getStats() const { return mStats; }
+
+    private:
+        HostRayTracer() = default;
+
+        static const uint32_t kLeafFlag = 0x80000000;
+        static const uint32_t kInvalidChild = 0xffffffff;
+
+        /** 4-wide BVH node.
+        */
+        struct alignas(16) Node
+        {
+            float bounds[6][4];                         ///< Child bounds in SoA layout: min x, max x, min y, max y, min z, max z.
+            uint32_t children[4];                       ///< Child node index, leaf index with kLeafFlag set, or kInvalidChild.
+        };
+
+        /** Leaf with up to four triangles in SoA layout, stored as a vertex and two edges for the intersection test.
+        */
+        struct alignas(16) TriangleLeaf
+        {
+            float v0[3][4];
+            float e1[3][4];
+            float e2[3][4];
+            uint32_t primitiveIndex[4];                 ///< Triangle index within the mesh. Unused slots have degenerate triangles.
+        };
+
+        /** Leaf with up to four instances.
+        */
+        struct InstanceLeaf
+        {
+            uint32_t instanceIndex[4];                  ///< Instance index, or kInvalidChild for unused slots.
+        };
+
+        struct Blas
+        {
+            std::vector<Node> nodes;
+            std::vector<TriangleLeaf> leaves;
+            AABB bounds;
+        };
+
+        struct Instance
+        {
+            uint32_t meshID;
+            uint32_t globalMatrixID;
+            float worldToObject[3][4];                  ///< Affine part of the inverse instance transform (row-major).
+            AABB worldBounds;
+        };
+
+        struct StackEntry
+        {
+            uint32_t ref;                               ///< Node index, or leaf index with kLeafFlag set.
+            float tNear;                                ///< Entry distance of the node bounds.
+        };
+
+        struct RayData;
+
+        template<bool kAnyHit>
+        bool traverseBlas(const Blas& blas, const Ray& ray, Hit& hit) const;
+        template<bool kAnyHit>
+        bool traverse(const Ray& ray, Hit& hit) const;
+        void buildTlas();
+
+        std::vector<Blas> mBlas;                        ///< BVH per mesh, indexed by mesh ID. Empty for meshes without triangles.
+        std::vector<Instance> mInstances;               ///< Instances, indexed by geometry instance ID.
+        std::vector<Node> mTlasNodes;
+        std::vector<InstanceLeaf> mTlasLeaves;
+        AABB mBounds;
+        mutable std::shared_mutex mTlasMutex;           ///< Protects the instances, the instance BVH and the bounds.
+        Stats mStats;
+    };
+}
@@ -33,9 +33,11 @@
 #include "AssimpImporter.h"
 #include "Utils/StringUtils.h"
 #include "Utils/Timing/TimeReport.h"
+#include "Utils/Timing/TraceProfiler.h"
 #include "Core/API/Device.h"
 #include "Scene/SceneBuilder.h"
 
+#include <atomic>
 #include <execution>
 
 namespace Falcor
@@ -217,60 +219,44 @@ namespace Falcor
             resetTime(pAiNode->mScalingKeys, pAiNode->mNumScalingKeys);
         }
 
-        void createAnimation(ImporterData& data, const aiAnimation* pAiAnim, ImportMode importMode)
+        /** Converts the keys of an animation channel to a list of keyframes.
+            Keys of the position, rotation and scaling tracks with the same time are merged into a single keyframe.
+        */
+        std::vector<Animation::Keyframe> convertAnimationChannel(aiNodeAnim* pAiNode, double ticksPerSecond)
         {
-            assert(pAiAnim->mNumMeshChannels == 0);
-            double duration = pAiAnim->mDuration;
-            double ticksPerSecond = pAiAnim->mTicksPerSecond ? pAiAnim->mTicksPerSecond : 25;
-            // The GLTF2 importer in Assimp has a bug where duration and keyframe times are loaded as milliseconds instead of ticks.
-            // We can fix this by using a fixed ticksPerSecond value of 1000.
-            if (importMode == ImportMode::GLTF2) ticksPerSecond = 1000.0;
-            double durationInSeconds = duration / ticksPerSecond;
-
-            for (uint32_t i = 0; i < pAiAnim->mNumChannels; i++)
-            {
-                aiNodeAnim* pAiNode = pAiAnim->mChannels[i];
-                resetNegativeKeyframeTimes(pAiNode);
+            resetNegativeKeyframeTimes(pAiNode);
 
-                std::vector<Animation::SharedPtr> animations;
-                for (uint32_t i = 0; i < data.getNodeInstanceCount(pAiNode->mNodeName.C_Str()); i++)
-                {
-                    Animation::SharedPtr pAnimation = Animation::create(
-                        std::string(pAiNode->mNodeName.C_Str()) + "." + std::to_string(i),
-                        data.getFalcorNodeID(pAiNode->mNodeName.C_Str(), i),
-                        durationInSeconds
-                    );
-                    animations.push_back(pAnimation);
-                    data.builder.addAnimation(pAnimation);
-                }
+            std::vector<Animation::Keyframe> keyframes;
+            keyframes.reserve(std::max({ pAiNode->mNumPositionKeys, pAiNode->mNumRotationKeys, pAiNode->mNumScalingKeys }));
 
-                uint32_t pos = 0, rot = 0, scale = 0;
-                Animation::Keyframe keyframe;
-                bool done = false;
+            uint32_t pos = 0, rot = 0, scale = 0;
+            Animation::Keyframe keyframe;
+            bool done = false;
 
-                auto nextKeyTime = [&]()
-                {
-                    double time = -std::numeric_limits<double>::max();
-                    if (pos < pAiNode->mNumPositionKeys) time = std::max(time, pAiNode->mPositionKeys[pos].mTime);
-                    if (rot < pAiNode->mNumRotationKeys) time = std::max(time, pAiNode->mRotationKeys[rot].mTime);
-                    if (scale < pAiNode->mNumScalingKeys) time = std::max(time, pAiNode->mScalingKeys[scale].mTime);
-                    assert(time != -std::numeric_limits<double>::max());
-                    return time;
-                };
-
-                while (!done)
-                {
-                    double time = nextKeyTime();
-                    assert(time == 0 || (time / ticksPerSecond) > keyframe.time);
-                    keyframe.time = time / ticksPerSecond;
-
-                    // Note the order of the logical-and, we don't want to short-circuit the function calls
-                    done = parseAnimationChannel(pAiNode->mPositionKeys, pAiNode->mNumPositionKeys, time, pos, keyframe.translation);
-                    done = parseAnimationChannel(pAiNode->mRotationKeys, pAiNode->mNumRotationKeys, time, rot, keyframe.rotation) && done;
-                    done = parseAnimationChannel(pAiNode->mScalingKeys, pAiNode->mNumScalingKeys, time, scale, keyframe.scaling) && done;
-                    for(auto pAnimation : animations) pAnimation->addKeyframe(keyframe);
-                }
+            auto nextKeyTime = [&]()
+            {
+                double time = -std::numeric_limits<double>::max();
+                if (pos < pAiNode->mNumPositionKeys) time = std::max(time, pAiNode->mPositionKeys[pos].mTime);
+                if (rot < pAiNode->mNumRotationKeys) time = std::max(time, pAiNode->mRotationKeys[rot].mTime);
+                if (scale < pAiNode->mNumScalingKeys) time = std::max(time, pAiNode->mScalingKeys[scale].mTime);
+                assert(time != -std::numeric_limits<double>::max());
+                return time;
+            };
+
+            while (!done)
+            {
+                double time = nextKeyTime();
+                assert(time == 0 || (time / ticksPerSecond) > keyframe.time);
+                keyframe.time = time / ticksPerSecond;
+
+                // Note the order of the logical-and, we don't want to short-circuit the function calls
+                done = parseAnimationChannel(pAiNode->mPositionKeys, pAiNode->mNumPositionKeys, time, pos, keyframe.translation);
+                done = parseAnimationChannel(pAiNode->mRotationKeys, pAiNode->mNumRotationKeys, time, rot, keyframe.rotation) && done;
+                done = parseAnimationChannel(pAiNode->mScalingKeys, pAiNode->mNumScalingKeys, time, scale, keyframe.scaling) && done;
+                keyframes.push_back(keyframe);
             }
+
+            return keyframes;
         }
 
         bool createCameras(ImporterData& data, ImportMode importMode)
@@ -402,9 +388,51 @@ namespace Falcor
 
         bool createAnimations(ImporterData& data, ImportMode importMode)
         {
+            // Gather the channels of all animations.
+            struct Channel
+            {
+                aiNodeAnim* pAiNode;
+                double ticksPerSecond;
+                double durationInSeconds;
+            };
+            std::vector<Channel> channels;
+
             for (uint32_t i = 0; i < data.pScene->mNumAnimations; i++)
             {
-                createAnimation(data, data.pScene->mAnimations[i], importMode);
+                const aiAnimation* pAiAnim = data.pScene->mAnimations[i];
+                assert(pAiAnim->mNumMeshChannels == 0);
+                double duration = pAiAnim->mDuration;
+                double ticksPerSecond = pAiAnim->mTicksPerSecond ? pAiAnim->mTicksPerSecond : 25;
+                // The GLTF2 importer in Assimp has a bug where duration and keyframe times are loaded as milliseconds instead of ticks.
+                // We can fix this by using a fixed ticksPerSecond value of 1000.
+                if (importMode == ImportMode::GLTF2) ticksPerSecond = 1000.0;
+                double durationInSeconds = duration / ticksPerSecond;
+
+                for (uint32_t j = 0; j < pAiAnim->mNumChannels; j++) channels.push_back({ pAiAnim->mChannels[j], ticksPerSecond, durationInSeconds });
+            }
+
+            // Convert the channels in parallel. There is one animation per instance of the animated node.
+            std::vector<std::vector<Animation::SharedPtr>> animations(channels.size());
+            auto range = NumericRange<size_t>(0, channels.size());
+            std::for_each(std::execution::par, range.begin(), range.end(), [&](size_t i)
+            {
+                TRACE_ZONE("AssimpImporter::convertAnimationChannel");
+                const Channel& channel = channels[i];
+                const std::string nodeName = channel.pAiNode->mNodeName.C_Str();
+                const std::vector<Animation::Keyframe> keyframes = convertAnimationChannel(channel.pAiNode, channel.ticksPerSecond);
+
+                for (uint32_t j = 0; j < data.getNodeInstanceCount(nodeName); j++)
+                {
+                    Animation::SharedPtr pAnimation = Animation::create(nodeName + "." + std::to_string(j), data.getFalcorNodeID(nodeName, j), channel.durationInSeconds);
+                    for (const auto& keyframe : keyframes) pAnimation->addKeyframe(keyframe);
+                    animations[i].push_back(pAnimation);
+                }
+            });
+
+            // Add the animations sequentially to retain a deterministic order.
+            for (const auto& channelAnimations : animations)
+            {
+                for (const auto& pAnimation : channelAnimations) data.builder.addAnimation(pAnimation);
             }
             return true;
         }
@@ -457,53 +485,93 @@ namespace Falcor
             weights.resize(vertexCount);
             ids.resize(vertexCount);
 
-            std::fill(weights.begin(), weights.end(), float4(0.f));
-            std::fill(ids.begin(), ids.end(), uint4(Scene::kInvalidBone));
-
+            // Assimp stores the weights per bone, each holding the IDs of the vertices it affects.
+            // We transpose this into a list of influences per vertex. The influences are counted and scattered
+            // in parallel over the bones using atomics, so the order within a vertex is arbitrary at this point.
+            std::vector<uint32_t> falcorBoneIDs(pAiMesh->mNumBones);
             for (uint32_t bone = 0; bone < pAiMesh->mNumBones; bone++)
             {
                 const aiBone* pAiBone = pAiMesh->mBones[bone];
                 assert(data.getNodeInstanceCount(pAiBone->mName.C_Str()) == 1);
-                uint32_t aiBoneID = data.getFalcorNodeID(pAiBone->mName.C_Str(), 0);
+                falcorBoneIDs[bone] = data.getFalcorNodeID(pAiBone->mName.C_Str(), 0);
+            }
 
-                // The way Assimp works, the weights holds the IDs of the vertices it affects.
-                // We loop over all the weights, initializing the vertices data along the way
+            std::vector<std::atomic<uint32_t>> counters(vertexCount);
+            auto boneRange = NumericRange<uint32_t>(0, pAiMesh->mNumBones);
+            std::for_each(std::execution::par, boneRange.begin(), boneRange.end(), [&](uint32_t bone)
+            {
+                const aiBone* pAiBone = pAiMesh->mBones[bone];
                 for (uint32_t weightID = 0; weightID < pAiBone->mNumWeights; weightID++)
                 {
-                    // Get the vertex the current weight affects
+                    // Skip zero weights
                     const aiVertexWeight& aiWeight = pAiBone->mWeights[weightID];
+                    if (aiWeight.mWeight != 0.f) counters[aiWeight.mVertexId].fetch_add(1, std::memory_order_relaxed);
+                }
+            });
 
-                    // Skip zero weights
+            std::vector<uint32_t> offsets(vertexCount + 1, 0);
+            for (uint32_t i = 0; i < vertexCount; i++)
+            {
+                offsets[i + 1] = offsets[i] + counters[i].load(std::memory_order_relaxed);
+                counters[i].store(offsets[i], std::memory_order_relaxed);
+            }
+
+            struct Influence
+            {
+                uint32_t bone;  ///< Bone index in the Assimp mesh.
+                float weight;
+            };
+            std::vector<Influence> influences(offsets[vertexCount]);
+            std::for_each(std::execution::par, boneRange.begin(), boneRange.end(), [&](uint32_t bone)
+            {
+                const aiBone* pAiBone = pAiMesh->mBones[bone];
+                for (uint32_t weightID = 0; weightID < pAiBone->mNumWeights; weightID++)
+                {
+                    const aiVertexWeight& aiWeight = pAiBone->mWeights[weightID];
                     if (aiWeight.mWeight == 0.f) continue;
+                    uint32_t slot = counters[aiWeight.mVertexId].fetch_add(1, std::memory_order_relaxed);
+                    influences[slot] = { bone, aiWeight.mWeight };
+                }
+            });
 
-                    // Get the address of the Bone ID and weight for the current vertex
-                    uint4& vertexIds = ids[aiWeight.mVertexId];
-                    float4& vertexWeights = weights[aiWeight.mVertexId];
+            // Keep the kMaxBonesPerVertex largest influences of each vertex. Ties are broken by the bone index
+            // and the kept influences are stored in bone order, so the result doesn't depend on the scatter order.
+            // Vertices with at most kMaxBonesPerVertex influences get the same result as assigning them in bone order.
+            std::atomic<uint32_t> truncatedCount{ 0 };
+            auto vertexRange = NumericRange<uint32_t>(0, vertexCount);
+            std::for_each(std::execution::par, vertexRange.begin(), vertexRange.end(), [&](uint32_t i)
+            {
+                auto first = influences.begin() + offsets[i];
+                auto last = influences.begin() + offsets[i + 1];
+                auto byWeight = [](const Influence& a, const Influence& b) { return a.weight > b.weight || (a.weight == b.weight && a.bone < b.bone); };
+                auto byBone = [](const Influence& a, const Influence& b) { return a.bone < b.bone; };
 
-                    // Find the next unused slot in the bone array of the vertex, and initialize it with the current value
-                    bool emptySlotFound = false;
-                    for (uint32_t j = 0; j < Scene::kMaxBonesPerVertex; j++)
-                    {
-                        if (vertexIds[j] == Scene::kInvalidBone)
-                        {
-                            vertexIds[j] = aiBoneID;
-                            vertexWeights[j] = aiWeight.mWeight;
-                            emptySlotFound = true;
-                            break;
-                        }
-                    }
+                if (last - first > (ptrdiff_t)Scene::kMaxBonesPerVertex)
+                {
+                    std::nth_element(first, first + Scene::kMaxBonesPerVertex - 1, last, byWeight);
+                    last = first + Scene::kMaxBonesPerVertex;
+                    truncatedCount.fetch_add(1, std::memory_order_relaxed);
+                }
+                std::sort(first, last, byBone);
 
-                    if (emptySlotFound == false) logError("One of the vertices has too many bones attached to it. If you'll continue, this bone will be ignored and the animation might not look correct");
+                uint4 vertexIds = uint4(Scene::kInvalidBone);
+                float4 vertexWeights = float4(0.f);
+                float sum = 0.f;
+                for (uint32_t j = 0; first + j != last; j++)
+                {
+                    vertexIds[j] = falcorBoneIDs[first[j].bone];
+                    vertexWeights[j] = first[j].weight;
+                    sum += first[j].weight;
                 }
-            }
 
-            // Now we need to normalize the weights for each vertex, since in some models the sum is larger than 1
-            for (uint32_t i = 0; i < vertexCount; i++)
+                // Normalize the weights, since in some models the sum is larger than 1
+                ids[i] = vertexIds;
+                weights[i] = sum > 0.f ? vertexWeights / sum : vertexWeights;
+            });
+
+            if (truncatedCount > 0)
             {
-                float4& w = weights[i];
-                float f = 0;
-                for (uint32_t j = 0; j < Scene::kMaxBonesPerVertex; j++) f += w[j];
-                w /= f;
+                logWarning("Mesh '" + std::string(pAiMesh->mName.C_Str()) + "' has " + std::to_string(truncatedCount.load()) + " vertices with more than " + std::to_string(Scene::kMaxBonesPerVertex) + " bones attached. Only the most influential bones are kept and the animation might not look correct.");
             }
         }
 
@@ -518,6 +586,7 @@ namespace Falcor
             std::vector<SceneBuilder::ProcessedMesh> processedMeshes(meshCount);
             auto range = NumericRange<uint32_t>(0, meshCount);
             std::for_each(std::execution::par, range.begin(), range.end(), [&] (uint32_t i) {
+                TRACE_ZONE("AssimpImporter::processMesh");
                 const aiMesh* pAiMesh = pScene->mMeshes[i];
                 const uint32_t perFaceIndexCount = pAiMesh->mFaces[0].mNumIndices;
 
@@ -591,11 +660,13 @@ namespace Falcor
             // Add meshes to the scene.
             // We retain a deterministic order of the meshes in the global scene buffer by adding
             // them sequentially after being processed in parallel.
+            // Each processed mesh is released once added, so that out-of-core geometry doesn't keep a second copy in memory.
             uint32_t i = 0;
-            for (const auto& mesh : processedMeshes)
+            for (auto& mesh : processedMeshes)
             {
                 uint32_t meshID = data.builder.addProcessedMesh(mesh);
                 data.meshMap[i++] = meshID;
+                mesh = {};
             }
         }
 
@@ -733,8 +804,17 @@ namespace Falcor
             }
         }
 
-        void loadTextures(ImporterData& data, const aiMaterial* pAiMaterial, const std::string& folder, const Material::SharedPtr& pMaterial, ImportMode importMode)
+        struct TextureRequest
         {
+            Material::TextureSlot slot;
+            std::string filename;
+        };
+
+        /** Finds the textures of a material. The textures are loaded later by issuing the returned requests to the scene builder.
+        */
+        std::vector<TextureRequest> findTextures(const aiMaterial* pAiMaterial, const std::string& folder, ImportMode importMode)
+        {
+            std::vector<TextureRequest> requests;
             const auto& textureMappings = kTextureMappings[int(importMode)];
 
             for (const auto& source : textureMappings)
@@ -752,13 +832,15 @@ namespace Falcor
                     continue;
                 }
 
-                // Load the texture
-                std::string filename = canonicalizeFilename(folder + '/' + path);
-                data.builder.loadMaterialTexture(pMaterial, source.targetType, filename);
+                requests.push_back({ source.targetType, canonicalizeFilename(folder + '/' + path) });
             }
+            return requests;
         }
 
-        Material::SharedPtr createMaterial(ImporterData& data, const aiMaterial* pAiMaterial, const std::string& folder, ImportMode importMode)
+        /** Creates a material. This does not modify the scene builder and can be called from multiple threads.
+            \param[out] textureRequests Textures to load for the material.
+        */
+        Material::SharedPtr createMaterial(const ImporterData& data, const aiMaterial* pAiMaterial, const std::string& folder, ImportMode importMode, std::vector<TextureRequest>& textureRequests)
         {
             aiString name;
             pAiMaterial->Get(AI_MATKEY_NAME, name);
@@ -784,8 +866,8 @@ namespace Falcor
             // Create an instance of the standard material. All materials are assumed to be of this type.
             StandardMaterial::SharedPtr pMaterial = StandardMaterial::create(nameStr, shadingModel);
 
-            // Load textures. Note that loading is affected by the current shading model.
-            loadTextures(data, pAiMaterial, folder, pMaterial, importMode);
+            // Find textures. Note that loading is affected by the current shading model.
+            textureRequests = findTextures(pAiMaterial, folder, importMode);
 
             // Opacity
             float opacity = 1.f;
@@ -903,16 +985,27 @@ namespace Falcor
 
         bool createAllMaterials(ImporterData& data, const std::string& modelFolder, ImportMode importMode)
         {
-            for (uint32_t i = 0; i < data.pScene->mNumMaterials; i++)
+            // Parse the materials in parallel.
+            const uint32_t materialCount = data.pScene->mNumMaterials;
+            std::vector<Material::SharedPtr> materials(materialCount);
+            std::vector<std::vector<TextureRequest>> textureRequests(materialCount);
+            auto range = NumericRange<uint32_t>(0, materialCount);
+            std::for_each(std::execution::par, range.begin(), range.end(), [&](uint32_t i)
+            {
+                TRACE_ZONE("AssimpImporter::createMaterial");
+                materials[i] = createMaterial(data, data.pScene->mMaterials[i], modelFolder, importMode, textureRequests[i]);
+            });
+
+            // Issue the texture requests in material order. The textures are loaded asynchronously while the rest of the scene is imported.
+            for (uint32_t i = 0; i < materialCount; i++)
             {
-                const aiMaterial* pAiMaterial = data.pScene->mMaterials[i];
-                auto pMaterial = createMaterial(data, pAiMaterial, modelFolder, importMode);
-                if (pMaterial == nullptr)
+                if (materials[i] == nullptr)
                 {
                     logError("Can't allocate memory for material");
                     return false;
                 }
-                data.materialMap[i] = pMaterial;
+                for (const auto& request : textureRequests[i]) data.builder.loadMaterialTexture(materials[i], request.slot, request.filename);
+                data.materialMap[i] = materials[i];
             }
 
             return true;
@@ -1032,7 +1125,11 @@ namespace Falcor
         Assimp::Importer importer;
         importer.SetPropertyInteger(AI_CONFIG_PP_RVC_FLAGS, removeFlags);
 
-        const aiScene* pScene = importer.ReadFile(fullpath, assimpFlags);
+        const aiScene* pScene = nullptr;
+        {
+            TRACE_ZONE("AssimpImporter::readFile");
+            pScene = importer.ReadFile(fullpath, assimpFlags);
+        }
         timeReport.measure("Loading asset file");
 
         if (pScene == nullptr)
@@ -1043,9 +1140,6 @@ namespace Falcor
             return false;
         }
 
-        verifyScene(pScene);
-        timeReport.measure("Verifying scene");
-
         // Extract the folder name
         auto last = fullpath.find_last_of("/\\");
         std::string modelFolder = fullpath.substr(0, last);
@@ -1057,44 +1151,64 @@ namespace Falcor
         if (hasSuffix(filename, ".obj", false)) importMode = ImportMode::OBJ;
         if (hasSuffix(filename, ".gltf", false) || hasSuffix(filename, ".glb", false)) importMode = ImportMode::GLTF2;
 
-        if (createAllMaterials(data, modelFolder, importMode) == false)
+        // Create the materials first, so that the textures are loading in the background while the rest of the scene is imported.
         {
-            logError("Can't create materials for model " + filename);
-            return false;
+            TRACE_ZONE("AssimpImporter::createMaterials");
+            if (createAllMaterials(data, modelFolder, importMode) == false)
+            {
+                logError("Can't create materials for model " + filename);
+                return false;
+            }
         }
         timeReport.measure("Creating materials");
 
-        if (createSceneGraph(data) == false)
         {
-            logError("Can't create draw lists for model " + filename);
-            return false;
+            TRACE_ZONE("AssimpImporter::verifyScene");
+            verifyScene(pScene);
         }
-        timeReport.measure("Creating scene graph");
+        timeReport.measure("Verifying scene");
 
-        createMeshes(data);
-        addMeshInstances(data, data.pScene->mRootNode);
-        timeReport.measure("Creating meshes");
+        {
+            TRACE_ZONE("AssimpImporter::createSceneGraph");
+            if (createSceneGraph(data) == false)
+            {
+                logError("Can't create draw lists for model " + filename);
+                return false;
+            }
+        }
+        timeReport.measure("Creating scene graph");
 
-        if (createAnimations(data, importMode) == false)
         {
-            logError("Can't create animations for model " + filename);
-            return false;
+            TRACE_ZONE("AssimpImporter::createMeshes");
+            createMeshes(data);
+            addMeshInstances(data, data.pScene->mRootNode);
         }
-        timeReport.measure("Creating animations");
+        timeReport.measure("Creating meshes");
 
-        if (createCameras(data, importMode) == false)
         {
-            logError("Can't create a camera for model " + filename);
-            return false;
+            TRACE_ZONE("AssimpImporter::createAnimations");
+            if (createAnimations(data, importMode) == false)
+            {
+                logError("Can't create animations for model " + filename);
+                return false;
+            }
         }
-        timeReport.measure("Creating cameras");
+        timeReport.measure("Creating animations");
 
-        if (createLights(data) == false)
         {
-            logError("Can't create a lights for model " + filename);
-            return false;
+            TRACE_ZONE("AssimpImporter::createCamerasAndLights");
+            if (createCameras(data, importMode) == false)
+            {
+                logError("Can't create a camera for model " + filename);
+                return false;
+            }
+            if (createLights(data) == false)
+            {
+                logError("Can't create a lights for model " + filename);
+                return false;
+            }
         }
-        timeReport.measure("Creating lights");
+        timeReport.measure("Creating cameras and lights");
 
         timeReport.printToLog();
 
@@ -0,0 +1,404 @@
+/***************************************************************************
+ # Copyright (c) 2015-21, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "stdafx.h"
+#include "EmissiveIntegrator.h"
+#include "Utils/NumericRange.h"
+#include <execution>
+
+namespace Falcor
+{
+    namespace
+    {
+        int64_t floorMod(int64_t a, int64_t b)
+        {
+            int64_t r = a % b;
+            return r < 0 ? r + b : r;
+        }
+
+        /** Resolve a texel coordinate using an address mode.
+            \return Texel coordinate in [0, size), or -1 for texels in the border.
+        */
+        int64_t resolveTexel(int64_t i, int64_t size, Sampler::AddressMode mode)
+        {
+            switch (mode)
+            {
+            case Sampler::AddressMode::Wrap:
+                return floorMod(i, size);
+            case Sampler::AddressMode::Mirror:
+            {
+                int64_t p = floorMod(i, 2 * size);
+                return p < size ? p : 2 * size - 1 - p;
+            }
+            case Sampler::AddressMode::Clamp:
+                return std::clamp(i, int64_t(0), size - 1);
+            case Sampler::AddressMode::Border:
+                return i < 0 || i >= size ? -1 : i;
+            case Sampler::AddressMode::MirrorOnce:
+                return std::min(i < 0 ? -i - 1 : i, size - 1);
+            default:
+                should_not_get_here();
+                return 0;
+            }
+        }
+
+        /** Resolve a range of texel coordinates [i, i + blockSize) to a contiguous range of texels inside the texture.
+            Mirrored ranges are returned by their first texel in memory order, as they have the same sum.
+            \return First texel of the range, or -1 if the range is not contiguous in the texture (e.g., it wraps around or is clamped).
+        */
+        int64_t resolveBlock(int64_t i, int64_t blockSize, int64_t size, Sampler::AddressMode mode)
+        {
+            switch (mode)
+            {
+            case Sampler::AddressMode::Wrap:
+            {
+                int64_t t = floorMod(i, size);
+                return t + blockSize <= size ? t : -1;
+            }
+            case Sampler::AddressMode::Mirror:
+            {
+                int64_t p = floorMod(i, 2 * size);
+                if (p + blockSize <= size) return p;
+                if (p >= size && p + blockSize <= 2 * size) return 2 * size - p - blockSize;
+                return -1;
+            }
+            case Sampler::AddressMode::Clamp:
+            case Sampler::AddressMode::Border:
+                return i >= 0 && i + blockSize <= size ? i : -1;
+            case Sampler::AddressMode::MirrorOnce:
+                if (i >= 0) return i + blockSize <= size ? i : -1;
+                if (i + blockSize <= 0 && -i <= size) return -(i + blockSize);
+                return -1;
+            default:
+                should_not_get_here();
+                return -1;
+            }
+        }
+
+        // Host versions of the polygon clipping in Utils/Geometry/GeometryHelpers.slang.
+
+        int classifyPointPlane2D(const float2 p, const uint32_t axis, const float sign, const float c, const float planeThickness = 1e-6f)
+        {
+            float d = sign * (p[axis] - c);
+            if (d > planeThickness) return 1;
+            else if (d < -planeThickness) return -1;
+            else return 0;
+        }
+
+        void clipPolygonPlane2D(float2 p[7], uint32_t& n, const uint32_t axis, const float sign, const float c)
+        {
+            if (n <= 1)
+            {
+                n = 0;
+                return;
+            }
+
+            float2 q[7];
+            uint32_t k = 0;
+            bool fullyOnPlane = true;
+
+            float2 p1 = p[n - 1];
+            int d1 = classifyPointPlane2D(p1, axis, sign, c);
+
+            for (uint32_t i = 0; i < n; i++)
+            {
+                float2 p2 = p[i];
+                int d2 = classifyPointPlane2D(p2, axis, sign, c);
+
+                if (d2 == 0)
+                {
+                    if (d1 != 0) q[k++] = p2;
+                }
+                else
+                {
+                    fullyOnPlane = false;
+
+                    if (d1 == 0)
+                    {
+                        if (k == 0 || q[k - 1] != p1) q[k++] = p1;
+                    }
+                    else if (d1 != d2)
+                    {
+                        float alpha = (p2[axis] - c) / (p2[axis] - p1[axis]);
+                        q[k++] = glm::mix(p2, p1, alpha);
+                    }
+
+                    if (d2 > 0) q[k++] = p2;
+                }
+
+                p1 = p2;
+                d1 = d2;
+            }
+
+            if (fullyOnPlane) return;
+
+            n = k;
+            for (uint32_t i = 0; i < k; i++) p[i] = q[i];
+        }
+
+        float computeClippedTriangleArea2D(const float2 pos[3], const float2 minPoint, const float2 maxPoint)
+        {
+            uint32_t n = 3;
+            float2 p[7] = {};
+            p[0] = pos[0];
+            p[1] = pos[1];
+            p[2] = pos[2];
+
+            clipPolygonPlane2D(p, n, 0, +1.f, minPoint.x);
+            clipPolygonPlane2D(p, n, 0, -1.f, maxPoint.x);
+            clipPolygonPlane2D(p, n, 1, +1.f, minPoint.y);
+            clipPolygonPlane2D(p, n, 1, -1.f, maxPoint.y);
+
+            if (n < 3) return 0.f;
+
+            float area = 0.f;
+            for (uint32_t i = 0; i < n; i++)
+            {
+                uint32_t j = i + 1 < n ? i + 1 : 0;
+                area += p[i].x * p[j].y - p[i].y * p[j].x;
+            }
+            return 0.5f * area;
+        }
+
+        /** Traverses a quadtree of texel blocks over the triangle's bounding box in texture space.
+        */
+        class TriangleIntegrator
+        {
+        public:
+            TriangleIntegrator(const EmissiveIntegrator::TexelData& texels, const float2 pos[3], int64_t offsetX, int64_t offsetY, bool useBlockSums)
+                : mTexels(texels)
+                , mOffsetX(offsetX)
+                , mOffsetY(offsetY)
+                , mUseBlockSums(useBlockSums)
+            {
+                const float signedArea = (pos[1].x - pos[0].x) * (pos[2].y - pos[0].y) - (pos[1].y - pos[0].y) * (pos[2].x - pos[0].x);
+                for (uint32_t i = 0; i < 3; i++)
+                {
+                    mPos[i] = pos[i];
+                    // Orient the edges so that the inside of the triangle is on the positive side.
+                    mEdgeOrigin[i] = pos[i];
+                    mEdgeDir[i] = (pos[(i + 1) % 3] - pos[i]) * (signedArea < 0.f ? -1.f : 1.f);
+                }
+                mMin = glm::min(glm::min(pos[0], pos[1]), pos[2]);
+                mMax = glm::max(glm::max(pos[0], pos[1]), pos[2]);
+            }
+
+            void integrate()
+            {
+                // Pick the coarsest level at which the bounding box is covered by at most 2x2 blocks.
+                const int64_t x0 = (int64_t)std::floor(mMin.x), y0 = (int64_t)std::floor(mMin.y);
+                const int64_t x1 = std::max((int64_t)std::ceil(mMax.x), x0 + 1), y1 = std::max((int64_t)std::ceil(mMax.y), y0 + 1);
+                const int64_t extent = std::max(x1 - x0, y1 - y0);
+                uint32_t level = 0;
+                while ((int64_t(1) << level) < extent) level++;
+
+                for (int64_t by = y0 >> level; by <= (y1 - 1) >> level; by++)
+                {
+                    for (int64_t bx = x0 >> level; bx <= (x1 - 1) >> level; bx++)
+                    {
+                        visit(level, bx, by);
+                    }
+                }
+            }
+
+            glm::dvec3 sum = glm::dvec3(0.0);
+            double weight = 0.0;
+
+        private:
+            enum class Coverage { None, Partial, Full };
+
+            Coverage classify(const float2 minPoint, const float2 maxPoint) const
+            {
+                if (maxPoint.x <= mMin.x || maxPoint.y <= mMin.y || minPoint.x >= mMax.x || minPoint.y >= mMax.y) return Coverage::None;
+
+                const float2 corners[4] = { minPoint, float2(maxPoint.x, minPoint.y), float2(minPoint.x, maxPoint.y), maxPoint };
+                bool full = true;
+                for (uint32_t i = 0; i < 3; i++)
+                {
+                    uint32_t insideCount = 0;
+                    for (const float2& c : corners)
+                    {
+                        float2 d = c - mEdgeOrigin[i];
+                        if (mEdgeDir[i].x * d.y - mEdgeDir[i].y * d.x >= 0.f) insideCount++;
+                    }
+                    if (insideCount == 0) return Coverage::None;
+                    if (insideCount < 4) full = false;
+                }
+                return full ? Coverage::Full : Coverage::Partial;
+            }
+
+            void visit(uint32_t level, int64_t bx, int64_t by)
+            {
+                const int64_t blockSize = int64_t(1) << level;
+                const int64_t x = bx * blockSize, y = by * blockSize;
+                const float2 minPoint = float2((float)x, (float)y);
+                const float2 maxPoint = float2((float)(x + blockSize), (float)(y + blockSize));
+
+                Coverage coverage = classify(minPoint, maxPoint);
+                if (coverage == Coverage::None) return;
+
+                if (coverage == Coverage::Full)
+                {
+                    float3 blockSum;
+                    if (level == 0)
+                    {
+                        sum += glm::dvec3(mTexels.fetch(x + mOffsetX, y + mOffsetY));
+                        weight += 1.0;
+                        return;
+                    }
+                    if (mUseBlockSums && mTexels.lookupBlockSum(level, x + mOffsetX, y + mOffsetY, blockSum))
+                    {
+                        sum += glm::dvec3(blockSum);
+                        weight += double(blockSize * blockSize);
+                        return;
+                    }
+                }
+                else if (level == 0)
+                {
+                    // Partially covered texel. Clip the triangle to the texel and compute the area analytically.
+                    float area = computeClippedTriangleArea2D(mPos, minPoint, maxPoint);
+                    float w = std::min(std::abs(area), 1.f); // The area may be negative due to winding.
+                    if (w > 0.f)
+                    {
+                        sum += glm::dvec3(mTexels.fetch(x + mOffsetX, y + mOffsetY) * w);
+                        weight += w;
+                    }
+                    return;
+                }
+
+                for (int64_t cy = 0; cy < 2; cy++)
+                {
+                    for (int64_t cx = 0; cx < 2; cx++) visit(level - 1, 2 * bx + cx, 2 * by + cy);
+                }
+            }
+
+            const EmissiveIntegrator::TexelData& mTexels;
+            float2 mPos[3];
+            float2 mEdgeOrigin[3];
+            float2 mEdgeDir[3];
+            float2 mMin;
+            float2 mMax;
+            int64_t mOffsetX;
+            int64_t mOffsetY;
+            bool mUseBlockSums;
+        };
+    }
+
+    EmissiveIntegrator::TexelData::SharedPtr EmissiveIntegrator::TexelData::create(uint32_t width, uint32_t height, const float4* texels, Sampler::AddressMode addressModeU, Sampler::AddressMode addressModeV)
+    {
+        if (width == 0 || height == 0) throw std::exception("EmissiveIntegrator::TexelData::create() - Texture dimensions must be non-zero");
+
+        SharedPtr pData = SharedPtr(new TexelData());
+        pData->mWidth = width;
+        pData->mHeight = height;
+        pData->mAddressModeU = addressModeU;
+        pData->mAddressModeV = addressModeV;
+
+        auto& level0 = pData->mLevels.emplace_back((size_t)width * height);
+        for (size_t i = 0; i < level0.size(); i++) level0[i] = float3(texels[i]);
+
+        // Build the pyramid of block sums. Partial blocks at the right and bottom edges of non power-of-two textures are dropped.
+        uint32_t w = width, h = height;
+        while (w >= 2 && h >= 2)
+        {
+            const uint32_t prevW = w;
+            w /= 2;
+            h /= 2;
+            std::vector<float3> level((size_t)w * h);
+            const std::vector<float3>& prev = pData->mLevels.back();
+
+            NumericRange<uint32_t> rows(0, h);
+            std::for_each(std::execution::par, rows.begin(), rows.end(), [&](uint32_t y)
+            {
+                const float3* pRow0 = prev.data() + (size_t)(2 * y) * prevW;
+                const float3* pRow1 = pRow0 + prevW;
+                float3* pDst = level.data() + (size_t)y * w;
+                for (uint32_t x = 0; x < w; x++)
+                {
+                    pDst[x] = (pRow0[2 * x] + pRow0[2 * x + 1]) + (pRow1[2 * x] + pRow1[2 * x + 1]);
+                }
+            });
+            pData->mLevels.push_back(std::move(level));
+        }
+
+        return pData;
+    }
+
+    float3 EmissiveIntegrator::TexelData::fetch(int64_t x, int64_t y) const
+    {
+        int64_t tx = resolveTexel(x, mWidth, mAddressModeU);
+        int64_t ty = resolveTexel(y, mHeight, mAddressModeV);
+        if (tx < 0 || ty < 0) return float3(0.f);
+        return mLevels[0][(size_t)ty * mWidth + (size_t)tx];
+    }
+
+    float3 EmissiveIntegrator::TexelData::sample(float2 uv) const
+    {
+        return fetch((int64_t)std::floor(uv.x * mWidth), (int64_t)std::floor(uv.y * mHeight));
+    }
+
+    bool EmissiveIntegrator::TexelData::lookupBlockSum(uint32_t level, int64_t x, int64_t y, float3& sum) const
+    {
+        if (level >= mLevels.size()) return false;
+
+        const int64_t blockSize = int64_t(1) << level;
+        int64_t tx = resolveBlock(x, blockSize, mWidth, mAddressModeU);
+        int64_t ty = resolveBlock(y, blockSize, mHeight, mAddressModeV);
+        if (tx < 0 || ty < 0 || tx % blockSize != 0 || ty % blockSize != 0) return false;
+
+        const size_t levelWidth = mWidth >> level;
+        sum = mLevels[level][(size_t)(ty >> level) * levelWidth + (size_t)(tx >> level)];
+        return true;
+    }
+
+    float3 EmissiveIntegrator::integrateTriangle(const TexelData& texels, const float2 texCoords[3], bool useBlockSums, float* pWeight)
+    {
+        // Place the triangle in texture space like the GPU integrator, offset so that the texel positions are non-negative.
+        const float2 dim = float2((float)texels.getWidth(), (float)texels.getHeight());
+        const float2 uvOffset = glm::floor(glm::min(glm::min(texCoords[0], texCoords[1]), texCoords[2]));
+        float2 pos[3];
+        for (uint32_t i = 0; i < 3; i++) pos[i] = (texCoords[i] - uvOffset) * dim;
+
+        TriangleIntegrator integrator(texels, pos, (int64_t)uvOffset.x * texels.getWidth(), (int64_t)uvOffset.y * texels.getHeight(), useBlockSums);
+        integrator.integrate();
+
+        if (pWeight) *pWeight = (float)integrator.weight;
+
+        if (integrator.weight > 0.0)
+        {
+            return float3(integrator.sum / integrator.weight);
+        }
+        else
+        {
+            // The triangle is degenerate in texture space (line or point).
+            // Approximate the emission as the average emission sampled at the three vertices.
+            float3 average = float3(0.f);
+            for (uint32_t i = 0; i < 3; i++) average += texels.sample(texCoords[i]);
+            return average / 3.f;
+        }
+    }
+}
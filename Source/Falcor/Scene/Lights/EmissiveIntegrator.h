@@ -0,0 +1,115 @@
+/***************************************************************************
+ # Copyright (c) 2015-21, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#pragma once
+#include "Core/API/Sampler.h"
+
+namespace Falcor
+{
+    /** Host implementation of the emissive texture pre-integration in EmissiveIntegrator.3d.slang.
+
+        The average emission over a triangle is computed by integrating the texels it covers in texture space,
+        where partially covered texels are weighted by their analytic coverage. Like the GPU integrator, the
+        result is exact under the assumption that the emissive texture is sampled with nearest filtering at mip 0.
+
+        Blocks of texels that are fully covered by the triangle are looked up in a pyramid of texel block sums,
+        so the cost grows with the triangle's perimeter in texels rather than with its area.
+    */
+    class dlldecl EmissiveIntegrator
+    {
+    public:
+        /** Host copy of an emissive texture prepared for integration.
+        */
+        class dlldecl TexelData
+        {
+        public:
+            using SharedPtr = std::shared_ptr<TexelData>;
+            using SharedConstPtr = std::shared_ptr<const TexelData>;
+
+            /** Create the texel data and its pyramid of block sums.
+                \param[in] width Texture width in texels.
+                \param[in] height Texture height in texels.
+                \param[in] texels Linear RGBA texels of mip 0 in row-major order (width * height elements). The alpha channel is ignored.
+                \param[in] addressModeU Address mode of the sampler in u.
+                \param[in] addressModeV Address mode of the sampler in v.
+                \return New object.
+            */
+            static SharedPtr create(uint32_t width, uint32_t height, const float4* texels, Sampler::AddressMode addressModeU = Sampler::AddressMode::Wrap, Sampler::AddressMode addressModeV = Sampler::AddressMode::Wrap);
+
+            uint32_t getWidth() const { return mWidth; }
+            uint32_t getHeight() const { return mHeight; }
+
+            /** Get the number of pyramid levels. Level 0 holds the texels and level L the sums of 2^L x 2^L texel blocks.
+            */
+            uint32_t getLevelCount() const { return (uint32_t)mLevels.size(); }
+
+            /** Fetch a texel. Coordinates outside the texture are resolved using the address modes.
+                \param[in] x Texel x coordinate.
+                \param[in] y Texel y coordinate.
+                \return Texel value, or zero for texels in the border.
+            */
+            float3 fetch(int64_t x, int64_t y) const;
+
+            /** Sample the texture with nearest filtering.
+                \param[in] uv Texture coordinate.
+                \return Texel value.
+            */
+            float3 sample(float2 uv) const;
+
+            /** Look up the sum of a block of texels.
+                \param[in] level Pyramid level.
+                \param[in] x Texel x coordinate of the first texel in the block, possibly outside the texture.
+                \param[in] y Texel y coordinate of the first texel in the block, possibly outside the texture.
+                \param[out] sum Sum of the texels in the 2^level x 2^level block.
+                \return True if the block maps to a single aligned block in the pyramid, false otherwise.
+            */
+            bool lookupBlockSum(uint32_t level, int64_t x, int64_t y, float3& sum) const;
+
+        private:
+            TexelData() = default;
+
+            uint32_t mWidth = 0;
+            uint32_t mHeight = 0;
+            Sampler::AddressMode mAddressModeU = Sampler::AddressMode::Wrap;
+            Sampler::AddressMode mAddressModeV = Sampler::AddressMode::Wrap;
+            std::vector<std::vector<float3>> mLevels;   ///< Level 0 holds the texels, level L the sums of 2^L x 2^L texel blocks.
+        };
+
+        /** Integrate the emission over a triangle in texture space.
+            \param[in] texels Texel data.
+            \param[in] texCoords Texture coordinates of the triangle vertices.
+            \param[in] useBlockSums Use the pyramid of block sums for fully covered blocks. If false, all covered texels are visited.
+            \param[out] pWeight Total texel coverage of the triangle. This is an optional output parameter.
+            \return Average emission over the triangle. If the triangle has no coverage, i.e., it is degenerate in texture space,
+                    the average of the texels sampled at the three vertices is returned instead.
+        */
+        static float3 integrateTriangle(const TexelData& texels, const float2 texCoords[3], bool useBlockSums = true, float* pWeight = nullptr);
+
+    private:
+        EmissiveIntegrator() = delete;
+    };
+}
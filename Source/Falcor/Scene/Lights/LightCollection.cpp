@@ -27,9 +27,16 @@
  **************************************************************************/
 #include "stdafx.h"
 #include "LightCollection.h"
+#include "EmissiveIntegrator.h"
 #include "LightCollectionShared.slang"
 #include "Scene/Scene.h"
+#include "Scene/SceneCache.h"
+#include "Utils/Color/ColorHelpers.slang"
+#include "Utils/Algorithm/HostParallel.h"
+#include "Utils/NumericRange.h"
 #include <sstream>
+#include <execution>
+#include <filesystem>
 
 namespace Falcor
 {
@@ -45,16 +52,18 @@ namespace Falcor
         const char kFinalizeIntegrationFile[] = "Scene/Lights/FinalizeIntegration.cs.slang";
     }
 
-    LightCollection::SharedPtr LightCollection::create(RenderContext* pRenderContext, const std::shared_ptr<Scene>& pScene)
+    LightCollection::SharedPtr LightCollection::create(RenderContext* pRenderContext, const std::shared_ptr<Scene>& pScene, BuildMode buildMode)
     {
         SharedPtr ptr = SharedPtr(new LightCollection());
-        return ptr->init(pRenderContext, pScene) ? ptr : nullptr;
+        return ptr->init(pRenderContext, pScene, buildMode) ? ptr : nullptr;
     }
 
     bool LightCollection::update(RenderContext* pRenderContext, UpdateStatus* pUpdateStatus)
     {
         PROFILE("LightCollection::update()");
 
+        mUpdatedLights.clear();
+
         auto pScene = mpScene.lock();
         if (!pScene) return false;
 
@@ -66,8 +75,7 @@ namespace Falcor
 
         // Update transform matrices and check for updates.
         // TODO: Move per-mesh instance update flags into Scene. Return just a list of mesh lights that have changed.
-        std::vector<uint32_t> updatedLights;
-        updatedLights.reserve(mMeshLights.size());
+        mUpdatedLights.reserve(mMeshLights.size());
 
         for (uint32_t lightIdx = 0; lightIdx < mMeshLights.size(); ++lightIdx)
         {
@@ -78,21 +86,22 @@ namespace Falcor
             if (pScene->getAnimationController()->isMatrixChanged(instanceData.globalMatrixID)) updateFlags |= UpdateFlags::MatrixChanged;
 
             // Store update status.
-            if (updateFlags != UpdateFlags::None) updatedLights.push_back(lightIdx);
+            if (updateFlags != UpdateFlags::None) mUpdatedLights.push_back(lightIdx);
             if (pUpdateStatus) pUpdateStatus->lightsUpdateInfo.push_back(updateFlags);
         }
 
         // Update light data if needed.
-        if (!updatedLights.empty())
+        if (!mUpdatedLights.empty())
         {
-            updateTrianglePositions(pRenderContext, *pScene, updatedLights);
+            if (mBuildOnHost) updateTrianglePositionsHost(*pScene, mUpdatedLights);
+            else updateTrianglePositions(pRenderContext, *pScene, mUpdatedLights);
             return true;
         }
 
         return false;
     }
 
-    bool LightCollection::init(RenderContext* pRenderContext, const std::shared_ptr<Scene>& pScene)
+    bool LightCollection::init(RenderContext* pRenderContext, const std::shared_ptr<Scene>& pScene, BuildMode buildMode)
     {
         assert(pScene);
         mpScene = pScene;
@@ -100,9 +109,16 @@ namespace Falcor
         // Setup the lights.
         if (!setupMeshLights(*pScene)) return false;
 
-        // Create program for integrating emissive textures.
+        // Build on the host if possible. This avoids reading back the results from the GPU.
+        mBuildOnHost = buildMode != BuildMode::Device && canBuildOnHost(*pScene);
+        if (buildMode == BuildMode::Host && !mBuildOnHost)
+        {
+            logWarning("LightCollection: The geometry of some mesh lights is not available on the host. Building the emissive triangle list on the GPU instead.");
+        }
+
+        // Create program for integrating emissive textures. It is not needed when building on the host.
         // This should be done after lights are setup, so that we know which sampler state etc. to use.
-        if (!initIntegrator(*pScene)) return false;
+        if (!mBuildOnHost && !initIntegrator(*pScene)) return false;
 
         // Create programs for building/updating the mesh lights.
         Shader::DefineList defines = pScene->getSceneDefines();
@@ -248,20 +264,31 @@ namespace Falcor
             prepareTriangleData(pRenderContext, scene);
             timeReport.measure("LightCollection::build preparation");
 
-            // Pre-integrate emissive triangles.
+            // Pre-integrate emissive triangles. For cached scenes, the flux is loaded from the scene cache if the emissive content is unchanged.
             // TODO: We might want to redo this in update() for animated meshes or after scale changes as that affects the flux.
-            integrateEmissive(pRenderContext, scene);
+            const auto& sceneCacheKey = scene.getSceneCacheKey();
+            const std::optional<SHA1::MD> contentKey = sceneCacheKey ? computeEmissiveContentKey(scene) : std::nullopt;
+            const bool fluxCached = contentKey && readFluxFromCache(*sceneCacheKey, *contentKey);
 
-            timeReport.measure("LightCollection::build integrate emissive");
+            if (!fluxCached)
+            {
+                if (mBuildOnHost) integrateEmissiveHost(pRenderContext, scene);
+                else integrateEmissive(pRenderContext, scene);
+            }
+
+            timeReport.measure(fluxCached ? "LightCollection::build load cached emissive flux" : "LightCollection::build integrate emissive");
 
             // Build list of active triangles.
-            mCPUInvalidData = CPUOutOfDateFlags::All;
-            mStagingBufferValid = false;
+            // When building on the host, the CPU data is already up-to-date.
+            mCPUInvalidData = mBuildOnHost ? CPUOutOfDateFlags::None : CPUOutOfDateFlags::All;
+            mStagingBufferValid = mBuildOnHost;
             mStatsValid = false;
 
-            prepareSyncCPUData(pRenderContext);
+            if (!mBuildOnHost) prepareSyncCPUData(pRenderContext);
             updateActiveTriangleList();
 
+            if (contentKey && !fluxCached) writeFluxToCache(*sceneCacheKey, *contentKey);
+
             timeReport.measure("LightCollection::build finalize");
             timeReport.printToLog();
         }
@@ -281,7 +308,8 @@ namespace Falcor
         if (mpFluxData->getStructSize() != sizeof(EmissiveFlux)) throw std::exception("Struct EmissiveFlux size mismatch between CPU/GPU");
 
         // Compute triangle data (vertices, uv-coordinates, materialID) for all mesh lights.
-        buildTriangleList(pRenderContext, scene);
+        if (mBuildOnHost) buildTriangleListHost(scene);
+        else buildTriangleList(pRenderContext, scene);
     }
 
     void LightCollection::prepareMeshData(const Scene& scene)
@@ -493,6 +521,289 @@ namespace Falcor
         }
     }
 
+    bool LightCollection::canBuildOnHost(const Scene& scene) const
+    {
+        for (const auto& meshLight : mMeshLights)
+        {
+            const MeshInstanceData& instanceData = scene.getMeshInstance(meshLight.meshInstanceID);
+            if (!scene.getHostMeshGeometry(instanceData.meshID)) return false;
+        }
+        return true;
+    }
+
+    void LightCollection::buildTriangleListHost(const Scene& scene)
+    {
+        assert(mMeshLights.size() > 0);
+
+        mMeshLightTriangles.assign(mTriangleCount, MeshLightTriangle());
+        for (uint32_t lightIdx = 0; lightIdx < mMeshLights.size(); ++lightIdx)
+        {
+            const MeshLightData& meshLight = mMeshLights[lightIdx];
+            for (uint32_t i = 0; i < meshLight.triangleCount; i++) mMeshLightTriangles[meshLight.triangleOffset + i].lightIdx = lightIdx;
+        }
+
+        NumericRange<uint32_t> range(0, mTriangleCount);
+        std::for_each(std::execution::par, range.begin(), range.end(), [&](uint32_t triIdx)
+        {
+            computeTriangleGeometry(scene, triIdx);
+        });
+
+        uploadTriangleData(0, mTriangleCount);
+    }
+
+    void LightCollection::computeTriangleGeometry(const Scene& scene, uint32_t triIdx)
+    {
+        // This is the host version of the per-triangle work in BuildTriangleList.cs.slang.
+        // Note that the texture coordinates of emissive geometry are already quantized to fp16 when loading the scene.
+        MeshLightTriangle& tri = mMeshLightTriangles[triIdx];
+        const MeshLightData& meshLight = mMeshLights[tri.lightIdx];
+        const MeshInstanceData& instanceData = scene.getMeshInstance(meshLight.meshInstanceID);
+        const Scene::HostMeshGeometry* pGeometry = scene.getHostMeshGeometry(instanceData.meshID);
+        assert(pGeometry);
+        const glm::mat4& worldMat = scene.getAnimationController()->getGlobalMatrices()[instanceData.globalMatrixID];
+
+        const uint32_t triangleIndex = triIdx - meshLight.triangleOffset;
+        for (uint32_t j = 0; j < 3; j++)
+        {
+            const uint32_t vtxIdx = pGeometry->indices[triangleIndex * 3 + j];
+            tri.vtx[j].pos = (worldMat * float4(pGeometry->positions[vtxIdx], 1.f)).xyz;
+            tri.vtx[j].uv = pGeometry->texCrds[vtxIdx];
+        }
+
+        // Compute face normal and area in world space like Scene::computeFaceNormalAndAreaW().
+        float3 N = glm::cross(tri.vtx[1].pos - tri.vtx[0].pos, tri.vtx[2].pos - tri.vtx[0].pos);
+        tri.area = 0.5f * glm::length(N);
+        if (instanceData.isWorldFrontFaceCW()) N = -N;
+        tri.normal = glm::normalize(N);
+    }
+
+    void LightCollection::uploadTriangleData(uint32_t firstTriangle, uint32_t triangleCount)
+    {
+        std::vector<PackedEmissiveTriangle> packedTriangles(triangleCount);
+        NumericRange<uint32_t> range(0, triangleCount);
+        std::for_each(std::execution::par, range.begin(), range.end(), [&](uint32_t i)
+        {
+            const MeshLightTriangle& meshLightTri = mMeshLightTriangles[firstTriangle + i];
+            EmissiveTriangle tri;
+            for (uint32_t j = 0; j < 3; j++)
+            {
+                tri.posW[j] = meshLightTri.vtx[j].pos;
+                tri.texCoords[j] = meshLightTri.vtx[j].uv;
+            }
+            tri.normal = meshLightTri.normal;
+            tri.area = meshLightTri.area;
+            tri.materialID = mMeshLights[meshLightTri.lightIdx].materialID;
+            tri.lightIdx = meshLightTri.lightIdx;
+            packedTriangles[i].pack(tri);
+        });
+
+        mpTriangleData->setBlob(packedTriangles.data(), firstTriangle * sizeof(PackedEmissiveTriangle), triangleCount * sizeof(PackedEmissiveTriangle));
+    }
+
+    void LightCollection::integrateEmissiveHost(RenderContext* pRenderContext, const Scene& scene)
+    {
+        assert(mTriangleCount > 0);
+        assert(mMeshLights.size() > 0);
+
+        // Copy the emissive textures to the host. The textures are converted to linear RGBA32Float on the GPU first,
+        // which handles sRGB and block-compressed formats. All readbacks are issued before waiting for the first one.
+        struct TextureReadback
+        {
+            Texture::SharedPtr pTexture;
+            CopyContext::ReadTextureTask::SharedPtr pTask;
+            EmissiveIntegrator::TexelData::SharedPtr pTexels;
+        };
+        std::vector<TextureReadback> readbacks;
+        std::unordered_map<const Texture*, size_t> textureIndices;
+
+        struct LightMaterial
+        {
+            float3 emissive;
+            float emissiveFactor;
+            const EmissiveIntegrator::TexelData* pTexels = nullptr;
+        };
+        std::vector<LightMaterial> lightMaterials(mMeshLights.size());
+        std::vector<size_t> lightTextures(mMeshLights.size(), SIZE_MAX);
+
+        for (size_t lightIdx = 0; lightIdx < mMeshLights.size(); lightIdx++)
+        {
+            auto pMaterial = scene.getMaterial(mMeshLights[lightIdx].materialID)->toBasicMaterial();
+            assert(pMaterial);
+            lightMaterials[lightIdx].emissive = pMaterial->getEmissiveColor();
+            lightMaterials[lightIdx].emissiveFactor = pMaterial->getEmissiveFactor();
+
+            const auto& pTexture = pMaterial->getEmissiveTexture();
+            if (!pTexture) continue;
+
+            auto it = textureIndices.find(pTexture.get());
+            if (it == textureIndices.end())
+            {
+                TextureReadback readback;
+                readback.pTexture = Texture::create2D(pTexture->getWidth(), pTexture->getHeight(), ResourceFormat::RGBA32Float, 1, 1, nullptr, ResourceBindFlags::RenderTarget | ResourceBindFlags::ShaderResource);
+                pRenderContext->blit(pTexture->getSRV(0, 1, 0, 1), readback.pTexture->getRTV(), RenderContext::kMaxRect, RenderContext::kMaxRect, Sampler::Filter::Point);
+                readback.pTask = pRenderContext->asyncReadTextureSubresource(readback.pTexture.get(), 0);
+                it = textureIndices.emplace(pTexture.get(), readbacks.size()).first;
+                readbacks.push_back(std::move(readback));
+            }
+            lightTextures[lightIdx] = it->second;
+        }
+
+        // Texels are fetched with the address modes of the material sampler, like the point sampler in the GPU integrator.
+        const Sampler::AddressMode addressModeU = mpSamplerState ? mpSamplerState->getAddressModeU() : Sampler::AddressMode::Wrap;
+        const Sampler::AddressMode addressModeV = mpSamplerState ? mpSamplerState->getAddressModeV() : Sampler::AddressMode::Wrap;
+        for (auto& readback : readbacks)
+        {
+            std::vector<uint8_t> data = readback.pTask->getData();
+            assert(data.size() == (size_t)readback.pTexture->getWidth() * readback.pTexture->getHeight() * sizeof(float4));
+            readback.pTexels = EmissiveIntegrator::TexelData::create(readback.pTexture->getWidth(), readback.pTexture->getHeight(), reinterpret_cast<const float4*>(data.data()), addressModeU, addressModeV);
+            readback.pTexture = nullptr;
+        }
+        for (size_t lightIdx = 0; lightIdx < mMeshLights.size(); lightIdx++)
+        {
+            if (lightTextures[lightIdx] != SIZE_MAX) lightMaterials[lightIdx].pTexels = readbacks[lightTextures[lightIdx]].pTexels.get();
+        }
+
+        // Integrate all triangles in parallel. This is the host version of FinalizeIntegration.cs.slang.
+        std::vector<EmissiveFlux> fluxData(mTriangleCount);
+        NumericRange<uint32_t> range(0, mTriangleCount);
+        std::for_each(std::execution::par, range.begin(), range.end(), [&](uint32_t triIdx)
+        {
+            MeshLightTriangle& tri = mMeshLightTriangles[triIdx];
+            const LightMaterial& material = lightMaterials[tri.lightIdx];
+
+            float3 averageEmissiveColor = material.emissive;
+            if (material.pTexels)
+            {
+                const float2 texCoords[3] = { tri.vtx[0].uv, tri.vtx[1].uv, tri.vtx[2].uv };
+                averageEmissiveColor = EmissiveIntegrator::integrateTriangle(*material.pTexels, texCoords);
+            }
+            tri.averageRadiance = averageEmissiveColor * material.emissiveFactor;
+
+            // Pre-compute the luminous flux emitted assuming diffuse emitters, see FinalizeIntegration.cs.slang.
+            tri.flux = luminance(tri.averageRadiance) * tri.area * (float)M_PI;
+
+            fluxData[triIdx].flux = tri.flux;
+            fluxData[triIdx].averageRadiance = tri.averageRadiance;
+        });
+
+        mpFluxData->setBlob(fluxData.data(), 0, fluxData.size() * sizeof(EmissiveFlux));
+    }
+
+    std::optional<SHA1::MD> LightCollection::computeEmissiveContentKey(const Scene& scene) const
+    {
+        // The mesh geometry is part of the scene cache. The flux additionally depends on the instance transforms,
+        // the emissive material parameters and textures, and the sampler used for the texture lookups.
+        // Textures are identified by their source file, including its size and modification time so that files edited in place are detected.
+        // Textures without a source file can't be identified, in which case no key is returned and the flux is not cached.
+        SHA1 sha1;
+        const auto& globalMatrices = scene.getAnimationController()->getGlobalMatrices();
+        for (const auto& meshLight : mMeshLights)
+        {
+            sha1.update(&meshLight, sizeof(meshLight));
+
+            const MeshInstanceData& instanceData = scene.getMeshInstance(meshLight.meshInstanceID);
+            const glm::mat4& worldMat = globalMatrices[instanceData.globalMatrixID];
+            sha1.update(&worldMat, sizeof(worldMat));
+
+            auto pMaterial = scene.getMaterial(meshLight.materialID)->toBasicMaterial();
+            assert(pMaterial);
+            const float3 emissive = pMaterial->getEmissiveColor();
+            const float emissiveFactor = pMaterial->getEmissiveFactor();
+            sha1.update(&emissive, sizeof(emissive));
+            sha1.update(&emissiveFactor, sizeof(emissiveFactor));
+
+            const auto& pTexture = pMaterial->getEmissiveTexture();
+            const std::string textureName = pTexture ? pTexture->getSourceFilename() : "";
+            sha1.update(textureName.data(), textureName.size() + 1);
+
+            if (pTexture)
+            {
+                std::error_code ec;
+                const uint64_t fileSize = std::filesystem::file_size(textureName, ec);
+                if (ec) return std::nullopt;
+                const int64_t writeTime = std::filesystem::last_write_time(textureName, ec).time_since_epoch().count();
+                if (ec) return std::nullopt;
+                sha1.update(&fileSize, sizeof(fileSize));
+                sha1.update(&writeTime, sizeof(writeTime));
+            }
+        }
+
+        const Sampler::AddressMode addressModes[2] =
+        {
+            mpSamplerState ? mpSamplerState->getAddressModeU() : Sampler::AddressMode::Wrap,
+            mpSamplerState ? mpSamplerState->getAddressModeV() : Sampler::AddressMode::Wrap,
+        };
+        sha1.update(addressModes, sizeof(addressModes));
+
+        return sha1.final();
+    }
+
+    bool LightCollection::readFluxFromCache(const SHA1::MD& sceneKey, const SHA1::MD& contentKey)
+    {
+        std::vector<EmissiveFlux> fluxData;
+        try
+        {
+            if (!SceneCache::readEmissiveFlux(sceneKey, contentKey, fluxData)) return false;
+        }
+        catch (const std::exception& e)
+        {
+            logWarning(std::string("Failed to read emissive flux from scene cache: ") + e.what());
+            return false;
+        }
+        if (fluxData.size() != mTriangleCount) return false;
+
+        mpFluxData->setBlob(fluxData.data(), 0, fluxData.size() * sizeof(EmissiveFlux));
+
+        // When building on the host, the CPU data is expected to be up-to-date after the build.
+        // Otherwise the flux is read back together with the triangle data.
+        if (mBuildOnHost)
+        {
+            for (uint32_t triIdx = 0; triIdx < mTriangleCount; triIdx++)
+            {
+                mMeshLightTriangles[triIdx].flux = fluxData[triIdx].flux;
+                mMeshLightTriangles[triIdx].averageRadiance = fluxData[triIdx].averageRadiance;
+            }
+        }
+        return true;
+    }
+
+    void LightCollection::writeFluxToCache(const SHA1::MD& sceneKey, const SHA1::MD& contentKey) const
+    {
+        // The CPU data has been synced by updateActiveTriangleList().
+        assert(mCPUInvalidData == CPUOutOfDateFlags::None);
+        std::vector<EmissiveFlux> fluxData(mTriangleCount);
+        for (uint32_t triIdx = 0; triIdx < mTriangleCount; triIdx++)
+        {
+            fluxData[triIdx].flux = mMeshLightTriangles[triIdx].flux;
+            fluxData[triIdx].averageRadiance = mMeshLightTriangles[triIdx].averageRadiance;
+        }
+
+        try
+        {
+            SceneCache::writeEmissiveFlux(sceneKey, contentKey, fluxData);
+        }
+        catch (const std::exception& e)
+        {
+            logWarning(std::string("Failed to write emissive flux to scene cache: ") + e.what());
+        }
+    }
+
+    void LightCollection::updateTrianglePositionsHost(const Scene& scene, const std::vector<uint32_t>& updatedLights)
+    {
+        // Unlike the GPU version, only the triangles of the updated mesh lights are recomputed and uploaded.
+        assert(!updatedLights.empty());
+        for (uint32_t lightIdx : updatedLights)
+        {
+            const MeshLightData& meshLight = mMeshLights[lightIdx];
+            NumericRange<uint32_t> range(meshLight.triangleOffset, meshLight.triangleOffset + meshLight.triangleCount);
+            std::for_each(std::execution::par, range.begin(), range.end(), [&](uint32_t triIdx)
+            {
+                computeTriangleGeometry(scene, triIdx);
+            });
+            uploadTriangleData(meshLight.triangleOffset, meshLight.triangleCount);
+        }
+    }
+
     void LightCollection::updateActiveTriangleList()
     {
         // This function updates the list of active (non-culled) triangles based on the pre-integrated flux.
@@ -503,19 +814,15 @@ namespace Falcor
         // Read back the current data. This is potentially expensive.
         syncCPUData();
 
-        mActiveTriangleList.clear();
-        mActiveTriangleList.reserve(mMeshLightTriangles.size());
-
-        // Iterate over the emissive triangles.
-        for (uint32_t triIdx = 0; triIdx < (uint32_t)mMeshLightTriangles.size(); triIdx++)
+        // Compact the indices of the emissive triangles with non-zero flux.
+        assert(mMeshLightTriangles.size() <= std::numeric_limits<uint32_t>::max());
+        mActiveTriangleList.resize(mMeshLightTriangles.size());
+        const size_t activeTriangleCount = HostParallel::compactIndices((uint32_t)mMeshLightTriangles.size(), mActiveTriangleList.data(), [this](uint32_t triIdx)
         {
-            if (mMeshLightTriangles[triIdx].flux > 0.f)
-            {
-                mActiveTriangleList.push_back(triIdx);
-            }
-        }
+            return mMeshLightTriangles[triIdx].flux > 0.f;
+        });
+        mActiveTriangleList.resize(activeTriangleCount);
 
-        assert(mActiveTriangleList.size() <= std::numeric_limits<uint32_t>::max());
         const uint32_t activeCount = (uint32_t)mActiveTriangleList.size();
 
         // Update GPU buffer.
@@ -28,6 +28,8 @@
 #pragma once
 #include "RenderGraph/BasePasses/ComputePass.h"
 #include "MeshLightData.slang"
+#include "Utils/CryptoUtils.h"
+#include <optional>
 
 namespace Falcor
 {
@@ -47,6 +49,15 @@ namespace Falcor
         using SharedPtr = std::shared_ptr<LightCollection>;
         using SharedConstPtr = std::shared_ptr<const LightCollection>;
 
+        /** Where the emissive triangle list is built and pre-integrated.
+        */
+        enum class BuildMode : uint32_t
+        {
+            Auto,       ///< Build on the host if the geometry of all mesh lights is available on the host, otherwise on the GPU.
+            Host,       ///< Build on the host. Falls back to the GPU if the geometry of some mesh light is not available on the host.
+            Device,     ///< Build on the GPU and read the results back to the host when needed.
+        };
+
         enum class UpdateFlags : uint32_t
         {
             None                = 0u,   ///< Nothing was changed.
@@ -110,9 +121,10 @@ namespace Falcor
             Note that update() must be called before the collection is ready to use.
             \param[in] pRenderContext The render context.
             \param[in] pScene The scene.
+            \param[in] buildMode Where to build the emissive triangle list and pre-integrate the emission.
             \return Ptr to the created object, or nullptr if an error occured.
         */
-        static SharedPtr create(RenderContext* pRenderContext, const std::shared_ptr<Scene>& pScene);
+        static SharedPtr create(RenderContext* pRenderContext, const std::shared_ptr<Scene>& pScene, BuildMode buildMode = BuildMode::Auto);
 
         /** Updates the light collection to the current state of the scene.
             \param[in] pRenderContext The render context.
@@ -139,6 +151,11 @@ namespace Falcor
         */
         const MeshLightStats& getStats() const { computeStats(); return mMeshLightStats; }
 
+        /** Returns true if the emissive triangle list and pre-integrated emission are built on the host.
+            In that case getMeshLightTriangles() returns the data without reading it back from the GPU.
+        */
+        bool isBuiltOnHost() const { return mBuildOnHost; }
+
         /** Returns a CPU buffer with all emissive triangles in world space.
             Note that update() must have been called before for the data to be valid.
             Call prepareSyncCPUData() ahead of time to avoid stalling the GPU.
@@ -150,6 +167,10 @@ namespace Falcor
         */
         const std::vector<MeshLightData>& getMeshLights() const { return mMeshLights; }
 
+        /** Returns the indices of the mesh lights that were changed by the last call to update().
+        */
+        const std::vector<uint32_t>& getUpdatedLights() const { return mUpdatedLights; }
+
         /** Prepare for syncing the CPU data.
             If the mesh light triangles will be accessed with getMeshLightTriangles()
             performance can be improved by calling this function ahead of time.
@@ -174,7 +195,7 @@ namespace Falcor
     protected:
         LightCollection() = default;
 
-        bool init(RenderContext* pRenderContext, const std::shared_ptr<Scene>& pScene);
+        bool init(RenderContext* pRenderContext, const std::shared_ptr<Scene>& pScene, BuildMode buildMode);
         bool initIntegrator(const Scene& scene);
         bool setupMeshLights(const Scene& scene);
         void build(RenderContext* pRenderContext, const Scene& scene);
@@ -186,6 +207,19 @@ namespace Falcor
         void updateActiveTriangleList();
         void updateTrianglePositions(RenderContext* pRenderContext, const Scene& scene, const std::vector<uint32_t>& updatedLights);
 
+        // Host implementation of the build.
+        bool canBuildOnHost(const Scene& scene) const;
+        void buildTriangleListHost(const Scene& scene);
+        void integrateEmissiveHost(RenderContext* pRenderContext, const Scene& scene);
+        void updateTrianglePositionsHost(const Scene& scene, const std::vector<uint32_t>& updatedLights);
+        void computeTriangleGeometry(const Scene& scene, uint32_t triIdx);
+        void uploadTriangleData(uint32_t firstTriangle, uint32_t triangleCount);
+
+        // Caching of the pre-integrated flux alongside the scene cache.
+        std::optional<SHA1::MD> computeEmissiveContentKey(const Scene& scene) const;
+        bool readFluxFromCache(const SHA1::MD& sceneKey, const SHA1::MD& contentKey);
+        void writeFluxToCache(const SHA1::MD& sceneKey, const SHA1::MD& contentKey) const;
+
         void copyDataToStagingBuffer(RenderContext* pRenderContext) const;
         void syncCPUData() const;
 
@@ -193,12 +227,14 @@ namespace Falcor
         std::weak_ptr<Scene>                    mpScene;                ///< Weak pointer to scene (scene owns LightCollection).
 
         std::vector<MeshLightData>              mMeshLights;            ///< List of all mesh lights.
+        std::vector<uint32_t>                   mUpdatedLights;         ///< List of mesh lights changed by the last call to update().
         uint32_t                                mTriangleCount = 0;     ///< Total number of triangles in all mesh lights (= mMeshLightTriangles.size()). This may include culled triangles.
 
         mutable std::vector<MeshLightTriangle>  mMeshLightTriangles;    ///< List of all pre-processed mesh light triangles.
         mutable std::vector<uint32_t>           mActiveTriangleList;    ///< List of active (non-culled) emissive triangles.
         mutable MeshLightStats                  mMeshLightStats;        ///< Stats before/after pre-processing of mesh lights. Do not access this directly, use getStats() which ensures the stats are up-to-date.
         mutable bool                            mStatsValid = false;    ///< True when stats are valid.
+        bool                                    mBuildOnHost = false;   ///< True if the triangle list and pre-integrated emission are built on the host.
 
         // GPU resources for the mesh lights and emissive triangles.
         Buffer::SharedPtr                       mpTriangleData;         ///< Per-triangle geometry data for emissive triangles (mTriangleCount elements).
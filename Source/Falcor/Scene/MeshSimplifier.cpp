@@ -0,0 +1,332 @@
+/***************************************************************************
+ # Copyright (c) 2015-21, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "stdafx.h"
+#include "MeshSimplifier.h"
+#include <execution>
+
+namespace Falcor
+{
+    namespace
+    {
+        // Max number of distinct neighbors two collapsing vertices may share.
+        // Interior edges of a manifold mesh have exactly two, more indicates the collapse would create a non-manifold fold.
+        const uint32_t kMaxSharedNeighbors = 2;
+
+        /** Symmetric quadric representing the sum of squared distances to a set of planes.
+            The error for a point p is p^T A p + 2 b^T p + c. Double precision is used as the terms cancel.
+        */
+        struct Quadric
+        {
+            double a00 = 0.0, a01 = 0.0, a02 = 0.0, a11 = 0.0, a12 = 0.0, a22 = 0.0;
+            double b0 = 0.0, b1 = 0.0, b2 = 0.0;
+            double c = 0.0;
+            double weight = 0.0;
+
+            static Quadric fromTriangle(const float3& p0, const float3& p1, const float3& p2)
+            {
+                Quadric q;
+                float3 n = glm::cross(p1 - p0, p2 - p0);
+                double area = 0.5 * glm::length(n);
+                if (area == 0.0) return q;
+
+                // Plane n.x + d = 0 weighted by the triangle area.
+                double nx = n.x / (2.0 * area), ny = n.y / (2.0 * area), nz = n.z / (2.0 * area);
+                double d = -(nx * p0.x + ny * p0.y + nz * p0.z);
+
+                q.a00 = area * nx * nx; q.a01 = area * nx * ny; q.a02 = area * nx * nz;
+                q.a11 = area * ny * ny; q.a12 = area * ny * nz; q.a22 = area * nz * nz;
+                q.b0 = area * nx * d; q.b1 = area * ny * d; q.b2 = area * nz * d;
+                q.c = area * d * d;
+                q.weight = area;
+                return q;
+            }
+
+            Quadric& operator+=(const Quadric& o)
+            {
+                a00 += o.a00; a01 += o.a01; a02 += o.a02; a11 += o.a11; a12 += o.a12; a22 += o.a22;
+                b0 += o.b0; b1 += o.b1; b2 += o.b2;
+                c += o.c;
+                weight += o.weight;
+                return *this;
+            }
+
+            double evaluate(const float3& p) const
+            {
+                double x = p.x, y = p.y, z = p.z;
+                double e = a00 * x * x + a11 * y * y + a22 * z * z + 2.0 * (a01 * x * y + a02 * x * z + a12 * y * z) +
+                    2.0 * (b0 * x + b1 * y + b2 * z) + c;
+                return std::max(e, 0.0);
+            }
+        };
+
+        /** Returns the squared distance error of collapsing vertex v0 onto v1.
+        */
+        float computeCollapseError(const std::vector<Quadric>& quadrics, const float3* positions, uint32_t v0, uint32_t v1)
+        {
+            Quadric q = quadrics[v0];
+            q += quadrics[v1];
+            return q.weight > 0.0 ? (float)(q.evaluate(positions[v1]) / q.weight) : 0.f;
+        }
+
+        struct PositionHash
+        {
+            size_t operator()(const float3& p) const
+            {
+                const uint32_t* u = reinterpret_cast<const uint32_t*>(&p);
+                return ((size_t)u[0] * 73856093u) ^ ((size_t)u[1] * 19349663u) ^ ((size_t)u[2] * 83492791u);
+            }
+        };
+
+        /** Finds vertices that must not be moved: vertices on attribute seams, open borders and non-manifold edges.
+        */
+        std::vector<bool> findLockedVertices(const float3* positions, size_t vertexCount, const uint32_t* indices, size_t indexCount)
+        {
+            // Map vertices to the first vertex with the same position.
+            std::vector<uint32_t> canonical(vertexCount);
+            std::vector<uint32_t> positionCount(vertexCount, 0);
+            std::unordered_map<float3, uint32_t, PositionHash> positionToVertex;
+            positionToVertex.reserve(vertexCount);
+            for (uint32_t v = 0; v < (uint32_t)vertexCount; v++)
+            {
+                canonical[v] = positionToVertex.emplace(positions[v], v).first->second;
+                positionCount[canonical[v]]++;
+            }
+
+            std::vector<bool> lockedCanonical(vertexCount, false);
+            for (uint32_t v = 0; v < (uint32_t)vertexCount; v++)
+            {
+                if (positionCount[v] > 1) lockedCanonical[v] = true;
+            }
+
+            // Edges of a closed manifold surface are shared by exactly two triangles.
+            std::unordered_map<uint64_t, uint32_t> edgeCount;
+            edgeCount.reserve(indexCount);
+            for (size_t i = 0; i < indexCount; i += 3)
+            {
+                for (uint32_t e = 0; e < 3; e++)
+                {
+                    uint32_t a = canonical[indices[i + e]];
+                    uint32_t b = canonical[indices[i + (e + 1) % 3]];
+                    uint64_t key = a < b ? ((uint64_t)a << 32) | b : ((uint64_t)b << 32) | a;
+                    edgeCount[key]++;
+                }
+            }
+            for (const auto& [key, count] : edgeCount)
+            {
+                if (count != 2)
+                {
+                    lockedCanonical[(uint32_t)(key >> 32)] = true;
+                    lockedCanonical[(uint32_t)key] = true;
+                }
+            }
+
+            std::vector<bool> locked(vertexCount);
+            for (uint32_t v = 0; v < (uint32_t)vertexCount; v++) locked[v] = lockedCanonical[canonical[v]];
+            return locked;
+        }
+
+        /** Vertex to triangle adjacency in compressed row format.
+        */
+        struct VertexAdjacency
+        {
+            std::vector<uint32_t> offsets;
+            std::vector<uint32_t> triangles;
+
+            void build(const std::vector<uint32_t>& indices, size_t vertexCount)
+            {
+                offsets.assign(vertexCount + 1, 0);
+                for (uint32_t index : indices) offsets[index + 1]++;
+                for (size_t v = 0; v < vertexCount; v++) offsets[v + 1] += offsets[v];
+
+                triangles.resize(indices.size());
+                std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+                for (size_t i = 0; i < indices.size(); i++) triangles[fill[indices[i]]++] = (uint32_t)(i / 3);
+            }
+
+            const uint32_t* begin(uint32_t v) const { return triangles.data() + offsets[v]; }
+            const uint32_t* end(uint32_t v) const { return triangles.data() + offsets[v + 1]; }
+        };
+
+        struct Collapse
+        {
+            uint32_t v0;    ///< Vertex to remove.
+            uint32_t v1;    ///< Vertex to collapse onto.
+            float error;    ///< Squared distance error.
+        };
+
+        /** Checks that collapsing v0 onto v1 keeps the surface manifold and doesn't flip any triangles.
+        */
+        bool isCollapseValid(const std::vector<uint32_t>& indices, const VertexAdjacency& adjacency, const float3* positions, uint32_t v0, uint32_t v1)
+        {
+            // Count the neighbors of v0 that are also neighbors of v1.
+            std::vector<uint32_t> neighbors0, neighbors1;
+            for (const uint32_t* t = adjacency.begin(v0); t != adjacency.end(v0); t++)
+            {
+                for (uint32_t j = 0; j < 3; j++) neighbors0.push_back(indices[*t * 3 + j]);
+            }
+            for (const uint32_t* t = adjacency.begin(v1); t != adjacency.end(v1); t++)
+            {
+                for (uint32_t j = 0; j < 3; j++) neighbors1.push_back(indices[*t * 3 + j]);
+            }
+            std::sort(neighbors0.begin(), neighbors0.end());
+            std::sort(neighbors1.begin(), neighbors1.end());
+            neighbors0.erase(std::unique(neighbors0.begin(), neighbors0.end()), neighbors0.end());
+            neighbors1.erase(std::unique(neighbors1.begin(), neighbors1.end()), neighbors1.end());
+
+            uint32_t sharedCount = 0;
+            for (uint32_t v : neighbors0)
+            {
+                if (v != v0 && v != v1 && std::binary_search(neighbors1.begin(), neighbors1.end(), v)) sharedCount++;
+            }
+            if (sharedCount > kMaxSharedNeighbors) return false;
+
+            // Check that the remaining triangles around v0 keep their orientation.
+            for (const uint32_t* t = adjacency.begin(v0); t != adjacency.end(v0); t++)
+            {
+                uint32_t i0 = indices[*t * 3 + 0], i1 = indices[*t * 3 + 1], i2 = indices[*t * 3 + 2];
+                if (i0 == v1 || i1 == v1 || i2 == v1) continue; // Triangle is removed by the collapse.
+
+                float3 p0 = positions[i0], p1 = positions[i1], p2 = positions[i2];
+                float3 nBefore = glm::cross(p1 - p0, p2 - p0);
+                if (i0 == v0) p0 = positions[v1];
+                if (i1 == v0) p1 = positions[v1];
+                if (i2 == v0) p2 = positions[v1];
+                float3 nAfter = glm::cross(p1 - p0, p2 - p0);
+
+                if (glm::dot(nBefore, nAfter) <= 0.f) return false;
+            }
+            return true;
+        }
+    }
+
+    MeshSimplifier::Result MeshSimplifier::simplify(const float3* positions, size_t vertexCount, const uint32_t* indices, size_t indexCount, const Options& options)
+    {
+        assert(indexCount % 3 == 0);
+        assert(options.targetError >= 0.f);
+        assert(vertexCount <= std::numeric_limits<uint32_t>::max());
+
+        Result result;
+        result.indices.assign(indices, indices + indexCount);
+        if (indexCount <= options.targetIndexCount) return result;
+
+        const std::vector<bool> locked = findLockedVertices(positions, vertexCount, indices, indexCount);
+
+        std::vector<Quadric> quadrics(vertexCount);
+        for (size_t i = 0; i < indexCount; i += 3)
+        {
+            Quadric q = Quadric::fromTriangle(positions[indices[i]], positions[indices[i + 1]], positions[indices[i + 2]]);
+            for (uint32_t j = 0; j < 3; j++) quadrics[indices[i + j]] += q;
+        }
+
+        const size_t targetTriangleCount = options.targetIndexCount / 3;
+        const float maxSquaredError = options.targetError * options.targetError;
+        float maxCollapseError = 0.f;
+
+        VertexAdjacency adjacency;
+        std::vector<uint32_t> remap(vertexCount);
+        std::vector<bool> isVertexUsed(vertexCount);
+
+        // Each pass collapses a set of independent edges in order of increasing error.
+        // A collapse locks the one-ring of the removed vertex for the rest of the pass, so that the validity checks stay correct.
+        while (result.indices.size() / 3 > targetTriangleCount)
+        {
+            auto& current = result.indices;
+            adjacency.build(current, vertexCount);
+
+            // Collect one candidate per edge. Interior edges are visited twice, once from each triangle, so only the edge with a < b is used.
+            std::vector<Collapse> collapses;
+            collapses.reserve(current.size() / 2);
+            for (size_t i = 0; i < current.size(); i += 3)
+            {
+                for (uint32_t e = 0; e < 3; e++)
+                {
+                    uint32_t a = current[i + e], b = current[i + (e + 1) % 3];
+                    if (a > b || (locked[a] && locked[b])) continue;
+                    collapses.push_back({ a, b, 0.f });
+                }
+            }
+
+            auto range = NumericRange<size_t>(0, collapses.size());
+            std::for_each(std::execution::par, range.begin(), range.end(), [&](size_t i) {
+                // Pick the cheaper direction of collapsing the edge, vertices that are locked can't be removed.
+                Collapse& c = collapses[i];
+                float error01 = locked[c.v0] ? std::numeric_limits<float>::infinity() : computeCollapseError(quadrics, positions, c.v0, c.v1);
+                float error10 = locked[c.v1] ? std::numeric_limits<float>::infinity() : computeCollapseError(quadrics, positions, c.v1, c.v0);
+                if (error10 < error01) std::swap(c.v0, c.v1);
+                c.error = std::min(error01, error10);
+            });
+            std::sort(std::execution::par, collapses.begin(), collapses.end(), [](const Collapse& lhs, const Collapse& rhs) { return lhs.error < rhs.error; });
+
+            std::iota(remap.begin(), remap.end(), 0);
+            std::fill(isVertexUsed.begin(), isVertexUsed.end(), false);
+
+            size_t triangleCount = current.size() / 3;
+            size_t collapseCount = 0;
+            for (const auto& c : collapses)
+            {
+                if (c.error > maxSquaredError || triangleCount <= targetTriangleCount) break;
+                if (isVertexUsed[c.v0] || isVertexUsed[c.v1]) continue;
+                if (!isCollapseValid(current, adjacency, positions, c.v0, c.v1)) continue;
+
+                for (const uint32_t* t = adjacency.begin(c.v0); t != adjacency.end(c.v0); t++)
+                {
+                    bool isRemoved = false;
+                    for (uint32_t j = 0; j < 3; j++)
+                    {
+                        uint32_t v = current[*t * 3 + j];
+                        isVertexUsed[v] = true;
+                        isRemoved |= v == c.v1;
+                    }
+                    if (isRemoved) triangleCount--;
+                }
+
+                remap[c.v0] = c.v1;
+                quadrics[c.v1] += quadrics[c.v0];
+                maxCollapseError = std::max(maxCollapseError, c.error);
+                collapseCount++;
+            }
+
+            if (collapseCount == 0) break;
+
+            // Apply the collapses and remove degenerate triangles.
+            size_t writeIndex = 0;
+            for (size_t i = 0; i < current.size(); i += 3)
+            {
+                uint32_t i0 = remap[current[i]], i1 = remap[current[i + 1]], i2 = remap[current[i + 2]];
+                if (i0 == i1 || i1 == i2 || i2 == i0) continue;
+                current[writeIndex++] = i0;
+                current[writeIndex++] = i1;
+                current[writeIndex++] = i2;
+            }
+            current.resize(writeIndex);
+        }
+
+        result.error = std::sqrt(maxCollapseError);
+        return result;
+    }
+}
@@ -0,0 +1,73 @@
+/***************************************************************************
+ # Copyright (c) 2015-21, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#pragma once
+
+namespace Falcor
+{
+    /** Mesh simplification based on quadric error metrics (QEM).
+
+        Triangles are removed by iteratively collapsing edges onto one of their endpoints
+        in order of increasing quadric error [Garland and Heckbert 1997]. As no new vertices
+        are created, the simplified index list can share the vertex data of the input mesh,
+        which makes it suitable for storing levels of detail as extra index ranges.
+
+        Vertices on open mesh borders, on non-manifold edges and on attribute seams (multiple
+        vertices sharing the same position, e.g. due to texture coordinate or normal discontinuities)
+        are never moved. This preserves UV seams and material boundaries, as each mesh has a single material.
+    */
+    class dlldecl MeshSimplifier
+    {
+    public:
+        struct Options
+        {
+            size_t targetIndexCount = 0;                                ///< Target number of indices. Simplification stops once the mesh has this many indices or fewer.
+            float targetError = std::numeric_limits<float>::infinity(); ///< Max allowed geometric error as a distance in object space.
+        };
+
+        struct Result
+        {
+            std::vector<uint32_t> indices;  ///< Simplified triangle list indices referencing the input vertices.
+            float error = 0.f;              ///< Max geometric error of the performed edge collapses as a distance in object space.
+        };
+
+        /** Simplify a triangle mesh.
+            \param[in] positions Array of vertex positions.
+            \param[in] vertexCount Number of vertices.
+            \param[in] indices Array of triangle list indices.
+            \param[in] indexCount Number of indices. Must be a multiple of three.
+            \param[in] options Simplification options.
+            \return Simplified mesh. The triangle count is above the target if the target cannot be reached within the error bound.
+        */
+        static Result simplify(const float3* positions, size_t vertexCount, const uint32_t* indices, size_t indexCount, const Options& options);
+
+    private:
+        MeshSimplifier() = default;
+        MeshSimplifier(const MeshSimplifier&) = delete;
+        void operator=(const MeshSimplifier&) = delete;
+    };
+}
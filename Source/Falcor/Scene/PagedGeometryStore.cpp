@@ -0,0 +1,262 @@
+/***************************************************************************
+ # Copyright (c) 2015-21, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "stdafx.h"
+#include "PagedGeometryStore.h"
+
+namespace Falcor
+{
+    PagedGeometryStore::SharedPtr PagedGeometryStore::create(const std::filesystem::path& path, size_t pageSize, size_t residentBudget)
+    {
+        return SharedPtr(new PagedGeometryStore(path, pageSize, residentBudget));
+    }
+
+    PagedGeometryStore::PagedGeometryStore(const std::filesystem::path& path, size_t pageSize, size_t residentBudget)
+        : mPath(path)
+        , mPageSize(pageSize)
+        , mMaxResidentPageCount(std::max(residentBudget / pageSize, (size_t)1))
+    {
+        if (pageSize == 0) throw std::exception("PagedGeometryStore page size must be non-zero.");
+
+        mFile.open(path, std::ios::in | std::ios::out | std::ios::binary | std::ios::trunc);
+        if (!mFile.is_open())
+        {
+            throw std::exception(("Failed to create paged geometry store backing file '" + path.string() + "'.").c_str());
+        }
+    }
+
+    PagedGeometryStore::~PagedGeometryStore()
+    {
+        mFile.close();
+        std::error_code ec;
+        std::filesystem::remove(mPath, ec);
+    }
+
+    uint64_t PagedGeometryStore::append(const void* pData, size_t size)
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+
+        const uint64_t offset = mSize;
+        mSize += size;
+        mPages.resize(div_round_up(mSize, (uint64_t)mPageSize));
+
+        const uint8_t* pSrc = static_cast<const uint8_t*>(pData);
+        for (uint64_t pos = offset; pos < mSize;)
+        {
+            const size_t pageIndex = pos / mPageSize;
+            const size_t pageOffset = pos % mPageSize;
+            const size_t chunkSize = (size_t)std::min(mPageSize - pageOffset, mSize - pos);
+
+            uint8_t* pPage = acquirePage(pageIndex);
+            std::memcpy(pPage + pageOffset, pSrc, chunkSize);
+            mPages[pageIndex].isDirty = true;
+            releasePage(pageIndex);
+
+            pSrc += chunkSize;
+            pos += chunkSize;
+        }
+        return offset;
+    }
+
+    void PagedGeometryStore::read(uint64_t offset, size_t size, void* pDst)
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        assert(offset + size <= mSize);
+
+        uint8_t* pOut = static_cast<uint8_t*>(pDst);
+        for (uint64_t pos = offset; pos < offset + size;)
+        {
+            const size_t pageIndex = pos / mPageSize;
+            const size_t pageOffset = pos % mPageSize;
+            const size_t chunkSize = (size_t)std::min(mPageSize - pageOffset, offset + size - pos);
+
+            const uint8_t* pPage = acquirePage(pageIndex);
+            std::memcpy(pOut, pPage + pageOffset, chunkSize);
+            releasePage(pageIndex);
+
+            pOut += chunkSize;
+            pos += chunkSize;
+        }
+    }
+
+    void PagedGeometryStore::write(uint64_t offset, size_t size, const void* pSrc)
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        assert(offset + size <= mSize);
+
+        const uint8_t* pIn = static_cast<const uint8_t*>(pSrc);
+        for (uint64_t pos = offset; pos < offset + size;)
+        {
+            const size_t pageIndex = pos / mPageSize;
+            const size_t pageOffset = pos % mPageSize;
+            const size_t chunkSize = (size_t)std::min(mPageSize - pageOffset, offset + size - pos);
+
+            uint8_t* pPage = acquirePage(pageIndex);
+            std::memcpy(pPage + pageOffset, pIn, chunkSize);
+            mPages[pageIndex].isDirty = true;
+            releasePage(pageIndex);
+
+            pIn += chunkSize;
+            pos += chunkSize;
+        }
+    }
+
+    void PagedGeometryStore::pin(uint64_t offset, uint64_t size)
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        assert(offset + size <= mSize);
+        if (size == 0) return;
+
+        for (size_t pageIndex = offset / mPageSize; pageIndex <= (offset + size - 1) / mPageSize; pageIndex++)
+        {
+            acquirePage(pageIndex);
+        }
+    }
+
+    void PagedGeometryStore::unpin(uint64_t offset, uint64_t size)
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        assert(offset + size <= mSize);
+        if (size == 0) return;
+
+        for (size_t pageIndex = offset / mPageSize; pageIndex <= (offset + size - 1) / mPageSize; pageIndex++)
+        {
+            releasePage(pageIndex);
+        }
+    }
+
+    void PagedGeometryStore::forEachPage(uint64_t offset, uint64_t size, const std::function<void(uint64_t offset, const void* pData, size_t size)>& func)
+    {
+        std::unique_lock<std::mutex> lock(mMutex);
+        assert(offset + size <= mSize);
+
+        for (uint64_t pos = offset; pos < offset + size;)
+        {
+            const size_t pageIndex = pos / mPageSize;
+            const size_t pageOffset = pos % mPageSize;
+            const size_t chunkSize = (size_t)std::min(mPageSize - pageOffset, offset + size - pos);
+
+            // The page stays pinned while the lock is released for the callback.
+            const uint8_t* pPage = acquirePage(pageIndex);
+            lock.unlock();
+            func(pos, pPage + pageOffset, chunkSize);
+            lock.lock();
+            releasePage(pageIndex);
+
+            pos += chunkSize;
+        }
+    }
+
+    uint64_t PagedGeometryStore::getSize() const
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        return mSize;
+    }
+
+    PagedGeometryStore::Stats PagedGeometryStore::getStats() const
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        Stats stats = mStats;
+        stats.size = mSize;
+        stats.pageCount = mPages.size();
+        return stats;
+    }
+
+    uint8_t* PagedGeometryStore::acquirePage(size_t pageIndex)
+    {
+        assert(pageIndex < mPages.size());
+        Page& page = mPages[pageIndex];
+
+        if (!page.pData)
+        {
+            // Make room for the page before loading it, so that the budget is respected.
+            evictPages(mMaxResidentPageCount - 1);
+
+            page.pData = std::make_unique<uint8_t[]>(mPageSize);
+            if (page.isOnDisk)
+            {
+                mFile.seekg((std::streamoff)pageIndex * mPageSize);
+                mFile.read(reinterpret_cast<char*>(page.pData.get()), mPageSize);
+                if (!mFile) throw std::exception("Failed to read page from paged geometry store backing file.");
+                mStats.pageReadCount++;
+            }
+            else
+            {
+                std::memset(page.pData.get(), 0, mPageSize);
+            }
+
+            mStats.residentPageCount++;
+            mStats.peakResidentBytes = std::max(mStats.peakResidentBytes, (uint64_t)mStats.residentPageCount * mPageSize);
+        }
+        else if (page.pinCount == 0)
+        {
+            mLRU.erase(page.lruIt);
+        }
+
+        if (page.pinCount++ == 0) mStats.pinnedPageCount++;
+        return page.pData.get();
+    }
+
+    void PagedGeometryStore::releasePage(size_t pageIndex)
+    {
+        assert(pageIndex < mPages.size());
+        Page& page = mPages[pageIndex];
+        assert(page.pData && page.pinCount > 0);
+
+        if (--page.pinCount == 0)
+        {
+            mStats.pinnedPageCount--;
+            page.lruIt = mLRU.insert(mLRU.end(), pageIndex);
+            evictPages(mMaxResidentPageCount);
+        }
+    }
+
+    void PagedGeometryStore::evictPages(size_t maxResidentPageCount)
+    {
+        while (mStats.residentPageCount > maxResidentPageCount && !mLRU.empty())
+        {
+            const size_t pageIndex = mLRU.front();
+            mLRU.pop_front();
+
+            Page& page = mPages[pageIndex];
+            assert(page.pData && page.pinCount == 0);
+
+            if (page.isDirty)
+            {
+                mFile.seekp((std::streamoff)pageIndex * mPageSize);
+                mFile.write(reinterpret_cast<const char*>(page.pData.get()), mPageSize);
+                if (!mFile) throw std::exception("Failed to write page to paged geometry store backing file.");
+                page.isDirty = false;
+                page.isOnDisk = true;
+                mStats.pageWriteCount++;
+            }
+
+            page.pData.reset();
+            mStats.residentPageCount--;
+        }
+    }
+}
@@ -0,0 +1,166 @@
+/***************************************************************************
+ # Copyright (c) 2015-21, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#pragma once
+#include <filesystem>
+#include <fstream>
+#include <list>
+#include <mutex>
+
+namespace Falcor
+{
+    /** Paged out-of-core storage for scene geometry.
+
+        Data is appended to a linear 64-bit address space that is split into fixed-size pages.
+        The pages are written to a backing file and only a bounded set of pages is kept resident in memory.
+        Unpinned pages are evicted in least recently used order when the resident size exceeds the budget.
+        Pinned pages are never evicted, so the resident size can temporarily exceed the budget.
+
+        All functions are thread-safe.
+    */
+    class dlldecl PagedGeometryStore
+    {
+    public:
+        using SharedPtr = std::shared_ptr<PagedGeometryStore>;
+
+        static const size_t kDefaultPageSize = 16ull * 1024 * 1024;
+        static const size_t kDefaultResidentBudget = 1024ull * 1024 * 1024;
+
+        struct Stats
+        {
+            uint64_t size = 0;                  ///< Total size of the stored data in bytes.
+            size_t pageCount = 0;               ///< Total number of pages.
+            size_t residentPageCount = 0;       ///< Number of pages currently in memory.
+            size_t pinnedPageCount = 0;         ///< Number of pages currently pinned.
+            uint64_t peakResidentBytes = 0;     ///< Peak memory used by resident pages in bytes.
+            uint64_t pageReadCount = 0;         ///< Number of pages read from the backing file.
+            uint64_t pageWriteCount = 0;        ///< Number of pages written to the backing file.
+        };
+
+        /** Create a paged geometry store.
+            \param[in] path Path of the backing file. The file is created or truncated, and removed when the store is destroyed.
+            \param[in] pageSize Page size in bytes.
+            \param[in] residentBudget Max memory used by unpinned resident pages in bytes. At least one page is always kept resident.
+            \return New object, or throws an exception if the backing file can't be created.
+        */
+        static SharedPtr create(const std::filesystem::path& path, size_t pageSize = kDefaultPageSize, size_t residentBudget = kDefaultResidentBudget);
+
+        ~PagedGeometryStore();
+
+        /** Append data at the end of the store.
+            \param[in] pData Data to append.
+            \param[in] size Size in bytes.
+            \return Byte offset of the data in the store.
+        */
+        uint64_t append(const void* pData, size_t size);
+
+        /** Append the elements of a vector at the end of the store.
+            \return Byte offset of the data in the store.
+        */
+        template<typename T>
+        uint64_t append(const std::vector<T>& data) { return append(data.data(), data.size() * sizeof(T)); }
+
+        /** Read data from the store. The pages are loaded from the backing file if they are not resident.
+            \param[in] offset Byte offset in the store.
+            \param[in] size Size in bytes. The range must be within the store.
+            \param[out] pDst Destination buffer.
+        */
+        void read(uint64_t offset, size_t size, void* pDst);
+
+        /** Overwrite data in the store.
+            \param[in] offset Byte offset in the store.
+            \param[in] size Size in bytes. The range must be within the store.
+            \param[in] pSrc Source data.
+        */
+        void write(uint64_t offset, size_t size, const void* pSrc);
+
+        /** Pin all pages overlapping a range. Pinned pages are made resident and are not evicted until unpinned.
+            Pins are reference counted, each call must be matched by a call to unpin() with the same range.
+            \param[in] offset Byte offset in the store.
+            \param[in] size Size in bytes.
+        */
+        void pin(uint64_t offset, uint64_t size);
+
+        /** Unpin all pages overlapping a range.
+            \param[in] offset Byte offset in the store.
+            \param[in] size Size in bytes.
+        */
+        void unpin(uint64_t offset, uint64_t size);
+
+        /** Iterate over a range one page at a time. Each page is pinned during the callback.
+            This is used to upload large ranges to the GPU without loading them into memory at once.
+            \param[in] offset Byte offset in the store.
+            \param[in] size Size in bytes.
+            \param[in] func Function called with the byte offset, data pointer and size of each chunk, in order.
+        */
+        void forEachPage(uint64_t offset, uint64_t size, const std::function<void(uint64_t offset, const void* pData, size_t size)>& func);
+
+        /** Get the total size of the stored data in bytes.
+        */
+        uint64_t getSize() const;
+
+        /** Get the page size in bytes.
+        */
+        size_t getPageSize() const { return mPageSize; }
+
+        /** Get the max memory used by unpinned resident pages in bytes.
+        */
+        uint64_t getResidentBudget() const { return (uint64_t)mMaxResidentPageCount * mPageSize; }
+
+        /** Get statistics.
+        */
+        Stats getStats() const;
+
+    private:
+        PagedGeometryStore(const std::filesystem::path& path, size_t pageSize, size_t residentBudget);
+
+        struct Page
+        {
+            std::unique_ptr<uint8_t[]> pData;       ///< Page data, or nullptr if not resident.
+            uint32_t pinCount = 0;
+            bool isDirty = false;                   ///< True if the resident data differs from the backing file.
+            bool isOnDisk = false;                  ///< True if the page has been written to the backing file.
+            std::list<size_t>::iterator lruIt;      ///< Position in the LRU list. Only valid for resident unpinned pages.
+        };
+
+        uint8_t* acquirePage(size_t pageIndex);
+        void releasePage(size_t pageIndex);
+        void evictPages(size_t maxResidentPageCount);
+
+        std::filesystem::path mPath;
+        std::fstream mFile;
+        size_t mPageSize;
+        size_t mMaxResidentPageCount;
+
+        uint64_t mSize = 0;
+        std::vector<Page> mPages;
+        std::list<size_t> mLRU;                     ///< Resident unpinned pages, least recently used first.
+        Stats mStats;
+
+        mutable std::mutex mMutex;
+    };
+}
@@ -27,15 +27,22 @@
  **************************************************************************/
 #include "stdafx.h"
 #include "Scene.h"
+#include "HostRayTracer.h"
 #include "ScenePrimitiveDefines.slangh"
+#include "Utils/NumericRange.h"
 #include <sstream>
 #include <numeric>
+#include <execution>
+#include <atomic>
+#include <set>
 
 namespace Falcor
 {
     static_assert(sizeof(MeshDesc) % 16 == 0, "MeshDesc size should be a multiple of 16");
     static_assert(sizeof(PackedStaticVertexData) % 16 == 0, "PackedStaticVertexData size should be a multiple of 16");
+    static_assert(sizeof(CompactStaticVertexData) == 16, "CompactStaticVertexData size should be 16");
     static_assert(sizeof(PackedMeshInstanceData) % 16 == 0, "PackedMeshInstanceData size should be a multiple of 16");
+    static_assert(sizeof(WideMeshInstanceData) % 16 == 0, "WideMeshInstanceData size should be a multiple of 16");
     static_assert(PackedMeshInstanceData::kMatrixBits + PackedMeshInstanceData::kMeshBits + PackedMeshInstanceData::kFlagsBits + PackedMeshInstanceData::kMaterialBits <= 64);
 
     static_assert((uint32_t)PrimitiveTypeFlags::TriangleMesh == PRIMITIVE_TYPE_TRIANGLE_MESH, "Primitive type enum should match define constant for triangle mesh");
@@ -58,6 +65,7 @@ namespace Falcor
         const std::string kMeshInstanceBufferName = "meshInstances";
         const std::string kIndexBufferName = "indexData";
         const std::string kVertexBufferName = "vertices";
+        const std::string kVertexQuantizationBufferName = "vertexQuantization";
         const std::string kPrevVertexBufferName = "prevVertices";
         const std::string kProceduralPrimAABBBufferName = "proceduralPrimitiveAABBs";
         const std::string kCurveBufferName = "curves";
@@ -109,6 +117,11 @@ namespace Falcor
     Scene::Scene(SceneData&& sceneData, bool monochromeMode)
     {
         mMonochromeMode = monochromeMode;
+
+        // Build the host acceleration structure before the geometry is moved out of the scene data.
+        if (sceneData.buildHostRayTracer) mpHostRayTracer = HostRayTracer::create(sceneData);
+        mSceneCacheKey = sceneData.sceneCacheKey;
+
         // Copy/move scene data to member variables.
         mFilename = sceneData.filename;
         mRenderSettings = sceneData.renderSettings;
@@ -126,10 +139,13 @@ namespace Falcor
         mMeshDesc = std::move(sceneData.meshDesc);
         mMeshNames = std::move(sceneData.meshNames);
         mMeshBBs = std::move(sceneData.meshBBs);
+        mMeshLODs = std::move(sceneData.meshLODs);
         mMeshInstanceData = std::move(sceneData.meshInstanceData);
         mDisplacedMeshInstanceCount = sceneData.displacedMeshInstanceCount;
         mMeshIdToInstanceIds = std::move(sceneData.meshIdToInstanceIds);
         mMeshGroups = std::move(sceneData.meshGroups);
+        mUseCompactVertices = !sceneData.meshCompactStaticData.empty();
+        mMeshVertexQuantization = std::move(sceneData.meshVertexQuantization);
 
         mHas16BitIndices = sceneData.has16BitIndices;
         mHas32BitIndices = sceneData.has32BitIndices;
@@ -148,6 +164,21 @@ namespace Falcor
         mCustomPrimitiveDesc = std::move(sceneData.customPrimitiveDesc);
         mCustomPrimitiveAABBs = std::move(sceneData.customPrimitiveAABBs);
 
+        // Use the wide mesh instance format if the IDs don't fit in the packed format.
+        // The global matrices are one per scene graph node.
+        mUseWideMeshInstances = !PackedMeshInstanceData::isCompatible(mSceneGraph.size(), mMeshDesc.size(), mMaterials.size());
+        if (mUseWideMeshInstances) logInfo("Scene exceeds the packed mesh instance ID limits. Using wide mesh instance data.");
+
+        // Setup mesh ID -> LOD range map. The LODs are sorted by mesh ID.
+        mMeshLODRanges.resize(mMeshDesc.size(), uint2(0));
+        for (uint32_t i = 0; i < (uint32_t)mMeshLODs.size(); ++i)
+        {
+            uint2& range = mMeshLODRanges[mMeshLODs[i].meshID];
+            if (range.y == 0) range.x = i;
+            range.y++;
+        }
+        mMeshSelectedLODs.assign(mMeshDesc.size(), 0);
+
         for (const auto& pMaterial : mMaterials)
         {
             // Check for standard materials using the SpecGloss shading model.
@@ -174,8 +205,18 @@ namespace Falcor
         // Set default SDF grid config.
         setDefaultSDFGridConfig();
 
+        // Take ownership of the out-of-core mesh data, if any.
+        mpGeometryStore = sceneData.pGeometryStore;
+        mMeshIndexDataOffset = sceneData.meshIndexDataOffset;
+        mMeshIndexDataCount = sceneData.meshIndexDataCount;
+        mMeshStaticDataOffset = sceneData.meshStaticDataOffset;
+        mMeshStaticDataCount = sceneData.meshStaticDataCount;
+
+        // Keep host copies of the emissive mesh geometry for building the light collection on the host.
+        createHostMeshGeometry(sceneData);
+
         // Create vertex array objects for meshes and curves.
-        createMeshVao(sceneData.meshDrawCount, sceneData.meshIndexData, sceneData.meshStaticData, sceneData.meshDynamicData);
+        createMeshVao(sceneData.meshDrawCount, sceneData.meshIndexData, sceneData.meshStaticData, sceneData.meshCompactStaticData, sceneData.meshDynamicData);
         createCurveVao(mCurveIndexData, mCurveStaticData);
 
         // Create animation controller.
@@ -186,6 +227,8 @@ namespace Falcor
 
         // Finalize scene.
         finalize();
+
+        createUpdateScheduler();
     }
 
     Scene::SharedPtr Scene::create(const std::string& filename)
@@ -211,6 +254,8 @@ namespace Falcor
         defines.add("SCENE_HAS_INDEXED_VERTICES", hasIndexBuffer() ? "1" : "0");
         defines.add("SCENE_HAS_16BIT_INDICES", mHas16BitIndices ? "1" : "0");
         defines.add("SCENE_HAS_32BIT_INDICES", mHas32BitIndices ? "1" : "0");
+        defines.add("SCENE_USE_WIDE_MESH_INSTANCES", mUseWideMeshInstances ? "1" : "0");
+        defines.add("SCENE_USE_COMPACT_VERTICES", mUseCompactVertices ? "1" : "0");
         defines.add(mHitInfo.getDefines());
         defines.add("SCENE_PRIMITIVE_TYPE_FLAGS", std::to_string((uint)mPrimitiveTypes));
         defines.add("SCENE_HAS_SPEC_GLOSS_MATERIALS", mHasSpecGlossMaterials ? "1" : "0");
@@ -294,10 +339,17 @@ namespace Falcor
         pContext->raytrace(pProgram, pVars.get(), dispatchDims.x, dispatchDims.y, dispatchDims.z);
     }
 
-    void Scene::createMeshVao(uint32_t drawCount, const std::vector<uint32_t>& indexData, const std::vector<PackedStaticVertexData>& staticData, const std::vector<DynamicVertexData>& dynamicData)
+    void Scene::createMeshVao(uint32_t drawCount, const std::vector<uint32_t>& indexData, const std::vector<PackedStaticVertexData>& staticData, const std::vector<CompactStaticVertexData>& compactStaticData, const std::vector<DynamicVertexData>& dynamicData)
     {
+        // With out-of-core geometry the mesh data lives in the paged store and the in-memory lists are empty.
+        // With compact vertices the vertex data is only stored in the compact list.
+        assert(!(mUseCompactVertices && mpGeometryStore));
+        const uint64_t indexCount = mpGeometryStore ? mMeshIndexDataCount : indexData.size();
+        const uint64_t vertexCount = mpGeometryStore ? mMeshStaticDataCount : (mUseCompactVertices ? compactStaticData.size() : staticData.size());
+        const uint32_t vertexStride = mUseCompactVertices ? sizeof(CompactStaticVertexData) : sizeof(PackedStaticVertexData);
+
         // Create the index buffer.
-        size_t ibSize = sizeof(uint32_t) * indexData.size();
+        uint64_t ibSize = sizeof(uint32_t) * indexCount;
         if (ibSize > std::numeric_limits<uint32_t>::max())
         {
             throw std::exception("Index buffer size exceeds 4GB");
@@ -307,19 +359,22 @@ namespace Falcor
         if (ibSize > 0)
         {
             ResourceBindFlags ibBindFlags = Resource::BindFlags::Index | ResourceBindFlags::ShaderResource;
-            pIB = Buffer::create(ibSize, ibBindFlags, Buffer::CpuAccess::None, indexData.data());
+            pIB = Buffer::create((size_t)ibSize, ibBindFlags, Buffer::CpuAccess::None, mpGeometryStore ? nullptr : indexData.data());
+            if (mpGeometryStore) uploadFromGeometryStore(pIB, mMeshIndexDataOffset, ibSize);
         }
 
         // Create the vertex data structured buffer.
-        const size_t vertexCount = (uint32_t)staticData.size();
-        size_t staticVbSize = sizeof(PackedStaticVertexData) * vertexCount;
+        uint64_t staticVbSize = vertexStride * vertexCount;
         if (staticVbSize > std::numeric_limits<uint32_t>::max())
         {
             throw std::exception("Vertex buffer size exceeds 4GB");
         }
 
         ResourceBindFlags vbBindFlags = ResourceBindFlags::ShaderResource | ResourceBindFlags::UnorderedAccess | ResourceBindFlags::Vertex;
-        Buffer::SharedPtr pStaticBuffer = Buffer::createStructured(sizeof(PackedStaticVertexData), (uint32_t)vertexCount, vbBindFlags, Buffer::CpuAccess::None, nullptr, false);
+        // The full format vertices are uploaded by the animation controller, which also initializes the skinned vertices.
+        // Compact vertices are only used for static geometry and are uploaded directly.
+        Buffer::SharedPtr pStaticBuffer = Buffer::createStructured(vertexStride, (uint32_t)vertexCount, vbBindFlags, Buffer::CpuAccess::None, mUseCompactVertices ? compactStaticData.data() : nullptr, false);
+        if (mpGeometryStore) uploadFromGeometryStore(pStaticBuffer, mMeshStaticDataOffset, staticVbSize);
 
         Vao::BufferVec pVBs(kVertexBufferCount);
         pVBs[kStaticDataBufferIndex] = pStaticBuffer;
@@ -352,10 +407,18 @@ namespace Falcor
         VertexLayout::SharedPtr pLayout = VertexLayout::create();
 
         // Add the packed static vertex data layout.
+        // The compact format is passed as a single attribute and unpacked in the vertex shader, see Raster.slang.
         VertexBufferLayout::SharedPtr pStaticLayout = VertexBufferLayout::create();
-        pStaticLayout->addElement(VERTEX_POSITION_NAME, offsetof(PackedStaticVertexData, position), ResourceFormat::RGB32Float, 1, VERTEX_POSITION_LOC);
-        pStaticLayout->addElement(VERTEX_PACKED_NORMAL_TANGENT_NAME, offsetof(PackedStaticVertexData, packedNormalTangent), ResourceFormat::RGB32Float, 1, VERTEX_PACKED_NORMAL_TANGENT_LOC);
-        pStaticLayout->addElement(VERTEX_TEXCOORD_NAME, offsetof(PackedStaticVertexData, texCrd), ResourceFormat::RG32Float, 1, VERTEX_TEXCOORD_LOC);
+        if (mUseCompactVertices)
+        {
+            pStaticLayout->addElement(VERTEX_COMPACT_DATA_NAME, offsetof(CompactStaticVertexData, packedData), ResourceFormat::RGBA32Uint, 1, VERTEX_COMPACT_DATA_LOC);
+        }
+        else
+        {
+            pStaticLayout->addElement(VERTEX_POSITION_NAME, offsetof(PackedStaticVertexData, position), ResourceFormat::RGB32Float, 1, VERTEX_POSITION_LOC);
+            pStaticLayout->addElement(VERTEX_PACKED_NORMAL_TANGENT_NAME, offsetof(PackedStaticVertexData, packedNormalTangent), ResourceFormat::RGB32Float, 1, VERTEX_PACKED_NORMAL_TANGENT_LOC);
+            pStaticLayout->addElement(VERTEX_TEXCOORD_NAME, offsetof(PackedStaticVertexData, texCrd), ResourceFormat::RG32Float, 1, VERTEX_TEXCOORD_LOC);
+        }
         pLayout->addBufferLayout(kStaticDataBufferIndex, pStaticLayout);
 
         // Add the draw ID layout.
@@ -371,6 +434,139 @@ namespace Falcor
         mpVao16Bit = Vao::create(Vao::Topology::TriangleList, pLayout, pVBs, pIB, ResourceFormat::R16Uint);
     }
 
+    void Scene::uploadFromGeometryStore(const Buffer::SharedPtr& pBuffer, uint64_t offset, uint64_t size)
+    {
+        assert(mpGeometryStore && pBuffer && size <= pBuffer->getSize());
+
+        // Upload page by page so that only a bounded number of pages is resident at any time.
+        // The staging memory of the uploads is only released once the GPU has executed them, so we flush and wait
+        // whenever the staged data reaches the resident budget of the store. This bounds the memory used for staging.
+        const uint64_t maxStagedSize = mpGeometryStore->getResidentBudget();
+        uint64_t stagedSize = 0;
+        mpGeometryStore->forEachPage(offset, size, [&](uint64_t pos, const void* pData, size_t chunkSize)
+        {
+            pBuffer->setBlob(pData, (size_t)(pos - offset), chunkSize);
+            stagedSize += chunkSize;
+            if (stagedSize >= maxStagedSize)
+            {
+                gpDevice->flushAndSync();
+                stagedSize = 0;
+            }
+        });
+    }
+
+    void Scene::forEachMeshGroupGeometryRange(uint32_t groupID, const std::function<void(uint64_t offset, uint64_t size)>& func) const
+    {
+        assert(groupID < mMeshGroups.size());
+        for (uint32_t meshID : mMeshGroups[groupID].meshList)
+        {
+            const MeshDesc& mesh = mMeshDesc[meshID];
+            func(mMeshStaticDataOffset + sizeof(PackedStaticVertexData) * (uint64_t)mesh.vbOffset, sizeof(PackedStaticVertexData) * (uint64_t)mesh.vertexCount);
+
+            if (mesh.indexCount > 0)
+            {
+                const uint64_t wordCount = mesh.use16BitIndices() ? div_round_up(mesh.indexCount, 2u) : mesh.indexCount;
+                func(mMeshIndexDataOffset + sizeof(uint32_t) * (uint64_t)mesh.ibOffset, sizeof(uint32_t) * wordCount);
+            }
+
+            const uint2 lodRange = mMeshLODRanges[meshID];
+            for (uint32_t i = lodRange.x; i < lodRange.x + lodRange.y; i++)
+            {
+                const MeshLODDesc& lod = mMeshLODs[i];
+                const uint64_t wordCount = mesh.use16BitIndices() ? div_round_up(lod.indexCount, 2u) : lod.indexCount;
+                func(mMeshIndexDataOffset + sizeof(uint32_t) * (uint64_t)lod.ibOffset, sizeof(uint32_t) * wordCount);
+            }
+        }
+    }
+
+    void Scene::createHostMeshGeometry(const SceneData& sceneData)
+    {
+        // Find the static meshes used by instances with emissive materials.
+        std::set<uint32_t> cachedMeshIDs;
+        for (const auto& cachedMesh : sceneData.cachedMeshes) cachedMeshIDs.insert(cachedMesh.meshID);
+
+        std::vector<uint32_t> meshIDs;
+        for (const auto& inst : mMeshInstanceData)
+        {
+            auto pMaterial = mMaterials[inst.materialID]->toBasicMaterial();
+            if (!pMaterial || !pMaterial->isEmissive()) continue;
+
+            const MeshDesc& mesh = mMeshDesc[inst.meshID];
+            if (mesh.hasDynamicData() || cachedMeshIDs.count(inst.meshID) > 0) continue;
+            if (mHostMeshGeometry.count(inst.meshID) > 0) continue;
+
+            mHostMeshGeometry[inst.meshID] = {};
+            meshIDs.push_back(inst.meshID);
+        }
+
+        // Copy positions, texture coordinates and 32-bit indices, either from the scene data or from the out-of-core store.
+        NumericRange<uint32_t> range(0, (uint32_t)meshIDs.size());
+        std::for_each(std::execution::par, range.begin(), range.end(), [&](uint32_t i)
+        {
+            const uint32_t meshID = meshIDs[i];
+            const MeshDesc& mesh = mMeshDesc[meshID];
+            HostMeshGeometry& geometry = mHostMeshGeometry.at(meshID);
+
+            std::vector<PackedStaticVertexData> vertices(mesh.vertexCount);
+            if (mpGeometryStore) mpGeometryStore->read(mMeshStaticDataOffset + sizeof(PackedStaticVertexData) * (uint64_t)mesh.vbOffset, sizeof(PackedStaticVertexData) * vertices.size(), vertices.data());
+            else if (mUseCompactVertices)
+            {
+                const VertexQuantization& q = mMeshVertexQuantization[meshID];
+                for (uint32_t v = 0; v < mesh.vertexCount; v++) vertices[v] = PackedStaticVertexData(sceneData.meshCompactStaticData[mesh.vbOffset + v].unpack(q));
+            }
+            else std::copy_n(sceneData.meshStaticData.begin() + mesh.vbOffset, mesh.vertexCount, vertices.begin());
+
+            geometry.positions.resize(mesh.vertexCount);
+            geometry.texCrds.resize(mesh.vertexCount);
+            for (uint32_t v = 0; v < mesh.vertexCount; v++)
+            {
+                geometry.positions[v] = vertices[v].position;
+                geometry.texCrds[v] = vertices[v].texCrd;
+            }
+
+            const uint32_t indexCount = mesh.getTriangleCount() * 3;
+            geometry.indices.resize(indexCount);
+            if (mesh.indexCount > 0)
+            {
+                std::vector<uint32_t> words(mesh.use16BitIndices() ? div_round_up(mesh.indexCount, 2u) : mesh.indexCount);
+                if (mpGeometryStore) mpGeometryStore->read(mMeshIndexDataOffset + sizeof(uint32_t) * (uint64_t)mesh.ibOffset, sizeof(uint32_t) * words.size(), words.data());
+                else std::copy_n(sceneData.meshIndexData.begin() + mesh.ibOffset, words.size(), words.begin());
+
+                if (mesh.use16BitIndices())
+                {
+                    const uint16_t* pIndices = reinterpret_cast<const uint16_t*>(words.data());
+                    std::copy_n(pIndices, indexCount, geometry.indices.begin());
+                }
+                else
+                {
+                    std::copy_n(words.begin(), indexCount, geometry.indices.begin());
+                }
+            }
+            else
+            {
+                std::iota(geometry.indices.begin(), geometry.indices.end(), 0u);
+            }
+        });
+    }
+
+    const Scene::HostMeshGeometry* Scene::getHostMeshGeometry(uint32_t meshID) const
+    {
+        auto it = mHostMeshGeometry.find(meshID);
+        return it != mHostMeshGeometry.end() ? &it->second : nullptr;
+    }
+
+    void Scene::pinMeshGroupGeometry(uint32_t groupID)
+    {
+        if (!mpGeometryStore) return;
+        forEachMeshGroupGeometryRange(groupID, [&](uint64_t offset, uint64_t size) { mpGeometryStore->pin(offset, size); });
+    }
+
+    void Scene::unpinMeshGroupGeometry(uint32_t groupID)
+    {
+        if (!mpGeometryStore) return;
+        forEachMeshGroupGeometryRange(groupID, [&](uint64_t offset, uint64_t size) { mpGeometryStore->unpin(offset, size); });
+    }
+
     void Scene::createCurveVao(const std::vector<uint32_t>& indexData, const std::vector<StaticCurveVertexData>& staticData)
     {
         if (indexData.empty() || staticData.empty()) return;
@@ -440,6 +636,11 @@ namespace Falcor
         mpSceneBlock = ParameterBlock::create(pReflection);
         mpMeshesBuffer = Buffer::createStructured(mpSceneBlock[kMeshBufferName], (uint32_t)mMeshDesc.size(), Resource::BindFlags::ShaderResource, Buffer::CpuAccess::None, nullptr, false);
         mpMeshesBuffer->setName("Scene::mpMeshesBuffer");
+        if (mUseCompactVertices)
+        {
+            mpVertexQuantizationBuffer = Buffer::createStructured(mpSceneBlock[kVertexQuantizationBufferName], (uint32_t)mMeshVertexQuantization.size(), Resource::BindFlags::ShaderResource, Buffer::CpuAccess::None, mMeshVertexQuantization.data(), false);
+            mpVertexQuantizationBuffer->setName("Scene::mpVertexQuantizationBuffer");
+        }
         mpMeshInstancesBuffer = Buffer::createStructured(mpSceneBlock[kMeshInstanceBufferName], (uint32_t)mMeshInstanceData.size(), Resource::BindFlags::ShaderResource, Buffer::CpuAccess::None, nullptr, false);
         mpMeshInstancesBuffer->setName("Scene::mpMeshInstancesBuffer");
 
@@ -488,6 +689,7 @@ namespace Falcor
 
         mpSceneBlock->setBuffer(kMeshInstanceBufferName, mpMeshInstancesBuffer);
         mpSceneBlock->setBuffer(kMeshBufferName, mpMeshesBuffer);
+        if (mUseCompactVertices) mpSceneBlock->setBuffer(kVertexQuantizationBufferName, mpVertexQuantizationBuffer);
         mpSceneBlock->setBuffer(kCurveInstanceBufferName, mpCurveInstancesBuffer);
         mpSceneBlock->setBuffer(kCurveBufferName, mpCurvesBuffer);
         mpSceneBlock->setBuffer(kSDFGridInstancesBufferName, mpSDFGridInstancesBuffer);
@@ -595,13 +797,93 @@ namespace Falcor
             std::min(std::min(mSceneBB.extent().x, mSceneBB.extent().y), mSceneBB.extent().z));
     }
 
-    void Scene::updateMeshInstances(bool forceUpdate)
+    void Scene::selectMeshLODs(uint32_t viewportHeight, float maxPixelError)
     {
-        bool dataChanged = false;
+        if (mMeshLODs.empty()) return;
+
+        const auto& pCamera = getCamera();
+        const float3 cameraPos = pCamera->getPosition();
+
+        // Pixels covered by a unit length at unit distance.
+        const float pixelScale = viewportHeight * pCamera->getFocalLength() / pCamera->getFrameHeight();
+
         const auto& globalMatrices = mpAnimationController->getGlobalMatrices();
 
+        // Start from the coarsest LOD of each mesh and refine it to the finest LOD required by any of its instances.
+        std::vector<uint32_t> meshLODs(mMeshDesc.size());
+        for (uint32_t meshID = 0; meshID < (uint32_t)mMeshDesc.size(); ++meshID) meshLODs[meshID] = mMeshLODRanges[meshID].y;
+
+        for (uint32_t instanceID = 0; instanceID < (uint32_t)mMeshInstanceData.size(); ++instanceID)
+        {
+            const auto& inst = mMeshInstanceData[instanceID];
+            const uint2 range = mMeshLODRanges[inst.meshID];
+            if (range.y == 0) continue;
+
+            // The light collection is built from the triangles of emissive meshes, so their LOD can't change.
+            if (mMaterials[inst.materialID]->isEmissive())
+            {
+                meshLODs[inst.meshID] = std::min(meshLODs[inst.meshID], mMeshSelectedLODs[inst.meshID]);
+                continue;
+            }
+
+            const glm::mat4& transform = globalMatrices[inst.globalMatrixID];
+            const AABB bounds = mMeshBBs[inst.meshID].transform(transform);
+            const float distance = glm::length(bounds.center() - cameraPos) - bounds.radius();
+            if (distance <= 0.f)
+            {
+                meshLODs[inst.meshID] = 0;
+                continue;
+            }
+
+            // The LOD errors are in object space, scale them conservatively by the largest axis scale.
+            const float scale = std::max(std::max(glm::length(float3(transform[0])), glm::length(float3(transform[1]))), glm::length(float3(transform[2])));
+            const float errorScale = scale * pixelScale / distance;
+
+            uint32_t lod = range.y;
+            while (lod > 0 && mMeshLODs[range.x + lod - 1].error * errorScale > maxPixelError) --lod;
+            meshLODs[inst.meshID] = std::min(meshLODs[inst.meshID], lod);
+        }
+
+        if (meshLODs == mMeshSelectedLODs) return;
+        mMeshSelectedLODs = std::move(meshLODs);
+
+        // Point the instances to the index data of the selected LODs. The draw arguments and BLASes use the same ranges.
         for (auto& inst : mMeshInstanceData)
         {
+            if (mMeshLODRanges[inst.meshID].y > 0) inst.ibOffset = getMeshIndexRange(inst.meshID).x;
+        }
+        updateMeshInstances(true);
+        createDrawList();
+
+        // Clear the BLAS data. This will trigger a full BLAS/TLAS rebuild with the new index ranges.
+        mBlasData.clear();
+    }
+
+    uint2 Scene::getMeshIndexRange(uint32_t meshID) const
+    {
+        const MeshDesc& mesh = mMeshDesc[meshID];
+        const uint32_t lod = mMeshSelectedLODs[meshID];
+        if (lod == 0) return uint2(mesh.ibOffset, mesh.indexCount);
+
+        const MeshLODDesc& lodDesc = getMeshLOD(meshID, lod);
+        return uint2(lodDesc.ibOffset, lodDesc.indexCount);
+    }
+
+    void Scene::updateMeshInstances(bool forceUpdate)
+    {
+        prepareMeshInstanceUpdates(forceUpdate);
+        commitMeshInstanceUpdates();
+    }
+
+    void Scene::prepareMeshInstanceUpdates(bool forceUpdate)
+    {
+        std::atomic<bool> dataChanged{ false };
+        const auto& globalMatrices = mpAnimationController->getGlobalMatrices();
+
+        NumericRange<size_t> instanceRange(0, mMeshInstanceData.size());
+        std::for_each(std::execution::par, instanceRange.begin(), instanceRange.end(), [&](size_t instanceID)
+        {
+            auto& inst = mMeshInstanceData[instanceID];
             uint32_t prevFlags = inst.flags;
 
             const glm::mat4& transform = globalMatrices[inst.globalMatrixID];
@@ -618,10 +900,24 @@ namespace Falcor
             if (isWorldFrontFaceCW) inst.flags |= (uint32_t)MeshInstanceFlags::IsWorldFrontFaceCW;
             else inst.flags &= ~(uint32_t)MeshInstanceFlags::IsWorldFrontFaceCW;
 
-            dataChanged |= (inst.flags != prevFlags);
-        }
+            if (inst.flags != prevFlags) dataChanged.store(true, std::memory_order_relaxed);
+        });
+
+        mMeshInstancesDirty = forceUpdate || dataChanged;
+        if (!mMeshInstancesDirty) return;
 
-        if (forceUpdate || dataChanged)
+        assert(mMeshInstanceData.size() > 0);
+
+        if (mUseWideMeshInstances)
+        {
+            // Prepare wide mesh instance data.
+            mWideMeshInstanceData.resize(mMeshInstanceData.size());
+            std::for_each(std::execution::par, instanceRange.begin(), instanceRange.end(), [&](size_t i)
+            {
+                mWideMeshInstanceData[i].pack(mMeshInstanceData[i]);
+            });
+        }
+        else
         {
             // Make sure the scene data fits in the packed format.
             size_t maxMatrices = 1 << PackedMeshInstanceData::kMatrixBits;
@@ -643,18 +939,32 @@ namespace Falcor
             }
 
             // Prepare packed mesh instance data.
-            assert(mMeshInstanceData.size() > 0);
             mPackedMeshInstanceData.resize(mMeshInstanceData.size());
-
-            for (size_t i = 0; i < mMeshInstanceData.size(); i++)
+            std::for_each(std::execution::par, instanceRange.begin(), instanceRange.end(), [&](size_t i)
             {
                 mPackedMeshInstanceData[i].pack(mMeshInstanceData[i]);
-            }
+            });
+        }
+    }
+
+    void Scene::commitMeshInstanceUpdates()
+    {
+        if (!mMeshInstancesDirty) return;
 
+        if (mUseWideMeshInstances)
+        {
+            size_t byteSize = sizeof(WideMeshInstanceData) * mWideMeshInstanceData.size();
+            assert(mpMeshInstancesBuffer && mpMeshInstancesBuffer->getSize() == byteSize);
+            mpMeshInstancesBuffer->setBlob(mWideMeshInstanceData.data(), 0, byteSize);
+        }
+        else
+        {
             size_t byteSize = sizeof(PackedMeshInstanceData) * mPackedMeshInstanceData.size();
             assert(mpMeshInstancesBuffer && mpMeshInstancesBuffer->getSize() == byteSize);
             mpMeshInstancesBuffer->setBlob(mPackedMeshInstanceData.data(), 0, byteSize);
         }
+
+        mMeshInstancesDirty = false;
     }
 
     Scene::UpdateFlags Scene::updateRaytracingAABBData(bool forceUpdate)
@@ -1091,6 +1401,7 @@ namespace Falcor
         }
 
         s.geometryMemoryInBytes += mpMeshesBuffer ? mpMeshesBuffer->getSize() : 0;
+        s.geometryMemoryInBytes += mpVertexQuantizationBuffer ? mpVertexQuantizationBuffer->getSize() : 0;
         s.geometryMemoryInBytes += mpMeshInstancesBuffer ? mpMeshInstancesBuffer->getSize() : 0;
         s.geometryMemoryInBytes += mpCustomPrimitivesBuffer ? mpCustomPrimitivesBuffer->getSize() : 0;
         s.geometryMemoryInBytes += mpRtAABBBuffer ? mpRtAABBBuffer->getSize() : 0;
@@ -1170,6 +1481,7 @@ namespace Falcor
         }
         if (mpBlasScratch) s.blasScratchMemoryInBytes += mpBlasScratch->getSize();
         if (mpBlasStaticWorldMatrices) s.blasScratchMemoryInBytes += mpBlasStaticWorldMatrices->getSize();
+        if (mpBlasCompactVertexMatrices) s.blasScratchMemoryInBytes += mpBlasCompactVertexMatrices->getSize();
     }
 
     void Scene::updateRaytracingTLASStats()
@@ -1267,7 +1579,7 @@ namespace Falcor
         return false;
     }
 
-    Scene::UpdateFlags Scene::updateSelectedCamera(bool forceUpdate)
+    void Scene::prepareSelectedCameraUpdate(bool forceUpdate)
     {
         auto camera = mCameras[mSelectedCamera];
 
@@ -1280,8 +1592,13 @@ namespace Falcor
             mpCamCtrl->update();
         }
 
+        mSelectedCameraChanges = camera->beginFrame();
+    }
+
+    Scene::UpdateFlags Scene::commitSelectedCameraUpdate()
+    {
         UpdateFlags flags = UpdateFlags::None;
-        auto cameraChanges = camera->beginFrame();
+        const auto cameraChanges = mSelectedCameraChanges;
         if (mCameraSwitched || cameraChanges != Camera::Changes::None)
         {
             uploadSelectedCamera();
@@ -1294,6 +1611,12 @@ namespace Falcor
     }
 
     Scene::UpdateFlags Scene::updateLights(bool forceUpdate)
+    {
+        prepareLightUpdates(forceUpdate);
+        return commitLightUpdates(forceUpdate);
+    }
+
+    void Scene::prepareLightUpdates(bool forceUpdate)
     {
         Light::Changes combinedChanges = Light::Changes::None;
 
@@ -1309,23 +1632,42 @@ namespace Falcor
             combinedChanges |= changes;
         }
 
-        // Update changed lights.
+        // Stage the data of all active lights and track the range of changed lights.
+        // The range is uploaded with a single copy in commitLightUpdates().
+        mLightStagingData.resize(mLights.size());
+        mLightUploadRange = { 0, 0 };
         mActiveLightCount = 0;
 
         for (const auto& light : mLights)
         {
             if (!light->isActive()) continue;
 
+            mLightStagingData[mActiveLightCount] = light->getData();
+
             auto changes = light->getChanges();
             if (changes != Light::Changes::None || is_set(combinedChanges, Light::Changes::Active) || forceUpdate)
             {
-                // TODO: This is slow since the buffer is not CPU writable. Copy into CPU buffer and upload once instead.
-                mpLightsBuffer->setElement(mActiveLightCount, light->getData());
+                if (mLightUploadRange.x == mLightUploadRange.y) mLightUploadRange.x = mActiveLightCount;
+                mLightUploadRange.y = mActiveLightCount + 1;
             }
 
             mActiveLightCount++;
         }
 
+        mLightChanges = combinedChanges;
+    }
+
+    Scene::UpdateFlags Scene::commitLightUpdates(bool forceUpdate)
+    {
+        const Light::Changes combinedChanges = mLightChanges;
+
+        // Upload changed lights.
+        if (mLightUploadRange.y > mLightUploadRange.x)
+        {
+            const uint32_t count = mLightUploadRange.y - mLightUploadRange.x;
+            mpLightsBuffer->setBlob(&mLightStagingData[mLightUploadRange.x], mLightUploadRange.x * sizeof(LightData), count * sizeof(LightData));
+        }
+
         if (combinedChanges != Light::Changes::None || forceUpdate)
         {
             mpSceneBlock["lightCount"] = mActiveLightCount;
@@ -1345,6 +1687,12 @@ namespace Falcor
     }
 
     Scene::UpdateFlags Scene::updateGridVolumes(bool forceUpdate)
+    {
+        prepareGridVolumeUpdates(forceUpdate);
+        return commitGridVolumeUpdates(forceUpdate);
+    }
+
+    void Scene::prepareGridVolumeUpdates(bool forceUpdate)
     {
         GridVolume::UpdateFlags combinedUpdates = GridVolume::UpdateFlags::None;
 
@@ -1355,6 +1703,13 @@ namespace Falcor
             combinedUpdates |= pGridVolume->getUpdates();
         }
 
+        mGridVolumeUpdates = combinedUpdates;
+    }
+
+    Scene::UpdateFlags Scene::commitGridVolumeUpdates(bool forceUpdate)
+    {
+        const GridVolume::UpdateFlags combinedUpdates = mGridVolumeUpdates;
+
         // Early out if no volumes have changed.
         if (!forceUpdate && combinedUpdates == GridVolume::UpdateFlags::None) return UpdateFlags::None;
 
@@ -1492,68 +1847,120 @@ namespace Falcor
         return flags;
     }
 
-    Scene::UpdateFlags Scene::update(RenderContext* pContext, double currentTime)
+    void Scene::createUpdateScheduler()
     {
-        // Run scene update callback.
-        if (mUpdateCallback) mUpdateCallback(shared_from_this(), currentTime);
+        // The stages below replace the sequential update*() calls. Stages that only touch CPU state of their own
+        // objects (camera and light animation, grid volume playback, mesh instance packing) do their work in the
+        // prepare function, which runs in parallel with the other stages of the same wave. Everything that
+        // uploads data or records GPU work runs in the commit functions on the render thread.
+        auto& s = mUpdateScheduler;
 
-        mUpdates = UpdateFlags::None;
-
-        if (mpAnimationController->animate(pContext, currentTime))
+        auto animation = s.addStage("Animation", nullptr, [this]()
         {
-            mUpdates |= UpdateFlags::SceneGraphChanged;
-            for (const auto& inst : mMeshInstanceData)
+            if (mpAnimationController->animate(mpUpdateContext, mUpdateTime))
             {
-                if (mpAnimationController->isMatrixChanged(inst.globalMatrixID))
+                mUpdates |= UpdateFlags::SceneGraphChanged;
+                for (const auto& inst : mMeshInstanceData)
                 {
-                    mUpdates |= UpdateFlags::MeshesMoved;
+                    if (mpAnimationController->isMatrixChanged(inst.globalMatrixID))
+                    {
+                        mUpdates |= UpdateFlags::MeshesMoved;
+                    }
                 }
+
+                // We might end up setting the flag even if curves haven't changed (if looping is disabled for example).
+                if (mpAnimationController->hasAnimatedCurveCaches()) mUpdates |= UpdateFlags::CurvesMoved;
             }
+        });
 
-            // We might end up setting the flag even if curves haven't changed (if looping is disabled for example).
-            if (mpAnimationController->hasAnimatedCurveCaches()) mUpdates |= UpdateFlags::CurvesMoved;
-        }
+        s.addStage("EnvMap", nullptr, [this]() { mUpdates |= updateEnvMap(false); });
 
-        for (const auto& pGridVolume : mGridVolumes)
-        {
-            pGridVolume->updatePlayback(currentTime);
-        }
+        // Material updates may request a displacement update, which is handled by the geometry stage.
+        auto materials = s.addStage("Materials", nullptr, [this]() { mUpdates |= updateMaterials(false); });
 
-        mUpdates |= updateSelectedCamera(false);
-        mUpdates |= updateLights(false);
-        mUpdates |= updateGridVolumes(false);
-        mUpdates |= updateEnvMap(false);
-        mUpdates |= updateMaterials(false);
-        mUpdates |= updateGeometry(false);
-        pContext->flush();
+        s.addStage("Camera",
+            [this]() { prepareSelectedCameraUpdate(false); },
+            [this]() { mUpdates |= commitSelectedCameraUpdate(); },
+            { animation });
 
-        if (is_set(mUpdates, UpdateFlags::MeshesMoved))
-        {
-            mTlasCache.clear();
-            updateMeshInstances(false);
-        }
+        s.addStage("Lights",
+            [this]() { prepareLightUpdates(false); },
+            [this]() { mUpdates |= commitLightUpdates(false); },
+            { animation });
 
-        // Update existing BLASes if skinned animation and/or procedural primitives moved.
-        bool skinnedAnimation = mHasSkinnedMesh && is_set(mUpdates, UpdateFlags::SceneGraphChanged);
-        bool updateProcedural = is_set(mUpdates, UpdateFlags::CurvesMoved) || is_set(mUpdates, UpdateFlags::CustomPrimitivesMoved);
-        bool blasUpdateRequired = skinnedAnimation || updateProcedural;
+        s.addStage("GridVolumes",
+            [this]()
+            {
+                for (const auto& pGridVolume : mGridVolumes) pGridVolume->updatePlayback(mUpdateTime);
+                prepareGridVolumeUpdates(false);
+            },
+            [this]() { mUpdates |= commitGridVolumeUpdates(false); },
+            { animation });
 
-        if (!mBlasData.empty() && blasUpdateRequired)
+        auto geometry = s.addStage("Geometry", nullptr, [this]()
         {
-            mTlasCache.clear();
-            buildBlas(pContext);
-        }
+            mUpdates |= updateGeometry(false);
+            mpUpdateContext->flush();
+        },
+        { animation, materials });
+
+        auto meshInstances = s.addStage("MeshInstances",
+            [this]()
+            {
+                if (!is_set(mUpdates, UpdateFlags::MeshesMoved)) return;
+                prepareMeshInstanceUpdates(false);
+                if (mpHostRayTracer) mpHostRayTracer->setInstanceTransforms(mpAnimationController->getGlobalMatrices());
+            },
+            [this]()
+            {
+                if (!is_set(mUpdates, UpdateFlags::MeshesMoved)) return;
+                mTlasCache.clear();
+                commitMeshInstanceUpdates();
+            },
+            { animation });
 
-        // Update light collection
-        if (mpLightCollection && mpLightCollection->update(pContext))
+        // Update existing BLASes if skinned animation and/or procedural primitives moved.
+        s.addStage("BLAS", nullptr, [this]()
         {
-            mUpdates |= UpdateFlags::LightCollectionChanged;
-            mSceneStats.emissiveMemoryInBytes = mpLightCollection->getMemoryUsageInBytes();
-        }
-        else if (!mpLightCollection)
+            bool skinnedAnimation = mHasSkinnedMesh && is_set(mUpdates, UpdateFlags::SceneGraphChanged);
+            bool updateProcedural = is_set(mUpdates, UpdateFlags::CurvesMoved) || is_set(mUpdates, UpdateFlags::CustomPrimitivesMoved);
+            bool blasUpdateRequired = skinnedAnimation || updateProcedural;
+
+            if (!mBlasData.empty() && blasUpdateRequired)
+            {
+                mTlasCache.clear();
+                buildBlas(mpUpdateContext);
+            }
+        },
+        { geometry, meshInstances });
+
+        // Update light collection. This reads the mesh instance data, so it must not overlap with the mesh instance stage.
+        s.addStage("LightCollection", nullptr, [this]()
         {
-            mSceneStats.emissiveMemoryInBytes = 0;
-        }
+            if (mpLightCollection && mpLightCollection->update(mpUpdateContext))
+            {
+                mUpdates |= UpdateFlags::LightCollectionChanged;
+                mSceneStats.emissiveMemoryInBytes = mpLightCollection->getMemoryUsageInBytes();
+            }
+            else if (!mpLightCollection)
+            {
+                mSceneStats.emissiveMemoryInBytes = 0;
+            }
+        },
+        { meshInstances });
+    }
+
+    Scene::UpdateFlags Scene::update(RenderContext* pContext, double currentTime)
+    {
+        // Run scene update callback.
+        if (mUpdateCallback) mUpdateCallback(shared_from_this(), currentTime);
+
+        mUpdates = UpdateFlags::None;
+
+        mpUpdateContext = pContext;
+        mUpdateTime = currentTime;
+        mUpdateScheduler.execute();
+        mpUpdateContext = nullptr;
 
         if (mRenderSettings != mPrevRenderSettings)
         {
@@ -1890,6 +2297,17 @@ namespace Falcor
                 << "  Grid memory: " << formatByteSize(s.gridMemoryInBytes) << std::endl
                 << std::endl;
 
+            // Update timings.
+            const auto& updateStats = mUpdateScheduler.getStats();
+            auto formatTime = [](double ms) { std::ostringstream s; s << std::fixed << std::setprecision(3) << ms << " ms"; return s.str(); };
+            oss << "Update timings (last frame):" << std::endl;
+            for (const auto& stage : updateStats.stages)
+            {
+                oss << "  " << stage.name << " (wave " << stage.wave << "): prepare " << formatTime(stage.prepareTime) << ", commit " << formatTime(stage.commitTime) << std::endl;
+            }
+            oss << "  Total: " << formatTime(updateStats.totalTime) << " (serial " << formatTime(updateStats.serialTime) << ")" << std::endl
+                << std::endl;
+
             if (statsGroup.button("Print to log")) logInfo("\n" + oss.str());
 
             statsGroup.text(oss.str());
@@ -2240,10 +2658,12 @@ namespace Falcor
                 const auto& mesh = mMeshDesc[instance.meshID];
                 bool use16Bit = mesh.use16BitIndices();
 
+                const uint2 indexRange = getMeshIndexRange(instance.meshID);
+
                 D3D12_DRAW_INDEXED_ARGUMENTS draw;
-                draw.IndexCountPerInstance = mesh.indexCount;
+                draw.IndexCountPerInstance = indexRange.y;
                 draw.InstanceCount = 1;
-                draw.StartIndexLocation = mesh.ibOffset * (use16Bit ? 2 : 1);
+                draw.StartIndexLocation = indexRange.x * (use16Bit ? 2 : 1);
                 draw.BaseVertexLocation = mesh.vbOffset;
                 draw.StartInstanceLocation = instanceID++;
 
@@ -2313,6 +2733,40 @@ namespace Falcor
             return mpBlasStaticWorldMatrices;
         };
 
+        // With compact vertices the positions are quantized relative to the mesh bounds, see CompactStaticVertexData.
+        // DXR reads them as R16G16B16A16 unorm values, so we let it dequantize them with a per-mesh transform.
+        // For static meshes the transform also includes the object-to-world transform.
+        auto getCompactVertexMatricesBuffer = [&]()
+        {
+            if (!mpBlasCompactVertexMatrices)
+            {
+                std::vector<glm::mat4> transposedMatrices(mMeshDesc.size(), glm::identity<glm::mat4>());
+                for (const auto& meshGroup : mMeshGroups)
+                {
+                    for (uint32_t meshID : meshGroup.meshList)
+                    {
+                        const VertexQuantization& q = mMeshVertexQuantization[meshID];
+                        glm::mat4 m = glm::scale(glm::translate(glm::identity<glm::mat4>(), q.origin), q.scale);
+                        if (meshGroup.isStatic)
+                        {
+                            assert(mMeshIdToInstanceIds[meshID].size() == 1);
+                            uint32_t instanceID = mMeshIdToInstanceIds[meshID][0];
+                            m = globalMatrices[mMeshInstanceData[instanceID].globalMatrixID] * m;
+                        }
+                        transposedMatrices[meshID] = glm::transpose(m);
+                    }
+                }
+
+                uint32_t float4Count = (uint32_t)transposedMatrices.size() * 4;
+                mpBlasCompactVertexMatrices = Buffer::createStructured(sizeof(float4), float4Count, Resource::BindFlags::ShaderResource, Buffer::CpuAccess::None, transposedMatrices.data(), false);
+                mpBlasCompactVertexMatrices->setName("Scene::mpBlasCompactVertexMatrices");
+
+                // Transition the resource to non-pixel shader state as expected by DXR.
+                pContext->resourceBarrier(mpBlasCompactVertexMatrices.get(), Resource::State::NonPixelShader);
+            }
+            return mpBlasCompactVertexMatrices;
+        };
+
         assert(mMeshGroups.size() > 0);
         uint32_t totalBlasCount = (uint32_t)mMeshGroups.size() + (mCurveDesc.empty() ? 0 : 1) + (mSDFGrids.empty() ? 0 : 1) + (mCustomPrimitiveDesc.empty() ? 0 : 1); // If there are procedural primitives, they are all placed in one more BLAS.
 
@@ -2368,6 +2822,9 @@ namespace Falcor
                             if (glm::determinant(globalMatrices[matrixID]) < 0.f) frontFaceCW = !frontFaceCW;
                         }
                     }
+
+                    // Compact vertices are dequantized by the geometry transform, which also replaces the static mesh transform above.
+                    if (mUseCompactVertices) desc.Triangles.Transform3x4 = getCompactVertexMatricesBuffer()->getGpuAddress() + meshID * 64ull;
                     triangleWindings |= frontFaceCW ? 1 : 2;
 
                     // If this is an opaque mesh, set the opaque flag
@@ -2378,16 +2835,18 @@ namespace Falcor
                     desc.Triangles.VertexBuffer.StartAddress = pVb->getGpuAddress() + (mesh.vbOffset * pVbLayout->getStride());
                     desc.Triangles.VertexBuffer.StrideInBytes = pVbLayout->getStride();
                     desc.Triangles.VertexCount = mesh.vertexCount;
-                    desc.Triangles.VertexFormat = getDxgiFormat(pVbLayout->getElementFormat(0));
+                    desc.Triangles.VertexFormat = mUseCompactVertices ? DXGI_FORMAT_R16G16B16A16_UNORM : getDxgiFormat(pVbLayout->getElementFormat(0));
 
                     // Set index data
                     if (pIb)
                     {
                         // The global index data is stored in a dword array.
                         // Each mesh specifies whether its indices are in 16-bit or 32-bit format.
+                        // The index range is that of the LOD selected for the mesh, see selectMeshLODs().
                         ResourceFormat ibFormat = mesh.use16BitIndices() ? ResourceFormat::R16Uint : ResourceFormat::R32Uint;
-                        desc.Triangles.IndexBuffer = pIb->getGpuAddress() + mesh.ibOffset * sizeof(uint32_t);
-                        desc.Triangles.IndexCount = mesh.indexCount;
+                        const uint2 indexRange = getMeshIndexRange(meshID);
+                        desc.Triangles.IndexBuffer = pIb->getGpuAddress() + indexRange.x * sizeof(uint32_t);
+                        desc.Triangles.IndexCount = indexRange.y;
                         desc.Triangles.IndexFormat = getDxgiFormat(ibFormat);
                     }
                     else
@@ -38,12 +38,15 @@
 #include "SDFs/SDFGrid.h"
 #include "SDFs/NormalizedDenseSDFGrid/NDSDFGrid.h"
 #include "Utils/Math/AABB.h"
+#include "Utils/CryptoUtils.h"
 #include "Animation/AnimationController.h"
 #include "Animation/AnimatedVertexCache.h"
 #include "Camera/CameraController.h"
 #include "Displacement/DisplacementUpdateTask.slang"
 #include "SceneTypes.slang"
 #include "HitInfo.h"
+#include "PagedGeometryStore.h"
+#include "SceneUpdateScheduler.h"
 
 // Indicating the implementation of curve back-face culling is in anyhit shaders or intersection shaders.
 // Currently, the performance numbers on BabyCheetah scene with 20 indirect bounces are 77ms (with anyhit) and 73ms (without anyhit).
@@ -53,6 +56,7 @@
 namespace Falcor
 {
     class RtProgramVars;
+    class HostRayTracer;
 
     /** This class is the main scene representation.
         It holds all scene resources such as geometry, cameras, lights, and materials.
@@ -506,6 +510,73 @@ namespace Falcor
         */
         const MeshDesc& getMesh(uint32_t meshID) const { return mMeshDesc[meshID]; }
 
+        /** Host copy of the object-space geometry of a mesh.
+        */
+        struct HostMeshGeometry
+        {
+            std::vector<float3> positions;      ///< Vertex positions in object space.
+            std::vector<float2> texCrds;        ///< Vertex texture coordinates.
+            std::vector<uint32_t> indices;      ///< Vertex indices, three per triangle, relative to the first vertex of the mesh.
+        };
+
+        /** Get the host copy of a mesh's geometry.
+            Host copies are only kept for meshes without vertex animation that are referenced by instances with emissive materials.
+            \param[in] meshID Mesh ID.
+            \return The geometry, or nullptr if there is no host copy.
+        */
+        const HostMeshGeometry* getHostMeshGeometry(uint32_t meshID) const;
+
+        /** Get the number of levels of detail of a mesh, including the full resolution mesh (LOD 0).
+        */
+        uint32_t getMeshLODCount(uint32_t meshID) const { return mMeshLODRanges[meshID].y + 1; }
+
+        /** Get a simplified level of detail of a mesh.
+            \param[in] meshID Mesh ID.
+            \param[in] lod Level of detail in the range [1, getMeshLODCount(meshID)).
+        */
+        const MeshLODDesc& getMeshLOD(uint32_t meshID, uint32_t lod) const { assert(lod > 0 && lod < getMeshLODCount(meshID)); return mMeshLODs[mMeshLODRanges[meshID].x + lod - 1]; }
+
+        /** Select the level of detail for each mesh based on the projected geometric error of its instances from the selected camera.
+            The coarsest LOD whose error projects to at most the given number of pixels is selected.
+            Instances with the camera inside their bounds always use the full resolution mesh.
+            All instances of a mesh share its BLAS, so each mesh uses the finest LOD required by any of its instances.
+            Meshes with emissive instances keep their LOD, as the light collection is built from their triangles.
+            If the selection changes, the draw arguments are recreated and the BLASes are rebuilt on the next ray tracing use.
+            \param[in] viewportHeight Viewport height in pixels.
+            \param[in] maxPixelError Max allowed projected geometric error in pixels.
+        */
+        void selectMeshLODs(uint32_t viewportHeight, float maxPixelError = 1.f);
+
+        /** Get the level of detail used by a mesh instance, or 0 for the full resolution mesh.
+        */
+        uint32_t getMeshInstanceLOD(uint32_t instanceID) const { return mMeshSelectedLODs[mMeshInstanceData[instanceID].meshID]; }
+
+        /** Get the paged geometry store holding the mesh index and vertex data, or nullptr if the scene was not built with out-of-core geometry.
+        */
+        const PagedGeometryStore::SharedPtr& getGeometryStore() const { return mpGeometryStore; }
+
+        /** Get the acceleration structure for CPU ray queries, or nullptr if the scene was not built with SceneBuilder::Flags::HostRayTracing.
+            The instance transforms are kept in sync with the scene graph by update().
+        */
+        const std::shared_ptr<HostRayTracer>& getHostRayTracer() const { return mpHostRayTracer; }
+
+        /** Get the key of the scene cache the scene was loaded from or written to, if any.
+            This is used to store data derived from the scene (e.g. light BVHs) alongside the scene cache.
+        */
+        const std::optional<SHA1::MD>& getSceneCacheKey() const { return mSceneCacheKey; }
+
+        /** Pin the index and vertex data of all meshes in a mesh group in host memory.
+            This is a no-op if the scene was not built with out-of-core geometry.
+            Each call must be matched by a call to unpinMeshGroupGeometry().
+            \param[in] groupID Mesh group ID.
+        */
+        void pinMeshGroupGeometry(uint32_t groupID);
+
+        /** Unpin the index and vertex data of all meshes in a mesh group.
+            \param[in] groupID Mesh group ID.
+        */
+        void unpinMeshGroupGeometry(uint32_t groupID);
+
         /** Get the number of mesh instances.
         */
         uint32_t getMeshInstanceCount() const { return (uint32_t)mMeshInstanceData.size(); }
@@ -721,6 +792,14 @@ namespace Falcor
         */
         UpdateFlags getUpdates() const { return mUpdates; }
 
+        /** Get the per-stage timings of the last call to update().
+        */
+        const SceneUpdateScheduler::Stats& getUpdateStats() const { return mUpdateScheduler.getStats(); }
+
+        /** Enable/disable running the CPU part of independent update stages in parallel.
+        */
+        void setParallelUpdate(bool parallel) { mUpdateScheduler.setParallel(parallel); }
+
         /** Render the scene using the rasterizer.
             Note the rasterizer state bound to 'pState' is ignored.
             \param[in] pContext Render context.
@@ -767,6 +846,11 @@ namespace Falcor
         */
         const Vao::SharedPtr& getVao16() const { return mpVao16Bit; }
 
+        /** Check if the mesh vertices are stored in the compact format (CompactStaticVertexData).
+            The vertex layout of the VAOs then has a single attribute holding the compact data.
+        */
+        bool hasCompactVertices() const { return mUseCompactVertices; }
+
         /** Get the scene's VAO for curves.
         */
         const Vao::SharedPtr& getCurveVao() const { return mpCurveVao; }
@@ -907,6 +991,7 @@ namespace Falcor
             std::vector<MeshDesc> meshDesc;                         ///< List of mesh descriptors.
             std::vector<std::string> meshNames;                     ///< List of mesh names.
             std::vector<AABB> meshBBs;                              ///< List of mesh bounding boxes in object space.
+            std::vector<MeshLODDesc> meshLODs;                      ///< List of simplified mesh LODs sorted by mesh ID, from fine to coarse.
             std::vector<MeshInstanceData> meshInstanceData;         ///< List of mesh instances.
             uint32_t displacedMeshInstanceCount;                    ///< Number of displaced mesh instances. All displaced mesh instances are at the end of the mesh instance list.
             std::vector<std::vector<uint32_t>> meshIdToInstanceIds; ///< Mapping of what instances belong to which mesh.
@@ -919,8 +1004,17 @@ namespace Falcor
 
             std::vector<uint32_t> meshIndexData;                    ///< Vertex indices for all meshes in either 32-bit or 16-bit format packed tightly, decided per mesh.
             std::vector<PackedStaticVertexData> meshStaticData;     ///< Vertex attributes for all meshes in packed format.
+            std::vector<CompactStaticVertexData> meshCompactStaticData; ///< Vertex attributes for all meshes in the compact format. If used, 'meshStaticData' is empty.
+            std::vector<VertexQuantization> meshVertexQuantization; ///< Position quantization per mesh for the compact vertex format.
             std::vector<DynamicVertexData> meshDynamicData;         ///< Additional vertex attributes for dynamic (skinned) meshes.
 
+            // Out-of-core mesh data
+            PagedGeometryStore::SharedPtr pGeometryStore;           ///< Paged store holding the mesh index and static vertex data if built with out-of-core geometry. The in-memory lists above are then empty.
+            uint64_t meshIndexDataOffset = 0;                       ///< Byte offset of the mesh index data in the paged store.
+            uint64_t meshIndexDataCount = 0;                        ///< Number of 32-bit words of mesh index data in the paged store.
+            uint64_t meshStaticDataOffset = 0;                      ///< Byte offset of the static vertex data in the paged store.
+            uint64_t meshStaticDataCount = 0;                       ///< Number of static vertices in the paged store.
+
             // Curve data
             std::vector<CurveDesc> curveDesc;                       ///< List of curve descriptors.
             std::vector<AABB> curveBBs;                             ///< List of curve bounding boxes in object space. Each curve consists of many segments, each with its own AABB. The bounding boxes here are the unions of those.
@@ -939,6 +1033,9 @@ namespace Falcor
             // Custom primitive data
             std::vector<CustomPrimitiveDesc> customPrimitiveDesc;   ///< Custom primitive descriptors.
             std::vector<AABB> customPrimitiveAABBs;                 ///< List of AABBs for custom primitives in world space. Each custom primitive consists of one AABB.
+
+            bool buildHostRayTracer = false;                        ///< Build an acceleration structure for ray queries on the CPU.
+            std::optional<SHA1::MD> sceneCacheKey;                  ///< Key of the scene cache if the scene is cached. Not serialized.
         };
 
         friend class SceneBuilder;
@@ -952,7 +1049,10 @@ namespace Falcor
 
         static SharedPtr create(SceneData&& sceneData, bool monochromeMode = false);
 
-        void createMeshVao(uint32_t drawCount, const std::vector<uint32_t>& indexData, const std::vector<PackedStaticVertexData>& staticData, const std::vector<DynamicVertexData>& dynamicData);
+        void createMeshVao(uint32_t drawCount, const std::vector<uint32_t>& indexData, const std::vector<PackedStaticVertexData>& staticData, const std::vector<CompactStaticVertexData>& compactStaticData, const std::vector<DynamicVertexData>& dynamicData);
+        void uploadFromGeometryStore(const Buffer::SharedPtr& pBuffer, uint64_t offset, uint64_t size);
+        void forEachMeshGroupGeometryRange(uint32_t groupID, const std::function<void(uint64_t offset, uint64_t size)>& func) const;
+        void createHostMeshGeometry(const SceneData& sceneData);
         void createCurveVao(const std::vector<uint32_t>& indexData, const std::vector<StaticCurveVertexData>& staticData);
 
         /** Sets the default SDF grid config.
@@ -983,6 +1083,14 @@ namespace Falcor
         */
         void updateMeshInstances(bool forceUpdate);
 
+        /** Update the mesh instance flags and pack the mesh instance data. This is CPU-only work.
+        */
+        void prepareMeshInstanceUpdates(bool forceUpdate);
+
+        /** Upload the mesh instance data packed by prepareMeshInstanceUpdates(), if changed.
+        */
+        void commitMeshInstanceUpdates();
+
         /** Update curve instances.
         */
         void updateCurveInstances(bool forceUpdate);
@@ -999,6 +1107,10 @@ namespace Falcor
         */
         void finalize();
 
+        /** Get the index range (offset into the global index buffer, index count) of the LOD used by a mesh.
+        */
+        uint2 getMeshIndexRange(uint32_t meshID) const;
+
         /** Create the draw list for rasterization.
         */
         void createDrawList();
@@ -1045,9 +1157,18 @@ namespace Falcor
         */
         bool updateAnimatable(Animatable& animatable, const AnimationController& controller, bool force = false);
 
-        UpdateFlags updateSelectedCamera(bool forceUpdate);
+        /** Create the stages of the per-frame update(), see SceneUpdateScheduler.
+        */
+        void createUpdateScheduler();
+
+        void prepareSelectedCameraUpdate(bool forceUpdate);
+        UpdateFlags commitSelectedCameraUpdate();
         UpdateFlags updateLights(bool forceUpdate);
+        void prepareLightUpdates(bool forceUpdate);
+        UpdateFlags commitLightUpdates(bool forceUpdate);
         UpdateFlags updateGridVolumes(bool forceUpdate);
+        void prepareGridVolumeUpdates(bool forceUpdate);
+        UpdateFlags commitGridVolumeUpdates(bool forceUpdate);
         UpdateFlags updateEnvMap(bool forceUpdate);
         UpdateFlags updateMaterials(bool forceUpdate);
         UpdateFlags updateGeometry(bool forceUpdate);
@@ -1088,8 +1209,20 @@ namespace Falcor
         std::vector<MeshInstanceData> mMeshInstanceData;            ///< Mesh instance data.
         uint32_t mDisplacedMeshInstanceCount;                       ///< Number of displaced mesh instances. All displaced mesh instances are at the end of the mesh instance list.
         std::vector<PackedMeshInstanceData> mPackedMeshInstanceData;///< Copy of packed mesh instance data GPU buffer (mpMeshInstancesBuffer).
+        std::vector<WideMeshInstanceData> mWideMeshInstanceData;    ///< Copy of wide mesh instance data GPU buffer (mpMeshInstancesBuffer). Only used if mUseWideMeshInstances is set.
+        bool mUseWideMeshInstances = false;                         ///< True if the scene exceeds the ID limits of PackedMeshInstanceData.
+        bool mUseCompactVertices = false;                           ///< True if the mesh vertices are stored in the compact format (CompactStaticVertexData).
+        std::vector<VertexQuantization> mMeshVertexQuantization;    ///< Position quantization per mesh. Only used if mUseCompactVertices is set.
         std::vector<MeshGroup> mMeshGroups;                         ///< Groups of meshes. Each group maps to a BLAS for ray tracing.
+        PagedGeometryStore::SharedPtr mpGeometryStore;              ///< Paged store holding the mesh index and static vertex data, or nullptr if not using out-of-core geometry.
+        uint64_t mMeshIndexDataOffset = 0;                          ///< Byte offset of the mesh index data in the paged store.
+        uint64_t mMeshIndexDataCount = 0;                           ///< Number of 32-bit words of mesh index data in the paged store.
+        uint64_t mMeshStaticDataOffset = 0;                         ///< Byte offset of the static vertex data in the paged store.
+        uint64_t mMeshStaticDataCount = 0;                          ///< Number of static vertices in the paged store.
+        std::shared_ptr<HostRayTracer> mpHostRayTracer;             ///< Acceleration structure for CPU ray queries, or nullptr if not used.
+        std::optional<SHA1::MD> mSceneCacheKey;                     ///< Key of the scene cache, or empty if the scene is not cached.
         std::vector<std::string> mMeshNames;                        ///< Mesh names, indxed by mesh ID
+        std::unordered_map<uint32_t, HostMeshGeometry> mHostMeshGeometry; ///< Host copies of the geometry of emissive meshes, indexed by mesh ID.
         std::vector<Node> mSceneGraph;                              ///< For each index i, the array element indicates the parent node. Indices are in relation to mLocalToWorldMatrices.
 
         // Displacement mapping.
@@ -1148,6 +1281,9 @@ namespace Falcor
 
         // Scene metadata (CPU only)
         std::vector<AABB> mMeshBBs;                                 ///< Bounding boxes for meshes (not instances) in object space.
+        std::vector<MeshLODDesc> mMeshLODs;                         ///< Simplified mesh LODs sorted by mesh ID, from fine to coarse.
+        std::vector<uint2> mMeshLODRanges;                          ///< Range of LODs in mMeshLODs (offset, count) for each mesh.
+        std::vector<uint32_t> mMeshSelectedLODs;                    ///< Selected LOD for each mesh. Zero for the full resolution mesh.
         std::vector<std::vector<uint32_t>> mMeshIdToInstanceIds;    ///< Mapping of what instances belong to which mesh. The instanceID are sorted in ascending order.
         std::vector<AABB> mCurveBBs;                                ///< Bounding boxes for curves (not instances) in object space.
         std::vector<std::vector<uint32_t>> mCurveIdToInstanceIds;   ///< Mapping of what instances belong to which curve.
@@ -1161,6 +1297,7 @@ namespace Falcor
 
         // Scene block resources
         Buffer::SharedPtr mpMeshesBuffer;
+        Buffer::SharedPtr mpVertexQuantizationBuffer;
         Buffer::SharedPtr mpMeshInstancesBuffer;
         Buffer::SharedPtr mpCurvesBuffer;
         Buffer::SharedPtr mpCurveInstancesBuffer;
@@ -1196,6 +1333,17 @@ namespace Falcor
         std::map<RasterizerState::CullMode, RasterizerState::SharedPtr> mFrontClockwiseRS;
         std::map<RasterizerState::CullMode, RasterizerState::SharedPtr> mFrontCounterClockwiseRS;
         UpdateFlags mUpdates = UpdateFlags::All;
+
+        // Per-frame update
+        SceneUpdateScheduler mUpdateScheduler;                      ///< Runs the stages of update().
+        RenderContext* mpUpdateContext = nullptr;                   ///< Render context passed to update(). Only valid during update().
+        double mUpdateTime = 0.0;                                   ///< Time passed to update().
+        Camera::Changes mSelectedCameraChanges = Camera::Changes::None; ///< Changes of the selected camera, computed by prepareSelectedCameraUpdate().
+        Light::Changes mLightChanges = Light::Changes::None;        ///< Combined changes of all lights, computed by prepareLightUpdates().
+        std::vector<LightData> mLightStagingData;                   ///< Data of the active lights, staged for upload by prepareLightUpdates().
+        uint2 mLightUploadRange = { 0, 0 };                         ///< Range [first, last) of active lights to upload.
+        GridVolume::UpdateFlags mGridVolumeUpdates = GridVolume::UpdateFlags::None; ///< Combined updates of all grid volumes, computed by prepareGridVolumeUpdates().
+        bool mMeshInstancesDirty = false;                           ///< True if the mesh instance data packed by prepareMeshInstanceUpdates() needs to be uploaded.
         AnimationController::UniquePtr mpAnimationController;
 
         // Raytracing data
@@ -1260,6 +1408,7 @@ namespace Falcor
         std::vector<BlasGroup> mBlasGroups;                 ///< BLAS group data.
         Buffer::SharedPtr mpBlasScratch;                    ///< Scratch buffer used for BLAS builds.
         Buffer::SharedPtr mpBlasStaticWorldMatrices;        ///< Object-to-world transform matrices in row-major format. Only valid for static meshes.
+        Buffer::SharedPtr mpBlasCompactVertexMatrices;      ///< Per-mesh transforms in row-major format that dequantize compact vertex positions, including the object-to-world transform of static meshes.
         bool mRebuildBlas = true;                           ///< Flag to indicate BLASes need to be rebuilt.
         bool mHasSkinnedMesh = false;                       ///< Whether the scene has a skinned mesh at all.
         bool mHasAnimatedVertexCache = false;               ///< Whether the scene has an animated vertex cache at all.
@@ -28,11 +28,15 @@
 #include "stdafx.h"
 #include "SceneBuilder.h"
 #include "SceneCache.h"
+#include "MeshSimplifier.h"
+#include "VertexCacheOptimizer.h"
 #include "Importer.h"
 #include "Utils/Math/MathConstants.slangh"
 #include "Utils/Image/TextureAnalyzer.h"
 #include "Utils/Timing/TimeReport.h"
+#include "Utils/Timing/TraceProfiler.h"
 #include <mikktspace.h>
+#include <execution>
 #include <filesystem>
 #include <numeric>
 
@@ -152,6 +156,80 @@ namespace Falcor
             return indexData;
         }
 
+        // Error bounds for the compact vertex format (CompactStaticVertexData).
+        // The position error is relative to the shortest non-degenerate edge in the mesh.
+        // The texture coordinate bound allows fp16 texture coordinates in [-1,1].
+        const float kMaxCompactPositionError = 0.1f;
+        const float kMaxCompactTexCrdError = 1.f / 4096.f;
+
+        // Mesh LOD generation parameters.
+        // Each level targets half the triangles of the previous one. The generation stops when the error
+        // relative to the mesh bounding sphere radius exceeds the limit or when the mesh can't be simplified further.
+        const uint32_t kMaxMeshLODCount = 4;
+        const uint32_t kMeshLODMinTriangleCount = 256;
+        const float kMeshLODMaxRelativeError = 0.05f;
+        const float kMeshLODMinReduction = 0.25f;
+
+        struct CompactVertexError
+        {
+            float maxPositionError = 0.f;   ///< Max position error relative to the shortest edge.
+            float maxTexCrdError = 0.f;     ///< Max absolute texture coordinate error.
+            bool hasNonUnitTangentSign = false;
+
+            bool isWithinBounds() const
+            {
+                return maxPositionError <= kMaxCompactPositionError && maxTexCrdError <= kMaxCompactTexCrdError && !hasNonUnitTangentSign;
+            }
+        };
+
+        /** Computes the round-trip error of storing a mesh's vertices in the compact vertex format.
+        */
+        CompactVertexError computeCompactVertexError(const std::vector<uint32_t>& indices, const std::vector<StaticVertexData>& vertices, const AABB& bounds)
+        {
+            CompactVertexError error;
+            const VertexQuantization q = VertexQuantization::create(bounds.minPoint, bounds.maxPoint);
+
+            float maxPositionError = 0.f;
+            for (const auto& v : vertices)
+            {
+                CompactStaticVertexData packed;
+                packed.pack(v, q);
+                StaticVertexData u = packed.unpack(q);
+
+                maxPositionError = std::max(maxPositionError, glm::length(u.position - v.position));
+                float2 texCrdError = glm::abs(u.texCrd - v.texCrd);
+                error.maxTexCrdError = std::max(error.maxTexCrdError, std::max(texCrdError.x, texCrdError.y));
+                if (v.tangent.w != 0.f && std::abs(v.tangent.w) != 1.f) error.hasNonUnitTangentSign = true;
+            }
+
+            // Find the shortest non-degenerate edge to relate the position error to the tessellation.
+            float minEdgeLength = std::numeric_limits<float>::infinity();
+            for (size_t i = 0; i + 2 < indices.size(); i += 3)
+            {
+                for (size_t j = 0; j < 3; j++)
+                {
+                    float length = glm::length(vertices[indices[i + j]].position - vertices[indices[i + (j + 1) % 3]].position);
+                    if (length > 0.f) minEdgeLength = std::min(minEdgeLength, length);
+                }
+            }
+
+            error.maxPositionError = maxPositionError > 0.f ? maxPositionError / minEdgeLength : 0.f;
+            return error;
+        }
+
+        void checkMeshDataElementCount(uint64_t indexDataCount, uint64_t staticVertexCount, uint64_t dynamicVertexCount)
+        {
+            // The global mesh buffers are addressed with 32-bit offsets in the runtime mesh data.
+            if (indexDataCount > SceneBuilder::kMaxMeshDataElementCount ||
+                staticVertexCount > SceneBuilder::kMaxMeshDataElementCount ||
+                dynamicVertexCount > SceneBuilder::kMaxMeshDataElementCount)
+            {
+                throw std::exception(("Trying to build a scene that exceeds supported mesh data size (" + std::to_string(indexDataCount) + " indices, " +
+                    std::to_string(staticVertexCount) + " static vertices, " + std::to_string(dynamicVertexCount) + " dynamic vertices). " +
+                    "The limit is " + std::to_string(SceneBuilder::kMaxMeshDataElementCount) + " elements per buffer.").c_str());
+            }
+        }
+
         SceneCache::Key computeSceneCacheKey(const std::string& scenePath, SceneBuilder::Flags buildFlags)
         {
             SceneBuilder::Flags cacheFlags = buildFlags & (~(SceneBuilder::Flags::UseCache | SceneBuilder::Flags::RebuildCache));
@@ -201,7 +279,10 @@ namespace Falcor
         {
             try
             {
-                pBuilder->mpScene = Scene::create(SceneCache::readCache(pBuilder->mSceneCacheKey));
+                Scene::SceneData sceneData = SceneCache::readCache(pBuilder->mSceneCacheKey);
+                sceneData.buildHostRayTracer = is_set(buildFlags, Flags::HostRayTracing);
+                sceneData.sceneCacheKey = pBuilder->mSceneCacheKey;
+                pBuilder->mpScene = Scene::create(std::move(sceneData));
                 return pBuilder;
             }
             catch (const std::exception& e)
@@ -258,6 +339,8 @@ namespace Falcor
         createMeshGroups();
         optimizeGeometry();
         sortMeshes();
+        prepareCompactVertices();
+        generateMeshLODs();
         createGlobalBuffers();
         createCurveGlobalBuffers();
         collectVolumeGrids();
@@ -268,6 +351,7 @@ namespace Falcor
         optimizeMaterials();
         removeDuplicateMaterials();
         quantizeTexCoords();
+        createCompactVertexData();
 
         timeReport.measure("Optimizing materials");
 
@@ -287,10 +371,12 @@ namespace Falcor
         if (mWriteSceneCache)
         {
             SceneCache::writeCache(mSceneData, mSceneCacheKey);
+            mSceneData.sceneCacheKey = mSceneCacheKey;
             timeReport.measure("Writing cache");
         }
 
         // Create the scene object.
+        mSceneData.buildHostRayTracer = is_set(mFlags, Flags::HostRayTracing);
         mpScene = Scene::create(std::move(mSceneData), monochromeMode);
         mSceneData = {};
 
@@ -593,16 +679,35 @@ namespace Falcor
             spec.hasDynamicData = true;
         }
 
-        mMeshes.push_back(spec);
+        mMeshes.push_back(std::move(spec));
 
         if (mMeshes.size() > std::numeric_limits<uint32_t>::max())
         {
             throw std::exception("Trying to build a scene that exceeds supported number of meshes");
         }
 
+        // With out-of-core geometry the mesh data is moved to the paged store right away, so that it doesn't accumulate in memory during import.
+        if (is_set(mFlags, Flags::OutOfCoreGeometry))
+        {
+            if (!mpMeshStore) mpMeshStore = PagedGeometryStore::create(getTempFilename(), mOutOfCorePageSize, mOutOfCoreResidentBudget);
+            pageOutMeshData(mMeshes.back());
+        }
+
         return (uint32_t)(mMeshes.size() - 1);
     }
 
+    void SceneBuilder::setOutOfCoreBudget(size_t pageSize, size_t residentBudget)
+    {
+        if (!mMeshes.empty()) throw std::exception("SceneBuilder::setOutOfCoreBudget() must be called before adding meshes.");
+        mOutOfCorePageSize = pageSize;
+        mOutOfCoreResidentBudget = residentBudget;
+    }
+
+    PagedGeometryStore::Stats SceneBuilder::getOutOfCoreStats() const
+    {
+        return mpMeshStore ? mpMeshStore->getStats() : mMeshStoreStats;
+    }
+
     void SceneBuilder::addCustomPrimitive(uint32_t userID, const AABB& aabb)
     {
         // Currently each custom primitive has exactly one AABB. This may change in the future.
@@ -1454,6 +1559,7 @@ namespace Falcor
             // Transform vertices to world space if not already identity transform.
             if (transform != glm::identity<glm::mat4>())
             {
+                pageInMeshData(mesh);
                 assert(!mesh.staticData.empty());
                 assert((size_t)mesh.vertexCount == mesh.staticData.size());
 
@@ -1469,6 +1575,7 @@ namespace Falcor
                     // TODO: We should flip the sign of v.tangent.w if flippedWinding is true.
                     // Leaving that out for now for consistency with the shader code that needs the same fix.
                 }
+                pageOutMeshData(mesh);
 
                 transformedMeshCount++;
             }
@@ -1520,6 +1627,46 @@ namespace Falcor
         mesh.isFrontFaceCW = !mesh.isFrontFaceCW;
     }
 
+    void SceneBuilder::pageOutMeshData(MeshSpec& mesh, bool isModified)
+    {
+        // Moves the index and static vertex data of a mesh, including its LODs, to the out-of-core mesh store and frees the in-memory copy.
+        // The data is only written if it was modified since it was paged in. The store is append-only, so rewriting data leaves the
+        // previous copy unused in the backing file. Dynamic meshes are kept in memory as they don't support out-of-core geometry.
+
+        if (!is_set(mFlags, Flags::OutOfCoreGeometry) || mesh.isDynamic()) return;
+        assert(mpMeshStore && !mesh.isPagedOut);
+
+        if (isModified || !mesh.hasPagedCopy)
+        {
+            mesh.pagedIndexData = { mpMeshStore->append(mesh.indexData), mesh.indexData.size() };
+            mesh.pagedStaticData = { mpMeshStore->append(mesh.staticData), mesh.staticData.size() };
+            for (auto& lod : mesh.lods) lod.pagedIndexData = { mpMeshStore->append(lod.indexData), lod.indexData.size() };
+            mesh.hasPagedCopy = true;
+        }
+
+        std::vector<uint32_t>().swap(mesh.indexData);
+        std::vector<StaticVertexData>().swap(mesh.staticData);
+        for (auto& lod : mesh.lods) std::vector<uint32_t>().swap(lod.indexData);
+        mesh.isPagedOut = true;
+    }
+
+    void SceneBuilder::pageInMeshData(MeshSpec& mesh)
+    {
+        if (!mesh.isPagedOut) return;
+        assert(mpMeshStore && mesh.hasPagedCopy);
+
+        mesh.indexData.resize(mesh.pagedIndexData.count);
+        mpMeshStore->read(mesh.pagedIndexData.offset, mesh.indexData.size() * sizeof(uint32_t), mesh.indexData.data());
+        mesh.staticData.resize(mesh.pagedStaticData.count);
+        mpMeshStore->read(mesh.pagedStaticData.offset, mesh.staticData.size() * sizeof(StaticVertexData), mesh.staticData.data());
+        for (auto& lod : mesh.lods)
+        {
+            lod.indexData.resize(lod.pagedIndexData.count);
+            mpMeshStore->read(lod.pagedIndexData.offset, lod.indexData.size() * sizeof(uint32_t), lod.indexData.data());
+        }
+        mesh.isPagedOut = false;
+    }
+
     void SceneBuilder::updateSDFGridID(uint32_t oldID, uint32_t newID)
     {
         // This is a helper function to update all the references to a specific SDF grid ID
@@ -1562,7 +1709,9 @@ namespace Falcor
             // Skip meshes that are already front face counter-clockwise.
             if (mesh.isFrontFaceCW == false) continue;
 
+            pageInMeshData(mesh);
             flipTriangleWinding(mesh);
+            pageOutMeshData(mesh);
             assert(!mesh.isFrontFaceCW);
 
             flippedMeshCount++;
@@ -1575,6 +1724,7 @@ namespace Falcor
     {
         for (auto& mesh : mMeshes)
         {
+            pageInMeshData(mesh);
             assert(!mesh.staticData.empty());
             assert((size_t)mesh.vertexCount == mesh.staticData.size());
 
@@ -1585,6 +1735,7 @@ namespace Falcor
             }
 
             mesh.boundingBox = meshBB;
+            pageOutMeshData(mesh, false);
         }
     }
 
@@ -1789,6 +1940,7 @@ namespace Falcor
         MeshSpec leftMesh = createSpec(mesh, mesh.name + ".0");
         MeshSpec rightMesh = createSpec(mesh, mesh.name + ".1");
 
+        pageInMeshData(mMeshes[meshID]);
         if (mesh.indexCount > 0) splitIndexedMesh(mesh, leftMesh, rightMesh, axis, pos);
         else splitNonIndexedMesh(mesh, leftMesh, rightMesh, axis, pos);
 
@@ -1797,8 +1949,12 @@ namespace Falcor
 
         // It is possible all triangles ended up on either side of the splitting plane.
         // In that case, there is no need to modify the original mesh and we'll just return.
-        if (leftMesh.getTriangleCount() == 0) return { std::nullopt, meshID };
-        else if (rightMesh.getTriangleCount() == 0) return { meshID, std::nullopt };
+        if (leftMesh.getTriangleCount() == 0 || rightMesh.getTriangleCount() == 0)
+        {
+            pageOutMeshData(mMeshes[meshID], false);
+            if (leftMesh.getTriangleCount() == 0) return { std::nullopt, meshID };
+            else return { meshID, std::nullopt };
+        }
 
         logDebug("Mesh '" + mesh.name + "' with " + std::to_string(mesh.getTriangleCount()) + " triangles was split into two meshes with " + std::to_string(leftMesh.getTriangleCount()) + " and " + std::to_string(rightMesh.getTriangleCount()) + " triangles, respectively.");
 
@@ -1806,6 +1962,8 @@ namespace Falcor
         // The left mesh replaces the existing mesh.
         // The right mesh is appended at the end of the mesh list and linked to the instances.
         assert(leftMesh.vertexCount > 0 && rightMesh.vertexCount > 0);
+        pageOutMeshData(leftMesh);
+        pageOutMeshData(rightMesh);
         mMeshes[meshID] = std::move(leftMesh);
 
         uint32_t rightMeshID = (uint32_t)mMeshes.size();
@@ -2097,6 +2255,218 @@ namespace Falcor
         }
 
         mMeshGroups = std::move(optimizedGroups);
+
+        if (is_set(mFlags, Flags::OptimizeVertexCache)) optimizeVertexLocality();
+    }
+
+    void SceneBuilder::optimizeVertexLocality()
+    {
+        // This function reorders the triangles and vertices of each mesh for memory locality.
+        //
+        // The steps are:
+        //  - Sort triangles of very large meshes spatially along a Morton curve.
+        //  - Reorder triangles for post-transform vertex cache efficiency (rasterization).
+        //  - Reorder vertices by first use for vertex fetch efficiency (rasterization and ray tracing hit shaders).
+        //
+        // The reordering is only done for static indexed triangle meshes. Meshes with dynamic data or
+        // cached vertex animations are skipped as their vertex order is referenced elsewhere.
+
+        std::unordered_set<uint32_t> cachedMeshIDs;
+        for (const auto& cachedMesh : mSceneData.cachedMeshes) cachedMeshIDs.insert(cachedMesh.meshID);
+
+        const size_t meshCount = mMeshes.size();
+        std::vector<VertexCacheOptimizer::Stats> statsBefore(meshCount), statsAfter(meshCount);
+        std::vector<uint8_t> optimized(meshCount, 0); // Not std::vector<bool>, as the elements are written in parallel.
+
+        auto range = NumericRange<size_t>(0, meshCount);
+        std::for_each(std::execution::par, range.begin(), range.end(), [&](size_t meshID) {
+            TRACE_ZONE("SceneBuilder::optimizeVertexLocality (mesh)");
+            auto& mesh = mMeshes[meshID];
+            if (mesh.topology != Vao::Topology::TriangleList || mesh.indexCount == 0 || mesh.isDynamic()) return;
+            if (cachedMeshIDs.count((uint32_t)meshID) > 0) return;
+
+            pageInMeshData(mesh);
+
+            std::vector<uint32_t> indices(mesh.indexCount);
+            for (uint32_t i = 0; i < mesh.indexCount; i++) indices[i] = mesh.getIndex(i);
+
+            if (VertexCacheOptimizer::optimize(indices, mesh.staticData, mesh.boundingBox, statsBefore[meshID], statsAfter[meshID]))
+            {
+                mesh.indexData = mesh.use16BitIndices ? compact16BitIndices(indices) : std::move(indices);
+                optimized[meshID] = true;
+            }
+
+            pageOutMeshData(mesh, optimized[meshID] != 0);
+        });
+
+        VertexCacheOptimizer::Stats totalBefore, totalAfter;
+        size_t optimizedCount = 0;
+        for (size_t meshID = 0; meshID < meshCount; meshID++)
+        {
+            totalBefore += statsBefore[meshID];
+            totalAfter += statsAfter[meshID];
+            if (optimized[meshID]) optimizedCount++;
+        }
+
+        logInfo("Optimized vertex order for " + std::to_string(optimizedCount) + " out of " + std::to_string(meshCount) + " meshes");
+        logInfo("Vertex cache ACMR " + std::to_string(totalBefore.getACMR()) + " -> " + std::to_string(totalAfter.getACMR()) +
+            ", ATVR " + std::to_string(totalBefore.getATVR()) + " -> " + std::to_string(totalAfter.getATVR()));
+    }
+
+    void SceneBuilder::prepareCompactVertices()
+    {
+        // This function decides if the scene uses the compact vertex format (CompactStaticVertexData).
+        // The format is used for all meshes or none, so the scene falls back to the full format (PackedStaticVertexData)
+        // if any mesh exceeds the error bounds. The vertices are converted in createCompactVertexData().
+
+        if (!is_set(mFlags, Flags::UseCompactVertices)) return;
+
+        // Skinned and vertex-animated meshes are written at runtime in the full format.
+        // The out-of-core store only holds the full format.
+        bool hasDynamicMeshes = !mSceneData.cachedMeshes.empty();
+        for (const auto& mesh : mMeshes) hasDynamicMeshes |= mesh.isDynamic();
+        if (hasDynamicMeshes || is_set(mFlags, Flags::OutOfCoreGeometry))
+        {
+            logWarning("Compact vertex format is not supported for scenes with skinned or vertex-animated meshes or out-of-core geometry. Using the full vertex format.");
+            return;
+        }
+
+        const size_t meshCount = mMeshes.size();
+        std::vector<uint8_t> isCompact(meshCount, 0); // Not std::vector<bool>, as the elements are written in parallel.
+
+        auto range = NumericRange<size_t>(0, meshCount);
+        std::for_each(std::execution::par, range.begin(), range.end(), [&](size_t meshID) {
+            TRACE_ZONE("SceneBuilder::prepareCompactVertices (mesh)");
+            const auto& mesh = mMeshes[meshID];
+
+            std::vector<uint32_t> indices;
+            if (mesh.indexCount > 0)
+            {
+                indices.resize(mesh.indexCount);
+                for (uint32_t i = 0; i < mesh.indexCount; i++) indices[i] = mesh.getIndex(i);
+            }
+            else
+            {
+                indices.resize(mesh.vertexCount);
+                std::iota(indices.begin(), indices.end(), 0);
+            }
+
+            isCompact[meshID] = computeCompactVertexError(indices, mesh.staticData, mesh.boundingBox).isWithinBounds();
+        });
+
+        size_t compactMeshCount = 0;
+        size_t vertexCount = 0;
+        for (size_t meshID = 0; meshID < meshCount; meshID++)
+        {
+            vertexCount += mMeshes[meshID].staticData.size();
+            if (isCompact[meshID]) compactMeshCount++;
+            else logDebug("Mesh '" + mMeshes[meshID].name + "' exceeds the compact vertex format error bounds.");
+        }
+
+        if (compactMeshCount < meshCount)
+        {
+            logWarning("Compact vertex format exceeds the error bounds for " + std::to_string(meshCount - compactMeshCount) + " out of " + std::to_string(meshCount) + " meshes. Using the full vertex format.");
+            return;
+        }
+
+        mUseCompactVertices = true;
+
+        const float kMB = 1024.f * 1024.f;
+        const size_t fullByteSize = vertexCount * sizeof(PackedStaticVertexData);
+        const size_t compactByteSize = vertexCount * sizeof(CompactStaticVertexData);
+        logInfo("Using compact vertex format. Static vertex data " + std::to_string(fullByteSize / kMB) + " MB -> " + std::to_string(compactByteSize / kMB) + " MB");
+    }
+
+    void SceneBuilder::generateMeshLODs()
+    {
+        // This function generates simplified levels of detail for static indexed triangle meshes.
+        // Each LOD is simplified from the previous one, so the errors are accumulated to stay conservative.
+        // The LODs reference the vertices of the mesh and only add index data.
+        // With emissive mesh proxies, emissive meshes are replaced by their coarsest LOD, which is then used both for rendering and by the light collection.
+
+        if (!is_set(mFlags, Flags::GenerateMeshLODs))
+        {
+            if (is_set(mFlags, Flags::UseEmissiveMeshProxies)) logWarning("UseEmissiveMeshProxies requires GenerateMeshLODs. Ignoring emissive mesh proxies.");
+            return;
+        }
+        const bool useEmissiveProxies = is_set(mFlags, Flags::UseEmissiveMeshProxies);
+
+        std::unordered_set<uint32_t> cachedMeshIDs;
+        for (const auto& cachedMesh : mSceneData.cachedMeshes) cachedMeshIDs.insert(cachedMesh.meshID);
+
+        std::atomic<size_t> proxyCount{ 0 };
+        auto range = NumericRange<size_t>(0, mMeshes.size());
+        std::for_each(std::execution::par, range.begin(), range.end(), [&](size_t meshID) {
+            TRACE_ZONE("SceneBuilder::generateMeshLODs (mesh)");
+            auto& mesh = mMeshes[meshID];
+            mesh.lods.clear();
+
+            if (mesh.topology != Vao::Topology::TriangleList || mesh.indexCount == 0 || mesh.isDynamic() || mesh.isDisplaced) return;
+            if (cachedMeshIDs.count((uint32_t)meshID) > 0) return;
+            if (mesh.getTriangleCount() < kMeshLODMinTriangleCount) return;
+
+            pageInMeshData(mesh);
+
+            std::vector<float3> positions(mesh.staticData.size());
+            for (size_t i = 0; i < positions.size(); i++) positions[i] = mesh.staticData[i].position;
+
+            std::vector<uint32_t> indices(mesh.indexCount);
+            for (uint32_t i = 0; i < mesh.indexCount; i++) indices[i] = mesh.getIndex(i);
+
+            const float maxError = kMeshLODMaxRelativeError * mesh.boundingBox.radius();
+            float error = 0.f;
+
+            for (uint32_t lod = 1; lod < kMaxMeshLODCount; lod++)
+            {
+                MeshSimplifier::Options options;
+                options.targetIndexCount = indices.size() / 6 * 3;
+                options.targetError = maxError - error;
+
+                auto result = MeshSimplifier::simplify(positions.data(), positions.size(), indices.data(), indices.size(), options);
+                if (result.indices.size() > (1.f - kMeshLODMinReduction) * indices.size()) break;
+
+                indices = std::move(result.indices);
+                error += result.error;
+
+                if (is_set(mFlags, Flags::OptimizeVertexCache)) VertexCacheOptimizer::optimizeTriangleOrder(indices, mesh.vertexCount);
+
+                MeshSpec::LOD meshLOD;
+                meshLOD.indexCount = (uint32_t)indices.size();
+                meshLOD.indexData = mesh.use16BitIndices ? compact16BitIndices(indices) : indices;
+                meshLOD.error = error;
+                mesh.lods.push_back(std::move(meshLOD));
+
+                if (indices.size() / 3 < kMeshLODMinTriangleCount) break;
+            }
+
+            const bool isModified = !mesh.lods.empty();
+            if (useEmissiveProxies && isModified && mSceneData.materials[mesh.materialId]->isEmissive())
+            {
+                mesh.indexData = std::move(mesh.lods.back().indexData);
+                mesh.indexCount = mesh.lods.back().indexCount;
+                mesh.lods.clear();
+                proxyCount++;
+            }
+
+            pageOutMeshData(mesh, isModified);
+        });
+
+        size_t lodMeshCount = 0;
+        size_t lodCount = 0;
+        size_t indexCount = 0;
+        size_t lodIndexCount = 0;
+        for (const auto& mesh : mMeshes)
+        {
+            indexCount += mesh.indexCount;
+            if (mesh.lods.empty()) continue;
+            lodMeshCount++;
+            lodCount += mesh.lods.size();
+            for (const auto& lod : mesh.lods) lodIndexCount += lod.indexCount;
+        }
+
+        logInfo("Generated " + std::to_string(lodCount) + " LODs for " + std::to_string(lodMeshCount) + " out of " + std::to_string(mMeshes.size()) + " meshes. " +
+            "Index count " + std::to_string(indexCount) + " -> " + std::to_string(indexCount + lodIndexCount));
+        if (proxyCount > 0) logInfo("Replaced " + std::to_string(proxyCount) + " emissive meshes by proxies.");
     }
 
     void SceneBuilder::sortMeshes()
@@ -2139,25 +2509,38 @@ namespace Falcor
 
         const bool isIndexed = !is_set(mFlags, Flags::NonIndexedVertices);
 
+        if (is_set(mFlags, Flags::OutOfCoreGeometry))
+        {
+            bool hasDynamicMeshes = false;
+            for (const auto& mesh : mMeshes) hasDynamicMeshes |= mesh.isDynamic();
+
+            if (!hasDynamicMeshes)
+            {
+                createPagedGlobalBuffers(isIndexed);
+                return;
+            }
+
+            logWarning("Out-of-core geometry is not supported for scenes with dynamic meshes. Keeping all mesh data in memory.");
+            for (auto& mesh : mMeshes) pageInMeshData(mesh);
+            mMeshStoreStats = mpMeshStore->getStats();
+            mpMeshStore = nullptr;
+        }
+
         // Count total number of vertex and index data elements.
-        size_t totalIndexDataCount = 0;
-        size_t totalStaticVertexCount = 0;
-        size_t totalDynamicVertexCount = 0;
+        // The builder uses 64-bit offsets, but the GPU representation limits the size of the global buffers.
+        uint64_t totalIndexDataCount = 0;
+        uint64_t totalStaticVertexCount = 0;
+        uint64_t totalDynamicVertexCount = 0;
 
         for (const auto& mesh : mMeshes)
         {
             totalIndexDataCount += mesh.indexData.size();
+            for (const auto& lod : mesh.lods) totalIndexDataCount += lod.indexData.size();
             totalStaticVertexCount += mesh.staticData.size();
             totalDynamicVertexCount += mesh.dynamicData.size();
         }
 
-        // Check the range. We currently use 32-bit offsets.
-        if (totalIndexDataCount > std::numeric_limits<uint32_t>::max() ||
-            totalStaticVertexCount > std::numeric_limits<uint32_t>::max() ||
-            totalDynamicVertexCount > std::numeric_limits<uint32_t>::max())
-        {
-            throw std::exception("Trying to build a scene that exceeds supported mesh data size.");
-        }
+        checkMeshDataElementCount(isIndexed ? totalIndexDataCount : 0, totalStaticVertexCount, totalDynamicVertexCount);
 
         mSceneData.meshIndexData.reserve(totalIndexDataCount);
         mSceneData.meshStaticData.reserve(totalStaticVertexCount);
@@ -2166,8 +2549,8 @@ namespace Falcor
         // Copy all vertex and index data into the global buffers.
         for (auto& mesh : mMeshes)
         {
-            mesh.staticVertexOffset = (uint32_t)mSceneData.meshStaticData.size();
-            mesh.dynamicVertexOffset = (uint32_t)mSceneData.meshDynamicData.size();
+            mesh.staticVertexOffset = mSceneData.meshStaticData.size();
+            mesh.dynamicVertexOffset = mSceneData.meshDynamicData.size();
 
             // Insert the static vertex data in the global array.
             // The vertices are automatically converted to their packed format in this step.
@@ -2175,8 +2558,16 @@ namespace Falcor
 
             if (isIndexed)
             {
-                mesh.indexOffset = (uint32_t)mSceneData.meshIndexData.size();
+                mesh.indexOffset = mSceneData.meshIndexData.size();
                 mSceneData.meshIndexData.insert(mSceneData.meshIndexData.end(), mesh.indexData.begin(), mesh.indexData.end());
+
+                // Insert the LOD indices after the mesh indices.
+                for (auto& lod : mesh.lods)
+                {
+                    lod.indexOffset = mSceneData.meshIndexData.size();
+                    mSceneData.meshIndexData.insert(mSceneData.meshIndexData.end(), lod.indexData.begin(), lod.indexData.end());
+                    lod.indexData.clear();
+                }
             }
 
             if (mesh.isDynamic())
@@ -2185,9 +2576,13 @@ namespace Falcor
                 mSceneData.meshDynamicData.insert(mSceneData.meshDynamicData.end(), mesh.dynamicData.begin(), mesh.dynamicData.end());
 
                 // Patch vertex index references.
+                if (mesh.staticVertexOffset + mesh.staticVertexCount > std::numeric_limits<uint32_t>::max())
+                {
+                    throw std::exception("Trying to build a scene that exceeds supported mesh data size.");
+                }
                 for (uint32_t i = 0; i < mesh.dynamicData.size(); ++i)
                 {
-                    mSceneData.meshDynamicData[mesh.dynamicVertexOffset + i].staticIndex += mesh.staticVertexOffset;
+                    mSceneData.meshDynamicData[mesh.dynamicVertexOffset + i].staticIndex += (uint32_t)mesh.staticVertexOffset;
                 }
             }
 
@@ -2198,6 +2593,93 @@ namespace Falcor
         }
     }
 
+    void SceneBuilder::createPagedGlobalBuffers(bool isIndexed)
+    {
+        // This function copies the index and static vertex data of all meshes from the mesh store, which holds the data
+        // during import and post-processing, to a paged geometry store in the layout of the global buffers.
+        // The index data for all meshes is stored first, followed by the static vertex data. The data is copied in chunks
+        // of at most one page, so that the memory use is bounded by the resident budgets of the two stores.
+
+        assert(mpMeshStore);
+
+        // Check the size of the global buffers before copying any data.
+        uint64_t totalIndexDataCount = 0;
+        uint64_t totalStaticVertexCount = 0;
+        for (const auto& mesh : mMeshes)
+        {
+            totalIndexDataCount += mesh.pagedIndexData.count;
+            for (const auto& lod : mesh.lods) totalIndexDataCount += lod.pagedIndexData.count;
+            totalStaticVertexCount += mesh.pagedStaticData.count;
+        }
+        checkMeshDataElementCount(isIndexed ? totalIndexDataCount : 0, totalStaticVertexCount, 0);
+
+        auto pStore = PagedGeometryStore::create(getTempFilename(), mOutOfCorePageSize, mOutOfCoreResidentBudget);
+
+        auto copyIndexData = [&](const PagedRange& range)
+        {
+            mpMeshStore->forEachPage(range.offset, range.count * sizeof(uint32_t), [&](uint64_t offset, const void* pData, size_t size) { pStore->append(pData, size); });
+        };
+
+        mSceneData.meshIndexDataOffset = pStore->getSize();
+        uint64_t indexDataCount = 0;
+        if (isIndexed)
+        {
+            for (auto& mesh : mMeshes)
+            {
+                assert(mesh.isPagedOut);
+                mesh.indexOffset = indexDataCount;
+                copyIndexData(mesh.pagedIndexData);
+                indexDataCount += mesh.pagedIndexData.count;
+
+                for (auto& lod : mesh.lods)
+                {
+                    lod.indexOffset = indexDataCount;
+                    copyIndexData(lod.pagedIndexData);
+                    indexDataCount += lod.pagedIndexData.count;
+                }
+            }
+        }
+        mSceneData.meshIndexDataCount = indexDataCount;
+
+        mSceneData.meshStaticDataOffset = pStore->getSize();
+        uint64_t staticVertexCount = 0;
+        const size_t chunkVertexCount = std::max(mOutOfCorePageSize / sizeof(StaticVertexData), (size_t)1);
+        std::vector<StaticVertexData> vertices;
+        std::vector<PackedStaticVertexData> packedData;
+        for (auto& mesh : mMeshes)
+        {
+            assert(mesh.isPagedOut && !mesh.isDynamic());
+            mesh.staticVertexOffset = staticVertexCount;
+
+            // Convert to the packed format before writing.
+            for (uint64_t first = 0; first < mesh.pagedStaticData.count; first += chunkVertexCount)
+            {
+                vertices.resize((size_t)std::min((uint64_t)chunkVertexCount, mesh.pagedStaticData.count - first));
+                mpMeshStore->read(mesh.pagedStaticData.offset + first * sizeof(StaticVertexData), vertices.size() * sizeof(StaticVertexData), vertices.data());
+                packedData.assign(vertices.begin(), vertices.end());
+                pStore->append(packedData);
+            }
+            staticVertexCount += mesh.pagedStaticData.count;
+
+            // The mesh data is now only held in the global store.
+            mesh.isPagedOut = false;
+            mesh.hasPagedCopy = false;
+        }
+        mSceneData.meshStaticDataCount = staticVertexCount;
+
+        mSceneData.pGeometryStore = pStore;
+
+        const auto meshStoreStats = mpMeshStore->getStats();
+        const auto stats = pStore->getStats();
+        const float kMB = 1024.f * 1024.f;
+        logInfo("Streamed " + std::to_string(stats.size / kMB) + " MB of mesh data to paged geometry store (" + std::to_string(stats.pageCount) + " pages, " +
+            std::to_string(stats.peakResidentBytes / kMB) + " MB peak resident). Import store peak resident " + std::to_string(meshStoreStats.peakResidentBytes / kMB) + " MB.");
+
+        // Release the mesh store. This removes its backing file.
+        mMeshStoreStats = meshStoreStats;
+        mpMeshStore = nullptr;
+    }
+
     void SceneBuilder::createCurveGlobalBuffers()
     {
         assert(mSceneData.curveIndexData.empty());
@@ -2379,9 +2861,25 @@ namespace Falcor
                 float2 maxTexCrd = float2(-std::numeric_limits<float>::infinity());
                 float2 maxError = float2(0);
 
+                // With out-of-core geometry the vertices are read from the paged store and written back after quantization.
+                std::vector<PackedStaticVertexData> pagedData;
+                PackedStaticVertexData* pVertices = nullptr;
+                const auto& pStore = mSceneData.pGeometryStore;
+                const uint64_t storeOffset = mSceneData.meshStaticDataOffset + mesh.staticVertexOffset * sizeof(PackedStaticVertexData);
+                if (pStore)
+                {
+                    pagedData.resize(mesh.staticVertexCount);
+                    pStore->read(storeOffset, pagedData.size() * sizeof(PackedStaticVertexData), pagedData.data());
+                    pVertices = pagedData.data();
+                }
+                else
+                {
+                    pVertices = &mSceneData.meshStaticData[mesh.staticVertexOffset];
+                }
+
                 for (uint32_t i = 0; i < mesh.staticVertexCount; ++i)
                 {
-                    auto& v = mSceneData.meshStaticData[mesh.staticVertexOffset + i];
+                    auto& v = pVertices[i];
                     float2 texCrd = v.texCrd;
                     minTexCrd = min(minTexCrd, texCrd);
                     maxTexCrd = max(maxTexCrd, texCrd);
@@ -2389,6 +2887,8 @@ namespace Falcor
                     maxError = max(maxError, abs(v.texCrd - texCrd));
                 }
 
+                if (pStore) pStore->write(storeOffset, pagedData.size() * sizeof(PackedStaticVertexData), pagedData.data());
+
                 // Issue warning if quantization errors are too large.
                 float2 maxAbsCrd = max(abs(minTexCrd), abs(maxTexCrd));
                 if (maxAbsCrd.x > HLF_MAX || maxAbsCrd.y > HLF_MAX)
@@ -2416,6 +2916,33 @@ namespace Falcor
         }
     }
 
+    void SceneBuilder::createCompactVertexData()
+    {
+        // Convert the global vertex data to the compact format. This runs after quantizeTexCoords() so that the vertices are final.
+        // The positions are quantized relative to the mesh bounding box, which is in world space for pre-transformed static meshes.
+
+        if (!mUseCompactVertices) return;
+        assert(mSceneData.meshCompactStaticData.empty() && mSceneData.meshVertexQuantization.empty());
+
+        mSceneData.meshCompactStaticData.resize(mSceneData.meshStaticData.size());
+        mSceneData.meshVertexQuantization.resize(mMeshes.size());
+
+        auto range = NumericRange<size_t>(0, mMeshes.size());
+        std::for_each(std::execution::par, range.begin(), range.end(), [&](size_t meshID) {
+            const auto& mesh = mMeshes[meshID];
+            const VertexQuantization q = VertexQuantization::create(mesh.boundingBox.minPoint, mesh.boundingBox.maxPoint);
+            mSceneData.meshVertexQuantization[meshID] = q;
+
+            for (uint64_t i = mesh.staticVertexOffset; i < mesh.staticVertexOffset + mesh.staticVertexCount; i++)
+            {
+                mSceneData.meshCompactStaticData[i].pack(mSceneData.meshStaticData[i].unpack(), q);
+            }
+        });
+
+        // Free the full format data.
+        mSceneData.meshStaticData = {};
+    }
+
     void SceneBuilder::removeDuplicateSDFGrids()
     {
         // Removes duplicate SDF grids.
@@ -2460,16 +2987,38 @@ namespace Falcor
         for (uint32_t meshID = 0; meshID < mMeshes.size(); meshID++)
         {
             const auto& mesh = mMeshes[meshID];
+
+            // The builder uses 64-bit offsets, but the runtime mesh data uses 32-bit offsets.
+            const uint64_t kMaxOffset = std::numeric_limits<uint32_t>::max();
+            bool isInRange = mesh.staticVertexOffset + mesh.staticVertexCount <= kMaxOffset &&
+                mesh.dynamicVertexOffset + mesh.dynamicVertexCount <= kMaxOffset &&
+                mesh.indexOffset <= kMaxOffset;
+            for (const auto& lod : mesh.lods) isInRange &= lod.indexOffset <= kMaxOffset;
+            if (!isInRange)
+            {
+                throw std::exception("Trying to build a scene that exceeds supported mesh data size.");
+            }
+
             meshData[meshID].materialID = mesh.materialId;
-            meshData[meshID].vbOffset = mesh.staticVertexOffset;
-            meshData[meshID].ibOffset = mesh.indexOffset;
+            meshData[meshID].vbOffset = (uint32_t)mesh.staticVertexOffset;
+            meshData[meshID].ibOffset = (uint32_t)mesh.indexOffset;
             meshData[meshID].vertexCount = mesh.vertexCount;
             meshData[meshID].indexCount = mesh.indexCount;
-            meshData[meshID].dynamicVbOffset = mesh.hasDynamicData ? mesh.dynamicVertexOffset : 0;
+            meshData[meshID].dynamicVbOffset = mesh.hasDynamicData ? (uint32_t)mesh.dynamicVertexOffset : 0;
             assert(mesh.dynamicVertexCount == 0 || mesh.dynamicVertexCount == mesh.staticVertexCount);
 
             mSceneData.meshNames.push_back(mesh.name);
 
+            for (const auto& lod : mesh.lods)
+            {
+                MeshLODDesc lodDesc;
+                lodDesc.meshID = meshID;
+                lodDesc.ibOffset = (uint32_t)lod.indexOffset;
+                lodDesc.indexCount = lod.indexCount;
+                lodDesc.error = lod.error;
+                mSceneData.meshLODs.push_back(lodDesc);
+            }
+
             uint32_t meshFlags = 0;
             meshFlags |= mesh.use16BitIndices ? (uint32_t)MeshFlags::Use16BitIndices : 0;
             meshFlags |= mesh.hasDynamicData ? (uint32_t)MeshFlags::HasDynamicData : 0;
@@ -2587,8 +3136,8 @@ namespace Falcor
                     meshInstance.globalMatrixID = nodeID;
                     meshInstance.materialID = mesh.materialId;
                     meshInstance.meshID = meshID;
-                    meshInstance.vbOffset = mesh.staticVertexOffset;
-                    meshInstance.ibOffset = mesh.indexOffset;
+                    meshInstance.vbOffset = (uint32_t)mesh.staticVertexOffset;
+                    meshInstance.ibOffset = (uint32_t)mesh.indexOffset;
 
                     uint32_t instanceFlags = 0;
                     instanceFlags |= mesh.use16BitIndices ? (uint32_t)MeshInstanceFlags::Use16BitIndices : 0;
@@ -2721,6 +3270,12 @@ namespace Falcor
         flags.value("DontOptimizeGraph", SceneBuilder::Flags::DontOptimizeGraph);
         flags.value("DontOptimizeMaterials", SceneBuilder::Flags::DontOptimizeMaterials);
         flags.value("DontUseDisplacement", SceneBuilder::Flags::DontUseDisplacement);
+        flags.value("OptimizeVertexCache", SceneBuilder::Flags::OptimizeVertexCache);
+        flags.value("UseCompactVertices", SceneBuilder::Flags::UseCompactVertices);
+        flags.value("GenerateMeshLODs", SceneBuilder::Flags::GenerateMeshLODs);
+        flags.value("OutOfCoreGeometry", SceneBuilder::Flags::OutOfCoreGeometry);
+        flags.value("HostRayTracing", SceneBuilder::Flags::HostRayTracing);
+        flags.value("UseEmissiveMeshProxies", SceneBuilder::Flags::UseEmissiveMeshProxies);
         flags.value("UseCache", SceneBuilder::Flags::UseCache);
         flags.value("RebuildCache", SceneBuilder::Flags::RebuildCache);
         ScriptBindings::addEnumBinaryOperators(flags);
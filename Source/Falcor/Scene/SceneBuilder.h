@@ -42,6 +42,11 @@ namespace Falcor
 
         static const uint32_t kInvalidNode = Animatable::kInvalidNode;
 
+        /** Max number of elements in each of the global mesh index and vertex buffers.
+            The runtime mesh data (MeshDesc) addresses these buffers with 32-bit offsets. Building a scene with more mesh data throws an exception, also with Flags::OutOfCoreGeometry.
+        */
+        static const uint64_t kMaxMeshDataElementCount = std::numeric_limits<uint32_t>::max();
+
         /** Flags that control how the scene will be built. They can be combined together.
         */
         enum class Flags
@@ -62,6 +67,12 @@ namespace Falcor
             DontOptimizeGraph           = 0x1000, ///< Don't optimize the scene graph to remove unnecessary nodes.
             DontOptimizeMaterials       = 0x2000, ///< Don't optimize materials by removing constant textures. The optimizations are lossless so should generally be enabled.
             DontUseDisplacement         = 0x4000, ///< Don't use displacement mapping.
+            OptimizeVertexCache         = 0x8000, ///< Reorder triangles and vertices of static meshes for vertex cache and memory locality. Very large meshes are also sorted spatially.
+            UseCompactVertices          = 0x10000, ///< Store the mesh vertices in the compact 16B format (CompactStaticVertexData) if all meshes are within its error bounds. Falls back to the full format otherwise, and for scenes with skinned or vertex-animated meshes or out-of-core geometry.
+            GenerateMeshLODs            = 0x20000, ///< Generate simplified levels of detail for static triangle meshes. The LODs share the vertex data of the mesh and are stored as extra index ranges.
+            OutOfCoreGeometry           = 0x40000, ///< Page the mesh index and vertex data out to a file-backed store as meshes are imported, keeping a bounded set of pages in memory. Not supported for dynamic meshes. The mesh data is still limited to kMaxMeshDataElementCount vertices and indices.
+            HostRayTracing              = 0x80000, ///< Build an acceleration structure for CPU ray queries, see Scene::getHostRayTracer(). Only triangle meshes are included.
+            UseEmissiveMeshProxies      = 0x100000, ///< Replace static emissive meshes by their coarsest generated LOD. This reduces the number of emissive triangles in the light collection. Requires GenerateMeshLODs.
 
             UseCache                    = 0x10000000, ///< Enable scene caching. This caches the runtime scene representation on disk to reduce load time.
             RebuildCache                = 0x20000000, ///< Rebuild scene cache.
@@ -392,6 +403,18 @@ namespace Falcor
         */
         uint32_t addProcessedMesh(const ProcessedMesh& mesh);
 
+        /** Set the page size and resident memory budget used for out-of-core geometry (see Flags::OutOfCoreGeometry).
+            This must be called before any meshes are added.
+            \param[in] pageSize Page size in bytes.
+            \param[in] residentBudget Max memory used by resident pages of each paged store in bytes.
+        */
+        void setOutOfCoreBudget(size_t pageSize, size_t residentBudget);
+
+        /** Get statistics of the paged store holding the imported mesh data with out-of-core geometry.
+            The store is released when the scene is created, after which its final statistics are returned.
+        */
+        PagedGeometryStore::Stats getOutOfCoreStats() const;
+
         /** Set mesh vertex cache for animation.
             \param[in] cachedCurves The mesh vertex cache data.
         */
@@ -621,16 +644,22 @@ namespace Falcor
             bool hasObjects() const { return !meshes.empty() || !curves.empty() || !sdfGrids.empty() || !animatable.empty(); }
         };
 
+        struct PagedRange
+        {
+            uint64_t offset = 0;                    ///< Byte offset in the out-of-core mesh store.
+            uint64_t count = 0;                     ///< Number of elements.
+        };
+
         struct MeshSpec
         {
             std::string name;
             Vao::Topology topology = Vao::Topology::Undefined;
             uint32_t materialId = 0;                ///< Global material ID.
-            uint32_t staticVertexOffset = 0;        ///< Offset into the shared 'staticData' array. This is calculated in createGlobalBuffers().
+            uint64_t staticVertexOffset = 0;        ///< Offset into the shared 'staticData' array. This is calculated in createGlobalBuffers().
             uint32_t staticVertexCount = 0;         ///< Number of static vertices.
-            uint32_t dynamicVertexOffset = 0;       ///< Offset into the shared 'dynamicData' array. This is calculated in createGlobalBuffers().
+            uint64_t dynamicVertexOffset = 0;       ///< Offset into the shared 'dynamicData' array. This is calculated in createGlobalBuffers().
             uint32_t dynamicVertexCount = 0;        ///< Number of dynamic vertices.
-            uint32_t indexOffset = 0;               ///< Offset into the shared 'indexData' array. This is calculated in createGlobalBuffers().
+            uint64_t indexOffset = 0;               ///< Offset into the shared 'indexData' array. This is calculated in createGlobalBuffers().
             uint32_t indexCount = 0;                ///< Number of indices, or zero if non-indexed.
             uint32_t vertexCount = 0;               ///< Number of vertices.
             uint32_t skeletonNodeID = kInvalidNode; ///< Node ID of skeleton world transform. Forwarded from Mesh struct.
@@ -642,11 +671,27 @@ namespace Falcor
             AABB boundingBox;                       ///< Mesh bounding-box in object space.
             std::vector<uint32_t> instances;        ///< Node IDs of all instances of this mesh.
 
+            struct LOD
+            {
+                std::vector<uint32_t> indexData;    ///< Vertex indices in the same format as the mesh indices.
+                uint64_t indexOffset = 0;           ///< Offset into the shared 'indexData' array. This is calculated in createGlobalBuffers().
+                uint32_t indexCount = 0;            ///< Number of indices.
+                float error = 0.f;                  ///< Geometric error as a distance in object space.
+                PagedRange pagedIndexData;          ///< Location of the index data in the out-of-core mesh store.
+            };
+            std::vector<LOD> lods;                  ///< Simplified levels of detail ordered from fine to coarse. This is generated in generateMeshLODs().
+
             // Pre-processed vertex data.
             std::vector<uint32_t> indexData;    ///< Vertex indices in either 32-bit or 16-bit format packed tightly, or empty if non-indexed.
             std::vector<StaticVertexData> staticData;
             std::vector<DynamicVertexData> dynamicData;
 
+            // Out-of-core storage of the pre-processed vertex data. See pageOutMeshData().
+            bool isPagedOut = false;                ///< True if the index and static vertex data is only held in the out-of-core mesh store.
+            bool hasPagedCopy = false;              ///< True if the out-of-core mesh store holds an up-to-date copy of the data.
+            PagedRange pagedIndexData;              ///< Location of the index data in the out-of-core mesh store.
+            PagedRange pagedStaticData;             ///< Location of the static vertex data in the out-of-core mesh store.
+
             uint32_t getTriangleCount() const
             {
                 assert(topology == Vao::Topology::TriangleList);
@@ -695,6 +740,12 @@ namespace Falcor
         Scene::SharedPtr mpScene;
         SceneCache::Key mSceneCacheKey;
         bool mWriteSceneCache = false;  ///< True if scene cache should be written after import.
+        bool mUseCompactVertices = false; ///< True if the mesh vertices are converted to the compact format.
+
+        PagedGeometryStore::SharedPtr mpMeshStore;  ///< Paged store holding the imported mesh data with out-of-core geometry until the global buffers are created.
+        PagedGeometryStore::Stats mMeshStoreStats;  ///< Statistics of the mesh store when it was released.
+        size_t mOutOfCorePageSize = 16ull * 1024 * 1024;
+        size_t mOutOfCoreResidentBudget = 256ull * 1024 * 1024;
 
         SceneGraph mSceneGraph;
         const Flags mFlags;
@@ -713,6 +764,8 @@ namespace Falcor
         bool collapseNodes(uint32_t parentNodeID, uint32_t childNodeID);
         bool mergeNodes(uint32_t dstNodeID, uint32_t srcNodeID);
         void flipTriangleWinding(MeshSpec& mesh);
+        void pageOutMeshData(MeshSpec& mesh, bool isModified = true);
+        void pageInMeshData(MeshSpec& mesh);
         void updateSDFGridID(uint32_t oldID, uint32_t newID);
 
         /** Split a mesh by the given axis-aligned splitting plane.
@@ -742,13 +795,18 @@ namespace Falcor
         void calculateMeshBoundingBoxes();
         void createMeshGroups();
         void optimizeGeometry();
+        void optimizeVertexLocality();
+        void prepareCompactVertices();
+        void generateMeshLODs();
         void sortMeshes();
         void createGlobalBuffers();
+        void createPagedGlobalBuffers(bool isIndexed);
         void createCurveGlobalBuffers();
         void optimizeMaterials();
         void removeDuplicateMaterials();
         void collectVolumeGrids();
         void quantizeTexCoords();
+        void createCompactVertexData();
         void removeDuplicateSDFGrids();
 
         // Scene setup
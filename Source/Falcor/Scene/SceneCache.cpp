@@ -38,12 +38,16 @@ namespace Falcor
         /** Specfies the current cache file version.
             This needs to be incremented every time the file format changes!
         */
-        const uint32_t kVersion = 17;
+        const uint32_t kVersion = 20;
 
         /** Scene cache directory (subdirectory in the application data directory).
         */
         const std::string kDirectory = "NVIDIA/Falcor/SceneCache";
 
+        /** Suffix of the directory holding the emissive flux and light BVH entries of a scene (next to the scene cache file).
+        */
+        const std::string kLightCacheSuffix = "-lights";
+
         const size_t kBlockSize = 1 * 1024 * 1024;
 
         const char* kMagic = "FalcorS$";
@@ -57,6 +61,14 @@ namespace Falcor
                 return std::memcmp(magic, kMagic, sizeof(Header::magic)) == 0 && version == kVersion;
             }
         };
+
+        std::string keyToString(const SceneCache::Key& key)
+        {
+            std::stringstream ss;
+            ss << std::hex << std::setfill('0');
+            for (auto c : key) ss << std::setw(2) << (int)c;
+            return ss.str();
+        }
     }
 
     /** Wrapper around std::ostream to ease serialization of basic types.
@@ -172,6 +184,50 @@ namespace Falcor
         std::istream& mStream;
     };
 
+    template<typename WriteFunc>
+    void SceneCache::writeEntry(const std::filesystem::path& path, WriteFunc writeFunc)
+    {
+        // Create directories if not existing.
+        std::filesystem::create_directories(path.parent_path());
+
+        // Open file.
+        std::ofstream fs(path.c_str(), std::ios_base::binary);
+        if (fs.bad()) throw std::runtime_error("Failed to create scene cache file '" + path.string() + "'!");
+
+        // Write header (uncompressed).
+        Header header;
+        std::memcpy(header.magic, kMagic, sizeof(Header::magic));
+        header.version = kVersion;
+        fs.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+        // Write cache (compressed).
+        lz4_stream::basic_ostream<kBlockSize> zs(fs);
+        OutputStream stream(zs);
+        writeFunc(stream);
+        if (fs.bad()) throw std::runtime_error("Failed to write scene cache file to '" + path.string() + "'!");
+    }
+
+    template<typename ReadFunc>
+    bool SceneCache::readEntry(const std::filesystem::path& path, ReadFunc readFunc)
+    {
+        if (!std::filesystem::exists(path)) return false;
+
+        // Open file.
+        std::ifstream fs(path.c_str(), std::ios_base::binary);
+        if (fs.bad()) return false;
+
+        // Read header (uncompressed). Entries written by other cache versions are ignored.
+        Header header;
+        fs.read(reinterpret_cast<char*>(&header), sizeof(header));
+        if (fs.eof() || !header.isValid()) return false;
+
+        // Read cache (compressed).
+        lz4_stream::basic_istream<kBlockSize, kBlockSize> zs(fs);
+        InputStream stream(zs);
+        readFunc(stream);
+        return !fs.bad() && !zs.fail();
+    }
+
     bool SceneCache::hasValidCache(const Key& key)
     {
         auto cachePath = getCachePath(key);
@@ -193,24 +249,10 @@ namespace Falcor
 
         logInfo("Writing scene cache to " + cachePath.string());
 
-        // Create directories if not existing.
-        std::filesystem::create_directories(cachePath.parent_path());
-
-        // Open file.
-        std::ofstream fs(cachePath.c_str(), std::ios_base::binary);
-        if (fs.bad()) throw std::runtime_error("Failed to create scene cache file '" + cachePath.string() + "'!");
-
-        // Write header (uncompressed).
-        Header header;
-        std::memcpy(header.magic, kMagic, sizeof(Header::magic));
-        header.version = kVersion;
-        fs.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        // The emissive flux and light BVHs were derived from the previous scene data.
+        clearLightCache(key);
 
-        // Write cache (compressed).
-        lz4_stream::basic_ostream<kBlockSize> zs(fs);
-        OutputStream stream(zs);
-        writeSceneData(stream, sceneData);
-        if (fs.bad()) throw std::runtime_error("Failed to write scene cache file to '" + cachePath.string() + "'!");
+        writeEntry(cachePath, [&sceneData](OutputStream& stream) { writeSceneData(stream, sceneData); });
     }
 
     Scene::SceneData SceneCache::readCache(const Key& key)
@@ -236,12 +278,65 @@ namespace Falcor
         return sceneData;
     }
 
+    void SceneCache::writeEmissiveFlux(const Key& sceneKey, const Key& contentKey, const std::vector<EmissiveFlux>& fluxData)
+    {
+        writeEntry(getLightCachePath(sceneKey, "flux", contentKey), [&fluxData](OutputStream& stream)
+        {
+            stream.write((uint64_t)fluxData.size());
+            stream.write(fluxData.data(), fluxData.size() * sizeof(EmissiveFlux));
+        });
+    }
+
+    bool SceneCache::readEmissiveFlux(const Key& sceneKey, const Key& contentKey, std::vector<EmissiveFlux>& fluxData)
+    {
+        return readEntry(getLightCachePath(sceneKey, "flux", contentKey), [&fluxData](InputStream& stream)
+        {
+            fluxData.resize(stream.read<uint64_t>());
+            stream.read(fluxData.data(), fluxData.size() * sizeof(EmissiveFlux));
+        });
+    }
+
+    void SceneCache::writeLightBVH(const Key& sceneKey, const Key& bvhKey, const LightBVHData& data)
+    {
+        writeEntry(getLightCachePath(sceneKey, "bvh", bvhKey), [&data](OutputStream& stream)
+        {
+            stream.write(data.maxTriangleCountPerLeaf);
+            stream.write((uint64_t)data.nodes.size());
+            stream.write(data.nodes.data(), data.nodes.size() * sizeof(PackedNode));
+            stream.write(data.triangleIndices);
+            stream.write(data.triangleBitmasks);
+        });
+    }
+
+    bool SceneCache::readLightBVH(const Key& sceneKey, const Key& bvhKey, LightBVHData& data)
+    {
+        return readEntry(getLightCachePath(sceneKey, "bvh", bvhKey), [&data](InputStream& stream)
+        {
+            stream.read(data.maxTriangleCountPerLeaf);
+            data.nodes.resize(stream.read<uint64_t>());
+            stream.read(data.nodes.data(), data.nodes.size() * sizeof(PackedNode));
+            stream.read(data.triangleIndices);
+            stream.read(data.triangleBitmasks);
+        });
+    }
+
+    void SceneCache::clearLightCache(const Key& sceneKey)
+    {
+        std::filesystem::path path = getCachePath(sceneKey).string() + kLightCacheSuffix;
+        std::error_code ec;
+        std::filesystem::remove_all(path, ec);
+        if (ec) logWarning("Failed to remove light cache directory '" + path.string() + "'.");
+    }
+
     std::filesystem::path SceneCache::getCachePath(const Key& key)
     {
-        std::stringstream ss;
-        ss << std::hex << std::setfill('0') << std::setw(2);
-        for (auto c : key) ss << (int)c;
-        return std::filesystem::path(getAppDataDirectory()) / kDirectory / ss.str();
+        return std::filesystem::path(getAppDataDirectory()) / kDirectory / keyToString(key);
+    }
+
+    std::filesystem::path SceneCache::getLightCachePath(const Key& sceneKey, const std::string& type, const Key& entryKey)
+    {
+        std::filesystem::path dir = getCachePath(sceneKey).string() + kLightCacheSuffix;
+        return dir / (type + "-" + keyToString(entryKey));
     }
 
     // SceneData
@@ -306,6 +401,7 @@ namespace Falcor
         stream.write(sceneData.meshDesc);
         stream.write(sceneData.meshNames);
         stream.write(sceneData.meshBBs);
+        stream.write(sceneData.meshLODs);
         stream.write(sceneData.meshInstanceData);
         stream.write(sceneData.displacedMeshInstanceCount);
         stream.write((uint32_t)sceneData.meshIdToInstanceIds.size());
@@ -333,7 +429,18 @@ namespace Falcor
         stream.write(sceneData.meshDrawCount);
         stream.write(sceneData.meshIndexData);
         stream.write(sceneData.meshStaticData);
+        stream.write(sceneData.meshCompactStaticData);
+        stream.write(sceneData.meshVertexQuantization);
         stream.write(sceneData.meshDynamicData);
+        stream.write(sceneData.pGeometryStore != nullptr);
+        if (sceneData.pGeometryStore)
+        {
+            writeGeometryStore(stream, sceneData.pGeometryStore);
+            stream.write(sceneData.meshIndexDataOffset);
+            stream.write(sceneData.meshIndexDataCount);
+            stream.write(sceneData.meshStaticDataOffset);
+            stream.write(sceneData.meshStaticDataCount);
+        }
 
         writeMarker(stream, "Curves");
         stream.write(sceneData.curveDesc);
@@ -426,6 +533,7 @@ namespace Falcor
         stream.read(sceneData.meshDesc);
         stream.read(sceneData.meshNames);
         stream.read(sceneData.meshBBs);
+        stream.read(sceneData.meshLODs);
         stream.read(sceneData.meshInstanceData);
         stream.read(sceneData.displacedMeshInstanceCount);
         sceneData.meshIdToInstanceIds.resize(stream.read<uint32_t>());
@@ -453,7 +561,17 @@ namespace Falcor
         stream.read(sceneData.meshDrawCount);
         stream.read(sceneData.meshIndexData);
         stream.read(sceneData.meshStaticData);
+        stream.read(sceneData.meshCompactStaticData);
+        stream.read(sceneData.meshVertexQuantization);
         stream.read(sceneData.meshDynamicData);
+        if (stream.read<bool>())
+        {
+            sceneData.pGeometryStore = readGeometryStore(stream);
+            stream.read(sceneData.meshIndexDataOffset);
+            stream.read(sceneData.meshIndexDataCount);
+            stream.read(sceneData.meshStaticDataOffset);
+            stream.read(sceneData.meshStaticDataCount);
+        }
 
         readMarker(stream, "Curves");
         stream.read(sceneData.curveDesc);
@@ -483,6 +601,34 @@ namespace Falcor
         return sceneData;
     }
 
+    // PagedGeometryStore
+
+    void SceneCache::writeGeometryStore(OutputStream& stream, const PagedGeometryStore::SharedPtr& pStore)
+    {
+        // The data is streamed page by page, so that out-of-core geometry is never fully loaded into memory.
+        stream.write((uint64_t)pStore->getPageSize());
+        stream.write(pStore->getResidentBudget());
+        stream.write(pStore->getSize());
+        pStore->forEachPage(0, pStore->getSize(), [&stream](uint64_t offset, const void* pData, size_t size) { stream.write(pData, size); });
+    }
+
+    PagedGeometryStore::SharedPtr SceneCache::readGeometryStore(InputStream& stream)
+    {
+        const size_t pageSize = (size_t)stream.read<uint64_t>();
+        const size_t residentBudget = (size_t)stream.read<uint64_t>();
+        const uint64_t size = stream.read<uint64_t>();
+
+        auto pStore = PagedGeometryStore::create(getTempFilename(), pageSize, residentBudget);
+        std::vector<uint8_t> chunk;
+        for (uint64_t offset = 0; offset < size; offset += chunk.size())
+        {
+            chunk.resize((size_t)std::min((uint64_t)pageSize, size - offset));
+            stream.read(chunk.data(), chunk.size());
+            pStore->append(chunk);
+        }
+        return pStore;
+    }
+
     // Metadata
 
     void SceneCache::writeMetadata(OutputStream& stream, const Scene::Metadata& metadata)
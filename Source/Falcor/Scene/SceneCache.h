@@ -29,6 +29,8 @@
 #include "Material/BasicMaterial.h"
 #include "Material/MaterialTextureLoader.h"
 #include "Utils/CryptoUtils.h"
+#include "Scene/Lights/LightCollectionShared.slang"
+#include "Rendering/Lights/LightBVHTypes.slang"
 
 #include <filesystem>
 
@@ -37,12 +39,26 @@ namespace Falcor
     /** Helper class for reading and writing scene cache files.
         The scene cache is used to heavily reduce load times of more complex assets.
         The cache stores a binary representation of `Scene::SceneData` which contains everything to re-create a `Scene`.
+
+        Data derived from the emissive geometry at runtime (pre-integrated triangle flux and light BVHs) is stored in
+        separate entries next to the scene cache file. Each entry is identified by the scene cache key and a key
+        describing its inputs, and all entries of a scene are removed when its scene cache is rewritten.
     */
     class dlldecl SceneCache
     {
     public:
         using Key = SHA1::MD;
 
+        /** Serialized light BVH, see LightBVH.
+        */
+        struct LightBVHData
+        {
+            std::vector<PackedNode> nodes;              ///< BVH nodes.
+            std::vector<uint32_t> triangleIndices;      ///< Triangle indices sorted by leaf node.
+            std::vector<uint64_t> triangleBitmasks;     ///< Per-triangle bit pattern of the path to the leaf node.
+            uint32_t maxTriangleCountPerLeaf = 0;       ///< Largest number of triangles in a leaf node.
+        };
+
         /** Check if there is a valid scene cache for a given cache key.
             \param[in] key Cache key.
             \return Returns true if a valid cache exists.
@@ -61,15 +77,59 @@ namespace Falcor
         */
         static Scene::SceneData readCache(const Key& key);
 
+        /** Write the pre-integrated flux of the emissive triangles.
+            \param[in] sceneKey Scene cache key.
+            \param[in] contentKey Key identifying the emissive content the flux was computed from.
+            \param[in] fluxData Per-triangle flux data.
+        */
+        static void writeEmissiveFlux(const Key& sceneKey, const Key& contentKey, const std::vector<EmissiveFlux>& fluxData);
+
+        /** Read the pre-integrated flux of the emissive triangles.
+            \param[in] sceneKey Scene cache key.
+            \param[in] contentKey Key identifying the emissive content the flux was computed from.
+            \param[out] fluxData Per-triangle flux data.
+            \return Returns true if a valid entry was found.
+        */
+        static bool readEmissiveFlux(const Key& sceneKey, const Key& contentKey, std::vector<EmissiveFlux>& fluxData);
+
+        /** Write a light BVH.
+            \param[in] sceneKey Scene cache key.
+            \param[in] bvhKey Key identifying the build options and emissive triangles the BVH was built from.
+            \param[in] data BVH data.
+        */
+        static void writeLightBVH(const Key& sceneKey, const Key& bvhKey, const LightBVHData& data);
+
+        /** Read a light BVH.
+            \param[in] sceneKey Scene cache key.
+            \param[in] bvhKey Key identifying the build options and emissive triangles the BVH was built from.
+            \param[out] data BVH data.
+            \return Returns true if a valid entry was found.
+        */
+        static bool readLightBVH(const Key& sceneKey, const Key& bvhKey, LightBVHData& data);
+
+        /** Remove all emissive flux and light BVH entries of a scene.
+            \param[in] sceneKey Scene cache key.
+        */
+        static void clearLightCache(const Key& sceneKey);
+
     private:
         class OutputStream;
         class InputStream;
 
         static std::filesystem::path getCachePath(const Key& key);
+        static std::filesystem::path getLightCachePath(const Key& sceneKey, const std::string& type, const Key& entryKey);
+
+        template<typename WriteFunc>
+        static void writeEntry(const std::filesystem::path& path, WriteFunc writeFunc);
+        template<typename ReadFunc>
+        static bool readEntry(const std::filesystem::path& path, ReadFunc readFunc);
 
         static void writeSceneData(OutputStream& stream, const Scene::SceneData& sceneData);
         static Scene::SceneData readSceneData(InputStream& stream);
 
+        static void writeGeometryStore(OutputStream& stream, const PagedGeometryStore::SharedPtr& pStore);
+        static PagedGeometryStore::SharedPtr readGeometryStore(InputStream& stream);
+
         static void writeMetadata(OutputStream& stream, const Scene::Metadata& metadata);
         static Scene::Metadata readMetadata(InputStream& stream);
 
@@ -0,0 +1,117 @@
+/***************************************************************************
+ # Copyright (c) 2015-21, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "stdafx.h"
+#include "SceneUpdateScheduler.h"
+#include <execution>
+
+namespace Falcor
+{
+    SceneUpdateScheduler::StageID SceneUpdateScheduler::addStage(const std::string& name, StageFunc prepare, StageFunc commit, const std::vector<StageID>& dependencies)
+    {
+        const StageID id = (StageID)mStages.size();
+
+        uint32_t wave = 0;
+        for (StageID dependency : dependencies)
+        {
+            if (dependency >= id) throw std::exception("SceneUpdateScheduler stages can only depend on previously added stages.");
+            wave = std::max(wave, mStages[dependency].wave + 1);
+        }
+
+        Stage stage;
+        stage.name = name;
+        stage.prepare = std::move(prepare);
+        stage.commit = std::move(commit);
+        stage.wave = wave;
+        mStages.push_back(std::move(stage));
+
+        if (wave >= mWaves.size()) mWaves.resize(wave + 1);
+        mWaves[wave].push_back(id);
+
+        return id;
+    }
+
+    void SceneUpdateScheduler::execute()
+    {
+        auto startTime = CpuTimer::getCurrentTimePoint();
+
+        mStats.stages.resize(mStages.size());
+        for (StageID id = 0; id < (StageID)mStages.size(); id++)
+        {
+            auto& stats = mStats.stages[id];
+            stats.name = mStages[id].name;
+            stats.wave = mStages[id].wave;
+            stats.prepareTime = 0.0;
+            stats.commitTime = 0.0;
+        }
+
+        for (const auto& wave : mWaves)
+        {
+            // Run the prepare functions. Exceptions are caught and rethrown on the calling thread below.
+            auto prepare = [this](StageID id)
+            {
+                Stage& stage = mStages[id];
+                stage.exception = nullptr;
+                if (!stage.prepare) return;
+
+                auto t0 = CpuTimer::getCurrentTimePoint();
+                try
+                {
+                    stage.prepare();
+                }
+                catch (...)
+                {
+                    stage.exception = std::current_exception();
+                }
+                mStats.stages[id].prepareTime = CpuTimer::calcDuration(t0, CpuTimer::getCurrentTimePoint());
+            };
+
+            if (mParallel && wave.size() > 1) std::for_each(std::execution::par, wave.begin(), wave.end(), prepare);
+            else std::for_each(wave.begin(), wave.end(), prepare);
+
+            for (StageID id : wave)
+            {
+                if (mStages[id].exception) std::rethrow_exception(mStages[id].exception);
+            }
+
+            // Run the commit functions in the order the stages were added.
+            for (StageID id : wave)
+            {
+                Stage& stage = mStages[id];
+                if (!stage.commit) continue;
+
+                auto t0 = CpuTimer::getCurrentTimePoint();
+                stage.commit();
+                mStats.stages[id].commitTime = CpuTimer::calcDuration(t0, CpuTimer::getCurrentTimePoint());
+            }
+        }
+
+        mStats.totalTime = CpuTimer::calcDuration(startTime, CpuTimer::getCurrentTimePoint());
+        mStats.serialTime = 0.0;
+        for (const auto& stats : mStats.stages) mStats.serialTime += stats.prepareTime + stats.commitTime;
+    }
+}
@@ -0,0 +1,126 @@
+/***************************************************************************
+ # Copyright (c) 2015-21, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#pragma once
+#include <exception>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace Falcor
+{
+    /** Schedules the stages of the per-frame scene update.
+
+        Each stage has an optional prepare function and an optional commit function:
+        - The prepare function does CPU-only work (animation evaluation, data packing etc.) and may run on a
+          worker thread concurrently with the prepare functions of other stages. It must not touch GPU resources,
+          parameter blocks or the render context, and must only write state owned by its stage.
+        - The commit function runs on the thread calling execute(). This is where GPU uploads and any other
+          work requiring the render context is done.
+
+        Stages can only depend on previously added stages, so the order of addStage() calls is a valid execution order.
+        execute() groups the stages into waves, where each stage is placed in the first wave after all of its
+        dependencies. The prepare functions of a wave run in parallel, after which the commit functions of the wave
+        run in the order the stages were added. A stage is therefore guaranteed to see the committed results of all
+        of its dependencies, while independent stages overlap their CPU work.
+
+        Exceptions thrown by a prepare function are rethrown by execute() on the calling thread once the wave has finished.
+    */
+    class dlldecl SceneUpdateScheduler
+    {
+    public:
+        using StageID = uint32_t;
+        using StageFunc = std::function<void()>;
+
+        /** Timings of a single stage in the last call to execute().
+        */
+        struct StageStats
+        {
+            std::string name;
+            uint32_t wave = 0;              ///< Wave the stage was executed in.
+            double prepareTime = 0.0;       ///< Time spent in the prepare function in ms.
+            double commitTime = 0.0;        ///< Time spent in the commit function in ms.
+        };
+
+        /** Timings of the last call to execute().
+        */
+        struct Stats
+        {
+            std::vector<StageStats> stages;
+            double totalTime = 0.0;         ///< Wall clock time of execute() in ms.
+            double serialTime = 0.0;        ///< Sum of all prepare and commit times in ms. This is the time of a serial update.
+        };
+
+        /** Add a stage.
+            \param[in] name Name of the stage, used for reporting.
+            \param[in] prepare CPU-only work that may run on a worker thread, or nullptr.
+            \param[in] commit Work that runs on the calling thread after the prepare functions of the wave, or nullptr.
+            \param[in] dependencies Stages that must be committed before this stage is prepared. Must be previously added stages.
+            \return ID of the new stage.
+        */
+        StageID addStage(const std::string& name, StageFunc prepare, StageFunc commit, const std::vector<StageID>& dependencies = {});
+
+        /** Run all stages.
+        */
+        void execute();
+
+        /** Enable/disable running the prepare functions in parallel. Disabling this is useful for debugging and benchmarking.
+        */
+        void setParallel(bool parallel) { mParallel = parallel; }
+
+        /** Check if the prepare functions run in parallel.
+        */
+        bool isParallel() const { return mParallel; }
+
+        /** Get the number of stages.
+        */
+        uint32_t getStageCount() const { return (uint32_t)mStages.size(); }
+
+        /** Get the number of waves the stages are grouped into.
+        */
+        uint32_t getWaveCount() const { return (uint32_t)mWaves.size(); }
+
+        /** Get the timings of the last call to execute().
+        */
+        const Stats& getStats() const { return mStats; }
+
+    private:
+        struct Stage
+        {
+            std::string name;
+            StageFunc prepare;
+            StageFunc commit;
+            uint32_t wave = 0;
+            std::exception_ptr exception;
+        };
+
+        std::vector<Stage> mStages;
+        std::vector<std::vector<StageID>> mWaves;   ///< Stage IDs per wave, in the order the stages were added.
+        bool mParallel = true;
+        Stats mStats;
+    };
+}
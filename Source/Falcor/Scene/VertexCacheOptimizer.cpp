@@ -0,0 +1,308 @@
+/***************************************************************************
+ # Copyright (c) 2015-21, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "stdafx.h"
+#include "VertexCacheOptimizer.h"
+
+namespace Falcor
+{
+    namespace
+    {
+        // Vertex cache optimization parameters.
+        // The optimizer scores vertices against a simulated LRU cache, while the statistics are
+        // computed with a FIFO cache, which is a closer model of the post-transform cache on current GPUs.
+        const uint32_t kVertexCacheSize = 32;
+        const uint32_t kVertexCacheStatsSize = 16;
+
+        // Meshes with at least this many triangles are first sorted spatially along a Morton curve.
+        // This improves locality for ray tracing and for the emissive triangle list on large scanned meshes.
+        const size_t kSpatialSortMinTriangleCount = 1ull << 18;
+
+        /** Spreads the lower 10 bits of a value so that there are two zero bits between each bit.
+        */
+        uint32_t expandBits10(uint32_t v)
+        {
+            v &= 0x3ff;
+            v = (v | (v << 16)) & 0x030000ff;
+            v = (v | (v << 8)) & 0x0300f00f;
+            v = (v | (v << 4)) & 0x030c30c3;
+            v = (v | (v << 2)) & 0x09249249;
+            return v;
+        }
+
+        /** Computes a 30-bit Morton code for a position normalized to the unit cube.
+        */
+        uint32_t mortonCode3D(float3 p)
+        {
+            uint3 q = uint3(glm::clamp(p * 1024.f, float3(0.f), float3(1023.f)));
+            return (expandBits10(q.x) << 2) | (expandBits10(q.y) << 1) | expandBits10(q.z);
+        }
+
+        /** Reorders triangles along a Morton curve through their centroids.
+        */
+        void sortTrianglesSpatially(std::vector<uint32_t>& indices, const std::vector<StaticVertexData>& vertices, const AABB& bounds)
+        {
+            const size_t triangleCount = indices.size() / 3;
+            const float3 extent = bounds.extent();
+            const float3 invExtent = float3(
+                extent.x > 0.f ? 1.f / extent.x : 0.f,
+                extent.y > 0.f ? 1.f / extent.y : 0.f,
+                extent.z > 0.f ? 1.f / extent.z : 0.f);
+
+            std::vector<std::pair<uint32_t, uint32_t>> keys(triangleCount);
+            for (size_t i = 0; i < triangleCount; i++)
+            {
+                float3 centroid = (vertices[indices[3 * i]].position + vertices[indices[3 * i + 1]].position + vertices[indices[3 * i + 2]].position) / 3.f;
+                keys[i] = { mortonCode3D((centroid - bounds.minPoint) * invExtent), (uint32_t)i };
+            }
+            std::sort(keys.begin(), keys.end());
+
+            std::vector<uint32_t> sortedIndices(indices.size());
+            for (size_t i = 0; i < triangleCount; i++)
+            {
+                uint32_t triangle = keys[i].second;
+                for (size_t j = 0; j < 3; j++) sortedIndices[3 * i + j] = indices[3 * triangle + j];
+            }
+            indices = std::move(sortedIndices);
+        }
+
+        /** Reorders triangles for post-transform vertex cache efficiency.
+            This implements Tom Forsyth's "Linear-Speed Vertex Cache Optimisation".
+            When no triangle in the cache is usable, the next unprocessed triangle in input order is chosen,
+            which preserves the locality of a previous spatial sort.
+            See https://tomforsyth1000.github.io/papers/fast_vert_cache_opt.html
+        */
+        void optimizeVertexCacheOrder(std::vector<uint32_t>& indices, uint32_t vertexCount)
+        {
+            const uint32_t triangleCount = (uint32_t)(indices.size() / 3);
+            if (triangleCount == 0) return;
+
+            const uint32_t kInvalid = std::numeric_limits<uint32_t>::max();
+
+            // Build vertex to triangle adjacency. The first 'liveCount[v]' entries are the triangles not yet emitted.
+            std::vector<uint32_t> liveCount(vertexCount, 0);
+            for (uint32_t index : indices) liveCount[index]++;
+
+            std::vector<uint32_t> adjacencyOffset(vertexCount + 1, 0);
+            for (uint32_t v = 0; v < vertexCount; v++) adjacencyOffset[v + 1] = adjacencyOffset[v] + liveCount[v];
+
+            std::vector<uint32_t> adjacency(indices.size());
+            {
+                std::vector<uint32_t> fill(adjacencyOffset.begin(), adjacencyOffset.end() - 1);
+                for (uint32_t t = 0; t < triangleCount; t++)
+                {
+                    for (uint32_t j = 0; j < 3; j++) adjacency[fill[indices[3 * t + j]]++] = t;
+                }
+            }
+
+            auto scoreVertex = [&](uint32_t cachePosition, uint32_t valence)
+            {
+                if (valence == 0) return -1.f;
+                float score = 0.f;
+                if (cachePosition != kInvalid)
+                {
+                    // The three most recent vertices were used by the last triangle and get a fixed score to avoid strips.
+                    if (cachePosition < 3) score = 0.75f;
+                    else score = std::pow(1.f - (float)(cachePosition - 3) / (kVertexCacheSize - 3), 1.5f);
+                }
+                // Boost vertices with few remaining triangles so that isolated triangles are cleaned up early.
+                score += 2.f * std::pow((float)valence, -0.5f);
+                return score;
+            };
+
+            std::vector<uint32_t> cachePosition(vertexCount, kInvalid);
+            std::vector<float> vertexScore(vertexCount);
+            for (uint32_t v = 0; v < vertexCount; v++) vertexScore[v] = scoreVertex(kInvalid, liveCount[v]);
+
+            std::vector<bool> emitted(triangleCount, false);
+
+            std::vector<uint32_t> cache, newCache;
+            cache.reserve(kVertexCacheSize + 3);
+            newCache.reserve(kVertexCacheSize + 3);
+
+            std::vector<uint32_t> output;
+            output.reserve(indices.size());
+
+            uint32_t bestTriangle = kInvalid;
+            uint32_t nextInputTriangle = 0;
+
+            for (uint32_t emittedCount = 0; emittedCount < triangleCount; emittedCount++)
+            {
+                if (bestTriangle == kInvalid)
+                {
+                    while (emitted[nextInputTriangle]) nextInputTriangle++;
+                    bestTriangle = nextInputTriangle;
+                }
+
+                const uint32_t t = bestTriangle;
+                emitted[t] = true;
+
+                // Emit the triangle and remove it from the live adjacency lists of its vertices.
+                newCache.clear();
+                for (uint32_t j = 0; j < 3; j++)
+                {
+                    const uint32_t v = indices[3 * t + j];
+                    output.push_back(v);
+                    newCache.push_back(v);
+
+                    uint32_t* pAdj = adjacency.data() + adjacencyOffset[v];
+                    uint32_t& count = liveCount[v];
+                    for (uint32_t k = 0; k < count; k++)
+                    {
+                        if (pAdj[k] == t)
+                        {
+                            std::swap(pAdj[k], pAdj[count - 1]);
+                            count--;
+                            break;
+                        }
+                    }
+                }
+
+                // Move the triangle's vertices to the front of the LRU cache.
+                for (uint32_t v : cache)
+                {
+                    if (v != newCache[0] && v != newCache[1] && v != newCache[2]) newCache.push_back(v);
+                }
+
+                // Update cache positions and scores. Vertices pushed out of the cache are also rescored.
+                for (uint32_t i = 0; i < (uint32_t)newCache.size(); i++)
+                {
+                    const uint32_t v = newCache[i];
+                    cachePosition[v] = i < kVertexCacheSize ? i : kInvalid;
+                    vertexScore[v] = scoreVertex(cachePosition[v], liveCount[v]);
+                }
+
+                // Rescore the live triangles touching the cache and pick the best one.
+                bestTriangle = kInvalid;
+                float bestScore = -1.f;
+                for (uint32_t v : newCache)
+                {
+                    const uint32_t* pAdj = adjacency.data() + adjacencyOffset[v];
+                    for (uint32_t k = 0; k < liveCount[v]; k++)
+                    {
+                        const uint32_t u = pAdj[k];
+                        float score = vertexScore[indices[3 * u]] + vertexScore[indices[3 * u + 1]] + vertexScore[indices[3 * u + 2]];
+                        if (score > bestScore)
+                        {
+                            bestScore = score;
+                            bestTriangle = u;
+                        }
+                    }
+                }
+
+                if (newCache.size() > kVertexCacheSize) newCache.resize(kVertexCacheSize);
+                std::swap(cache, newCache);
+            }
+
+            assert(output.size() == indices.size());
+            indices = std::move(output);
+        }
+
+        /** Reorders vertices by first use in the index buffer to improve vertex fetch locality.
+            Unreferenced vertices are kept, but moved to the end.
+            \param[in,out] indices Triangle list indices, which are remapped to the new vertex order.
+            \param[in] vertices Vertex data.
+            \param[out] reordered Reordered vertex data.
+        */
+        void optimizeVertexFetchOrder(std::vector<uint32_t>& indices, const std::vector<StaticVertexData>& vertices, std::vector<StaticVertexData>& reordered)
+        {
+            const uint32_t kInvalid = std::numeric_limits<uint32_t>::max();
+            const uint32_t vertexCount = (uint32_t)vertices.size();
+
+            std::vector<uint32_t> remap(vertexCount, kInvalid);
+            uint32_t nextIndex = 0;
+            for (uint32_t& index : indices)
+            {
+                if (remap[index] == kInvalid) remap[index] = nextIndex++;
+                index = remap[index];
+            }
+            for (uint32_t& r : remap)
+            {
+                if (r == kInvalid) r = nextIndex++;
+            }
+            assert(nextIndex == vertexCount);
+
+            reordered.resize(vertexCount);
+            for (uint32_t v = 0; v < vertexCount; v++) reordered[remap[v]] = vertices[v];
+        }
+    }
+
+    VertexCacheOptimizer::Stats VertexCacheOptimizer::analyze(const std::vector<uint32_t>& indices, uint32_t vertexCount)
+    {
+        Stats stats;
+        stats.triangleCount = indices.size() / 3;
+        stats.vertexCount = vertexCount;
+
+        // Each vertex stores the time it was inserted. It's in the cache if it was inserted within the last 'cacheSize' misses.
+        std::vector<uint32_t> timestamps(vertexCount, 0);
+        uint32_t time = kVertexCacheStatsSize + 1;
+        for (uint32_t index : indices)
+        {
+            assert(index < vertexCount);
+            if (time - timestamps[index] > kVertexCacheStatsSize)
+            {
+                timestamps[index] = time++;
+                stats.transformCount++;
+            }
+        }
+        return stats;
+    }
+
+    void VertexCacheOptimizer::optimizeTriangleOrder(std::vector<uint32_t>& indices, uint32_t vertexCount)
+    {
+        optimizeVertexCacheOrder(indices, vertexCount);
+    }
+
+    bool VertexCacheOptimizer::optimize(std::vector<uint32_t>& indices, std::vector<StaticVertexData>& vertices, const AABB& bounds, Stats& statsBefore, Stats& statsAfter)
+    {
+        const uint32_t vertexCount = (uint32_t)vertices.size();
+        const size_t triangleCount = indices.size() / 3;
+
+        statsBefore = analyze(indices, vertexCount);
+
+        // Reorder a copy of the indices, so that the mesh is left unchanged if the result is rejected.
+        std::vector<uint32_t> newIndices = indices;
+        if (triangleCount >= kSpatialSortMinTriangleCount) sortTrianglesSpatially(newIndices, vertices, bounds);
+        optimizeVertexCacheOrder(newIndices, vertexCount);
+
+        statsAfter = analyze(newIndices, vertexCount);
+
+        // Keep the original ordering if it was better. Spatially sorted meshes are kept for their ray tracing locality.
+        if (statsAfter.transformCount > statsBefore.transformCount && triangleCount < kSpatialSortMinTriangleCount)
+        {
+            statsAfter = statsBefore;
+            return false;
+        }
+
+        // The vertex order does not affect the cache statistics. Indices and vertices are only written back together.
+        std::vector<StaticVertexData> newVertices;
+        optimizeVertexFetchOrder(newIndices, vertices, newVertices);
+        indices = std::move(newIndices);
+        vertices = std::move(newVertices);
+        return true;
+    }
+}
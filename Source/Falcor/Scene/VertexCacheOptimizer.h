@@ -0,0 +1,89 @@
+/***************************************************************************
+ # Copyright (c) 2015-21, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#pragma once
+#include "SceneTypes.slang"
+
+namespace Falcor
+{
+    /** Reordering of triangle meshes for memory locality.
+
+        Triangles are reordered for post-transform vertex cache efficiency using Tom Forsyth's
+        "Linear-Speed Vertex Cache Optimisation", and vertices are reordered by first use for
+        vertex fetch efficiency. Very large meshes are first sorted spatially along a Morton curve.
+    */
+    class dlldecl VertexCacheOptimizer
+    {
+    public:
+        /** Statistics of a simulated FIFO post-transform vertex cache.
+        */
+        struct Stats
+        {
+            uint64_t triangleCount = 0;
+            uint64_t vertexCount = 0;
+            uint64_t transformCount = 0;    ///< Number of simulated vertex shader invocations.
+
+            float getACMR() const { return triangleCount > 0 ? (float)transformCount / triangleCount : 0.f; }
+            float getATVR() const { return vertexCount > 0 ? (float)transformCount / vertexCount : 0.f; }
+
+            Stats& operator+=(const Stats& other)
+            {
+                triangleCount += other.triangleCount;
+                vertexCount += other.vertexCount;
+                transformCount += other.transformCount;
+                return *this;
+            }
+        };
+
+        /** Simulates a FIFO post-transform vertex cache.
+            \param[in] indices Triangle list indices.
+            \param[in] vertexCount Number of vertices referenced by the indices.
+            \return Cache statistics, from which the ACMR (average cache miss ratio) and ATVR (average transform to vertex ratio) are computed.
+        */
+        static Stats analyze(const std::vector<uint32_t>& indices, uint32_t vertexCount);
+
+        /** Reorder triangles for post-transform vertex cache efficiency. The vertices are not changed.
+            \param[in,out] indices Triangle list indices.
+            \param[in] vertexCount Number of vertices referenced by the indices.
+        */
+        static void optimizeTriangleOrder(std::vector<uint32_t>& indices, uint32_t vertexCount);
+
+        /** Reorder the triangles and vertices of a mesh.
+            The result is rejected if it has a worse vertex cache efficiency than the input, unless the mesh was sorted spatially.
+            \param[in,out] indices Triangle list indices.
+            \param[in,out] vertices Vertex data. The indices are remapped to the new vertex order.
+            \param[in] bounds Bounds of the mesh, used for the spatial sort.
+            \param[out] statsBefore Cache statistics of the input.
+            \param[out] statsAfter Cache statistics of the output.
+            \return True if the mesh was reordered, false if the indices and vertices were left unchanged.
+        */
+        static bool optimize(std::vector<uint32_t>& indices, std::vector<StaticVertexData>& vertices, const AABB& bounds, Stats& statsBefore, Stats& statsAfter);
+
+    private:
+        VertexCacheOptimizer() = delete;
+    };
+}
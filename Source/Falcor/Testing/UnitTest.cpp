@@ -89,6 +89,7 @@ namespace Falcor
     inline TestResult runTest(const Test& test, RenderContext* pRenderContext)
     {
         if (!test.skipMessage.empty()) return { TestResult::Status::Skipped, { test.skipMessage } };
+        if (test.gpuFunc && !pRenderContext) return { TestResult::Status::Skipped, { "No GPU device available (headless mode)." } };
 
         TestResult result { TestResult::Status::Passed };
 
@@ -135,7 +136,7 @@ namespace Falcor
         result.elapsedMS = std::chrono::duration_cast<std::chrono::milliseconds>(endTime - startTime).count();
 
         // Release GPU resources.
-        if (test.gpuFunc) gpDevice->flushAndSync();
+        if (test.gpuFunc && gpDevice) gpDevice->flushAndSync();
 
         return result;
     }
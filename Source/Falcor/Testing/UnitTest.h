@@ -76,6 +76,14 @@ namespace Falcor
 
     dlldecl void registerCPUTest(const std::string& filename, const std::string& name, const std::string& skipMessage, CPUTestFunc func);
     dlldecl void registerGPUTest(const std::string& filename, const std::string& name, const std::string& skipMessage, GPUTestFunc func);
+
+    /** Run all registered tests matching a filter.
+        \param[in] stream Output stream for the test results.
+        \param[in] pRenderContext Render context for GPU tests. If nullptr, GPU tests are skipped and only CPU tests are run.
+        \param[in] testFilterRegexp Regular expression matched against the test titles.
+        \param[in] repeatCount Number of times to run each test.
+        \return Number of failed tests.
+    */
     dlldecl int32_t runTests(std::ostream& stream, RenderContext* pRenderContext, const std::string& testFilterRegexp, uint32_t repeatCount = 1);
 
     class dlldecl UnitTestContext
@@ -0,0 +1,398 @@
+/***************************************************************************
+ # Copyright (c) 2015-21, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#pragma once
+#include "Utils/NumericRange.h"
+#include <algorithm>
+#include <cassert>
+#include <execution>
+#include <functional>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace Falcor
+{
+    /** Parallel primitives for host code.
+
+        These are the CPU counterparts of the GPU algorithms in this directory (PrefixSum, BitonicSort, ParallelReduction)
+        and are meant for host code that processes large arrays, such as BVH builds and mesh processing.
+
+        All functions operate on raw arrays. The input is split into contiguous blocks that are processed with std::execution::par.
+        The block size only depends on the element count, so the results are deterministic and independent of the number of threads,
+        also for non-associative operations such as floating-point addition.
+    */
+    namespace HostParallel
+    {
+        namespace detail
+        {
+            const size_t kMinBlockSize = 16384;     ///< Smallest number of elements per block.
+            const size_t kMaxBlockCount = 256;      ///< Largest number of blocks. Larger inputs use larger blocks.
+
+            /** Partitioning of an array into blocks.
+            */
+            struct Blocks
+            {
+                size_t elementCount;
+                size_t blockSize;
+                size_t blockCount;
+
+                explicit Blocks(size_t count)
+                    : elementCount(count)
+                    , blockSize(std::max(kMinBlockSize, (count + kMaxBlockCount - 1) / kMaxBlockCount))
+                    , blockCount((count + blockSize - 1) / blockSize)
+                {}
+
+                size_t begin(size_t blockIdx) const { return blockIdx * blockSize; }
+                size_t end(size_t blockIdx) const { return std::min(elementCount, (blockIdx + 1) * blockSize); }
+
+                /** Call func(blockIdx) for all blocks in parallel.
+                */
+                template<typename Func>
+                void forEach(Func func) const
+                {
+                    if (blockCount == 1) return func(size_t(0));
+                    NumericRange<size_t> range(0, blockCount);
+                    std::for_each(std::execution::par, range.begin(), range.end(), func);
+                }
+            };
+
+            /** Stable radix sort with 8-bit digits. The values are optional.
+            */
+            template<typename K, typename V, bool kSortValues>
+            void radixSort(K* pKeys, V* pValues, size_t count)
+            {
+                static_assert(std::is_integral<K>::value && std::is_unsigned<K>::value, "Radix sort requires unsigned integer keys");
+                const uint32_t kRadixBits = 8;
+                const size_t kRadix = size_t(1) << kRadixBits;
+
+                if (count <= 1) return;
+                const Blocks blocks(count);
+
+                std::vector<K> tmpKeys(count);
+                std::vector<V> tmpValues(kSortValues ? count : 0);
+                K* pSrcKeys = pKeys;
+                K* pDstKeys = tmpKeys.data();
+                V* pSrcValues = pValues;
+                V* pDstValues = tmpValues.data();
+
+                // Per-block digit histograms. After the scan, they hold the output offset for each digit and block.
+                std::vector<size_t> offsets(blocks.blockCount * kRadix);
+
+                for (uint32_t shift = 0; shift < sizeof(K) * 8; shift += kRadixBits)
+                {
+                    blocks.forEach([&](size_t blockIdx)
+                    {
+                        size_t* pOffsets = &offsets[blockIdx * kRadix];
+                        std::fill(pOffsets, pOffsets + kRadix, size_t(0));
+                        for (size_t i = blocks.begin(blockIdx); i < blocks.end(blockIdx); i++) pOffsets[(pSrcKeys[i] >> shift) & (kRadix - 1)]++;
+                    });
+
+                    // Scan in digit-major order so that the sort is stable. Skip the pass if all keys have the same digit.
+                    bool skipPass = false;
+                    size_t offset = 0;
+                    for (size_t digit = 0; digit < kRadix; digit++)
+                    {
+                        const size_t digitOffset = offset;
+                        for (size_t blockIdx = 0; blockIdx < blocks.blockCount; blockIdx++)
+                        {
+                            offset += std::exchange(offsets[blockIdx * kRadix + digit], offset);
+                        }
+                        skipPass |= offset - digitOffset == count;
+                    }
+                    if (skipPass) continue;
+
+                    blocks.forEach([&](size_t blockIdx)
+                    {
+                        size_t* pOffsets = &offsets[blockIdx * kRadix];
+                        for (size_t i = blocks.begin(blockIdx); i < blocks.end(blockIdx); i++)
+                        {
+                            const size_t dst = pOffsets[(pSrcKeys[i] >> shift) & (kRadix - 1)]++;
+                            pDstKeys[dst] = pSrcKeys[i];
+                            if constexpr (kSortValues) pDstValues[dst] = std::move(pSrcValues[i]);
+                        }
+                    });
+
+                    std::swap(pSrcKeys, pDstKeys);
+                    std::swap(pSrcValues, pDstValues);
+                }
+
+                // Copy the result back if it ended up in the temporary buffers.
+                if (pSrcKeys != pKeys)
+                {
+                    std::copy(std::execution::par, pSrcKeys, pSrcKeys + count, pKeys);
+                    if constexpr (kSortValues) std::move(std::execution::par, pSrcValues, pSrcValues + count, pValues);
+                }
+            }
+
+            /** Stream compaction. Calls pred(i) for all indices and write(dst, i) for the selected ones, keeping their order.
+                \return Number of selected elements.
+            */
+            template<typename Pred, typename Write>
+            size_t compact(size_t count, Pred pred, Write write)
+            {
+                const Blocks blocks(count);
+                std::vector<uint8_t> selected(count);
+                std::vector<size_t> offsets(blocks.blockCount + 1, 0);
+
+                blocks.forEach([&](size_t blockIdx)
+                {
+                    size_t selectedCount = 0;
+                    for (size_t i = blocks.begin(blockIdx); i < blocks.end(blockIdx); i++)
+                    {
+                        selected[i] = pred(i) ? 1 : 0;
+                        selectedCount += selected[i];
+                    }
+                    offsets[blockIdx + 1] = selectedCount;
+                });
+
+                for (size_t blockIdx = 0; blockIdx < blocks.blockCount; blockIdx++) offsets[blockIdx + 1] += offsets[blockIdx];
+
+                blocks.forEach([&](size_t blockIdx)
+                {
+                    size_t dst = offsets[blockIdx];
+                    for (size_t i = blocks.begin(blockIdx); i < blocks.end(blockIdx); i++)
+                    {
+                        if (selected[i]) write(dst++, i);
+                    }
+                });
+
+                return offsets[blocks.blockCount];
+            }
+        }
+
+        /** Reduce an array with an associative operator.
+            \param[in] pData Input data.
+            \param[in] count Number of elements.
+            \param[in] init Initial value, which is combined with the result.
+            \param[in] op Associative binary operator.
+            \return init op pData[0] op ... op pData[count - 1].
+        */
+        template<typename T, typename BinaryOp = std::plus<T>>
+        T reduce(const T* pData, size_t count, T init = T(), BinaryOp op = BinaryOp())
+        {
+            const detail::Blocks blocks(count);
+            std::vector<T> blockResults(blocks.blockCount);
+            blocks.forEach([&](size_t blockIdx)
+            {
+                const size_t first = blocks.begin(blockIdx);
+                T result = pData[first];
+                for (size_t i = first + 1; i < blocks.end(blockIdx); i++) result = op(result, pData[i]);
+                blockResults[blockIdx] = result;
+            });
+
+            T result = init;
+            for (const T& blockResult : blockResults) result = op(result, blockResult);
+            return result;
+        }
+
+        /** Compute the minimum and maximum of an array. This is the host version of ParallelReduction::Type::MinMax.
+            \param[in] pData Input data.
+            \param[in] count Number of elements. Must be larger than zero.
+            \return Pair of the minimum and maximum element.
+        */
+        template<typename T>
+        std::pair<T, T> minMax(const T* pData, size_t count)
+        {
+            assert(count > 0);
+            const detail::Blocks blocks(count);
+            std::vector<std::pair<T, T>> blockResults(blocks.blockCount);
+            blocks.forEach([&](size_t blockIdx)
+            {
+                auto [pMin, pMax] = std::minmax_element(pData + blocks.begin(blockIdx), pData + blocks.end(blockIdx));
+                blockResults[blockIdx] = { *pMin, *pMax };
+            });
+
+            std::pair<T, T> result = blockResults[0];
+            for (const auto& [minValue, maxValue] : blockResults)
+            {
+                result.first = std::min(result.first, minValue);
+                result.second = std::max(result.second, maxValue);
+            }
+            return result;
+        }
+
+        /** Compute the exclusive prefix scan of an array in place. This is the host version of PrefixSum.
+            Each element is replaced by y[i] = init op x[0] op ... op x[i-1], and y[0] = init.
+            \param[in,out] pData The data to scan in place.
+            \param[in] count Number of elements.
+            \param[in] init Initial value.
+            \param[in] op Associative binary operator.
+            \return The total, i.e. init op x[0] op ... op x[count - 1].
+        */
+        template<typename T, typename BinaryOp = std::plus<T>>
+        T exclusiveScan(T* pData, size_t count, T init = T(), BinaryOp op = BinaryOp())
+        {
+            const detail::Blocks blocks(count);
+            std::vector<T> blockOffsets(blocks.blockCount);
+
+            // Reduce each block. The last block does not contribute to any offset.
+            blocks.forEach([&](size_t blockIdx)
+            {
+                if (blockIdx + 1 == blocks.blockCount) return;
+                const size_t first = blocks.begin(blockIdx);
+                T result = pData[first];
+                for (size_t i = first + 1; i < blocks.end(blockIdx); i++) result = op(result, pData[i]);
+                blockOffsets[blockIdx] = result;
+            });
+
+            // Scan the block results.
+            T offset = init;
+            for (T& blockOffset : blockOffsets) offset = op(offset, std::exchange(blockOffset, offset));
+
+            // Scan each block starting at its offset. The total is given by the last block.
+            T total = init;
+            blocks.forEach([&](size_t blockIdx)
+            {
+                T sum = blockOffsets[blockIdx];
+                for (size_t i = blocks.begin(blockIdx); i < blocks.end(blockIdx); i++) sum = op(sum, std::exchange(pData[i], sum));
+                if (blockIdx + 1 == blocks.blockCount) total = sum;
+            });
+            return total;
+        }
+
+        /** Compute the inclusive prefix scan of an array in place.
+            Each element is replaced by y[i] = x[0] op ... op x[i].
+            \param[in,out] pData The data to scan in place.
+            \param[in] count Number of elements.
+            \param[in] op Associative binary operator.
+        */
+        template<typename T, typename BinaryOp = std::plus<T>>
+        void inclusiveScan(T* pData, size_t count, BinaryOp op = BinaryOp())
+        {
+            const detail::Blocks blocks(count);
+            std::vector<T> blockTotals(blocks.blockCount);
+
+            // Scan each block independently.
+            blocks.forEach([&](size_t blockIdx)
+            {
+                for (size_t i = blocks.begin(blockIdx) + 1; i < blocks.end(blockIdx); i++) pData[i] = op(pData[i - 1], pData[i]);
+                blockTotals[blockIdx] = pData[blocks.end(blockIdx) - 1];
+            });
+
+            // Add the total of all previous blocks to each block.
+            for (size_t blockIdx = 1; blockIdx < blocks.blockCount; blockIdx++) blockTotals[blockIdx] = op(blockTotals[blockIdx - 1], blockTotals[blockIdx]);
+            blocks.forEach([&](size_t blockIdx)
+            {
+                if (blockIdx == 0) return;
+                const T& offset = blockTotals[blockIdx - 1];
+                for (size_t i = blocks.begin(blockIdx); i < blocks.end(blockIdx); i++) pData[i] = op(offset, pData[i]);
+            });
+        }
+
+        /** Sort an array of unsigned integer keys in ascending order using a parallel LSD radix sort.
+            \param[in,out] pKeys The keys to sort in place.
+            \param[in] count Number of elements.
+        */
+        template<typename K>
+        void radixSort(K* pKeys, size_t count)
+        {
+            detail::radixSort<K, K, false>(pKeys, nullptr, count);
+        }
+
+        /** Sort an array of key-value pairs by the unsigned integer keys in ascending order using a parallel LSD radix sort.
+            The sort is stable, i.e. values with equal keys keep their relative order.
+            \param[in,out] pKeys The keys to sort in place.
+            \param[in,out] pValues The values to reorder along with the keys.
+            \param[in] count Number of elements.
+        */
+        template<typename K, typename V>
+        void radixSort(K* pKeys, V* pValues, size_t count)
+        {
+            detail::radixSort<K, V, true>(pKeys, pValues, count);
+        }
+
+        /** Sort an array in chunks of N elements. Each chunk is sorted in ascending order. This is the host version of BitonicSort.
+            \param[in,out] pData The data to sort in place.
+            \param[in] totalSize The total number of elements. This does _not_ have to be a multiple of chunkSize.
+            \param[in] chunkSize The number of elements per chunk.
+        */
+        template<typename T>
+        void sortChunks(T* pData, size_t totalSize, size_t chunkSize)
+        {
+            if (chunkSize <= 1) return;
+            const size_t chunkCount = (totalSize + chunkSize - 1) / chunkSize;
+            NumericRange<size_t> range(0, chunkCount);
+            std::for_each(std::execution::par, range.begin(), range.end(), [&](size_t chunkIdx)
+            {
+                std::sort(pData + chunkIdx * chunkSize, pData + std::min(totalSize, (chunkIdx + 1) * chunkSize));
+            });
+        }
+
+        /** Reorder an array so that the elements for which the predicate is true precede the others.
+            The partition is stable, i.e. the relative order is kept within both parts.
+            \param[in,out] pData The data to partition in place.
+            \param[in] count Number of elements.
+            \param[in] pred Predicate called once per element.
+            \return Number of elements for which the predicate is true.
+        */
+        template<typename T, typename Pred>
+        size_t partition(T* pData, size_t count, Pred pred)
+        {
+            std::vector<uint8_t> selected(count);
+            std::vector<T> tmp(count);
+            const size_t selectedCount = detail::compact(count,
+                [&](size_t i) { return (selected[i] = pred(pData[i]) ? 1 : 0) != 0; },
+                [&](size_t dst, size_t i) { tmp[dst] = std::move(pData[i]); });
+            detail::compact(count,
+                [&](size_t i) { return selected[i] == 0; },
+                [&](size_t dst, size_t i) { tmp[selectedCount + dst] = std::move(pData[i]); });
+            std::move(std::execution::par, tmp.begin(), tmp.end(), pData);
+            return selectedCount;
+        }
+
+        /** Copy the elements for which the predicate is true to the output, keeping their order (stream compaction).
+            \param[in] pInput Input data.
+            \param[in] count Number of input elements.
+            \param[out] pOutput Output data. Must have space for up to count elements.
+            \param[in] pred Predicate called once per element.
+            \return Number of elements written to the output.
+        */
+        template<typename T, typename Pred>
+        size_t compact(const T* pInput, size_t count, T* pOutput, Pred pred)
+        {
+            return detail::compact(count,
+                [&](size_t i) { return pred(pInput[i]); },
+                [&](size_t dst, size_t i) { pOutput[dst] = pInput[i]; });
+        }
+
+        /** Write the indices for which the predicate is true to the output in ascending order.
+            \param[in] count Number of indices to test.
+            \param[out] pOutput Output indices. Must have space for up to count elements.
+            \param[in] pred Predicate called once per index.
+            \return Number of indices written to the output.
+        */
+        template<typename I, typename Pred>
+        size_t compactIndices(I count, I* pOutput, Pred pred)
+        {
+            static_assert(std::is_integral<I>::value, "Indices must be integers");
+            return detail::compact((size_t)count,
+                [&](size_t i) { return pred((I)i); },
+                [&](size_t dst, size_t i) { pOutput[dst] = (I)i; });
+        }
+    }
+}
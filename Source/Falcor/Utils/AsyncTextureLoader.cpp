@@ -27,6 +27,7 @@
  **************************************************************************/
 #include "stdafx.h"
 #include "AsyncTextureLoader.h"
+#include "Utils/Timing/TraceProfiler.h"
 
 namespace Falcor
 {
@@ -49,8 +50,16 @@ namespace Falcor
 
     std::future<Texture::SharedPtr> AsyncTextureLoader::loadFromFile(const std::string& filename, bool generateMipLevels, bool loadAsSrgb, Resource::BindFlags bindFlags)
     {
+        // Connect the request to the worker that loads it in the trace.
+        uint64_t flowID = 0;
+        if (TraceProfiler::isCapturing())
+        {
+            flowID = TraceProfiler::newFlowID();
+            TraceProfiler::flowBegin(flowID, "AsyncTextureLoader");
+        }
+
         std::lock_guard<std::mutex> lock(mMutex);
-        mRequestQueue.push(Request{filename, generateMipLevels, loadAsSrgb, bindFlags});
+        mRequestQueue.push(Request{filename, generateMipLevels, loadAsSrgb, bindFlags, flowID});
         mCondition.notify_one();
         return mRequestQueue.back().promise.get_future();
     }
@@ -68,6 +77,8 @@ namespace Falcor
         for (size_t i = 0; i < threadCount; ++i)
         {
             mThreads.emplace_back([&, barrier] () {
+                TraceProfiler::setThreadName("AsyncTextureLoader");
+
                 while (true)
                 {
                     // Wait on condition until more work is ready.
@@ -96,8 +107,12 @@ namespace Falcor
                     lock.unlock();
 
                     // Load the textures (this part is running in parallel).
-                    Texture::SharedPtr pTexture = Texture::createFromFile(request.filename, request.generateMipLevels, request.loadAsSrgb, request.bindFlags);
-                    request.promise.set_value(pTexture);
+                    {
+                        TRACE_ZONE("AsyncTextureLoader::load");
+                        if (request.flowID != 0) TraceProfiler::flowEnd(request.flowID, "AsyncTextureLoader");
+                        Texture::SharedPtr pTexture = Texture::createFromFile(request.filename, request.generateMipLevels, request.loadAsSrgb, request.bindFlags);
+                        request.promise.set_value(pTexture);
+                    }
 
                     lock.lock();
 
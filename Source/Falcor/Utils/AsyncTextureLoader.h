@@ -65,6 +65,7 @@ namespace Falcor
             bool generateMipLevels;
             bool loadAsSrgb;
             Resource::BindFlags bindFlags;
+            uint64_t flowID;    ///< Trace flow ID connecting the request to its load, or zero if not tracing.
             std::promise<Texture::SharedPtr> promise;
         };
 
@@ -0,0 +1,136 @@
+/***************************************************************************
+ # Copyright (c) 2015-21, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "stdafx.h"
+#include "AsyncFrameCapture.h"
+#include "Utils/Timing/TraceProfiler.h"
+#include "Utils/Video/VideoEncoder.h"
+
+namespace Falcor
+{
+    AsyncFrameCapture::UniquePtr AsyncFrameCapture::create(uint32_t readbackDepth, uint32_t workerCount, size_t maxPendingWrites)
+    {
+        if (readbackDepth == 0) throw std::exception("AsyncFrameCapture::create() - Readback depth must be at least one.");
+        return UniquePtr(new AsyncFrameCapture(readbackDepth, workerCount, maxPendingWrites));
+    }
+
+    AsyncFrameCapture::AsyncFrameCapture(uint32_t readbackDepth, uint32_t workerCount, size_t maxPendingWrites)
+        : mReadbackDepth(readbackDepth)
+        , mpWriter(FrameWriter::create(workerCount, maxPendingWrites))
+    {
+    }
+
+    AsyncFrameCapture::~AsyncFrameCapture()
+    {
+        flush();
+    }
+
+    void AsyncFrameCapture::captureToFile(RenderContext* pContext, const Texture::SharedPtr& pTexture, uint32_t mipLevel, uint32_t arraySlice, const std::string& filename, Bitmap::FileFormat format, Bitmap::ExportFlags exportFlags)
+    {
+        assert(pTexture && pTexture->getType() == Texture::Type::Texture2D);
+        if (format == Bitmap::FileFormat::DdsFile)
+        {
+            throw std::exception("AsyncFrameCapture::captureToFile() does not support saving to DDS.");
+        }
+
+        uint32_t width = pTexture->getWidth(mipLevel);
+        uint32_t height = pTexture->getHeight(mipLevel);
+        ResourceFormat resourceFormat = pTexture->getFormat();
+
+        // Handle the special case where we have an HDR texture with less than 3 channels (same as Texture::captureToFile()).
+        // The temporary texture is kept alive by the deferred resource release until the copy has executed.
+        Texture::SharedPtr pSource = pTexture;
+        uint32_t subresource = pTexture->getSubresourceIndex(arraySlice, mipLevel);
+        if (getFormatType(resourceFormat) == FormatType::Float && getFormatChannelCount(resourceFormat) < 3)
+        {
+            pSource = Texture::create2D(width, height, ResourceFormat::RGBA32Float, 1, 1, nullptr, ResourceBindFlags::RenderTarget | ResourceBindFlags::ShaderResource);
+            pContext->blit(pTexture->getSRV(mipLevel, 1, arraySlice, 1), pSource->getRTV(0, 0, 1));
+            resourceFormat = ResourceFormat::RGBA32Float;
+            subresource = 0;
+        }
+
+        FrameWriter* pWriter = mpWriter.get();
+        enqueue(pContext, pSource.get(), subresource, [=] (std::vector<uint8_t>&& data)
+        {
+            pWriter->writeImage(filename, width, height, format, exportFlags, resourceFormat, std::move(data));
+        });
+    }
+
+    void AsyncFrameCapture::captureVideoFrame(RenderContext* pContext, const Texture::SharedPtr& pTexture, VideoEncoder* pEncoder)
+    {
+        assert(pTexture && pTexture->getType() == Texture::Type::Texture2D && pEncoder);
+
+        FrameWriter* pWriter = mpWriter.get();
+        enqueue(pContext, pTexture.get(), 0, [=] (std::vector<uint8_t>&& data)
+        {
+            pWriter->appendVideoFrame(pEncoder, std::move(data));
+        });
+    }
+
+    void AsyncFrameCapture::update()
+    {
+        while (!mReadbacks.empty() && mReadbacks.front().pTask->isReady()) retireOldest();
+    }
+
+    void AsyncFrameCapture::flush()
+    {
+        while (!mReadbacks.empty()) retireOldest();
+        mpWriter->flush();
+    }
+
+    void AsyncFrameCapture::enqueue(RenderContext* pContext, const Texture* pTexture, uint32_t subresource, WriteFunc write)
+    {
+        TRACE_ZONE("AsyncFrameCapture::enqueue");
+
+        // Retire what is already done, then make room in the ring. Waiting on the oldest readback
+        // only stalls if the GPU is more than readbackDepth captures behind.
+        update();
+        while (mReadbacks.size() >= mReadbackDepth) retireOldest();
+
+        if (mStagingRing.empty())
+        {
+            mStagingRing.resize(mReadbackDepth);
+            for (auto& pTask : mStagingRing) pTask = CopyContext::ReadTextureTask::createReusable(pContext);
+        }
+
+        // Readbacks are retired in the order the ring slots are used, so the next slot is free once there is room in the ring.
+        const auto& pTask = mStagingRing[mNextStagingSlot];
+        mNextStagingSlot = (mNextStagingSlot + 1) % mReadbackDepth;
+        pTask->record(pTexture, subresource);
+        mReadbacks.push_back({ pTask, std::move(write) });
+    }
+
+    void AsyncFrameCapture::retireOldest()
+    {
+        TRACE_ZONE("AsyncFrameCapture::retire");
+
+        // Readbacks are retired in order so that video frames are appended in capture order.
+        Readback readback = std::move(mReadbacks.front());
+        mReadbacks.pop_front();
+        readback.write(readback.pTask->getData());
+    }
+}
@@ -0,0 +1,118 @@
+/***************************************************************************
+ # Copyright (c) 2015-21, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#pragma once
+#include "FrameWriter.h"
+#include "Core/API/CopyContext.h"
+
+namespace Falcor
+{
+    class VideoEncoder;
+
+    /** Non-blocking capture of textures to image files and videos.
+
+        Each capture records a copy of the texture into a staging buffer from a ring of readbackDepth buffers.
+        The copies are submitted with the render context's regular flushes and tracked with its fence, so capturing
+        neither flushes nor waits for the GPU. Staging buffers are allocated once and only reallocated when the size
+        of the captured frames changes. Completed copies are read back in order when polled with update() and handed
+        to a FrameWriter, which converts and encodes them on worker threads. The render thread only blocks when the
+        readback ring is full and the oldest copy is still pending on the GPU, or when the writer's queue is full.
+    */
+    class dlldecl AsyncFrameCapture
+    {
+    public:
+        using UniquePtr = std::unique_ptr<AsyncFrameCapture>;
+
+        /** Create a frame capture pipeline.
+            \param[in] readbackDepth Maximum number of readbacks in flight.
+            \param[in] workerCount Number of writer threads.
+            \param[in] maxPendingWrites Maximum number of frames queued for writing before capturing blocks.
+            \return A new object, or throws an exception if the arguments are invalid.
+        */
+        static UniquePtr create(uint32_t readbackDepth = 3, uint32_t workerCount = 2, size_t maxPendingWrites = 8);
+
+        /** Destructor. Waits for all captures to be written.
+        */
+        ~AsyncFrameCapture();
+
+        /** Capture a 2D texture to an image file.
+            \param[in] pContext Render context.
+            \param[in] pTexture Texture to capture.
+            \param[in] mipLevel Mip level to capture.
+            \param[in] arraySlice Array slice to capture.
+            \param[in] filename Output filename.
+            \param[in] format Output file format. DDS is not supported.
+            \param[in] exportFlags Export flags.
+        */
+        void captureToFile(RenderContext* pContext, const Texture::SharedPtr& pTexture, uint32_t mipLevel, uint32_t arraySlice, const std::string& filename, Bitmap::FileFormat format = Bitmap::FileFormat::PngFile, Bitmap::ExportFlags exportFlags = Bitmap::ExportFlags::None);
+
+        /** Capture a 2D texture as the next frame of a video.
+            The texture must have the encoder's format. The encoder must outlive the capture; call flush() before ending the capture on the encoder.
+            \param[in] pContext Render context.
+            \param[in] pTexture Texture to capture.
+            \param[in] pEncoder Video encoder.
+        */
+        void captureVideoFrame(RenderContext* pContext, const Texture::SharedPtr& pTexture, VideoEncoder* pEncoder);
+
+        /** Hand completed readbacks over to the writer. Doesn't wait for the GPU.
+            This should be called once per frame so that captures are written without delay.
+        */
+        void update();
+
+        /** Wait until all captures have been read back and written.
+        */
+        void flush();
+
+        /** Get the number of readbacks in flight.
+        */
+        size_t getPendingReadbackCount() const { return mReadbacks.size(); }
+
+        /** Get the frame writer.
+        */
+        const FrameWriter::SharedPtr& getWriter() const { return mpWriter; }
+
+    private:
+        AsyncFrameCapture(uint32_t readbackDepth, uint32_t workerCount, size_t maxPendingWrites);
+
+        using WriteFunc = std::function<void(std::vector<uint8_t>&&)>;
+
+        struct Readback
+        {
+            CopyContext::ReadTextureTask::SharedPtr pTask;
+            WriteFunc write;
+        };
+
+        void enqueue(RenderContext* pContext, const Texture* pTexture, uint32_t subresource, WriteFunc write);
+        void retireOldest();
+
+        const uint32_t mReadbackDepth;
+        FrameWriter::SharedPtr mpWriter;
+        std::vector<CopyContext::ReadTextureTask::SharedPtr> mStagingRing;  ///< Reusable readback tasks, each owning a staging buffer.
+        uint32_t mNextStagingSlot = 0;      ///< Ring slot used by the next capture.
+        std::deque<Readback> mReadbacks;    ///< Readbacks in flight, oldest first.
+    };
+}
@@ -0,0 +1,636 @@
+/***************************************************************************
+ # Copyright (c) 2015-21, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "stdafx.h"
+#include "FLIP.h"
+#include "Utils/NumericRange.h"
+#include <array>
+#include <execution>
+#include <numeric>
+
+namespace Falcor
+{
+    namespace
+    {
+        // Constants from FLIPPass.cs.slang.
+        const float gqc = 0.7f;
+        const float gpc = 0.4f;
+        const float gpt = 0.95f;
+        const float gw = 0.082f;
+        const float gqf = 0.5f;
+
+        const float kPi = 3.141592653f;
+        const float kPiSquared = kPi * kPi;
+        const float kInvSqrt2 = 0.70710678f;
+
+        // a1, a2, b1, b2 of the CSF for the A, RG and BY channels.
+        const float kCSFParams[3][4] =
+        {
+            { 1.0f, 0.0f, 0.0047f, 1.0e-5f },
+            { 1.0f, 0.0f, 0.0053f, 1.0e-5f },
+            { 34.1f, 13.5f, 0.04f, 0.025f },
+        };
+
+        // Number of output rows per band. Each band additionally filters 2 * radius halo rows.
+        const uint32_t kBandHeight = 64;
+
+        float3 linearRGB2XYZ(const float3& c)
+        {
+            // Assumes D65 standard illuminant.
+            const float a11 = 10135552.0f / 24577794.0f;
+            const float a12 = 8788810.0f / 24577794.0f;
+            const float a13 = 4435075.0f / 24577794.0f;
+            const float a21 = 2613072.0f / 12288897.0f;
+            const float a22 = 8788810.0f / 12288897.0f;
+            const float a23 = 887015.0f / 12288897.0f;
+            const float a31 = 1425312.0f / 73733382.0f;
+            const float a32 = 8788810.0f / 73733382.0f;
+            const float a33 = 70074185.0f / 73733382.0f;
+            return float3(a11 * c.x + a12 * c.y + a13 * c.z, a21 * c.x + a22 * c.y + a23 * c.z, a31 * c.x + a32 * c.y + a33 * c.z);
+        }
+
+        float3 XYZ2LinearRGB(const float3& c)
+        {
+            const float a11 = 3.241003275f;
+            const float a12 = -1.537398934f;
+            const float a13 = -0.498615861f;
+            const float a21 = -0.969224334f;
+            const float a22 = 1.875930071f;
+            const float a23 = 0.041554224f;
+            const float a31 = 0.055639423f;
+            const float a32 = -0.204011202f;
+            const float a33 = 1.057148933f;
+            return float3(a11 * c.x + a12 * c.y + a13 * c.z, a21 * c.x + a22 * c.y + a23 * c.z, a31 * c.x + a32 * c.y + a33 * c.z);
+        }
+
+        // D65 reference illuminant.
+        const float3 kD65(0.950428545f, 1.000000000f, 1.088900371f);
+        const float3 kInvD65(1.052156925f, 1.000000000f, 0.918357670f);
+
+        float3 XYZ2CIELab(const float3& xyz)
+        {
+            const float delta = 6.0f / 29.0f;
+            const float deltaCube = delta * delta * delta;
+            const float factor = 1.0f / (3.0f * delta * delta);
+            const float term = 4.0f / 29.0f;
+            auto f = [&](float v) { return v > deltaCube ? std::cbrt(v) : factor * v + term; };
+            float x = f(xyz.x * kInvD65.x);
+            float y = f(xyz.y * kInvD65.y);
+            float z = f(xyz.z * kInvD65.z);
+            return float3(116.0f * y - 16.0f, 500.0f * (x - y), 200.0f * (y - z));
+        }
+
+        float3 XYZ2YCxCz(const float3& xyz)
+        {
+            float x = xyz.x * kInvD65.x;
+            float y = xyz.y * kInvD65.y;
+            float z = xyz.z * kInvD65.z;
+            return float3(116.0f * y - 16.0f, 500.0f * (x - y), 200.0f * (y - z));
+        }
+
+        float3 YCxCz2XYZ(const float3& ycxcz)
+        {
+            float y = (ycxcz.x + 16.0f) / 116.0f;
+            float x = ycxcz.y / 500.0f + y;
+            float z = y - ycxcz.z / 200.0f;
+            return float3(x * kD65.x, y * kD65.y, z * kD65.z);
+        }
+
+        float3 Hunt(const float3& lab)
+        {
+            float h = 0.01f * lab.x;
+            return float3(lab.x, h * lab.y, h * lab.z);
+        }
+
+        float HyAB(const float3& a, const float3& b)
+        {
+            float dy = a.y - b.y;
+            float dz = a.z - b.z;
+            return std::abs(a.x - b.x) + std::sqrt(dy * dy + dz * dz);
+        }
+
+        float3 saturate(const float3& c)
+        {
+            return float3(std::clamp(c.x, 0.f, 1.f), std::clamp(c.y, 0.f, 1.f), std::clamp(c.z, 0.f, 1.f));
+        }
+
+        /** Coefficients of the rational polynomial tone mappers (k0 * x^2 + k1 * x + k2) / (k3 * x^2 + k4 * x + k5) used by HDR-FLIP.
+            This matches toneMap() in ToneMappers.slang. Reinhard is handled separately as it operates on luminance.
+        */
+        std::array<float, 6> getToneMapperCoefficients(FLIP::ToneMapper toneMapper)
+        {
+            if (toneMapper == FLIP::ToneMapper::Hable)
+            {
+                const float A = 0.15f;
+                const float B = 0.50f;
+                const float C = 0.10f;
+                const float D = 0.20f;
+                const float E = 0.02f;
+                const float F = 0.30f;
+                std::array<float, 6> k = { A * F - A * E, C * B * F - B * E, 0.0f, A * F, B * F, D * F * F };
+
+                const float W = 11.2f;
+                const float nom = k[0] * W * W + k[1] * W + k[2];
+                const float denom = k[3] * W * W + k[4] * W + k[5];
+                const float whiteScale = denom / nom;
+
+                // Include white scale and exposure bias in rational polynomial coefficients.
+                k[0] = 4.0f * k[0] * whiteScale;
+                k[1] = 2.0f * k[1] * whiteScale;
+                k[2] = k[2] * whiteScale;
+                k[3] = 4.0f * k[3];
+                k[4] = 2.0f * k[4];
+                return k;
+            }
+
+            // ACES approximation including pre-exposure cancellation.
+            return { 0.6f * 0.6f * 2.51f, 0.6f * 0.03f, 0.0f, 0.6f * 0.6f * 2.43f, 0.6f * 0.59f, 0.14f };
+        }
+
+        float luminance(const float3& c)
+        {
+            return 0.2126f * c.x + 0.7152f * c.y + 0.0722f * c.z;
+        }
+
+        float3 toneMap(const float3& c, FLIP::ToneMapper toneMapper, const std::array<float, 6>& k)
+        {
+            if (toneMapper == FLIP::ToneMapper::Reinhard)
+            {
+                float invY = 1.0f / (luminance(c) + 1.0f);
+                return saturate(float3(c.x * invY, c.y * invY, c.z * invY));
+            }
+
+            auto map = [&](float x)
+            {
+                float nom = k[0] * x * x + k[1] * x + k[2];
+                float denom = k[3] * x * x + k[4] * x + k[5];
+                if (std::isinf(denom)) denom = 1.0f; // Avoid inf / inf division.
+                return std::clamp(nom / denom, 0.f, 1.f);
+            };
+            return float3(map(c.x), map(c.y), map(c.z));
+        }
+
+        const float kMaxDistance = std::pow(HyAB(Hunt(XYZ2CIELab(linearRGB2XYZ(float3(0.f, 1.f, 0.f)))), Hunt(XYZ2CIELab(linearRGB2XYZ(float3(0.f, 0.f, 1.f))))), gqc);
+
+        float redistributeErrors(float colorDifference, float featureDifference)
+        {
+            float error = std::pow(colorDifference, gqc);
+            const float perceptualCutoff = gpc * kMaxDistance;
+            if (error < perceptualCutoff) error *= gpt / perceptualCutoff;
+            else error = gpt + ((error - perceptualCutoff) / (kMaxDistance - perceptualCutoff)) * (1.0f - gpt);
+            return std::pow(error, 1.0f - featureDifference);
+        }
+
+        /** Filtered quantities of one image for one output row.
+        */
+        struct FilteredRow
+        {
+            std::vector<float> color[3];    ///< CSF filtered YCxCz.
+            std::vector<float> point[2];    ///< Point detector response in x and y.
+            std::vector<float> edge[2];     ///< Edge detector response in x and y.
+
+            void resize(uint32_t width)
+            {
+                for (auto& v : color) v.assign(width, 0.f);
+                for (auto& v : point) v.assign(width, 0.f);
+                for (auto& v : edge) v.assign(width, 0.f);
+            }
+        };
+
+        /** Per-band scratch memory for one image.
+        */
+        struct BandImage
+        {
+            // Horizontally filtered planes, (rows x width) each.
+            enum Plane { A, RG, BY1, BY2, Point, Edge, Gaussian, Count };
+            std::vector<float> planes[Count];
+            FilteredRow row;
+        };
+
+        /** Remove the outer taps of a symmetric kernel that are too small to affect the result in single precision.
+        */
+        void trimKernel(std::vector<float>& kernel)
+        {
+            float maxTap = 0.f;
+            for (float w : kernel) maxTap = std::max(maxTap, std::abs(w));
+            size_t trim = 0;
+            while (2 * trim + 1 < kernel.size() && std::abs(kernel[trim]) < 1e-8f * maxTap && std::abs(kernel[kernel.size() - 1 - trim]) < 1e-8f * maxTap) trim++;
+            kernel = std::vector<float>(kernel.begin() + trim, kernel.end() - trim);
+        }
+
+        /** Filter a padded row. The padded row has radius extra samples on each side, the kernel has at most 2 * radius + 1 taps.
+        */
+        void convolveRow(const float* pPadded, const std::vector<float>& kernel, uint32_t width, uint32_t radius, float* pDst)
+        {
+            std::fill(pDst, pDst + width, 0.f);
+            const size_t offset = radius - kernel.size() / 2;
+            for (size_t k = 0; k < kernel.size(); k++)
+            {
+                const float w = kernel[k];
+                const float* pSrc = pPadded + offset + k;
+                for (uint32_t x = 0; x < width; x++) pDst[x] += w * pSrc[x];
+            }
+        }
+
+        /** Filter a column of rows and accumulate the scaled result. The rows centered at firstRow + radius are filtered.
+        */
+        void accumulateColumn(const std::vector<float>& plane, const std::vector<float>& kernel, uint32_t width, uint32_t radius, uint32_t firstRow, float scale, float* pDst)
+        {
+            const size_t offset = firstRow + radius - kernel.size() / 2;
+            for (size_t k = 0; k < kernel.size(); k++)
+            {
+                const float w = scale * kernel[k];
+                const float* pSrc = plane.data() + (offset + k) * width;
+                for (uint32_t x = 0; x < width; x++) pDst[x] += w * pSrc[x];
+            }
+        }
+    }
+
+    FLIP::SharedPtr FLIP::create(uint32_t monitorWidthPixels, float monitorWidthMeters, float monitorDistanceMeters)
+    {
+        if (monitorWidthPixels == 0 || !(monitorWidthMeters > 0.f) || !(monitorDistanceMeters > 0.f))
+        {
+            throw std::exception("FLIP::create() - Invalid viewing conditions.");
+        }
+        return SharedPtr(new FLIP(monitorWidthPixels, monitorWidthMeters, monitorDistanceMeters));
+    }
+
+    FLIP::FLIP(uint32_t monitorWidthPixels, float monitorWidthMeters, float monitorDistanceMeters)
+    {
+        mPixelsPerDegree = monitorDistanceMeters * (monitorWidthPixels / monitorWidthMeters) * (kPi / 180.0f);
+        const float dx = 1.0f / mPixelsPerDegree;
+
+        // Radius of the spatial filter, which is always greater than or equal to the radius of the feature detection kernel.
+        mRadius = (int)std::ceil(3.0f * std::sqrt(0.04f / (2.0f * kPiSquared)) * mPixelsPerDegree);
+        const size_t taps = 2 * mRadius + 1;
+
+        // The CSF of each channel is a weighted sum of (at most) two 2D Gaussians a * sqrt(pi / b) * exp(-pi^2 * |p|^2 / b).
+        // Each Gaussian is separable, so the normalized 2D filter is the sum of separable filters with normalized 1D kernels,
+        // weighted by the fraction of the total 2D kernel sum they contribute.
+        for (uint32_t channel = 0; channel < 3; channel++)
+        {
+            const float* ab = kCSFParams[channel];
+            float termSum[2] = {};
+            std::vector<float> kernels[2];
+            for (uint32_t term = 0; term < 2; term++)
+            {
+                kernels[term].resize(taps);
+                float sum = 0.f;
+                for (int x = -mRadius; x <= mRadius; x++)
+                {
+                    float p = x * dx;
+                    float g = std::exp(-p * p * kPiSquared / ab[2 + term]);
+                    kernels[term][x + mRadius] = g;
+                    sum += g;
+                }
+                for (auto& g : kernels[term]) g /= sum;
+                termSum[term] = ab[term] * std::sqrt(kPi / ab[2 + term]) * sum * sum;
+            }
+
+            const float total = termSum[0] + termSum[1];
+            const uint32_t first = channel < 2 ? channel : 2;
+            mCSFKernels[first] = kernels[0];
+            mCSFWeights[first] = termSum[0] / total;
+            if (channel == 2)
+            {
+                mCSFKernels[3] = kernels[1];
+                mCSFWeights[3] = termSum[1] / total;
+            }
+        }
+
+        // Feature detection uses the first and second derivatives of a Gaussian. The shader normalizes the positive
+        // and negative lobes of the 2D kernels separately, which factors into the same normalization of the 1D kernels
+        // combined with a normalized Gaussian in the orthogonal direction.
+        const float sigmaFeatures = 0.5f * gw * mPixelsPerDegree;
+        const float sigmaFeaturesSquared = sigmaFeatures * sigmaFeatures;
+        mGaussianKernel.resize(taps);
+        mPointKernel.resize(taps);
+        mEdgeKernel.resize(taps);
+        float gaussianSum = 0.f, positiveSum = 0.f, negativeSum = 0.f, edgeSum = 0.f;
+        for (int x = -mRadius; x <= mRadius; x++)
+        {
+            float g = std::exp(-(x * x) / (2.0f * sigmaFeaturesSquared));
+            float point = ((x * x) / sigmaFeaturesSquared - 1.0f) * g;
+            float edge = -x * g;
+            mGaussianKernel[x + mRadius] = g;
+            mPointKernel[x + mRadius] = point;
+            mEdgeKernel[x + mRadius] = edge;
+            gaussianSum += g;
+            if (point >= 0.f) positiveSum += point;
+            else negativeSum -= point;
+            if (edge >= 0.f) edgeSum += edge;
+        }
+        for (auto& g : mGaussianKernel) g /= gaussianSum;
+        for (auto& p : mPointKernel) p /= (p >= 0.f ? positiveSum : negativeSum);
+        for (auto& e : mEdgeKernel) e /= edgeSum;
+
+        for (auto& kernel : mCSFKernels) trimKernel(kernel);
+        trimKernel(mGaussianKernel);
+        trimKernel(mPointKernel);
+        trimKernel(mEdgeKernel);
+    }
+
+    struct FLIP::Input
+    {
+        const float* pReference;
+        const float* pTest;
+        uint32_t width;
+        uint32_t height;
+        bool clampInput;
+        bool isHDR;
+        ToneMapper toneMapper;
+        std::array<float, 6> toneMapperCoefficients;
+    };
+
+    double FLIP::computeLDR(const float* pReference, const float* pTest, uint32_t width, uint32_t height, float* pErrorMap, bool clampInput) const
+    {
+        if (!pReference || !pTest) throw std::exception("FLIP::computeLDR() - Missing input image.");
+        if (width == 0 || height == 0) return 0.0;
+
+        const Input input = { pReference, pTest, width, height, clampInput, false, ToneMapper::ACES, {} };
+        const uint32_t bandCount = (height + kBandHeight - 1) / kBandHeight;
+        std::vector<double> bandSums(bandCount, 0.0);
+
+        NumericRange<uint32_t> range(0, bandCount);
+        std::for_each(std::execution::par, range.begin(), range.end(), [&](uint32_t band)
+        {
+            uint32_t y0 = band * kBandHeight;
+            uint32_t y1 = std::min(height, y0 + kBandHeight);
+            std::vector<float> errors(pErrorMap ? 0 : size_t(y1 - y0) * width);
+            float* pBandErrors = pErrorMap ? pErrorMap + size_t(y0) * width : errors.data();
+            computeBand(input, y0, y1, 0.f, pBandErrors);
+            bandSums[band] = std::accumulate(pBandErrors, pBandErrors + size_t(y1 - y0) * width, 0.0);
+        });
+
+        return std::accumulate(bandSums.begin(), bandSums.end(), 0.0) / (double(width) * height);
+    }
+
+    double FLIP::computeHDR(const float* pReference, const float* pTest, uint32_t width, uint32_t height, const ExposureParameters& exposures, ToneMapper toneMapper,
+        float* pErrorMap, float* pExposureMap, bool clampInput) const
+    {
+        if (!pReference || !pTest) throw std::exception("FLIP::computeHDR() - Missing input image.");
+        if (exposures.numExposures < 2) throw std::exception("FLIP::computeHDR() - At least two exposures are required.");
+        if (width == 0 || height == 0) return 0.0;
+
+        const Input input = { pReference, pTest, width, height, clampInput, true, toneMapper, getToneMapperCoefficients(toneMapper) };
+        const uint32_t bandCount = (height + kBandHeight - 1) / kBandHeight;
+        std::vector<double> bandSums(bandCount, 0.0);
+
+        // Each band evaluates all exposures before moving on to keep the working set small.
+        NumericRange<uint32_t> range(0, bandCount);
+        std::for_each(std::execution::par, range.begin(), range.end(), [&](uint32_t band)
+        {
+            uint32_t y0 = band * kBandHeight;
+            uint32_t y1 = std::min(height, y0 + kBandHeight);
+            const size_t count = size_t(y1 - y0) * width;
+            std::vector<float> errors(count);
+            std::vector<float> maxErrors(count, 0.f);
+            std::vector<uint32_t> maxExposures(count, 0);
+
+            for (uint32_t i = 0; i < exposures.numExposures; i++)
+            {
+                computeBand(input, y0, y1, exposures.startExposure + i * exposures.exposureDelta, errors.data());
+                for (size_t j = 0; j < count; j++)
+                {
+                    if (errors[j] > maxErrors[j])
+                    {
+                        maxErrors[j] = errors[j];
+                        maxExposures[j] = i;
+                    }
+                }
+            }
+
+            const size_t offset = size_t(y0) * width;
+            if (pErrorMap) std::copy(maxErrors.begin(), maxErrors.end(), pErrorMap + offset);
+            if (pExposureMap)
+            {
+                for (size_t j = 0; j < count; j++) pExposureMap[offset + j] = maxExposures[j] / (exposures.numExposures - 1.0f);
+            }
+            bandSums[band] = std::accumulate(maxErrors.begin(), maxErrors.end(), 0.0);
+        });
+
+        return std::accumulate(bandSums.begin(), bandSums.end(), 0.0) / (double(width) * height);
+    }
+
+    FLIP::ExposureParameters FLIP::computeExposureParameters(ToneMapper toneMapper, float medianLuminance, float maxLuminance)
+    {
+        std::array<float, 6> k;
+        if (toneMapper == ToneMapper::Reinhard) k = { 0.0f, 1.0f, 0.0f, 0.0f, 1.0f, 1.0f };
+        else if (toneMapper == ToneMapper::ACES) k = { 0.6f * 0.6f * 2.51f, 0.6f * 0.03f, 0.0f, 0.6f * 0.6f * 2.43f, 0.6f * 0.59f, 0.14f }; // 0.6 is pre-exposure cancellation.
+        else k = { 0.231683f, 0.013791f, 0.0f, 0.18f, 0.3f, 0.018f };
+
+        // Solve for the input value x where the tone mapper output reaches t, i.e., a * x^2 + b * x + c = 0.
+        const float t = 0.85f;
+        const float a = k[0] - t * k[3];
+        const float b = k[1] - t * k[4];
+        const float c = k[2] - t * k[5];
+
+        float xMax;
+        if (a == 0.0f)
+        {
+            xMax = -c / b;
+        }
+        else
+        {
+            float d1 = -0.5f * (b / a);
+            float d2 = std::sqrt((d1 * d1) - (c / a));
+            xMax = d1 + d2;
+        }
+
+        ExposureParameters params;
+        params.startExposure = std::log2(xMax / maxLuminance);
+        float stopExposure = std::log2(xMax / medianLuminance);
+        params.numExposures = uint32_t(std::max(2.0f, std::ceil(stopExposure - params.startExposure)));
+        params.exposureDelta = (stopExposure - params.startExposure) / (params.numExposures - 1.0f);
+        return params;
+    }
+
+    FLIP::ExposureParameters FLIP::computeExposureParameters(ToneMapper toneMapper, const float* pReference, uint32_t width, uint32_t height)
+    {
+        if (!pReference || width == 0 || height == 0) throw std::exception("FLIP::computeExposureParameters() - Empty reference image.");
+
+        std::vector<float> luminances(size_t(width) * height);
+        NumericRange<uint32_t> rows(0, height);
+        std::for_each(std::execution::par, rows.begin(), rows.end(), [&](uint32_t y)
+        {
+            for (uint32_t x = 0; x < width; x++)
+            {
+                size_t i = size_t(y) * width + x;
+                luminances[i] = luminance(float3(pReference[i * 4 + 0], pReference[i * 4 + 1], pReference[i * 4 + 2]));
+            }
+        });
+
+        float median, max;
+        computeMedianMax(luminances.data(), luminances.size(), median, max);
+        return computeExposureParameters(toneMapper, median, max);
+    }
+
+    void FLIP::computeMedianMax(const float* pValues, size_t count, float& median, float& max)
+    {
+        if (count == 0) throw std::exception("FLIP::computeMedianMax() - No values.");
+
+        std::vector<float> values(pValues, pValues + count);
+        max = *std::max_element(values.begin(), values.end());
+        auto mid = values.begin() + count / 2;
+        std::nth_element(values.begin(), mid, values.end());
+        median = *mid;
+        if ((count & 1) == 0)
+        {
+            // Even number of values, average with the largest value of the lower half.
+            median = (*std::max_element(values.begin(), mid) + median) * 0.5f;
+        }
+    }
+
+    FLIP::PooledValues FLIP::computePooledValues(const float* pErrorMap, size_t count)
+    {
+        PooledValues pooled;
+        if (!pErrorMap || count == 0) return pooled;
+
+        std::vector<float> values(pErrorMap, pErrorMap + count);
+        std::sort(std::execution::par, values.begin(), values.end());
+
+        const double sum = std::accumulate(values.begin(), values.end(), 0.0);
+        pooled.mean = sum / count;
+        pooled.min = values.front();
+        pooled.max = values.back();
+
+        // Walk the sorted values once and pick up the percentiles of the error-weighted distribution.
+        const float percentiles[3] = { 0.25f, 0.5f, 0.75f };
+        float* results[3] = { &pooled.weightedFirstQuartile, &pooled.weightedMedian, &pooled.weightedThirdQuartile };
+        if (sum > 0.0)
+        {
+            double cumulative = 0.0;
+            size_t next = 0;
+            for (size_t i = 0; i < count && next < 3; i++)
+            {
+                cumulative += values[i];
+                while (next < 3 && cumulative >= percentiles[next] * sum) *results[next++] = values[i];
+            }
+            while (next < 3) *results[next++] = values.back();
+        }
+
+        return pooled;
+    }
+
+    void FLIP::computeBand(const Input& input, uint32_t y0, uint32_t y1, float exposure, float* pBandErrors) const
+    {
+        const uint32_t width = input.width;
+        const uint32_t height = input.height;
+        const uint32_t radius = (uint32_t)mRadius;
+        const uint32_t rows = (y1 - y0) + 2 * radius;
+        const uint32_t paddedWidth = width + 2 * radius;
+        const float exposureScale = std::exp2(exposure);
+
+        BandImage images[2];
+        std::vector<float> padded[4];
+        for (auto& p : padded) p.resize(paddedWidth);
+
+        // Convert the band including the halo rows to YCxCz and filter horizontally.
+        const float* pSources[2] = { input.pReference, input.pTest };
+        for (uint32_t i = 0; i < 2; i++)
+        {
+            BandImage& image = images[i];
+            for (auto& plane : image.planes) plane.resize(size_t(rows) * width);
+
+            for (uint32_t r = 0; r < rows; r++)
+            {
+                int sy = std::clamp(int(y0) + int(r) - mRadius, 0, int(height) - 1);
+                const float* pRow = pSources[i] + size_t(sy) * width * 4;
+                for (uint32_t px = 0; px < paddedWidth; px++)
+                {
+                    int sx = std::clamp(int(px) - mRadius, 0, int(width) - 1);
+                    float3 c(pRow[sx * 4 + 0], pRow[sx * 4 + 1], pRow[sx * 4 + 2]);
+                    if (input.isHDR)
+                    {
+                        if (input.clampInput) c = float3(std::max(c.x, 0.f), std::max(c.y, 0.f), std::max(c.z, 0.f));
+                        c = toneMap(float3(c.x * exposureScale, c.y * exposureScale, c.z * exposureScale), input.toneMapper, input.toneMapperCoefficients);
+                    }
+                    else if (input.clampInput)
+                    {
+                        c = saturate(c);
+                    }
+                    float3 ycxcz = XYZ2YCxCz(linearRGB2XYZ(c));
+                    padded[0][px] = ycxcz.x;
+                    padded[1][px] = ycxcz.y;
+                    padded[2][px] = ycxcz.z;
+                    padded[3][px] = (ycxcz.x + 16.0f) / 116.0f; // Normalized Y from YCxCz.
+                }
+
+                size_t offset = size_t(r) * width;
+                convolveRow(padded[0].data(), mCSFKernels[0], width, radius, image.planes[BandImage::A].data() + offset);
+                convolveRow(padded[1].data(), mCSFKernels[1], width, radius, image.planes[BandImage::RG].data() + offset);
+                convolveRow(padded[2].data(), mCSFKernels[2], width, radius, image.planes[BandImage::BY1].data() + offset);
+                convolveRow(padded[2].data(), mCSFKernels[3], width, radius, image.planes[BandImage::BY2].data() + offset);
+                convolveRow(padded[3].data(), mPointKernel, width, radius, image.planes[BandImage::Point].data() + offset);
+                convolveRow(padded[3].data(), mEdgeKernel, width, radius, image.planes[BandImage::Edge].data() + offset);
+                convolveRow(padded[3].data(), mGaussianKernel, width, radius, image.planes[BandImage::Gaussian].data() + offset);
+            }
+        }
+
+        // Filter vertically one output row at a time and evaluate the error.
+        for (uint32_t y = y0; y < y1; y++)
+        {
+            const uint32_t firstRow = y - y0;
+            for (auto& image : images)
+            {
+                FilteredRow& row = image.row;
+                row.resize(width);
+                accumulateColumn(image.planes[BandImage::A], mCSFKernels[0], width, radius, firstRow, 1.f, row.color[0].data());
+                accumulateColumn(image.planes[BandImage::RG], mCSFKernels[1], width, radius, firstRow, 1.f, row.color[1].data());
+                accumulateColumn(image.planes[BandImage::BY1], mCSFKernels[2], width, radius, firstRow, mCSFWeights[2], row.color[2].data());
+                accumulateColumn(image.planes[BandImage::BY2], mCSFKernels[3], width, radius, firstRow, mCSFWeights[3], row.color[2].data());
+                accumulateColumn(image.planes[BandImage::Point], mGaussianKernel, width, radius, firstRow, 1.f, row.point[0].data());
+                accumulateColumn(image.planes[BandImage::Gaussian], mPointKernel, width, radius, firstRow, 1.f, row.point[1].data());
+                accumulateColumn(image.planes[BandImage::Edge], mGaussianKernel, width, radius, firstRow, 1.f, row.edge[0].data());
+                accumulateColumn(image.planes[BandImage::Gaussian], mEdgeKernel, width, radius, firstRow, 1.f, row.edge[1].data());
+            }
+
+            const FilteredRow& ref = images[0].row;
+            const FilteredRow& test = images[1].row;
+            for (uint32_t x = 0; x < width; x++)
+            {
+                // Color pipeline.
+                float3 filteredRef = saturate(XYZ2LinearRGB(YCxCz2XYZ(float3(ref.color[0][x], ref.color[1][x], ref.color[2][x]))));
+                float3 filteredTest = saturate(XYZ2LinearRGB(YCxCz2XYZ(float3(test.color[0][x], test.color[1][x], test.color[2][x]))));
+                float colorDiff = HyAB(Hunt(XYZ2CIELab(linearRGB2XYZ(filteredRef))), Hunt(XYZ2CIELab(linearRGB2XYZ(filteredTest))));
+
+                // Feature pipeline.
+                auto length = [](float a, float b) { return std::sqrt(a * a + b * b); };
+                float edgeDiff = std::abs(length(ref.edge[0][x], ref.edge[1][x]) - length(test.edge[0][x], test.edge[1][x]));
+                float pointDiff = std::abs(length(ref.point[0][x], ref.point[1][x]) - length(test.point[0][x], test.point[1][x]));
+                float featureDiff = std::sqrt(std::max(pointDiff, edgeDiff) * kInvSqrt2); // gqf = 0.5
+
+                float value = redistributeErrors(colorDiff, featureDiff);
+
+                // Invalid values are reported as maximum error, same as FLIPPass.
+                if (std::isnan(value) || std::isinf(value) || value < 0.f || value > 1.f) value = 1.f;
+
+                pBandErrors[size_t(y - y0) * width + x] = value;
+            }
+        }
+    }
+}
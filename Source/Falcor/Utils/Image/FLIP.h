@@ -0,0 +1,159 @@
+/***************************************************************************
+ # Copyright (c) 2015-21, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#pragma once
+#include <memory>
+#include <vector>
+
+namespace Falcor
+{
+    /** CPU implementation of the FLIP image difference metric.
+
+        The evaluator matches the LDR-FLIP and HDR-FLIP computations in FLIPPass (RenderPasses/FLIPPass/FLIPPass.cs.slang),
+        including the viewing condition defaults and clamp-to-edge addressing. The CSF and feature detection
+        kernels used by the shader are sums of separable Gaussians, which allows evaluating them as separable
+        filters over bands of rows instead of the brute-force 2D loops. Bands are processed in parallel.
+
+        Images are passed as tightly packed RGBA32F arrays in linear RGB (the alpha channel is ignored).
+    */
+    class dlldecl FLIP
+    {
+    public:
+        using SharedPtr = std::shared_ptr<FLIP>;
+
+        /** Tone mappers assumed by HDR-FLIP. Values match FLIPToneMapperType in FLIPPass.
+        */
+        enum class ToneMapper : uint32_t
+        {
+            ACES = 0,
+            Hable = 1,
+            Reinhard = 2,
+        };
+
+        /** Exposures evaluated by HDR-FLIP.
+        */
+        struct ExposureParameters
+        {
+            float startExposure = 0.f;      ///< First exposure (log2 scale).
+            float exposureDelta = 0.f;      ///< Exposure increment between evaluations.
+            uint32_t numExposures = 2;      ///< Number of exposures, at least 2.
+        };
+
+        /** Pooled statistics of an error map.
+            The weighted percentiles weigh each pixel by its error, so they describe where most of the error is.
+        */
+        struct PooledValues
+        {
+            double mean = 0.0;
+            float min = 0.f;
+            float max = 0.f;
+            float weightedMedian = 0.f;
+            float weightedFirstQuartile = 0.f;
+            float weightedThirdQuartile = 0.f;
+        };
+
+        /** Create a FLIP evaluator for the given viewing conditions.
+            \param[in] monitorWidthPixels Horizontal monitor resolution.
+            \param[in] monitorWidthMeters Width of the monitor in meters.
+            \param[in] monitorDistanceMeters Distance of the monitor from the viewer in meters.
+            \return New object, or throws an exception if the viewing conditions are invalid.
+        */
+        static SharedPtr create(uint32_t monitorWidthPixels = 3840, float monitorWidthMeters = 0.7f, float monitorDistanceMeters = 0.7f);
+
+        /** Get the number of pixels per degree of visual angle for the viewing conditions.
+        */
+        float getPixelsPerDegree() const { return mPixelsPerDegree; }
+
+        /** Get the filter radius in pixels.
+        */
+        int getFilterRadius() const { return mRadius; }
+
+        /** Compute the LDR-FLIP error map between two images.
+            \param[in] pReference Reference image (width * height RGBA32F pixels).
+            \param[in] pTest Test image (width * height RGBA32F pixels).
+            \param[in] width Image width in pixels.
+            \param[in] height Image height in pixels.
+            \param[out] pErrorMap Per-pixel FLIP error in [0,1] (width * height floats), or nullptr if not needed.
+            \param[in] clampInput Clamp input colors to [0,1] before evaluation.
+            \return Mean FLIP error over the image.
+        */
+        double computeLDR(const float* pReference, const float* pTest, uint32_t width, uint32_t height, float* pErrorMap, bool clampInput = false) const;
+
+        /** Compute the HDR-FLIP error map between two images.
+            HDR-FLIP is the maximum LDR-FLIP error over a range of exposures of the tone mapped inputs.
+            \param[in] pReference Reference image (width * height RGBA32F pixels).
+            \param[in] pTest Test image (width * height RGBA32F pixels).
+            \param[in] width Image width in pixels.
+            \param[in] height Image height in pixels.
+            \param[in] exposures Exposures to evaluate, see computeExposureParameters().
+            \param[in] toneMapper Tone mapper applied to the exposed inputs.
+            \param[out] pErrorMap Per-pixel FLIP error in [0,1] (width * height floats), or nullptr if not needed.
+            \param[out] pExposureMap Per-pixel exposure index of the maximum error normalized to [0,1] (width * height floats), or nullptr if not needed.
+            \param[in] clampInput Clamp negative input colors to zero before evaluation.
+            \return Mean FLIP error over the image.
+        */
+        double computeHDR(const float* pReference, const float* pTest, uint32_t width, uint32_t height, const ExposureParameters& exposures, ToneMapper toneMapper,
+            float* pErrorMap, float* pExposureMap = nullptr, bool clampInput = false) const;
+
+        /** Compute the HDR-FLIP exposure range from the median and maximum luminance of the reference image.
+            The start exposure maps the maximum luminance and the stop exposure maps the median luminance
+            to the point where the tone mapper reaches 85% of its output range.
+        */
+        static ExposureParameters computeExposureParameters(ToneMapper toneMapper, float medianLuminance, float maxLuminance);
+
+        /** Compute the HDR-FLIP exposure range for a reference image (width * height RGBA32F pixels).
+        */
+        static ExposureParameters computeExposureParameters(ToneMapper toneMapper, const float* pReference, uint32_t width, uint32_t height);
+
+        /** Compute the median and maximum of an array of values.
+        */
+        static void computeMedianMax(const float* pValues, size_t count, float& median, float& max);
+
+        /** Compute pooled statistics of an error map.
+            \param[in] pErrorMap Error values.
+            \param[in] count Number of values.
+            \return Pooled values. All values are zero if the map is empty.
+        */
+        static PooledValues computePooledValues(const float* pErrorMap, size_t count);
+
+    private:
+        FLIP(uint32_t monitorWidthPixels, float monitorWidthMeters, float monitorDistanceMeters);
+
+        struct Input;
+        void computeBand(const Input& input, uint32_t y0, uint32_t y1, float exposure, float* pBandErrors) const;
+
+        float mPixelsPerDegree = 0.f;
+        int mRadius = 0;
+
+        // 1D filter taps (at most 2 * radius + 1 entries each).
+        std::vector<float> mCSFKernels[4];      ///< Normalized CSF Gaussians for the A, RG and the two BY terms.
+        float mCSFWeights[4] = {};              ///< Weight of each CSF Gaussian after normalization of the 2D kernel.
+        std::vector<float> mGaussianKernel;     ///< Normalized feature detection Gaussian.
+        std::vector<float> mPointKernel;        ///< Normalized point detection kernel (second derivative).
+        std::vector<float> mEdgeKernel;         ///< Normalized edge detection kernel (first derivative).
+    };
+}
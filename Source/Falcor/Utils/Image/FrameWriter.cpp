@@ -0,0 +1,167 @@
+/***************************************************************************
+ # Copyright (c) 2015-21, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "stdafx.h"
+#include "FrameWriter.h"
+#include "Utils/Timing/TraceProfiler.h"
+#include "Utils/Video/VideoEncoder.h"
+
+namespace Falcor
+{
+    FrameWriter::SharedPtr FrameWriter::create(uint32_t workerCount, size_t maxPendingJobs)
+    {
+        if (workerCount == 0) throw std::exception("FrameWriter::create() - Worker count must be at least one.");
+        if (maxPendingJobs == 0) throw std::exception("FrameWriter::create() - Maximum number of pending jobs must be at least one.");
+        return SharedPtr(new FrameWriter(workerCount, maxPendingJobs));
+    }
+
+    FrameWriter::FrameWriter(uint32_t workerCount, size_t maxPendingJobs)
+        : mMaxPendingJobs(maxPendingJobs)
+    {
+        for (uint32_t i = 0; i < workerCount; i++) mWorkers.emplace_back(&FrameWriter::workerLoop, this);
+    }
+
+    FrameWriter::~FrameWriter()
+    {
+        flush();
+
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mTerminate = true;
+        }
+        mWorkAvailable.notify_all();
+
+        for (auto& worker : mWorkers) worker.join();
+    }
+
+    void FrameWriter::submit(Job job, const void* pStream)
+    {
+        std::unique_lock<std::mutex> lock(mMutex);
+
+        if (mQueue.size() + mRunningCount >= mMaxPendingJobs)
+        {
+            auto startTime = CpuTimer::getCurrentTimePoint();
+            mJobCompleted.wait(lock, [&] () { return mQueue.size() + mRunningCount < mMaxPendingJobs; });
+            mStats.stallCount++;
+            mStats.stallTimeMs += CpuTimer::calcDuration(startTime, CpuTimer::getCurrentTimePoint());
+        }
+
+        mQueue.push_back({ std::move(job), pStream });
+        mStats.submittedCount++;
+        lock.unlock();
+
+        mWorkAvailable.notify_one();
+    }
+
+    void FrameWriter::writeImage(const std::string& filename, uint32_t width, uint32_t height, Bitmap::FileFormat fileFormat, Bitmap::ExportFlags exportFlags, ResourceFormat resourceFormat, std::vector<uint8_t>&& data)
+    {
+        // The job is stored in a std::function, which must be copyable, so the data is moved into a shared pointer.
+        auto pData = std::make_shared<std::vector<uint8_t>>(std::move(data));
+        submit([=] ()
+        {
+            TRACE_ZONE("FrameWriter::writeImage");
+            Bitmap::saveImage(filename, width, height, fileFormat, exportFlags, resourceFormat, true, pData->data());
+        });
+    }
+
+    void FrameWriter::appendVideoFrame(VideoEncoder* pEncoder, std::vector<uint8_t>&& data)
+    {
+        assert(pEncoder);
+        auto pData = std::make_shared<std::vector<uint8_t>>(std::move(data));
+        submit([=] ()
+        {
+            TRACE_ZONE("FrameWriter::appendVideoFrame");
+            pEncoder->appendFrame(pData->data());
+        }, pEncoder);
+    }
+
+    void FrameWriter::flush()
+    {
+        std::unique_lock<std::mutex> lock(mMutex);
+        mJobCompleted.wait(lock, [&] () { return mQueue.empty() && mRunningCount == 0; });
+    }
+
+    size_t FrameWriter::getPendingCount() const
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        return mQueue.size() + mRunningCount;
+    }
+
+    FrameWriter::Stats FrameWriter::getStats() const
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        return mStats;
+    }
+
+    void FrameWriter::workerLoop()
+    {
+        TraceProfiler::setThreadName("FrameWriter");
+
+        std::unique_lock<std::mutex> lock(mMutex);
+        while (true)
+        {
+            // Find the first job whose stream has no running job. Earlier jobs of the same stream would
+            // have been found first, so this preserves the submission order within each stream.
+            auto isStreamActive = [&] (const void* pStream)
+            {
+                return pStream && std::find(mActiveStreams.begin(), mActiveStreams.end(), pStream) != mActiveStreams.end();
+            };
+            auto it = std::find_if(mQueue.begin(), mQueue.end(), [&] (const QueuedJob& job) { return !isStreamActive(job.pStream); });
+
+            if (it == mQueue.end())
+            {
+                if (mTerminate) break;
+                mWorkAvailable.wait(lock);
+                continue;
+            }
+
+            QueuedJob job = std::move(*it);
+            mQueue.erase(it);
+            if (job.pStream) mActiveStreams.push_back(job.pStream);
+            mRunningCount++;
+            lock.unlock();
+
+            try
+            {
+                job.job();
+            }
+            catch (const std::exception& e)
+            {
+                logError("FrameWriter job failed: " + std::string(e.what()));
+            }
+
+            lock.lock();
+            if (job.pStream) mActiveStreams.erase(std::find(mActiveStreams.begin(), mActiveStreams.end(), job.pStream));
+            mRunningCount--;
+            mStats.completedCount++;
+
+            // Completing a stream job may have made the next job of the same stream runnable.
+            if (job.pStream) mWorkAvailable.notify_all();
+            mJobCompleted.notify_all();
+        }
+    }
+}
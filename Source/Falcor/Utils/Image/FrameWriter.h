@@ -0,0 +1,130 @@
+/***************************************************************************
+ # Copyright (c) 2015-21, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#pragma once
+#include "Bitmap.h"
+#include <condition_variable>
+#include <deque>
+#include <functional>
+
+namespace Falcor
+{
+    class VideoEncoder;
+
+    /** Bounded worker pool for converting and writing captured frames off the render thread.
+
+        Jobs are executed by a fixed number of worker threads. Jobs submitted with the same stream key
+        are executed one at a time in submission order, which is required for appending frames to a
+        video encoder. Jobs without a stream key may run in any order.
+
+        The number of pending jobs (queued or running) is bounded. When the limit is reached, submit()
+        blocks until a job has completed. This applies backpressure to the producer instead of letting
+        captured frames accumulate in memory when encoding is slower than rendering.
+    */
+    class dlldecl FrameWriter
+    {
+    public:
+        using SharedPtr = std::shared_ptr<FrameWriter>;
+        using Job = std::function<void()>;
+
+        struct Stats
+        {
+            uint64_t submittedCount = 0;    ///< Number of submitted jobs.
+            uint64_t completedCount = 0;    ///< Number of completed jobs.
+            uint64_t stallCount = 0;        ///< Number of submissions that had to wait for a free slot.
+            double stallTimeMs = 0.0;       ///< Total time spent waiting for a free slot in milliseconds.
+        };
+
+        /** Create a frame writer.
+            \param[in] workerCount Number of worker threads.
+            \param[in] maxPendingJobs Maximum number of queued or running jobs before submit() blocks.
+            \return A new object, or throws an exception if the arguments are invalid.
+        */
+        static SharedPtr create(uint32_t workerCount = 2, size_t maxPendingJobs = 8);
+
+        /** Destructor. Waits for all pending jobs to complete.
+        */
+        ~FrameWriter();
+
+        /** Submit a job. Blocks while the maximum number of jobs is pending.
+            \param[in] job Job to execute. Exceptions thrown by the job are logged.
+            \param[in] pStream Optional stream key. Jobs with the same key are executed in order, one at a time.
+        */
+        void submit(Job job, const void* pStream = nullptr);
+
+        /** Submit an image to be written to file. See Bitmap::saveImage() for a description of the arguments.
+            \param[in] data Image data with the top-left pixel first. Ownership is transferred to the writer.
+        */
+        void writeImage(const std::string& filename, uint32_t width, uint32_t height, Bitmap::FileFormat fileFormat, Bitmap::ExportFlags exportFlags, ResourceFormat resourceFormat, std::vector<uint8_t>&& data);
+
+        /** Submit a frame to be appended to a video. Frames for the same encoder are appended in submission order.
+            The encoder must outlive the job. Call flush() before ending the capture on the encoder.
+            \param[in] pEncoder Video encoder.
+            \param[in] data Frame data in the encoder's format. Ownership is transferred to the writer.
+        */
+        void appendVideoFrame(VideoEncoder* pEncoder, std::vector<uint8_t>&& data);
+
+        /** Wait for all pending jobs to complete.
+        */
+        void flush();
+
+        /** Get the number of queued or running jobs.
+        */
+        size_t getPendingCount() const;
+
+        /** Get the maximum number of pending jobs.
+        */
+        size_t getMaxPendingCount() const { return mMaxPendingJobs; }
+
+        /** Get statistics.
+        */
+        Stats getStats() const;
+
+    private:
+        FrameWriter(uint32_t workerCount, size_t maxPendingJobs);
+
+        struct QueuedJob
+        {
+            Job job;
+            const void* pStream;
+        };
+
+        void workerLoop();
+
+        const size_t mMaxPendingJobs;
+        std::vector<std::thread> mWorkers;
+
+        mutable std::mutex mMutex;
+        std::condition_variable mWorkAvailable;                 ///< Signaled when a job may have become runnable.
+        std::condition_variable mJobCompleted;                  ///< Signaled when a job has completed.
+        std::deque<QueuedJob> mQueue;
+        std::vector<const void*> mActiveStreams;                ///< Streams with a running job.
+        size_t mRunningCount = 0;
+        bool mTerminate = false;
+        Stats mStats;
+    };
+}
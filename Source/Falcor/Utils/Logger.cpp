@@ -27,6 +27,7 @@
  **************************************************************************/
 #include "stdafx.h"
 #include "Logger.h"
+#include <fstream>
 
 namespace Falcor
 {
@@ -37,9 +38,12 @@ namespace Falcor
         bool sShowBoxOnError = true;
         Logger::Level sVerbosity = Logger::Level::Info;
 
+        const auto kWorkerWaitTime = std::chrono::milliseconds(10);
+
 #if _LOG_ENABLED
         bool sInitialized = false;
         FILE* sLogFile = nullptr;
+        thread_local bool tIsLoggerWorker = false;  ///< True on the logger worker thread, which is the only thread calling the sinks.
 
         std::string generateLogFilePath()
         {
@@ -90,15 +94,311 @@ namespace Falcor
             if (sLogFile)
             {
                 std::fprintf(sLogFile, "%s", s.c_str());
-                std::fflush(sLogFile);
             }
         }
+
+        std::string formatTimestamp(uint64_t timestamp)
+        {
+            char buf[32];
+            std::snprintf(buf, sizeof(buf), "%.6f", timestamp * 1e-9);
+            return buf;
+        }
+
+        std::string formatLine(const Logger::Message& msg)
+        {
+            return "[" + formatTimestamp(msg.timestamp) + "][T" + std::to_string(msg.threadID) + "] " + Logger::getLevelString(msg.level) + " " + msg.text + "\n";
+        }
+
+        std::string escapeJson(const std::string& s)
+        {
+            std::string result;
+            result.reserve(s.size());
+            for (char c : s)
+            {
+                switch (c)
+                {
+                case '"': result += "\\\""; break;
+                case '\\': result += "\\\\"; break;
+                case '\n': result += "\\n"; break;
+                case '\r': result += "\\r"; break;
+                case '\t': result += "\\t"; break;
+                default:
+                    if ((unsigned char)c < 0x20)
+                    {
+                        char buf[8];
+                        std::snprintf(buf, sizeof(buf), "\\u%04x", (unsigned char)c);
+                        result += buf;
+                    }
+                    else
+                    {
+                        result += c;
+                    }
+                }
+            }
+            return result;
+        }
+
+        class FileSink : public Logger::Sink
+        {
+        public:
+            FileSink(const std::string& path, bool json) : mJson(json)
+            {
+                mStream.open(path, std::ios::out | std::ios::trunc);
+                if (!mStream.is_open()) throw std::exception(("Failed to open log file '" + path + "'.").c_str());
+            }
+
+            void write(const Logger::Message& msg) override
+            {
+                if (mJson)
+                {
+                    mStream << "{\"time\":" << formatTimestamp(msg.timestamp) << ",\"thread\":" << msg.threadID << ",\"level\":\"" << levelName(msg.level) << "\",\"message\":\"" << escapeJson(msg.text) << "\"}\n";
+                }
+                else
+                {
+                    mStream << formatLine(msg);
+                }
+            }
+
+            void flush() override { mStream.flush(); }
+
+        private:
+            static const char* levelName(Logger::Level level)
+            {
+                // Strip the parentheses from the level string.
+                switch (level)
+                {
+                case Logger::Level::Fatal: return "Fatal";
+                case Logger::Level::Error: return "Error";
+                case Logger::Level::Warning: return "Warning";
+                case Logger::Level::Info: return "Info";
+                case Logger::Level::Debug: return "Debug";
+                default: return "";
+                }
+            }
+
+            std::ofstream mStream;
+            bool mJson;
+        };
+
+        class ConsoleSink : public Logger::Sink
+        {
+        public:
+            void write(const Logger::Message& msg) override
+            {
+                if (msg.level > Logger::Level::Error) std::cout << formatLine(msg);
+                else std::cerr << formatLine(msg);
+            }
+
+            void flush() override { std::cout.flush(); }
+        };
+
+        /** State of the asynchronous logger.
+            Producers push messages to the queue, a single background thread writes them to the log file and sinks.
+        */
+        struct LoggerState
+        {
+            BoundedMPSCQueue<Logger::Message> queue{ Logger::kQueueCapacity };
+            const std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+            std::atomic<uint32_t> nextThreadID = 0;
+
+            std::atomic<uint64_t> queuedCount = 0;
+            std::atomic<uint64_t> writtenCount = 0;
+            std::atomic<uint64_t> droppedCount = 0;
+
+            std::mutex sinkMutex;                       ///< Protects the sink list and the log file.
+            std::vector<Logger::Sink::SharedPtr> sinks;
+
+            std::mutex workerMutex;                     ///< Protects the worker thread state below.
+            std::condition_variable workerCondition;    ///< Signaled to wake up the worker.
+            std::condition_variable flushCondition;     ///< Signaled by the worker when messages have been written.
+            std::thread worker;
+            std::atomic<bool> isRunning = false;
+            std::atomic<bool> isExiting = false;        ///< Set at process exit. Messages are then written synchronously.
+            bool stopRequested = false;
+            bool wakeRequested = false;
+
+            void startWorker()
+            {
+                std::lock_guard<std::mutex> lock(workerMutex);
+                if (isRunning) return;
+                stopRequested = false;
+                worker = std::thread(&LoggerState::workerLoop, this);
+                isRunning = true;
+            }
+
+            void stopWorker()
+            {
+                {
+                    std::lock_guard<std::mutex> lock(workerMutex);
+                    if (!isRunning) return;
+                    stopRequested = true;
+                    workerCondition.notify_one();
+                }
+                if (worker.joinable()) worker.join();
+                isRunning = false;
+            }
+
+            void workerLoop()
+            {
+                tIsLoggerWorker = true;
+                while (true)
+                {
+                    writePending();
+
+                    std::unique_lock<std::mutex> lock(workerMutex);
+                    flushCondition.notify_all();
+                    if (stopRequested) break;
+                    workerCondition.wait_for(lock, kWorkerWaitTime, [this] { return wakeRequested || stopRequested; });
+                    wakeRequested = false;
+                }
+                writePending();
+                flushCondition.notify_all();
+            }
+
+            /** Write all queued messages. Must only be called by one thread at a time.
+            */
+            void writePending()
+            {
+                std::lock_guard<std::mutex> lock(sinkMutex);
+                Logger::Message msg;
+                bool written = false;
+                while (queue.tryPop(msg))
+                {
+                    writeMessage(msg);
+                    writtenCount.fetch_add(1, std::memory_order_release);
+                    written = true;
+                }
+
+                if (written)
+                {
+                    if (sLogFile) std::fflush(sLogFile);
+                    for (const auto& pSink : sinks) pSink->flush();
+                }
+            }
+
+            void writeMessage(const Logger::Message& msg, bool writeToSinks = true)
+            {
+                std::string s = Logger::getLevelString(msg.level) + std::string(" ") + msg.text + "\n";
+
+                // Write to log file.
+                printToLogFile(s);
+
+                // Write to debug window if debugger is attached.
+                if (isDebuggerPresent()) printToDebugWindow(s);
+
+                // Write errors to stderr unconditionally, other messages to stdout if enabled.
+                if (msg.level > Logger::Level::Error)
+                {
+                    if (sLogToConsole) std::cout << s;
+                }
+                else
+                {
+                    std::cerr << s;
+                }
+
+                if (writeToSinks)
+                {
+                    for (const auto& pSink : sinks) pSink->write(msg);
+                }
+            }
+
+            void push(Logger::Level level, const std::string& text)
+            {
+                thread_local uint32_t threadID = nextThreadID++;
+
+                Logger::Message msg;
+                msg.level = level;
+                msg.text = text;
+                msg.timestamp = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - startTime).count();
+                msg.threadID = threadID;
+
+                // Messages logged on the worker thread, i.e. from a sink, can't wait for space in the queue as the worker is the one draining it.
+                // They are written directly, but not to the sinks to avoid recursion. The worker already holds the sink mutex.
+                if (tIsLoggerWorker)
+                {
+                    writeMessage(msg, false);
+                    return;
+                }
+
+                // Messages logged at process exit are written directly as the worker has been stopped.
+                if (isExiting)
+                {
+                    std::lock_guard<std::mutex> lock(sinkMutex);
+                    writeMessage(msg);
+                    if (sLogFile) std::fflush(sLogFile);
+                    for (const auto& pSink : sinks) pSink->flush();
+                    return;
+                }
+
+                if (!isRunning) startWorker();
+
+                while (!queue.tryPush(std::move(msg)))
+                {
+                    // Drop low priority messages rather than stalling the caller. Warnings and errors wait for space.
+                    if (level >= Logger::Level::Info)
+                    {
+                        droppedCount.fetch_add(1, std::memory_order_relaxed);
+                        return;
+                    }
+                    wake();
+                    std::this_thread::yield();
+                }
+                queuedCount.fetch_add(1, std::memory_order_release);
+            }
+
+            void wake()
+            {
+                std::lock_guard<std::mutex> lock(workerMutex);
+                wakeRequested = true;
+                workerCondition.notify_one();
+            }
+
+            void flush()
+            {
+                if (!isRunning) return;
+
+                // Messages logged from a sink can't be waited for on the worker thread.
+                if (tIsLoggerWorker) return;
+
+                uint64_t target = queuedCount.load(std::memory_order_acquire);
+                std::unique_lock<std::mutex> lock(workerMutex);
+                wakeRequested = true;
+                workerCondition.notify_one();
+                flushCondition.wait(lock, [&] { return writtenCount.load(std::memory_order_acquire) >= target || !isRunning; });
+            }
+
+            /** Write all queued messages at process exit and stop the worker, so that messages aren't lost if Logger::shutdown() is never called.
+            */
+            void exit()
+            {
+                isExiting = true;
+                stopWorker();
+                writePending();
+            }
+        };
+
+        LoggerState& getState()
+        {
+            // The state is intentionally never destroyed, so that logging from static destructors remains valid.
+            // Queued messages are written by Logger::shutdown(), Logger::flush() or at process exit.
+            static LoggerState* spState = []()
+            {
+                auto pState = new LoggerState();
+                std::atexit([]() { getState().exit(); });
+                return pState;
+            }();
+            return *spState;
+        }
 #endif
     }
 
     void Logger::shutdown()
     {
 #if _LOG_ENABLED
+        auto& state = getState();
+        state.stopWorker();
+
+        std::lock_guard<std::mutex> lock(state.sinkMutex);
         if(sLogFile)
         {
             fclose(sLogFile);
@@ -108,7 +408,60 @@ namespace Falcor
 #endif
     }
 
-    const char* getLogLevelString(Logger::Level level)
+    void Logger::flush()
+    {
+#if _LOG_ENABLED
+        getState().flush();
+#endif
+    }
+
+    void Logger::addSink(const Sink::SharedPtr& pSink)
+    {
+#if _LOG_ENABLED
+        auto& state = getState();
+        std::lock_guard<std::mutex> lock(state.sinkMutex);
+        state.sinks.push_back(pSink);
+#endif
+    }
+
+    void Logger::removeSink(const Sink::SharedPtr& pSink)
+    {
+#if _LOG_ENABLED
+        auto& state = getState();
+        state.flush();
+        std::lock_guard<std::mutex> lock(state.sinkMutex);
+        state.sinks.erase(std::remove(state.sinks.begin(), state.sinks.end(), pSink), state.sinks.end());
+#endif
+    }
+
+    Logger::Sink::SharedPtr Logger::createFileSink(const std::string& path)
+    {
+        return std::make_shared<FileSink>(path, false);
+    }
+
+    Logger::Sink::SharedPtr Logger::createConsoleSink()
+    {
+        return std::make_shared<ConsoleSink>();
+    }
+
+    Logger::Sink::SharedPtr Logger::createJsonSink(const std::string& path)
+    {
+        return std::make_shared<FileSink>(path, true);
+    }
+
+    Logger::Stats Logger::getStats()
+    {
+        Stats stats;
+#if _LOG_ENABLED
+        auto& state = getState();
+        stats.queuedCount = state.queuedCount.load();
+        stats.writtenCount = state.writtenCount.load();
+        stats.droppedCount = state.droppedCount.load();
+#endif
+        return stats;
+    }
+
+    const char* Logger::getLevelString(Logger::Level level)
     {
         switch (level)
         {
@@ -133,23 +486,11 @@ namespace Falcor
 #if _LOG_ENABLED
         if (level <= sVerbosity)
         {
-            std::string s = getLogLevelString(level) + std::string(" ") + msg + "\n";
-
-            // Write to log file.
-            printToLogFile(s);
+            auto& state = getState();
+            state.push(level, msg);
 
-            // Write to debug window if debugger is attached.
-            if (isDebuggerPresent()) printToDebugWindow(s);
-
-            // Write errors to stderr unconditionally, other messages to stdout if enabled.
-            if (level > Logger::Level::Error)
-            {
-                if (sLogToConsole) std::cout << s;
-            }
-            else
-            {
-                std::cerr << s;
-            }
+            // Make sure errors are written before showing a message box or terminating.
+            if (level <= Logger::Level::Error) state.flush();
         }
 #endif
 
@@ -32,6 +32,8 @@ namespace Falcor
     /** Container class for logging messages.
     *   To enable log messages, make sure _LOG_ENABLED is set to true in FalcorConfig.h.
     *   Messages are printed to a log file in the application directory. Using Logger#ShowBoxOnError() you can control if a message box will be shown as well.
+    *   Logging is asynchronous and thread-safe. Messages are queued in a bounded lock-free queue and written by a background thread,
+    *   so the calling thread never waits for I/O unless the message is an error or the queue is full.
     */
     class dlldecl Logger
     {
@@ -60,10 +62,95 @@ namespace Falcor
             None            ///< Don't show a message box.
         };
 
+        /** A log message as passed to the sinks.
+        */
+        struct Message
+        {
+            Level level = Level::Info;  ///< Message severity.
+            std::string text;           ///< Message text, without severity prefix or trailing newline.
+            uint64_t timestamp = 0;     ///< Time when the message was logged, in nanoseconds since the logger was started.
+            uint32_t threadID = 0;      ///< Sequential ID of the thread that logged the message. IDs are assigned in order of each thread's first message.
+        };
+
+        /** Interface for log message destinations.
+            Messages are passed to the sinks in the order they were queued, on the logger's background thread.
+            A sink is never called concurrently from multiple threads.
+        */
+        class dlldecl Sink
+        {
+        public:
+            using SharedPtr = std::shared_ptr<Sink>;
+            virtual ~Sink() = default;
+
+            /** Write a message.
+                Messages logged from within this call are written to the log file and console directly, but are not passed to the sinks.
+            */
+            virtual void write(const Message& msg) = 0;
+
+            /** Flush buffered output. Called after each batch of messages.
+            */
+            virtual void flush() {}
+        };
+
+        /** Logger statistics.
+        */
+        struct Stats
+        {
+            uint64_t queuedCount = 0;   ///< Number of messages queued.
+            uint64_t writtenCount = 0;  ///< Number of messages written to the sinks.
+            uint64_t droppedCount = 0;  ///< Number of messages dropped because the queue was full.
+        };
+
+        /** Max number of messages waiting to be written.
+            When the queue is full, debug and info messages are dropped while warnings and errors wait for space.
+        */
+        static const size_t kQueueCapacity = 16384;
+
         /** Shutdown the logger and close the log file.
+            Waits for all queued messages to be written and stops the background thread.
+            If this is not called, the queued messages are written at process exit and later messages are written synchronously.
         */
         static void shutdown();
 
+        /** Wait until all messages logged so far have been written to the log file and sinks.
+            Messages logged with severity `Error` or higher are always flushed before returning from the log call.
+        */
+        static void flush();
+
+        /** Add a sink that receives all messages passing the verbosity filter, in addition to the log file.
+            \param[in] pSink Sink to add.
+        */
+        static void addSink(const Sink::SharedPtr& pSink);
+
+        /** Remove a previously added sink. Messages queued before the call are still written to the sink.
+            \param[in] pSink Sink to remove.
+        */
+        static void removeSink(const Sink::SharedPtr& pSink);
+
+        /** Create a sink writing text lines with timestamp and thread ID to a file.
+            \param[in] path File path. The file is created or truncated.
+            \return New sink, or throws an exception if the file can't be opened.
+        */
+        static Sink::SharedPtr createFileSink(const std::string& path);
+
+        /** Create a sink writing text lines with timestamp and thread ID to stdout, and errors to stderr.
+        */
+        static Sink::SharedPtr createConsoleSink();
+
+        /** Create a sink writing one JSON object per line to a file, with the fields "time" (seconds), "thread", "level" and "message".
+            \param[in] path File path. The file is created or truncated.
+            \return New sink, or throws an exception if the file can't be opened.
+        */
+        static Sink::SharedPtr createJsonSink(const std::string& path);
+
+        /** Get the logger statistics.
+        */
+        static Stats getStats();
+
+        /** Get the string representation of a severity level.
+        */
+        static const char* getLevelString(Level level);
+
         /** Set the path of the logfile.
             Note: This only works if the logfile has not been opened for writing yet.
             \param[in] path Logfile path
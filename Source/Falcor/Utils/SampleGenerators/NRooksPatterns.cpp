@@ -0,0 +1,442 @@
+/***************************************************************************
+ # Copyright (c) 2015-21, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "stdafx.h"
+#include "NRooksPatterns.h"
+#include "Utils/NumericRange.h"
+#include <execution>
+#include <fstream>
+#include <random>
+
+namespace Falcor
+{
+    namespace
+    {
+        const std::string kCacheDirectory = "NVIDIA/Falcor/NRooksPatterns";
+        const char kMagic[4] = { 'N', 'R', 'K', 'S' };
+        const uint32_t kVersion = 1;
+
+        struct Header
+        {
+            char magic[4];
+            uint32_t version;
+            uint32_t size;
+            uint32_t patternCount;
+            uint32_t seed;
+            uint32_t optimization;
+            uint32_t iterations;
+        };
+
+        /** Latin square of group IDs, stored row-major.
+        */
+        class LatinSquare
+        {
+        public:
+            LatinSquare(uint8_t* pData, uint32_t size) : mpData(pData), mSize(size) {}
+
+            uint8_t& at(uint32_t x, uint32_t y) { return mpData[y * mSize + x]; }
+
+            /** Fill with a random Latin square. Each row is a random perfect matching between columns and the
+                groups not yet used in each column, which always exists since the remaining bipartite graph is regular.
+            */
+            void randomize(std::mt19937& rng)
+            {
+                std::vector<uint32_t> usedGroups(mSize, 0);    // Bit mask of groups used per column.
+                std::vector<uint32_t> columns(mSize), groups(mSize);
+                std::iota(columns.begin(), columns.end(), 0);
+                std::iota(groups.begin(), groups.end(), 0);
+                std::vector<int> columnOfGroup(mSize);
+                std::vector<bool> visited(mSize);
+
+                // Kuhn's augmenting path algorithm.
+                std::function<bool(uint32_t)> augment = [&](uint32_t x)
+                {
+                    for (uint32_t g : groups)
+                    {
+                        if ((usedGroups[x] & (1u << g)) || visited[g]) continue;
+                        visited[g] = true;
+                        if (columnOfGroup[g] < 0 || augment(columnOfGroup[g]))
+                        {
+                            columnOfGroup[g] = x;
+                            return true;
+                        }
+                    }
+                    return false;
+                };
+
+                for (uint32_t y = 0; y < mSize; y++)
+                {
+                    std::shuffle(columns.begin(), columns.end(), rng);
+                    std::shuffle(groups.begin(), groups.end(), rng);
+                    std::fill(columnOfGroup.begin(), columnOfGroup.end(), -1);
+                    for (uint32_t x : columns)
+                    {
+                        std::fill(visited.begin(), visited.end(), false);
+                        bool found = augment(x);
+                        assert(found);
+                    }
+                    for (uint32_t g = 0; g < mSize; g++)
+                    {
+                        at(columnOfGroup[g], y) = (uint8_t)g;
+                        usedGroups[columnOfGroup[g]] |= 1u << g;
+                    }
+                }
+            }
+
+            /** Energy penalizing pixels of the same group that are close to each other.
+            */
+            float computeEnergy()
+            {
+                uint8_t rows[NRooksPatterns::kMaxSize][NRooksPatterns::kMaxSize];
+                for (uint32_t y = 0; y < mSize; y++)
+                {
+                    for (uint32_t x = 0; x < mSize; x++) rows[at(x, y)][x] = (uint8_t)y;
+                }
+
+                float energy = 0.f;
+                for (uint32_t g = 0; g < mSize; g++)
+                {
+                    for (uint32_t i = 0; i < mSize; i++)
+                    {
+                        for (uint32_t j = i + 1; j < mSize; j++)
+                        {
+                            int dx = (int)j - (int)i;
+                            int dy = (int)rows[g][j] - (int)rows[g][i];
+                            float d2 = (float)(dx * dx + dy * dy);
+                            energy += 1.f / (d2 * d2);
+                        }
+                    }
+                }
+                return energy;
+            }
+
+            void swapRows(uint32_t a, uint32_t b)
+            {
+                for (uint32_t x = 0; x < mSize; x++) std::swap(at(x, a), at(x, b));
+            }
+
+            void swapColumns(uint32_t a, uint32_t b)
+            {
+                for (uint32_t y = 0; y < mSize; y++) std::swap(at(a, y), at(b, y));
+            }
+
+            /** Row cycle switch. The groups in rows a and b are swapped along the cycle of columns through x,
+                where each column is followed by the column holding its group of row b in row a.
+                The groups of each row stay the same set, so the Latin property is preserved. Swaps of intercalates are the special case of 2-cycles.
+            */
+            void switchRowCycle(uint32_t a, uint32_t b, uint32_t x)
+            {
+                uint32_t columnOfGroup[NRooksPatterns::kMaxSize];
+                for (uint32_t i = 0; i < mSize; i++) columnOfGroup[at(i, a)] = i;
+
+                uint32_t start = x;
+                do
+                {
+                    uint32_t next = columnOfGroup[at(x, b)];
+                    std::swap(at(x, a), at(x, b));
+                    x = next;
+                } while (x != start);
+            }
+
+            /** Column cycle switch, the transpose of switchRowCycle().
+            */
+            void switchColumnCycle(uint32_t a, uint32_t b, uint32_t y)
+            {
+                uint32_t rowOfGroup[NRooksPatterns::kMaxSize];
+                for (uint32_t i = 0; i < mSize; i++) rowOfGroup[at(a, i)] = i;
+
+                uint32_t start = y;
+                do
+                {
+                    uint32_t next = rowOfGroup[at(b, y)];
+                    std::swap(at(a, y), at(b, y));
+                    y = next;
+                } while (y != start);
+            }
+
+            /** Simulated annealing with random moves that preserve the Latin property.
+            */
+            void optimize(std::mt19937& rng, uint32_t iterations)
+            {
+                const float kStartTemperature = 0.05f;
+                const float kEndTemperature = 0.0005f;
+
+                std::uniform_int_distribution<uint32_t> index(0, mSize - 1);
+                std::uniform_real_distribution<float> uniform(0.f, 1.f);
+                std::vector<uint8_t> current(mpData, mpData + mSize * mSize);
+                std::vector<uint8_t> best = current;
+                float energy = computeEnergy();
+                float bestEnergy = energy;
+
+                for (uint32_t i = 0; i < iterations; i++)
+                {
+                    uint32_t a = index(rng), b = index(rng), c = index(rng);
+                    if (a == b) continue;
+
+                    switch (i % 4)
+                    {
+                    case 0: switchRowCycle(a, b, c); break;
+                    case 1: switchColumnCycle(a, b, c); break;
+                    case 2: swapRows(a, b); break;
+                    case 3: swapColumns(a, b); break;
+                    }
+
+                    const float temperature = kStartTemperature * std::pow(kEndTemperature / kStartTemperature, (float)i / iterations);
+                    const float newEnergy = computeEnergy();
+                    if (newEnergy <= energy || uniform(rng) < std::exp((energy - newEnergy) / temperature))
+                    {
+                        energy = newEnergy;
+                        std::copy_n(mpData, current.size(), current.begin());
+                        if (energy < bestEnergy)
+                        {
+                            bestEnergy = energy;
+                            best = current;
+                        }
+                    }
+                    else
+                    {
+                        std::copy(current.begin(), current.end(), mpData);
+                    }
+                }
+                std::copy(best.begin(), best.end(), mpData);
+            }
+
+        private:
+            uint8_t* mpData;
+            uint32_t mSize;
+        };
+
+        void validateDesc(const NRooksPatterns::Desc& desc)
+        {
+            if (desc.size < 2 || desc.size > NRooksPatterns::kMaxSize || desc.size % 2 != 0) throw std::exception("NRooksPatterns: Size must be even and in [2, 16]");
+            if (desc.patternCount == 0) throw std::exception("NRooksPatterns: Pattern count must be non-zero");
+        }
+    }
+
+    NRooksPatterns::SharedPtr NRooksPatterns::create(const Desc& desc, bool useCache)
+    {
+        validateDesc(desc);
+
+        auto cachePath = getCachePath(desc);
+        if (useCache && std::filesystem::exists(cachePath))
+        {
+            try
+            {
+                auto pPatterns = read(cachePath);
+                if (pPatterns->getDesc() == desc) return pPatterns;
+                logWarning("N-rooks pattern cache '" + cachePath.string() + "' does not match the requested patterns. Regenerating.");
+            }
+            catch (const std::exception& e)
+            {
+                logWarning(std::string("Failed to load N-rooks pattern cache: ") + e.what());
+            }
+        }
+
+        SharedPtr pPatterns = SharedPtr(new NRooksPatterns(desc));
+        pPatterns->generate();
+
+        if (useCache)
+        {
+            try
+            {
+                std::filesystem::create_directories(cachePath.parent_path());
+                pPatterns->write(cachePath);
+            }
+            catch (const std::exception& e)
+            {
+                logWarning(std::string("Failed to write N-rooks pattern cache: ") + e.what());
+            }
+        }
+        return pPatterns;
+    }
+
+    NRooksPatterns::NRooksPatterns(const Desc& desc)
+        : mDesc(desc)
+    {
+        mGroups.resize((size_t)desc.patternCount * desc.size * desc.size);
+    }
+
+    void NRooksPatterns::generate()
+    {
+        const uint32_t size = mDesc.size;
+        auto range = NumericRange<uint32_t>(0, mDesc.patternCount);
+        std::for_each(std::execution::par, range.begin(), range.end(), [&](uint32_t pattern)
+        {
+            // Seed per pattern so that the result does not depend on the scheduling.
+            std::seed_seq seq{ mDesc.seed, pattern };
+            std::mt19937 rng(seq);
+            LatinSquare square(mGroups.data() + (size_t)pattern * size * size, size);
+            square.randomize(rng);
+            if (mDesc.optimization == Optimization::MinDistance) square.optimize(rng, mDesc.iterations);
+        });
+    }
+
+    uint32_t NRooksPatterns::getRow(uint32_t pattern, uint32_t group, uint32_t x) const
+    {
+        for (uint32_t y = 0; y < mDesc.size; y++)
+        {
+            if (getGroup(pattern, x, y) == group) return y;
+        }
+        throw std::exception("NRooksPatterns: Invalid group");
+    }
+
+    NRooksPatterns::Metrics NRooksPatterns::computeMetrics(uint32_t pattern) const
+    {
+        const uint32_t size = mDesc.size;
+        float minDistance2 = std::numeric_limits<float>::infinity();
+        double sum = 0.0;
+
+        for (uint32_t y = 0; y < size; y++)
+        {
+            for (uint32_t x = 0; x < size; x++)
+            {
+                const uint32_t group = getGroup(pattern, x, y);
+                float pixelMinDistance2 = std::numeric_limits<float>::infinity();
+                for (uint32_t x2 = 0; x2 < size; x2++)
+                {
+                    if (x2 == x) continue;
+                    float dx = (float)x2 - (float)x;
+                    float dy = (float)getRow(pattern, group, x2) - (float)y;
+                    pixelMinDistance2 = std::min(pixelMinDistance2, dx * dx + dy * dy);
+                }
+                minDistance2 = std::min(minDistance2, pixelMinDistance2);
+                sum += std::sqrt(pixelMinDistance2);
+            }
+        }
+
+        Metrics metrics;
+        metrics.minDistance = std::sqrt(minDistance2);
+        metrics.meanMinDistance = (float)(sum / (size * size));
+        return metrics;
+    }
+
+    std::vector<uint8_t> NRooksPatterns::getPackedData() const
+    {
+        const uint32_t size = mDesc.size;
+        const size_t patternBytes = size * size;
+        std::vector<uint8_t> data(mDesc.patternCount * patternBytes, 0);
+
+        auto setNibble = [&](size_t nibble, uint32_t value)
+        {
+            data[nibble / 2] |= (uint8_t)(value << (4 * (nibble % 2)));
+        };
+
+        for (uint32_t pattern = 0; pattern < mDesc.patternCount; pattern++)
+        {
+            const size_t base = 2 * pattern * patternBytes;
+            for (uint32_t y = 0; y < size; y++)
+            {
+                for (uint32_t x = 0; x < size; x++)
+                {
+                    const uint32_t group = getGroup(pattern, x, y);
+                    setNibble(base + group * size + x, y);
+                    setNibble(base + size * size + y * size + x, group);
+                }
+            }
+        }
+        return data;
+    }
+
+    void NRooksPatterns::write(const std::filesystem::path& path) const
+    {
+        std::ofstream fs(path, std::ios_base::binary);
+        if (!fs) throw std::runtime_error("Failed to create N-rooks pattern file '" + path.string() + "'");
+
+        Header header;
+        std::memcpy(header.magic, kMagic, sizeof(kMagic));
+        header.version = kVersion;
+        header.size = mDesc.size;
+        header.patternCount = mDesc.patternCount;
+        header.seed = mDesc.seed;
+        header.optimization = (uint32_t)mDesc.optimization;
+        header.iterations = mDesc.iterations;
+        fs.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+        // Only the group IDs are stored, packed two per byte.
+        std::vector<uint8_t> packed(mGroups.size() / 2);
+        for (size_t i = 0; i < packed.size(); i++) packed[i] = mGroups[2 * i] | (mGroups[2 * i + 1] << 4);
+        fs.write(reinterpret_cast<const char*>(packed.data()), packed.size());
+        if (!fs) throw std::runtime_error("Failed to write N-rooks pattern file '" + path.string() + "'");
+    }
+
+    NRooksPatterns::SharedPtr NRooksPatterns::read(const std::filesystem::path& path)
+    {
+        std::ifstream fs(path, std::ios_base::binary);
+        if (!fs) throw std::runtime_error("Failed to open N-rooks pattern file '" + path.string() + "'");
+
+        Header header;
+        fs.read(reinterpret_cast<char*>(&header), sizeof(header));
+        if (!fs || std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0 || header.version != kVersion)
+        {
+            throw std::runtime_error("Invalid header in N-rooks pattern file '" + path.string() + "'");
+        }
+
+        Desc desc;
+        desc.size = header.size;
+        desc.patternCount = header.patternCount;
+        desc.seed = header.seed;
+        desc.optimization = (Optimization)header.optimization;
+        desc.iterations = header.iterations;
+        validateDesc(desc);
+
+        SharedPtr pPatterns = SharedPtr(new NRooksPatterns(desc));
+        std::vector<uint8_t> packed(pPatterns->mGroups.size() / 2);
+        fs.read(reinterpret_cast<char*>(packed.data()), packed.size());
+        if (!fs) throw std::runtime_error("Failed to read N-rooks pattern file '" + path.string() + "'");
+
+        for (size_t i = 0; i < packed.size(); i++)
+        {
+            pPatterns->mGroups[2 * i] = packed[i] & 0xf;
+            pPatterns->mGroups[2 * i + 1] = packed[i] >> 4;
+        }
+
+        // Validate the Latin property so that corrupt files are not used for rendering.
+        const uint32_t size = desc.size;
+        const uint32_t fullMask = (1u << size) - 1;
+        for (uint32_t pattern = 0; pattern < desc.patternCount; pattern++)
+        {
+            for (uint32_t i = 0; i < size; i++)
+            {
+                uint32_t rowMask = 0, columnMask = 0;
+                for (uint32_t j = 0; j < size; j++)
+                {
+                    rowMask |= 1u << pPatterns->getGroup(pattern, j, i);
+                    columnMask |= 1u << pPatterns->getGroup(pattern, i, j);
+                }
+                if (rowMask != fullMask || columnMask != fullMask) throw std::runtime_error("Invalid pattern in N-rooks pattern file '" + path.string() + "'");
+            }
+        }
+        return pPatterns;
+    }
+
+    std::filesystem::path NRooksPatterns::getCachePath(const Desc& desc)
+    {
+        std::string filename = std::to_string(desc.size) + "RooksPattern" + std::to_string(desc.patternCount) + "_s" + std::to_string(desc.seed)
+            + "_o" + std::to_string((uint32_t)desc.optimization) + "_i" + std::to_string(desc.iterations) + ".bin";
+        return std::filesystem::path(getAppDataDirectory()) / kCacheDirectory / filename;
+    }
+}
@@ -0,0 +1,130 @@
+/***************************************************************************
+ # Copyright (c) 2015-21, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#pragma once
+#include <filesystem>
+
+namespace Falcor
+{
+    /** Sets of N-rooks patterns for path reuse in blocks of N x N pixels (Bekaert et al. 2002).
+
+        Each pattern partitions the block into N groups of N pixels, such that every group has exactly
+        one pixel per row and per column. Equivalently, the group IDs of the pixels form a Latin square.
+        Pixels reuse the paths of the other pixels in their group.
+
+        Patterns are generated from random Latin squares. They are optionally optimized with random
+        row, column and intercalate swaps, which preserve the Latin property, to spread out the pixels
+        of each group. The patterns are optimized in parallel.
+
+        Generated pattern sets are cached on disk in a compact binary format, keyed by the generation parameters.
+    */
+    class dlldecl NRooksPatterns
+    {
+    public:
+        using SharedPtr = std::shared_ptr<NRooksPatterns>;
+
+        static const uint32_t kMaxSize = 16;    ///< Group IDs and rows are stored in 4 bits.
+
+        enum class Optimization : uint32_t
+        {
+            None,           ///< Random Latin squares.
+            MinDistance,    ///< Maximize the distances between pixels in the same group.
+        };
+
+        struct Desc
+        {
+            uint32_t size = 16;                                     ///< Number of rooks per pattern, equal to the block width. Must be even and at most kMaxSize.
+            uint32_t patternCount = 256;                            ///< Number of patterns.
+            uint32_t seed = 0;                                      ///< Random seed.
+            Optimization optimization = Optimization::MinDistance;  ///< Optimization of the random patterns.
+            uint32_t iterations = 5000;                             ///< Number of optimization steps per pattern.
+
+            bool operator==(const Desc& other) const
+            {
+                return size == other.size && patternCount == other.patternCount && seed == other.seed && optimization == other.optimization && iterations == other.iterations;
+            }
+        };
+
+        /** Quality metrics of a pattern.
+        */
+        struct Metrics
+        {
+            float minDistance = 0.f;        ///< Smallest distance between two pixels in the same group.
+            float meanMinDistance = 0.f;    ///< Mean distance from a pixel to the closest pixel in the same group.
+        };
+
+        /** Create a set of patterns.
+            \param[in] desc Generation parameters.
+            \param[in] useCache Load the patterns from the cache if available, and write them to the cache after generation.
+            \return New object, or throws an exception on error.
+        */
+        static SharedPtr create(const Desc& desc, bool useCache = true);
+
+        /** Read a set of patterns written with write().
+            \param[in] path File path.
+            \return New object, or throws an exception if the file is missing or invalid.
+        */
+        static SharedPtr read(const std::filesystem::path& path);
+
+        /** Write the patterns in the compact binary format (4 bits per pixel).
+            \param[in] path File path.
+        */
+        void write(const std::filesystem::path& path) const;
+
+        /** Get the cache file path for a set of generation parameters.
+        */
+        static std::filesystem::path getCachePath(const Desc& desc);
+
+        const Desc& getDesc() const { return mDesc; }
+
+        /** Get the group of a pixel in the block.
+        */
+        uint32_t getGroup(uint32_t pattern, uint32_t x, uint32_t y) const { return mGroups[(pattern * mDesc.size + y) * mDesc.size + x]; }
+
+        /** Get the row of the pixel of a group in a column of the block.
+        */
+        uint32_t getRow(uint32_t pattern, uint32_t group, uint32_t x) const;
+
+        /** Compute the quality metrics of a pattern.
+        */
+        Metrics computeMetrics(uint32_t pattern) const;
+
+        /** Get the patterns in the layout used by the ReSTIR PT shaders, size^2 bytes per pattern:
+            - size groups x size columns, 4 bits each: the row of the pixel of the group in each column.
+            - size x size pixels in row-major order, 4 bits each: the group of each pixel.
+            Entries are packed two per byte, low nibble first.
+        */
+        std::vector<uint8_t> getPackedData() const;
+
+    private:
+        NRooksPatterns(const Desc& desc);
+        void generate();
+
+        Desc mDesc;
+        std::vector<uint8_t> mGroups;       ///< Group of each pixel, patternCount x size x size, row-major.
+    };
+}
@@ -29,6 +29,7 @@
 #include <thread>
 #include <mutex>
 #include <condition_variable>
+#include <atomic>
 
 namespace Falcor
 {
@@ -123,4 +124,96 @@ namespace Falcor
         std::mutex mMutex;
         std::condition_variable mCondition;
     };
+
+    /** Bounded lock-free multi-producer single-consumer queue.
+
+        The queue is a ring buffer of cells with a sequence number each (Vyukov's bounded queue).
+        Producers claim a cell with a single compare-and-swap on the enqueue position and publish it by updating the
+        cell's sequence number. The consumer reads cells in order without any atomic read-modify-write operations.
+        Pushing fails instead of blocking when the queue is full.
+
+        Any number of threads may call tryPush() concurrently, but only one thread at a time may call tryPop().
+    */
+    template<typename T>
+    class BoundedMPSCQueue
+    {
+    public:
+        /** Create a queue.
+            \param[in] capacity Max number of elements in the queue. Must be a power of two.
+        */
+        explicit BoundedMPSCQueue(size_t capacity)
+            : mCells(capacity)
+            , mMask(capacity - 1)
+        {
+            if (capacity < 2 || (capacity & (capacity - 1)) != 0) throw std::exception("BoundedMPSCQueue capacity must be a power of two.");
+            for (size_t i = 0; i < capacity; i++) mCells[i].sequence.store(i, std::memory_order_relaxed);
+        }
+
+        BoundedMPSCQueue(const BoundedMPSCQueue&) = delete;
+        BoundedMPSCQueue& operator=(const BoundedMPSCQueue&) = delete;
+
+        /** Try to append an element.
+            \param[in] value Element to append. It is only moved from if the push succeeds.
+            \return True if the element was appended, false if the queue is full.
+        */
+        bool tryPush(T&& value)
+        {
+            size_t pos = mEnqueuePos.load(std::memory_order_relaxed);
+            while (true)
+            {
+                Cell& cell = mCells[pos & mMask];
+                size_t sequence = cell.sequence.load(std::memory_order_acquire);
+                intptr_t diff = (intptr_t)sequence - (intptr_t)pos;
+                if (diff == 0)
+                {
+                    if (mEnqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                    {
+                        cell.value = std::move(value);
+                        cell.sequence.store(pos + 1, std::memory_order_release);
+                        return true;
+                    }
+                }
+                else if (diff < 0)
+                {
+                    return false;
+                }
+                else
+                {
+                    pos = mEnqueuePos.load(std::memory_order_relaxed);
+                }
+            }
+        }
+
+        /** Try to remove the oldest element. Must only be called by the consumer thread.
+            \param[out] value Removed element.
+            \return True if an element was removed, false if the queue is empty.
+        */
+        bool tryPop(T& value)
+        {
+            Cell& cell = mCells[mDequeuePos & mMask];
+            size_t sequence = cell.sequence.load(std::memory_order_acquire);
+            if ((intptr_t)sequence - (intptr_t)(mDequeuePos + 1) < 0) return false;
+
+            value = std::move(cell.value);
+            cell.sequence.store(mDequeuePos + mMask + 1, std::memory_order_release);
+            mDequeuePos++;
+            return true;
+        }
+
+        /** Get the capacity of the queue.
+        */
+        size_t getCapacity() const { return mCells.size(); }
+
+    private:
+        struct Cell
+        {
+            std::atomic<size_t> sequence;
+            T value;
+        };
+
+        std::vector<Cell> mCells;
+        const size_t mMask;
+        alignas(64) std::atomic<size_t> mEnqueuePos = 0;
+        alignas(64) size_t mDequeuePos = 0;
+    };
 }
@@ -30,6 +30,7 @@
 #include <unordered_map>
 #include <memory>
 #include "CpuTimer.h"
+#include "TraceProfiler.h"
 #include "Core/API/GpuTimer.h"
 #include "Utils/Scripting/ScriptBindings.h"
 
@@ -42,6 +43,7 @@ namespace Falcor
         It automatically creates event hierarchies based on the order and nesting of the calls made.
         This class uses a double-buffering scheme for GPU profiling to avoid GPU stalls.
         ProfilerEvent is a wrapper class which together with scoping can simplify event profiling.
+        The profiler must only be used from the main thread. Use TraceProfiler to record zones on worker threads.
     */
     class dlldecl Profiler
     {
@@ -269,16 +271,27 @@ namespace Falcor
             , mFlags(flags)
         {
             Profiler::instance().startEvent(mName, mFlags);
+
+            // Also record the event in the trace profiler so that main thread events show up alongside worker threads.
+            if (TraceProfiler::isCapturing())
+            {
+                mpTraceName = TraceProfiler::internName(mName);
+                mTraceBegin = TraceProfiler::getTimestamp();
+            }
         }
 
         ~ProfilerEvent()
         {
+            if (mpTraceName) TraceProfiler::recordZone(mpTraceName, mTraceBegin, TraceProfiler::getTimestamp());
+
             Profiler::instance().endEvent(mName, mFlags);
         }
 
     private:
         const std::string mName;
         Profiler::Flags mFlags;
+        const char* mpTraceName = nullptr;
+        uint64_t mTraceBegin = 0;
     };
 
 #if _PROFILING_ENABLED
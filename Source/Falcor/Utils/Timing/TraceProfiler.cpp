@@ -0,0 +1,351 @@
+/***************************************************************************
+ # Copyright (c) 2015-21, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "stdafx.h"
+#include "TraceProfiler.h"
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <unordered_set>
+
+namespace Falcor
+{
+    namespace
+    {
+        const size_t kChunkSize = 1 << 14;
+        const size_t kMaxChunkCount = TraceProfiler::kMaxEventsPerThread / kChunkSize;
+
+        enum class EventType : uint32_t
+        {
+            Zone,
+            FlowBegin,
+            FlowEnd,
+        };
+
+        struct Event
+        {
+            const char* name;
+            uint64_t begin;
+            uint64_t end;
+            uint64_t flowID;
+            EventType type;
+        };
+
+        /** Per-thread event buffer.
+            Only the owning thread writes events. The event count is published with release semantics
+            so that the exporter can read all events up to the count without locking.
+            Chunks are allocated on demand and never freed while the buffer is alive.
+        */
+        struct ThreadBuffer
+        {
+            uint32_t threadIndex = 0;
+            std::string name;                                   ///< Thread name. Protected by the registry mutex.
+            std::atomic<uint64_t> generation = 0;               ///< Capture generation the events belong to. Only written by the owning thread.
+            std::atomic<size_t> count = 0;                      ///< Number of published events.
+            std::atomic<size_t> dropped = 0;                    ///< Number of dropped events.
+            std::atomic<bool> alive = true;                     ///< False once the owning thread has exited.
+            std::atomic<Event*> chunks[kMaxChunkCount] = {};
+
+            ~ThreadBuffer()
+            {
+                for (auto& chunk : chunks) delete[] chunk.load();
+            }
+
+            void push(const Event& event, uint64_t currentGeneration)
+            {
+                // Lazily discard events from a previous capture. Doing this on the owning thread avoids
+                // racing with concurrent writes.
+                if (generation.load(std::memory_order_relaxed) != currentGeneration)
+                {
+                    count.store(0, std::memory_order_relaxed);
+                    dropped.store(0, std::memory_order_relaxed);
+                    generation.store(currentGeneration, std::memory_order_release);
+                }
+
+                size_t index = count.load(std::memory_order_relaxed);
+                if (index >= TraceProfiler::kMaxEventsPerThread)
+                {
+                    dropped.fetch_add(1, std::memory_order_relaxed);
+                    return;
+                }
+
+                Event* pChunk = chunks[index / kChunkSize].load(std::memory_order_relaxed);
+                if (!pChunk)
+                {
+                    pChunk = new Event[kChunkSize];
+                    chunks[index / kChunkSize].store(pChunk, std::memory_order_release);
+                }
+                pChunk[index % kChunkSize] = event;
+                count.store(index + 1, std::memory_order_release);
+            }
+        };
+
+        struct Registry
+        {
+            std::mutex mutex;
+            std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+            uint32_t nextThreadIndex = 0;
+            std::atomic<uint64_t> generation = 1;
+            std::atomic<uint64_t> nextFlowID = 1;
+            uint64_t startTimestamp = 0;    ///< Timestamp counter value at the start of the capture.
+            uint64_t startTimeNs = 0;       ///< System time in nanoseconds at the start of the capture.
+            std::unordered_set<std::string> names;
+        };
+
+        // The registry is intentionally leaked so that threads exiting during static destruction
+        // can still safely mark their buffers as dead.
+        Registry& getRegistry()
+        {
+            static Registry* pRegistry = new Registry();
+            return *pRegistry;
+        }
+
+        /** Thread-local handle to the calling thread's buffer.
+            The buffer itself is owned by the registry so that its events outlive the thread.
+        */
+        struct ThreadHandle
+        {
+            ThreadBuffer* pBuffer = nullptr;
+
+            ~ThreadHandle()
+            {
+                if (pBuffer) pBuffer->alive.store(false);
+            }
+        };
+
+        thread_local ThreadHandle tThreadHandle;
+
+        ThreadBuffer& getThreadBuffer()
+        {
+            if (!tThreadHandle.pBuffer)
+            {
+                auto& registry = getRegistry();
+                std::lock_guard<std::mutex> lock(registry.mutex);
+                auto pBuffer = std::make_unique<ThreadBuffer>();
+                pBuffer->threadIndex = registry.nextThreadIndex++;
+                pBuffer->name = "Thread " + std::to_string(pBuffer->threadIndex);
+                tThreadHandle.pBuffer = pBuffer.get();
+                registry.buffers.push_back(std::move(pBuffer));
+            }
+            return *tThreadHandle.pBuffer;
+        }
+
+        void pushEvent(const Event& event)
+        {
+            if (!TraceProfiler::isCapturing()) return;
+            getThreadBuffer().push(event, getRegistry().generation.load(std::memory_order_acquire));
+        }
+
+        uint64_t getTimeNs()
+        {
+            return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+        }
+
+        void writeJsonString(std::ostream& os, const char* str)
+        {
+            os << '"';
+            for (const char* p = str; *p; ++p)
+            {
+                char c = *p;
+                switch (c)
+                {
+                case '"': os << "\\\""; break;
+                case '\\': os << "\\\\"; break;
+                case '\n': os << "\\n"; break;
+                case '\r': os << "\\r"; break;
+                case '\t': os << "\\t"; break;
+                default:
+                    if ((unsigned char)c < 0x20) os << "\\u" << std::hex << std::setw(4) << std::setfill('0') << (int)c << std::dec << std::setfill(' ');
+                    else os << c;
+                }
+            }
+            os << '"';
+        }
+    }
+
+    std::atomic<bool> TraceProfiler::sCapturing = false;
+
+    void TraceProfiler::start()
+    {
+        auto& registry = getRegistry();
+        std::lock_guard<std::mutex> lock(registry.mutex);
+
+        // Release buffers of threads that have exited. Their events belong to the previous capture.
+        auto& buffers = registry.buffers;
+        buffers.erase(std::remove_if(buffers.begin(), buffers.end(), [](const auto& pBuffer) { return !pBuffer->alive.load(); }), buffers.end());
+
+        registry.startTimeNs = getTimeNs();
+        registry.startTimestamp = getTimestamp();
+        registry.generation.fetch_add(1, std::memory_order_release);
+        sCapturing.store(true);
+    }
+
+    void TraceProfiler::stop()
+    {
+        sCapturing.store(false);
+    }
+
+    void TraceProfiler::recordZone(const char* name, uint64_t begin, uint64_t end)
+    {
+        pushEvent({ name, begin, end, 0, EventType::Zone });
+    }
+
+    void TraceProfiler::setThreadName(const std::string& name)
+    {
+        auto& buffer = getThreadBuffer();
+        std::lock_guard<std::mutex> lock(getRegistry().mutex);
+        buffer.name = name;
+    }
+
+    uint64_t TraceProfiler::newFlowID()
+    {
+        return getRegistry().nextFlowID.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void TraceProfiler::flowBegin(uint64_t id, const char* name)
+    {
+        uint64_t timestamp = getTimestamp();
+        pushEvent({ name, timestamp, timestamp, id, EventType::FlowBegin });
+    }
+
+    void TraceProfiler::flowEnd(uint64_t id, const char* name)
+    {
+        uint64_t timestamp = getTimestamp();
+        pushEvent({ name, timestamp, timestamp, id, EventType::FlowEnd });
+    }
+
+    const char* TraceProfiler::internName(const std::string& name)
+    {
+        auto& registry = getRegistry();
+        std::lock_guard<std::mutex> lock(registry.mutex);
+        return registry.names.insert(name).first->c_str();
+    }
+
+    TraceProfiler::Stats TraceProfiler::getStats()
+    {
+        auto& registry = getRegistry();
+        std::lock_guard<std::mutex> lock(registry.mutex);
+        uint64_t generation = registry.generation.load(std::memory_order_acquire);
+
+        Stats stats;
+        for (const auto& pBuffer : registry.buffers)
+        {
+            // Buffers that have not recorded anything since the capture started still hold stale events.
+            if (pBuffer->generation.load(std::memory_order_acquire) != generation) continue;
+            size_t count = pBuffer->count.load(std::memory_order_acquire);
+            if (count == 0) continue;
+            stats.threadCount++;
+            stats.eventCount += count;
+            stats.droppedCount += pBuffer->dropped.load(std::memory_order_relaxed);
+        }
+        return stats;
+    }
+
+    std::string TraceProfiler::toChromeTraceJson()
+    {
+        auto& registry = getRegistry();
+        std::lock_guard<std::mutex> lock(registry.mutex);
+        uint64_t generation = registry.generation.load(std::memory_order_acquire);
+        uint64_t startTimestamp = registry.startTimestamp;
+
+        // Calibrate the timestamp counter against the system clock over the duration since the capture started.
+        uint64_t elapsedNs = getTimeNs() - registry.startTimeNs;
+        uint64_t elapsedTicks = getTimestamp() - startTimestamp;
+        double nsPerTick = elapsedTicks > 0 ? (double)elapsedNs / elapsedTicks : 1.0;
+
+        std::ostringstream os;
+        os << std::fixed << std::setprecision(3);
+        os << "{\n\"displayTimeUnit\": \"ns\",\n\"traceEvents\": [\n";
+
+        bool first = true;
+        auto beginEvent = [&] ()
+        {
+            if (!first) os << ",\n";
+            first = false;
+        };
+
+        // Timestamps are in microseconds relative to the start of the capture.
+        auto toMicroseconds = [&] (uint64_t timestamp)
+        {
+            return (double)(int64_t)(timestamp - startTimestamp) * nsPerTick * 1e-3;
+        };
+
+        for (const auto& pBuffer : registry.buffers)
+        {
+            if (pBuffer->generation.load(std::memory_order_acquire) != generation) continue;
+            size_t count = pBuffer->count.load(std::memory_order_acquire);
+            if (count == 0) continue;
+
+            uint32_t tid = pBuffer->threadIndex;
+
+            beginEvent();
+            os << "{\"ph\": \"M\", \"name\": \"thread_name\", \"pid\": 0, \"tid\": " << tid << ", \"args\": {\"name\": ";
+            writeJsonString(os, pBuffer->name.c_str());
+            os << "}}";
+            beginEvent();
+            os << "{\"ph\": \"M\", \"name\": \"thread_sort_index\", \"pid\": 0, \"tid\": " << tid << ", \"args\": {\"sort_index\": " << tid << "}}";
+
+            for (size_t i = 0; i < count; ++i)
+            {
+                const Event& event = pBuffer->chunks[i / kChunkSize].load(std::memory_order_acquire)[i % kChunkSize];
+
+                beginEvent();
+                os << "{\"name\": ";
+                writeJsonString(os, event.name);
+                switch (event.type)
+                {
+                case EventType::Zone:
+                    os << ", \"cat\": \"cpu\", \"ph\": \"X\", \"ts\": " << toMicroseconds(event.begin) << ", \"dur\": " << (event.end - event.begin) * nsPerTick * 1e-3;
+                    break;
+                case EventType::FlowBegin:
+                    os << ", \"cat\": \"flow\", \"ph\": \"s\", \"id\": " << event.flowID << ", \"ts\": " << toMicroseconds(event.begin);
+                    break;
+                case EventType::FlowEnd:
+                    os << ", \"cat\": \"flow\", \"ph\": \"f\", \"bp\": \"e\", \"id\": " << event.flowID << ", \"ts\": " << toMicroseconds(event.begin);
+                    break;
+                }
+                os << ", \"pid\": 0, \"tid\": " << tid << "}";
+            }
+        }
+
+        os << "\n]\n}\n";
+        return os.str();
+    }
+
+    bool TraceProfiler::writeChromeTrace(const std::filesystem::path& path)
+    {
+        std::ofstream ofs(path);
+        if (!ofs.good())
+        {
+            logWarning("TraceProfiler::writeChromeTrace() - Failed to open file '" + path.string() + "'.");
+            return false;
+        }
+        ofs << toChromeTraceJson();
+        return ofs.good();
+    }
+}
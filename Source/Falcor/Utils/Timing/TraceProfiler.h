@@ -0,0 +1,165 @@
+/***************************************************************************
+ # Copyright (c) 2015-21, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#pragma once
+#include <atomic>
+#include <filesystem>
+#include <intrin.h>
+
+namespace Falcor
+{
+    /** Low-overhead hierarchical CPU trace recorder that can be used from any thread.
+
+        Unlike the Profiler, which aggregates named events recorded on the main thread, the trace
+        profiler records individual zones with their begin and end times. Every thread appends to its
+        own event buffer, so recording a zone takes no locks and threads never contend with each other.
+        Captures are exported in the Chrome trace-event format (chrome://tracing or ui.perfetto.dev)
+        with one lane per thread.
+
+        Zones are typically recorded with the TRACE_ZONE macro. Zone names are stored by pointer and
+        must outlive the capture (string literals, or names returned by internName()).
+        Work handed from one thread to another can be connected with flow arrows by calling
+        flowBegin() on the producing thread and flowEnd() on the consuming thread with the same ID.
+
+        Events are only recorded while a capture is running. When not capturing, a zone costs a single
+        relaxed atomic load.
+    */
+    class dlldecl TraceProfiler
+    {
+    public:
+        static const size_t kMaxEventsPerThread = 1 << 20;  ///< Events recorded beyond this count are dropped.
+
+        struct Stats
+        {
+            size_t threadCount = 0;     ///< Number of threads that recorded events in the current capture.
+            size_t eventCount = 0;      ///< Number of recorded events.
+            size_t droppedCount = 0;    ///< Number of events dropped because a thread buffer was full.
+        };
+
+        /** Start a new capture. Events from a previous capture are discarded.
+            Must not be called while toChromeTraceJson() or writeChromeTrace() are running.
+        */
+        static void start();
+
+        /** Stop the current capture. Zones that end after this call are not recorded.
+        */
+        static void stop();
+
+        /** Check if a capture is running.
+        */
+        static bool isCapturing() { return sCapturing.load(std::memory_order_relaxed); }
+
+        /** Get the current timestamp.
+            Timestamps are read from the CPU timestamp counter, which is much cheaper than querying
+            the system clock, and are converted to time when the capture is exported.
+        */
+        static uint64_t getTimestamp() { return __rdtsc(); }
+
+        /** Record a completed zone on the calling thread.
+            \param[in] name Zone name. Must outlive the capture.
+            \param[in] begin Begin timestamp from getTimestamp().
+            \param[in] end End timestamp from getTimestamp().
+        */
+        static void recordZone(const char* name, uint64_t begin, uint64_t end);
+
+        /** Set the name of the calling thread's lane in the exported trace.
+        */
+        static void setThreadName(const std::string& name);
+
+        /** Allocate a new unique flow ID.
+        */
+        static uint64_t newFlowID();
+
+        /** Record the start of a flow arrow on the calling thread.
+            The arrow originates from the innermost zone enclosing this call.
+            \param[in] id Flow ID from newFlowID().
+            \param[in] name Flow name. Must outlive the capture.
+        */
+        static void flowBegin(uint64_t id, const char* name = "flow");
+
+        /** Record the end of a flow arrow on the calling thread.
+            The arrow terminates at the innermost zone enclosing this call.
+            \param[in] id Flow ID passed to flowBegin().
+            \param[in] name Flow name. Must outlive the capture.
+        */
+        static void flowEnd(uint64_t id, const char* name = "flow");
+
+        /** Return a pointer to a persistent copy of a name, for zones with dynamic names.
+            This takes a lock and should not be used on hot paths.
+        */
+        static const char* internName(const std::string& name);
+
+        /** Get statistics about the current capture.
+        */
+        static Stats getStats();
+
+        /** Export the recorded events in the Chrome trace-event JSON format.
+        */
+        static std::string toChromeTraceJson();
+
+        /** Write the recorded events to a file in the Chrome trace-event JSON format.
+            \param[in] path File path.
+            \return True if successful.
+        */
+        static bool writeChromeTrace(const std::filesystem::path& path);
+
+    private:
+        TraceProfiler() = default;
+
+        static std::atomic<bool> sCapturing;
+    };
+
+    /** Scoped trace zone. Records a zone from construction to destruction if a capture is running.
+        Use the TRACE_ZONE macro instead of creating TraceZone objects directly.
+    */
+    class TraceZone
+    {
+    public:
+        TraceZone(const char* name)
+            : mName(name)
+            , mActive(TraceProfiler::isCapturing())
+        {
+            if (mActive) mBegin = TraceProfiler::getTimestamp();
+        }
+
+        ~TraceZone()
+        {
+            if (mActive) TraceProfiler::recordZone(mName, mBegin, TraceProfiler::getTimestamp());
+        }
+
+    private:
+        const char* mName;
+        uint64_t mBegin = 0;
+        bool mActive;
+    };
+
+#if _PROFILING_ENABLED
+#define TRACE_ZONE(_name) Falcor::TraceZone concat_strings(_traceZone, __LINE__)(_name)
+#else
+#define TRACE_ZONE(_name)
+#endif
+}
@@ -119,6 +119,9 @@ namespace Mogwai
 
     void CaptureTrigger::endFrame(RenderContext* pRenderContext, const Fbo::SharedPtr& pTargetFbo)
     {
+        // Write out captures from previous frames that have finished on the GPU.
+        mpCapture->update();
+
         if (!mCurrent.pGraph) return;
         uint64_t frameId = gpFramework->getGlobalClock().getFrame();
         const auto& ranges = mGraphRanges.at(mCurrent.pGraph);
@@ -142,6 +145,16 @@ namespace Mogwai
         }
     }
 
+    void CaptureTrigger::shutdown()
+    {
+        if (mCurrent.pGraph)
+        {
+            endRange(mCurrent.pGraph, mCurrent.range);
+            mCurrent = {};
+        }
+        mpCapture->flush();
+    }
+
     void CaptureTrigger::renderUI(Gui::Window& w)
     {
         w.textbox("Base Filename", mBaseFilename);
@@ -27,6 +27,7 @@
  **************************************************************************/
 #pragma once
 #include "../../Mogwai.h"
+#include "Utils/Image/AsyncFrameCapture.h"
 
 namespace Mogwai
 {
@@ -42,8 +43,9 @@ namespace Mogwai
         virtual void toggleWindow() override { mShowUI = !mShowUI; }
         virtual void registerScriptBindings(pybind11::module& m) override;
         virtual void activeGraphChanged(RenderGraph* pNewGraph, RenderGraph* pPrevGraph) override;
+        virtual void shutdown() override;
     protected:
-        CaptureTrigger(Renderer* pRenderer, const std::string& name) : Extension(pRenderer, name) {}
+        CaptureTrigger(Renderer* pRenderer, const std::string& name) : Extension(pRenderer, name), mpCapture(AsyncFrameCapture::create()) {}
 
         using Range = std::pair<uint64_t, uint64_t>; // Start frame and count
 
@@ -72,6 +74,8 @@ namespace Mogwai
         std::string mOutputDir = ".";
         bool mShowUI = false;
 
+        AsyncFrameCapture::UniquePtr mpCapture;     ///< Readback and writing of captured frames off the render thread.
+
         struct
         {
             RenderGraph* pGraph = nullptr;
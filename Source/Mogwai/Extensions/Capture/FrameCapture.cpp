@@ -133,13 +133,13 @@ namespace Mogwai
 
         for (uint32_t i = 0 ; i < pGraph->getOutputCount() ; i++)
         {
-            Texture* pTex = pGraph->getOutput(i)->asTexture().get();
+            Texture::SharedPtr pTex = pGraph->getOutput(i)->asTexture();
             assert(pTex);
             auto ext = Bitmap::getFileExtFromResourceFormat(pTex->getFormat());
             auto format = Bitmap::getFormatFromFileExtension(ext);
             std::string filename = addFrameSuffix ? getOutputNamePrefix(pGraph->getOutputName(i)) + std::to_string(gpFramework->getGlobalClock().getFrame()) + "." + ext :
                                                     getOutputNamePrefix(pGraph->getOutputName(i)) + ext;
-            pTex->captureToFile(0, 0, filename, format);
+            mpCapture->captureToFile(pCtx, pTex, 0, 0, filename, format);
         }
 
         if (mCaptureAllOutputs && !unmarkedOutputs.empty())
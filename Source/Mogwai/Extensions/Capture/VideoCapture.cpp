@@ -113,6 +113,8 @@ namespace Mogwai
 
     void VideoCapture::endRange(RenderGraph* pGraph, const Range& r)
     {
+        // Wait for all frames to be appended before finalizing the videos.
+        mpCapture->flush();
         for (const auto& e : mEncoders) e.pEncoder->endCapture();
     }
 
@@ -127,7 +129,7 @@ namespace Mogwai
                 pTex = e.pBlitTex;
             }
 
-            e.pEncoder->appendFrame(pCtx->readTextureSubresource(pTex.get(), 0).data());
+            mpCapture->captureVideoFrame(pCtx, pTex, e.pEncoder.get());
         }
     }
 
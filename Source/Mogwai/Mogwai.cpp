@@ -73,6 +73,7 @@ namespace Mogwai
     void Renderer::onShutdown()
     {
         resetEditor();
+        for (auto& pe : mpExtensions) pe->shutdown();
         gpDevice->flushAndSync(); // Need to do that because clearing the graphs will try to release some state objects which might be in use
         mGraphs.clear();
     }
@@ -57,6 +57,7 @@ namespace Mogwai
         virtual void addGraph(RenderGraph* pGraph) {};
         virtual void removeGraph(RenderGraph* pGraph) {};
         virtual void activeGraphChanged(RenderGraph* pNewGraph, RenderGraph* pPrevGraph) {};
+        virtual void shutdown() {};     ///< Called before the renderer shuts down, while the device is still valid.
 
     protected:
         Extension(Renderer* pRenderer, const std::string& name) : mpRenderer(pRenderer), mName(name) {}
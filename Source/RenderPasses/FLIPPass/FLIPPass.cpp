@@ -199,73 +199,17 @@ void FLIPPass::updatePrograms()
     mRecompile = false;
 }
 
-static void solveSecondDegree(const float a, const float b, float c, float& xMin, float& xMax)
-{
-    //  Solve a * x^2 + b * x + c = 0.
-    if (a == 0.0f)
-    {
-        xMin = xMax = -c / b;
-        return;
-    }
-
-    float d1 = -0.5f * (b / a);
-    float d2 = std::sqrtf((d1 * d1) - (c / a));
-    xMin = d1 - d2;
-    xMax = d1 + d2;
-}
-
-// At some point, we want to replace this with a compute pass. The BitonicSort needs to be updated so it can handle
-// large amounts of floatintpoint numbers.
-static void computeMedianMax(const float* values, const uint32_t numValues, float& median, float& max)
-{
-    std::vector<float> sortedValues(values, values + numValues);
-    std::sort(sortedValues.begin(), sortedValues.end());
-    if (numValues & 1)      // Odd number of values.
-    {
-        median = sortedValues[numValues / 2];
-    }
-    else                    // Even number of values.
-    {
-        uint32_t medianLocation = numValues / 2 - 1;
-        median = (sortedValues[medianLocation] + sortedValues[medianLocation + 1]) * 0.5f;
-    }
-    max = sortedValues[numValues - 1];
-}
+static_assert(uint32_t(FLIPToneMapperType::ACES) == uint32_t(FLIP::ToneMapper::ACES));
+static_assert(uint32_t(FLIPToneMapperType::Hable) == uint32_t(FLIP::ToneMapper::Hable));
+static_assert(uint32_t(FLIPToneMapperType::Reinhard) == uint32_t(FLIP::ToneMapper::Reinhard));
 
 void FLIPPass::computeExposureParameters(const float Ymedian, const float Ymax)
 {
-    std::vector<float> tmCoefficients;
-    if (mToneMapper == FLIPToneMapperType::Reinhard)
-    {
-        tmCoefficients = { 0.0f, 1.0f, 0.0f, 0.0f, 1.0f, 1.0f };
-    }
-    else if (mToneMapper == FLIPToneMapperType::ACES)
-    {
-        tmCoefficients = { 0.6f * 0.6f * 2.51f, 0.6f * 0.03f, 0.0f, 0.6f * 0.6f * 2.43f, 0.6f * 0.59f, 0.14f };  // 0.6 is pre-exposure cancellation.
-    }
-    else if (mToneMapper == FLIPToneMapperType::Hable)
-    {
-        tmCoefficients = { 0.231683f, 0.013791f, 0.0f, 0.18f, 0.3f, 0.018f };
-    }
-    else
-    {
-        should_not_get_here();
-    }
-
-    const float t = 0.85f;
-    const float a = tmCoefficients[0] - t * tmCoefficients[3];
-    const float b = tmCoefficients[1] - t * tmCoefficients[4];
-    const float c = tmCoefficients[2] - t * tmCoefficients[5];
-
-    float xMin = 0.0f;
-    float xMax = 0.0f;
-    solveSecondDegree(a, b, c, xMin, xMax);
-
-    mStartExposure = std::log2(xMax / Ymax);
-    float stopExposure = std::log2(xMax / Ymedian);
-
-    mNumExposures = uint32_t(std::max(2.0f, std::ceil(stopExposure - mStartExposure)));
-    mExposureDelta = (stopExposure - mStartExposure) / (mNumExposures - 1.0f);
+    // Shared with the CPU implementation of FLIP.
+    auto exposures = FLIP::computeExposureParameters(FLIP::ToneMapper(mToneMapper), Ymedian, Ymax);
+    mStartExposure = exposures.startExposure;
+    mExposureDelta = exposures.exposureDelta;
+    mNumExposures = exposures.numExposures;
 }
 
 void FLIPPass::execute(RenderContext* pRenderContext, const RenderData& renderData)
@@ -335,7 +279,7 @@ void FLIPPass::execute(RenderContext* pRenderContext, const RenderData& renderDa
 
         float Ymedian, Ymax;
         const float* luminanceValues = (float*)mpLuminance->map(Buffer::MapType::Read);
-        computeMedianMax(luminanceValues, outputResolution.x * outputResolution.y, Ymedian, Ymax);
+        FLIP::computeMedianMax(luminanceValues, outputResolution.x * outputResolution.y, Ymedian, Ymax);
         mpLuminance->unmap();
 
         computeExposureParameters(Ymedian, Ymax);
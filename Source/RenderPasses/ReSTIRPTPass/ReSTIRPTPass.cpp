@@ -3,6 +3,7 @@
  **************************************************************************/
 #include "ReSTIRPTPass.h"
 #include "RenderGraph/RenderPassHelpers.h"
+#include "Utils/SampleGenerators/NRooksPatterns.h"
 #include <fstream>
 
 namespace
@@ -139,6 +140,9 @@ namespace
         { (uint32_t)PathSamplingMode::PathTracing, "Path Tracing" }
     };
 
+    // ReSTIR keeps a full-frame temporal reservoir buffer per sample. The sample count is limited so that these buffers fit in this budget.
+    const uint64_t kMaxTemporalReservoirMemory = 2ull << 30;
+
     // Scripting options.
     const std::string kSamplesPerPixel = "samplesPerPixel";
     const std::string kMaxSurfaceBounces = "maxSurfaceBounces";
@@ -192,13 +196,61 @@ namespace
     const std::string kFeatureBasedRejection = "featureBasedRejection";
     const std::string kSpatialReusePattern = "spatialReusePattern";
     const std::string kSmallWindowRestirWindowRadius = "smallWindowRestirWindowRadius";
+    const std::string kNRooksPatternCount = "nRooksPatternCount";
+    const std::string kOptimizeNRooksPatterns = "optimizeNRooksPatterns";
     const std::string kSpatialReuseRadius = "spatialReuseRadius";
     const std::string kUseDirectLighting = "useDirectLighting";
     const std::string kSeparatePathBSDF = "separatePathBSDF";
     const std::string kCandidateSamples = "candidateSamples";
     const std::string kTemporalUpdateForDynamicScene = "temporalUpdateForDynamicScene";
+    const std::string kCompressReservoirs = "compressReservoirs";
     const std::string kEnableRayStats = "enableRayStats";
 
+    // Pre-resolved handles for the shader variables that are set every frame.
+    namespace ShaderVars
+    {
+        const ShaderVarHandle envMapSampler("envMapSampler");
+        const ShaderVarHandle params("params");
+        const ShaderVarHandle vbuffer("vbuffer");
+        const ShaderVarHandle outputColor("outputColor");
+        const ShaderVarHandle outputNRD("outputNRD");
+        const ShaderVarHandle outputNRDDiffuseRadianceHitDist("outputNRDDiffuseRadianceHitDist");
+        const ShaderVarHandle outputNRDSpecularRadianceHitDist("outputNRDSpecularRadianceHitDist");
+        const ShaderVarHandle outputNRDResidualRadianceHitDist("outputNRDResidualRadianceHitDist");
+        const ShaderVarHandle isLastRound("isLastRound");
+        const ShaderVarHandle useDirectLighting("useDirectLighting");
+        const ShaderVarHandle kUseEnvLight("kUseEnvLight");
+        const ShaderVarHandle kUseEmissiveLights("kUseEmissiveLights");
+        const ShaderVarHandle kUseAnalyticLights("kUseAnalyticLights");
+        const ShaderVarHandle kUseEnvBackground("kUseEnvBackground");
+        const ShaderVarHandle emissiveSampler("emissiveSampler");
+        const ShaderVarHandle outputDebug("outputDebug");
+        const ShaderVarHandle outputTime("outputTime");
+        const ShaderVarHandle outputReservoirs("outputReservoirs");
+        const ShaderVarHandle nRooksPattern("nRooksPattern");
+        const ShaderVarHandle misWeightBuffer("misWeightBuffer");
+        const ShaderVarHandle temporalReservoirs("temporalReservoirs");
+        const ShaderVarHandle reconnectionDataBuffer("reconnectionDataBuffer");
+        const ShaderVarHandle gNumSpatialRounds("gNumSpatialRounds");
+        const ShaderVarHandle temporalVbuffer("temporalVbuffer");
+        const ShaderVarHandle motionVectors("motionVectors");
+        const ShaderVarHandle gEnableTemporalReprojection("gEnableTemporalReprojection");
+        const ShaderVarHandle gNoResamplingForTemporalReuse("gNoResamplingForTemporalReuse");
+        const ShaderVarHandle gTemporalHistoryLength("gTemporalHistoryLength");
+        const ShaderVarHandle gSpatialReusePattern("gSpatialReusePattern");
+        const ShaderVarHandle gNRooksPatternCount("gNRooksPatternCount");
+        const ShaderVarHandle gNeighborCount("gNeighborCount");
+        const ShaderVarHandle gGatherRadius("gGatherRadius");
+        const ShaderVarHandle gSpatialRoundId("gSpatialRoundId");
+        const ShaderVarHandle gSmallWindowRadius("gSmallWindowRadius");
+        const ShaderVarHandle gFeatureBasedRejection("gFeatureBasedRejection");
+        const ShaderVarHandle neighborOffsets("neighborOffsets");
+        const ShaderVarHandle primaryHitEmission("primaryHitEmission");
+        const ShaderVarHandle gSppId("gSppId");
+        const ShaderVarHandle directLighting("directLighting");
+        const ShaderVarHandle gIsLastRound("gIsLastRound");
+    }
+
     const uint32_t kNeighborOffsetCount = 8192;
 }
 
@@ -301,25 +353,15 @@ ReSTIRPTPass::ReSTIRPTPass(const Dictionary& dict)
     parseDictionary(dict);
     validateOptions();
 
-    // load N-rook patterns (for Bekaert-style path reuse)
-
-    std::string fullpath;
-    findFileInDataDirectories("16RooksPattern256.txt", fullpath);
-    FILE* f = fopen(fullpath.c_str(), "r");
-
-    std::vector<byte> NRookArray(65536);
-    for (int i = 0; i < 8192; i++)
-    {
-        for (int j = 0; j < 8; j++)
-        {
-            int temp1, temp2;
-            fscanf(f, "%d %d", &temp1, &temp2);
-            NRookArray[8 * i + j] = (temp2 << 4) | temp1;
-        }
-    }
-    fclose(f);
-
-    mNRooksPatternBuffer = Buffer::create(65536, ResourceBindFlags::ShaderResource, Buffer::CpuAccess::None, NRookArray.data());
+    // Generate N-rooks patterns (for Bekaert-style path reuse).
+    // The shaders address the patterns as 16x16 blocks with 4-bit entries, so the size is fixed here.
+    NRooksPatterns::Desc nRooksDesc;
+    nRooksDesc.size = 16;
+    nRooksDesc.patternCount = mNRooksPatternCount;
+    nRooksDesc.optimization = mOptimizeNRooksPatterns ? NRooksPatterns::Optimization::MinDistance : NRooksPatterns::Optimization::None;
+    auto pNRooksPatterns = NRooksPatterns::create(nRooksDesc);
+    auto nRooksData = pNRooksPatterns->getPackedData();
+    mNRooksPatternBuffer = Buffer::create(nRooksData.size(), ResourceBindFlags::ShaderResource, Buffer::CpuAccess::None, nRooksData.data());
 
     // Create sample generator.
     mpSampleGenerator = SampleGenerator::create(mStaticParams.sampleGenerator);
@@ -434,11 +476,14 @@ bool ReSTIRPTPass::parseDictionary(const Dictionary& dict)
         else if (key == kFeatureBasedRejection) mFeatureBasedRejection = value;
         else if (key == kSpatialReusePattern) mSpatialReusePattern = value;
         else if (key == kSmallWindowRestirWindowRadius) mSmallWindowRestirWindowRadius = value;
+        else if (key == kNRooksPatternCount) mNRooksPatternCount = value;
+        else if (key == kOptimizeNRooksPatterns) mOptimizeNRooksPatterns = value;
         else if (key == kSpatialReuseRadius) mSpatialReuseRadius = value;
         else if (key == kUseDirectLighting) mUseDirectLighting = value;
         else if (key == kSeparatePathBSDF) mStaticParams.separatePathBSDF = value;
         else if (key == kCandidateSamples) mStaticParams.candidateSamples = value;
         else if (key == kTemporalUpdateForDynamicScene) mStaticParams.temporalUpdateForDynamicScene = value;
+        else if (key == kCompressReservoirs) mStaticParams.compressReservoirs = value;
         else if (key == kEnableRayStats) mEnableRayStats = value;
         else logWarning("Unknown field '" + key + "' in ReSTIRPTPass dictionary");
     }
@@ -489,6 +534,7 @@ void ReSTIRPTPass::validateOptions()
     }
 
     // Static parameters.
+    // The limit for the current frame dimensions is applied in getSamplesPerPixel(), so that the requested value is kept.
     if (mStaticParams.samplesPerPixel < 1 || mStaticParams.samplesPerPixel > kMaxSamplesPerPixel)
     {
         logError("'samplesPerPixel' must be in the range [1, " + std::to_string(kMaxSamplesPerPixel) + "]. Clamping to this range.");
@@ -513,6 +559,12 @@ void ReSTIRPTPass::validateOptions()
     uint32_t minSurfaceBounces = std::max(mStaticParams.maxDiffuseBounces, std::max(mStaticParams.maxSpecularBounces, mStaticParams.maxTransmissionBounces));
     mStaticParams.maxSurfaceBounces = std::max(mStaticParams.maxSurfaceBounces, minSurfaceBounces);
 
+    if (mNRooksPatternCount < 1)
+    {
+        logError("'nRooksPatternCount' must be at least 1. Clamping to 1.");
+        mNRooksPatternCount = 1;
+    }
+
     if (mStaticParams.maxTransmissionReflectionDepth > mStaticParams.maxTransmissionBounces)
     {
         logWarning("'maxTransmissionReflectionDepth' exceeds `maxTransmissionBounces`. Clamping to " + std::to_string(mStaticParams.maxTransmissionBounces));
@@ -588,11 +640,14 @@ Dictionary ReSTIRPTPass::getScriptingDictionary()
     d[kFeatureBasedRejection] = mFeatureBasedRejection;
     d[kSpatialReusePattern] = mSpatialReusePattern;
     d[kSmallWindowRestirWindowRadius] = mSmallWindowRestirWindowRadius;
+    d[kNRooksPatternCount] = mNRooksPatternCount;
+    d[kOptimizeNRooksPatterns] = mOptimizeNRooksPatterns;
     d[kSpatialReuseRadius] = mSpatialReuseRadius;
     d[kUseDirectLighting] = mUseDirectLighting;
     d[kSeparatePathBSDF] = mStaticParams.separatePathBSDF;
     d[kCandidateSamples] = mStaticParams.candidateSamples;
     d[kTemporalUpdateForDynamicScene] = mStaticParams.temporalUpdateForDynamicScene;
+    d[kCompressReservoirs] = mStaticParams.compressReservoirs;
     d[kEnableRayStats] = mEnableRayStats;
     // Denoising parameters
     d[kUseNRDDemodulation] = mStaticParams.useNRDDemodulation;
@@ -627,6 +682,19 @@ void ReSTIRPTPass::compile(RenderContext* pContext, const CompileData& compileDa
         logError("Frame dimensions up to " + std::to_string(kMaxFrameDimension) + " pixels width/height are supported.");
     }
 
+    // Select the path ID encoding for the frame dimensions.
+    // Larger frames need more bits per pixel coordinate, which lowers the supported sample count.
+    uint32_t pathIDPixelBits = getPathIDPixelBits(mParams.frameDim);
+    if (pathIDPixelBits != mStaticParams.pathIDPixelBits)
+    {
+        mStaticParams.pathIDPixelBits = pathIDPixelBits;
+        mRecompile = true;
+    }
+    if (getSamplesPerPixel() < mStaticParams.samplesPerPixel)
+    {
+        logWarning("'samplesPerPixel' exceeds the maximum of " + std::to_string(getMaxSamplesPerPixel()) + " supported at the current frame dimensions and memory budget. Using " + std::to_string(getSamplesPerPixel()) + " samples per pixel.");
+    }
+
     // Tile dimensions have to be powers-of-two.
     assert(isPowerOf2(kScreenTileDim.x) && isPowerOf2(kScreenTileDim.y));
     assert(kScreenTileDim.x == (1 << kScreenTileBits.x) && kScreenTileDim.y == (1 << kScreenTileBits.y));
@@ -693,7 +761,7 @@ void ReSTIRPTPass::execute(RenderContext* pRenderContext, const RenderData& rend
         mStaticParams.temporalMisKind = ReSTIRMISKind::Talbot;
     }
 
-    uint32_t numPasses = mStaticParams.pathSamplingMode == PathSamplingMode::PathTracing ? 1 : mStaticParams.samplesPerPixel;
+    uint32_t numPasses = mStaticParams.pathSamplingMode == PathSamplingMode::PathTracing ? 1 : getSamplesPerPixel();
 
     for (uint32_t restir_i = 0; restir_i < numPasses; restir_i++)
     {
@@ -801,6 +869,31 @@ void ReSTIRPTPass::renderUI(Gui::Widgets& widget)
     }
 }
 
+uint32_t ReSTIRPTPass::getMaxSamplesPerPixel() const
+{
+    uint32_t maxSamplesPerPixel = std::min(kMaxSamplesPerPixel, getPathIDMaxSamplesPerPixel(getPathIDPixelBits(mParams.frameDim)));
+
+    // Each sample has its own temporal reservoir buffer in ReSTIR mode, see prepareResources().
+    if (mStaticParams.pathSamplingMode == PathSamplingMode::ReSTIR)
+    {
+        const uint2 screenTiles = div_round_up(mParams.frameDim, kScreenTileDim);
+        const uint64_t bufferSize = (uint64_t)screenTiles.x * screenTiles.y * kScreenTileDim.x * kScreenTileDim.y * getBaseReservoirSize();
+        if (bufferSize > 0) maxSamplesPerPixel = std::min(maxSamplesPerPixel, (uint32_t)std::max<uint64_t>(1, kMaxTemporalReservoirMemory / bufferSize));
+    }
+    return maxSamplesPerPixel;
+}
+
+uint32_t ReSTIRPTPass::getBaseReservoirSize() const
+{
+    return mStaticParams.compressReservoirs ? (uint32_t)sizeof(PackedPathReservoir) : 88;
+}
+
+uint32_t ReSTIRPTPass::getSamplesPerPixel() const
+{
+    // The requested value is clamped per frame and not modified, so that it is restored when the frame dimensions shrink again.
+    return std::min(mStaticParams.samplesPerPixel, getMaxSamplesPerPixel());
+}
+
 Texture::SharedPtr ReSTIRPTPass::createNeighborOffsetTexture(uint32_t sampleCount)
 {
     std::unique_ptr<int8_t[]> offsets(new int8_t[sampleCount * 2]);
@@ -963,11 +1056,18 @@ bool ReSTIRPTPass::renderRenderingUI(Gui::Widgets& widget)
 
         dirty |= widget.var("Samples/pixel", mStaticParams.samplesPerPixel, 1u, kMaxSamplesPerPixel);
 
-        widget.tooltip("Number of samples per pixel. One path is traced for each sample.\n");
+        widget.tooltip("Number of samples per pixel. One path is traced for each sample.\n"
+            "The maximum depends on the frame dimensions, since the path ID encodes both the pixel and the sample index.\n"
+            "In ReSTIR mode it is also limited by the memory of the per-sample temporal reservoirs.");
+        if (getSamplesPerPixel() < mStaticParams.samplesPerPixel) widget.text("Using " + std::to_string(getSamplesPerPixel()) + " samples/pixel at the current frame dimensions and memory budget.");
 
         dirty |= widget.checkbox("Use Sampled BSDFs", mStaticParams.separatePathBSDF);
         widget.tooltip("Control whether to use mixture BSDF or sampled BSDF in path tracing/path reuse.\n");
 
+        dirty |= widget.checkbox("Compress Reservoirs", mStaticParams.compressReservoirs);
+        widget.tooltip("Store reservoirs, reconnection data and path reuse MIS weights in packed formats.\n"
+            "Reduces memory and bandwidth of the reuse passes at the cost of a small quantization error.\n");
+
         if (widget.var("Max bounces (override all)", mStaticParams.maxSurfaceBounces, 0u, kMaxBounces))
         {
             // Allow users to change the max surface bounce parameter in the UI to clamp all other surface bounce parameters.
@@ -1198,9 +1298,15 @@ void ReSTIRPTPass::prepareResources(RenderContext* pRenderContext, const RenderD
     if (mStaticParams.pathSamplingMode != PathSamplingMode::PathTracing)
     {
 
-        if (mStaticParams.shiftStrategy == ShiftMapping::Hybrid && (!mReconnectionDataBuffer ||
-            mStaticParams.rcDataOfflineMode && mReconnectionDataBuffer->getElementSize() != 512 ||
-            !mStaticParams.rcDataOfflineMode && mReconnectionDataBuffer->getElementSize() != 256))
+        // Expected element sizes, used to detect layout changes that require reallocation.
+        const bool compress = mStaticParams.compressReservoirs;
+        const uint32_t rcDataPathCount = mStaticParams.rcDataOfflineMode ? 12 : 6;
+        const uint32_t rcDataSize = compress ? rcDataPathCount * (uint32_t)sizeof(PackedReconnectionData) : (mStaticParams.rcDataOfflineMode ? 512 : 256);
+        const uint32_t baseReservoirSize = getBaseReservoirSize();
+        const uint32_t pathTreeReservoirSize = compress ? (uint32_t)sizeof(PackedPathReservoirBPR) : 128;
+        const uint32_t misWeightSize = compress ? (uint32_t)sizeof(PackedPathReuseMISWeight) : 2 * sizeof(float);
+
+        if (mStaticParams.shiftStrategy == ShiftMapping::Hybrid && (!mReconnectionDataBuffer || mReconnectionDataBuffer->getElementSize() != rcDataSize))
         {
             mReconnectionDataBuffer = Buffer::createStructured(var["reconnectionDataBuffer"], reservoirCount, Resource::BindFlags::ShaderResource | Resource::BindFlags::UnorderedAccess, Buffer::CpuAccess::None, nullptr, false);
             //printf("rcDataSize size: %d\n", mReconnectionDataBuffer->getElementSize());
@@ -1208,21 +1314,18 @@ void ReSTIRPTPass::prepareResources(RenderContext* pRenderContext, const RenderD
         if (mStaticParams.shiftStrategy != ShiftMapping::Hybrid)
             mReconnectionDataBuffer = nullptr;
 
-        uint32_t baseReservoirSize = 88;
-        uint32_t pathTreeReservoirSize = 128;
-
         if (mpOutputReservoirs &&
             (mStaticParams.pathSamplingMode == PathSamplingMode::PathReuse && mpOutputReservoirs->getElementSize() != pathTreeReservoirSize ||
                 mStaticParams.pathSamplingMode != PathSamplingMode::PathReuse && mpOutputReservoirs->getElementSize() != baseReservoirSize ||
-                mpTemporalReservoirs.size() != mStaticParams.samplesPerPixel && mStaticParams.pathSamplingMode != PathSamplingMode::PathReuse))
+                mpTemporalReservoirs.size() != getSamplesPerPixel() && mStaticParams.pathSamplingMode != PathSamplingMode::PathReuse))
         {
             mpOutputReservoirs = Buffer::createStructured(var["outputReservoirs"], reservoirCount, Resource::BindFlags::ShaderResource | Resource::BindFlags::UnorderedAccess, Buffer::CpuAccess::None, nullptr, false);
             //printf("reservoir size: %d\n", mpOutputReservoirs->getElementSize());
 
             if (mStaticParams.pathSamplingMode != PathSamplingMode::PathReuse)
             {
-                mpTemporalReservoirs.resize(mStaticParams.samplesPerPixel);
-                for (uint32_t i = 0; i < mStaticParams.samplesPerPixel; i++)
+                mpTemporalReservoirs.resize(getSamplesPerPixel());
+                for (uint32_t i = 0; i < getSamplesPerPixel(); i++)
                     mpTemporalReservoirs[i] = Buffer::createStructured(var["outputReservoirs"], reservoirCount, Resource::BindFlags::ShaderResource | Resource::BindFlags::UnorderedAccess, Buffer::CpuAccess::None, nullptr, false);
             }
             mVarsChanged = true;
@@ -1230,7 +1333,7 @@ void ReSTIRPTPass::prepareResources(RenderContext* pRenderContext, const RenderD
 
         if (mStaticParams.pathSamplingMode == PathSamplingMode::PathReuse)
         {
-            if (!mPathReuseMISWeightBuffer)
+            if (!mPathReuseMISWeightBuffer || mPathReuseMISWeightBuffer->getElementSize() != misWeightSize)
             {
                 mPathReuseMISWeightBuffer = Buffer::createStructured(var["misWeightBuffer"], reservoirCount, Resource::BindFlags::ShaderResource | Resource::BindFlags::UnorderedAccess, Buffer::CpuAccess::None, nullptr, false);
                 mVarsChanged = true;
@@ -1251,8 +1354,8 @@ void ReSTIRPTPass::prepareResources(RenderContext* pRenderContext, const RenderD
             }
             else
             {
-                mpTemporalReservoirs.resize(mStaticParams.samplesPerPixel);
-                for (uint32_t i = 0; i < mStaticParams.samplesPerPixel; i++)
+                mpTemporalReservoirs.resize(getSamplesPerPixel());
+                for (uint32_t i = 0; i < getSamplesPerPixel(); i++)
                     mpTemporalReservoirs[i] = Buffer::createStructured(var["outputReservoirs"], reservoirCount, Resource::BindFlags::ShaderResource | Resource::BindFlags::UnorderedAccess, Buffer::CpuAccess::None, nullptr, false);
             }
             mVarsChanged = true;
@@ -1418,41 +1521,41 @@ void ReSTIRPTPass::setShaderData(const ShaderVar& var, const RenderData& renderD
     // Bind static resources that don't change per frame.
     if (mVarsChanged)
     {
-        if (isPathTracer && mpEnvMapSampler) mpEnvMapSampler->setShaderData(var["envMapSampler"]);
+        if (isPathTracer && mpEnvMapSampler) mpEnvMapSampler->setShaderData(var[ShaderVars::envMapSampler]);
     }
 
     // Bind runtime data.
-    var["params"].setBlob(mParams);
-    var["vbuffer"] = renderData[kInputVBuffer]->asTexture();
-    var["outputColor"] = renderData[kOutputColor]->asTexture();
+    var[ShaderVars::params].setBlob(mParams);
+    var[ShaderVars::vbuffer] = renderData[kInputVBuffer]->asTexture();
+    var[ShaderVars::outputColor] = renderData[kOutputColor]->asTexture();
 
 
     if (mOutputNRDData && isPathTracer)
     {
-        setNRDData(var["outputNRD"], renderData);
-        var["outputNRDDiffuseRadianceHitDist"] = renderData[kOutputNRDDiffuseRadianceHitDist]->asTexture();    ///< Output resolved diffuse color in .rgb and hit distance in .a for NRD. Only valid if kOutputNRDData == true.
-        var["outputNRDSpecularRadianceHitDist"] = renderData[kOutputNRDSpecularRadianceHitDist]->asTexture();  ///< Output resolved specular color in .rgb and hit distance in .a for NRD. Only valid if kOutputNRDData == true.
-        var["outputNRDResidualRadianceHitDist"] = renderData[kOutputNRDResidualRadianceHitDist]->asTexture();///< Output resolved residual color in .rgb and hit distance in .a for NRD. Only valid if kOutputNRDData == true.
+        setNRDData(var[ShaderVars::outputNRD], renderData);
+        var[ShaderVars::outputNRDDiffuseRadianceHitDist] = renderData[kOutputNRDDiffuseRadianceHitDist]->asTexture();    ///< Output resolved diffuse color in .rgb and hit distance in .a for NRD. Only valid if kOutputNRDData == true.
+        var[ShaderVars::outputNRDSpecularRadianceHitDist] = renderData[kOutputNRDSpecularRadianceHitDist]->asTexture();  ///< Output resolved specular color in .rgb and hit distance in .a for NRD. Only valid if kOutputNRDData == true.
+        var[ShaderVars::outputNRDResidualRadianceHitDist] = renderData[kOutputNRDResidualRadianceHitDist]->asTexture();///< Output resolved residual color in .rgb and hit distance in .a for NRD. Only valid if kOutputNRDData == true.
     }
 
     if (isPathTracer)
     {
-        var["isLastRound"] = !mEnableSpatialReuse && !mEnableTemporalReuse;
-        var["useDirectLighting"] = mUseDirectLighting;
-        var["kUseEnvLight"] = mpScene->useEnvLight();
-        var["kUseEmissiveLights"] = mpScene->useEmissiveLights();
-        var["kUseAnalyticLights"] = mpScene->useAnalyticLights();
+        var[ShaderVars::isLastRound] = !mEnableSpatialReuse && !mEnableTemporalReuse;
+        var[ShaderVars::useDirectLighting] = mUseDirectLighting;
+        var[ShaderVars::kUseEnvLight] = mpScene->useEnvLight();
+        var[ShaderVars::kUseEmissiveLights] = mpScene->useEmissiveLights();
+        var[ShaderVars::kUseAnalyticLights] = mpScene->useAnalyticLights();
     }
     else if (isPathGenerator)
     {
-        var["kUseEnvBackground"] = mpScene->useEnvBackground();
+        var[ShaderVars::kUseEnvBackground] = mpScene->useEnvBackground();
     }
 
-    if (auto outputDebug = var.findMember("outputDebug"); outputDebug.isValid())
+    if (auto outputDebug = ShaderVars::outputDebug.find(var); outputDebug.isValid())
     {
         outputDebug = renderData[kOutputDebug]->asTexture(); // Can be nullptr
     }
-    if (auto outputTime = var.findMember("outputTime"); outputTime.isValid())
+    if (auto outputTime = ShaderVars::outputTime.find(var); outputTime.isValid())
     {
         outputTime = renderData[kOutputTime]->asTexture(); // Can be nullptr
     }
@@ -1460,7 +1563,7 @@ void ReSTIRPTPass::setShaderData(const ShaderVar& var, const RenderData& renderD
     if (isPathTracer && mpEmissiveSampler)
     {
         // TODO: Do we have to bind this every frame?
-        bool success = mpEmissiveSampler->setShaderData(var["emissiveSampler"]);
+        bool success = mpEmissiveSampler->setShaderData(var[ShaderVars::emissiveSampler]);
         if (!success) throw std::exception("Failed to bind emissive light sampler");
     }
 }
@@ -1531,7 +1634,7 @@ bool ReSTIRPTPass::beginFrame(RenderContext* pRenderContext, const RenderData& r
     mpPixelDebug->beginFrame(pRenderContext, renderData.getDefaultTextureDims());
 
     // Update the random seed.
-    int initialShaderPasses = mStaticParams.pathSamplingMode == PathSamplingMode::PathTracing ? 1 : mStaticParams.samplesPerPixel;
+    int initialShaderPasses = mStaticParams.pathSamplingMode == PathSamplingMode::PathTracing ? 1 : getSamplesPerPixel();
     mParams.seed = mParams.useFixedSeed ? mParams.fixedSeed : mSeedOffset + initialShaderPasses * mParams.frameCount;
 
     return true;
@@ -1662,61 +1765,62 @@ void ReSTIRPTPass::PathReusePass(RenderContext* pRenderContext, uint32_t restir_
     // TODO: refactor arguments
     setShaderData(var, renderData, false, false);
 
-    var["outputReservoirs"] = spatialRoundId % 2 == 1 ? mpTemporalReservoirs[restir_i] : mpOutputReservoirs;
+    var[ShaderVars::outputReservoirs] = spatialRoundId % 2 == 1 ? mpTemporalReservoirs[restir_i] : mpOutputReservoirs;
 
     if (mStaticParams.pathSamplingMode == PathSamplingMode::PathReuse)
     {
-        var["nRooksPattern"] = mNRooksPatternBuffer;
+        var[ShaderVars::nRooksPattern] = mNRooksPatternBuffer;
+        var[ShaderVars::gNRooksPatternCount] = mNRooksPatternCount;
     }
 
     if (mStaticParams.pathSamplingMode == PathSamplingMode::PathReuse)
-        var["misWeightBuffer"] = mPathReuseMISWeightBuffer;
+        var[ShaderVars::misWeightBuffer] = mPathReuseMISWeightBuffer;
     else if (!isPathReuseMISWeightComputation)
-        var["temporalReservoirs"] = spatialRoundId % 2 == 0 ? mpTemporalReservoirs[restir_i] : mpOutputReservoirs;
-    var["reconnectionDataBuffer"] = mReconnectionDataBuffer;
+        var[ShaderVars::temporalReservoirs] = spatialRoundId % 2 == 0 ? mpTemporalReservoirs[restir_i] : mpOutputReservoirs;
+    var[ShaderVars::reconnectionDataBuffer] = mReconnectionDataBuffer;
 
-    var["gNumSpatialRounds"] = mNumSpatialRounds;
+    var[ShaderVars::gNumSpatialRounds] = mNumSpatialRounds;
 
     if (isTemporalReuse)
     {
-        var["temporalVbuffer"] = mpTemporalVBuffer;
-        var["motionVectors"] = renderData[kInputMotionVectors]->asTexture();
-        var["gEnableTemporalReprojection"] = mEnableTemporalReprojection;
-        var["gNoResamplingForTemporalReuse"] = mNoResamplingForTemporalReuse;
-        if (!mUseMaxHistory) var["gTemporalHistoryLength"] = 1e30f;
-        else var["gTemporalHistoryLength"] = (float)mTemporalHistoryLength;
+        var[ShaderVars::temporalVbuffer] = mpTemporalVBuffer;
+        var[ShaderVars::motionVectors] = renderData[kInputMotionVectors]->asTexture();
+        var[ShaderVars::gEnableTemporalReprojection] = mEnableTemporalReprojection;
+        var[ShaderVars::gNoResamplingForTemporalReuse] = mNoResamplingForTemporalReuse;
+        if (!mUseMaxHistory) var[ShaderVars::gTemporalHistoryLength] = 1e30f;
+        else var[ShaderVars::gTemporalHistoryLength] = (float)mTemporalHistoryLength;
     }
     else
     {
-        var["gSpatialReusePattern"] = mStaticParams.pathSamplingMode == PathSamplingMode::PathReuse ? (uint32_t)mPathReusePattern : (uint32_t)mSpatialReusePattern;
+        var[ShaderVars::gSpatialReusePattern] = mStaticParams.pathSamplingMode == PathSamplingMode::PathReuse ? (uint32_t)mPathReusePattern : (uint32_t)mSpatialReusePattern;
 
         if (!isPathReuseMISWeightComputation)
         {
-            var["gNeighborCount"] = mSpatialNeighborCount;
-            var["gGatherRadius"] = mSpatialReuseRadius;
-            var["gSpatialRoundId"] = spatialRoundId;
-            var["gSmallWindowRadius"] = mSmallWindowRestirWindowRadius;
-            var["gFeatureBasedRejection"] = mFeatureBasedRejection;
-            var["neighborOffsets"] = mpNeighborOffsets;
+            var[ShaderVars::gNeighborCount] = mSpatialNeighborCount;
+            var[ShaderVars::gGatherRadius] = mSpatialReuseRadius;
+            var[ShaderVars::gSpatialRoundId] = spatialRoundId;
+            var[ShaderVars::gSmallWindowRadius] = mSmallWindowRestirWindowRadius;
+            var[ShaderVars::gFeatureBasedRejection] = mFeatureBasedRejection;
+            var[ShaderVars::neighborOffsets] = mpNeighborOffsets;
         }
 
         if (mOutputNRDData && !isPathReuseMISWeightComputation)
         {
-            var["outputNRDDiffuseRadianceHitDist"] = renderData[kOutputNRDDiffuseRadianceHitDist]->asTexture();
-            var["outputNRDSpecularRadianceHitDist"] = renderData[kOutputNRDSpecularRadianceHitDist]->asTexture();
-            var["outputNRDResidualRadianceHitDist"] = renderData[kOutputNRDResidualRadianceHitDist]->asTexture();
-            var["primaryHitEmission"] = renderData[kOutputNRDEmission]->asTexture();
-            var["gSppId"] = restir_i;
+            var[ShaderVars::outputNRDDiffuseRadianceHitDist] = renderData[kOutputNRDDiffuseRadianceHitDist]->asTexture();
+            var[ShaderVars::outputNRDSpecularRadianceHitDist] = renderData[kOutputNRDSpecularRadianceHitDist]->asTexture();
+            var[ShaderVars::outputNRDResidualRadianceHitDist] = renderData[kOutputNRDResidualRadianceHitDist]->asTexture();
+            var[ShaderVars::primaryHitEmission] = renderData[kOutputNRDEmission]->asTexture();
+            var[ShaderVars::gSppId] = restir_i;
         }
     }
 
 
     if (!isPathReuseMISWeightComputation)
     {
-        var["directLighting"] = renderData[kInputDirectLighting]->asTexture();
-        var["useDirectLighting"] = mUseDirectLighting;
+        var[ShaderVars::directLighting] = renderData[kInputDirectLighting]->asTexture();
+        var[ShaderVars::useDirectLighting] = mUseDirectLighting;
     }
-    var["gIsLastRound"] = mStaticParams.pathSamplingMode == PathSamplingMode::PathReuse || isLastRound;
+    var[ShaderVars::gIsLastRound] = mStaticParams.pathSamplingMode == PathSamplingMode::PathReuse || isLastRound;
 
     pass["gScene"] = mpScene->getParameterBlock();
     pass["gPathTracer"] = mpPathTracerBlock;
@@ -1753,35 +1857,35 @@ void ReSTIRPTPass::PathRetracePass(RenderContext* pRenderContext, uint32_t resti
 
     // TODO: refactor arguments
     setShaderData(var, renderData, false, false);
-    var["outputReservoirs"] = spatialRoundId % 2 == 1 ? mpTemporalReservoirs[restir_i] : mpOutputReservoirs;
+    var[ShaderVars::outputReservoirs] = spatialRoundId % 2 == 1 ? mpTemporalReservoirs[restir_i] : mpOutputReservoirs;
 
     if (mStaticParams.pathSamplingMode == PathSamplingMode::PathReuse)
     {
-        var["nRooksPattern"] = mNRooksPatternBuffer;
+        var[ShaderVars::nRooksPattern] = mNRooksPatternBuffer;
     }
 
-    var["temporalReservoirs"] = spatialRoundId % 2 == 0 ? mpTemporalReservoirs[restir_i] : mpOutputReservoirs;
-    var["reconnectionDataBuffer"] = mReconnectionDataBuffer;
-    var["gNumSpatialRounds"] = mNumSpatialRounds;
+    var[ShaderVars::temporalReservoirs] = spatialRoundId % 2 == 0 ? mpTemporalReservoirs[restir_i] : mpOutputReservoirs;
+    var[ShaderVars::reconnectionDataBuffer] = mReconnectionDataBuffer;
+    var[ShaderVars::gNumSpatialRounds] = mNumSpatialRounds;
 
     if (temporalReuse)
     {
-        var["temporalVbuffer"] = mpTemporalVBuffer;
-        var["motionVectors"] = renderData[kInputMotionVectors]->asTexture();
-        var["gEnableTemporalReprojection"] = mEnableTemporalReprojection;
-        var["gNoResamplingForTemporalReuse"] = mNoResamplingForTemporalReuse;
-        if (!mUseMaxHistory) var["gTemporalHistoryLength"] = 1e30f;
-        else var["gTemporalHistoryLength"] = (float)mTemporalHistoryLength;
+        var[ShaderVars::temporalVbuffer] = mpTemporalVBuffer;
+        var[ShaderVars::motionVectors] = renderData[kInputMotionVectors]->asTexture();
+        var[ShaderVars::gEnableTemporalReprojection] = mEnableTemporalReprojection;
+        var[ShaderVars::gNoResamplingForTemporalReuse] = mNoResamplingForTemporalReuse;
+        if (!mUseMaxHistory) var[ShaderVars::gTemporalHistoryLength] = 1e30f;
+        else var[ShaderVars::gTemporalHistoryLength] = (float)mTemporalHistoryLength;
     }
     else
     {
-        var["gSpatialRoundId"] = spatialRoundId;
-        var["neighborOffsets"] = mpNeighborOffsets;
-        var["gGatherRadius"] = mSpatialReuseRadius;
-        var["gNeighborCount"] = mSpatialNeighborCount;
-        var["gSmallWindowRadius"] = mSmallWindowRestirWindowRadius;
-        var["gSpatialReusePattern"] = mStaticParams.pathSamplingMode == PathSamplingMode::PathReuse ? (uint32_t)mPathReusePattern : (uint32_t)mSpatialReusePattern;
-        var["gFeatureBasedRejection"] = mFeatureBasedRejection;
+        var[ShaderVars::gSpatialRoundId] = spatialRoundId;
+        var[ShaderVars::neighborOffsets] = mpNeighborOffsets;
+        var[ShaderVars::gGatherRadius] = mSpatialReuseRadius;
+        var[ShaderVars::gNeighborCount] = mSpatialNeighborCount;
+        var[ShaderVars::gSmallWindowRadius] = mSmallWindowRestirWindowRadius;
+        var[ShaderVars::gSpatialReusePattern] = mStaticParams.pathSamplingMode == PathSamplingMode::PathReuse ? (uint32_t)mPathReusePattern : (uint32_t)mSpatialReusePattern;
+        var[ShaderVars::gFeatureBasedRejection] = mFeatureBasedRejection;
     }
 
     pass["gScene"] = mpScene->getParameterBlock();
@@ -1802,8 +1906,9 @@ Program::DefineList ReSTIRPTPass::StaticParams::getDefines(const ReSTIRPTPass& o
     Program::DefineList defines;
 
     // Path tracer configuration.
-    defines.add("SAMPLES_PER_PIXEL", std::to_string(samplesPerPixel)); // 0 indicates a variable sample count
+    defines.add("SAMPLES_PER_PIXEL", std::to_string(owner.getSamplesPerPixel())); // 0 indicates a variable sample count
     defines.add("CANDIDATE_SAMPLES", std::to_string(candidateSamples)); // 0 indicates a variable sample count    
+    defines.add("PATH_ID_PIXEL_BITS", std::to_string(pathIDPixelBits));
     defines.add("MAX_SURFACE_BOUNCES", std::to_string(maxSurfaceBounces));
     defines.add("MAX_DIFFUSE_BOUNCES", std::to_string(maxDiffuseBounces));
     defines.add("MAX_SPECULAR_BOUNCES", std::to_string(maxSpecularBounces));
@@ -1862,5 +1967,7 @@ Program::DefineList ReSTIRPTPass::StaticParams::getDefines(const ReSTIRPTPass& o
     defines.add("RCDATA_PATH_NUM", rcDataOfflineMode ? "12" : "6");
     defines.add("RCDATA_PAD_SIZE", rcDataOfflineMode ? "2" : "1");
 
+    defines.add("COMPRESS_RESERVOIRS", compressReservoirs ? "1" : "0");
+
     return defines;
 }
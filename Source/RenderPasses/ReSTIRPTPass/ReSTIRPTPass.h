@@ -15,6 +15,7 @@
 #include "Rendering/Utils/PixelStats.h"
 #include "Rendering/Materials/TexLODTypes.slang"
 #include "Params.slang"
+#include "PackedPathReservoir.slang"
 #include <fstream>
 
 using namespace Falcor;
@@ -68,14 +69,18 @@ private:
     void PathReusePass(RenderContext* pRenderContext, uint32_t restir_i, const RenderData& renderData, bool temporalReuse = false, int spatialRoundId = 0, bool isLastRound = false);
     void PathRetracePass(RenderContext* pRenderContext, uint32_t restir_i, const RenderData& renderData, bool temporalReuse = false, int spatialRoundId = 0);
     Texture::SharedPtr createNeighborOffsetTexture(uint32_t sampleCount);
+    uint32_t getMaxSamplesPerPixel() const;
+    uint32_t getSamplesPerPixel() const;
+    uint32_t getBaseReservoirSize() const;
 
     /** Static configuration. Changing any of these options require shader recompilation.
     */
     struct StaticParams
     {
         // Rendering parameters
-        uint32_t    samplesPerPixel = 1;                        ///< Number of samples (paths) per pixel, unless a sample density map is used.
+        uint32_t    samplesPerPixel = 1;                        ///< Requested number of samples (paths) per pixel, unless a sample density map is used. Limited by the frame dimensions and the temporal reservoir memory, see getSamplesPerPixel().
         uint32_t    candidateSamples = 1;
+        uint32_t    pathIDPixelBits = 12;                       ///< Bits per pixel coordinate in the path ID. This is selected automatically from the frame dimensions.
         uint32_t    maxSurfaceBounces = 9;                      ///< Max number of surface bounces (diffuse + specular + transmission), up to kMaxPathLenth.
         uint32_t    maxDiffuseBounces = -1;                     ///< Max number of diffuse bounces (0 = direct only), up to kMaxBounces. This will be initialized at startup.
         uint32_t    maxSpecularBounces = -1;                    ///< Max number of specular bounces (0 = direct only), up to kMaxBounces. This will be initialized at startup.
@@ -114,6 +119,8 @@ private:
 
         bool            rcDataOfflineMode = false;
 
+        bool            compressReservoirs = false;         ///< Store reservoirs, reconnection data and path reuse MIS weights in packed formats (see PackedPathReservoir.slang).
+
 		// Denoising parameters
 		bool        useNRDDemodulation = true;                  ///< Global switch for NRD demodulation.
 
@@ -173,6 +180,8 @@ private:
     SpatialReusePattern             mSpatialReusePattern = SpatialReusePattern::Default;
     PathReusePattern                mPathReusePattern = PathReusePattern::NRooksShift;
     uint32_t                        mSmallWindowRestirWindowRadius = 2;
+    uint32_t                        mNRooksPatternCount = 256;          ///< Number of N-rooks patterns generated for path reuse. Requires re-creating the pass to take effect.
+    bool                            mOptimizeNRooksPatterns = true;     ///< Optimize the N-rooks patterns for a large minimum distance between rooks.
     int                             mSpatialNeighborCount = 3;
     float                           mSpatialReuseRadius = 20.f;
     int                             mNumSpatialRounds = 1;
@@ -45,15 +45,48 @@ static std::vector<std::string> librariesWithTests =
 */
 static int sReturnCode = 1;
 
-void FalcorTest::onLoad(RenderContext* pRenderContext)
+/** Load all the DLLs so that they can register their tests.
+*/
+static void loadTestLibraries()
 {
-    // Load all the DLLs so that they can register their tests.
     for (const auto& lib : librariesWithTests)
     {
         RenderPassLibrary::instance().loadLibrary(lib);
     }
 }
 
+/** Run the tests without creating a window or GPU device.
+    Only CPU tests are run, GPU tests are reported as skipped. This allows running the tests on machines without a GPU.
+*/
+static int runHeadless(const FalcorTest::Options& options)
+{
+    Logger::showBoxOnError(false);
+    OSServices::start();
+    Threading::start();
+
+    int returnCode = 1;
+    try
+    {
+        loadTestLibraries();
+        returnCode = runTests(std::cout, nullptr, options.filter, options.repeat);
+    }
+    catch (const std::exception& e)
+    {
+        logError("Caught exception:\n\n" + std::string(e.what()));
+    }
+
+    Threading::shutdown();
+    RenderPassLibrary::instance().shutdown();
+    OSServices::stop();
+    Logger::shutdown();
+    return returnCode;
+}
+
+void FalcorTest::onLoad(RenderContext* pRenderContext)
+{
+    loadTestLibraries();
+}
+
 void FalcorTest::onFrameRender(RenderContext* pRenderContext, const Fbo::SharedPtr& pTargetFbo)
 {
     sReturnCode = runTests(std::cout, pRenderContext, mOptions.filter, mOptions.repeat);
@@ -67,6 +100,7 @@ int main(int argc, char** argv)
     args::HelpFlag helpFlag(parser, "help", "Display this help menu.", {'h', "help"});
     args::ValueFlag<std::string> filterFlag(parser, "filter", "Regular expression for filtering tests to run.", {'f', "filter"});
     args::ValueFlag<uint32_t> repeatFlag(parser, "N", "Number of times to repeat the test.", {'r', "repeat"});
+    args::Flag headlessFlag(parser, "headless", "Run CPU tests only, without creating a window or GPU device.", {"headless"});
     args::CompletionFlag completionFlag(parser, {"complete"});
 
     try
@@ -101,6 +135,8 @@ int main(int argc, char** argv)
     if (filterFlag) options.filter = args::get(filterFlag);
     if (repeatFlag) options.repeat = args::get(repeatFlag);
 
+    if (headlessFlag) return runHeadless(options);
+
     FalcorTest::UniquePtr pRenderer = std::make_unique<FalcorTest>(options);
     SampleConfig config;
     config.windowDesc.title = "FalcorTest";
@@ -0,0 +1,126 @@
+/***************************************************************************
+ # Copyright (c) 2015-21, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "Testing/UnitTest.h"
+
+namespace Falcor
+{
+    namespace
+    {
+        const char kShaderFile[] = "Tests/Core/ShaderVarHandleTests.cs.slang";
+
+        const ShaderVarHandle kValue("value");
+        const ShaderVarHandle kParams("params");
+        const ShaderVarHandle kParamsA("params.a");
+        const ShaderVarHandle kParamsB("params.b");
+        const ShaderVarHandle kA("a");
+        const ShaderVarHandle kMissing("missing");
+        const ShaderVarHandle kParamsMissing("params.missing");
+
+        void runAndVerify(GPUUnitTestContext& ctx, uint32_t value, uint32_t a, float b)
+        {
+            ctx.runProgram(1, 1, 1);
+
+            const float* result = ctx.mapBuffer<const float>("result");
+            EXPECT_EQ(result[0], (float)value);
+            EXPECT_EQ(result[1], (float)a);
+            EXPECT_EQ(result[2], b);
+            ctx.unmapBuffer("result");
+        }
+    }
+
+    GPU_TEST(ShaderVarHandle_Set)
+    {
+        ctx.createProgram(kShaderFile, "main");
+        ctx.allocateStructuredBuffer("result", 3);
+
+        auto var = ctx["CB"];
+        var[kValue] = 1u;
+        var[kParamsA] = 2u;
+        var["params"]["b"] = 3.5f;
+        runAndVerify(ctx, 1, 2, 3.5f);
+
+        // Handles applied to a struct member resolve relative to that member.
+        var[kParams][kA] = 5u;
+        var[kParamsB] = -1.f;
+        runAndVerify(ctx, 1, 5, -1.f);
+
+        EXPECT(!kMissing.find(var).isValid());
+        EXPECT(!kParamsMissing.find(var).isValid());
+        EXPECT(!kParamsA.find(ShaderVar()).isValid());
+    }
+
+    GPU_TEST(ShaderVarHandle_Recompile)
+    {
+        // The member offsets change when the program is recompiled with a different layout.
+        // The handles must re-resolve instead of writing to the stale offsets.
+        for (uint32_t i = 0; i < 4; i++)
+        {
+            bool extraMember = i % 2 == 1;
+            ctx.createProgram(kShaderFile, "main", Program::DefineList{ { "EXTRA_MEMBER", extraMember ? "1" : "0" } });
+            ctx.allocateStructuredBuffer("result", 3);
+
+            auto var = ctx["CB"];
+            if (extraMember) var["extra"] = uint4(0xffffffff);
+            var[kValue] = 10u + i;
+            var[kParamsA] = 20u + i;
+            var[kParamsB] = 0.5f * i;
+            runAndVerify(ctx, 10 + i, 20 + i, 0.5f * i);
+        }
+    }
+
+    /** Microbenchmark of the CPU cost of setting constant buffer variables.
+        Compares name lookups with pre-resolved handles. The timings are logged but not checked, as they depend on the machine.
+    */
+    GPU_TEST(ShaderVarHandle_Benchmark)
+    {
+        ctx.createProgram(kShaderFile, "main");
+        ctx.allocateStructuredBuffer("result", 3);
+
+        const uint32_t kIterations = 100000;
+        auto var = ctx["CB"];
+        auto paramsVar = var["params"];
+
+        auto measure = [&](const std::string& name, auto func)
+        {
+            auto start = CpuTimer::getCurrentTimePoint();
+            for (uint32_t i = 0; i < kIterations; i++) func(i);
+            double ms = CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint());
+            logInfo(name + ": " + std::to_string(ms * 1e6 / kIterations) + " ns per set");
+        };
+
+        measure("CB name lookup", [&](uint32_t i) { var["value"] = i; });
+        measure("CB handle", [&](uint32_t i) { var[kValue] = i; });
+        measure("CB nested name lookup", [&](uint32_t i) { var["params"]["a"] = i; });
+        measure("CB nested handle", [&](uint32_t i) { var[kParamsA] = i; });
+        measure("Struct name lookup", [&](uint32_t i) { paramsVar["a"] = i; });
+        measure("Struct handle", [&](uint32_t i) { paramsVar[kA] = i; });
+
+        // The values set last must be visible to the shader.
+        runAndVerify(ctx, kIterations - 1, kIterations - 1, 0.f);
+    }
+}
@@ -0,0 +1,260 @@
+/***************************************************************************
+ # Copyright (c) 2015-21, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "Testing/UnitTest.h"
+#include "../../../../RenderPasses/ReSTIRPTPass/PackedPathReservoir.slang"
+#include <glm/gtx/io.hpp>
+#include <random>
+
+namespace Falcor
+{
+    namespace
+    {
+        const uint32_t kTestCount = 10000;
+
+        /** Returns the angle in radians between two normalized directions.
+            Computed from the chord length, which is more accurate than acos() for small angles.
+        */
+        float angleBetween(float3 a, float3 b)
+        {
+            return 2.f * std::asin(std::min(glm::length(a - b) * 0.5f, 1.f));
+        }
+
+        /** Checks that an RGB9E5 round trip is within the format's precision.
+            Each component has an absolute error of at most half a mantissa step of the shared exponent,
+            which is bounded by 2^-9 of the max component (plus rounding in the exponent selection).
+        */
+        void checkRGB9E5(CPUUnitTestContext& ctx, float3 ref, float3 res, const char* name, uint32_t i)
+        {
+            float maxc = std::max(std::max(ref.x, ref.y), ref.z);
+            float threshold = maxc * (1.f / 512.f) + 1e-7f;
+            EXPECT_LE(std::abs(res.x - ref.x), threshold) << name << " i = " << i;
+            EXPECT_LE(std::abs(res.y - ref.y), threshold) << name << " i = " << i;
+            EXPECT_LE(std::abs(res.z - ref.z), threshold) << name << " i = " << i;
+        }
+
+        PathReservoirFields createRandomReservoir(std::mt19937& rng)
+        {
+            auto u = [&]() { return std::uniform_real_distribution<float>()(rng); };
+            auto color = [&]() { return float3(u(), u(), u()) * std::pow(2.f, u() * 30.f - 14.f); };
+            auto dir = [&]()
+            {
+                float z = 1.f - 2.f * u();
+                float r = std::sqrt(std::max(0.f, 1.f - z * z));
+                float phi = 2.f * (float)M_PI * u();
+                return float3(r * std::cos(phi), r * std::sin(phi), z);
+            };
+
+            PathReservoirFields r;
+            r.M = std::floor(u() * 40.f) + u();
+            r.weight = u() * 100.f;
+            r.pathFlags = (int)rng();
+            r.rcRandomSeed = rng();
+            r.F = color();
+            r.lightPdf = u() * 1e3f;
+            r.cachedJacobian = float3(std::pow(10.f, u() * 12.f - 6.f), std::pow(10.f, u() * 12.f - 6.f), std::pow(10.f, u() * 12.f - 6.f));
+            r.initRandomSeed = rng();
+            r.rcInstanceID = rng() % 4 == 0 ? 0xffffffff : rng();
+            r.rcPrimitiveIndex = rng();
+            float b0 = u(), b1 = u();
+            r.rcBarycentrics = b0 + b1 <= 1.f ? float2(b0, b1) : float2(1.f - b0, 1.f - b1);
+            for (uint32_t j = 0; j < 2; j++)
+            {
+                r.rcVertexWi[j] = rng() % 8 == 0 ? float3(0.f) : dir();
+                r.rcVertexIrradiance[j] = color();
+            }
+            r.rcLightPdf = u() * 1e3f;
+            r.rcVertexBSDFLightSamplingIrradiance = color();
+            return r;
+        }
+    }
+
+    CPU_TEST(PackedPathReservoir_Layout)
+    {
+        // The packed structs are used directly as structured buffer elements.
+        EXPECT_EQ(sizeof(PackedPathReservoir), 56);
+        EXPECT_EQ(sizeof(PackedPathReservoirBPR), 72);
+        EXPECT_EQ(sizeof(PackedReconnectionData), 20);
+        EXPECT_EQ(sizeof(PackedPathReuseMISWeight), 4);
+    }
+
+    CPU_TEST(PackedPathReservoir_RGB9E5)
+    {
+        // Exactly representable values.
+        EXPECT_EQ(decodeRGB9E5(encodeRGB9E5(float3(0.f))), float3(0.f));
+        EXPECT_EQ(decodeRGB9E5(encodeRGB9E5(float3(1.f, 0.5f, 0.25f))), float3(1.f, 0.5f, 0.25f));
+        EXPECT_EQ(decodeRGB9E5(encodeRGB9E5(float3(kRGB9E5MaxValue))), float3(kRGB9E5MaxValue));
+
+        // Out-of-range values are clamped, negative values and NaNs are flushed to zero.
+        EXPECT_EQ(decodeRGB9E5(encodeRGB9E5(float3(1e10f, -1.f, 0.f))), float3(kRGB9E5MaxValue, 0.f, 0.f));
+        EXPECT_EQ(decodeRGB9E5(encodeRGB9E5(float3(std::numeric_limits<float>::quiet_NaN(), 1.f, 1.f))), float3(0.f, 1.f, 1.f));
+
+        // Values that round up to the next exponent.
+        EXPECT_EQ(decodeRGB9E5(encodeRGB9E5(float3(0.9999f, 0.f, 0.f))), float3(1.f, 0.f, 0.f));
+
+        std::mt19937 rng;
+        auto u = [&]() { return std::uniform_real_distribution<float>()(rng); };
+        for (uint32_t i = 0; i < kTestCount; i++)
+        {
+            float3 c = float3(u(), u(), u()) * std::pow(2.f, u() * 40.f - 24.f);
+            c = glm::min(c, float3(kRGB9E5MaxValue));
+            checkRGB9E5(ctx, c, decodeRGB9E5(encodeRGB9E5(c)), "c", i);
+        }
+    }
+
+    CPU_TEST(PackedPathReservoir_BF16)
+    {
+        EXPECT_EQ(decodeBF16(encodeBF16(0.f)), 0.f);
+        EXPECT_EQ(decodeBF16(encodeBF16(1.f)), 1.f);
+        EXPECT_EQ(decodeBF16(encodeBF16(-2.f)), -2.f);
+        EXPECT_EQ(decodeBF16(encodeBF16(std::numeric_limits<float>::infinity())), std::numeric_limits<float>::infinity());
+
+        std::mt19937 rng;
+        auto u = [&]() { return std::uniform_real_distribution<float>()(rng); };
+        for (uint32_t i = 0; i < kTestCount; i++)
+        {
+            // bfloat16 covers the full fp32 exponent range with 8 bits of precision.
+            float v = std::pow(2.f, u() * 200.f - 100.f);
+            EXPECT_LE(std::abs(decodeBF16(encodeBF16(v)) - v), v * (1.f / 256.f)) << "i = " << i;
+        }
+    }
+
+    CPU_TEST(PackedPathReservoir_Direction)
+    {
+        EXPECT_EQ(decodeDirection(encodeDirection(float3(0.f))), float3(0.f));
+
+        std::mt19937 rng;
+        auto u = [&]() { return std::uniform_real_distribution<float>()(rng); };
+        for (uint32_t i = 0; i < kTestCount; i++)
+        {
+            float3 d = glm::normalize(float3(u(), u(), u()) * 2.f - 1.f);
+            float3 res = decodeDirection(encodeDirection(d));
+            EXPECT_NE(encodeDirection(d), kPackedZeroDirection) << "i = " << i;
+            EXPECT_LE(std::abs(glm::length(res) - 1.f), 1e-5f) << "i = " << i;
+            EXPECT_LE(angleBetween(d, res), 1e-4f) << "i = " << i;
+        }
+    }
+
+    CPU_TEST(PackedPathReservoir_RoundTrip)
+    {
+        std::mt19937 rng;
+
+        for (uint32_t i = 0; i < kTestCount; i++)
+        {
+            PathReservoirFields ref = createRandomReservoir(rng);
+
+            PackedPathReservoirBPR packed;
+            packed.pack(ref);
+            PathReservoirFields res = packed.unpack();
+
+            // Fields that are stored at full precision must be reproduced exactly.
+            EXPECT_EQ(res.M, ref.M) << "i = " << i;
+            EXPECT_EQ(res.weight, ref.weight) << "i = " << i;
+            EXPECT_EQ(res.pathFlags, ref.pathFlags) << "i = " << i;
+            EXPECT_EQ(res.rcRandomSeed, ref.rcRandomSeed) << "i = " << i;
+            EXPECT_EQ(res.initRandomSeed, ref.initRandomSeed) << "i = " << i;
+            EXPECT_EQ(res.lightPdf, ref.lightPdf) << "i = " << i;
+            EXPECT_EQ(res.rcInstanceID, ref.rcInstanceID) << "i = " << i;
+            EXPECT_EQ(res.rcPrimitiveIndex, ref.rcPrimitiveIndex) << "i = " << i;
+            EXPECT_EQ(res.rcLightPdf, ref.rcLightPdf) << "i = " << i;
+
+            // Quantized fields.
+            checkRGB9E5(ctx, ref.F, res.F, "F", i);
+            for (uint32_t j = 0; j < 3; j++)
+            {
+                EXPECT_LE(std::abs(res.cachedJacobian[j] - ref.cachedJacobian[j]), ref.cachedJacobian[j] * (1.f / 256.f)) << "i = " << i;
+            }
+            EXPECT_LE(std::abs(res.rcBarycentrics.x - ref.rcBarycentrics.x), 1.f / 65535.f) << "i = " << i;
+            EXPECT_LE(std::abs(res.rcBarycentrics.y - ref.rcBarycentrics.y), 1.f / 65535.f) << "i = " << i;
+            for (uint32_t j = 0; j < 2; j++)
+            {
+                if (ref.rcVertexWi[j] == float3(0.f)) EXPECT_EQ(res.rcVertexWi[j], float3(0.f)) << "i = " << i;
+                else EXPECT_LE(angleBetween(ref.rcVertexWi[j], res.rcVertexWi[j]), 1e-4f) << "i = " << i;
+                checkRGB9E5(ctx, glm::min(ref.rcVertexIrradiance[j], float3(kRGB9E5MaxValue)), res.rcVertexIrradiance[j], "rcVertexIrradiance", i);
+            }
+            checkRGB9E5(ctx, glm::min(ref.rcVertexBSDFLightSamplingIrradiance, float3(kRGB9E5MaxValue)), res.rcVertexBSDFLightSamplingIrradiance, "rcVertexBSDFLightSamplingIrradiance", i);
+
+            // The base layout without path reuse attributes must unpack to the same values.
+            PathReservoirFields baseRes = packed.base.unpack();
+            EXPECT_EQ(baseRes.F, res.F) << "i = " << i;
+            EXPECT_EQ(baseRes.rcVertexWi[0], res.rcVertexWi[0]) << "i = " << i;
+            EXPECT_EQ(baseRes.rcVertexWi[1], float3(0.f)) << "i = " << i;
+
+            // Repeated load/store of an unchanged reservoir must not drift.
+            // Octahedral codes on the folds are not unique, so directions are compared by angle.
+            PackedPathReservoirBPR repacked;
+            repacked.pack(res);
+            PathReservoirFields res2 = repacked.unpack();
+            EXPECT_EQ(res2.F, res.F) << "i = " << i;
+            EXPECT_EQ(res2.cachedJacobian, res.cachedJacobian) << "i = " << i;
+            EXPECT_EQ(res2.rcBarycentrics, res.rcBarycentrics) << "i = " << i;
+            EXPECT_EQ(res2.rcVertexBSDFLightSamplingIrradiance, res.rcVertexBSDFLightSamplingIrradiance) << "i = " << i;
+            for (uint32_t j = 0; j < 2; j++)
+            {
+                EXPECT_EQ(res2.rcVertexIrradiance[j], res.rcVertexIrradiance[j]) << "i = " << i;
+                EXPECT_LE(angleBetween(res2.rcVertexWi[j], res.rcVertexWi[j]), 1e-4f) << "i = " << i;
+            }
+        }
+    }
+
+    CPU_TEST(PackedPathReservoir_ReconnectionData)
+    {
+        std::mt19937 rng;
+        auto u = [&]() { return std::uniform_real_distribution<float>()(rng); };
+
+        for (uint32_t i = 0; i < kTestCount; i++)
+        {
+            ReconnectionDataFields ref;
+            ref.rcPrevInstanceID = rng();
+            ref.rcPrevPrimitiveIndex = rng();
+            ref.rcPrevBarycentrics = float2(u(), u()) * 0.5f;
+            ref.rcPrevWo = glm::normalize(float3(u(), u(), u()) * 2.f - 1.f);
+            ref.pathThroughput = float3(u(), u(), u()) * 4.f;
+
+            PackedReconnectionData packed;
+            packed.pack(ref);
+            ReconnectionDataFields res = packed.unpack();
+
+            EXPECT_EQ(res.rcPrevInstanceID, ref.rcPrevInstanceID) << "i = " << i;
+            EXPECT_EQ(res.rcPrevPrimitiveIndex, ref.rcPrevPrimitiveIndex) << "i = " << i;
+            EXPECT_LE(std::abs(res.rcPrevBarycentrics.x - ref.rcPrevBarycentrics.x), 1.f / 65535.f) << "i = " << i;
+            EXPECT_LE(std::abs(res.rcPrevBarycentrics.y - ref.rcPrevBarycentrics.y), 1.f / 65535.f) << "i = " << i;
+            EXPECT_LE(angleBetween(ref.rcPrevWo, res.rcPrevWo), 1e-4f) << "i = " << i;
+            checkRGB9E5(ctx, ref.pathThroughput, res.pathThroughput, "pathThroughput", i);
+        }
+
+        // MIS weights are in [0,1] and stored as fp16.
+        for (uint32_t i = 0; i < kTestCount; i++)
+        {
+            float w0 = u(), w1 = u();
+            PackedPathReuseMISWeight packed;
+            packed.pack(w0, w1);
+            EXPECT_LE(std::abs(packed.getBSDFMISWeight() - w0), 1.f / 2048.f) << "i = " << i;
+            EXPECT_LE(std::abs(packed.getNEEMISWeight() - w1), 1.f / 2048.f) << "i = " << i;
+        }
+    }
+}
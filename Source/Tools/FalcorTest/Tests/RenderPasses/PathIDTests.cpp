@@ -0,0 +1,111 @@
+/***************************************************************************
+ # Copyright (c) 2015-21, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "Testing/UnitTest.h"
+#include "../../../../RenderPasses/ReSTIRPTPass/Params.slang"
+#include <random>
+
+namespace Falcor
+{
+    CPU_TEST(PathID_PixelBits)
+    {
+        EXPECT_EQ(getPathIDPixelBits(uint2(0, 0)), kMinPathIDPixelBits);
+        EXPECT_EQ(getPathIDPixelBits(uint2(256, 256)), 8);
+        EXPECT_EQ(getPathIDPixelBits(uint2(257, 1)), 9);
+        EXPECT_EQ(getPathIDPixelBits(uint2(1920, 1080)), 11);
+        EXPECT_EQ(getPathIDPixelBits(uint2(3840, 2160)), 12);
+        EXPECT_EQ(getPathIDPixelBits(uint2(4096, 4096)), 12);
+        EXPECT_EQ(getPathIDPixelBits(uint2(1, 4097)), 13);
+        EXPECT_EQ(getPathIDPixelBits(uint2(7680, 4320)), 13);
+        EXPECT_EQ(getPathIDPixelBits(uint2(kMaxFrameDimension, kMaxFrameDimension)), kMaxPathIDPixelBits);
+
+        // Frames exceeding the maximum dimension are clamped to the largest encoding.
+        EXPECT_EQ(getPathIDPixelBits(uint2(kMaxFrameDimension + 1, 1)), kMaxPathIDPixelBits);
+
+        // The previous fixed layout (12 bits per pixel coordinate) supported 4096 pixels and 256 samples.
+        EXPECT_EQ(getPathIDMaxSamplesPerPixel(12), 256);
+        EXPECT_EQ(getPathIDMaxSamplesPerPixel(11), 1024);
+        EXPECT_EQ(getPathIDMaxSamplesPerPixel(13), 64);
+        EXPECT_EQ(getPathIDMaxSamplesPerPixel(kMaxPathIDPixelBits), 16);
+        EXPECT_GE(getPathIDMaxSamplesPerPixel(kMinPathIDPixelBits), kMaxSamplesPerPixel);
+    }
+
+    CPU_TEST(PathID_Boundary)
+    {
+        for (uint pixelBits = kMinPathIDPixelBits; pixelBits <= kMaxPathIDPixelBits; pixelBits++)
+        {
+            const uint maxCoord = (1u << pixelBits) - 1;
+            const uint maxSampleIdx = getPathIDMaxSamplesPerPixel(pixelBits) - 1;
+
+            EXPECT_EQ(encodePathID(uint2(0, 0), 0, pixelBits), 0u) << "pixelBits = " << pixelBits;
+
+            // All fields at their maximum fill the 32-bit path ID exactly.
+            EXPECT_EQ(encodePathID(uint2(maxCoord, maxCoord), maxSampleIdx, pixelBits), 0xffffffffu) << "pixelBits = " << pixelBits;
+
+            // Each field at its maximum must decode without affecting the others.
+            const uint2 pixels[] = { uint2(maxCoord, 0), uint2(0, maxCoord), uint2(maxCoord, maxCoord), uint2(0, 0) };
+            const uint sampleIndices[] = { 0, maxSampleIdx };
+            for (uint2 pixel : pixels)
+            {
+                for (uint sampleIdx : sampleIndices)
+                {
+                    uint pathID = encodePathID(pixel, sampleIdx, pixelBits);
+                    uint2 decodedPixel = decodePathIDPixel(pathID, pixelBits);
+                    EXPECT_EQ(decodedPixel.x, pixel.x) << "pixelBits = " << pixelBits << " sampleIdx = " << sampleIdx;
+                    EXPECT_EQ(decodedPixel.y, pixel.y) << "pixelBits = " << pixelBits << " sampleIdx = " << sampleIdx;
+                    EXPECT_EQ(decodePathIDSampleIdx(pathID, pixelBits), sampleIdx) << "pixelBits = " << pixelBits;
+                }
+            }
+        }
+    }
+
+    CPU_TEST(PathID_RoundTrip)
+    {
+        std::mt19937 rng;
+
+        const uint2 frameDims[] = { uint2(1920, 1080), uint2(3840, 2160), uint2(7680, 4320), uint2(15360, 8640) };
+        for (uint2 frameDim : frameDims)
+        {
+            const uint pixelBits = getPathIDPixelBits(frameDim);
+            const uint sampleCount = getPathIDMaxSamplesPerPixel(pixelBits);
+            std::uniform_int_distribution<uint> distX(0, frameDim.x - 1);
+            std::uniform_int_distribution<uint> distY(0, frameDim.y - 1);
+            std::uniform_int_distribution<uint> distSample(0, sampleCount - 1);
+
+            for (uint32_t i = 0; i < 10000; i++)
+            {
+                uint2 pixel(distX(rng), distY(rng));
+                uint sampleIdx = distSample(rng);
+                uint pathID = encodePathID(pixel, sampleIdx, pixelBits);
+                uint2 decodedPixel = decodePathIDPixel(pathID, pixelBits);
+                EXPECT_EQ(decodedPixel.x, pixel.x) << "frameDim = " << frameDim.x << "x" << frameDim.y << " i = " << i;
+                EXPECT_EQ(decodedPixel.y, pixel.y) << "frameDim = " << frameDim.x << "x" << frameDim.y << " i = " << i;
+                EXPECT_EQ(decodePathIDSampleIdx(pathID, pixelBits), sampleIdx) << "frameDim = " << frameDim.x << "x" << frameDim.y << " i = " << i;
+            }
+        }
+    }
+}
@@ -0,0 +1,770 @@
+/***************************************************************************
+ # Copyright (c) 2015-21, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "ReSTIRPTReference.h"
+#include "../../../../RenderPasses/ReSTIRPTPass/PackedPathReservoir.slang"
+#include <execution>
+#include <random>
+
+namespace Falcor
+{
+    namespace
+    {
+        const float kPi = 3.14159265358979323846f;
+        const float kInvPi = 1.f / kPi;
+
+        enum class Lobe : uint32_t
+        {
+            Diffuse = 0,
+            Glossy = 1,
+        };
+
+        using Rng = std::mt19937;
+
+        float sampleNext1D(Rng& rng)
+        {
+            return std::uniform_real_distribution<float>()(rng);
+        }
+
+        /** Same scalarization as PathReservoir::toScalar().
+        */
+        float toScalar(const float3& color)
+        {
+            return dot(color, float3(0.299f, 0.587f, 0.114f));
+        }
+
+        bool isJacobianInvalid(float jacobian)
+        {
+            return !(jacobian > 0.f) || std::isinf(jacobian);
+        }
+
+        float3 reflectAboutNormal(const float3& wo)
+        {
+            return float3(-wo.x, -wo.y, wo.z);
+        }
+
+        /** Cosine-weighted hemisphere sample around +z (same mapping for the diffuse lobe and the ceiling).
+        */
+        float3 sampleCosineHemisphere(float u1, float u2)
+        {
+            float r = std::sqrt(u1);
+            float phi = 2.f * kPi * u2;
+            return float3(r * std::cos(phi), r * std::sin(phi), std::sqrt(std::max(0.f, 1.f - u1)));
+        }
+
+        /** Path state. This is the subset of PathReservoir needed for the analytic scene.
+        */
+        struct Reservoir
+        {
+            float M = 0.f;
+            float weight = 0.f;
+            float3 F = float3(0.f);
+
+            uint32_t pathLength = 0;            ///< 2 (emitting ceiling) or 3 (floor light), 0 if empty.
+            Lobe lobe = Lobe::Diffuse;          ///< Lobe sampled at the primary hit.
+            float u[5] = {};                    ///< Primary sample space coordinates (lobe, direction at x1, direction at x2).
+            uint32_t rcVertexLength = 0;        ///< 2 or 3, or 0 if the path has no reconnection vertex.
+            float3 rcVertexPos = float3(0.f);
+            float3 rcVertexIrradiance = float3(0.f);
+            float2 cachedJacobian = float2(0.f);    ///< Scatter PDF towards the reconnection vertex and geometry term at the reconnection vertex.
+
+            bool isValid() const { return pathLength != 0; }
+        };
+
+        /** Full evaluation of a path prefix at a primary hit for a given set of random numbers.
+        */
+        struct TracedPath
+        {
+            bool valid = false;                 ///< True if the full path x1 -> x2 -> x3 exists.
+            bool validPrefix = false;           ///< True if x1 -> x2 exists.
+            Lobe lobe = Lobe::Diffuse;
+            float3 wi = float3(0.f);
+            float scatterPdf = 0.f;
+            float3 throughput = float3(0.f);    ///< BSDF * cos / pdf at x1.
+            float3 x2 = float3(0.f);
+            float3 w2 = float3(0.f);
+            float3 x3 = float3(0.f);
+        };
+
+        class Evaluator
+        {
+        public:
+            Evaluator(const ReSTIRPTReference::Scene& scene, const ReSTIRPTReference::Config& config)
+                : mScene(scene)
+                , mConfig(config)
+            {}
+
+            // Scene.
+
+            float3 evalCeilingEmission(const float3& p) const
+            {
+                float2 d = float2(p.x, p.y) - mScene.ceilingEmissionCenter;
+                float r2 = (d.x * d.x + d.y * d.y) / (mScene.ceilingEmissionRadius * mScene.ceilingEmissionRadius);
+                return mScene.ceilingEmission * std::exp(-r2);
+            }
+
+            float3 evalCeilingAlbedo(const float3& p) const
+            {
+                return mScene.ceilingAlbedo * (0.75f + 0.25f * std::sin(2.f * p.x) * std::cos(3.f * p.y));
+            }
+
+            float3 evalLightEmission(const float3& p) const
+            {
+                bool inside = p.x >= mScene.lightMin.x && p.x <= mScene.lightMax.x && p.y >= mScene.lightMin.y && p.y <= mScene.lightMax.y;
+                return inside ? mScene.lightRadiance : float3(0.f);
+            }
+
+            /** Irradiance at a ceiling point due to the floor light (Lambert's polygon formula).
+            */
+            float3 evalCeilingIrradiance(const float3& p) const
+            {
+                const float3 corners[4] =
+                {
+                    float3(mScene.lightMin.x, mScene.lightMin.y, 0.f),
+                    float3(mScene.lightMax.x, mScene.lightMin.y, 0.f),
+                    float3(mScene.lightMax.x, mScene.lightMax.y, 0.f),
+                    float3(mScene.lightMin.x, mScene.lightMax.y, 0.f),
+                };
+                float3 v[4];
+                for (uint32_t i = 0; i < 4; ++i) v[i] = normalize(corners[i] - p);
+
+                double sum = 0.0;
+                for (uint32_t i = 0; i < 4; ++i)
+                {
+                    const float3& a = v[i];
+                    const float3& b = v[(i + 1) % 4];
+                    float3 c = cross(a, b);
+                    float len = length(c);
+                    if (len == 0.f) continue;
+                    double theta = std::atan2((double)len, (double)dot(a, b));
+                    sum += theta * (-c.z / len);
+                }
+                return mScene.lightRadiance * (float)(0.5 * std::abs(sum));
+            }
+
+            /** Outgoing radiance at a ceiling point (towards the floor).
+            */
+            float3 evalCeilingRadiance(const float3& p) const
+            {
+                return evalCeilingEmission(p) + evalCeilingAlbedo(p) * evalCeilingIrradiance(p) * kInvPi;
+            }
+
+            float3 intersectCeiling(const float3& origin, const float3& dir) const
+            {
+                return origin + dir * ((mScene.ceilingHeight - origin.z) / dir.z);
+            }
+
+            float3 intersectFloor(const float3& origin, const float3& dir) const
+            {
+                return origin + dir * (-origin.z / dir.z);
+            }
+
+            // Primary hit BSDF.
+
+            float getDiffuseProbability(const ReSTIRPTReference::Pixel& px) const
+            {
+                float d = toScalar(px.diffuse);
+                float s = toScalar(px.specular);
+                return d + s > 0.f ? d / (d + s) : 0.f;
+            }
+
+            /** Evaluate BSDF * cos of one lobe.
+            */
+            float3 evalLobe(const ReSTIRPTReference::Pixel& px, Lobe lobe, const float3& wi) const
+            {
+                if (wi.z <= 0.f) return float3(0.f);
+                if (lobe == Lobe::Diffuse) return px.diffuse * (kInvPi * wi.z);
+                float cosAlpha = dot(reflectAboutNormal(px.wo), wi);
+                if (cosAlpha <= 0.f) return float3(0.f);
+                return px.specular * ((px.exponent + 2.f) * 0.5f * kInvPi * std::pow(cosAlpha, px.exponent) * wi.z);
+            }
+
+            /** Evaluate the PDF of sampling a direction with a given lobe, including the lobe selection probability.
+            */
+            float evalLobePdf(const ReSTIRPTReference::Pixel& px, Lobe lobe, const float3& wi) const
+            {
+                float pDiffuse = getDiffuseProbability(px);
+                if (lobe == Lobe::Diffuse) return wi.z > 0.f ? pDiffuse * wi.z * kInvPi : 0.f;
+                float cosAlpha = dot(reflectAboutNormal(px.wo), wi);
+                if (cosAlpha <= 0.f) return 0.f;
+                return (1.f - pDiffuse) * (px.exponent + 1.f) * 0.5f * kInvPi * std::pow(cosAlpha, px.exponent);
+            }
+
+            float3 sampleLobe(const ReSTIRPTReference::Pixel& px, Lobe lobe, float u1, float u2) const
+            {
+                if (lobe == Lobe::Diffuse) return sampleCosineHemisphere(u1, u2);
+
+                float cosAlpha = std::pow(u1, 1.f / (px.exponent + 1.f));
+                float sinAlpha = std::sqrt(std::max(0.f, 1.f - cosAlpha * cosAlpha));
+                float phi = 2.f * kPi * u2;
+                float3 n = reflectAboutNormal(px.wo);
+                float3 t = normalize(cross(std::abs(n.z) < 0.999f ? float3(0.f, 0.f, 1.f) : float3(1.f, 0.f, 0.f), n));
+                float3 b = cross(n, t);
+                return t * (sinAlpha * std::cos(phi)) + b * (sinAlpha * std::sin(phi)) + n * cosAlpha;
+            }
+
+            bool isRough(const ReSTIRPTReference::Pixel& px, Lobe lobe) const
+            {
+                return lobe == Lobe::Diffuse || px.exponent <= mConfig.specularExponentThreshold;
+            }
+
+            /** Trace the path prefix (x1 -> x2 -> direction towards x3) with the given random numbers.
+            */
+            TracedPath tracePath(uint32_t pixelIndex, const float u[5]) const
+            {
+                const auto& px = mScene.pixels[pixelIndex];
+                TracedPath path;
+                path.lobe = u[0] < getDiffuseProbability(px) ? Lobe::Diffuse : Lobe::Glossy;
+                path.wi = sampleLobe(px, path.lobe, u[1], u[2]);
+                if (path.wi.z < 1e-6f) return path;
+                path.scatterPdf = evalLobePdf(px, path.lobe, path.wi);
+                if (path.scatterPdf == 0.f) return path;
+                path.throughput = evalLobe(px, path.lobe, path.wi) / path.scatterPdf;
+                path.x2 = intersectCeiling(px.posW, path.wi);
+                path.validPrefix = true;
+                float3 w = sampleCosineHemisphere(u[3], u[4]);
+                path.w2 = float3(w.x, w.y, -w.z);
+                if (path.w2.z > -1e-6f) return path;
+                path.x3 = intersectFloor(path.x2, path.w2);
+                path.valid = true;
+                return path;
+            }
+
+            float3 evalPathContribution(const TracedPath& path, uint32_t pathLength) const
+            {
+                if (pathLength == 2) return path.validPrefix ? path.throughput * evalCeilingEmission(path.x2) : float3(0.f);
+                if (!path.valid) return float3(0.f);
+                return path.throughput * evalCeilingAlbedo(path.x2) * evalLightEmission(path.x3);
+            }
+
+            /** Select the reconnection vertex, see computeShiftedIntegrandHybrid().
+                The reconnection vertex is the first vertex where both it and its predecessor are rough and far enough apart.
+            */
+            uint32_t classifyPath(uint32_t pixelIndex, Lobe lobe, const float3& x2, const float3& x3, uint32_t pathLength) const
+            {
+                switch (mConfig.shiftMapping)
+                {
+                case ShiftMapping::Reconnection: return 2;
+                case ShiftMapping::RandomReplay: return 0;
+                default: break;
+                }
+                const auto& px = mScene.pixels[pixelIndex];
+                if (isRough(px, lobe) && length(x2 - px.posW) > mConfig.nearFieldDistance) return 2;
+                if (pathLength == 3 && length(x3 - x2) > mConfig.nearFieldDistance) return 3;
+                return 0;
+            }
+
+            void setReconnectionData(Reservoir& r, uint32_t pixelIndex, const TracedPath& path) const
+            {
+                if (r.rcVertexLength == 2)
+                {
+                    float3 d = path.x2 - mScene.pixels[pixelIndex].posW;
+                    r.rcVertexPos = path.x2;
+                    r.rcVertexIrradiance = r.pathLength == 2 ? evalCeilingEmission(path.x2) : evalCeilingAlbedo(path.x2) * evalLightEmission(path.x3);
+                    r.cachedJacobian = float2(path.scatterPdf, path.wi.z / dot(d, d));
+                }
+                else if (r.rcVertexLength == 3)
+                {
+                    float3 d = path.x3 - path.x2;
+                    float dist2 = dot(d, d);
+                    r.rcVertexPos = path.x3;
+                    r.rcVertexIrradiance = evalLightEmission(path.x3);
+                    r.cachedJacobian = float2(-path.w2.z * kInvPi, -path.w2.z / dist2);
+                }
+            }
+
+            /** Generate the initial reservoir of a pixel with streaming RIS (source PDF is 1 in primary sample space).
+            */
+            Reservoir generateInitialReservoir(uint32_t pixelIndex, Rng& rng) const
+            {
+                Reservoir r;
+                float weightSum = 0.f;
+                for (uint32_t i = 0; i < mConfig.candidateCount; ++i)
+                {
+                    float u[5];
+                    for (float& v : u) v = sampleNext1D(rng);
+                    TracedPath path = tracePath(pixelIndex, u);
+                    for (uint32_t pathLength = 2; pathLength <= 3; ++pathLength)
+                    {
+                        float3 F = evalPathContribution(path, pathLength);
+                        float w = toScalar(F);
+                        if (!(w > 0.f)) continue;
+                        weightSum += w;
+                        if (sampleNext1D(rng) * weightSum <= w)
+                        {
+                            r.F = F;
+                            r.pathLength = pathLength;
+                            r.lobe = path.lobe;
+                            std::copy(u, u + 5, r.u);
+                            r.rcVertexLength = classifyPath(pixelIndex, path.lobe, path.x2, path.x3, pathLength);
+                            setReconnectionData(r, pixelIndex, path);
+                        }
+                    }
+                }
+                r.M = 1.f;
+                float pHat = toScalar(r.F);
+                r.weight = pHat > 0.f ? weightSum / (pHat * mConfig.candidateCount) : 0.f;
+                return r;
+            }
+
+            /** Shift a path from its current pixel to another pixel, see computeShiftedIntegrand().
+                \param[in,out] r Reservoir holding the path. On success its path data is updated to the shifted path.
+                \param[in] dstPixelIndex Destination pixel.
+                \param[out] jacobian Primary sample space Jacobian of the shift (dst / src).
+                \return Shifted integrand, or zero if the shift failed.
+            */
+            float3 shiftPath(Reservoir& r, uint32_t dstPixelIndex, float& jacobian) const
+            {
+                jacobian = 0.f;
+                if (!r.isValid()) return float3(0.f);
+
+                const auto& dst = mScene.pixels[dstPixelIndex];
+                float3 F = float3(0.f);
+                float J = 1.f;
+
+                if (r.rcVertexLength == 2)
+                {
+                    // Reconnect the primary hit to x2, keeping the sampled lobe.
+                    float3 d = r.rcVertexPos - dst.posW;
+                    float dist2 = dot(d, d);
+                    float dist = std::sqrt(dist2);
+                    float3 wi = d / dist;
+                    if (mConfig.shiftMapping == ShiftMapping::Hybrid && !(isRough(dst, r.lobe) && dist > mConfig.nearFieldDistance)) return float3(0.f);
+
+                    float scatterPdf = evalLobePdf(dst, r.lobe, wi);
+                    if (scatterPdf == 0.f) return float3(0.f);
+                    float geometryFactor = wi.z / dist2;
+                    J = scatterPdf * geometryFactor / (r.cachedJacobian.x * r.cachedJacobian.y);
+                    F = evalLobe(dst, r.lobe, wi) / scatterPdf * r.rcVertexIrradiance;
+                    r.cachedJacobian = float2(scatterPdf, geometryFactor);
+                }
+                else
+                {
+                    // Random replay of the prefix. The shifted path must have the same reconnection vertex for the shift to be invertible.
+                    TracedPath path = tracePath(dstPixelIndex, r.u);
+                    if (!path.validPrefix) return float3(0.f);
+                    float3 x3 = r.rcVertexLength == 3 ? r.rcVertexPos : path.x3;
+                    if (classifyPath(dstPixelIndex, path.lobe, path.x2, x3, r.pathLength) != r.rcVertexLength) return float3(0.f);
+
+                    if (r.rcVertexLength == 3)
+                    {
+                        // Reconnect x2 to the light vertex.
+                        float3 d = r.rcVertexPos - path.x2;
+                        float dist2 = dot(d, d);
+                        float3 w2 = d / std::sqrt(dist2);
+                        float scatterPdf = -w2.z * kInvPi;
+                        float geometryFactor = -w2.z / dist2;
+                        J = scatterPdf * geometryFactor / (r.cachedJacobian.x * r.cachedJacobian.y);
+                        F = path.throughput * evalCeilingAlbedo(path.x2) * r.rcVertexIrradiance;
+                        r.cachedJacobian = float2(scatterPdf, geometryFactor);
+                    }
+                    else
+                    {
+                        F = evalPathContribution(path, r.pathLength);
+                    }
+                    r.lobe = path.lobe;
+                }
+
+                if (isJacobianInvalid(J) || !(toScalar(F) > 0.f)) return float3(0.f);
+
+                jacobian = mConfig.useJacobian ? J : 1.f;
+                r.F = F;
+                return F;
+            }
+
+            /** Merge a (shifted) reservoir with resampling MIS, see PathReservoir::mergeWithResamplingMIS().
+            */
+            void mergeWithResamplingMIS(Reservoir& dst, float& weightSum, const Reservoir& shifted, float jacobian, const Reservoir& src, float misWeight, Rng& rng) const
+            {
+                float w = toScalar(shifted.F) * jacobian * src.weight * misWeight;
+                dst.M += src.M;
+                if (std::isnan(w) || w == 0.f) return;
+                weightSum += w;
+                if (sampleNext1D(rng) * weightSum <= w)
+                {
+                    float M = dst.M;
+                    dst = shifted;
+                    dst.M = M;
+                }
+            }
+
+            void finalizeGRIS(Reservoir& r, float weightSum, float normalization) const
+            {
+                float pHat = toScalar(r.F);
+                r.weight = pHat == 0.f ? 0.f : weightSum / pHat / normalization;
+            }
+
+            struct Neighbor
+            {
+                uint32_t pixelIndex;
+                const Reservoir* pReservoir;
+            };
+
+            /** Talbot resampling MIS, see the TALBOT RMIS branch in SpatialReuse.cs.slang.
+            */
+            Reservoir resampleTalbot(uint32_t centerIndex, const Reservoir& central, const std::vector<Neighbor>& neighbors, Rng& rng) const
+            {
+                Reservoir dst;
+                float weightSum = 0.f;
+                const int neighborCount = (int)neighbors.size();
+
+                for (int i = -1; i < neighborCount; ++i)
+                {
+                    const Reservoir& neighbor = i == -1 ? central : *neighbors[i].pReservoir;
+                    Reservoir temp = neighbor;
+                    float jacobian = 1.f;
+                    bool possibleToBeSelected = false;
+
+                    if (i == -1) possibleToBeSelected = neighbor.weight > 0.f;
+                    else possibleToBeSelected = neighbor.weight > 0.f && toScalar(shiftPath(temp, centerIndex, jacobian)) > 0.f;
+
+                    float pSum = 0.f;
+                    float pSelf = 0.f;
+                    if (possibleToBeSelected)
+                    {
+                        for (int j = -1; j < neighborCount; ++j)
+                        {
+                            if (j == -1)
+                            {
+                                float p = toScalar(temp.F) * central.M;
+                                pSum += p;
+                                if (i == -1) pSelf = p;
+                            }
+                            else if (i == j)
+                            {
+                                pSelf = toScalar(neighbor.F) / jacobian * neighbor.M;
+                                pSum += pSelf;
+                            }
+                            else
+                            {
+                                Reservoir tneighbor = temp;
+                                float tneighborJacobian;
+                                float p = toScalar(shiftPath(tneighbor, neighbors[j].pixelIndex, tneighborJacobian)) * tneighborJacobian;
+                                pSum += p * neighbors[j].pReservoir->M;
+                            }
+                        }
+                    }
+
+                    float misWeight = pSum == 0.f ? 0.f : pSelf / pSum;
+                    mergeWithResamplingMIS(dst, weightSum, temp, jacobian, neighbor, misWeight, rng);
+                }
+
+                finalizeGRIS(dst, weightSum, 1.f);
+                return dst;
+            }
+
+            /** Pairwise resampling MIS, see the PAIRWISE RMIS branch in SpatialReuse.cs.slang.
+            */
+            Reservoir resamplePairwise(uint32_t centerIndex, const Reservoir& central, const std::vector<Neighbor>& neighbors, float neighborCount, Rng& rng) const
+            {
+                Reservoir dst;
+                float weightSum = 0.f;
+                float canonicalWeight = 1.f;
+                float centralPHat = toScalar(central.F);
+
+                for (const auto& n : neighbors)
+                {
+                    const Reservoir& neighbor = *n.pReservoir;
+
+                    Reservoir prefix = central;
+                    float prefixJacobian;
+                    float prefixApproxPdf = toScalar(shiftPath(prefix, n.pixelIndex, prefixJacobian)) * prefixJacobian;
+
+                    canonicalWeight += 1.f;
+                    if (prefixApproxPdf > 0.f)
+                    {
+                        canonicalWeight -= prefixApproxPdf * neighbor.M / (prefixApproxPdf * neighbor.M + central.M * centralPHat / neighborCount);
+                    }
+
+                    Reservoir temp = neighbor;
+                    float jacobian = 0.f;
+                    float neighborWeight = 0.f;
+                    if (neighbor.weight > 0.f && toScalar(shiftPath(temp, centerIndex, jacobian)) > 0.f)
+                    {
+                        float pSelf = toScalar(neighbor.F) / jacobian * neighbor.M;
+                        neighborWeight = pSelf / (pSelf + toScalar(temp.F) * central.M / neighborCount);
+                        if (std::isnan(neighborWeight) || std::isinf(neighborWeight)) neighborWeight = 0.f;
+                    }
+                    mergeWithResamplingMIS(dst, weightSum, temp, jacobian, neighbor, neighborWeight, rng);
+                }
+
+                mergeWithResamplingMIS(dst, weightSum, central, 1.f, central, canonicalWeight, rng);
+
+                // Compensate for the pairwise MIS weights not being divided by (k + 1).
+                finalizeGRIS(dst, weightSum, (float)neighbors.size() + 1.f);
+                return dst;
+            }
+
+            Reservoir resample(uint32_t centerIndex, const Reservoir& central, const std::vector<Neighbor>& neighbors, float neighborCount, Rng& rng) const
+            {
+                if (mConfig.misKind == ReSTIRMISKind::Pairwise) return resamplePairwise(centerIndex, central, neighbors, neighborCount, rng);
+                return resampleTalbot(centerIndex, central, neighbors, rng);
+            }
+
+            /** Round trip a reservoir through the compressed storage precision (see PackedPathReservoir).
+            */
+            void quantize(Reservoir& r) const
+            {
+                if (!mConfig.quantizeReservoirs) return;
+                r.F = decodeRGB9E5(encodeRGB9E5(r.F));
+                r.rcVertexIrradiance = decodeRGB9E5(encodeRGB9E5(r.rcVertexIrradiance));
+                r.cachedJacobian = float2(decodeBF16(encodeBF16(r.cachedJacobian.x)), decodeBF16(encodeBF16(r.cachedJacobian.y)));
+            }
+
+            /** Render all frames of one trial and return the final pixel estimates.
+            */
+            void runTrial(Rng& rng, float3* pEstimates) const
+            {
+                const uint2 frameDim = mScene.frameDim;
+                const uint32_t pixelCount = frameDim.x * frameDim.y;
+                const uint32_t frameCount = mConfig.temporalReuse ? std::max(mConfig.frameCount, 1u) : 1u;
+                const int radius = (int)mConfig.spatialRadius;
+
+                std::vector<Reservoir> current(pixelCount), next(pixelCount), previous;
+                std::vector<Neighbor> neighbors;
+
+                for (uint32_t frame = 0; frame < frameCount; ++frame)
+                {
+                    for (uint32_t i = 0; i < pixelCount; ++i)
+                    {
+                        current[i] = generateInitialReservoir(i, rng);
+                        quantize(current[i]);
+                    }
+
+                    // Temporal reuse with a static camera, so the previous pixel is the same pixel.
+                    if (frame > 0)
+                    {
+                        for (uint32_t i = 0; i < pixelCount; ++i)
+                        {
+                            Reservoir temporal = previous[i];
+                            temporal.M = std::min(mConfig.temporalHistoryLength * current[i].M, temporal.M);
+                            neighbors = { { i, &temporal } };
+                            next[i] = resample(i, current[i], neighbors, 1.f, rng);
+                            quantize(next[i]);
+                        }
+                        std::swap(current, next);
+                    }
+
+                    for (uint32_t round = 0; round < mConfig.spatialRounds; ++round)
+                    {
+                        for (uint32_t i = 0; i < pixelCount; ++i)
+                        {
+                            int2 pixel = int2(i % frameDim.x, i / frameDim.x);
+                            neighbors.clear();
+                            for (uint32_t k = 0; k < mConfig.spatialNeighborCount && radius > 0; ++k)
+                            {
+                                int2 offset;
+                                do
+                                {
+                                    offset.x = std::min((int)(sampleNext1D(rng) * (2 * radius + 1)), 2 * radius) - radius;
+                                    offset.y = std::min((int)(sampleNext1D(rng) * (2 * radius + 1)), 2 * radius) - radius;
+                                } while (offset.x == 0 && offset.y == 0);
+                                int2 neighborPixel = pixel + offset;
+                                if (neighborPixel.x < 0 || neighborPixel.y < 0 || neighborPixel.x >= (int)frameDim.x || neighborPixel.y >= (int)frameDim.y) continue;
+                                uint32_t neighborIndex = neighborPixel.y * frameDim.x + neighborPixel.x;
+                                neighbors.push_back({ neighborIndex, &current[neighborIndex] });
+                            }
+                            next[i] = resample(i, current[i], neighbors, (float)mConfig.spatialNeighborCount, rng);
+                            quantize(next[i]);
+                        }
+                        std::swap(current, next);
+                    }
+
+                    previous = current;
+                }
+
+                for (uint32_t i = 0; i < pixelCount; ++i) pEstimates[i] = current[i].F * current[i].weight;
+            }
+
+        private:
+            const ReSTIRPTReference::Scene& mScene;
+            const ReSTIRPTReference::Config& mConfig;
+        };
+
+        const char* toString(ShiftMapping shiftMapping)
+        {
+            switch (shiftMapping)
+            {
+            case ShiftMapping::Reconnection: return "Reconnection";
+            case ShiftMapping::RandomReplay: return "RandomReplay";
+            case ShiftMapping::Hybrid: return "Hybrid";
+            default: return "Unknown";
+            }
+        }
+
+        const char* toString(ReSTIRMISKind misKind)
+        {
+            switch (misKind)
+            {
+            case ReSTIRMISKind::Talbot: return "Talbot";
+            case ReSTIRMISKind::Pairwise: return "Pairwise";
+            default: return "Unsupported";
+            }
+        }
+    }
+
+    std::string ReSTIRPTReference::Config::toString() const
+    {
+        std::ostringstream oss;
+        oss << "shift=" << Falcor::toString(shiftMapping) << " mis=" << Falcor::toString(misKind) << " candidates=" << candidateCount
+            << " spatialRounds=" << spatialRounds << " neighbors=" << spatialNeighborCount << " radius=" << spatialRadius
+            << " temporal=" << (temporalReuse ? frameCount : 0) << " jacobian=" << useJacobian << " quantize=" << quantizeReservoirs;
+        return oss.str();
+    }
+
+    ReSTIRPTReference::ReSTIRPTReference(const Scene& scene, uint32_t quadratureResolution)
+        : mScene(scene)
+    {
+        if (mScene.pixels.size() != (size_t)mScene.frameDim.x * mScene.frameDim.y) throw std::exception("ReSTIRPTReference: Pixel count does not match the frame dimension");
+
+        // The quadrature runs over the primary sample space of each lobe separately.
+        // The integrand is smooth since the light is only reached via the ceiling irradiance, which is evaluated in closed form.
+        Config config;
+        Evaluator evaluator(mScene, config);
+        mReference.resize(mScene.pixels.size());
+
+        auto range = NumericRange<uint32_t>(0, (uint32_t)mScene.pixels.size());
+        std::for_each(std::execution::par, range.begin(), range.end(), [&](uint32_t pixelIndex)
+        {
+            const auto& px = mScene.pixels[pixelIndex];
+            double sum[2][3] = {};
+            for (uint32_t y = 0; y < quadratureResolution; ++y)
+            {
+                for (uint32_t x = 0; x < quadratureResolution; ++x)
+                {
+                    float u1 = (x + 0.5f) / quadratureResolution;
+                    float u2 = (y + 0.5f) / quadratureResolution;
+                    for (uint32_t lobe = 0; lobe < 2; ++lobe)
+                    {
+                        float3 wi = evaluator.sampleLobe(px, (Lobe)lobe, u1, u2);
+                        if (wi.z < 1e-6f) continue;
+                        float3 L = evaluator.evalCeilingRadiance(evaluator.intersectCeiling(px.posW, wi));
+                        float w = lobe == 0 ? 1.f : wi.z;
+                        for (uint32_t c = 0; c < 3; ++c) sum[lobe][c] += w * L[c];
+                    }
+                }
+            }
+
+            // Diffuse lobe: kd * E[L], glossy lobe: ks * (n + 2) / (n + 1) * E[cos * L].
+            double invCount = 1.0 / ((double)quadratureResolution * quadratureResolution);
+            double glossyScale = (px.exponent + 2.0) / (px.exponent + 1.0);
+            float3 result;
+            for (uint32_t c = 0; c < 3; ++c)
+            {
+                result[c] = (float)(px.diffuse[c] * sum[0][c] * invCount + px.specular[c] * glossyScale * sum[1][c] * invCount);
+            }
+            mReference[pixelIndex] = result;
+        });
+    }
+
+    ReSTIRPTReference::Scene ReSTIRPTReference::createDefaultScene(uint2 frameDim)
+    {
+        Scene scene;
+        scene.frameDim = frameDim;
+        scene.ceilingHeight = 1.f;
+        scene.ceilingEmission = float3(1.2f, 1.0f, 0.8f);
+        scene.ceilingEmissionCenter = float2(0.3f, -0.2f);
+        scene.ceilingEmissionRadius = 0.8f;
+        scene.lightMin = float2(-1.2f, 0.2f);
+        scene.lightMax = float2(-0.4f, 1.f);
+        scene.lightRadiance = float3(6.f, 5.f, 4.f);
+
+        // Pixels cover [-1,1]^2 on the floor. Materials alternate between rough and glossy in 2x2 blocks.
+        scene.pixels.resize(frameDim.x * frameDim.y);
+        for (uint32_t y = 0; y < frameDim.y; ++y)
+        {
+            for (uint32_t x = 0; x < frameDim.x; ++x)
+            {
+                float fx = (x + 0.5f) / frameDim.x;
+                float fy = (y + 0.5f) / frameDim.y;
+                bool glossy = ((x / 2) + (y / 2)) % 2 == 1;
+
+                Pixel& px = scene.pixels[y * frameDim.x + x];
+                px.posW = float3(2.f * fx - 1.f, 2.f * fy - 1.f, 0.f);
+                px.wo = normalize(float3(0.6f * fx - 0.3f, 0.2f - 0.4f * fy, 1.f));
+                px.diffuse = glossy ? float3(0.1f, 0.15f, 0.2f) * (0.5f + fx) : float3(0.6f, 0.5f, 0.4f) * (0.5f + 0.5f * fy);
+                px.specular = glossy ? float3(0.6f, 0.6f, 0.5f) : float3(0.2f);
+                px.exponent = glossy ? 100.f + 100.f * fy : 2.f + 8.f * fx;
+            }
+        }
+        return scene;
+    }
+
+    ReSTIRPTReference::Result ReSTIRPTReference::run(const Config& config, uint32_t trialCount, uint32_t seed) const
+    {
+        if (config.misKind != ReSTIRMISKind::Talbot && config.misKind != ReSTIRMISKind::Pairwise)
+        {
+            throw std::exception("ReSTIRPTReference: Only Talbot and Pairwise resampling MIS are supported");
+        }
+
+        const uint32_t pixelCount = (uint32_t)mScene.pixels.size();
+        std::vector<float3> estimates((size_t)trialCount * pixelCount);
+
+        Evaluator evaluator(mScene, config);
+        auto range = NumericRange<uint32_t>(0, trialCount);
+        std::for_each(std::execution::par, range.begin(), range.end(), [&](uint32_t trial)
+        {
+            std::seed_seq seq{ seed, trial };
+            Rng rng(seq);
+            evaluator.runTrial(rng, estimates.data() + (size_t)trial * pixelCount);
+        });
+
+        // Reduce serially so that the result does not depend on the thread count.
+        Result result;
+        result.trialCount = trialCount;
+        result.mean.resize(pixelCount);
+        result.meanLuminance.resize(pixelCount);
+        result.varianceLuminance.resize(pixelCount);
+
+        for (uint32_t i = 0; i < pixelCount; ++i)
+        {
+            double sum[3] = {};
+            double sumLum = 0.0;
+            double sumLum2 = 0.0;
+            for (uint32_t trial = 0; trial < trialCount; ++trial)
+            {
+                const float3& e = estimates[(size_t)trial * pixelCount + i];
+                for (uint32_t c = 0; c < 3; ++c) sum[c] += e[c];
+                double lum = toScalar(e);
+                sumLum += lum;
+                sumLum2 += lum * lum;
+            }
+            double mean = sumLum / trialCount;
+            result.mean[i] = float3((float)(sum[0] / trialCount), (float)(sum[1] / trialCount), (float)(sum[2] / trialCount));
+            result.meanLuminance[i] = mean;
+            result.varianceLuminance[i] = trialCount > 1 ? std::max(0.0, (sumLum2 - trialCount * mean * mean) / (trialCount - 1)) : 0.0;
+            result.averageVariance += result.varianceLuminance[i] / pixelCount;
+        }
+
+        return result;
+    }
+
+    float ReSTIRPTReference::getReferenceLuminance(uint32_t pixelIndex) const
+    {
+        return toScalar(mReference[pixelIndex]);
+    }
+}
@@ -0,0 +1,142 @@
+/***************************************************************************
+ # Copyright (c) 2015-21, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#pragma once
+#include "Falcor.h"
+#include "../../../../RenderPasses/ReSTIRPTPass/Params.slang"
+
+namespace Falcor
+{
+    /** CPU reference implementation of the ReSTIR PT resampling and shift mapping math.
+
+        This mirrors the reservoir combination in PathReservoir.slang/SpatialReuse.cs.slang and the
+        shift mappings in Shift.slang on an analytic scene defined in host code, so that the
+        unbiasedness of a given configuration can be checked statistically without a GPU.
+
+        The scene consists of a grid of primary hits on the floor plane (z = 0), each with its own
+        diffuse + normalized Phong BSDF, a diffuse ceiling (z = H) with smoothly varying albedo and
+        emission, and a rectangular area light on the floor. Paths are x1 -> x2 (ceiling) -> x3 (floor)
+        and are sampled with BSDF sampling only, so that every path has a closed-form primary sample
+        space (PSS) mapping. The reference image is computed by deterministic quadrature.
+
+        Trials are independent and run in parallel. Each trial uses its own seeded random number
+        generator, so results are deterministic for a given seed regardless of thread scheduling.
+    */
+    class ReSTIRPTReference
+    {
+    public:
+        /** Primary hit of one pixel.
+        */
+        struct Pixel
+        {
+            float3 posW = float3(0.f);                  ///< Position on the floor plane.
+            float3 wo = float3(0.f, 0.f, 1.f);          ///< Outgoing direction (towards the camera).
+            float3 diffuse = float3(0.5f);              ///< Diffuse albedo.
+            float3 specular = float3(0.f);              ///< Phong lobe albedo.
+            float exponent = 1.f;                       ///< Phong exponent.
+        };
+
+        /** Analytic scene description.
+        */
+        struct Scene
+        {
+            uint2 frameDim = { 0, 0 };
+            std::vector<Pixel> pixels;                  ///< Primary hits in scanline order.
+
+            float ceilingHeight = 1.f;
+            float3 ceilingAlbedo = float3(0.7f, 0.6f, 0.5f);        ///< Mean ceiling albedo, modulated by a smooth pattern.
+            float3 ceilingEmission = float3(0.f);                   ///< Peak ceiling emission (Gaussian falloff).
+            float2 ceilingEmissionCenter = float2(0.f);
+            float ceilingEmissionRadius = 1.f;
+
+            float2 lightMin = float2(0.f);              ///< Floor area light extent.
+            float2 lightMax = float2(0.f);
+            float3 lightRadiance = float3(0.f);
+        };
+
+        /** Resampling configuration. Defaults follow the ReSTIR PT pass defaults where applicable.
+        */
+        struct Config
+        {
+            ShiftMapping shiftMapping = ShiftMapping::Hybrid;
+            ReSTIRMISKind misKind = ReSTIRMISKind::Talbot;  ///< Only Talbot and Pairwise are supported. Used for both temporal and spatial reuse.
+            uint32_t candidateCount = 1;                ///< Initial candidate paths per pixel.
+            uint32_t spatialRounds = 1;
+            uint32_t spatialNeighborCount = 3;
+            uint32_t spatialRadius = 2;                 ///< Neighbors are picked from a square window of this radius in pixels.
+            bool temporalReuse = false;
+            uint32_t frameCount = 1;                    ///< Number of frames rendered per trial. Only relevant with temporal reuse.
+            float temporalHistoryLength = 20.f;
+
+            // Hybrid shift classification, see RestirPathTracerParams.
+            float specularExponentThreshold = 32.f;     ///< Phong lobes with a larger exponent are classified as specular.
+            float nearFieldDistance = 1.1f;
+
+            bool useJacobian = true;                    ///< Setting this to false gives a biased estimator (used to validate the tests).
+            bool quantizeReservoirs = false;            ///< Round trip reservoirs through the COMPRESS_RESERVOIRS storage precision.
+
+            std::string toString() const;
+        };
+
+        /** Per-pixel statistics over all trials.
+        */
+        struct Result
+        {
+            uint32_t trialCount = 0;
+            std::vector<float3> mean;                   ///< Mean pixel estimate.
+            std::vector<double> meanLuminance;          ///< Mean of the luminance of the pixel estimate.
+            std::vector<double> varianceLuminance;      ///< Sample variance of the luminance of the pixel estimate.
+            double averageVariance = 0.0;               ///< Luminance variance averaged over all pixels.
+        };
+
+        /** Create the reference and compute the ground truth image.
+            \param[in] scene Scene description.
+            \param[in] quadratureResolution Quadrature points per dimension and BSDF lobe.
+        */
+        ReSTIRPTReference(const Scene& scene, uint32_t quadratureResolution = 256);
+
+        /** Create the default test scene with a mix of rough and glossy pixels.
+        */
+        static Scene createDefaultScene(uint2 frameDim);
+
+        /** Run independent trials of a configuration.
+            \param[in] config Resampling configuration.
+            \param[in] trialCount Number of independent trials.
+            \param[in] seed Random seed. Trial i uses the seed sequence (seed, i).
+            \return Per-pixel statistics of the estimate in the last frame of each trial.
+        */
+        Result run(const Config& config, uint32_t trialCount, uint32_t seed = 0) const;
+
+        const Scene& getScene() const { return mScene; }
+        const std::vector<float3>& getReference() const { return mReference; }
+        float getReferenceLuminance(uint32_t pixelIndex) const;
+
+    private:
+        Scene mScene;
+        std::vector<float3> mReference;
+    };
+}
@@ -0,0 +1,182 @@
+/***************************************************************************
+ # Copyright (c) 2015-21, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "Testing/UnitTest.h"
+#include "ReSTIRPTReference.h"
+
+#include "hypothesis/hypothesis.h"
+
+namespace Falcor
+{
+    namespace
+    {
+        const uint2 kFrameDim = { 8, 8 };
+        const uint32_t kTrialCount = 4096;
+        const double kSignificanceLevel = 0.01;
+
+        const ReSTIRPTReference& getReference()
+        {
+            // The quadrature for the reference image is shared by all tests.
+            static const ReSTIRPTReference reference(ReSTIRPTReference::createDefaultScene(kFrameDim));
+            return reference;
+        }
+
+        /** Run a Student's t-test per pixel against the reference.
+            \param[in] numTests Total number of tests performed, used for the Sidak correction.
+            \return Number of pixels where the null hypothesis (unbiased) was rejected.
+        */
+        uint32_t countBiasedPixels(const ReSTIRPTReference::Result& result, int numTests, std::string& report)
+        {
+            const auto& reference = getReference();
+            uint32_t biasedCount = 0;
+            for (uint32_t i = 0; i < (uint32_t)result.meanLuminance.size(); ++i)
+            {
+                auto [success, pixelReport] = hypothesis::students_t_test(result.meanLuminance[i], result.varianceLuminance[i],
+                    reference.getReferenceLuminance(i), result.trialCount, kSignificanceLevel, numTests);
+                if (!success)
+                {
+                    biasedCount++;
+                    report += "Pixel " + std::to_string(i) + ":\n" + pixelReport;
+                }
+            }
+            return biasedCount;
+        }
+
+        ReSTIRPTReference::Config createReuseConfig(ShiftMapping shiftMapping, ReSTIRMISKind misKind)
+        {
+            ReSTIRPTReference::Config config;
+            config.shiftMapping = shiftMapping;
+            config.misKind = misKind;
+            config.spatialRounds = 2;
+            config.spatialNeighborCount = 3;
+            config.temporalReuse = true;
+            config.frameCount = 3;
+            return config;
+        }
+    }
+
+    CPU_TEST(ReSTIRPTReference_Deterministic)
+    {
+        const auto& reference = getReference();
+        auto config = createReuseConfig(ShiftMapping::Hybrid, ReSTIRMISKind::Talbot);
+
+        auto a = reference.run(config, 64, 7);
+        auto b = reference.run(config, 64, 7);
+        auto c = reference.run(config, 64, 8);
+
+        bool equal = true;
+        bool differentSeedEqual = true;
+        for (size_t i = 0; i < a.mean.size(); ++i)
+        {
+            equal = equal && a.mean[i] == b.mean[i] && a.varianceLuminance[i] == b.varianceLuminance[i];
+            differentSeedEqual = differentSeedEqual && a.mean[i] == c.mean[i];
+        }
+        EXPECT(equal);
+        EXPECT(!differentSeedEqual);
+    }
+
+    CPU_TEST(ReSTIRPTReference_Unbiased)
+    {
+        const auto& reference = getReference();
+
+        // Plain path tracing validates the reference image itself.
+        std::vector<ReSTIRPTReference::Config> configs;
+        ReSTIRPTReference::Config noReuse;
+        noReuse.spatialRounds = 0;
+        configs.push_back(noReuse);
+
+        for (auto shiftMapping : { ShiftMapping::Reconnection, ShiftMapping::RandomReplay, ShiftMapping::Hybrid })
+        {
+            for (auto misKind : { ReSTIRMISKind::Talbot, ReSTIRMISKind::Pairwise })
+            {
+                ReSTIRPTReference::Config spatial;
+                spatial.shiftMapping = shiftMapping;
+                spatial.misKind = misKind;
+                spatial.candidateCount = 2;
+                configs.push_back(spatial);
+                configs.push_back(createReuseConfig(shiftMapping, misKind));
+            }
+        }
+
+        const int numTests = (int)(configs.size() * kFrameDim.x * kFrameDim.y);
+        for (const auto& config : configs)
+        {
+            auto result = reference.run(config, kTrialCount, 1);
+            logInfo("ReSTIRPTReference_Unbiased: " + config.toString() + " average variance " + std::to_string(result.averageVariance));
+
+            std::string report;
+            uint32_t biasedCount = countBiasedPixels(result, numTests, report);
+            if (biasedCount > 0) std::cout << config.toString() << std::endl << report << std::endl;
+            EXPECT_EQ(biasedCount, 0u) << config.toString();
+        }
+    }
+
+    CPU_TEST(ReSTIRPTReference_VarianceReduction)
+    {
+        const auto& reference = getReference();
+
+        ReSTIRPTReference::Config noReuse;
+        noReuse.spatialRounds = 0;
+        auto baseline = reference.run(noReuse, 1024, 2);
+
+        for (auto shiftMapping : { ShiftMapping::Reconnection, ShiftMapping::RandomReplay, ShiftMapping::Hybrid })
+        {
+            auto config = createReuseConfig(shiftMapping, ReSTIRMISKind::Talbot);
+            auto result = reference.run(config, 1024, 2);
+            EXPECT_LT(result.averageVariance, baseline.averageVariance) << config.toString();
+        }
+    }
+
+    CPU_TEST(ReSTIRPTReference_DetectsBias)
+    {
+        // Ignoring the shift Jacobian must be caught by the unbiasedness test.
+        auto config = createReuseConfig(ShiftMapping::Reconnection, ReSTIRMISKind::Talbot);
+        config.useJacobian = false;
+        auto result = getReference().run(config, kTrialCount, 3);
+
+        std::string report;
+        EXPECT_GT(countBiasedPixels(result, kFrameDim.x * kFrameDim.y, report), 0u);
+    }
+
+    CPU_TEST(ReSTIRPTReference_CompressedReservoirs)
+    {
+        // The compressed reservoir storage is a performance approximation, its bias must be below the detection threshold.
+        const auto& reference = getReference();
+        for (auto shiftMapping : { ShiftMapping::Reconnection, ShiftMapping::Hybrid })
+        {
+            auto config = createReuseConfig(shiftMapping, ReSTIRMISKind::Talbot);
+            config.quantizeReservoirs = true;
+            auto result = reference.run(config, kTrialCount, 4);
+            logInfo("ReSTIRPTReference_CompressedReservoirs: " + config.toString() + " average variance " + std::to_string(result.averageVariance));
+
+            std::string report;
+            uint32_t biasedCount = countBiasedPixels(result, 2 * kFrameDim.x * kFrameDim.y, report);
+            if (biasedCount > 0) std::cout << report << std::endl;
+            EXPECT_EQ(biasedCount, 0u) << config.toString();
+        }
+    }
+}
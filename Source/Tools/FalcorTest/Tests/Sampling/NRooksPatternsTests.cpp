@@ -0,0 +1,200 @@
+/***************************************************************************
+ # Copyright (c) 2015-21, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "Testing/UnitTest.h"
+#include "Utils/SampleGenerators/NRooksPatterns.h"
+#include <set>
+
+namespace Falcor
+{
+    namespace
+    {
+        NRooksPatterns::Desc makeDesc(uint32_t size, uint32_t patternCount, NRooksPatterns::Optimization optimization, uint32_t seed = 0)
+        {
+            NRooksPatterns::Desc desc;
+            desc.size = size;
+            desc.patternCount = patternCount;
+            desc.optimization = optimization;
+            desc.seed = seed;
+            return desc;
+        }
+
+        /** Checks that each pattern is a Latin square, i.e., each group has one pixel per row and column.
+        */
+        void testLatinProperty(CPUUnitTestContext& ctx, const NRooksPatterns& patterns)
+        {
+            const uint32_t size = patterns.getDesc().size;
+            for (uint32_t pattern = 0; pattern < patterns.getDesc().patternCount; pattern++)
+            {
+                for (uint32_t i = 0; i < size; i++)
+                {
+                    std::set<uint32_t> rowGroups, columnGroups;
+                    for (uint32_t j = 0; j < size; j++)
+                    {
+                        rowGroups.insert(patterns.getGroup(pattern, j, i));
+                        columnGroups.insert(patterns.getGroup(pattern, i, j));
+                        EXPECT_LT(patterns.getGroup(pattern, j, i), size);
+                    }
+                    EXPECT_EQ(rowGroups.size(), size);
+                    EXPECT_EQ(columnGroups.size(), size);
+                }
+
+                for (uint32_t y = 0; y < size; y++)
+                {
+                    for (uint32_t x = 0; x < size; x++) EXPECT_EQ(patterns.getRow(pattern, patterns.getGroup(pattern, x, y), x), y);
+                }
+            }
+        }
+
+        /** Returns the average of the pattern metrics.
+        */
+        NRooksPatterns::Metrics averageMetrics(const NRooksPatterns& patterns)
+        {
+            NRooksPatterns::Metrics average;
+            const uint32_t patternCount = patterns.getDesc().patternCount;
+            for (uint32_t pattern = 0; pattern < patternCount; pattern++)
+            {
+                auto metrics = patterns.computeMetrics(pattern);
+                average.minDistance += metrics.minDistance / patternCount;
+                average.meanMinDistance += metrics.meanMinDistance / patternCount;
+            }
+            return average;
+        }
+    }
+
+    CPU_TEST(NRooksPatterns_LatinProperty)
+    {
+        for (uint32_t size : { 2, 4, 6, 8, 16 })
+        {
+            for (auto optimization : { NRooksPatterns::Optimization::None, NRooksPatterns::Optimization::MinDistance })
+            {
+                auto pPatterns = NRooksPatterns::create(makeDesc(size, 32, optimization), false);
+                testLatinProperty(ctx, *pPatterns);
+            }
+        }
+    }
+
+    CPU_TEST(NRooksPatterns_Quality)
+    {
+        auto pRandom = NRooksPatterns::create(makeDesc(16, 64, NRooksPatterns::Optimization::None), false);
+        auto pOptimized = NRooksPatterns::create(makeDesc(16, 64, NRooksPatterns::Optimization::MinDistance), false);
+
+        // Two pixels in the same group can't be closer than a diagonal neighbor.
+        // The optimized patterns must not have diagonal neighbors in the same group, and spread groups out more on average.
+        auto randomMetrics = averageMetrics(*pRandom);
+        auto optimizedMetrics = averageMetrics(*pOptimized);
+        for (uint32_t pattern = 0; pattern < 64; pattern++)
+        {
+            EXPECT_GE(pRandom->computeMetrics(pattern).minDistance, std::sqrt(2.f));
+            EXPECT_GE(pOptimized->computeMetrics(pattern).minDistance, 2.f) << "pattern " << pattern;
+        }
+        EXPECT_GT(optimizedMetrics.meanMinDistance, randomMetrics.meanMinDistance * 1.15f);
+        logInfo("N-rooks patterns: random mean min distance " + std::to_string(randomMetrics.meanMinDistance) + ", optimized " + std::to_string(optimizedMetrics.meanMinDistance));
+
+        // All patterns are different.
+        std::set<std::vector<uint32_t>> unique;
+        for (uint32_t pattern = 0; pattern < 64; pattern++)
+        {
+            std::vector<uint32_t> groups;
+            for (uint32_t i = 0; i < 256; i++) groups.push_back(pOptimized->getGroup(pattern, i % 16, i / 16));
+            unique.insert(groups);
+        }
+        EXPECT_EQ(unique.size(), 64);
+    }
+
+    CPU_TEST(NRooksPatterns_PackedLayout)
+    {
+        auto pPatterns = NRooksPatterns::create(makeDesc(16, 8, NRooksPatterns::Optimization::MinDistance), false);
+        auto data = pPatterns->getPackedData();
+        EXPECT_EQ(data.size(), 8 * 256);
+
+        auto loadWord = [&](size_t address)
+        {
+            uint32_t word;
+            std::memcpy(&word, data.data() + address, sizeof(word));
+            return word;
+        };
+
+        // Decode with the same addressing as SpatialReuse.cs.slang.
+        for (uint32_t pattern = 0; pattern < 8; pattern++)
+        {
+            for (uint32_t pixelInBlockId = 0; pixelInBlockId < 256; pixelInBlockId++)
+            {
+                const uint32_t x = pixelInBlockId % 16, y = pixelInBlockId / 16;
+                const uint32_t byteAddress = pixelInBlockId / 2;
+                const uint32_t word = loadWord(pattern * 256 + 128 + 4 * (byteAddress / 4));
+                const uint32_t groupId = (word >> (8 * (byteAddress % 4)) >> (4 * (pixelInBlockId % 2))) & 0xf;
+                EXPECT_EQ(groupId, pPatterns->getGroup(pattern, x, y));
+
+                const uint32_t words[2] = { loadWord(pattern * 256 + groupId * 8), loadWord(pattern * 256 + groupId * 8 + 4) };
+                for (uint32_t i = 0; i < 16; i++)
+                {
+                    const uint32_t rowId = (words[i / 8] >> (4 * (i % 8))) & 0xf;
+                    EXPECT_EQ(pPatterns->getGroup(pattern, i, rowId), groupId);
+                    if (i == x) EXPECT_EQ(rowId, y);
+                }
+            }
+        }
+    }
+
+    CPU_TEST(NRooksPatterns_Serialization)
+    {
+        auto desc = makeDesc(16, 16, NRooksPatterns::Optimization::MinDistance, 7);
+        auto pPatterns = NRooksPatterns::create(desc, false);
+
+        // Generation is deterministic.
+        auto pPatterns2 = NRooksPatterns::create(desc, false);
+        EXPECT(pPatterns->getPackedData() == pPatterns2->getPackedData());
+
+        // Round trip through the binary format, which stores 4 bits per pixel.
+        std::filesystem::path path = getTempFilename();
+        pPatterns->write(path);
+        EXPECT_EQ(std::filesystem::file_size(path), 28 + 16 * 128);
+        auto pLoaded = NRooksPatterns::read(path);
+        EXPECT(pLoaded->getDesc() == desc);
+        EXPECT(pLoaded->getPackedData() == pPatterns->getPackedData());
+
+        // Corrupt patterns are rejected.
+        {
+            std::fstream fs(path, std::ios_base::binary | std::ios_base::in | std::ios_base::out);
+            fs.seekp(28);
+            char c = 0x11;
+            fs.write(&c, 1);
+        }
+        bool failed = false;
+        try
+        {
+            NRooksPatterns::read(path);
+        }
+        catch (const std::exception&)
+        {
+            failed = true;
+        }
+        EXPECT(failed);
+        std::filesystem::remove(path);
+    }
+}
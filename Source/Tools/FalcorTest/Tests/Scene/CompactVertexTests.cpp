@@ -0,0 +1,179 @@
+/***************************************************************************
+ # Copyright (c) 2015-21, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "Testing/UnitTest.h"
+#include "Scene/SceneTypes.slang"
+#include <random>
+
+namespace Falcor
+{
+    namespace
+    {
+        // Expected worst-case errors of the compact vertex format.
+        // The direction bounds are slightly above the measured max errors of the octahedral encodings.
+        const float kMaxNormalAngle = glm::radians(0.1f);       // 2x 12-bit octahedral.
+        const float kMaxTangentAngle = glm::radians(0.3f);      // 2x 10-bit octahedral.
+        const float kMaxTexCrdRelError = 1.f / 2048.f;          // fp16 with round-to-nearest.
+
+        float3 randomDirection(std::mt19937& rng)
+        {
+            std::normal_distribution<float> dist;
+            float3 d;
+            do { d = float3(dist(rng), dist(rng), dist(rng)); } while (glm::length(d) < 1e-3f);
+            return glm::normalize(d);
+        }
+
+        float angle(const float3& a, const float3& b)
+        {
+            return std::acos(glm::clamp(glm::dot(a, b), -1.f, 1.f));
+        }
+    }
+
+    CPU_TEST(CompactStaticVertexData_RoundTrip)
+    {
+        std::mt19937 rng;
+        std::uniform_real_distribution<float> u;
+
+        // Test a few bounding boxes of very different scales.
+        const AABB boxes[] =
+        {
+            AABB(float3(0.f), float3(1.f)),
+            AABB(float3(-1e3f, -5.f, 20.f), float3(1e3f, 5.f, 40.f)),
+            AABB(float3(1e-3f, 2e-3f, 3e-3f), float3(2e-3f, 3e-3f, 5e-3f)),
+        };
+
+        for (const auto& box : boxes)
+        {
+            const VertexQuantization q = VertexQuantization::create(box.minPoint, box.maxPoint);
+            const float3 maxPositionError = box.extent() / float((1u << CompactStaticVertexData::kPositionBits) - 1) * 0.5f;
+
+            for (uint32_t i = 0; i < 10000; i++)
+            {
+                StaticVertexData v;
+                v.position = box.minPoint + float3(u(rng), u(rng), u(rng)) * box.extent();
+                v.normal = randomDirection(rng);
+                v.tangent = float4(randomDirection(rng), u(rng) < 0.5f ? 1.f : -1.f);
+                v.texCrd = float2(u(rng), u(rng)) * 2.f - 1.f;
+
+                CompactStaticVertexData packed;
+                packed.pack(v, q);
+                StaticVertexData r = packed.unpack(q);
+
+                for (int j = 0; j < 3; j++)
+                {
+                    // Allow a small slack for the float arithmetic in the dequantization.
+                    EXPECT_LE(std::abs(r.position[j] - v.position[j]), maxPositionError[j] * 1.01f) << "i = " << i << " j = " << j;
+                }
+                EXPECT_LE(angle(r.normal, v.normal), kMaxNormalAngle) << "i = " << i;
+                EXPECT_LE(angle(float3(r.tangent), float3(v.tangent)), kMaxTangentAngle) << "i = " << i;
+                EXPECT_EQ(r.tangent.w, v.tangent.w) << "i = " << i;
+                EXPECT_LE(std::abs(r.texCrd.x - v.texCrd.x), kMaxTexCrdRelError) << "i = " << i;
+                EXPECT_LE(std::abs(r.texCrd.y - v.texCrd.y), kMaxTexCrdRelError) << "i = " << i;
+            }
+        }
+    }
+
+    CPU_TEST(CompactStaticVertexData_FromPacked)
+    {
+        // The scene builder converts the full vertex format to the compact one. Check that going through
+        // PackedStaticVertexData only adds the (small) error of its fp16 normal on top of the compact format.
+        std::mt19937 rng;
+        std::uniform_real_distribution<float> u;
+
+        const AABB box(float3(-2.f, 0.f, 1.f), float3(3.f, 1.f, 8.f));
+        const VertexQuantization q = VertexQuantization::create(box.minPoint, box.maxPoint);
+        const float3 maxPositionError = box.extent() / float((1u << CompactStaticVertexData::kPositionBits) - 1) * 0.5f;
+
+        for (uint32_t i = 0; i < 10000; i++)
+        {
+            StaticVertexData v;
+            v.position = box.minPoint + float3(u(rng), u(rng), u(rng)) * box.extent();
+            v.normal = randomDirection(rng);
+            v.tangent = float4(randomDirection(rng), u(rng) < 0.5f ? 1.f : -1.f);
+            v.texCrd = float2(u(rng), u(rng));
+
+            const StaticVertexData full = PackedStaticVertexData(v).unpack();
+            EXPECT_EQ(full.position, v.position) << "i = " << i;
+            EXPECT_EQ(full.tangent.w, v.tangent.w) << "i = " << i;
+
+            CompactStaticVertexData packed;
+            packed.pack(full, q);
+            StaticVertexData r = packed.unpack(q);
+
+            for (int j = 0; j < 3; j++)
+            {
+                EXPECT_LE(std::abs(r.position[j] - v.position[j]), maxPositionError[j] * 1.01f) << "i = " << i << " j = " << j;
+            }
+            EXPECT_LE(angle(r.normal, v.normal), kMaxNormalAngle + glm::radians(0.05f)) << "i = " << i;
+            EXPECT_LE(angle(float3(r.tangent), float3(v.tangent)), kMaxTangentAngle + glm::radians(0.05f)) << "i = " << i;
+            EXPECT_EQ(r.tangent.w, v.tangent.w) << "i = " << i;
+        }
+    }
+
+    CPU_TEST(CompactStaticVertexData_ExactValues)
+    {
+        const VertexQuantization q = VertexQuantization::create(float3(-1.f), float3(1.f));
+
+        // Axis-aligned directions and simple texture coordinates should be represented exactly.
+        const float3 dirs[] = { float3(1, 0, 0), float3(-1, 0, 0), float3(0, 1, 0), float3(0, -1, 0), float3(0, 0, 1), float3(0, 0, -1) };
+        for (const auto& n : dirs)
+        {
+            StaticVertexData v;
+            v.position = n.x + n.y + n.z > 0.f ? float3(1.f) : float3(-1.f);
+            v.normal = n;
+            v.tangent = float4(n.y, n.z, n.x, -1.f);
+            v.texCrd = float2(0.5f, 0.25f);
+
+            CompactStaticVertexData packed;
+            packed.pack(v, q);
+            StaticVertexData r = packed.unpack(q);
+
+            for (int j = 0; j < 3; j++) EXPECT_LE(std::abs(r.position[j] - v.position[j]), 1e-6f) << "j = " << j;
+            EXPECT_EQ(r.normal, v.normal);
+            EXPECT_EQ(r.tangent, v.tangent);
+            EXPECT_EQ(r.texCrd, v.texCrd);
+        }
+
+        // An invalid tangent (w == 0) should be preserved.
+        StaticVertexData v;
+        v.normal = float3(0, 0, 1);
+        v.tangent = float4(0.f);
+
+        CompactStaticVertexData packed;
+        packed.pack(v, q);
+        StaticVertexData r = packed.unpack(q);
+        EXPECT_EQ(r.tangent, float4(0.f));
+
+        // Flat bounding boxes should not produce NaNs.
+        const VertexQuantization flat = VertexQuantization::create(float3(0.f, 1.f, 2.f), float3(1.f, 1.f, 3.f));
+        v.position = float3(0.5f, 1.f, 2.5f);
+        packed.pack(v, flat);
+        r = packed.unpack(flat);
+        EXPECT_EQ(r.position.y, 1.f);
+        EXPECT(!glm::any(glm::isnan(r.position)));
+    }
+}
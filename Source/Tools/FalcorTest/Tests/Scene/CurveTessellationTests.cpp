@@ -0,0 +1,389 @@
+/***************************************************************************
+ # Copyright (c) 2015-21, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "Testing/UnitTest.h"
+#include "Scene/Curves/CurveTessellation.h"
+#include "Utils/Math/MathHelpers.h"
+#include <random>
+
+namespace Falcor
+{
+    namespace
+    {
+        struct TestStrands
+        {
+            std::vector<int> vertexCounts;
+            std::vector<float3> controlPoints;
+            std::vector<float> widths;
+            std::vector<float2> UVs;
+        };
+
+        /** Creates random wavy strands with 2 to maxVertexCount control points each.
+            \param[in] curliness Scale of the random offsets between consecutive control points. Zero creates straight strands.
+        */
+        TestStrands createStrands(uint32_t strandCount, int maxVertexCount, float curliness, uint32_t seed = 0)
+        {
+            std::mt19937 rng(seed);
+            std::uniform_real_distribution<float> dist(-1.f, 1.f);
+            TestStrands strands;
+            for (uint32_t i = 0; i < strandCount; i++)
+            {
+                int vertexCount = 2 + (int)(rng() % (uint32_t)(maxVertexCount - 1));
+                strands.vertexCounts.push_back(vertexCount);
+                float3 p = float3(dist(rng), dist(rng), dist(rng)) * 10.f;
+                for (int j = 0; j < vertexCount; j++)
+                {
+                    strands.controlPoints.push_back(p);
+                    strands.widths.push_back(0.05f + 0.04f * dist(rng));
+                    strands.UVs.push_back(float2((float)i / strandCount, (float)j / vertexCount));
+                    p += float3(0.f, 1.f, 0.f) + curliness * float3(dist(rng), dist(rng), dist(rng));
+                }
+            }
+            return strands;
+        }
+
+        glm::mat4 createTransform()
+        {
+            // Rotation about z, uniform scale by 2, and a translation.
+            const float c = std::cos(0.3f), s = std::sin(0.3f);
+            glm::mat4 xform(1.f);
+            xform[0] = float4(2.f * c, 2.f * s, 0.f, 0.f);
+            xform[1] = float4(-2.f * s, 2.f * c, 0.f, 0.f);
+            xform[2] = float4(0.f, 0.f, 2.f, 0.f);
+            xform[3] = float4(1.f, -2.f, 3.f, 1.f);
+            return xform;
+        }
+
+        // Serial reference implementations matching the original CurveTessellation code.
+
+        float4 referenceTransformSphere(const glm::mat4& xform, const float4& sphere)
+        {
+            float3 q = sphere.xyz + float3(sphere.w, 0, 0);
+            float4 xp = xform * float4(sphere.xyz, 1.f);
+            float4 xq = xform * float4(q, 1.f);
+            float xr = glm::length(xq.xyz - xp.xyz);
+            return float4(xp.xyz, xr);
+        }
+
+        CurveTessellation::SweptSphereResult referenceConvertToLinearSweptSphere(size_t strandCount, const int* vertexCountsPerStrand, const float3* controlPoints, const float* widths, const float2* UVs, uint32_t subdivPerSegment, uint32_t keepOneEveryXPerStrand, const glm::mat4& xform)
+        {
+            CurveTessellation::SweptSphereResult result;
+            result.degree = 1;
+
+            uint32_t pointOffset = 0;
+            for (uint32_t i = 0; i < strandCount; i++)
+            {
+                CubicSpline strandPoints(controlPoints + pointOffset, vertexCountsPerStrand[i]);
+                CubicSpline strandWidths(widths + pointOffset, vertexCountsPerStrand[i]);
+
+                uint32_t tmpCount = 0;
+                for (uint32_t j = 0; j < (uint32_t)vertexCountsPerStrand[i] - 1; j++)
+                {
+                    for (uint32_t k = 0; k < subdivPerSegment; k++)
+                    {
+                        if (tmpCount % keepOneEveryXPerStrand == 0)
+                        {
+                            float t = (float)k / (float)subdivPerSegment;
+                            result.indices.push_back((uint32_t)result.points.size());
+                            float4 sph = referenceTransformSphere(xform, float4(strandPoints.interpolate(j, t), strandWidths.interpolate(j, t) * 0.5f));
+                            result.points.push_back(sph.xyz);
+                            result.radius.push_back(sph.w);
+                        }
+                        tmpCount++;
+                    }
+                }
+
+                float4 sph = referenceTransformSphere(xform, float4(strandPoints.interpolate(vertexCountsPerStrand[i] - 2, 1.f), strandWidths.interpolate(vertexCountsPerStrand[i] - 2, 1.f) * 0.5f));
+                result.points.push_back(sph.xyz);
+                result.radius.push_back(sph.w);
+
+                if (UVs)
+                {
+                    CubicSpline strandUVs(UVs + pointOffset, vertexCountsPerStrand[i]);
+                    tmpCount = 0;
+                    for (uint32_t j = 0; j < (uint32_t)vertexCountsPerStrand[i] - 1; j++)
+                    {
+                        for (uint32_t k = 0; k < subdivPerSegment; k++)
+                        {
+                            if (tmpCount % keepOneEveryXPerStrand == 0)
+                            {
+                                float t = (float)k / (float)subdivPerSegment;
+                                result.texCrds.push_back(strandUVs.interpolate(j, t));
+                            }
+                            tmpCount++;
+                        }
+                    }
+                    result.texCrds.push_back(strandUVs.interpolate(vertexCountsPerStrand[i] - 2, 1.f));
+                }
+
+                pointOffset += vertexCountsPerStrand[i];
+            }
+            return result;
+        }
+
+        CurveTessellation::MeshResult referenceConvertToMesh(size_t strandCount, const int* vertexCountsPerStrand, const float3* controlPoints, const float* widths, const float2* UVs, uint32_t subdivPerSegment, uint32_t pointCountPerCrossSection)
+        {
+            CurveTessellation::MeshResult result;
+            uint32_t pointOffset = 0;
+            uint32_t meshVertexOffset = 0;
+            for (uint32_t i = 0; i < strandCount; i++)
+            {
+                CubicSpline strandPoints(controlPoints + pointOffset, vertexCountsPerStrand[i]);
+                CubicSpline strandWidths(widths + pointOffset, vertexCountsPerStrand[i]);
+
+                std::vector<float3> curvePoints;
+                std::vector<float> curveRadius;
+                std::vector<float2> curveUVs;
+
+                curvePoints.push_back(strandPoints.interpolate(0, 0.f));
+                curveRadius.push_back(strandWidths.interpolate(0, 0.f) * 0.5f);
+                for (uint32_t j = 0; j < (uint32_t)vertexCountsPerStrand[i] - 1; j++)
+                {
+                    for (uint32_t k = 1; k <= subdivPerSegment; k++)
+                    {
+                        float t = (float)k / (float)subdivPerSegment;
+                        curvePoints.push_back(strandPoints.interpolate(j, t));
+                        curveRadius.push_back(strandWidths.interpolate(j, t) * 0.5f);
+                    }
+                }
+
+                if (UVs)
+                {
+                    CubicSpline strandUVs(UVs + pointOffset, vertexCountsPerStrand[i]);
+                    curveUVs.push_back(strandUVs.interpolate(0, 0.f));
+                    for (uint32_t j = 0; j < (uint32_t)vertexCountsPerStrand[i] - 1; j++)
+                    {
+                        for (uint32_t k = 1; k <= subdivPerSegment; k++)
+                        {
+                            float t = (float)k / (float)subdivPerSegment;
+                            curveUVs.push_back(strandUVs.interpolate(j, t));
+                        }
+                    }
+                }
+
+                pointOffset += vertexCountsPerStrand[i];
+
+                for (uint32_t j = 0; j < curvePoints.size(); j++)
+                {
+                    float3 fwd, s, t;
+                    if (j < curvePoints.size() - 1) fwd = normalize(curvePoints[j + 1] - curvePoints[j]);
+                    else fwd = normalize(curvePoints[j] - curvePoints[j - 1]);
+                    buildFrame(fwd, s, t);
+
+                    for (uint32_t k = 0; k < pointCountPerCrossSection; k++)
+                    {
+                        float phi = (float)k / (float)pointCountPerCrossSection * (float)M_PI * 2.f;
+                        float3 vNormal = std::cos(phi) * s + std::sin(phi) * t;
+                        result.vertices.push_back(curvePoints[j] + curveRadius[j] * vNormal);
+                        result.normals.push_back(vNormal);
+                        result.tangents.push_back(float4(fwd.x, fwd.y, fwd.z, 1));
+                        if (UVs) result.texCrds.push_back(curveUVs[j]);
+                    }
+
+                    if (j < curvePoints.size() - 1)
+                    {
+                        for (uint32_t k = 0; k < pointCountPerCrossSection; k++)
+                        {
+                            result.faceVertexCounts.push_back(3);
+                            result.faceVertexIndices.push_back(meshVertexOffset + j * pointCountPerCrossSection + k);
+                            result.faceVertexIndices.push_back(meshVertexOffset + j * pointCountPerCrossSection + (k + 1) % pointCountPerCrossSection);
+                            result.faceVertexIndices.push_back(meshVertexOffset + (j + 1) * pointCountPerCrossSection + (k + 1) % pointCountPerCrossSection);
+
+                            result.faceVertexCounts.push_back(3);
+                            result.faceVertexIndices.push_back(meshVertexOffset + j * pointCountPerCrossSection + k);
+                            result.faceVertexIndices.push_back(meshVertexOffset + (j + 1) * pointCountPerCrossSection + (k + 1) % pointCountPerCrossSection);
+                            result.faceVertexIndices.push_back(meshVertexOffset + (j + 1) * pointCountPerCrossSection + k);
+                        }
+                    }
+                }
+
+                meshVertexOffset += pointCountPerCrossSection * (uint32_t)curvePoints.size();
+            }
+            return result;
+        }
+
+        template<typename T>
+        bool equal(const std::vector<T>& a, const std::vector<T>& b)
+        {
+            return a.size() == b.size() && std::memcmp(a.data(), b.data(), a.size() * sizeof(T)) == 0;
+        }
+    }
+
+    CPU_TEST(CurveTessellation_SweptSphereFixed)
+    {
+        TestStrands strands = createStrands(200, 12, 0.5f);
+        const glm::mat4 xform = createTransform();
+
+        for (uint32_t subdiv : { 1, 3, 4 })
+        {
+            for (uint32_t keep : { 1, 2, 3, 5 })
+            {
+                for (bool useUVs : { false, true })
+                {
+                    const float2* pUVs = useUVs ? strands.UVs.data() : nullptr;
+                    auto ref = referenceConvertToLinearSweptSphere(strands.vertexCounts.size(), strands.vertexCounts.data(), strands.controlPoints.data(), strands.widths.data(), pUVs, subdiv, keep, xform);
+                    auto result = CurveTessellation::convertToLinearSweptSphere(strands.vertexCounts.size(), strands.vertexCounts.data(), strands.controlPoints.data(), strands.widths.data(), pUVs, 1, subdiv, keep, xform);
+
+                    EXPECT_EQ(result.degree, 1u);
+                    EXPECT(equal(result.indices, ref.indices)) << "subdiv=" << subdiv << " keep=" << keep;
+                    EXPECT(equal(result.points, ref.points)) << "subdiv=" << subdiv << " keep=" << keep;
+                    EXPECT(equal(result.radius, ref.radius)) << "subdiv=" << subdiv << " keep=" << keep;
+                    EXPECT(equal(result.texCrds, ref.texCrds)) << "subdiv=" << subdiv << " keep=" << keep << " UVs=" << useUVs;
+                }
+            }
+        }
+    }
+
+    CPU_TEST(CurveTessellation_MeshFixed)
+    {
+        TestStrands strands = createStrands(100, 10, 0.5f);
+
+        for (uint32_t subdiv : { 1, 2, 4 })
+        {
+            for (uint32_t pointCount : { 3, 4, 8 })
+            {
+                auto ref = referenceConvertToMesh(strands.vertexCounts.size(), strands.vertexCounts.data(), strands.controlPoints.data(), strands.widths.data(), strands.UVs.data(), subdiv, pointCount);
+                auto result = CurveTessellation::convertToMesh(strands.vertexCounts.size(), strands.vertexCounts.data(), strands.controlPoints.data(), strands.widths.data(), strands.UVs.data(), subdiv, pointCount);
+
+                EXPECT(equal(result.vertices, ref.vertices)) << "subdiv=" << subdiv << " pointCount=" << pointCount;
+                EXPECT(equal(result.normals, ref.normals)) << "subdiv=" << subdiv << " pointCount=" << pointCount;
+                EXPECT(equal(result.tangents, ref.tangents)) << "subdiv=" << subdiv << " pointCount=" << pointCount;
+                EXPECT(equal(result.faceVertexCounts, ref.faceVertexCounts)) << "subdiv=" << subdiv << " pointCount=" << pointCount;
+                EXPECT(equal(result.faceVertexIndices, ref.faceVertexIndices)) << "subdiv=" << subdiv << " pointCount=" << pointCount;
+                EXPECT(equal(result.texCrds, ref.texCrds)) << "subdiv=" << subdiv << " pointCount=" << pointCount;
+            }
+        }
+    }
+
+    CPU_TEST(CurveTessellation_CallerBuffers)
+    {
+        TestStrands strands = createStrands(50, 8, 0.5f);
+        const glm::mat4 xform = createTransform();
+
+        CurveTessellation::TessellationOptions options;
+        options.subdivPerSegment = 3;
+        options.keepOneEveryXPerStrand = 2;
+        auto layout = CurveTessellation::computeStrandLayout(strands.vertexCounts.size(), strands.vertexCounts.data(), strands.controlPoints.data(), strands.widths.data(), options, xform);
+        auto ref = CurveTessellation::convertToLinearSweptSphere(strands.vertexCounts.size(), strands.vertexCounts.data(), strands.controlPoints.data(), strands.widths.data(), strands.UVs.data(), 1, options, xform);
+        EXPECT_EQ(layout.getPointCount(), ref.points.size());
+        EXPECT_EQ(layout.getSegmentCount(), ref.indices.size());
+
+        // Append to buffers that already hold some data and check that nothing outside the output range is touched.
+        const uint32_t kPrefix = 7;
+        const uint32_t kGuard = 0xdeadbeef;
+        std::vector<uint32_t> indices(kPrefix + layout.getSegmentCount() + 1, kGuard);
+        std::vector<float3> points(kPrefix + layout.getPointCount() + 1, float3(-1.f));
+        std::vector<float> radius(kPrefix + layout.getPointCount() + 1, -1.f);
+        std::vector<float2> texCrds(kPrefix + layout.getPointCount() + 1, float2(-1.f));
+
+        CurveTessellation::SweptSphereBuffers buffers;
+        buffers.pIndices = indices.data() + kPrefix;
+        buffers.pPoints = points.data() + kPrefix;
+        buffers.pRadius = radius.data() + kPrefix;
+        buffers.pTexCrds = texCrds.data() + kPrefix;
+        CurveTessellation::tessellateLinearSweptSphere(layout, strands.vertexCounts.data(), strands.controlPoints.data(), strands.widths.data(), strands.UVs.data(), xform, buffers, kPrefix);
+
+        EXPECT_EQ(indices[kPrefix - 1], kGuard);
+        EXPECT_EQ(indices.back(), kGuard);
+        EXPECT_EQ(radius[kPrefix - 1], -1.f);
+        EXPECT_EQ(radius.back(), -1.f);
+        for (size_t i = 0; i < ref.indices.size(); i++) EXPECT_EQ(indices[kPrefix + i], ref.indices[i] + kPrefix) << "i=" << i;
+        for (size_t i = 0; i < ref.points.size(); i++)
+        {
+            EXPECT(points[kPrefix + i] == ref.points[i]) << "i=" << i;
+            EXPECT_EQ(radius[kPrefix + i], ref.radius[i]) << "i=" << i;
+            EXPECT(texCrds[kPrefix + i] == ref.texCrds[i]) << "i=" << i;
+        }
+    }
+
+    CPU_TEST(CurveTessellation_Adaptive)
+    {
+        const glm::mat4 xform = createTransform();
+        CurveTessellation::TessellationOptions options;
+        options.subdivPerSegment = 16;
+        options.adaptive = true;
+
+        // Straight strands need a single sub-segment per cubic segment.
+        {
+            TestStrands strands = createStrands(50, 8, 0.f);
+            auto layout = CurveTessellation::computeStrandLayout(strands.vertexCounts.size(), strands.vertexCounts.data(), strands.controlPoints.data(), strands.widths.data(), options, xform);
+            for (uint32_t subdiv : layout.segmentSubdivs) EXPECT_EQ(subdiv, 1u);
+            EXPECT_EQ(layout.getPointCount(), layout.controlPointOffsets.back());
+        }
+
+        TestStrands strands = createStrands(100, 10, 1.f);
+        auto layout = CurveTessellation::computeStrandLayout(strands.vertexCounts.size(), strands.vertexCounts.data(), strands.controlPoints.data(), strands.widths.data(), options, xform);
+        EXPECT_EQ(layout.segmentSubdivs.size(), (size_t)layout.controlPointOffsets.back() - strands.vertexCounts.size());
+        uint32_t totalSubdiv = 0;
+        for (uint32_t subdiv : layout.segmentSubdivs)
+        {
+            EXPECT_GE(subdiv, 1u);
+            EXPECT_LE(subdiv, options.subdivPerSegment);
+            totalSubdiv += subdiv;
+        }
+        EXPECT_GT(totalSubdiv, (uint32_t)layout.segmentSubdivs.size());
+        EXPECT_EQ(layout.getPointCount(), totalSubdiv + (uint32_t)strands.vertexCounts.size());
+
+        // A looser tolerance never needs more sub-segments.
+        auto looseOptions = options;
+        looseOptions.maxDeviation = 1.f;
+        auto looseLayout = CurveTessellation::computeStrandLayout(strands.vertexCounts.size(), strands.vertexCounts.data(), strands.controlPoints.data(), strands.widths.data(), looseOptions, xform);
+        for (size_t i = 0; i < layout.segmentSubdivs.size(); i++) EXPECT_LE(looseLayout.segmentSubdivs[i], layout.segmentSubdivs[i]) << "i=" << i;
+
+        // Distant strands are tessellated more coarsely when the screen-space tolerance is enabled.
+        auto screenOptions = options;
+        screenOptions.pixelAngle = 0.001f;
+        screenOptions.viewPosition = float3(0.f, 0.f, 1000.f);
+        auto screenLayout = CurveTessellation::computeStrandLayout(strands.vertexCounts.size(), strands.vertexCounts.data(), strands.controlPoints.data(), strands.widths.data(), screenOptions, xform);
+        EXPECT_LT(screenLayout.getPointCount(), layout.getPointCount());
+
+        // Decimation keeps every X-th point plus the last point of each strand, in the same pass for both outputs.
+        auto full = CurveTessellation::convertToLinearSweptSphere(strands.vertexCounts.size(), strands.vertexCounts.data(), strands.controlPoints.data(), strands.widths.data(), strands.UVs.data(), 1, options, xform);
+        EXPECT_EQ(full.points.size(), layout.getPointCount());
+
+        auto decimatedOptions = options;
+        decimatedOptions.keepOneEveryXPerStrand = 3;
+        auto decimatedLayout = CurveTessellation::computeStrandLayout(strands.vertexCounts.size(), strands.vertexCounts.data(), strands.controlPoints.data(), strands.widths.data(), decimatedOptions, xform);
+        auto decimated = CurveTessellation::convertToLinearSweptSphere(strands.vertexCounts.size(), strands.vertexCounts.data(), strands.controlPoints.data(), strands.widths.data(), strands.UVs.data(), 1, decimatedOptions, xform);
+        auto decimatedMesh = CurveTessellation::convertToMesh(strands.vertexCounts.size(), strands.vertexCounts.data(), strands.controlPoints.data(), strands.widths.data(), strands.UVs.data(), decimatedOptions, 4);
+        EXPECT_EQ(decimated.points.size(), decimatedLayout.getPointCount());
+        EXPECT_EQ(decimatedMesh.vertices.size(), decimatedLayout.getMeshVertexCount(4));
+        EXPECT_EQ(decimatedMesh.faceVertexCounts.size(), decimatedLayout.getMeshFaceCount(4));
+
+        for (size_t i = 0; i < strands.vertexCounts.size(); i++)
+        {
+            const uint32_t fullBegin = layout.pointOffsets[i], fullEnd = layout.pointOffsets[i + 1];
+            const uint32_t begin = decimatedLayout.pointOffsets[i], end = decimatedLayout.pointOffsets[i + 1];
+            EXPECT_EQ(end - begin, (fullEnd - fullBegin - 2) / 3 + 2) << "strand=" << i;
+            for (uint32_t p = begin; p + 1 < end; p++)
+            {
+                EXPECT(decimated.points[p] == full.points[fullBegin + 3 * (p - begin)]) << "strand=" << i << " p=" << p;
+            }
+            EXPECT(decimated.points[end - 1] == full.points[fullEnd - 1]) << "strand=" << i;
+        }
+    }
+}
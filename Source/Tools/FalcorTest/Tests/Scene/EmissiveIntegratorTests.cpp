@@ -0,0 +1,302 @@
+/***************************************************************************
+ # Copyright (c) 2015-21, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "Testing/UnitTest.h"
+#include "Scene/Lights/EmissiveIntegrator.h"
+#include "Scene/SceneBuilder.h"
+#include <random>
+
+namespace Falcor
+{
+    namespace
+    {
+        const Sampler::AddressMode kAddressModes[] = { Sampler::AddressMode::Wrap, Sampler::AddressMode::Mirror, Sampler::AddressMode::Clamp, Sampler::AddressMode::Border, Sampler::AddressMode::MirrorOnce };
+
+        std::vector<float4> createTexels(uint32_t width, uint32_t height, uint32_t seed)
+        {
+            std::mt19937 rng(seed);
+            std::uniform_real_distribution<float> dist(0.f, 1.f);
+            std::vector<float4> texels(width * height);
+            for (auto& t : texels) t = float4(dist(rng), dist(rng), dist(rng), 1.f);
+            return texels;
+        }
+
+        /** Creates a random triangle in texture space with an extent of up to maxExtent texels.
+        */
+        void createTriangle(std::mt19937& rng, uint32_t width, uint32_t height, float maxExtent, float2 texCoords[3])
+        {
+            std::uniform_real_distribution<float> dist(0.f, 1.f);
+            const float2 center = float2(dist(rng) * 3.f - 1.f, dist(rng) * 3.f - 1.f);
+            for (uint32_t i = 0; i < 3; i++)
+            {
+                const float2 offset = float2(dist(rng) - 0.5f, dist(rng) - 0.5f) * maxExtent;
+                texCoords[i] = center + offset / float2((float)width, (float)height);
+            }
+        }
+
+        float edgeFunction(float2 a, float2 b, float2 p)
+        {
+            return (b.x - a.x) * (p.y - a.y) - (b.y - a.y) * (p.x - a.x);
+        }
+
+        /** Reference integration by stratified point sampling of the triangle with n x n samples per texel.
+        */
+        float3 integrateReference(const EmissiveIntegrator::TexelData& texels, const float2 texCoords[3], uint32_t n)
+        {
+            const float2 dim = float2((float)texels.getWidth(), (float)texels.getHeight());
+            const float2 uvMin = glm::min(glm::min(texCoords[0], texCoords[1]), texCoords[2]);
+            const float2 uvMax = glm::max(glm::max(texCoords[0], texCoords[1]), texCoords[2]);
+            const int64_t x0 = (int64_t)std::floor(uvMin.x * dim.x), y0 = (int64_t)std::floor(uvMin.y * dim.y);
+            const int64_t x1 = (int64_t)std::ceil(uvMax.x * dim.x), y1 = (int64_t)std::ceil(uvMax.y * dim.y);
+            const float sign = edgeFunction(texCoords[0], texCoords[1], texCoords[2]) < 0.f ? -1.f : 1.f;
+
+            double sum[3] = {};
+            uint64_t count = 0;
+            for (int64_t y = y0 * n; y < y1 * n; y++)
+            {
+                for (int64_t x = x0 * n; x < x1 * n; x++)
+                {
+                    const float2 uv = float2((x + 0.5f) / n, (y + 0.5f) / n) / dim;
+                    if (sign * edgeFunction(texCoords[0], texCoords[1], uv) < 0.f) continue;
+                    if (sign * edgeFunction(texCoords[1], texCoords[2], uv) < 0.f) continue;
+                    if (sign * edgeFunction(texCoords[2], texCoords[0], uv) < 0.f) continue;
+                    const float3 c = texels.sample(uv);
+                    for (int i = 0; i < 3; i++) sum[i] += c[i];
+                    count++;
+                }
+            }
+            return count > 0 ? float3(float(sum[0] / count), float(sum[1] / count), float(sum[2] / count)) : float3(0.f);
+        }
+
+        /** Creates a scene with a grid of emissive quads, with one textured and one untextured emissive material.
+        */
+        Scene::SharedPtr createEmissiveScene()
+        {
+            const uint32_t gridSize = 8, texWidth = 61, texHeight = 32;
+            std::vector<float3> positions, normals;
+            std::vector<float2> texCrds;
+            std::vector<uint32_t> indices;
+            for (uint32_t y = 0; y <= gridSize; y++)
+            {
+                for (uint32_t x = 0; x <= gridSize; x++)
+                {
+                    // Distort the grid so that the triangles have varying sizes, and let the uvs span more than one tile.
+                    const float u = (float)x / gridSize, v = (float)y / gridSize;
+                    positions.push_back(float3(u + 0.05f * std::sin(7.f * v), v, 0.1f * u * v));
+                    normals.push_back(float3(0.f, 0.f, 1.f));
+                    texCrds.push_back(float2(2.3f * u * u - 0.4f, 1.7f * v + 0.1f * u));
+                }
+            }
+            for (uint32_t y = 0; y < gridSize; y++)
+            {
+                for (uint32_t x = 0; x < gridSize; x++)
+                {
+                    const uint32_t i = y * (gridSize + 1) + x;
+                    indices.insert(indices.end(), { i, i + 1, i + gridSize + 2, i, i + gridSize + 2, i + gridSize + 1 });
+                }
+            }
+
+            const std::vector<float4> texels = createTexels(texWidth, texHeight, 5);
+            auto pTexturedMaterial = StandardMaterial::create("Textured");
+            pTexturedMaterial->setEmissiveTexture(Texture::create2D(texWidth, texHeight, ResourceFormat::RGBA32Float, 1, 1, texels.data()));
+            pTexturedMaterial->setEmissiveFactor(3.f);
+            auto pConstantMaterial = StandardMaterial::create("Constant");
+            pConstantMaterial->setEmissiveColor(float3(0.5f, 1.f, 2.f));
+
+            SceneBuilder::SharedPtr pBuilder = SceneBuilder::create();
+            SceneBuilder::Mesh mesh;
+            mesh.faceCount = (uint32_t)indices.size() / 3;
+            mesh.vertexCount = (uint32_t)positions.size();
+            mesh.indexCount = (uint32_t)indices.size();
+            mesh.pIndices = indices.data();
+            mesh.topology = Vao::Topology::TriangleList;
+            mesh.positions = { positions.data(), SceneBuilder::Mesh::AttributeFrequency::Vertex };
+            mesh.normals = { normals.data(), SceneBuilder::Mesh::AttributeFrequency::Vertex };
+            mesh.texCrds = { texCrds.data(), SceneBuilder::Mesh::AttributeFrequency::Vertex };
+
+            mesh.name = "Textured";
+            mesh.pMaterial = pTexturedMaterial;
+            const uint32_t texturedMeshID = pBuilder->addMesh(mesh);
+            mesh.name = "Constant";
+            mesh.pMaterial = pConstantMaterial;
+            const uint32_t constantMeshID = pBuilder->addMesh(mesh);
+
+            SceneBuilder::Node node;
+            node.name = "Textured";
+            node.transform = glm::scale(float4x4(1.f), float3(2.f, 2.f, 1.f));
+            pBuilder->addMeshInstance(pBuilder->addNode(node), texturedMeshID);
+            node.name = "Constant";
+            node.transform = glm::scale(glm::translate(float4x4(1.f), float3(0.f, 0.f, 1.f)), float3(-1.f, 1.f, 1.f));
+            pBuilder->addMeshInstance(pBuilder->addNode(node), constantMeshID);
+
+            return pBuilder->getScene();
+        }
+    }
+
+    CPU_TEST(EmissiveIntegrator_Constant)
+    {
+        const uint32_t width = 48, height = 20;
+        std::vector<float4> data(width * height, float4(0.25f, 0.5f, 2.f, 1.f));
+        auto pTexels = EmissiveIntegrator::TexelData::create(width, height, data.data());
+
+        std::mt19937 rng(0);
+        for (uint32_t i = 0; i < 100; i++)
+        {
+            float2 texCoords[3];
+            createTriangle(rng, width, height, 40.f, texCoords);
+
+            // The weight is the triangle area in texels.
+            float weight = 0.f;
+            const float3 result = EmissiveIntegrator::integrateTriangle(*pTexels, texCoords, true, &weight);
+            const float area = 0.5f * std::abs(edgeFunction(texCoords[0] * float2((float)width, (float)height), texCoords[1] * float2((float)width, (float)height), texCoords[2] * float2((float)width, (float)height)));
+            EXPECT_LE(std::abs(weight - area), 1e-3f * std::max(area, 1.f));
+
+            EXPECT_LE(std::abs(result.x - 0.25f), 1e-4f);
+            EXPECT_LE(std::abs(result.y - 0.5f), 1e-4f);
+            EXPECT_LE(std::abs(result.z - 2.f), 1e-4f);
+        }
+    }
+
+    CPU_TEST(EmissiveIntegrator_Reference)
+    {
+        // Compare against point sampling for triangles covering a few texels, using an NPOT texture.
+        const uint32_t width = 37, height = 23;
+        const std::vector<float4> data = createTexels(width, height, 1);
+        std::mt19937 rng(2);
+
+        for (auto addressMode : kAddressModes)
+        {
+            auto pTexels = EmissiveIntegrator::TexelData::create(width, height, data.data(), addressMode, addressMode);
+            for (uint32_t i = 0; i < 50; i++)
+            {
+                float2 texCoords[3];
+                createTriangle(rng, width, height, 12.f, texCoords);
+
+                float weight = 0.f;
+                const float3 result = EmissiveIntegrator::integrateTriangle(*pTexels, texCoords, true, &weight);
+                if (weight < 1.f) continue; // Skip slivers where point sampling is too noisy.
+                const float3 ref = integrateReference(*pTexels, texCoords, 32);
+                for (int c = 0; c < 3; c++) EXPECT_LE(std::abs(result[c] - ref[c]), 2e-2f) << "addressMode=" << (int)addressMode << " i=" << i;
+            }
+        }
+    }
+
+    CPU_TEST(EmissiveIntegrator_BlockSums)
+    {
+        // The block sum lookups should give the same result as visiting all covered texels, for POT and NPOT textures.
+        const uint32_t sizes[][2] = { { 256, 256 }, { 100, 60 }, { 1, 1 }, { 129, 7 } };
+        std::mt19937 rng(3);
+
+        for (const auto& size : sizes)
+        {
+            const std::vector<float4> data = createTexels(size[0], size[1], size[0] * size[1]);
+            for (auto addressMode : kAddressModes)
+            {
+                auto pTexels = EmissiveIntegrator::TexelData::create(size[0], size[1], data.data(), addressMode, addressMode);
+                for (uint32_t i = 0; i < 20; i++)
+                {
+                    float2 texCoords[3];
+                    createTriangle(rng, size[0], size[1], 300.f, texCoords);
+
+                    float weight = 0.f, weightRef = 0.f;
+                    const float3 result = EmissiveIntegrator::integrateTriangle(*pTexels, texCoords, true, &weight);
+                    const float3 ref = EmissiveIntegrator::integrateTriangle(*pTexels, texCoords, false, &weightRef);
+                    EXPECT_LE(std::abs(weight - weightRef), 1e-4f * std::max(weightRef, 1.f));
+                    for (int c = 0; c < 3; c++) EXPECT_LE(std::abs(result[c] - ref[c]), 1e-4f) << "size=" << size[0] << "x" << size[1] << " addressMode=" << (int)addressMode << " i=" << i;
+                }
+            }
+        }
+    }
+
+    CPU_TEST(EmissiveIntegrator_Degenerate)
+    {
+        // Triangles without area in texture space return the average of the texels at the vertices.
+        const uint32_t width = 16, height = 16;
+        const std::vector<float4> data = createTexels(width, height, 4);
+        auto pTexels = EmissiveIntegrator::TexelData::create(width, height, data.data());
+
+        const float2 texCoords[3] = { float2(0.125f, 0.125f), float2(0.5f, 0.3125f), float2(0.875f, 0.5f) };
+        float weight = 1.f;
+        const float3 result = EmissiveIntegrator::integrateTriangle(*pTexels, texCoords, true, &weight);
+        const float3 expected = (pTexels->sample(texCoords[0]) + pTexels->sample(texCoords[1]) + pTexels->sample(texCoords[2])) / 3.f;
+        EXPECT_EQ(weight, 0.f);
+        for (int c = 0; c < 3; c++) EXPECT_LE(std::abs(result[c] - expected[c]), 1e-6f);
+    }
+
+    GPU_TEST(LightCollection_HostBuild)
+    {
+        // Compare the emissive triangles built on the host with the ones built on the GPU.
+        if (!gpDevice->isFeatureSupported(Device::SupportedFeatures::ConservativeRasterizationTier3))
+        {
+            throw SkippingTestException("Conservative rasterization tier 3 is not supported");
+        }
+
+        RenderContext* pRenderContext = ctx.getRenderContext();
+        Scene::SharedPtr pScene = createEmissiveScene();
+        EXPECT_NE(pScene, nullptr);
+        if (pScene == nullptr) return;
+
+        auto pHost = LightCollection::create(pRenderContext, pScene, LightCollection::BuildMode::Host);
+        auto pDevice = LightCollection::create(pRenderContext, pScene, LightCollection::BuildMode::Device);
+        EXPECT(pHost && pDevice);
+        if (!pHost || !pDevice) return;
+        pHost->update(pRenderContext);
+        pDevice->update(pRenderContext);
+
+        EXPECT(pHost->isBuiltOnHost());
+        EXPECT(!pDevice->isBuiltOnHost());
+        EXPECT_EQ(pHost->getTotalLightCount(), pDevice->getTotalLightCount());
+        EXPECT_EQ(pHost->getActiveLightCount(), pDevice->getActiveLightCount());
+
+        const auto& hostTriangles = pHost->getMeshLightTriangles();
+        const auto& deviceTriangles = pDevice->getMeshLightTriangles();
+        EXPECT_EQ(hostTriangles.size(), deviceTriangles.size());
+        if (hostTriangles.size() != deviceTriangles.size()) return;
+
+        auto expectNear = [&](float a, float b, float relTol, size_t i)
+        {
+            EXPECT_LE(std::abs(a - b), relTol * std::max(std::abs(b), 1e-3f)) << "triangle " << i << ": " << a << " vs " << b;
+        };
+        for (size_t i = 0; i < hostTriangles.size(); i++)
+        {
+            const auto& h = hostTriangles[i];
+            const auto& d = deviceTriangles[i];
+            EXPECT_EQ(h.lightIdx, d.lightIdx);
+            for (uint32_t j = 0; j < 3; j++)
+            {
+                for (int c = 0; c < 3; c++) expectNear(h.vtx[j].pos[c], d.vtx[j].pos[c], 1e-5f, i);
+                for (int c = 0; c < 2; c++) EXPECT_EQ(h.vtx[j].uv[c], d.vtx[j].uv[c]) << "triangle " << i;
+            }
+            for (int c = 0; c < 3; c++) EXPECT_LE(std::abs(h.normal[c] - d.normal[c]), 1e-5f) << "triangle " << i;
+            expectNear(h.area, d.area, 1e-5f, i);
+
+            // The GPU integrator accumulates in single precision using atomics, so allow for some rounding difference.
+            for (int c = 0; c < 3; c++) expectNear(h.averageRadiance[c], d.averageRadiance[c], 1e-3f, i);
+            expectNear(h.flux, d.flux, 1e-3f, i);
+        }
+    }
+}
@@ -0,0 +1,358 @@
+/***************************************************************************
+ # Copyright (c) 2015-21, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "Testing/UnitTest.h"
+#include "Scene/HostRayTracer.h"
+#include "Utils/Timing/CpuTimer.h"
+#include <random>
+
+namespace Falcor
+{
+    namespace
+    {
+        using Ray = HostRayTracer::Ray;
+        using Hit = HostRayTracer::Hit;
+
+        /** Creates scene data with random triangle soups, instanced through a two-level scene graph.
+            Mesh 0 is non-indexed, mesh 1 uses 16-bit indices if the vertex count allows and the others 32-bit indices.
+        */
+        Scene::SceneData createSceneData(std::mt19937& rng, uint32_t meshCount, uint32_t triangleCount, uint32_t instanceCount)
+        {
+            std::uniform_real_distribution<float> u(0.f, 1.f);
+            auto randomFloat3 = [&]() { return float3(u(rng), u(rng), u(rng)); };
+
+            Scene::SceneData sceneData;
+            for (uint32_t meshID = 0; meshID < meshCount; meshID++)
+            {
+                MeshDesc mesh = {};
+                mesh.vbOffset = (uint32_t)sceneData.meshStaticData.size();
+                mesh.ibOffset = (uint32_t)sceneData.meshIndexData.size();
+                mesh.flags = meshID == 1 && triangleCount * 3 <= 0xffff ? (uint32_t)MeshFlags::Use16BitIndices : 0;
+
+                // Small triangles scattered in the unit cube. When indexed, every other triangle shares a vertex with the previous one.
+                std::vector<uint32_t> indices;
+                for (uint32_t t = 0; t < triangleCount; t++)
+                {
+                    const bool shareVertex = meshID != 0 && t % 2 == 1;
+                    const float3 center = shareVertex ? sceneData.meshStaticData.back().position : randomFloat3();
+                    if (shareVertex) indices.push_back((uint32_t)(sceneData.meshStaticData.size() - 1 - mesh.vbOffset));
+                    for (uint32_t v = shareVertex ? 1 : 0; v < 3; v++)
+                    {
+                        PackedStaticVertexData vertex = {};
+                        vertex.position = center + (randomFloat3() - 0.5f) * 0.05f;
+                        indices.push_back((uint32_t)(sceneData.meshStaticData.size() - mesh.vbOffset));
+                        sceneData.meshStaticData.push_back(vertex);
+                    }
+                }
+                mesh.vertexCount = (uint32_t)(sceneData.meshStaticData.size() - mesh.vbOffset);
+
+                if (meshID == 0)
+                {
+                    mesh.ibOffset = 0;
+                }
+                else if (mesh.use16BitIndices())
+                {
+                    mesh.indexCount = (uint32_t)indices.size();
+                    for (size_t i = 0; i < indices.size(); i += 2)
+                    {
+                        uint32_t hi = i + 1 < indices.size() ? indices[i + 1] : 0;
+                        sceneData.meshIndexData.push_back(indices[i] | (hi << 16));
+                    }
+                }
+                else
+                {
+                    mesh.indexCount = (uint32_t)indices.size();
+                    sceneData.meshIndexData.insert(sceneData.meshIndexData.end(), indices.begin(), indices.end());
+                }
+                sceneData.meshDesc.push_back(mesh);
+            }
+
+            // Root node with one child per instance.
+            sceneData.sceneGraph.push_back(Scene::Node("root", Scene::kInvalidNode, glm::translate(float3(0.5f, -1.f, 2.f)) * glm::scale(float3(2.f)), float4x4(1.f), float4x4(1.f)));
+            for (uint32_t i = 0; i < instanceCount; i++)
+            {
+                float4x4 transform = glm::translate(randomFloat3() * 4.f - 2.f) * glm::rotate(u(rng) * 6.28f, glm::normalize(randomFloat3() + 0.1f)) * glm::scale(randomFloat3() + 0.5f);
+                sceneData.sceneGraph.push_back(Scene::Node("node" + std::to_string(i), 0, transform, float4x4(1.f), float4x4(1.f)));
+
+                MeshInstanceData instance = {};
+                instance.globalMatrixID = i + 1;
+                instance.meshID = i % meshCount;
+                sceneData.meshInstanceData.push_back(instance);
+            }
+            return sceneData;
+        }
+
+        /** Brute force reference. Returns the closest hit distance, or infinity on miss.
+        */
+        double traceReference(const Scene::SceneData& sceneData, const std::vector<float4x4>& globalMatrices, const Ray& ray)
+        {
+            using double3 = glm::dvec3;
+            double tBest = std::numeric_limits<double>::infinity();
+            const double3 o = double3(ray.origin), d = double3(ray.dir);
+
+            for (const auto& instance : sceneData.meshInstanceData)
+            {
+                const MeshDesc& mesh = sceneData.meshDesc[instance.meshID];
+                const glm::dmat4 m = glm::dmat4(globalMatrices[instance.globalMatrixID]);
+                auto getVertex = [&](uint32_t i)
+                {
+                    uint32_t index = i;
+                    if (mesh.indexCount > 0)
+                    {
+                        uint32_t word = sceneData.meshIndexData[mesh.ibOffset + (mesh.use16BitIndices() ? i / 2 : i)];
+                        index = mesh.use16BitIndices() ? (word >> (16 * (i & 1))) & 0xffff : word;
+                    }
+                    return double3(m * glm::dvec4(double3(sceneData.meshStaticData[mesh.vbOffset + index].position), 1.0));
+                };
+
+                for (uint32_t t = 0; t < mesh.getTriangleCount(); t++)
+                {
+                    double3 v0 = getVertex(3 * t), e1 = getVertex(3 * t + 1) - v0, e2 = getVertex(3 * t + 2) - v0;
+                    double3 p = glm::cross(d, e2);
+                    double det = glm::dot(e1, p);
+                    if (det == 0.0) continue;
+                    double3 s = o - v0;
+                    double b1 = glm::dot(s, p) / det;
+                    double3 q = glm::cross(s, e1);
+                    double b2 = glm::dot(d, q) / det;
+                    double dist = glm::dot(e2, q) / det;
+                    if (b1 >= 0.0 && b2 >= 0.0 && b1 + b2 <= 1.0 && dist >= ray.tMin && dist <= ray.tMax) tBest = std::min(tBest, dist);
+                }
+            }
+            return tBest;
+        }
+
+        std::vector<float4x4> computeGlobalMatrices(const Scene::SceneData& sceneData)
+        {
+            std::vector<float4x4> globalMatrices(sceneData.sceneGraph.size());
+            for (size_t i = 0; i < globalMatrices.size(); i++)
+            {
+                const auto& node = sceneData.sceneGraph[i];
+                globalMatrices[i] = node.parent == Scene::kInvalidNode ? node.transform : globalMatrices[node.parent] * node.transform;
+            }
+            return globalMatrices;
+        }
+
+        /** Creates rays from random points around the scene towards random points inside it.
+        */
+        std::vector<Ray> createRays(std::mt19937& rng, const AABB& bounds, uint32_t rayCount)
+        {
+            std::uniform_real_distribution<float> u(0.f, 1.f);
+            std::vector<Ray> rays(rayCount);
+            for (auto& ray : rays)
+            {
+                float3 target = bounds.minPoint + float3(u(rng), u(rng), u(rng)) * bounds.extent();
+                ray.origin = bounds.center() + glm::normalize(float3(u(rng), u(rng), u(rng)) - 0.5f) * glm::length(bounds.extent());
+                ray.dir = glm::normalize(target - ray.origin);
+            }
+            return rays;
+        }
+
+        /** Compares the closest hits to the brute force reference.
+            Hits are allowed to differ for a small fraction of rays grazing triangle edges.
+        */
+        void testClosestHits(CPUUnitTestContext& ctx, const HostRayTracer& tracer, const Scene::SceneData& sceneData, const std::vector<float4x4>& globalMatrices, const std::vector<Ray>& rays)
+        {
+            std::vector<Hit> hits(rays.size());
+            tracer.traceClosestHit(rays.data(), hits.data(), rays.size());
+
+            uint32_t hitCount = 0;
+            uint32_t mismatchCount = 0;
+            for (size_t i = 0; i < rays.size(); i++)
+            {
+                double tRef = traceReference(sceneData, globalMatrices, rays[i]);
+                const Hit& hit = hits[i];
+                bool match = hit.isValid() == std::isfinite(tRef);
+                if (hit.isValid())
+                {
+                    hitCount++;
+                    match = match && std::abs(hit.t - tRef) <= 1e-4 * tRef;
+                    EXPECT(hit.type == HitType::Triangle);
+                    EXPECT_LT(hit.instanceID.index, (uint32_t)sceneData.meshInstanceData.size());
+                    EXPECT_LT(hit.primitiveIndex, sceneData.meshDesc[sceneData.meshInstanceData[hit.instanceID.index].meshID].getTriangleCount());
+                    EXPECT(hit.barycentrics.x >= 0.f && hit.barycentrics.y >= 0.f && hit.barycentrics.x + hit.barycentrics.y <= 1.f);
+                }
+                if (!match) mismatchCount++;
+            }
+
+            // Make sure the test is meaningful.
+            EXPECT_GT(hitCount, (uint32_t)rays.size() / 10);
+            EXPECT_LT(hitCount, (uint32_t)rays.size());
+            EXPECT_LE(mismatchCount, (uint32_t)rays.size() / 1000);
+        }
+    }
+
+    CPU_TEST(HostRayTracer_ClosestHit)
+    {
+        std::mt19937 rng(1);
+        Scene::SceneData sceneData = createSceneData(rng, 5, 2000, 20);
+        auto pTracer = HostRayTracer::create(sceneData);
+        EXPECT_EQ(pTracer->getStats().meshCount, 5u);
+        EXPECT_EQ(pTracer->getStats().instanceCount, 20u);
+        EXPECT_EQ(pTracer->getStats().triangleCount, 10000ull);
+
+        auto globalMatrices = computeGlobalMatrices(sceneData);
+        auto rays = createRays(rng, pTracer->getBounds(), 4000);
+        testClosestHits(ctx, *pTracer, sceneData, globalMatrices, rays);
+
+        // The batched and single ray queries return the same hits.
+        for (size_t i = 0; i < 100; i++)
+        {
+            Hit hit = pTracer->traceClosestHit(rays[i]);
+            Hit batchHit;
+            pTracer->traceClosestHit(&rays[i], &batchHit, 1);
+            EXPECT(hit.type == batchHit.type);
+            EXPECT_EQ(hit.instanceID.index, batchHit.instanceID.index);
+            EXPECT_EQ(hit.primitiveIndex, batchHit.primitiveIndex);
+            EXPECT_EQ(hit.t, batchHit.t);
+        }
+    }
+
+    CPU_TEST(HostRayTracer_AnyHit)
+    {
+        std::mt19937 rng(2);
+        Scene::SceneData sceneData = createSceneData(rng, 3, 2000, 10);
+        auto pTracer = HostRayTracer::create(sceneData);
+        auto rays = createRays(rng, pTracer->getBounds(), 4000);
+
+        std::unique_ptr<bool[]> anyHits(new bool[rays.size()]);
+        pTracer->traceAnyHit(rays.data(), anyHits.get(), rays.size());
+
+        for (size_t i = 0; i < rays.size(); i++)
+        {
+            Hit hit = pTracer->traceClosestHit(rays[i]);
+            EXPECT_EQ(hit.isValid(), anyHits[i]);
+            if (!hit.isValid()) continue;
+
+            // The interval up to the closest hit is unoccluded, the interval including it is occluded.
+            Ray shortRay = rays[i];
+            shortRay.tMax = hit.t * 0.999f;
+            EXPECT(!pTracer->traceAnyHit(shortRay));
+            shortRay.tMax = hit.t * 1.001f;
+            EXPECT(pTracer->traceAnyHit(shortRay));
+        }
+    }
+
+    CPU_TEST(HostRayTracer_InstanceTransforms)
+    {
+        std::mt19937 rng(3);
+        Scene::SceneData sceneData = createSceneData(rng, 4, 2000, 12);
+        auto pTracer = HostRayTracer::create(sceneData);
+
+        // Move the instances and compare against the reference with the new transforms.
+        std::uniform_real_distribution<float> u(0.f, 1.f);
+        for (size_t i = 1; i < sceneData.sceneGraph.size(); i++)
+        {
+            sceneData.sceneGraph[i].transform = glm::translate(float3(u(rng), u(rng), u(rng))) * sceneData.sceneGraph[i].transform;
+        }
+        auto globalMatrices = computeGlobalMatrices(sceneData);
+        pTracer->setInstanceTransforms(globalMatrices);
+
+        auto rays = createRays(rng, pTracer->getBounds(), 2000);
+        testClosestHits(ctx, *pTracer, sceneData, globalMatrices, rays);
+    }
+
+    CPU_TEST(HostRayTracer_ConcurrentUpdate)
+    {
+        std::mt19937 rng(5);
+        Scene::SceneData sceneData = createSceneData(rng, 4, 2000, 12);
+        auto pTracer = HostRayTracer::create(sceneData);
+        auto rays = createRays(rng, pTracer->getBounds(), 500);
+
+        // Trace the rays with two sets of transforms.
+        std::vector<float4x4> globalMatrices[2];
+        std::vector<Hit> hits[2];
+        for (uint32_t k = 0; k < 2; k++)
+        {
+            std::uniform_real_distribution<float> u(0.f, 1.f);
+            for (size_t i = 1; i < sceneData.sceneGraph.size(); i++)
+            {
+                sceneData.sceneGraph[i].transform = glm::translate(float3(u(rng), u(rng), u(rng)) * 0.2f) * sceneData.sceneGraph[i].transform;
+            }
+            globalMatrices[k] = computeGlobalMatrices(sceneData);
+            pTracer->setInstanceTransforms(globalMatrices[k]);
+            hits[k].resize(rays.size());
+            pTracer->traceClosestHit(rays.data(), hits[k].data(), rays.size());
+        }
+
+        // Trace while the transforms are switched on another thread. Each hit must match one of the two sets of transforms.
+        std::atomic<bool> done = false;
+        std::thread updater([&]()
+        {
+            for (uint32_t i = 0; i < 1000; i++) pTracer->setInstanceTransforms(globalMatrices[i % 2]);
+            done = true;
+        });
+
+        uint32_t mismatchCount = 0;
+        do
+        {
+            for (size_t i = 0; i < rays.size(); i++)
+            {
+                Hit hit = pTracer->traceClosestHit(rays[i]);
+                bool matches = false;
+                for (uint32_t k = 0; k < 2; k++)
+                {
+                    matches |= hit.type == hits[k][i].type && hit.instanceID.index == hits[k][i].instanceID.index && hit.primitiveIndex == hits[k][i].primitiveIndex;
+                }
+                if (!matches) mismatchCount++;
+            }
+        } while (!done);
+        updater.join();
+        EXPECT_EQ(mismatchCount, 0u);
+    }
+
+    CPU_TEST(HostRayTracer_Empty)
+    {
+        Scene::SceneData sceneData;
+        auto pTracer = HostRayTracer::create(sceneData);
+        EXPECT(!pTracer->getBounds().valid());
+        EXPECT(!pTracer->traceClosestHit(Ray()).isValid());
+        EXPECT(!pTracer->traceAnyHit(Ray()));
+    }
+
+    CPU_TEST(HostRayTracer_Performance)
+    {
+        std::mt19937 rng(4);
+        Scene::SceneData sceneData = createSceneData(rng, 8, 50000, 64);
+        auto pTracer = HostRayTracer::create(sceneData);
+        auto rays = createRays(rng, pTracer->getBounds(), 1000000);
+
+        std::vector<Hit> hits(rays.size());
+        auto startTime = CpuTimer::getCurrentTimePoint();
+        pTracer->traceClosestHit(rays.data(), hits.data(), rays.size());
+        double closestHitTime = CpuTimer::calcDuration(startTime, CpuTimer::getCurrentTimePoint());
+
+        std::unique_ptr<bool[]> anyHits(new bool[rays.size()]);
+        startTime = CpuTimer::getCurrentTimePoint();
+        pTracer->traceAnyHit(rays.data(), anyHits.get(), rays.size());
+        double anyHitTime = CpuTimer::calcDuration(startTime, CpuTimer::getCurrentTimePoint());
+
+        const auto& stats = pTracer->getStats();
+        logInfo("HostRayTracer: " + std::to_string(stats.triangleCount * stats.instanceCount / stats.meshCount) + " triangles, build " + std::to_string(stats.buildTime) + " s, "
+            + std::to_string(rays.size() / (closestHitTime * 1e3)) + " Mrays/s closest hit, " + std::to_string(rays.size() / (anyHitTime * 1e3)) + " Mrays/s any hit.");
+    }
+}
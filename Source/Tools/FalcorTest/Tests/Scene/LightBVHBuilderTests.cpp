@@ -0,0 +1,556 @@
+/***************************************************************************
+ # Copyright (c) 2015-21, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "Testing/UnitTest.h"
+#include "Rendering/Lights/LightBVHBuilder.h"
+#include "Utils/Timing/CpuTimer.h"
+#include <numeric>
+#include <random>
+
+namespace Falcor
+{
+    namespace
+    {
+        using MeshLightTriangle = LightCollection::MeshLightTriangle;
+        using IncrementalBVH = LightBVHBuilder::IncrementalBVH;
+
+        const uint32_t kLightCount = 12;
+        const uint32_t kTrianglesPerLight = 40;
+        const uint64_t kInvalidBitmask = std::numeric_limits<uint64_t>::max();
+
+        struct TestLights
+        {
+            std::vector<MeshLightTriangle> triangles;
+            std::vector<MeshLightData> meshLights;
+        };
+
+        /** Creates mesh lights made of small triangles clustered around random centers.
+            Every tenth triangle has zero flux, so that it is culled with pre-integration.
+        */
+        TestLights createLights(std::mt19937& rng, uint32_t lightCount = kLightCount, uint32_t trianglesPerLight = kTrianglesPerLight)
+        {
+            std::uniform_real_distribution<float> u(0.f, 1.f);
+            auto randomFloat3 = [&]() { return float3(u(rng), u(rng), u(rng)); };
+
+            TestLights lights;
+            for (uint32_t lightIdx = 0; lightIdx < lightCount; lightIdx++)
+            {
+                MeshLightData light;
+                light.triangleOffset = (uint32_t)lights.triangles.size();
+                light.triangleCount = trianglesPerLight;
+                lights.meshLights.push_back(light);
+
+                const float3 center = randomFloat3() * 10.f;
+                const float3 up = glm::normalize(randomFloat3() - 0.5f);
+                for (uint32_t i = 0; i < trianglesPerLight; i++)
+                {
+                    MeshLightTriangle tri;
+                    const float3 p = center + randomFloat3();
+                    for (uint32_t j = 0; j < 3; j++) tri.vtx[j].pos = p + (randomFloat3() - 0.5f) * 0.1f;
+                    tri.lightIdx = lightIdx;
+                    tri.normal = glm::normalize(up + (randomFloat3() - 0.5f) * 0.5f);
+                    tri.flux = i % 10 == 9 ? 0.f : u(rng) + 0.1f;
+                    lights.triangles.push_back(tri);
+                }
+            }
+            return lights;
+        }
+
+        /** Creates mesh lights whose triangle centers are clustered so that the Morton build splits off one triangle per code bit.
+            Each light has one triangle per bit of the 63-bit Morton code, many triangles at the origin, and one at (1,1,1) that sets the bounds.
+        */
+        TestLights createClusteredLights(uint32_t lightCount, uint32_t originTriangleCount)
+        {
+            std::vector<float3> centers(originTriangleCount, float3(0.f));
+            for (uint32_t i = 0; i < 21; i++)
+            {
+                // The center of the grid cell that sets a single bit of the quantized coordinate.
+                const float c = (float(1u << i) + 0.5f) / 2097152.f;
+                centers.push_back(float3(c, 0.f, 0.f));
+                centers.push_back(float3(0.f, c, 0.f));
+                centers.push_back(float3(0.f, 0.f, c));
+            }
+            centers.push_back(float3(1.f));
+
+            TestLights lights;
+            for (uint32_t lightIdx = 0; lightIdx < lightCount; lightIdx++)
+            {
+                MeshLightData light;
+                light.triangleOffset = (uint32_t)lights.triangles.size();
+                light.triangleCount = (uint32_t)centers.size();
+                lights.meshLights.push_back(light);
+
+                for (const float3& center : centers)
+                {
+                    MeshLightTriangle tri;
+                    for (auto& v : tri.vtx) v.pos = center;
+                    tri.lightIdx = lightIdx;
+                    tri.normal = float3(0.f, 0.f, 1.f);
+                    tri.flux = 1.f;
+                    lights.triangles.push_back(tri);
+                }
+            }
+            return lights;
+        }
+
+        void moveLight(TestLights& lights, uint32_t lightIdx, float3 offset)
+        {
+            const MeshLightData& light = lights.meshLights[lightIdx];
+            for (uint32_t i = light.triangleOffset; i < light.triangleOffset + light.triangleCount; i++)
+            {
+                for (auto& v : lights.triangles[i].vtx) v.pos += offset;
+            }
+        }
+
+        /** BVH data as seen by the GPU, which only receives the parts written by the builder.
+        */
+        struct UploadedBVH
+        {
+            std::vector<PackedNode> nodes;
+            std::vector<uint32_t> triangleIndices;
+            std::vector<uint64_t> triangleBitmasks;
+
+            void upload(const IncrementalBVH& bvh, bool rebuilt)
+            {
+                if (rebuilt)
+                {
+                    nodes = bvh.nodes;
+                    triangleIndices = bvh.triangleIndices;
+                    triangleBitmasks = bvh.triangleBitmasks;
+                    return;
+                }
+                for (uint2 range : bvh.dirtyNodeRanges)
+                {
+                    std::copy(bvh.nodes.begin() + range.x, bvh.nodes.begin() + range.y, nodes.begin() + range.x);
+                }
+                for (uint2 range : bvh.dirtyTriangleIndexRanges)
+                {
+                    std::copy(bvh.triangleIndices.begin() + range.x, bvh.triangleIndices.begin() + range.y, triangleIndices.begin() + range.x);
+                }
+                for (uint2 range : bvh.dirtyBitmaskRanges)
+                {
+                    std::copy(bvh.triangleBitmasks.begin() + range.x, bvh.triangleBitmasks.begin() + range.y, triangleBitmasks.begin() + range.x);
+                }
+            }
+
+            /** Returns true if the uploaded data is identical to the data of the builder, i.e., no written part was missed.
+            */
+            bool matches(const IncrementalBVH& bvh) const
+            {
+                return nodes.size() == bvh.nodes.size() && std::memcmp(nodes.data(), bvh.nodes.data(), nodes.size() * sizeof(PackedNode)) == 0 &&
+                    triangleIndices == bvh.triangleIndices && triangleBitmasks == bvh.triangleBitmasks;
+            }
+        };
+
+        /** Returns true if any of the sorted ranges [x, y) overlaps [begin, end).
+        */
+        bool overlaps(const std::vector<uint2>& ranges, uint32_t begin, uint32_t end)
+        {
+            return std::any_of(ranges.begin(), ranges.end(), [&](uint2 range) { return range.x < end && begin < range.y; });
+        }
+
+        /** Evaluates the probability of sampling a triangle by traversing the BVH along the triangle's bitmask.
+            This mirrors the traversal in LightBVHSampler with uniform triangle sampling in the leaves.
+            \return The pdf, or -1 if the bitmask does not lead to a leaf containing the triangle.
+        */
+        template<typename BVH>
+        double evalPdf(const BVH& bvh, uint32_t triangleIdx, const float3& shadingPoint)
+        {
+            const uint64_t bitmask = bvh.triangleBitmasks[triangleIdx];
+            if (bitmask == kInvalidBitmask) return 0.0;
+
+            auto importance = [&](uint32_t nodeIndex)
+            {
+                const SharedNodeAttributes attribs = bvh.nodes[nodeIndex].getNodeAttributes();
+                const float3 d = attribs.origin - shadingPoint;
+                const float r = std::max(glm::length(attribs.extent), glm::length(d));
+                return (double)attribs.flux / (r * r);
+            };
+
+            double pdf = 1.0;
+            uint32_t nodeIndex = 0;
+            for (uint32_t depth = 0; !bvh.nodes[nodeIndex].isLeaf(); depth++)
+            {
+                if (depth >= 64) return -1.0;
+                const uint32_t leftIndex = nodeIndex + 1;
+                const uint32_t rightIndex = bvh.nodes[nodeIndex].getInternalNode().rightChildIdx;
+                const double leftImportance = importance(leftIndex), rightImportance = importance(rightIndex);
+                const double pLeft = leftImportance + rightImportance > 0.0 ? leftImportance / (leftImportance + rightImportance) : 0.5;
+                const bool right = (bitmask >> depth) & 1;
+                pdf *= right ? 1.0 - pLeft : pLeft;
+                nodeIndex = right ? rightIndex : leftIndex;
+            }
+
+            const LeafNode leaf = bvh.nodes[nodeIndex].getLeafNode();
+            for (uint32_t i = leaf.triangleOffset; i < leaf.triangleOffset + leaf.triangleCount; i++)
+            {
+                if (bvh.triangleIndices[i] == triangleIdx) return pdf / leaf.triangleCount;
+            }
+            return -1.0;
+        }
+
+        /** Checks that all included triangles can be sampled and that the pdfs sum to one.
+        */
+        template<typename BVH>
+        void checkPdfs(CPUUnitTestContext& ctx, const BVH& bvh, const TestLights& lights, const std::vector<float3>& shadingPoints)
+        {
+            for (const float3& p : shadingPoints)
+            {
+                double pdfSum = 0.0;
+                for (uint32_t i = 0; i < (uint32_t)lights.triangles.size(); i++)
+                {
+                    double pdf = evalPdf(bvh, i, p);
+                    if (lights.triangles[i].flux > 0.f) EXPECT_GT(pdf, 0.0) << "triangle " << i;
+                    else EXPECT_EQ(pdf, 0.0) << "triangle " << i;
+                    pdfSum += pdf;
+                }
+                EXPECT_LE(std::abs(pdfSum - 1.0), 1e-6) << "pdf sum " << pdfSum;
+            }
+        }
+
+        /** Computes the relative variance of estimating the unshadowed contribution sum(flux / distance^2) of all triangles
+            at a shading point by sampling a single triangle with the BVH. This is zero for perfect importance sampling.
+        */
+        template<typename BVH>
+        double evalRelativeVariance(const BVH& bvh, const TestLights& lights, const float3& shadingPoint)
+        {
+            double sum = 0.0;
+            double secondMoment = 0.0;
+            for (uint32_t i = 0; i < (uint32_t)lights.triangles.size(); i++)
+            {
+                const MeshLightTriangle& tri = lights.triangles[i];
+                const float3 d = tri.getCenter() - shadingPoint;
+                const double f = tri.flux / std::max(glm::dot(d, d), 1e-2f);
+                if (f == 0.0) continue;
+                sum += f;
+                secondMoment += f * f / evalPdf(bvh, i, shadingPoint);
+            }
+            return sum > 0.0 ? secondMoment / (sum * sum) - 1.0 : 0.0;
+        }
+
+        std::vector<float3> createShadingPoints(std::mt19937& rng, uint32_t count)
+        {
+            std::uniform_real_distribution<float> u(-2.f, 12.f);
+            std::vector<float3> points(count);
+            for (auto& p : points) p = float3(u(rng), u(rng), u(rng));
+            return points;
+        }
+
+        LightBVHBuilder::Options createOptions(bool allowRefitting)
+        {
+            LightBVHBuilder::Options options;
+            options.useIncrementalUpdates = true;
+            options.allowRefitting = allowRefitting;
+            return options;
+        }
+    }
+
+    CPU_TEST(LightBVHIncrementalStatic)
+    {
+        std::mt19937 rng(1);
+        TestLights lights = createLights(rng);
+        auto pBuilder = LightBVHBuilder::create(createOptions(true));
+
+        IncrementalBVH bvh;
+        pBuilder->buildIncremental(lights.triangles, lights.meshLights, bvh);
+        EXPECT(bvh.hasStatic);
+        EXPECT(!bvh.hasDynamic);
+        EXPECT_EQ(bvh.staticNodeOffset, 0);
+        EXPECT_EQ(bvh.dirtyNodeRanges.size(), 1);
+        EXPECT(bvh.dirtyNodeRanges[0] == uint2(0, bvh.nodes.size()));
+        checkPdfs(ctx, bvh, lights, createShadingPoints(rng, 8));
+
+        // Updating without moved lights does not touch the BVH.
+        EXPECT(!pBuilder->updateIncremental(lights.triangles, lights.meshLights, {}, bvh));
+        EXPECT(bvh.dirtyNodeRanges.empty());
+        EXPECT(bvh.dirtyTriangleIndexRanges.empty());
+        EXPECT(bvh.dirtyBitmaskRanges.empty());
+    }
+
+    CPU_TEST(LightBVHIncrementalMatchesRebuild)
+    {
+        std::mt19937 rng(2);
+        TestLights lights = createLights(rng);
+        const std::vector<float3> shadingPoints = createShadingPoints(rng, 8);
+        auto pBuilder = LightBVHBuilder::create(createOptions(false));
+
+        IncrementalBVH bvh;
+        UploadedBVH uploaded;
+        pBuilder->buildIncremental(lights.triangles, lights.meshLights, bvh);
+        uploaded.upload(bvh, true);
+
+        // Lights that move for the first time are moved out of the static subtree.
+        const std::vector<uint32_t> updatedLights = { 3, 4, 9 };
+        for (uint32_t lightIdx : updatedLights) moveLight(lights, lightIdx, float3(0.5f, 0.f, -0.25f));
+        EXPECT(pBuilder->updateIncremental(lights.triangles, lights.meshLights, updatedLights, bvh));
+        EXPECT(bvh.hasStatic && bvh.hasDynamic);
+        EXPECT_EQ(bvh.subtrees.size(), updatedLights.size());
+        uploaded.upload(bvh, true);
+
+        const uint32_t staticNodeOffset = bvh.staticNodeOffset;
+        const std::vector<PackedNode> staticNodes(bvh.nodes.begin() + staticNodeOffset, bvh.nodes.end());
+
+        for (uint32_t frame = 0; frame < 4; frame++)
+        {
+            for (uint32_t lightIdx : updatedLights) moveLight(lights, lightIdx, float3(std::sin(frame * 0.7f + lightIdx), 0.3f, std::cos(frame * 1.3f)) * 2.f);
+            EXPECT(!pBuilder->updateIncremental(lights.triangles, lights.meshLights, updatedLights, bvh));
+            EXPECT(!overlaps(bvh.dirtyNodeRanges, staticNodeOffset, (uint32_t)bvh.nodes.size()));
+            uploaded.upload(bvh, false);
+            EXPECT(uploaded.matches(bvh));
+
+            // The static subtree is not rewritten.
+            EXPECT_EQ(bvh.staticNodeOffset, staticNodeOffset);
+            EXPECT_EQ(std::memcmp(staticNodes.data(), bvh.nodes.data() + staticNodeOffset, staticNodes.size() * sizeof(PackedNode)), 0);
+
+            // Compare against a full rebuild with the same light classification.
+            IncrementalBVH reference;
+            reference.isDynamicLight = bvh.isDynamicLight;
+            pBuilder->buildIncremental(lights.triangles, lights.meshLights, reference);
+            EXPECT_EQ(reference.nodes.size(), bvh.nodes.size());
+            EXPECT(reference.triangleBitmasks == bvh.triangleBitmasks);
+
+            for (const float3& p : shadingPoints)
+            {
+                for (uint32_t i = 0; i < (uint32_t)lights.triangles.size(); i++)
+                {
+                    const double referencePdf = evalPdf(reference, i, p);
+                    EXPECT_EQ(evalPdf(bvh, i, p), referencePdf) << "triangle " << i;
+                    EXPECT_EQ(evalPdf(uploaded, i, p), referencePdf) << "triangle " << i;
+                }
+            }
+        }
+        checkPdfs(ctx, uploaded, lights, shadingPoints);
+    }
+
+    CPU_TEST(LightBVHIncrementalRefit)
+    {
+        std::mt19937 rng(3);
+        TestLights lights = createLights(rng);
+        const std::vector<float3> shadingPoints = createShadingPoints(rng, 8);
+        auto pBuilder = LightBVHBuilder::create(createOptions(true));
+
+        IncrementalBVH bvh;
+        UploadedBVH uploaded;
+        bvh.isDynamicLight.assign(kLightCount, false);
+        bvh.isDynamicLight[0] = bvh.isDynamicLight[7] = true;
+        pBuilder->buildIncremental(lights.triangles, lights.meshLights, bvh);
+        uploaded.upload(bvh, true);
+
+        const uint32_t staticNodeOffset = bvh.staticNodeOffset;
+        const std::vector<PackedNode> staticNodes(bvh.nodes.begin() + staticNodeOffset, bvh.nodes.end());
+        const std::vector<uint32_t> updatedLights = { 0, 7 };
+
+        for (uint32_t frame = 0; frame < 6; frame++)
+        {
+            for (uint32_t lightIdx : updatedLights) moveLight(lights, lightIdx, float3(1.f, -0.5f * frame, 0.25f));
+
+            // Cull the triangles of a dynamic light, which changes the hierarchy of its subtree.
+            if (frame == 3)
+            {
+                const MeshLightData& light = lights.meshLights[7];
+                for (uint32_t i = 0; i < light.triangleCount; i++) lights.triangles[light.triangleOffset + i].flux = 0.f;
+            }
+
+            EXPECT(!pBuilder->updateIncremental(lights.triangles, lights.meshLights, updatedLights, bvh));
+            uploaded.upload(bvh, false);
+            EXPECT(uploaded.matches(bvh));
+            EXPECT_EQ(std::memcmp(staticNodes.data(), bvh.nodes.data() + staticNodeOffset, staticNodes.size() * sizeof(PackedNode)), 0);
+            checkPdfs(ctx, uploaded, lights, shadingPoints);
+        }
+
+        // Culling all dynamic triangles changes the layout, which requires a rebuild.
+        const MeshLightData& light = lights.meshLights[0];
+        for (uint32_t i = 0; i < light.triangleCount; i++) lights.triangles[light.triangleOffset + i].flux = 0.f;
+        EXPECT(pBuilder->updateIncremental(lights.triangles, lights.meshLights, updatedLights, bvh));
+        EXPECT(!bvh.hasDynamic);
+        uploaded.upload(bvh, true);
+        checkPdfs(ctx, uploaded, lights, shadingPoints);
+    }
+
+    CPU_TEST(LightBVHIncrementalDirtySubtrees)
+    {
+        std::mt19937 rng(6);
+        TestLights lights = createLights(rng);
+        const std::vector<float3> shadingPoints = createShadingPoints(rng, 8);
+        auto pBuilder = LightBVHBuilder::create(createOptions(true));
+
+        // Place the dynamic lights far apart, so that moving one of them slightly does not change the top-level tree.
+        const std::vector<uint32_t> dynamicLights = { 2, 5, 8, 11 };
+        for (uint32_t i = 0; i < (uint32_t)dynamicLights.size(); i++) moveLight(lights, dynamicLights[i], float3(100.f * (i + 1), 0.f, 0.f));
+
+        IncrementalBVH bvh;
+        UploadedBVH uploaded;
+        bvh.isDynamicLight.assign(kLightCount, false);
+        for (uint32_t lightIdx : dynamicLights) bvh.isDynamicLight[lightIdx] = true;
+        pBuilder->buildIncremental(lights.triangles, lights.meshLights, bvh);
+        uploaded.upload(bvh, true);
+        EXPECT_EQ(bvh.subtrees.size(), dynamicLights.size());
+
+        for (uint32_t frame = 0; frame < 4; frame++)
+        {
+            const uint32_t movedLight = dynamicLights[frame];
+            moveLight(lights, movedLight, float3(0.f, 0.1f, -0.1f));
+            EXPECT(!pBuilder->updateIncremental(lights.triangles, lights.meshLights, { movedLight }, bvh));
+            uploaded.upload(bvh, false);
+            EXPECT(uploaded.matches(bvh));
+            checkPdfs(ctx, uploaded, lights, shadingPoints);
+
+            // Only the subtree of the moved light is rewritten. The nodes of the other subtrees, their triangle indices and bitmasks are untouched.
+            for (const auto& subtree : bvh.subtrees)
+            {
+                const MeshLightData& light = lights.meshLights[subtree.lightIndex];
+                const bool moved = subtree.lightIndex == movedLight;
+                const uint32_t nodeEnd = subtree.nodeOffset + (uint32_t)subtree.nodes.size();
+                const uint32_t triangleEnd = subtree.triangleOffset + (uint32_t)subtree.trianglesData.size();
+                EXPECT_EQ(overlaps(bvh.dirtyNodeRanges, subtree.nodeOffset, nodeEnd), moved) << "light " << subtree.lightIndex;
+                EXPECT_EQ(overlaps(bvh.dirtyTriangleIndexRanges, subtree.triangleOffset, triangleEnd), moved) << "light " << subtree.lightIndex;
+                EXPECT_EQ(overlaps(bvh.dirtyBitmaskRanges, light.triangleOffset, light.triangleOffset + light.triangleCount), moved) << "light " << subtree.lightIndex;
+            }
+
+            // Besides the moved subtree, only the top-level nodes above it and the root node are written.
+            uint32_t dirtyNodeCount = 0;
+            for (uint2 range : bvh.dirtyNodeRanges) dirtyNodeCount += range.y - range.x;
+            const uint32_t movedSubtreeNodeCount = (uint32_t)bvh.subtrees[bvh.lightSubtrees[movedLight]].nodes.size();
+            EXPECT_LE(dirtyNodeCount, movedSubtreeNodeCount + (uint32_t)dynamicLights.size());
+        }
+    }
+
+    CPU_TEST(LightBVHMorton)
+    {
+        for (bool useTreeletRestructuring : { false, true })
+        {
+            std::mt19937 rng(4);
+            TestLights lights = createLights(rng);
+            const std::vector<float3> shadingPoints = createShadingPoints(rng, 8);
+
+            LightBVHBuilder::Options options = createOptions(false);
+            options.splitHeuristicSelection = LightBVHBuilder::SplitHeuristic::Morton;
+            options.useTreeletRestructuring = useTreeletRestructuring;
+            auto pBuilder = LightBVHBuilder::create(options);
+
+            IncrementalBVH bvh;
+            UploadedBVH uploaded;
+            pBuilder->buildIncremental(lights.triangles, lights.meshLights, bvh);
+            uploaded.upload(bvh, true);
+            for (const PackedNode& node : bvh.nodes)
+            {
+                if (node.isLeaf()) EXPECT_LE(node.getLeafNode().triangleCount, options.maxTriangleCountPerLeaf);
+            }
+            checkPdfs(ctx, uploaded, lights, shadingPoints);
+
+            // The subtrees of the moving lights and the top-level tree are also built with the Morton build.
+            const std::vector<uint32_t> updatedLights = { 1, 5, 6 };
+            for (uint32_t frame = 0; frame < 3; frame++)
+            {
+                for (uint32_t lightIdx : updatedLights) moveLight(lights, lightIdx, float3(0.25f, -0.5f, 0.5f * frame));
+                const bool rebuilt = pBuilder->updateIncremental(lights.triangles, lights.meshLights, updatedLights, bvh);
+                EXPECT_EQ(rebuilt, frame == 0);
+                uploaded.upload(bvh, rebuilt);
+                checkPdfs(ctx, uploaded, lights, shadingPoints);
+            }
+        }
+    }
+
+    CPU_TEST(LightBVHMortonClustered)
+    {
+        // Splitting at every code bit and then the equal codes at the origin exceeds the maximum BVH depth.
+        // The Morton build falls back to middle splits near the limit, also for the subtrees of the incremental BVH.
+        const TestLights lights = createClusteredLights(2, 1024);
+        std::mt19937 rng(7);
+        const std::vector<float3> shadingPoints = createShadingPoints(rng, 4);
+
+        for (bool useTreeletRestructuring : { false, true })
+        {
+            for (bool createLeavesASAP : { false, true })
+            {
+                LightBVHBuilder::Options options = createOptions(false);
+                options.splitHeuristicSelection = LightBVHBuilder::SplitHeuristic::Morton;
+                options.useTreeletRestructuring = useTreeletRestructuring;
+                options.createLeavesASAP = createLeavesASAP;
+                auto pBuilder = LightBVHBuilder::create(options);
+
+                // Single static tree at depth 0.
+                IncrementalBVH bvh;
+                pBuilder->buildIncremental(lights.triangles, lights.meshLights, bvh);
+                EXPECT(!bvh.hasDynamic);
+                checkPdfs(ctx, bvh, lights, shadingPoints);
+
+                // Static subtree at depth 1 and a dynamic subtree below the top-level tree.
+                IncrementalBVH dynamicBVH;
+                dynamicBVH.isDynamicLight = { true, false };
+                pBuilder->buildIncremental(lights.triangles, lights.meshLights, dynamicBVH);
+                EXPECT(dynamicBVH.hasStatic && dynamicBVH.hasDynamic);
+                checkPdfs(ctx, dynamicBVH, lights, shadingPoints);
+            }
+        }
+    }
+
+    CPU_TEST(LightBVHMorton_Performance)
+    {
+        std::mt19937 rng(5);
+        const TestLights lights = createLights(rng, 256, 400);
+        const std::vector<float3> shadingPoints = createShadingPoints(rng, 64);
+
+        struct Config
+        {
+            std::string name;
+            LightBVHBuilder::SplitHeuristic splitHeuristic;
+            bool useTreeletRestructuring;
+        };
+        const Config configs[] =
+        {
+            { "BinnedSAOH", LightBVHBuilder::SplitHeuristic::BinnedSAOH, false },
+            { "Morton", LightBVHBuilder::SplitHeuristic::Morton, false },
+            { "Morton with treelet restructuring", LightBVHBuilder::SplitHeuristic::Morton, true },
+        };
+
+        for (const Config& config : configs)
+        {
+            LightBVHBuilder::Options options = createOptions(false);
+            options.splitHeuristicSelection = config.splitHeuristic;
+            options.useTreeletRestructuring = config.useTreeletRestructuring;
+            auto pBuilder = LightBVHBuilder::create(options);
+
+            IncrementalBVH bvh;
+            auto startTime = CpuTimer::getCurrentTimePoint();
+            pBuilder->buildIncremental(lights.triangles, lights.meshLights, bvh);
+            const double buildTime = CpuTimer::calcDuration(startTime, CpuTimer::getCurrentTimePoint());
+
+            // Sampling quality is measured by the variance of the light sampling estimator at the shading points.
+            // The average is dominated by the few points close to the lights, so the median is reported as well.
+            std::vector<double> variances;
+            for (const float3& p : shadingPoints) variances.push_back(evalRelativeVariance(bvh, lights, p));
+            const double averageVariance = std::accumulate(variances.begin(), variances.end(), 0.0) / variances.size();
+            std::nth_element(variances.begin(), variances.begin() + variances.size() / 2, variances.end());
+            const double medianVariance = variances[variances.size() / 2];
+            EXPECT(std::isfinite(averageVariance));
+
+            logInfo("LightBVHBuilder " + config.name + ": " + std::to_string(lights.triangles.size()) + " triangles, " + std::to_string(bvh.nodes.size()) + " nodes, build "
+                + std::to_string(buildTime) + " ms, relative variance average " + std::to_string(averageVariance) + ", median " + std::to_string(medianVariance));
+        }
+    }
+}
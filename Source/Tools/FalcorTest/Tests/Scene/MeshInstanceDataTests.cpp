@@ -0,0 +1,160 @@
+/***************************************************************************
+ # Copyright (c) 2015-21, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "Testing/UnitTest.h"
+#include "Scene/SceneTypes.slang"
+#include <random>
+
+namespace Falcor
+{
+    namespace
+    {
+        const uint32_t kMaxMatrixID = (1u << PackedMeshInstanceData::kMatrixBits) - 1;
+        const uint32_t kMaxMeshID = (1u << PackedMeshInstanceData::kMeshBits) - 1;
+        const uint32_t kMaxMaterialID = (1u << PackedMeshInstanceData::kMaterialBits) - 1;
+        const uint32_t kMaxFlags = (1u << PackedMeshInstanceData::kFlagsBits) - 1;
+        const uint32_t kMaxUint = std::numeric_limits<uint32_t>::max();
+
+        MeshInstanceData createInstance(uint32_t globalMatrixID, uint32_t materialID, uint32_t meshID, uint32_t flags, uint32_t vbOffset, uint32_t ibOffset)
+        {
+            MeshInstanceData d;
+            d.globalMatrixID = globalMatrixID;
+            d.materialID = materialID;
+            d.meshID = meshID;
+            d.flags = flags;
+            d.vbOffset = vbOffset;
+            d.ibOffset = ibOffset;
+            return d;
+        }
+
+        /** Generates test data with all fields at their boundary values and random values in between.
+            \param[in] maxIDs Max value of each field (globalMatrixID, materialID, meshID, flags).
+        */
+        std::vector<MeshInstanceData> createTestData(uint4 maxIDs)
+        {
+            std::vector<MeshInstanceData> testData;
+
+            // Each field at its min and max value while the others are at the opposite end, to catch bits spilling into neighboring fields.
+            testData.push_back(createInstance(0, 0, 0, 0, 0, 0));
+            testData.push_back(createInstance(maxIDs.x, maxIDs.y, maxIDs.z, maxIDs.w, kMaxUint, kMaxUint));
+            testData.push_back(createInstance(maxIDs.x, 0, 0, 0, 0, 0));
+            testData.push_back(createInstance(0, maxIDs.y, 0, 0, 0, 0));
+            testData.push_back(createInstance(0, 0, maxIDs.z, 0, 0, 0));
+            testData.push_back(createInstance(0, 0, 0, maxIDs.w, 0, 0));
+            testData.push_back(createInstance(0, maxIDs.y, maxIDs.z, maxIDs.w, kMaxUint, kMaxUint));
+            testData.push_back(createInstance(maxIDs.x, 0, maxIDs.z, maxIDs.w, kMaxUint, kMaxUint));
+            testData.push_back(createInstance(maxIDs.x, maxIDs.y, 0, maxIDs.w, kMaxUint, kMaxUint));
+            testData.push_back(createInstance(maxIDs.x, maxIDs.y, maxIDs.z, 0, kMaxUint, kMaxUint));
+
+            std::mt19937 rng;
+            auto randomID = [&](uint32_t maxID) { return (uint32_t)(rng() % (maxID + 1ull)); };
+            for (uint32_t i = 0; i < 1000; i++)
+            {
+                testData.push_back(createInstance(randomID(maxIDs.x), randomID(maxIDs.y), randomID(maxIDs.z), randomID(maxIDs.w), rng(), rng()));
+            }
+            return testData;
+        }
+
+        void expectEqual(UnitTestContext& ctx, const MeshInstanceData& result, const MeshInstanceData& expected, size_t i)
+        {
+            EXPECT_EQ(result.globalMatrixID, expected.globalMatrixID) << "i = " << i;
+            EXPECT_EQ(result.materialID, expected.materialID) << "i = " << i;
+            EXPECT_EQ(result.meshID, expected.meshID) << "i = " << i;
+            EXPECT_EQ(result.flags, expected.flags) << "i = " << i;
+            EXPECT_EQ(result.vbOffset, expected.vbOffset) << "i = " << i;
+            EXPECT_EQ(result.ibOffset, expected.ibOffset) << "i = " << i;
+        }
+
+        template<typename T>
+        void testDeviceUnpack(GPUUnitTestContext& ctx, const std::string& entryPoint, const std::string& bufferName, const std::vector<MeshInstanceData>& testData)
+        {
+            std::vector<T> packedData(testData.size());
+            for (size_t i = 0; i < testData.size(); i++) packedData[i].pack(testData[i]);
+
+            ctx.createProgram("Tests/Scene/MeshInstanceDataTests.cs.slang", entryPoint);
+            ctx["CB"]["n"] = (uint32_t)testData.size();
+            ctx.allocateStructuredBuffer(bufferName, (uint32_t)packedData.size(), packedData.data(), packedData.size() * sizeof(T));
+            ctx.allocateStructuredBuffer("result", (uint32_t)testData.size() * 6);
+            ctx.runProgram((uint32_t)testData.size());
+
+            const uint32_t* result = ctx.mapBuffer<const uint32_t>("result");
+            for (size_t i = 0; i < testData.size(); i++)
+            {
+                const uint32_t* r = result + i * 6;
+                expectEqual(ctx, createInstance(r[0], r[1], r[2], r[3], r[4], r[5]), testData[i], i);
+            }
+            ctx.unmapBuffer("result");
+        }
+    }
+
+    CPU_TEST(PackedMeshInstanceData_Limits)
+    {
+        const size_t maxMatrices = kMaxMatrixID + 1ull;
+        const size_t maxMeshes = kMaxMeshID + 1ull;
+        const size_t maxMaterials = kMaxMaterialID + 1ull;
+
+        EXPECT(PackedMeshInstanceData::isCompatible(0, 0, 0));
+        EXPECT(PackedMeshInstanceData::isCompatible(maxMatrices, maxMeshes, maxMaterials));
+        EXPECT(!PackedMeshInstanceData::isCompatible(maxMatrices + 1, maxMeshes, maxMaterials));
+        EXPECT(!PackedMeshInstanceData::isCompatible(maxMatrices, maxMeshes + 1, maxMaterials));
+        EXPECT(!PackedMeshInstanceData::isCompatible(maxMatrices, maxMeshes, maxMaterials + 1));
+    }
+
+    CPU_TEST(PackedMeshInstanceData_HostRoundTrip)
+    {
+        auto testData = createTestData(uint4(kMaxMatrixID, kMaxMaterialID, kMaxMeshID, kMaxFlags));
+        for (size_t i = 0; i < testData.size(); i++)
+        {
+            PackedMeshInstanceData packed;
+            packed.pack(testData[i]);
+            expectEqual(ctx, packed.unpack(), testData[i], i);
+        }
+    }
+
+    CPU_TEST(WideMeshInstanceData_HostRoundTrip)
+    {
+        auto testData = createTestData(uint4(kMaxUint));
+        for (size_t i = 0; i < testData.size(); i++)
+        {
+            WideMeshInstanceData packed;
+            packed.pack(testData[i]);
+            expectEqual(ctx, packed.unpack(), testData[i], i);
+        }
+    }
+
+    GPU_TEST(PackedMeshInstanceData_DeviceUnpack)
+    {
+        auto testData = createTestData(uint4(kMaxMatrixID, kMaxMaterialID, kMaxMeshID, kMaxFlags));
+        testDeviceUnpack<PackedMeshInstanceData>(ctx, "testPackedMeshInstanceData", "packedData", testData);
+    }
+
+    GPU_TEST(WideMeshInstanceData_DeviceUnpack)
+    {
+        auto testData = createTestData(uint4(kMaxUint));
+        testDeviceUnpack<WideMeshInstanceData>(ctx, "testWideMeshInstanceData", "wideData", testData);
+    }
+}
@@ -0,0 +1,234 @@
+/***************************************************************************
+ # Copyright (c) 2015-21, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "Testing/UnitTest.h"
+#include "Scene/MeshSimplifier.h"
+
+namespace Falcor
+{
+    namespace
+    {
+        struct TestMesh
+        {
+            std::vector<float3> positions;
+            std::vector<uint32_t> indices;
+        };
+
+        /** Creates a closed unit sphere with a single vertex at each pole.
+        */
+        TestMesh createSphere(uint32_t rings, uint32_t segments)
+        {
+            TestMesh mesh;
+            mesh.positions.push_back(float3(0.f, 1.f, 0.f));
+            for (uint32_t i = 1; i < rings; i++)
+            {
+                float theta = (float)M_PI * i / rings;
+                for (uint32_t j = 0; j < segments; j++)
+                {
+                    float phi = 2.f * (float)M_PI * j / segments;
+                    mesh.positions.push_back(float3(std::sin(theta) * std::cos(phi), std::cos(theta), std::sin(theta) * std::sin(phi)));
+                }
+            }
+            mesh.positions.push_back(float3(0.f, -1.f, 0.f));
+
+            auto ringVertex = [&](uint32_t ring, uint32_t segment) { return 1 + (ring - 1) * segments + segment % segments; };
+            const uint32_t southPole = (uint32_t)mesh.positions.size() - 1;
+            for (uint32_t j = 0; j < segments; j++)
+            {
+                mesh.indices.insert(mesh.indices.end(), { 0, ringVertex(1, j + 1), ringVertex(1, j) });
+                mesh.indices.insert(mesh.indices.end(), { southPole, ringVertex(rings - 1, j), ringVertex(rings - 1, j + 1) });
+                for (uint32_t i = 1; i < rings - 1; i++)
+                {
+                    uint32_t a = ringVertex(i, j), b = ringVertex(i, j + 1), c = ringVertex(i + 1, j), d = ringVertex(i + 1, j + 1);
+                    mesh.indices.insert(mesh.indices.end(), { a, b, c, b, d, c });
+                }
+            }
+            return mesh;
+        }
+
+        /** Creates a planar grid in the xy-plane. Optionally the column at x = seamColumn is duplicated to form an attribute seam.
+        */
+        TestMesh createGrid(uint32_t size, uint32_t seamColumn = 0)
+        {
+            TestMesh mesh;
+            const uint32_t columns = size + 1 + (seamColumn > 0 ? 1 : 0);
+            std::vector<uint32_t> rowStart;
+            for (uint32_t y = 0; y <= size; y++)
+            {
+                for (uint32_t x = 0; x < columns; x++)
+                {
+                    float px = (float)(seamColumn > 0 && x > seamColumn ? x - 1 : x);
+                    mesh.positions.push_back(float3(px, (float)y, 0.f));
+                }
+            }
+            for (uint32_t y = 0; y < size; y++)
+            {
+                for (uint32_t x = 0; x < columns - 1; x++)
+                {
+                    if (seamColumn > 0 && x == seamColumn) continue; // Skip the zero-width quad at the seam.
+                    uint32_t a = y * columns + x, b = a + 1, c = a + columns, d = c + 1;
+                    mesh.indices.insert(mesh.indices.end(), { a, c, b, b, c, d });
+                }
+            }
+            return mesh;
+        }
+
+        float computeArea(const TestMesh& mesh, const std::vector<uint32_t>& indices)
+        {
+            float area = 0.f;
+            for (size_t i = 0; i < indices.size(); i += 3)
+            {
+                const float3& p0 = mesh.positions[indices[i]];
+                const float3& p1 = mesh.positions[indices[i + 1]];
+                const float3& p2 = mesh.positions[indices[i + 2]];
+                area += 0.5f * glm::length(glm::cross(p1 - p0, p2 - p0));
+            }
+            return area;
+        }
+
+        MeshSimplifier::Result simplify(const TestMesh& mesh, size_t targetIndexCount, float targetError = std::numeric_limits<float>::infinity())
+        {
+            MeshSimplifier::Options options;
+            options.targetIndexCount = targetIndexCount;
+            options.targetError = targetError;
+            return MeshSimplifier::simplify(mesh.positions.data(), mesh.positions.size(), mesh.indices.data(), mesh.indices.size(), options);
+        }
+    }
+
+    CPU_TEST(MeshSimplifier_TriangleCountTarget)
+    {
+        TestMesh mesh = createSphere(64, 128);
+        const size_t triangleCount = mesh.indices.size() / 3;
+
+        float prevError = 0.f;
+        for (size_t divisor : { 2, 4, 10, 50 })
+        {
+            const size_t targetTriangleCount = triangleCount / divisor;
+            auto result = simplify(mesh, targetTriangleCount * 3);
+
+            // The target should be reached closely on a closed mesh without an error bound.
+            const size_t resultTriangleCount = result.indices.size() / 3;
+            EXPECT_EQ(result.indices.size() % 3, 0u);
+            EXPECT_LE(resultTriangleCount, targetTriangleCount) << "divisor = " << divisor;
+            EXPECT_GE(resultTriangleCount, targetTriangleCount * 9 / 10) << "divisor = " << divisor;
+
+            // The result must reference valid vertices and contain no degenerate triangles.
+            for (size_t i = 0; i < result.indices.size(); i += 3)
+            {
+                uint32_t i0 = result.indices[i], i1 = result.indices[i + 1], i2 = result.indices[i + 2];
+                EXPECT(i0 < mesh.positions.size() && i1 < mesh.positions.size() && i2 < mesh.positions.size());
+                EXPECT(i0 != i1 && i1 != i2 && i2 != i0) << "triangle = " << i / 3;
+            }
+
+            // The error increases with coarser levels.
+            EXPECT_GE(result.error, prevError) << "divisor = " << divisor;
+            prevError = result.error;
+        }
+    }
+
+    CPU_TEST(MeshSimplifier_ErrorBound)
+    {
+        TestMesh mesh = createSphere(64, 128);
+
+        for (float targetError : { 1e-3f, 1e-2f, 5e-2f })
+        {
+            auto result = simplify(mesh, 0, targetError);
+            EXPECT_LE(result.error, targetError) << "targetError = " << targetError;
+            EXPECT_LT(result.indices.size(), mesh.indices.size()) << "targetError = " << targetError;
+
+            // The vertices stay on the unit sphere, check the deviation of the triangle centroids from the surface.
+            // The quadric error measures the distance of the vertices to the original planes, while the
+            // centroids of the larger simplified triangles sag further below the curved surface, so we allow some slack.
+            float maxDeviation = 0.f;
+            for (size_t i = 0; i < result.indices.size(); i += 3)
+            {
+                float3 centroid = (mesh.positions[result.indices[i]] + mesh.positions[result.indices[i + 1]] + mesh.positions[result.indices[i + 2]]) / 3.f;
+                maxDeviation = std::max(maxDeviation, 1.f - glm::length(centroid));
+            }
+            EXPECT_LE(maxDeviation, 3.f * targetError) << "targetError = " << targetError;
+        }
+
+        // A zero error bound only allows lossless collapses, which don't exist on a sphere.
+        auto result = simplify(mesh, 0, 0.f);
+        EXPECT_EQ(result.indices.size(), mesh.indices.size());
+        EXPECT_EQ(result.error, 0.f);
+    }
+
+    CPU_TEST(MeshSimplifier_Borders)
+    {
+        const uint32_t size = 32;
+        TestMesh mesh = createGrid(size);
+        auto result = simplify(mesh, 0, 0.f);
+
+        // A planar grid simplifies without error while keeping its area and its border vertices.
+        EXPECT_EQ(result.error, 0.f);
+        EXPECT_LT(result.indices.size(), mesh.indices.size() / 4);
+        EXPECT(std::abs(computeArea(mesh, result.indices) - computeArea(mesh, mesh.indices)) < 1e-3f);
+
+        std::vector<bool> isReferenced(mesh.positions.size(), false);
+        for (uint32_t index : result.indices) isReferenced[index] = true;
+        for (uint32_t v = 0; v < mesh.positions.size(); v++)
+        {
+            const float3& p = mesh.positions[v];
+            bool isBorder = p.x == 0.f || p.y == 0.f || p.x == size || p.y == size;
+            if (isBorder) EXPECT(isReferenced[v]) << "v = " << v;
+        }
+    }
+
+    CPU_TEST(MeshSimplifier_Seams)
+    {
+        const uint32_t size = 32;
+        const uint32_t seamColumn = 16;
+        TestMesh mesh = createGrid(size, seamColumn);
+        auto result = simplify(mesh, 0, 0.f);
+
+        EXPECT_LT(result.indices.size(), mesh.indices.size() / 2);
+
+        // The vertices on both sides of the seam must be kept.
+        std::vector<bool> isReferenced(mesh.positions.size(), false);
+        for (uint32_t index : result.indices) isReferenced[index] = true;
+        const uint32_t columns = size + 2;
+        for (uint32_t y = 0; y <= size; y++)
+        {
+            EXPECT(isReferenced[y * columns + seamColumn]) << "y = " << y;
+            EXPECT(isReferenced[y * columns + seamColumn + 1]) << "y = " << y;
+        }
+
+        // No triangles may cross the seam.
+        for (size_t i = 0; i < result.indices.size(); i += 3)
+        {
+            bool left = false, right = false;
+            for (uint32_t j = 0; j < 3; j++)
+            {
+                uint32_t x = result.indices[i + j] % columns;
+                left |= x < seamColumn;
+                right |= x > seamColumn + 1;
+            }
+            EXPECT(!(left && right)) << "triangle = " << i / 3;
+        }
+    }
+}
@@ -0,0 +1,364 @@
+/***************************************************************************
+ # Copyright (c) 2015-21, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "Testing/UnitTest.h"
+#include "Scene/PagedGeometryStore.h"
+#include "Scene/SceneBuilder.h"
+#include <array>
+#include <atomic>
+#include <thread>
+
+namespace Falcor
+{
+    namespace
+    {
+        // The streaming test is scaled down to run quickly. The same harness validates the
+        // out-of-core path on large scenes by raising kStreamSize (e.g. to 100GB) while keeping the budget fixed.
+        const uint64_t kStreamSize = 256ull * 1024 * 1024;
+        const size_t kStreamChunkSize = 3 * 1024 * 1024 + 17; // Not a multiple of the page size.
+        const size_t kPageSize = 1024 * 1024;
+        const size_t kResidentBudget = 16 * 1024 * 1024;
+
+        /** Deterministic data pattern identifying each 32-bit word by its offset in the stream.
+        */
+        uint32_t patternWord(uint64_t wordIndex)
+        {
+            uint64_t x = wordIndex * 0x9e3779b97f4a7c15ull;
+            return (uint32_t)(x ^ (x >> 32));
+        }
+
+        void fillPattern(std::vector<uint32_t>& data, uint64_t firstWord)
+        {
+            for (size_t i = 0; i < data.size(); i++) data[i] = patternWord(firstWord + i);
+        }
+
+        using Triangle = std::array<float, 9>;
+
+        /** Samples the private memory of the process on a background thread and records the peak.
+        */
+        class PeakMemorySampler
+        {
+        public:
+            PeakMemorySampler()
+                : mBaseline(getProcessUsedVirtualMemory())
+                , mPeak(mBaseline)
+                , mThread([this]() { while (!mStop) { sample(); std::this_thread::sleep_for(std::chrono::milliseconds(1)); } })
+            {}
+
+            ~PeakMemorySampler()
+            {
+                mStop = true;
+                mThread.join();
+            }
+
+            /** Get the peak memory use in bytes above the memory use when the sampler was created.
+            */
+            uint64_t getPeakGrowth()
+            {
+                sample();
+                return mPeak - mBaseline;
+            }
+
+        private:
+            void sample()
+            {
+                const uint64_t used = getProcessUsedVirtualMemory();
+                uint64_t peak = mPeak;
+                while (used > peak && !mPeak.compare_exchange_weak(peak, used)) {}
+            }
+
+            const uint64_t mBaseline;
+            std::atomic<uint64_t> mPeak;
+            std::atomic<bool> mStop{ false };
+            std::thread mThread;
+        };
+
+        void addTriangle(std::vector<Triangle>& triangles, const float3& p0, const float3& p1, const float3& p2)
+        {
+            triangles.push_back({ p0.x, p0.y, p0.z, p1.x, p1.y, p1.z, p2.x, p2.y, p2.z });
+        }
+    }
+
+    CPU_TEST(PagedGeometryStore_Streaming)
+    {
+        auto pStore = PagedGeometryStore::create(getTempFilename(), kPageSize, kResidentBudget);
+
+        // Stream synthetic mesh data through the store.
+        std::vector<uint32_t> chunk(kStreamChunkSize / sizeof(uint32_t));
+        uint64_t wordCount = 0;
+        while (wordCount * sizeof(uint32_t) < kStreamSize)
+        {
+            fillPattern(chunk, wordCount);
+            uint64_t offset = pStore->append(chunk);
+            EXPECT_EQ(offset, wordCount * sizeof(uint32_t));
+            wordCount += chunk.size();
+        }
+
+        auto stats = pStore->getStats();
+        EXPECT_EQ(stats.size, wordCount * sizeof(uint32_t));
+        EXPECT_EQ(stats.pageCount, div_round_up(stats.size, (uint64_t)kPageSize));
+        EXPECT_LE(stats.peakResidentBytes, kResidentBudget);
+        EXPECT_LE(stats.residentPageCount * kPageSize, kResidentBudget);
+        EXPECT_EQ(stats.pinnedPageCount, 0u);
+        EXPECT_GT(stats.pageWriteCount, 0u);
+
+        // Read back everything page by page and validate the data.
+        uint64_t errorCount = 0;
+        pStore->forEachPage(0, stats.size, [&](uint64_t offset, const void* pData, size_t size)
+        {
+            EXPECT_EQ(offset % sizeof(uint32_t), 0u);
+            const uint32_t* pWords = static_cast<const uint32_t*>(pData);
+            for (size_t i = 0; i < size / sizeof(uint32_t); i++)
+            {
+                if (pWords[i] != patternWord(offset / sizeof(uint32_t) + i)) errorCount++;
+            }
+        });
+        EXPECT_EQ(errorCount, 0u);
+
+        stats = pStore->getStats();
+        EXPECT_LE(stats.peakResidentBytes, kResidentBudget);
+        EXPECT_GT(stats.pageReadCount, 0u);
+    }
+
+    CPU_TEST(PagedGeometryStore_RandomAccess)
+    {
+        auto pStore = PagedGeometryStore::create(getTempFilename(), kPageSize, 4 * kPageSize);
+
+        std::vector<uint32_t> data(16 * kPageSize / sizeof(uint32_t));
+        fillPattern(data, 0);
+        pStore->append(data);
+
+        // Overwrite a range straddling a page boundary, then evict it by touching other pages.
+        std::vector<uint32_t> patch(1000, 0xdeadbeef);
+        const uint64_t patchOffset = 3 * kPageSize - 1000;
+        pStore->write(patchOffset, patch.size() * sizeof(uint32_t), patch.data());
+        std::copy(patch.begin(), patch.end(), data.begin() + patchOffset / sizeof(uint32_t));
+
+        std::vector<uint32_t> tmp(kPageSize / sizeof(uint32_t));
+        for (uint64_t page = 8; page < 16; page++) pStore->read(page * kPageSize, kPageSize, tmp.data());
+
+        // Read random ranges and compare against the reference.
+        std::mt19937 rng;
+        std::uniform_int_distribution<size_t> dist(0, data.size() - 1);
+        for (uint32_t i = 0; i < 100; i++)
+        {
+            size_t first = dist(rng);
+            size_t count = std::min(dist(rng) / 4 + 1, data.size() - first);
+            std::vector<uint32_t> result(count);
+            pStore->read(first * sizeof(uint32_t), count * sizeof(uint32_t), result.data());
+            EXPECT(std::equal(result.begin(), result.end(), data.begin() + first)) << "first=" << first << " count=" << count;
+        }
+    }
+
+    CPU_TEST(PagedGeometryStore_Pinning)
+    {
+        auto pStore = PagedGeometryStore::create(getTempFilename(), kPageSize, 2 * kPageSize);
+
+        std::vector<uint32_t> data(8 * kPageSize / sizeof(uint32_t));
+        fillPattern(data, 0);
+        pStore->append(data);
+
+        // Pin a range spanning three pages. Pinned pages may exceed the budget but are never evicted.
+        const uint64_t pinOffset = kPageSize / 2;
+        const uint64_t pinSize = 2 * kPageSize;
+        pStore->pin(pinOffset, pinSize);
+        EXPECT_EQ(pStore->getStats().pinnedPageCount, 3u);
+
+        std::vector<uint32_t> tmp(kPageSize / sizeof(uint32_t));
+        for (uint64_t page = 4; page < 8; page++) pStore->read(page * kPageSize, kPageSize, tmp.data());
+
+        const uint64_t readCount = pStore->getStats().pageReadCount;
+        std::vector<uint32_t> result(pinSize / sizeof(uint32_t));
+        pStore->read(pinOffset, pinSize, result.data());
+        EXPECT(std::equal(result.begin(), result.end(), data.begin() + pinOffset / sizeof(uint32_t)));
+        EXPECT_EQ(pStore->getStats().pageReadCount, readCount);
+
+        pStore->unpin(pinOffset, pinSize);
+        auto stats = pStore->getStats();
+        EXPECT_EQ(stats.pinnedPageCount, 0u);
+        EXPECT_LE(stats.residentPageCount, 2u);
+    }
+
+    CPU_TEST(PagedGeometryStore_RemovesBackingFile)
+    {
+        std::filesystem::path path = getTempFilename();
+        {
+            auto pStore = PagedGeometryStore::create(path, kPageSize, kPageSize);
+            std::vector<uint32_t> data(4 * kPageSize / sizeof(uint32_t), 1);
+            pStore->append(data);
+            EXPECT(std::filesystem::exists(path));
+        }
+        EXPECT(!std::filesystem::exists(path));
+    }
+
+    GPU_TEST(PagedGeometryStore_SceneBuilder)
+    {
+        // Build a scene from meshes that together are much larger than the resident budget.
+        const size_t kBuilderPageSize = 64 * 1024;
+        const size_t kBuilderResidentBudget = 256 * 1024;
+        const uint32_t kMeshCount = 32;
+        const uint32_t kGridSize = 64;
+
+        auto pBuilder = SceneBuilder::create(SceneBuilder::Flags::OutOfCoreGeometry);
+        pBuilder->setOutOfCoreBudget(kBuilderPageSize, kBuilderResidentBudget);
+        auto pMaterial = StandardMaterial::create("Default");
+
+        // Each mesh is a grid with its own translation, so that the meshes are pre-transformed while paged.
+        std::vector<Triangle> expectedTriangles;
+        for (uint32_t m = 0; m < kMeshCount; m++)
+        {
+            const float3 translation = float3(0.f, 0.f, (float)m);
+            auto getPosition = [&](uint32_t x, uint32_t y) { return float3(x * 0.25f, y * 0.5f, (x ^ y ^ m) * 0.125f); };
+
+            auto pMesh = TriangleMesh::create();
+            for (uint32_t y = 0; y < kGridSize; y++)
+            {
+                for (uint32_t x = 0; x < kGridSize; x++) pMesh->addVertex(getPosition(x, y), float3(0.f, 0.f, 1.f), float2(x, y) / float(kGridSize));
+            }
+            for (uint32_t y = 0; y + 1 < kGridSize; y++)
+            {
+                for (uint32_t x = 0; x + 1 < kGridSize; x++)
+                {
+                    const uint32_t i = y * kGridSize + x;
+                    pMesh->addTriangle(i, i + 1, i + kGridSize);
+                    pMesh->addTriangle(i + 1, i + kGridSize + 1, i + kGridSize);
+                    addTriangle(expectedTriangles, getPosition(x, y) + translation, getPosition(x + 1, y) + translation, getPosition(x, y + 1) + translation);
+                    addTriangle(expectedTriangles, getPosition(x + 1, y) + translation, getPosition(x + 1, y + 1) + translation, getPosition(x, y + 1) + translation);
+                }
+            }
+
+            const uint32_t meshID = pBuilder->addTriangleMesh(pMesh, pMaterial);
+            SceneBuilder::Node node;
+            node.name = "Mesh" + std::to_string(m);
+            node.transform = glm::translate(float4x4(1.f), translation);
+            pBuilder->addMeshInstance(pBuilder->addNode(node), meshID);
+        }
+
+        // The mesh data should have been moved to the paged store during import.
+        const uint64_t vertexDataSize = (uint64_t)kMeshCount * kGridSize * kGridSize * sizeof(StaticVertexData);
+        auto importStats = pBuilder->getOutOfCoreStats();
+        EXPECT_GE(importStats.size, vertexDataSize);
+        EXPECT_GT(importStats.pageWriteCount, 0u);
+        EXPECT_LE(importStats.peakResidentBytes, kBuilderResidentBudget);
+
+        auto pScene = pBuilder->getScene();
+        importStats = pBuilder->getOutOfCoreStats();
+        EXPECT_LE(importStats.peakResidentBytes, kBuilderResidentBudget);
+
+        const auto& pStore = pScene->getGeometryStore();
+        EXPECT(pStore != nullptr);
+        if (!pStore) return;
+        EXPECT_LE(pStore->getStats().peakResidentBytes, kBuilderResidentBudget);
+
+        // Read back the triangles. The index data is stored first, followed by the static vertex data.
+        uint64_t vertexCount = 0;
+        for (uint32_t meshID = 0; meshID < pScene->getMeshCount(); meshID++) vertexCount += pScene->getMesh(meshID).vertexCount;
+        const uint64_t staticDataOffset = pStore->getSize() - vertexCount * sizeof(PackedStaticVertexData);
+
+        std::vector<Triangle> triangles;
+        for (uint32_t meshID = 0; meshID < pScene->getMeshCount(); meshID++)
+        {
+            const MeshDesc& mesh = pScene->getMesh(meshID);
+            EXPECT(mesh.indexCount > 0);
+
+            std::vector<PackedStaticVertexData> vertices(mesh.vertexCount);
+            pStore->read(staticDataOffset + (uint64_t)mesh.vbOffset * sizeof(PackedStaticVertexData), vertices.size() * sizeof(PackedStaticVertexData), vertices.data());
+
+            std::vector<uint32_t> words(mesh.use16BitIndices() ? div_round_up(mesh.indexCount, 2u) : mesh.indexCount);
+            pStore->read((uint64_t)mesh.ibOffset * sizeof(uint32_t), words.size() * sizeof(uint32_t), words.data());
+            auto getIndex = [&](uint32_t i) { return mesh.use16BitIndices() ? (uint32_t)reinterpret_cast<const uint16_t*>(words.data())[i] : words[i]; };
+
+            for (uint32_t i = 0; i < mesh.indexCount; i += 3)
+            {
+                addTriangle(triangles, vertices[getIndex(i)].position, vertices[getIndex(i + 1)].position, vertices[getIndex(i + 2)].position);
+            }
+        }
+
+        // The meshes may have been reordered and split, so compare the sorted triangle lists.
+        std::sort(expectedTriangles.begin(), expectedTriangles.end());
+        std::sort(triangles.begin(), triangles.end());
+        EXPECT_EQ(triangles.size(), expectedTriangles.size());
+        EXPECT(triangles == expectedTriangles);
+    }
+
+    GPU_TEST(PagedGeometryStore_SceneBuilderMemory)
+    {
+        // Build a scene whose mesh data is much larger than the resident budget and check that the memory use of the process stays bounded.
+        // The test is scaled down to run quickly. Raising kMeshCount validates the out-of-core path on large scenes with the same bound.
+        const size_t kBuilderPageSize = 1024 * 1024;
+        const size_t kBuilderResidentBudget = 16 * 1024 * 1024;
+        const uint32_t kMeshCount = 64;
+        const uint32_t kGridSize = 256;
+
+        // The import and global stores are both resident while the global buffers are created, and uploads are staged up to the budget.
+        // The remaining allowance covers the meshes being processed by the build passes and the scene's own data structures.
+        const uint64_t kMaxMemoryGrowth = 3 * kBuilderResidentBudget + 128ull * 1024 * 1024;
+
+        auto pMesh = TriangleMesh::create();
+        for (uint32_t y = 0; y < kGridSize; y++)
+        {
+            for (uint32_t x = 0; x < kGridSize; x++) pMesh->addVertex(float3(x, y, (x ^ y) & 7), float3(0.f, 0.f, 1.f), float2(x, y) / float(kGridSize));
+        }
+        for (uint32_t y = 0; y + 1 < kGridSize; y++)
+        {
+            for (uint32_t x = 0; x + 1 < kGridSize; x++)
+            {
+                const uint32_t i = y * kGridSize + x;
+                pMesh->addTriangle(i, i + 1, i + kGridSize);
+                pMesh->addTriangle(i + 1, i + kGridSize + 1, i + kGridSize);
+            }
+        }
+
+        const uint64_t meshDataSize = (uint64_t)kMeshCount * (pMesh->getVertices().size() * sizeof(StaticVertexData) + pMesh->getIndices().size() * sizeof(uint32_t));
+        gpDevice->flushAndSync();
+
+        PeakMemorySampler sampler;
+        {
+            auto pBuilder = SceneBuilder::create(SceneBuilder::Flags::OutOfCoreGeometry);
+            pBuilder->setOutOfCoreBudget(kBuilderPageSize, kBuilderResidentBudget);
+            auto pMaterial = StandardMaterial::create("Default");
+
+            for (uint32_t m = 0; m < kMeshCount; m++)
+            {
+                const uint32_t meshID = pBuilder->addTriangleMesh(pMesh, pMaterial);
+                SceneBuilder::Node node;
+                node.name = "Mesh" + std::to_string(m);
+                node.transform = glm::translate(float4x4(1.f), float3(0.f, 0.f, (float)m));
+                pBuilder->addMeshInstance(pBuilder->addNode(node), meshID);
+            }
+            EXPECT_LE(sampler.getPeakGrowth(), kMaxMemoryGrowth) << "after import";
+
+            auto pScene = pBuilder->getScene();
+            EXPECT(pScene->getGeometryStore() != nullptr);
+            EXPECT_GE(pBuilder->getOutOfCoreStats().size, meshDataSize);
+        }
+
+        const uint64_t peakGrowth = sampler.getPeakGrowth();
+        logInfo("Built scene with " + std::to_string(meshDataSize >> 20) + " MB of mesh data. Peak memory growth " + std::to_string(peakGrowth >> 20) + " MB.");
+        EXPECT_LE(peakGrowth, kMaxMemoryGrowth);
+    }
+}
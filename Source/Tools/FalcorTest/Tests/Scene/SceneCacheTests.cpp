@@ -0,0 +1,180 @@
+/***************************************************************************
+ # Copyright (c) 2015-21, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "Testing/UnitTest.h"
+#include "Scene/SceneCache.h"
+#include "Rendering/Lights/LightBVHBuilder.h"
+#include <random>
+
+namespace Falcor
+{
+    namespace
+    {
+        using MeshLightTriangle = LightCollection::MeshLightTriangle;
+
+        const uint32_t kLightCount = 8;
+        const uint32_t kTrianglesPerLight = 50;
+
+        SceneCache::Key computeKey(const std::string& str)
+        {
+            return SHA1::compute(str.data(), str.size());
+        }
+
+        /** Creates mesh lights made of small random triangles.
+        */
+        void createLights(std::mt19937& rng, std::vector<MeshLightTriangle>& triangles, std::vector<MeshLightData>& meshLights)
+        {
+            std::uniform_real_distribution<float> u(0.f, 1.f);
+            auto randomFloat3 = [&]() { return float3(u(rng), u(rng), u(rng)); };
+
+            for (uint32_t lightIdx = 0; lightIdx < kLightCount; lightIdx++)
+            {
+                MeshLightData light;
+                light.triangleOffset = (uint32_t)triangles.size();
+                light.triangleCount = kTrianglesPerLight;
+                meshLights.push_back(light);
+
+                const float3 center = randomFloat3() * 10.f;
+                for (uint32_t i = 0; i < kTrianglesPerLight; i++)
+                {
+                    MeshLightTriangle tri;
+                    const float3 p = center + randomFloat3();
+                    for (uint32_t j = 0; j < 3; j++) tri.vtx[j].pos = p + (randomFloat3() - 0.5f) * 0.1f;
+                    tri.lightIdx = lightIdx;
+                    tri.normal = glm::normalize(randomFloat3() - 0.5f);
+                    tri.flux = u(rng) + 0.1f;
+                    triangles.push_back(tri);
+                }
+            }
+        }
+    }
+
+    CPU_TEST(SceneCacheLightBVH)
+    {
+        std::mt19937 rng(1);
+        std::vector<MeshLightTriangle> triangles;
+        std::vector<MeshLightData> meshLights;
+        createLights(rng, triangles, meshLights);
+
+        // Without dynamic lights, the incremental BVH is the same as a regular BVH.
+        LightBVHBuilder::Options options;
+        options.maxTriangleCountPerLeaf = 4;
+        auto pBuilder = LightBVHBuilder::create(options);
+        LightBVHBuilder::IncrementalBVH bvh;
+        pBuilder->buildIncremental(triangles, meshLights, bvh);
+        EXPECT(!bvh.nodes.empty());
+
+        SceneCache::LightBVHData data;
+        data.nodes = bvh.nodes;
+        data.triangleIndices = bvh.triangleIndices;
+        data.triangleBitmasks = bvh.triangleBitmasks;
+        data.maxTriangleCountPerLeaf = options.maxTriangleCountPerLeaf;
+
+        const SceneCache::Key sceneKey = computeKey("SceneCacheTests/LightBVH");
+        const SceneCache::Key bvhKey = computeKey("bvh");
+        SceneCache::clearLightCache(sceneKey);
+
+        SceneCache::writeLightBVH(sceneKey, bvhKey, data);
+
+        SceneCache::LightBVHData loaded;
+        EXPECT(SceneCache::readLightBVH(sceneKey, bvhKey, loaded));
+        EXPECT_EQ(loaded.maxTriangleCountPerLeaf, data.maxTriangleCountPerLeaf);
+        EXPECT_EQ(loaded.nodes.size(), data.nodes.size());
+        EXPECT(loaded.nodes.size() == data.nodes.size() && std::memcmp(loaded.nodes.data(), data.nodes.data(), data.nodes.size() * sizeof(PackedNode)) == 0);
+        EXPECT(loaded.triangleIndices == data.triangleIndices);
+        EXPECT(loaded.triangleBitmasks == data.triangleBitmasks);
+
+        // Entries are only found with the key they were written with.
+        SceneCache::LightBVHData other;
+        EXPECT(!SceneCache::readLightBVH(sceneKey, computeKey("other"), other));
+        EXPECT(!SceneCache::readLightBVH(computeKey("SceneCacheTests/Other"), bvhKey, other));
+
+        SceneCache::clearLightCache(sceneKey);
+        EXPECT(!SceneCache::readLightBVH(sceneKey, bvhKey, other));
+    }
+
+    CPU_TEST(SceneCacheKeyCollision)
+    {
+        // These keys map to the same string if only the first byte is padded to two digits ("00" "1" "11" vs. "00" "11" "1").
+        SceneCache::Key keyA = {}, keyB = {};
+        keyA[1] = 0x01;
+        keyA[2] = 0x11;
+        keyB[1] = 0x11;
+        keyB[2] = 0x01;
+
+        SceneCache::LightBVHData dataA, dataB;
+        dataA.nodes.resize(1);
+        dataA.triangleIndices = { 0 };
+        dataA.triangleBitmasks = { 0 };
+        dataA.maxTriangleCountPerLeaf = 1;
+        dataB = dataA;
+        dataB.maxTriangleCountPerLeaf = 2;
+
+        const SceneCache::Key sceneKey = computeKey("SceneCacheTests/KeyCollision");
+        SceneCache::clearLightCache(sceneKey);
+
+        SceneCache::writeLightBVH(sceneKey, keyA, dataA);
+        SceneCache::writeLightBVH(sceneKey, keyB, dataB);
+
+        // Each key finds its own entry.
+        SceneCache::LightBVHData loaded;
+        EXPECT(SceneCache::readLightBVH(sceneKey, keyA, loaded));
+        EXPECT_EQ(loaded.maxTriangleCountPerLeaf, dataA.maxTriangleCountPerLeaf);
+        EXPECT(SceneCache::readLightBVH(sceneKey, keyB, loaded));
+        EXPECT_EQ(loaded.maxTriangleCountPerLeaf, dataB.maxTriangleCountPerLeaf);
+
+        SceneCache::clearLightCache(sceneKey);
+    }
+
+    CPU_TEST(SceneCacheEmissiveFlux)
+    {
+        std::mt19937 rng(2);
+        std::uniform_real_distribution<float> u(0.f, 1.f);
+        std::vector<EmissiveFlux> fluxData(1000);
+        for (auto& flux : fluxData)
+        {
+            flux.flux = u(rng);
+            flux.averageRadiance = float3(u(rng), u(rng), u(rng));
+        }
+
+        const SceneCache::Key sceneKey = computeKey("SceneCacheTests/EmissiveFlux");
+        const SceneCache::Key contentKey = computeKey("flux");
+        SceneCache::clearLightCache(sceneKey);
+
+        SceneCache::writeEmissiveFlux(sceneKey, contentKey, fluxData);
+
+        std::vector<EmissiveFlux> loaded;
+        EXPECT(SceneCache::readEmissiveFlux(sceneKey, contentKey, loaded));
+        EXPECT_EQ(loaded.size(), fluxData.size());
+        EXPECT(loaded.size() == fluxData.size() && std::memcmp(loaded.data(), fluxData.data(), fluxData.size() * sizeof(EmissiveFlux)) == 0);
+
+        EXPECT(!SceneCache::readEmissiveFlux(sceneKey, computeKey("other"), loaded));
+
+        SceneCache::clearLightCache(sceneKey);
+        EXPECT(!SceneCache::readEmissiveFlux(sceneKey, contentKey, loaded));
+    }
+}
@@ -0,0 +1,237 @@
+/***************************************************************************
+ # Copyright (c) 2015-21, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "Testing/UnitTest.h"
+#include "Scene/SceneUpdateScheduler.h"
+#include <atomic>
+#include <mutex>
+#include <random>
+
+namespace Falcor
+{
+    namespace
+    {
+        /** Mocked scene update stage. The prepare function transforms and packs a set of matrices into a staging
+            buffer, the commit function copies the staging buffer into a mocked GPU buffer.
+        */
+        struct MockUploadStage
+        {
+            std::vector<glm::mat4> local;
+            std::vector<glm::mat4> staging;
+            std::vector<glm::mat4> gpuBuffer;
+
+            MockUploadStage(uint32_t count, uint32_t seed)
+            {
+                std::mt19937 rng(seed);
+                std::uniform_real_distribution<float> u(-1.f, 1.f);
+                local.resize(count);
+                for (auto& m : local)
+                {
+                    for (int c = 0; c < 4; c++) m[c] = float4(u(rng), u(rng), u(rng), c == 3 ? 1.f : 0.f);
+                }
+                staging.resize(count);
+                gpuBuffer.resize(count);
+            }
+
+            void prepare(const glm::mat4& parent)
+            {
+                for (size_t i = 0; i < local.size(); i++)
+                {
+                    glm::mat4 m = parent * local[i];
+                    // Some extra work per element to make the stage CPU bound, similar to evaluating an animation.
+                    for (int j = 0; j < 8; j++) m = m * local[(i + j) % local.size()];
+                    staging[i] = m;
+                }
+            }
+
+            void commit()
+            {
+                std::memcpy(gpuBuffer.data(), staging.data(), staging.size() * sizeof(glm::mat4));
+            }
+        };
+    }
+
+    CPU_TEST(SceneUpdateScheduler_Waves)
+    {
+        SceneUpdateScheduler scheduler;
+
+        std::mutex mutex;
+        std::vector<std::string> commitOrder;
+        std::vector<std::atomic<bool>> committed(6);
+        std::atomic<uint32_t> violations{ 0 };
+
+        auto addStage = [&](const std::string& name, const std::vector<SceneUpdateScheduler::StageID>& dependencies)
+        {
+            const uint32_t id = scheduler.getStageCount();
+            auto prepare = [&, dependencies]()
+            {
+                for (auto dependency : dependencies)
+                {
+                    if (!committed[dependency]) violations++;
+                }
+            };
+            auto commit = [&, id, name]()
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                commitOrder.push_back(name);
+                committed[id] = true;
+            };
+            return scheduler.addStage(name, prepare, commit, dependencies);
+        };
+
+        auto a = addStage("A", {});
+        auto b = addStage("B", {});
+        auto c = addStage("C", { a });
+        auto d = addStage("D", { a, b });
+        auto e = addStage("E", { c });
+        auto f = addStage("F", {});
+        scheduler.addStage("G", nullptr, nullptr, { d });
+
+        EXPECT_EQ(scheduler.getStageCount(), 7u);
+        EXPECT_EQ(scheduler.getWaveCount(), 3u);
+
+        for (bool parallel : { false, true })
+        {
+            scheduler.setParallel(parallel);
+            commitOrder.clear();
+            for (auto& flag : committed) flag = false;
+
+            scheduler.execute();
+
+            EXPECT_EQ(violations, 0u);
+            const std::vector<std::string> expectedOrder = { "A", "B", "F", "C", "D", "E" };
+            EXPECT(commitOrder == expectedOrder) << "parallel=" << parallel;
+
+            const auto& stats = scheduler.getStats();
+            EXPECT_EQ(stats.stages.size(), 7u);
+            EXPECT_EQ(stats.stages[a].wave, 0u);
+            EXPECT_EQ(stats.stages[b].wave, 0u);
+            EXPECT_EQ(stats.stages[c].wave, 1u);
+            EXPECT_EQ(stats.stages[d].wave, 1u);
+            EXPECT_EQ(stats.stages[e].wave, 2u);
+            EXPECT_EQ(stats.stages[f].wave, 0u);
+            EXPECT_EQ(stats.stages[6].wave, 2u);
+            EXPECT_EQ(stats.stages[e].name, "E");
+            EXPECT_GE(stats.totalTime, 0.0);
+        }
+    }
+
+    CPU_TEST(SceneUpdateScheduler_InvalidDependency)
+    {
+        SceneUpdateScheduler scheduler;
+        auto a = scheduler.addStage("A", nullptr, nullptr);
+
+        bool thrown = false;
+        try
+        {
+            scheduler.addStage("B", nullptr, nullptr, { a + 1 });
+        }
+        catch (const std::exception&)
+        {
+            thrown = true;
+        }
+        EXPECT(thrown);
+        EXPECT_EQ(scheduler.getStageCount(), 1u);
+    }
+
+    CPU_TEST(SceneUpdateScheduler_Exception)
+    {
+        SceneUpdateScheduler scheduler;
+
+        bool committedA = false;
+        bool committedB = false;
+        bool committedC = false;
+        auto a = scheduler.addStage("A", nullptr, [&]() { committedA = true; });
+        scheduler.addStage("B", []() { throw std::runtime_error("prepare failed"); }, [&]() { committedB = true; }, { a });
+        scheduler.addStage("C", nullptr, [&]() { committedC = true; }, { a });
+
+        // The exception is rethrown on the calling thread and none of the commits of the failed wave run.
+        bool thrown = false;
+        try
+        {
+            scheduler.execute();
+        }
+        catch (const std::runtime_error& e)
+        {
+            thrown = std::string(e.what()) == "prepare failed";
+        }
+        EXPECT(thrown);
+        EXPECT(committedA);
+        EXPECT(!committedB);
+        EXPECT(!committedC);
+    }
+
+    CPU_TEST(SceneUpdateScheduler_Benchmark)
+    {
+        const uint32_t kStageCount = 6;
+        const uint32_t kElementCount = 1 << 15;
+        const uint32_t kIterations = 5;
+
+        // Run the same mocked update with serial and parallel preparation.
+        auto run = [&](bool parallel, std::vector<MockUploadStage>& stages)
+        {
+            SceneUpdateScheduler scheduler;
+            scheduler.setParallel(parallel);
+
+            // Stage 0 is the root (e.g. animation), the others depend only on it and are prepared concurrently.
+            glm::mat4 root = glm::mat4(1.f);
+            auto rootID = scheduler.addStage("Root", [&]() { root = stages[0].local[0]; }, [&]() { stages[0].commit(); });
+            for (uint32_t i = 1; i < kStageCount; i++)
+            {
+                MockUploadStage* pStage = &stages[i];
+                scheduler.addStage("Stage" + std::to_string(i), [pStage, &root]() { pStage->prepare(root); }, [pStage]() { pStage->commit(); }, { rootID });
+            }
+
+            double totalTime = 0.0;
+            for (uint32_t i = 0; i < kIterations; i++)
+            {
+                scheduler.execute();
+                totalTime += scheduler.getStats().totalTime;
+            }
+            return std::make_pair(totalTime / kIterations, scheduler.getStats().serialTime);
+        };
+
+        std::vector<MockUploadStage> serialStages, parallelStages;
+        for (uint32_t i = 0; i < kStageCount; i++)
+        {
+            serialStages.emplace_back(kElementCount, i);
+            parallelStages.emplace_back(kElementCount, i);
+        }
+
+        auto [serialTime, serialStageTime] = run(false, serialStages);
+        auto [parallelTime, parallelStageTime] = run(true, parallelStages);
+
+        // Scheduling must not change the result.
+        for (uint32_t i = 0; i < kStageCount; i++)
+        {
+            EXPECT_EQ(std::memcmp(serialStages[i].gpuBuffer.data(), parallelStages[i].gpuBuffer.data(), kElementCount * sizeof(glm::mat4)), 0) << "stage " << i;
+        }
+
+        logInfo("SceneUpdateScheduler: " + std::to_string(kStageCount) + " stages, serial " + std::to_string(serialTime) + " ms, parallel " + std::to_string(parallelTime) + " ms, speedup "
+            + std::to_string(serialTime / parallelTime) + "x (sum of stage times " + std::to_string(parallelStageTime) + " ms)");
+    }
+}
@@ -0,0 +1,143 @@
+/***************************************************************************
+ # Copyright (c) 2015-21, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "Testing/UnitTest.h"
+#include "Scene/VertexCacheOptimizer.h"
+#include <algorithm>
+#include <array>
+#include <random>
+
+namespace Falcor
+{
+    namespace
+    {
+        struct TestMesh
+        {
+            std::vector<StaticVertexData> vertices;
+            std::vector<uint32_t> indices;
+            AABB bounds;
+        };
+
+        /** Creates a planar grid of width x height quads in the xy-plane, with the triangles in row-major order.
+        */
+        TestMesh createGrid(uint32_t width, uint32_t height)
+        {
+            TestMesh mesh;
+            for (uint32_t y = 0; y <= height; y++)
+            {
+                for (uint32_t x = 0; x <= width; x++)
+                {
+                    StaticVertexData v = {};
+                    v.position = float3((float)x, (float)y, 0.f);
+                    v.normal = float3(0.f, 0.f, 1.f);
+                    mesh.vertices.push_back(v);
+                    mesh.bounds |= v.position;
+                }
+            }
+            for (uint32_t y = 0; y < height; y++)
+            {
+                for (uint32_t x = 0; x < width; x++)
+                {
+                    uint32_t a = y * (width + 1) + x, b = a + 1, c = a + width + 1, d = c + 1;
+                    mesh.indices.insert(mesh.indices.end(), { a, b, c, b, d, c });
+                }
+            }
+            return mesh;
+        }
+
+        using Triangle = std::array<std::array<float, 3>, 3>;
+
+        /** Returns the triangles as sorted lists of vertex positions.
+            Each triangle is rotated to start at its smallest vertex, so that the winding is preserved.
+        */
+        std::vector<Triangle> getTriangles(const TestMesh& mesh)
+        {
+            std::vector<Triangle> triangles;
+            for (size_t i = 0; i < mesh.indices.size(); i += 3)
+            {
+                Triangle tri;
+                for (size_t j = 0; j < 3; j++)
+                {
+                    const float3& p = mesh.vertices[mesh.indices[i + j]].position;
+                    tri[j] = { p.x, p.y, p.z };
+                }
+                std::rotate(tri.begin(), std::min_element(tri.begin(), tri.end()), tri.end());
+                triangles.push_back(tri);
+            }
+            std::sort(triangles.begin(), triangles.end());
+            return triangles;
+        }
+    }
+
+    CPU_TEST(VertexCacheOptimizer_Reorder)
+    {
+        // Shuffle the triangles of a grid, which the optimizer should improve.
+        TestMesh mesh = createGrid(32, 32);
+        std::vector<uint32_t> order(mesh.indices.size() / 3);
+        for (uint32_t i = 0; i < (uint32_t)order.size(); i++) order[i] = i;
+        std::shuffle(order.begin(), order.end(), std::mt19937(1));
+        std::vector<uint32_t> shuffled;
+        for (uint32_t t : order) shuffled.insert(shuffled.end(), mesh.indices.begin() + 3 * t, mesh.indices.begin() + 3 * t + 3);
+        mesh.indices = shuffled;
+
+        const std::vector<Triangle> triangles = getTriangles(mesh);
+        VertexCacheOptimizer::Stats statsBefore, statsAfter;
+        EXPECT(VertexCacheOptimizer::optimize(mesh.indices, mesh.vertices, mesh.bounds, statsBefore, statsAfter));
+        EXPECT_LT(statsAfter.transformCount, statsBefore.transformCount);
+        EXPECT_EQ(statsAfter.transformCount, VertexCacheOptimizer::analyze(mesh.indices, (uint32_t)mesh.vertices.size()).transformCount);
+
+        // The vertices are ordered by first use.
+        uint32_t nextVertex = 0;
+        for (uint32_t index : mesh.indices)
+        {
+            EXPECT_LE(index, nextVertex);
+            if (index == nextVertex) nextVertex++;
+        }
+        EXPECT(getTriangles(mesh) == triangles);
+    }
+
+    CPU_TEST(VertexCacheOptimizer_KeepsBetterOrder)
+    {
+        // The row-major order of this grid is better than the optimized order, so the optimizer rejects its result.
+        TestMesh mesh = createGrid(6, 5);
+        const TestMesh original = mesh;
+        const std::vector<Triangle> triangles = getTriangles(mesh);
+
+        VertexCacheOptimizer::Stats statsBefore, statsAfter;
+        EXPECT(!VertexCacheOptimizer::optimize(mesh.indices, mesh.vertices, mesh.bounds, statsBefore, statsAfter));
+        EXPECT_EQ(statsAfter.transformCount, statsBefore.transformCount);
+
+        // Both the indices and the vertices are unchanged.
+        EXPECT(mesh.indices == original.indices);
+        EXPECT_EQ(mesh.vertices.size(), original.vertices.size());
+        for (uint32_t i = 0; i < (uint32_t)mesh.vertices.size(); i++)
+        {
+            EXPECT(mesh.vertices[i].position == original.vertices[i].position) << "vertex " << i;
+        }
+        EXPECT(getTriangles(mesh) == triangles);
+    }
+}
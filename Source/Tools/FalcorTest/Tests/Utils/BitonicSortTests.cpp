@@ -27,6 +27,7 @@
  **************************************************************************/
 #include "Testing/UnitTest.h"
 #include "Utils/Algorithm/BitonicSort.h"
+#include "Utils/Algorithm/HostParallel.h"
 #include <random>
 
 namespace Falcor
@@ -70,6 +71,23 @@ namespace Falcor
             }
             pTestDataBuffer->unmap();
         }
+
+        void testHostSort(CPUUnitTestContext& ctx, const uint32_t n, const uint32_t chunkSize)
+        {
+            // Create random test data in the same way as for the GPU.
+            std::vector<uint32_t> testData(n);
+            std::mt19937 r;
+            for (auto& it : testData) it = r();
+
+            std::vector<uint32_t> result = testData;
+            HostParallel::sortChunks(result.data(), n, chunkSize);
+
+            sort(testData, chunkSize);
+            for (uint32_t i = 0; i < n; i++)
+            {
+                EXPECT_EQ(testData[i], result[i]) << "i = " << i;
+            }
+        }
     }
 
 #if _ENABLE_NVAPI
@@ -94,4 +112,19 @@ namespace Falcor
         testGpuSort(ctx, pSort.get(), 16384, 256);
         testGpuSort(ctx, pSort.get(), 3103, 1024);
     }
+
+    CPU_TEST(BitonicSortHost)
+    {
+        // Test the host chunk sort with the same parameters as the GPU version.
+        testHostSort(ctx, 100, 1);
+        testHostSort(ctx, 19, 2);
+        testHostSort(ctx, 1024, 4);
+        testHostSort(ctx, 11025, 8);
+        testHostSort(ctx, 290, 16);
+        testHostSort(ctx, 1500, 32);
+        testHostSort(ctx, 20000, 64);
+        testHostSort(ctx, 2001, 128);
+        testHostSort(ctx, 16384, 256);
+        testHostSort(ctx, 3103, 1024);
+    }
 }
@@ -0,0 +1,186 @@
+/***************************************************************************
+ # Copyright (c) 2015-21, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "Testing/UnitTest.h"
+#include "Utils/Image/FLIP.h"
+#include <fstream>
+
+namespace Falcor
+{
+    namespace
+    {
+        // Reference error maps in flip_reference.dat were generated by a direct C++ port of the brute-force
+        // evaluation in FLIPPass.cs.slang, using the inputs below. The file stores the LDR map, followed by
+        // the HDR maps for the ACES and Reinhard tone mappers (with input clamping), as kWidth * kHeight floats each.
+        const uint32_t kWidth = 48;
+        const uint32_t kHeight = 32;
+        const float kTolerance = 1e-4f;
+
+        uint32_t hash(uint32_t x)
+        {
+            x ^= x >> 16;
+            x *= 0x7feb352d;
+            x ^= x >> 15;
+            x *= 0x846ca68b;
+            x ^= x >> 16;
+            return x;
+        }
+
+        /** Generate a smooth reference image and a test image with noise added to its right half.
+        */
+        void generateImages(std::vector<float>& reference, std::vector<float>& test, bool hdr)
+        {
+            reference.resize(kWidth * kHeight * 4);
+            test.resize(kWidth * kHeight * 4);
+            for (uint32_t y = 0; y < kHeight; y++)
+            {
+                for (uint32_t x = 0; x < kWidth; x++)
+                {
+                    for (uint32_t c = 0; c < 4; c++)
+                    {
+                        uint32_t i = (y * kWidth + x) * 4 + c;
+                        float value = 0.5f + 0.4f * std::sin(0.3f * x + c) * std::cos(0.2f * y);
+                        float noise = x >= kWidth / 2 ? (hash(i) & 0xffff) / 65535.f - 0.5f : 0.f;
+                        reference[i] = value;
+                        test[i] = value + 0.2f * noise;
+                        if (hdr)
+                        {
+                            reference[i] = std::exp(6.f * reference[i] - 3.f);
+                            test[i] = std::exp(6.f * test[i] - 3.f);
+                        }
+                    }
+                }
+            }
+        }
+
+        std::vector<float> loadReferenceMaps()
+        {
+            std::string fullpath;
+            if (!findFileInDataDirectories("flip_reference.dat", fullpath))
+            {
+                throw ErrorRunningTestException("Cannot find reference data file 'flip_reference.dat'.");
+            }
+
+            std::vector<float> maps(3 * kWidth * kHeight);
+            std::ifstream fin(fullpath, std::ios::in | std::ios::binary);
+            fin.read((char*)maps.data(), maps.size() * sizeof(float));
+            if (!fin) throw ErrorRunningTestException("Cannot read reference data file 'flip_reference.dat'.");
+            return maps;
+        }
+
+        void compareMaps(CPUUnitTestContext& ctx, const std::vector<float>& result, const float* pReference)
+        {
+            double referenceMean = 0.0;
+            for (uint32_t i = 0; i < kWidth * kHeight; i++)
+            {
+                EXPECT_LE(std::abs(result[i] - pReference[i]), kTolerance) << "pixel (" << i % kWidth << ", " << i / kWidth << ")";
+                referenceMean += pReference[i];
+            }
+            auto pooled = FLIP::computePooledValues(result.data(), result.size());
+            EXPECT_LE(std::abs(pooled.mean - referenceMean / (kWidth * kHeight)), kTolerance);
+        }
+    }
+
+    CPU_TEST(FLIP_LDRReference)
+    {
+        std::vector<float> reference, test;
+        generateImages(reference, test, false);
+        auto referenceMaps = loadReferenceMaps();
+
+        auto pFLIP = FLIP::create();
+        EXPECT_EQ(pFLIP->getFilterRadius(), 10);
+
+        std::vector<float> errorMap(kWidth * kHeight);
+        double mean = pFLIP->computeLDR(reference.data(), test.data(), kWidth, kHeight, errorMap.data());
+        compareMaps(ctx, errorMap, referenceMaps.data());
+
+        // The mean is also returned without an error map.
+        EXPECT_LE(std::abs(pFLIP->computeLDR(reference.data(), test.data(), kWidth, kHeight, nullptr) - mean), 1e-6);
+
+        // Identical images have no error.
+        EXPECT_EQ(pFLIP->computeLDR(reference.data(), reference.data(), kWidth, kHeight, nullptr), 0.0);
+    }
+
+    CPU_TEST(FLIP_HDRReference)
+    {
+        std::vector<float> reference, test;
+        generateImages(reference, test, true);
+        auto referenceMaps = loadReferenceMaps();
+
+        auto pFLIP = FLIP::create();
+        const FLIP::ToneMapper toneMappers[] = { FLIP::ToneMapper::ACES, FLIP::ToneMapper::Reinhard };
+        for (uint32_t i = 0; i < 2; i++)
+        {
+            auto exposures = FLIP::computeExposureParameters(toneMappers[i], reference.data(), kWidth, kHeight);
+            std::vector<float> errorMap(kWidth * kHeight);
+            std::vector<float> exposureMap(kWidth * kHeight);
+            pFLIP->computeHDR(reference.data(), test.data(), kWidth, kHeight, exposures, toneMappers[i], errorMap.data(), exposureMap.data(), true);
+            compareMaps(ctx, errorMap, referenceMaps.data() + (i + 1) * kWidth * kHeight);
+
+            for (float e : exposureMap)
+            {
+                EXPECT_GE(e, 0.f);
+                EXPECT_LE(e, 1.f);
+            }
+        }
+    }
+
+    CPU_TEST(FLIP_ExposureParameters)
+    {
+        float median, max;
+        const float even[] = { 4.f, 1.f, 3.f, 2.f };
+        FLIP::computeMedianMax(even, 4, median, max);
+        EXPECT_EQ(median, 2.5f);
+        EXPECT_EQ(max, 4.f);
+        const float odd[] = { 5.f, 1.f, 4.f, 2.f, 3.f };
+        FLIP::computeMedianMax(odd, 5, median, max);
+        EXPECT_EQ(median, 3.f);
+        EXPECT_EQ(max, 5.f);
+
+        // Reinhard reaches 0.85 at x = 0.85 / 0.15.
+        auto exposures = FLIP::computeExposureParameters(FLIP::ToneMapper::Reinhard, 0.4f, 4.f);
+        const float xMax = 0.85f / 0.15f;
+        EXPECT_LE(std::abs(exposures.startExposure - std::log2(xMax / 4.f)), 1e-5f);
+        EXPECT_EQ(exposures.numExposures, 4u);
+        EXPECT_LE(std::abs(exposures.exposureDelta - std::log2(4.f / 0.4f) / 3.f), 1e-5f);
+    }
+
+    CPU_TEST(FLIP_PooledValues)
+    {
+        const float values[] = { 2.f, 0.f, 1.f, 0.f, 1.f, 0.f };
+        auto pooled = FLIP::computePooledValues(values, 6);
+        EXPECT_LE(std::abs(pooled.mean - 4.0 / 6.0), 1e-9);
+        EXPECT_EQ(pooled.min, 0.f);
+        EXPECT_EQ(pooled.max, 2.f);
+        EXPECT_EQ(pooled.weightedFirstQuartile, 1.f);
+        EXPECT_EQ(pooled.weightedMedian, 1.f);
+        EXPECT_EQ(pooled.weightedThirdQuartile, 2.f);
+
+        auto empty = FLIP::computePooledValues(nullptr, 0);
+        EXPECT_EQ(empty.mean, 0.0);
+    }
+}
@@ -0,0 +1,148 @@
+/***************************************************************************
+ # Copyright (c) 2015-21, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "Testing/UnitTest.h"
+#include "Utils/Image/FrameWriter.h"
+
+namespace Falcor
+{
+    CPU_TEST(FrameWriter_StreamOrder)
+    {
+        const uint32_t kStreamCount = 3;
+        const uint32_t kJobCount = 50;
+
+        auto pWriter = FrameWriter::create(4, 6);
+
+        // Jobs of each stream must run one at a time and in submission order.
+        std::mutex mutex;
+        std::vector<std::vector<uint32_t>> order(kStreamCount);
+        std::vector<std::atomic<uint32_t>> running(kStreamCount);
+        std::atomic<uint32_t> overlapCount = 0;
+
+        for (uint32_t i = 0; i < kJobCount; i++)
+        {
+            for (uint32_t s = 0; s < kStreamCount; s++)
+            {
+                pWriter->submit([&, s, i] ()
+                {
+                    if (running[s]++ != 0) overlapCount++;
+                    std::this_thread::sleep_for(std::chrono::microseconds(100));
+                    {
+                        std::lock_guard<std::mutex> lock(mutex);
+                        order[s].push_back(i);
+                    }
+                    running[s]--;
+                }, &order[s]);
+            }
+        }
+        pWriter->flush();
+
+        EXPECT_EQ(pWriter->getPendingCount(), 0u);
+        EXPECT_EQ(overlapCount.load(), 0u);
+        for (uint32_t s = 0; s < kStreamCount; s++)
+        {
+            EXPECT_EQ(order[s].size(), kJobCount);
+            for (uint32_t i = 0; i < order[s].size(); i++) EXPECT_EQ(order[s][i], i) << "stream " << s;
+        }
+
+        auto stats = pWriter->getStats();
+        EXPECT_EQ(stats.submittedCount, kStreamCount * kJobCount);
+        EXPECT_EQ(stats.completedCount, kStreamCount * kJobCount);
+    }
+
+    CPU_TEST(FrameWriter_Backpressure)
+    {
+        const size_t kMaxPending = 3;
+        const uint32_t kJobCount = 20;
+
+        auto pWriter = FrameWriter::create(2, kMaxPending);
+
+        std::atomic<uint32_t> completed = 0;
+        for (uint32_t i = 0; i < kJobCount; i++)
+        {
+            pWriter->submit([&] ()
+            {
+                std::this_thread::sleep_for(std::chrono::milliseconds(2));
+                completed++;
+            });
+            EXPECT_LE(pWriter->getPendingCount(), kMaxPending);
+        }
+
+        // The producer is faster than the writer, so it must have been stalled.
+        auto stats = pWriter->getStats();
+        EXPECT_GT(stats.stallCount, 0u);
+        EXPECT_GT(stats.stallTimeMs, 0.0);
+
+        pWriter->flush();
+        EXPECT_EQ(completed.load(), kJobCount);
+
+        // Exceptions thrown by jobs are logged and don't stop the workers.
+        pWriter->submit([] () { throw std::exception("FrameWriter_Backpressure: expected exception"); });
+        pWriter->submit([&] () { completed++; });
+        pWriter->flush();
+        EXPECT_EQ(completed.load(), kJobCount + 1);
+    }
+
+    CPU_TEST(FrameWriter_Images)
+    {
+        const uint32_t kFrameCount = 8;
+        const uint32_t kWidth = 64;
+        const uint32_t kHeight = 32;
+
+        // Write synthetic frames where all channels of frame i have the value 16 * i + 5.
+        std::vector<std::string> filenames;
+        {
+            auto pWriter = FrameWriter::create(3, 4);
+            for (uint32_t i = 0; i < kFrameCount; i++)
+            {
+                std::vector<uint8_t> data(kWidth * kHeight * 4, (uint8_t)(16 * i + 5));
+                filenames.push_back(getTempFilename() + ".png");
+                pWriter->writeImage(filenames.back(), kWidth, kHeight, Bitmap::FileFormat::PngFile, Bitmap::ExportFlags::ExportAlpha, ResourceFormat::RGBA8Unorm, std::move(data));
+            }
+            // The destructor waits for all writes to complete.
+        }
+
+        for (uint32_t i = 0; i < kFrameCount; i++)
+        {
+            auto pBitmap = Bitmap::createFromFile(filenames[i], true);
+            EXPECT(pBitmap != nullptr) << filenames[i];
+            if (!pBitmap) continue;
+            EXPECT_EQ(pBitmap->getWidth(), kWidth);
+            EXPECT_EQ(pBitmap->getHeight(), kHeight);
+            EXPECT_EQ(getFormatBytesPerBlock(pBitmap->getFormat()), 4u);
+
+            uint32_t mismatchCount = 0;
+            for (uint32_t j = 0; j < pBitmap->getSize(); j++)
+            {
+                if (pBitmap->getData()[j] != (uint8_t)(16 * i + 5)) mismatchCount++;
+            }
+            EXPECT_EQ(mismatchCount, 0u) << filenames[i];
+
+            std::filesystem::remove(filenames[i]);
+        }
+    }
+}
@@ -0,0 +1,207 @@
+/***************************************************************************
+ # Copyright (c) 2015-21, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "Testing/UnitTest.h"
+#include "Utils/Algorithm/HostParallel.h"
+#include "Utils/Timing/CpuTimer.h"
+#include <numeric>
+#include <random>
+
+namespace Falcor
+{
+    namespace
+    {
+        // Sizes below, at and above the block size, and large enough to use the maximum block count.
+        const size_t kTestSizes[] = { 0, 1, 27, 16384, 16385, 100003, 5000011 };
+
+        template<typename T>
+        std::vector<T> createRandomData(size_t count, uint32_t seed, T maxValue = std::numeric_limits<T>::max())
+        {
+            std::mt19937_64 r(seed);
+            std::uniform_int_distribution<T> dist(0, maxValue);
+            std::vector<T> data(count);
+            for (auto& it : data) it = dist(r);
+            return data;
+        }
+    }
+
+    CPU_TEST(HostParallel_InclusiveScan)
+    {
+        for (size_t count : kTestSizes)
+        {
+            auto data = createRandomData<uint32_t>(count, 1);
+            std::vector<uint32_t> ref(count);
+            std::inclusive_scan(data.begin(), data.end(), ref.begin());
+            HostParallel::inclusiveScan(data.data(), count);
+            EXPECT(data == ref) << "count = " << count;
+
+            // Non-commutative operator.
+            auto maxData = createRandomData<uint64_t>(count, 2);
+            std::vector<uint64_t> maxRef(count);
+            std::inclusive_scan(maxData.begin(), maxData.end(), maxRef.begin(), [](uint64_t a, uint64_t b) { return std::max(a, b); });
+            HostParallel::inclusiveScan(maxData.data(), count, [](uint64_t a, uint64_t b) { return std::max(a, b); });
+            EXPECT(maxData == maxRef) << "count = " << count;
+        }
+    }
+
+    CPU_TEST(HostParallel_ExclusiveScan)
+    {
+        for (size_t count : kTestSizes)
+        {
+            auto data = createRandomData<uint64_t>(count, 3, 1000);
+            std::vector<uint64_t> ref(count);
+            std::exclusive_scan(data.begin(), data.end(), ref.begin(), uint64_t(7));
+            const uint64_t refTotal = std::accumulate(data.begin(), data.end(), uint64_t(7));
+            uint64_t total = HostParallel::exclusiveScan(data.data(), count, uint64_t(7));
+            EXPECT(data == ref) << "count = " << count;
+            EXPECT_EQ(total, refTotal) << "count = " << count;
+        }
+    }
+
+    CPU_TEST(HostParallel_Reduce)
+    {
+        for (size_t count : kTestSizes)
+        {
+            auto data = createRandomData<uint32_t>(count, 4);
+            const uint64_t refSum = std::accumulate(data.begin(), data.end(), uint64_t(0));
+            std::vector<uint64_t> data64(data.begin(), data.end());
+            EXPECT_EQ(HostParallel::reduce(data64.data(), count), refSum) << "count = " << count;
+            EXPECT_EQ(HostParallel::reduce(data.data(), count, 0u, [](uint32_t a, uint32_t b) { return a ^ b; }),
+                std::accumulate(data.begin(), data.end(), 0u, [](uint32_t a, uint32_t b) { return a ^ b; })) << "count = " << count;
+
+            if (count == 0) continue;
+            auto [minValue, maxValue] = HostParallel::minMax(data.data(), count);
+            EXPECT_EQ(minValue, *std::min_element(data.begin(), data.end())) << "count = " << count;
+            EXPECT_EQ(maxValue, *std::max_element(data.begin(), data.end())) << "count = " << count;
+        }
+
+        // The result of a floating-point reduction does not depend on the number of threads.
+        std::vector<float> floats(1000000);
+        std::mt19937 r;
+        for (auto& f : floats) f = std::uniform_real_distribution<float>()(r);
+        const float sum = HostParallel::reduce(floats.data(), floats.size());
+        for (uint32_t i = 0; i < 4; i++) EXPECT_EQ(HostParallel::reduce(floats.data(), floats.size()), sum);
+        EXPECT(std::abs(sum - 500000.f) < 2000.f) << "sum = " << sum;
+    }
+
+    CPU_TEST(HostParallel_RadixSort)
+    {
+        for (size_t count : kTestSizes)
+        {
+            auto keys = createRandomData<uint32_t>(count, 5);
+            auto ref = keys;
+            std::sort(ref.begin(), ref.end());
+            HostParallel::radixSort(keys.data(), count);
+            EXPECT(keys == ref) << "count = " << count;
+
+            // 64-bit keys where most digits are equal for all keys, so that passes are skipped.
+            auto keys64 = createRandomData<uint64_t>(count, 6, 0xffff);
+            for (auto& key : keys64) key |= 0xabcd000000000000ull;
+            auto ref64 = keys64;
+            std::sort(ref64.begin(), ref64.end());
+            HostParallel::radixSort(keys64.data(), count);
+            EXPECT(keys64 == ref64) << "count = " << count;
+        }
+    }
+
+    CPU_TEST(HostParallel_RadixSortKeyValue)
+    {
+        for (size_t count : kTestSizes)
+        {
+            // Use few distinct keys and the original position as value to check that the sort is stable.
+            auto keys = createRandomData<uint32_t>(count, 7, 1000);
+            std::vector<uint32_t> values(count);
+            std::iota(values.begin(), values.end(), 0u);
+
+            std::vector<std::pair<uint32_t, uint32_t>> ref(count);
+            for (size_t i = 0; i < count; i++) ref[i] = { keys[i], values[i] };
+            std::stable_sort(ref.begin(), ref.end(), [](const auto& a, const auto& b) { return a.first < b.first; });
+
+            HostParallel::radixSort(keys.data(), values.data(), count);
+            bool equal = true;
+            for (size_t i = 0; i < count; i++) equal &= keys[i] == ref[i].first && values[i] == ref[i].second;
+            EXPECT(equal) << "count = " << count;
+        }
+    }
+
+    CPU_TEST(HostParallel_PartitionAndCompact)
+    {
+        auto isOdd = [](uint32_t x) { return (x & 1) != 0; };
+        for (size_t count : kTestSizes)
+        {
+            auto data = createRandomData<uint32_t>(count, 8);
+
+            std::vector<uint32_t> refCompact;
+            std::copy_if(data.begin(), data.end(), std::back_inserter(refCompact), isOdd);
+            std::vector<uint32_t> compacted(count);
+            size_t compactedCount = HostParallel::compact(data.data(), count, compacted.data(), isOdd);
+            compacted.resize(compactedCount);
+            EXPECT(compacted == refCompact) << "count = " << count;
+
+            std::vector<uint32_t> refIndices;
+            for (uint32_t i = 0; i < (uint32_t)count; i++) if (isOdd(data[i])) refIndices.push_back(i);
+            std::vector<uint32_t> indices(count);
+            indices.resize(HostParallel::compactIndices((uint32_t)count, indices.data(), [&](uint32_t i) { return isOdd(data[i]); }));
+            EXPECT(indices == refIndices) << "count = " << count;
+
+            auto refPartition = data;
+            size_t refCount = std::stable_partition(refPartition.begin(), refPartition.end(), isOdd) - refPartition.begin();
+            size_t partitionCount = HostParallel::partition(data.data(), count, isOdd);
+            EXPECT_EQ(partitionCount, refCount) << "count = " << count;
+            EXPECT(data == refPartition) << "count = " << count;
+        }
+    }
+
+    CPU_TEST(HostParallel_Performance)
+    {
+        const size_t kCount = 1 << 24;
+        auto data = createRandomData<uint32_t>(kCount, 9);
+
+        auto measure = [](auto func)
+        {
+            auto startTime = CpuTimer::getCurrentTimePoint();
+            func();
+            return CpuTimer::calcDuration(startTime, CpuTimer::getCurrentTimePoint());
+        };
+
+        auto keys = data;
+        double stdSortTime = measure([&]() { std::sort(keys.begin(), keys.end()); });
+        auto sortedKeys = std::move(keys);
+        keys = data;
+        double radixSortTime = measure([&]() { HostParallel::radixSort(keys.data(), keys.size()); });
+        EXPECT(keys == sortedKeys);
+
+        std::vector<uint32_t> scanned(kCount);
+        double stdScanTime = measure([&]() { std::inclusive_scan(data.begin(), data.end(), scanned.begin()); });
+        keys = data;
+        double scanTime = measure([&]() { HostParallel::inclusiveScan(keys.data(), keys.size()); });
+        EXPECT(keys == scanned);
+
+        logInfo("HostParallel: " + std::to_string(kCount) + " elements, radixSort " + std::to_string(radixSortTime) + " ms (std::sort " + std::to_string(stdSortTime) + " ms), "
+            "inclusiveScan " + std::to_string(scanTime) + " ms (std::inclusive_scan " + std::to_string(stdScanTime) + " ms)");
+    }
+}
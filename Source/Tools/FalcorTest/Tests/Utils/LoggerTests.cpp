@@ -0,0 +1,288 @@
+/***************************************************************************
+ # Copyright (c) 2015-21, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "Testing/UnitTest.h"
+#include <fstream>
+
+namespace Falcor
+{
+    namespace
+    {
+        /** Sink collecting all messages in memory.
+        */
+        class CaptureSink : public Logger::Sink
+        {
+        public:
+            void write(const Logger::Message& msg) override
+            {
+                std::lock_guard<std::mutex> lock(mMutex);
+                mMessages.push_back(msg);
+            }
+
+            std::vector<Logger::Message> getMessages()
+            {
+                std::lock_guard<std::mutex> lock(mMutex);
+                return mMessages;
+            }
+
+        private:
+            std::mutex mMutex;
+            std::vector<Logger::Message> mMessages;
+        };
+
+        /** Sink only counting the messages, to measure the logger overhead.
+        */
+        class CountSink : public Logger::Sink
+        {
+        public:
+            void write(const Logger::Message& msg) override { mCount++; }
+            uint64_t getCount() const { return mCount; }
+
+        private:
+            std::atomic<uint64_t> mCount = 0;
+        };
+
+        /** Sink logging warnings itself when it receives a message.
+        */
+        class ReentrantSink : public Logger::Sink
+        {
+        public:
+            void write(const Logger::Message& msg) override
+            {
+                mCount++;
+                for (uint32_t i = 0; i < kWarningCount; i++) logWarning("ReentrantSink warning " + std::to_string(i));
+            }
+            uint64_t getCount() const { return mCount; }
+
+            static const uint32_t kWarningCount = 8;
+
+        private:
+            std::atomic<uint64_t> mCount = 0;
+        };
+    }
+
+    CPU_TEST(BoundedMPSCQueue_Capacity)
+    {
+        BoundedMPSCQueue<uint32_t> queue(4);
+        EXPECT_EQ(queue.getCapacity(), 4u);
+
+        for (uint32_t i = 0; i < 4; i++) EXPECT(queue.tryPush(std::move(i)));
+        uint32_t value = 100;
+        EXPECT(!queue.tryPush(std::move(value)));
+
+        uint32_t result;
+        EXPECT(queue.tryPop(result));
+        EXPECT_EQ(result, 0u);
+        EXPECT(queue.tryPush(std::move(value)));
+
+        for (uint32_t expected : { 1u, 2u, 3u, 100u })
+        {
+            EXPECT(queue.tryPop(result));
+            EXPECT_EQ(result, expected);
+        }
+        EXPECT(!queue.tryPop(result));
+    }
+
+    CPU_TEST(BoundedMPSCQueue_MultipleProducers)
+    {
+        const uint32_t kProducerCount = 8;
+        const uint32_t kValueCount = 20000;
+        BoundedMPSCQueue<uint64_t> queue(256);
+
+        std::vector<std::thread> producers;
+        for (uint32_t p = 0; p < kProducerCount; p++)
+        {
+            producers.emplace_back([&queue, p]()
+            {
+                for (uint32_t i = 0; i < kValueCount; i++)
+                {
+                    uint64_t value = ((uint64_t)p << 32) | i;
+                    while (!queue.tryPush(std::move(value))) std::this_thread::yield();
+                }
+            });
+        }
+
+        // Values from each producer must arrive complete and in order.
+        std::vector<uint32_t> nextValue(kProducerCount, 0);
+        uint64_t errorCount = 0;
+        for (uint64_t received = 0; received < (uint64_t)kProducerCount * kValueCount;)
+        {
+            uint64_t value;
+            if (!queue.tryPop(value))
+            {
+                std::this_thread::yield();
+                continue;
+            }
+            uint32_t p = (uint32_t)(value >> 32);
+            if (p >= kProducerCount || (uint32_t)value != nextValue[p]++) errorCount++;
+            received++;
+        }
+
+        for (auto& t : producers) t.join();
+        EXPECT_EQ(errorCount, 0u);
+        uint64_t value;
+        EXPECT(!queue.tryPop(value));
+    }
+
+    CPU_TEST(Logger_Sink)
+    {
+        const uint32_t kThreadCount = 4;
+        const uint32_t kMessageCount = 100;
+
+        auto pSink = std::make_shared<CaptureSink>();
+        Logger::addSink(pSink);
+
+        std::vector<std::thread> threads;
+        for (uint32_t t = 0; t < kThreadCount; t++)
+        {
+            threads.emplace_back([t]()
+            {
+                for (uint32_t i = 0; i < kMessageCount; i++) logInfo("Logger_Sink " + std::to_string(t) + " " + std::to_string(i));
+            });
+        }
+        for (auto& t : threads) t.join();
+        logWarning("Logger_Sink warning");
+
+        Logger::flush();
+        Logger::removeSink(pSink);
+        logInfo("Logger_Sink after removal");
+        Logger::flush();
+
+        auto messages = pSink->getMessages();
+        EXPECT_EQ(messages.size(), kThreadCount * kMessageCount + 1);
+        if (messages.empty()) return;
+
+        // Messages from each thread are in order, with one thread ID per thread and increasing timestamps.
+        std::map<uint32_t, std::pair<uint32_t, uint32_t>> threadToIndex;
+        std::map<uint32_t, uint64_t> lastTimestamp;
+        for (size_t i = 0; i + 1 < messages.size(); i++)
+        {
+            const auto& msg = messages[i];
+            EXPECT(msg.level == Logger::Level::Info);
+
+            uint32_t t, index;
+            EXPECT_EQ(std::sscanf(msg.text.c_str(), "Logger_Sink %u %u", &t, &index), 2);
+            auto it = threadToIndex.find(msg.threadID);
+            if (it == threadToIndex.end()) it = threadToIndex.emplace(msg.threadID, std::make_pair(t, 0u)).first;
+            EXPECT_EQ(it->second.first, t);
+            EXPECT_EQ(it->second.second++, index);
+
+            EXPECT_GE(msg.timestamp, lastTimestamp[msg.threadID]);
+            lastTimestamp[msg.threadID] = msg.timestamp;
+        }
+        EXPECT_EQ(threadToIndex.size(), kThreadCount);
+
+        EXPECT(messages.back().level == Logger::Level::Warning);
+        EXPECT_EQ(messages.back().text, "Logger_Sink warning");
+    }
+
+    CPU_TEST(Logger_JsonSink)
+    {
+        std::string path = getTempFilename();
+        auto pSink = Logger::createJsonSink(path);
+        Logger::addSink(pSink);
+        logInfo("Logger_JsonSink \"quoted\"\tand\\escaped\nline");
+        Logger::flush();
+        Logger::removeSink(pSink);
+        pSink = nullptr;
+
+        std::ifstream file(path);
+        std::string line;
+        EXPECT(!std::getline(file, line).fail());
+        EXPECT(line.find("\"level\":\"Info\"") != std::string::npos) << line;
+        EXPECT(line.find("\"message\":\"Logger_JsonSink \\\"quoted\\\"\\tand\\\\escaped\\nline\"") != std::string::npos) << line;
+        EXPECT(line.find("\"time\":") != std::string::npos) << line;
+        EXPECT(line.find("\"thread\":") != std::string::npos) << line;
+        EXPECT(std::getline(file, line).fail());
+        file.close();
+        std::filesystem::remove(path);
+    }
+
+    /** Test logging from within a sink.
+        The messages are written synchronously on the worker thread instead of waiting for the queue, and are not passed back to the sinks.
+    */
+    CPU_TEST(Logger_LogFromSink)
+    {
+        auto pSink = std::make_shared<ReentrantSink>();
+        Logger::flush();
+        auto before = Logger::getStats();
+
+        Logger::addSink(pSink);
+        logInfo("Logger_LogFromSink");
+        Logger::flush();
+        Logger::removeSink(pSink);
+        auto after = Logger::getStats();
+
+        EXPECT_EQ(pSink->getCount(), 1u);
+        EXPECT_EQ(after.queuedCount - before.queuedCount, 1u);
+        EXPECT_EQ(after.writtenCount, after.queuedCount);
+    }
+
+    /** Stress test logging from many threads at once.
+        Messages that don't fit in the queue are dropped, but every message must be accounted for exactly once.
+        The time per message is logged as a benchmark.
+    */
+    CPU_TEST(Logger_Stress)
+    {
+        const uint32_t kThreadCount = 32;
+        const uint32_t kMessageCount = 1000;
+        const uint64_t kTotalCount = (uint64_t)kThreadCount * kMessageCount;
+
+        auto pSink = std::make_shared<CountSink>();
+        Logger::addSink(pSink);
+        Logger::flush();
+        auto before = Logger::getStats();
+
+        Barrier barrier(kThreadCount);
+        auto start = CpuTimer::getCurrentTimePoint();
+        std::vector<std::thread> threads;
+        for (uint32_t t = 0; t < kThreadCount; t++)
+        {
+            threads.emplace_back([&barrier, t]()
+            {
+                barrier.wait();
+                for (uint32_t i = 0; i < kMessageCount; i++) logInfo("Logger_Stress " + std::to_string(t) + " " + std::to_string(i));
+            });
+        }
+        for (auto& t : threads) t.join();
+        double producerMs = CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint());
+
+        Logger::flush();
+        double totalMs = CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint());
+        Logger::removeSink(pSink);
+        auto after = Logger::getStats();
+
+        uint64_t queued = after.queuedCount - before.queuedCount;
+        uint64_t dropped = after.droppedCount - before.droppedCount;
+        EXPECT_EQ(queued + dropped, kTotalCount);
+        EXPECT_EQ(pSink->getCount(), queued);
+        EXPECT_EQ(after.writtenCount, after.queuedCount);
+
+        logInfo("Logger_Stress: " + std::to_string(kThreadCount) + " threads, " + std::to_string(producerMs * 1e6 / kTotalCount) + " ns per message on producers, "
+            + std::to_string(totalMs) + " ms until written, " + std::to_string(dropped) + " dropped.");
+    }
+}
@@ -27,6 +27,7 @@
  **************************************************************************/
 #include "Testing/UnitTest.h"
 #include "Utils/Algorithm/PrefixSum.h"
+#include "Utils/Algorithm/HostParallel.h"
 #include <random>
 
 namespace Falcor
@@ -86,6 +87,26 @@ namespace Falcor
             }
             pTestDataBuffer->unmap();
         }
+
+        void testHostPrefixSum(CPUUnitTestContext& ctx, uint32_t numElems)
+        {
+            // Create random test data in the same way as for the GPU.
+            assert(numElems > 0);
+            const uint32_t maxVal = std::numeric_limits<uint32_t>::max() / numElems;
+            std::vector<uint32_t> testData(numElems);
+            std::mt19937 r;
+            for (auto& it : testData) it = r() % maxVal;
+
+            std::vector<uint32_t> result = testData;
+            uint32_t sum = HostParallel::exclusiveScan(result.data(), result.size());
+
+            const uint32_t refSum = prefixSum(testData);
+            EXPECT_EQ(sum, refSum);
+            for (uint32_t i = 0; i < numElems; i++)
+            {
+                EXPECT_EQ(testData[i], result[i]) << "i = " << i;
+            }
+        }
     }
 
     GPU_TEST(PrefixSum)
@@ -109,4 +130,17 @@ namespace Falcor
         testPrefixSum(ctx, pPrefixSum, 1088921);
         testPrefixSum(ctx, pPrefixSum, 13912615);
     }
+
+    CPU_TEST(PrefixSumHost)
+    {
+        // Test the host prefix sum with the same buffer sizes as the GPU version.
+        testHostPrefixSum(ctx, 1);
+        testHostPrefixSum(ctx, 27);
+        testHostPrefixSum(ctx, 64);
+        testHostPrefixSum(ctx, 2049);
+        testHostPrefixSum(ctx, 10201);
+        testHostPrefixSum(ctx, 231917);
+        testHostPrefixSum(ctx, 1088921);
+        testHostPrefixSum(ctx, 13912615);
+    }
 }
@@ -0,0 +1,198 @@
+/***************************************************************************
+ # Copyright (c) 2015-21, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "Testing/UnitTest.h"
+#include <fstream>
+
+namespace Falcor
+{
+    namespace
+    {
+        size_t countOccurrences(const std::string& str, const std::string& pattern)
+        {
+            size_t count = 0;
+            for (size_t pos = str.find(pattern); pos != std::string::npos; pos = str.find(pattern, pos + pattern.size())) count++;
+            return count;
+        }
+    }
+
+    CPU_TEST(TraceProfiler_MultipleThreads)
+    {
+        const uint32_t kThreadCount = 4;
+        const uint32_t kZoneCount = 1000;
+
+        TraceProfiler::start();
+
+        std::vector<std::thread> threads;
+        for (uint32_t t = 0; t < kThreadCount; t++)
+        {
+            threads.emplace_back([t]()
+            {
+                TraceProfiler::setThreadName("TraceProfilerTestWorker" + std::to_string(t));
+                for (uint32_t i = 0; i < kZoneCount; i++)
+                {
+                    TraceZone outer("TraceProfilerTest::outer");
+                    TraceZone inner("TraceProfilerTest::inner");
+                }
+            });
+        }
+        for (auto& t : threads) t.join();
+
+        TraceProfiler::stop();
+
+        // Zones recorded after the capture has stopped are ignored.
+        {
+            TraceZone zone("TraceProfilerTest::stopped");
+        }
+
+        auto stats = TraceProfiler::getStats();
+        EXPECT_EQ(stats.threadCount, kThreadCount);
+        EXPECT_EQ(stats.eventCount, 2 * kThreadCount * kZoneCount);
+        EXPECT_EQ(stats.droppedCount, 0u);
+
+        std::string json = TraceProfiler::toChromeTraceJson();
+        EXPECT_EQ(countOccurrences(json, "\"name\": \"TraceProfilerTest::outer\""), kThreadCount * kZoneCount);
+        EXPECT_EQ(countOccurrences(json, "\"name\": \"TraceProfilerTest::inner\""), kThreadCount * kZoneCount);
+        EXPECT_EQ(countOccurrences(json, "TraceProfilerTest::stopped"), 0u);
+        EXPECT_EQ(countOccurrences(json, "\"ph\": \"X\""), 2 * kThreadCount * kZoneCount);
+        EXPECT_EQ(countOccurrences(json, "\"name\": \"thread_name\""), kThreadCount);
+        for (uint32_t t = 0; t < kThreadCount; t++)
+        {
+            EXPECT_EQ(countOccurrences(json, "\"name\": \"TraceProfilerTestWorker" + std::to_string(t) + "\""), 1u);
+        }
+
+        // A new capture discards the previous events.
+        TraceProfiler::start();
+        TraceProfiler::stop();
+        EXPECT_EQ(TraceProfiler::getStats().eventCount, 0u);
+    }
+
+    CPU_TEST(TraceProfiler_Flow)
+    {
+        TraceProfiler::start();
+
+        uint64_t flowID = TraceProfiler::newFlowID();
+        EXPECT_NE(flowID, 0u);
+        EXPECT_NE(TraceProfiler::newFlowID(), flowID);
+
+        {
+            TraceZone zone("TraceProfilerTest::producer");
+            TraceProfiler::flowBegin(flowID, "TraceProfilerTest::flow");
+        }
+        std::thread consumer([flowID]()
+        {
+            TraceZone zone("TraceProfilerTest::consumer");
+            TraceProfiler::flowEnd(flowID, "TraceProfilerTest::flow");
+        });
+        consumer.join();
+
+        TraceProfiler::stop();
+
+        std::string json = TraceProfiler::toChromeTraceJson();
+        EXPECT_EQ(countOccurrences(json, "\"ph\": \"s\", \"id\": " + std::to_string(flowID) + ","), 1u) << json;
+        EXPECT_EQ(countOccurrences(json, "\"ph\": \"f\", \"bp\": \"e\", \"id\": " + std::to_string(flowID) + ","), 1u) << json;
+        EXPECT_EQ(countOccurrences(json, "TraceProfilerTest::flow"), 2u);
+
+        // The file contains the same events.
+        std::string path = getTempFilename();
+        EXPECT(TraceProfiler::writeChromeTrace(path));
+        std::ifstream file(path);
+        std::string contents((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+        file.close();
+        std::filesystem::remove(path);
+        EXPECT_EQ(countOccurrences(contents, "TraceProfilerTest::flow"), 2u);
+        EXPECT_EQ(countOccurrences(contents, "\"ph\": \"X\""), 2u);
+    }
+
+    CPU_TEST(TraceProfiler_Escaping)
+    {
+        TraceProfiler::start();
+        {
+            TraceZone zone(TraceProfiler::internName("TraceProfilerTest \"quoted\"\\path"));
+        }
+        TraceProfiler::stop();
+
+        EXPECT_EQ(TraceProfiler::internName("TraceProfilerTest::interned"), TraceProfiler::internName(std::string("TraceProfilerTest::") + "interned"));
+
+        std::string json = TraceProfiler::toChromeTraceJson();
+        EXPECT_EQ(countOccurrences(json, "\"name\": \"TraceProfilerTest \\\"quoted\\\"\\\\path\""), 1u) << json;
+    }
+
+    CPU_TEST(TraceProfiler_ZoneMacro)
+    {
+        TraceProfiler::start();
+        {
+            // Multiple zones in the same scope need unique variable names.
+            TRACE_ZONE("TraceProfilerTest::first");
+            TRACE_ZONE("TraceProfilerTest::second");
+        }
+        TraceProfiler::stop();
+
+#if _PROFILING_ENABLED
+        EXPECT_EQ(TraceProfiler::getStats().eventCount, 2u);
+        std::string json = TraceProfiler::toChromeTraceJson();
+        EXPECT_EQ(countOccurrences(json, "\"name\": \"TraceProfilerTest::first\""), 1u);
+        EXPECT_EQ(countOccurrences(json, "\"name\": \"TraceProfilerTest::second\""), 1u);
+#endif
+    }
+
+    /** Measure the overhead of recording a zone.
+        The target is below 50 ns per zone with the capture enabled. The result is only logged, as wall-clock timings are unreliable on loaded machines.
+    */
+    CPU_TEST(TraceProfiler_Benchmark)
+    {
+        const uint32_t kZoneCount = 500000;
+
+        // Zones when not capturing.
+        auto start = CpuTimer::getCurrentTimePoint();
+        for (uint32_t i = 0; i < kZoneCount; i++)
+        {
+            TraceZone zone("TraceProfilerTest::benchmark");
+        }
+        double disabledMs = CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint());
+
+        // Zones when capturing. The first pass allocates the event buffers.
+        double enabledMs = 0.0;
+        for (uint32_t pass = 0; pass < 2; pass++)
+        {
+            TraceProfiler::start();
+            start = CpuTimer::getCurrentTimePoint();
+            for (uint32_t i = 0; i < kZoneCount; i++)
+            {
+                TraceZone zone("TraceProfilerTest::benchmark");
+            }
+            enabledMs = CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint());
+            TraceProfiler::stop();
+        }
+
+        EXPECT_EQ(TraceProfiler::getStats().eventCount, kZoneCount);
+
+        double disabledNs = disabledMs * 1e6 / kZoneCount;
+        double enabledNs = enabledMs * 1e6 / kZoneCount;
+        logInfo("TraceProfiler_Benchmark: " + std::to_string(enabledNs) + " ns per zone when capturing, " + std::to_string(disabledNs) + " ns per zone when not capturing.");
+    }
+}
@@ -25,12 +25,26 @@
  # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
  # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  **************************************************************************/
+#include "Falcor.h"
+
 #include <FreeImage.h>
 #include <args.hxx>
-
+#include <emmintrin.h>
+
+#include <atomic>
+#include <chrono>
+#include <execution>
+#include <filesystem>
+#include <fstream>
+#include <future>
+#include <iomanip>
 #include <iostream>
 #include <memory>
+#include <numeric>
+#include <random>
+#include <sstream>
 #include <string>
+#include <thread>
 #include <vector>
 #include <stdexcept>
 #include <map>
@@ -159,70 +173,221 @@ private:
     {}
 };
 
+/** Per-pixel error kernels.
+    Each kernel evaluates the per-channel error of one RGBA pixel using SSE.
+*/
 struct MSE
 {
-    double operator()(const float* a, const float* b, size_t count) const
+    static __m128 eval(__m128 a, __m128 b)
     {
-        double error = 0.0;
-        for (size_t i = 0; i < count; ++i) { error += sqr(a[i] - b[i]); }
-        return error / count;
+        __m128 d = _mm_sub_ps(a, b);
+        return _mm_mul_ps(d, d);
     }
 };
 
 struct RMSE
 {
-    double operator()(const float* a, const float* b, size_t count) const
+    static __m128 eval(__m128 a, __m128 b)
     {
-        double error = 0.0;
-        for (size_t i = 0; i < count; ++i) { error += sqr(a[i] - b[i]) / (sqr(a[i]) + 1e-3); }
-        return error / count;
+        __m128 d = _mm_sub_ps(a, b);
+        return _mm_div_ps(_mm_mul_ps(d, d), _mm_add_ps(_mm_mul_ps(a, a), _mm_set1_ps(1e-3f)));
     }
 };
 
 struct MAE
 {
-    double operator()(const float* a, const float* b, size_t count) const
+    static __m128 eval(__m128 a, __m128 b)
     {
-        double error = 0.0;
-        for (size_t i = 0; i < count; ++i) { error += std::fabs(sqr(a[i] - b[i])); }
-        return error / count;
+        __m128 d = _mm_sub_ps(a, b);
+        return _mm_andnot_ps(_mm_set1_ps(-0.f), _mm_mul_ps(d, d));
     }
 };
 
 struct MAPE
 {
-    double operator()(const float* a, const float* b, size_t count) const
+    static __m128 eval(__m128 a, __m128 b)
     {
-        double error = 0.0;
-        for (size_t i = 0; i < count; ++i) { error += std::fabs((a[i] - b[i]) / (a[i] + 1e-3)); }
-        return 100.0 * error / count;
+        __m128 d = _mm_div_ps(_mm_sub_ps(a, b), _mm_add_ps(a, _mm_set1_ps(1e-3f)));
+        return _mm_mul_ps(_mm_andnot_ps(_mm_set1_ps(-0.f), d), _mm_set1_ps(100.f));
     }
 };
 
+static float horizontalSum(__m128 v)
+{
+    __m128 t = _mm_add_ps(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 3, 0, 1)));
+    t = _mm_add_ss(t, _mm_shuffle_ps(t, t, _MM_SHUFFLE(1, 0, 3, 2)));
+    return _mm_cvtss_f32(t);
+}
+
+/** Run a function for each row of an image in parallel and return the sum of the per-row results.
+*/
+template<typename Func>
+double parallelRowSum(uint32_t height, Func func)
+{
+    std::vector<double> rowSums(height, 0.0);
+    Falcor::NumericRange<uint32_t> rows(0, height);
+    std::for_each(std::execution::par, rows.begin(), rows.end(), [&] (uint32_t y) { rowSums[y] = func(y); });
+    return std::accumulate(rowSums.begin(), rowSums.end(), 0.0);
+}
+
 template<typename Metric>
 double compare(const Image& imageA, const Image& imageB, bool alpha, float* errorMap)
 {
-    Metric metric;
-    double sum = 0.0;
-    const float* a = imageA.getData();
-    const float* b = imageB.getData();
-    size_t count = imageA.getWidth() * imageA.getHeight();
-    for (size_t i = 0; i < count; ++i)
+    const uint32_t width = imageA.getWidth();
+    const uint32_t height = imageA.getHeight();
+    const __m128 mask = _mm_castsi128_ps(_mm_set_epi32(alpha ? -1 : 0, -1, -1, -1));
+    const float scale = 1.f / (alpha ? 4 : 3);
+
+    double sum = parallelRowSum(height, [&] (uint32_t y)
     {
-        double error = metric(a, b, alpha ? 4 : 3);
-        if (errorMap) *errorMap++ = float(error);
-        sum += error;
-        a += 4;
-        b += 4;
+        const float* a = imageA.getData() + size_t(y) * width * 4;
+        const float* b = imageB.getData() + size_t(y) * width * 4;
+        float* dst = errorMap + size_t(y) * width;
+        double rowSum = 0.0;
+        for (uint32_t x = 0; x < width; ++x)
+        {
+            __m128 error = _mm_and_ps(Metric::eval(_mm_loadu_ps(a), _mm_loadu_ps(b)), mask);
+            float pixelError = horizontalSum(error) * scale;
+            dst[x] = pixelError;
+            rowSum += pixelError;
+            a += 4;
+            b += 4;
+        }
+        return rowSum;
+    });
+
+    return sum / (double(width) * height);
+}
+
+/** Structural dissimilarity (1 - SSIM) averaged over the compared channels.
+    Uses the standard 11x11 Gaussian window (sigma 1.5) applied as a separable filter with clamp-to-edge addressing.
+*/
+static double compareSSIM(const Image& imageA, const Image& imageB, bool alpha, float* errorMap)
+{
+    const int kRadius = 5;
+    const float kSigma = 1.5f;
+    const float C1 = sqr(0.01f);
+    const float C2 = sqr(0.03f);
+
+    float kernel[2 * kRadius + 1];
+    float kernelSum = 0.f;
+    for (int i = -kRadius; i <= kRadius; ++i) kernelSum += kernel[i + kRadius] = std::exp(-float(i * i) / (2.f * kSigma * kSigma));
+    for (float& w : kernel) w /= kernelSum;
+
+    const uint32_t width = imageA.getWidth();
+    const uint32_t height = imageA.getHeight();
+    const uint32_t channels = alpha ? 4 : 3;
+    const size_t count = size_t(width) * height;
+
+    // Horizontally filtered a, b, a^2, b^2 and a*b.
+    std::vector<float> planes[5];
+    for (auto& plane : planes) plane.resize(count);
+    std::fill(errorMap, errorMap + count, 0.f);
+
+    Falcor::NumericRange<uint32_t> rows(0, height);
+    for (uint32_t c = 0; c < channels; ++c)
+    {
+        std::for_each(std::execution::par, rows.begin(), rows.end(), [&] (uint32_t y)
+        {
+            // Gather the channel into padded rows of a, b, a^2, b^2 and a*b.
+            const float* a = imageA.getData() + size_t(y) * width * 4 + c;
+            const float* b = imageB.getData() + size_t(y) * width * 4 + c;
+            std::vector<float> padded[5];
+            for (auto& row : padded) row.resize(width + 2 * kRadius);
+            for (int x = 0; x < int(width) + 2 * kRadius; ++x)
+            {
+                const size_t sx = size_t(clamp(x - kRadius, 0, int(width) - 1)) * 4;
+                padded[0][x] = a[sx];
+                padded[1][x] = b[sx];
+                padded[2][x] = a[sx] * a[sx];
+                padded[3][x] = b[sx] * b[sx];
+                padded[4][x] = a[sx] * b[sx];
+            }
+
+            const size_t offset = size_t(y) * width;
+            for (size_t i = 0; i < 5; ++i)
+            {
+                float* dst = planes[i].data() + offset;
+                std::fill(dst, dst + width, 0.f);
+                for (int k = 0; k <= 2 * kRadius; ++k)
+                {
+                    const float w = kernel[k];
+                    const float* src = padded[i].data() + k;
+                    for (uint32_t x = 0; x < width; ++x) dst[x] += w * src[x];
+                }
+            }
+        });
+
+        std::for_each(std::execution::par, rows.begin(), rows.end(), [&] (uint32_t y)
+        {
+            std::vector<float> sums[5];
+            for (size_t i = 0; i < 5; ++i)
+            {
+                sums[i].assign(width, 0.f);
+                for (int k = -kRadius; k <= kRadius; ++k)
+                {
+                    const size_t sy = size_t(clamp(int(y) + k, 0, int(height) - 1));
+                    const float w = kernel[k + kRadius];
+                    const float* src = planes[i].data() + sy * width;
+                    float* dst = sums[i].data();
+                    for (uint32_t x = 0; x < width; ++x) dst[x] += w * src[x];
+                }
+            }
+
+            float* dst = errorMap + size_t(y) * width;
+            for (uint32_t x = 0; x < width; ++x)
+            {
+                const float muA = sums[0][x];
+                const float muB = sums[1][x];
+                const float varA = sums[2][x] - muA * muA;
+                const float varB = sums[3][x] - muB * muB;
+                const float covAB = sums[4][x] - muA * muB;
+                dst[x] += ((2.f * muA * muB + C1) * (2.f * covAB + C2)) / ((muA * muA + muB * muB + C1) * (varA + varB + C2));
+            }
+        });
     }
+
+    double sum = parallelRowSum(height, [&] (uint32_t y)
+    {
+        float* dst = errorMap + size_t(y) * width;
+        double rowSum = 0.0;
+        for (uint32_t x = 0; x < width; ++x)
+        {
+            dst[x] = 1.f - dst[x] / channels;
+            rowSum += dst[x];
+        }
+        return rowSum;
+    });
+
     return sum / count;
 }
 
+/** FLIP error using the CPU implementation of FLIPPass with default viewing conditions.
+    The first image is the reference. The alpha channel is ignored.
+*/
+static double compareFLIP(const Image& imageA, const Image& imageB, bool alpha, float* errorMap)
+{
+    static const Falcor::FLIP::SharedPtr pFLIP = Falcor::FLIP::create();
+    return pFLIP->computeLDR(imageA.getData(), imageB.getData(), imageA.getWidth(), imageA.getHeight(), errorMap);
+}
+
+/** HDR-FLIP error using the CPU implementation of FLIPPass with default viewing conditions and the ACES tone mapper.
+    The exposure range is computed from the first image, same as FLIPPass. The alpha channel is ignored.
+*/
+static double compareHDRFLIP(const Image& imageA, const Image& imageB, bool alpha, float* errorMap)
+{
+    static const Falcor::FLIP::SharedPtr pFLIP = Falcor::FLIP::create();
+    const auto toneMapper = Falcor::FLIP::ToneMapper::ACES;
+    auto exposures = Falcor::FLIP::computeExposureParameters(toneMapper, imageA.getData(), imageA.getWidth(), imageA.getHeight());
+    return pFLIP->computeHDR(imageA.getData(), imageB.getData(), imageA.getWidth(), imageA.getHeight(), exposures, toneMapper, errorMap);
+}
+
 struct ErrorMetric
 {
     std::string name;
     std::string desc;
     std::function<double(const Image& imageA, const Image& imageB, bool alpha, float* errorMap)> compare;
+    bool reportPooledValues = false;    ///< Report pooled statistics (weighted percentiles) of the error map.
 };
 
 static const std::vector<ErrorMetric> errorMetrics =
@@ -231,8 +396,43 @@ static const std::vector<ErrorMetric> errorMetrics =
     { "rmse", "Relative Mean Squared Error", compare<RMSE> },
     { "mae", "Mean Absolute Error", compare<MAE> },
     { "mape", "Mean Absolute Percentage Error", compare<MAPE> },
+    { "ssim", "Structural Dissimilarity (1 - SSIM)", compareSSIM },
+    { "flip", "FLIP (LDR, same as FLIPPass)", compareFLIP, true },
+    { "hdrflip", "HDR-FLIP (ACES, automatic exposure range, same as FLIPPass)", compareHDRFLIP, true },
 };
 
+/** Average the error map over square tiles.
+    \param[in] tileSize Tile size in pixels.
+    \param[out] tilesX Number of tiles horizontally.
+    \param[out] tilesY Number of tiles vertically.
+    \return Mean error per tile in row-major order.
+*/
+static std::vector<float> computeTileErrors(uint32_t width, uint32_t height, const float* errorMap, uint32_t tileSize, uint32_t& tilesX, uint32_t& tilesY)
+{
+    tilesX = (width + tileSize - 1) / tileSize;
+    tilesY = (height + tileSize - 1) / tileSize;
+    std::vector<float> tileErrors(size_t(tilesX) * tilesY);
+
+    Falcor::NumericRange<uint32_t> tileRows(0, tilesY);
+    std::for_each(std::execution::par, tileRows.begin(), tileRows.end(), [&] (uint32_t ty)
+    {
+        std::vector<double> sums(tilesX, 0.0);
+        const uint32_t y0 = ty * tileSize;
+        const uint32_t y1 = std::min(height, y0 + tileSize);
+        for (uint32_t y = y0; y < y1; ++y)
+        {
+            for (uint32_t x = 0; x < width; ++x) sums[x / tileSize] += errorMap[size_t(y) * width + x];
+        }
+        for (uint32_t tx = 0; tx < tilesX; ++tx)
+        {
+            const uint32_t tileWidth = std::min(width, (tx + 1) * tileSize) - tx * tileSize;
+            tileErrors[size_t(ty) * tilesX + tx] = float(sums[tx] / (double(tileWidth) * (y1 - y0)));
+        }
+    });
+
+    return tileErrors;
+}
+
 static Image::SharedPtr generateHeatMap(uint32_t width, uint32_t height, const float* errorMap)
 {
     auto writeColor = [] (float t, float* dst)
@@ -264,66 +464,393 @@ static Image::SharedPtr generateHeatMap(uint32_t width, uint32_t height, const f
     return image;
 }
 
-static bool compareImages(const std::string& filenameA, const std::string& filenameB, ErrorMetric metric, float threshold, bool alpha, const std::string& heatMapFilename)
+struct CompareOptions
+{
+    ErrorMetric metric;
+    float threshold = 0.f;
+    bool alpha = false;
+    uint32_t tileSize = 0;          ///< Tile size for the heat map and worst tile statistics (0 = per pixel).
+};
+
+struct ComparePair
 {
-    auto loadImage = [] (const std::string& filename)
+    std::string filenameA;
+    std::string filenameB;
+    std::string heatMapFilename;    ///< Heat map output filename (empty = no heat map).
+};
+
+struct CompareResult
+{
+    bool passed = false;
+    double error = 0.0;
+    std::string message;            ///< Error message if the comparison could not be performed.
+    uint32_t width = 0;
+    uint32_t height = 0;
+    bool hasWorstTile = false;
+    uint32_t worstTileX = 0;        ///< Pixel x coordinate of the worst tile.
+    uint32_t worstTileY = 0;        ///< Pixel y coordinate of the worst tile.
+    float worstTileError = 0.f;
+    bool hasPooledValues = false;
+    Falcor::FLIP::PooledValues pooledValues;
+    double loadTime = 0.0;          ///< Image decode time in seconds.
+    double compareTime = 0.0;       ///< Metric evaluation time in seconds.
+};
+
+using Clock = std::chrono::steady_clock;
+
+static double secondsSince(Clock::time_point start)
+{
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+static Image::SharedPtr loadImage(const std::string& filename, std::string& message)
+{
+    try
+    {
+        return Image::loadFromFile(filename);
+    }
+    catch (const std::runtime_error& e)
     {
+        message = "Cannot load image from '" + filename + "' (Error: " + e.what() + ").";
+        return nullptr;
+    }
+}
+
+static CompareResult compareImages(const Image& imageA, const Image& imageB, const CompareOptions& options, const std::string& heatMapFilename)
+{
+    CompareResult result;
+
+    // Check resolution.
+    if (imageA.getWidth() != imageB.getWidth() || imageA.getHeight() != imageB.getHeight())
+    {
+        result.message = "Cannot compare images with different resolutions.";
+        return result;
+    }
+
+    const uint32_t width = imageA.getWidth();
+    const uint32_t height = imageA.getHeight();
+    result.width = width;
+    result.height = height;
+
+    // Compare images.
+    auto start = Clock::now();
+    auto errorMap = std::make_unique<float[]>(size_t(width) * height);
+    result.error = options.metric.compare(imageA, imageB, options.alpha, errorMap.get());
+    result.compareTime = secondsSince(start);
+
+    if (options.metric.reportPooledValues)
+    {
+        result.hasPooledValues = true;
+        result.pooledValues = Falcor::FLIP::computePooledValues(errorMap.get(), size_t(width) * height);
+    }
+
+    // Reduce to tiles.
+    uint32_t mapWidth = width;
+    uint32_t mapHeight = height;
+    const float* map = errorMap.get();
+    std::vector<float> tileErrors;
+    if (options.tileSize > 0)
+    {
+        tileErrors = computeTileErrors(width, height, errorMap.get(), options.tileSize, mapWidth, mapHeight);
+        auto worst = std::max_element(tileErrors.begin(), tileErrors.end());
+        size_t index = std::distance(tileErrors.begin(), worst);
+        result.hasWorstTile = true;
+        result.worstTileX = uint32_t(index % mapWidth) * options.tileSize;
+        result.worstTileY = uint32_t(index / mapWidth) * options.tileSize;
+        result.worstTileError = *worst;
+        map = tileErrors.data();
+    }
+
+    // Generate heat map.
+    if (!heatMapFilename.empty())
+    {
+        auto heatMap = generateHeatMap(mapWidth, mapHeight, map);
         try
         {
-            return Image::loadFromFile(filename);
+            heatMap->saveToFile(heatMapFilename);
         }
         catch (const std::runtime_error& e)
         {
-            std::cerr << "Cannot load image from '" << filename << "' (Error: " << e.what() << ")." << std::endl;
-            return Image::SharedPtr();
+            std::cerr << "Cannot save image to '" << heatMapFilename << "' (Error: " << e.what() << ")." << std::endl;
         }
+    }
+
+    // Treat nans and infs as errors.
+    result.passed = !std::isnan(result.error) && !std::isinf(result.error) && result.error <= options.threshold;
+    return result;
+}
+
+static CompareResult compareFiles(const ComparePair& pair, const CompareOptions& options)
+{
+    CompareResult result;
+
+    // Decode the second image on another thread while decoding the first one.
+    auto start = Clock::now();
+    std::string messageB;
+    auto futureB = std::async(std::launch::async, [&] () { return loadImage(pair.filenameB, messageB); });
+    auto imageA = loadImage(pair.filenameA, result.message);
+    auto imageB = futureB.get();
+    double loadTime = secondsSince(start);
+
+    if (!imageA) return result;
+    if (!imageB)
+    {
+        result.message = messageB;
+        return result;
+    }
+
+    result = compareImages(*imageA, *imageB, options, pair.heatMapFilename);
+    result.loadTime = loadTime;
+    return result;
+}
+
+/** Compare all pairs using a fixed number of concurrent jobs.
+    Each job decodes and compares one pair at a time, limiting the number of images held in memory.
+*/
+static std::vector<CompareResult> compareBatch(const std::vector<ComparePair>& pairs, const CompareOptions& options, uint32_t jobCount)
+{
+    std::vector<CompareResult> results(pairs.size());
+    std::atomic<size_t> nextPair = 0;
+
+    auto worker = [&] ()
+    {
+        for (size_t i = nextPair++; i < pairs.size(); i = nextPair++) results[i] = compareFiles(pairs[i], options);
     };
 
-    auto saveImage = [] (const Image& image, const std::string& filename)
+    std::vector<std::thread> threads;
+    for (uint32_t i = 1; i < std::min<size_t>(jobCount, pairs.size()); ++i) threads.emplace_back(worker);
+    worker();
+    for (auto& thread : threads) thread.join();
+
+    return results;
+}
+
+static bool isImageFile(const std::filesystem::path& path)
+{
+    return std::filesystem::is_regular_file(path) && FreeImage_GetFIFFromFilename(path.string().c_str()) != FIF_UNKNOWN;
+}
+
+/** Build the list of pairs from two directories. Images in the first directory are matched with images at the same relative path in the second one.
+*/
+static std::vector<ComparePair> findDirectoryPairs(const std::filesystem::path& dirA, const std::filesystem::path& dirB, const std::filesystem::path& heatMapDir)
+{
+    std::vector<ComparePair> pairs;
+    for (const auto& entry : std::filesystem::recursive_directory_iterator(dirA))
     {
-        try
+        if (!isImageFile(entry.path())) continue;
+        auto relativePath = std::filesystem::relative(entry.path(), dirA);
+        ComparePair pair;
+        pair.filenameA = entry.path().string();
+        pair.filenameB = (dirB / relativePath).string();
+        if (!heatMapDir.empty()) pair.heatMapFilename = (heatMapDir / relativePath).replace_extension(".png").string();
+        pairs.push_back(pair);
+    }
+
+    std::sort(pairs.begin(), pairs.end(), [] (const ComparePair& a, const ComparePair& b) { return a.filenameA < b.filenameA; });
+    return pairs;
+}
+
+/** Read the list of pairs from a manifest file.
+    Each line holds two image paths and an optional heat map filename, separated by tabs, or by whitespace if the paths contain no spaces.
+    Empty lines and lines starting with '#' are ignored.
+*/
+static std::vector<ComparePair> readManifest(const std::string& filename, const std::filesystem::path& heatMapDir)
+{
+    std::ifstream ifs(filename);
+    if (!ifs) throw std::runtime_error("Cannot open manifest '" + filename + "'");
+
+    std::vector<ComparePair> pairs;
+    std::string line;
+    for (size_t lineNumber = 1; std::getline(ifs, line); ++lineNumber)
+    {
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        if (line.empty() || line[0] == '#') continue;
+
+        std::vector<std::string> fields;
+        if (line.find('\t') != std::string::npos)
         {
-            image.saveToFile(filename);
+            std::istringstream iss(line);
+            for (std::string field; std::getline(iss, field, '\t');) fields.push_back(field);
         }
-        catch (const std::runtime_error& e)
+        else
         {
-            std::cerr << "Cannot save image to '" << filename << "' (Error: " << e.what() << ")." << std::endl;
+            std::istringstream iss(line);
+            for (std::string field; iss >> field;) fields.push_back(field);
+        }
+        if (fields.size() < 2 || fields.size() > 3 || fields[0].empty() || fields[1].empty())
+        {
+            throw std::runtime_error("Invalid manifest entry on line " + std::to_string(lineNumber) + " of '" + filename + "'");
         }
-    };
 
-    // Load images.
-    auto imageA = loadImage(filenameA);
-    if (!imageA) return false;
-    auto imageB = loadImage(filenameB);
-    if (!imageB) return false;
+        ComparePair pair;
+        pair.filenameA = fields[0];
+        pair.filenameB = fields[1];
+        if (fields.size() == 3)
+        {
+            pair.heatMapFilename = fields[2];
+        }
+        else if (!heatMapDir.empty())
+        {
+            // Prefix heat maps with the entry index to avoid name collisions.
+            auto stem = std::filesystem::path(pair.filenameB).stem().string();
+            pair.heatMapFilename = (heatMapDir / (std::to_string(pairs.size()) + "_" + stem + ".png")).string();
+        }
+        pairs.push_back(pair);
+    }
 
-    // Check resolution.
-    if (imageA->getWidth() != imageB->getWidth() || imageA->getHeight() != imageB->getHeight())
+    return pairs;
+}
+
+static std::string jsonString(const std::string& s)
+{
+    std::ostringstream oss;
+    oss << '"';
+    for (char c : s)
     {
-        std::cerr << "Cannot compare images with different resolutions." << std::endl;
+        switch (c)
+        {
+        case '"': oss << "\\\""; break;
+        case '\\': oss << "\\\\"; break;
+        case '\n': oss << "\\n"; break;
+        case '\r': oss << "\\r"; break;
+        case '\t': oss << "\\t"; break;
+        default:
+            if ((unsigned char)c < 0x20) oss << "\\u" << std::hex << std::setw(4) << std::setfill('0') << (int)c << std::dec << std::setfill(' ');
+            else oss << c;
+        }
+    }
+    oss << '"';
+    return oss.str();
+}
+
+static std::string jsonNumber(double value)
+{
+    if (std::isnan(value) || std::isinf(value)) return "null";
+    std::ostringstream oss;
+    oss << std::setprecision(9) << value;
+    return oss.str();
+}
+
+static bool writeJsonReport(const std::string& filename, const std::vector<ComparePair>& pairs, const std::vector<CompareResult>& results, const CompareOptions& options, double totalTime)
+{
+    std::ofstream ofs(filename);
+    if (!ofs)
+    {
+        std::cerr << "Cannot write report to '" << filename << "'." << std::endl;
         return false;
     }
 
-    uint32_t width = imageA->getWidth();
-    uint32_t height = imageB->getHeight();
+    size_t passedCount = std::count_if(results.begin(), results.end(), [] (const CompareResult& r) { return r.passed; });
+
+    ofs << "{\n";
+    ofs << "  \"metric\": " << jsonString(options.metric.name) << ",\n";
+    ofs << "  \"threshold\": " << jsonNumber(options.threshold) << ",\n";
+    ofs << "  \"alpha\": " << (options.alpha ? "true" : "false") << ",\n";
+    ofs << "  \"tileSize\": " << options.tileSize << ",\n";
+    ofs << "  \"summary\": {\n";
+    ofs << "    \"pairs\": " << results.size() << ",\n";
+    ofs << "    \"passed\": " << passedCount << ",\n";
+    ofs << "    \"failed\": " << (results.size() - passedCount) << ",\n";
+    ofs << "    \"seconds\": " << jsonNumber(totalTime) << ",\n";
+    ofs << "    \"imagesPerSecond\": " << jsonNumber(totalTime > 0.0 ? results.size() / totalTime : 0.0) << "\n";
+    ofs << "  },\n";
+    ofs << "  \"results\": [";
+    for (size_t i = 0; i < results.size(); ++i)
+    {
+        const auto& pair = pairs[i];
+        const auto& result = results[i];
+        ofs << (i > 0 ? ",\n" : "\n") << "    {";
+        ofs << "\"image1\": " << jsonString(pair.filenameA);
+        ofs << ", \"image2\": " << jsonString(pair.filenameB);
+        ofs << ", \"passed\": " << (result.passed ? "true" : "false");
+        if (result.message.empty())
+        {
+            ofs << ", \"error\": " << jsonNumber(result.error);
+            ofs << ", \"width\": " << result.width << ", \"height\": " << result.height;
+            ofs << ", \"loadSeconds\": " << jsonNumber(result.loadTime) << ", \"compareSeconds\": " << jsonNumber(result.compareTime);
+            if (result.hasWorstTile)
+            {
+                ofs << ", \"worstTile\": {\"x\": " << result.worstTileX << ", \"y\": " << result.worstTileY << ", \"error\": " << jsonNumber(result.worstTileError) << "}";
+            }
+            if (result.hasPooledValues)
+            {
+                const auto& pooled = result.pooledValues;
+                ofs << ", \"pooled\": {\"mean\": " << jsonNumber(pooled.mean) << ", \"min\": " << jsonNumber(pooled.min) << ", \"max\": " << jsonNumber(pooled.max);
+                ofs << ", \"weightedFirstQuartile\": " << jsonNumber(pooled.weightedFirstQuartile) << ", \"weightedMedian\": " << jsonNumber(pooled.weightedMedian);
+                ofs << ", \"weightedThirdQuartile\": " << jsonNumber(pooled.weightedThirdQuartile) << "}";
+            }
+            if (!pair.heatMapFilename.empty()) ofs << ", \"heatMap\": " << jsonString(pair.heatMapFilename);
+        }
+        else
+        {
+            ofs << ", \"message\": " << jsonString(result.message);
+        }
+        ofs << "}";
+    }
+    ofs << "\n  ]\n}\n";
 
-    // Compare images.
-    std::unique_ptr<float[]> errorMap = heatMapFilename.empty() ? nullptr : std::make_unique<float[]>(width * height);
-    double error = metric.compare(*imageA, *imageB, alpha, errorMap.get());
+    return true;
+}
 
-    // Generate heat map.
-    if (errorMap)
+/** Measure metric throughput on synthetic 4K inputs, and decode throughput of 4K EXR files.
+*/
+static void runBenchmark(uint32_t iterations, uint32_t jobCount)
+{
+    const uint32_t width = 3840;
+    const uint32_t height = 2160;
+
+    // Generate a smooth reference image and a noisy test image.
+    auto imageA = Image::create(width, height);
+    auto imageB = Image::create(width, height);
+    std::mt19937 rng(0);
+    std::uniform_real_distribution<float> noise(-0.05f, 0.05f);
+    for (uint32_t y = 0; y < height; ++y)
     {
-        auto heatMap = generateHeatMap(width, height, errorMap.get());
-        saveImage(*heatMap, heatMapFilename);
+        for (uint32_t x = 0; x < width; ++x)
+        {
+            size_t i = (size_t(y) * width + x) * 4;
+            for (uint32_t c = 0; c < 4; ++c)
+            {
+                float value = 0.5f + 0.4f * std::sin(x * 0.01f + c) * std::cos(y * 0.013f);
+                imageA->getData()[i + c] = value;
+                imageB->getData()[i + c] = value + noise(rng);
+            }
+        }
     }
 
-    std::cout << error << std::endl;
+    std::cout << "Benchmark on " << width << "x" << height << " inputs, " << iterations << " iterations, " << jobCount << " jobs." << std::endl;
 
-    // Treat nans and infs as errors.
-    if (std::isnan(error) || std::isinf(error)) return false;
+    for (const auto& metric : errorMetrics)
+    {
+        CompareOptions options;
+        options.metric = metric;
+
+        auto start = Clock::now();
+        std::atomic<uint32_t> next = 0;
+        auto worker = [&] () { while (next++ < iterations) compareImages(*imageA, *imageB, options, ""); };
+        std::vector<std::thread> threads;
+        for (uint32_t i = 1; i < std::min(jobCount, iterations); ++i) threads.emplace_back(worker);
+        worker();
+        for (auto& thread : threads) thread.join();
+        double seconds = secondsSince(start);
+
+        std::cout << "  " << std::left << std::setw(6) << metric.name << std::right << std::fixed << std::setprecision(2) << std::setw(10) << iterations / seconds << " images/s" << std::endl;
+    }
 
-    return error <= threshold;
+    // Decode throughput.
+    auto path = std::filesystem::temp_directory_path() / "ImageCompareBenchmark.exr";
+    imageA->saveToFile(path.string());
+    auto start = Clock::now();
+    std::atomic<uint32_t> next = 0;
+    auto worker = [&] () { while (next++ < iterations) Image::loadFromFile(path.string()); };
+    std::vector<std::thread> threads;
+    for (uint32_t i = 1; i < std::min(jobCount, iterations); ++i) threads.emplace_back(worker);
+    worker();
+    for (auto& thread : threads) thread.join();
+    double seconds = secondsSince(start);
+    std::filesystem::remove(path);
+
+    std::cout << "  " << std::left << std::setw(6) << "decode" << std::right << std::fixed << std::setprecision(2) << std::setw(10) << iterations / seconds << " images/s (EXR)" << std::endl;
 }
 
 static void printMetrics(std::ostream &stream = std::cout)
@@ -337,16 +864,21 @@ static void printMetrics(std::ostream &stream = std::cout)
 
 int main(int argc, char** argv)
 {
-    args::ArgumentParser parser("Utility to compare images.");
+    args::ArgumentParser parser("Utility to compare images.", "Batch mode: pass two directories to compare images with matching relative paths, or use --manifest.");
     parser.helpParams.programName = "ImageCompare";
     args::HelpFlag helpFlag(parser, "help", "Display this help menu.", {'h', "help"});
     args::Flag listMetricsFlag(parser, "", "List available error metrics.", {'l'});
     args::ValueFlag<std::string> metricFlag(parser, "metric", "The error metric.", {'m'});
     args::ValueFlag<float> thresholdFlag(parser, "threshold", "The error threshold.", {'t'});
     args::Flag alphaFlag(parser, "", "Include alpha channel.", {'a'});
-    args::ValueFlag<std::string> heatMapFlag(parser, "filename", "Generate error heat map.", {'e'});
-    args::Positional<std::string> image1(parser, "image1", "The first image.", args::Options::Required);
-    args::Positional<std::string> image2(parser, "image2", "The second image.", args::Options::Required);
+    args::ValueFlag<std::string> heatMapFlag(parser, "filename", "Generate error heat map (output directory in batch mode).", {'e'});
+    args::ValueFlag<uint32_t> tileFlag(parser, "size", "Average the error over tiles of the given size for the heat map and report the worst tile.", {"tile"});
+    args::ValueFlag<std::string> manifestFlag(parser, "filename", "Compare the image pairs listed in a manifest file (one pair per line).", {"manifest"});
+    args::ValueFlag<std::string> jsonFlag(parser, "filename", "Write a JSON report.", {"json"});
+    args::ValueFlag<uint32_t> jobsFlag(parser, "count", "Number of image pairs processed concurrently in batch mode.", {'j', "jobs"});
+    args::ValueFlag<uint32_t> benchmarkFlag(parser, "iterations", "Benchmark metrics and decoding on 4K inputs.", {"benchmark"});
+    args::Positional<std::string> image1(parser, "image1", "The first (reference) image or directory.");
+    args::Positional<std::string> image2(parser, "image2", "The second image or directory.");
     args::CompletionFlag completionFlag(parser, {"complete"});
 
     try
@@ -382,7 +914,17 @@ int main(int argc, char** argv)
         return 0;
     }
 
-    ErrorMetric metric = errorMetrics.front();
+    // Limit the default number of concurrent jobs, each job holds two decoded images in memory.
+    const uint32_t jobCount = std::max(1u, jobsFlag ? args::get(jobsFlag) : std::min(8u, std::thread::hardware_concurrency()));
+
+    if (benchmarkFlag)
+    {
+        runBenchmark(std::max(1u, args::get(benchmarkFlag)), jobCount);
+        return 0;
+    }
+
+    CompareOptions options;
+    options.metric = errorMetrics.front();
     if (metricFlag)
     {
         auto name = args::get(metricFlag);
@@ -393,15 +935,67 @@ int main(int argc, char** argv)
             printMetrics(std::cerr);
             return 1;
         }
-        metric = *it;
+        options.metric = *it;
     }
+    options.threshold = thresholdFlag ? args::get(thresholdFlag) : 0.f;
+    options.alpha = alphaFlag ? args::get(alphaFlag) : false;
+    options.tileSize = tileFlag ? args::get(tileFlag) : 0;
+
+    const std::string heatMap = heatMapFlag ? args::get(heatMapFlag) : "";
+    const bool directoryMode = image1 && image2 && std::filesystem::is_directory(args::get(image1)) && std::filesystem::is_directory(args::get(image2));
+    const bool batchMode = manifestFlag || directoryMode;
+
+    if (!manifestFlag && (!image1 || !image2))
+    {
+        std::cerr << "Two images, two directories or a manifest are required." << std::endl;
+        std::cerr << parser;
+        return 1;
+    }
+
+    // Build the list of image pairs.
+    std::vector<ComparePair> pairs;
+    try
+    {
+        if (batchMode && !heatMap.empty()) std::filesystem::create_directories(heatMap);
+        if (manifestFlag) pairs = readManifest(args::get(manifestFlag), heatMap);
+        else if (directoryMode) pairs = findDirectoryPairs(args::get(image1), args::get(image2), heatMap);
+        else pairs.push_back({ args::get(image1), args::get(image2), heatMap });
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+
+    for (const auto& pair : pairs)
+    {
+        auto heatMapDir = std::filesystem::path(pair.heatMapFilename).parent_path();
+        if (!heatMapDir.empty()) std::filesystem::create_directories(heatMapDir);
+    }
+
+    auto start = Clock::now();
+    auto results = compareBatch(pairs, options, jobCount);
+    double totalTime = secondsSince(start);
+
+    if (batchMode)
+    {
+        for (size_t i = 0; i < pairs.size(); ++i)
+        {
+            const auto& result = results[i];
+            if (result.message.empty()) std::cout << (result.passed ? "PASS " : "FAIL ") << result.error << " " << pairs[i].filenameA << " " << pairs[i].filenameB << std::endl;
+            else std::cout << "FAIL " << pairs[i].filenameA << " " << pairs[i].filenameB << ": " << result.message << std::endl;
+        }
+        size_t failedCount = std::count_if(results.begin(), results.end(), [] (const CompareResult& r) { return !r.passed; });
+        std::cout << "Compared " << pairs.size() << " pairs (" << failedCount << " failed) in " << totalTime << " s (" << (totalTime > 0.0 ? pairs.size() / totalTime : 0.0) << " pairs/s)." << std::endl;
+    }
+    else
+    {
+        const auto& result = results.front();
+        if (result.message.empty()) std::cout << result.error << std::endl;
+        else std::cerr << result.message << std::endl;
+    }
+
+    if (jsonFlag && !writeJsonReport(args::get(jsonFlag), pairs, results, options, totalTime)) return 1;
 
-    return compareImages(
-        args::get(image1),
-        args::get(image2),
-        metric,
-        thresholdFlag ? args::get(thresholdFlag) : 0.f,
-        alphaFlag ? args::get(alphaFlag) : false,
-        heatMapFlag ? args::get(heatMapFlag) : ""
-    ) ? 0 : 1;
+    return std::all_of(results.begin(), results.end(), [] (const CompareResult& r) { return r.passed; }) ? 0 : 1;
 }